@@ -9,8 +9,9 @@
  *    An append-only filesystem where nothing is ever deleted.
  *    This is the foundational storage layer for Phantom OS.
  *
- *    Build (standalone): gcc -Wall -O2 -DGEOFS_STANDALONE geofs.c -o geofs -lpthread
+ *    Build (standalone): gcc -Wall -O2 -DGEOFS_STANDALONE geofs.c kernel/lz4.c -o geofs -lpthread
  *    Build (library):    gcc -Wall -O2 -c geofs.c -o geofs.o
+ *    Deflate for cold data: add -DGEOFS_HAVE_ZLIB and -lz
  *    Usage:              ./geofs help
  *
  * ══════════════════════════════════════════════════════════════════════════════
@@ -24,12 +25,27 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 #include <sys/types.h>
 #include <pthread.h>
 #include <time.h>
 #include <errno.h>
 
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#define GEOFS_HAVE_IO_URING 1
+#endif
+#endif
+
 #include "geofs.h"
+#include "kernel/lz4.h"
+
+#ifdef GEOFS_HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 /* ══════════════════════════════════════════════════════════════════════════════
  * INTERNAL STRUCTURES
@@ -66,9 +82,13 @@ struct geofs_superblock {
 
 struct content_index_entry {
     geofs_hash_t    hash;
-    uint64_t        offset;
+    uint64_t        offset;                 /* Of the data, not its header */
     uint64_t        size;
-    struct content_index_entry *next;
+    uint64_t        stored;                 /* Bytes on disk; size unless compressed */
+    uint64_t        length;                 /* Of the content: size, or a manifest's chunks */
+    uint16_t        flags;                  /* Codec and GEOFS_OBJ_* bits */
+    uint8_t         packed;                 /* Shares blocks in a pack */
+    struct content_index_entry *next;       /* Bucket chain */
 };
 
 struct ref_index_entry {
@@ -78,7 +98,22 @@ struct ref_index_entry {
     geofs_time_t    created;
     char            path[GEOFS_MAX_PATH];
     int             is_hidden;
-    struct ref_index_entry *next;
+    struct ref_index_entry *next;           /* All refs, newest first */
+    struct ref_index_entry *version_next;   /* Same path, older */
+};
+
+/* Every version of one path, newest first */
+struct ref_path_entry {
+    geofs_hash_t    path_hash;
+    struct ref_index_entry *versions;
+    uint64_t        version_count;
+    struct ref_path_entry *next;            /* Bucket chain */
+};
+
+/* Lookup counters for one hash table */
+struct index_probe_stats {
+    uint64_t        lookups;
+    uint64_t        probes;                 /* Chain entries compared */
 };
 
 struct view_index_entry {
@@ -102,9 +137,14 @@ struct geofs_ref_record {
     geofs_time_t    created;
     uint16_t        path_len;
     char            path[GEOFS_MAX_PATH];
-    uint8_t         reserved[58];       /* Pad to GEOFS_REF_RECORD_SIZE */
+    uint8_t         reserved[34];       /* Pad to GEOFS_REF_RECORD_SIZE */
 };
 
+/* Records are written back to back from concurrent threads; one that ran
+ * past its slot would overwrite the next record's magic */
+_Static_assert(sizeof(struct geofs_ref_record) == GEOFS_REF_RECORD_SIZE,
+               "ref record must fill exactly one slot");
+
 /* On-disk view record (geological strata - each view is a layer) */
 #define GEOFS_VIEW_RECORD_MAGIC 0x57454956UL  /* "VIEW" */
 #define GEOFS_VIEW_RECORD_SIZE  128
@@ -119,17 +159,175 @@ struct geofs_view_record {
     uint8_t         reserved[24];       /* Pad to GEOFS_VIEW_RECORD_SIZE */
 };
 
+/*
+ * Content is written as a log of segments: the content blocks of one or
+ * more stores followed by a trailer block that commits them. On open,
+ * segments past the superblock's content_next_block (written after the
+ * last sync) are only accepted if their trailer checksum matches, so a
+ * torn tail is dropped instead of indexed.
+ */
+#define GEOFS_SEGMENT_MAGIC     0x54474553UL  /* "SEGT" */
+#define GEOFS_SEGMENT_BLOCKS    256           /* Staging buffer, 1 MB */
+#define GEOFS_SEGMENT_REFS      64            /* Ref records staged per flush */
+
+#define GEOFS_ASYNC_DEPTH       256           /* io_uring entries, ops in flight */
+#define GEOFS_ASYNC_BATCH       32            /* Queued entries that force a submit */
+#define GEOFS_ASYNC_DIRECT_MIN  (64 * 1024)   /* Smaller async stores are staged */
+
+struct geofs_segment_trailer {
+    uint32_t        magic;
+    uint32_t        checksum;           /* CRC-32C of the blocks before the trailer */
+    uint64_t        blocks;             /* Blocks covered, trailer excluded */
+    uint64_t        objects;
+    uint64_t        sequence;
+};
+
+/*
+ * Objects smaller than GEOFS_PACK_MAX_OBJECT don't get a header block of
+ * their own. They are packed back to back into a run of blocks inside a
+ * segment, each behind a compact header, so a 200-byte message costs
+ * about 250 bytes instead of two blocks. Larger objects keep the
+ * block-aligned "CONT" header block layout.
+ */
+#define GEOFS_PACK_MAGIC        0x4B434150UL  /* "PACK" */
+#define GEOFS_PACK_MAX_OBJECT   (16 * 1024)
+#define GEOFS_PACK_ALIGN        8
+
+struct geofs_pack_header {              /* Starts the first block of a pack */
+    uint32_t        magic;
+    uint32_t        blocks;             /* Blocks the pack spans */
+    uint32_t        objects;
+    uint32_t        used;               /* Bytes used, this header included */
+};
+
+struct geofs_packed_object {            /* Precedes each packed object's data */
+    geofs_hash_t    hash;
+    uint32_t        length;             /* Stored bytes that follow */
+    uint16_t        flags;              /* Codec and GEOFS_OBJ_* bits */
+    uint16_t        reserved;
+    uint32_t        checksum;           /* CRC-32C of the stored bytes */
+    uint32_t        size;               /* Before compression */
+};
+
+/*
+ * Objects carry flags: the codec in the low byte, whether the object
+ * supersedes an earlier copy of itself (see geofs_volume_recompress), and
+ * whether it is a manifest of chunks (see geofs_manifest_store).
+ * Block-format objects keep them after the "CONT" magic, with the stored
+ * size at byte 48.
+ */
+#define GEOFS_OBJ_CODEC_MASK    0x00FF
+#define GEOFS_OBJ_SUPERSEDES    0x0100
+#define GEOFS_OBJ_MANIFEST      0x0200
+#define GEOFS_COMPRESS_MIN      64            /* Smaller objects stay raw */
+
+/*
+ * A manifest's bytes: this header, then each chunk's hash and size. Its
+ * hash is of those bytes with a tag folded in (see manifest_hash), so
+ * manifests dedup with each other but never with plain content.
+ */
+#define GEOFS_MANIFEST_MAGIC    0x4E414D47UL  /* "GMAN" */
+
+struct geofs_manifest_header {
+    uint32_t        magic;
+    uint32_t        reserved;
+    uint64_t        chunks;
+    uint64_t        size;               /* Of the content, all chunks together */
+};
+
+struct geofs_manifest_entry {
+    geofs_hash_t    hash;
+    uint64_t        size;
+};
+
+#define GEOFS_PACK_RECORD(size) \
+    (sizeof(struct geofs_packed_object) + \
+     (((size) + GEOFS_PACK_ALIGN - 1) & ~(uint64_t)(GEOFS_PACK_ALIGN - 1)))
+
+/*
+ * Memory behind content views: either the volume's mapping of its content
+ * region, or a heap copy made for one view of an unmapped volume. The
+ * volume holds one reference on its mapping and every view holds another,
+ * so a mapping outlives the volume until its last view is released.
+ */
+struct geofs_mapping {
+    uint8_t        *base;
+    size_t          length;
+    int             is_mmap;            /* munmap rather than free */
+    uint64_t        refs;
+};
+
 /* Full definition of opaque geofs_volume type */
 struct geofs_volume {
     int             fd;
     char            path[GEOFS_MAX_PATH];
     struct geofs_superblock sb;
-    struct content_index_entry *content_index;
-    struct ref_index_entry *ref_index;
+
+    /* Content by hash; refs by path hash, each path holding its versions */
+    struct content_index_entry **content_buckets;
+    uint64_t        content_nbuckets;
+    uint64_t        content_count;
+    uint64_t        packed_count;           /* Of those, packed */
+    uint64_t        compressed_count;
+    uint64_t        recompressed_count;
+    uint64_t        stored_bytes;           /* Indexed copies, after compression */
+    uint64_t        superseded_bytes;
+    struct ref_path_entry **ref_buckets;
+    uint64_t        ref_nbuckets;
+    uint64_t        ref_paths;
+    uint64_t        ref_count;
+    uint64_t        ref_generation;     /* See geofs_ref_generation */
+    struct index_probe_stats content_probe;
+    struct index_probe_stats ref_probe;
+
+    struct ref_index_entry *ref_index;      /* Every ref, for listings */
     struct view_index_entry *view_index;
     geofs_view_t    current_view;
-    pthread_mutex_t lock;
+    struct geofs_mapping *mapping;          /* Set by geofs_volume_map */
+    geofs_codec_t   codec;                  /* For new stores */
+
+    /*
+     * Readers of the indices share the lock; inserts, view changes and
+     * close take it exclusively. Stored content is immutable, so reads do
+     * their I/O after dropping it.
+     */
+    pthread_rwlock_t lock;
     int             dirty;
+
+    /*
+     * Write staging. Stores and ref records are copied into the segment
+     * under seg_lock, which alone advances sb.content_next_block and
+     * sb.ref_next_id when the segment is flushed. Content at or past
+     * content_next_block is still staged; reads of it flush first.
+     * seg_lock is taken after the index lock. staged_ops only grows under
+     * it, atomically, so the flusher can read it without the lock.
+     */
+    pthread_mutex_t seg_lock;
+    uint8_t        *seg_buf;                /* GEOFS_SEGMENT_BLOCKS blocks */
+    uint64_t        seg_blocks;
+    uint64_t        seg_objects;
+    int             pack_open;              /* Last staged blocks are a pack */
+    uint64_t        pack_start;             /* Its first block in seg_buf */
+    uint64_t        pack_used;              /* Bytes used from there */
+    struct geofs_ref_record *seg_refs;      /* GEOFS_SEGMENT_REFS records */
+    uint64_t        seg_nrefs;
+    uint64_t        seg_sequence;           /* Segments written */
+    uint64_t        staged_ops;             /* Stores and refs staged, ever */
+
+    /* Durability: sync_lock serializes fdatasync; synced_ops trails staged_ops */
+    pthread_mutex_t sync_lock;
+    uint64_t        synced_ops;
+    geofs_sync_policy_t sync_policy;
+    unsigned        sync_interval_ms;
+    pthread_t       flusher;                /* Runs under GEOFS_SYNC_GROUP */
+    int             flusher_running;
+    int             flusher_stop;
+    pthread_mutex_t flusher_lock;
+    pthread_cond_t  flusher_cond;
+
+    /* Asynchronous operations; created on first use, see ASYNCHRONOUS I/O */
+    pthread_mutex_t async_lock;
+    struct geofs_async *async;
 };
 
 /* ══════════════════════════════════════════════════════════════════════════════
@@ -285,231 +483,1226 @@ const char *geofs_strerror(geofs_error_t err) {
  * INDEX FUNCTIONS
  * ══════════════════════════════════════════════════════════════════════════════ */
 
+#define GEOFS_INDEX_MIN_BUCKETS 1024        /* Power of two; doubles at load 1 */
+
+/* SHA-256 output is already uniform, so its first 8 bytes pick the bucket */
+static uint64_t hash_bucket(const geofs_hash_t hash, uint64_t nbuckets) {
+    uint64_t key;
+    memcpy(&key, hash, sizeof(key));
+    return key & (nbuckets - 1);
+}
+
+static geofs_error_t index_init(geofs_volume_t *vol) {
+    vol->content_buckets = calloc(GEOFS_INDEX_MIN_BUCKETS,
+                                  sizeof(*vol->content_buckets));
+    vol->ref_buckets = calloc(GEOFS_INDEX_MIN_BUCKETS,
+                              sizeof(*vol->ref_buckets));
+    if (!vol->content_buckets || !vol->ref_buckets) {
+        free(vol->content_buckets);
+        free(vol->ref_buckets);
+        vol->content_buckets = NULL;
+        vol->ref_buckets = NULL;
+        return GEOFS_ERR_NOMEM;
+    }
+    vol->content_nbuckets = GEOFS_INDEX_MIN_BUCKETS;
+    vol->ref_nbuckets = GEOFS_INDEX_MIN_BUCKETS;
+    return GEOFS_OK;
+}
+
+static void index_free(geofs_volume_t *vol) {
+    for (uint64_t i = 0; vol->content_buckets && i < vol->content_nbuckets; i++) {
+        struct content_index_entry *ce = vol->content_buckets[i];
+        while (ce) {
+            struct content_index_entry *next = ce->next;
+            free(ce);
+            ce = next;
+        }
+    }
+    free(vol->content_buckets);
+    vol->content_buckets = NULL;
+
+    for (uint64_t i = 0; vol->ref_buckets && i < vol->ref_nbuckets; i++) {
+        struct ref_path_entry *pe = vol->ref_buckets[i];
+        while (pe) {
+            struct ref_path_entry *next = pe->next;
+            free(pe);
+            pe = next;
+        }
+    }
+    free(vol->ref_buckets);
+    vol->ref_buckets = NULL;
+
+    struct ref_index_entry *re = vol->ref_index;
+    while (re) {
+        struct ref_index_entry *next = re->next;
+        free(re);
+        re = next;
+    }
+    vol->ref_index = NULL;
+
+    struct view_index_entry *ve = vol->view_index;
+    while (ve) {
+        struct view_index_entry *next = ve->next;
+        free(ve);
+        ve = next;
+    }
+    vol->view_index = NULL;
+}
+
+/* Double a table once it averages more than one entry per bucket. If the
+ * bigger table can't be allocated the old one keeps working, just slower */
+static void content_index_grow(geofs_volume_t *vol) {
+    uint64_t nbuckets = vol->content_nbuckets * 2;
+    struct content_index_entry **buckets = calloc(nbuckets, sizeof(*buckets));
+    if (!buckets) return;
+
+    for (uint64_t i = 0; i < vol->content_nbuckets; i++) {
+        struct content_index_entry *entry = vol->content_buckets[i];
+        while (entry) {
+            struct content_index_entry *next = entry->next;
+            uint64_t b = hash_bucket(entry->hash, nbuckets);
+            entry->next = buckets[b];
+            buckets[b] = entry;
+            entry = next;
+        }
+    }
+    free(vol->content_buckets);
+    vol->content_buckets = buckets;
+    vol->content_nbuckets = nbuckets;
+}
+
+static void ref_index_grow(geofs_volume_t *vol) {
+    uint64_t nbuckets = vol->ref_nbuckets * 2;
+    struct ref_path_entry **buckets = calloc(nbuckets, sizeof(*buckets));
+    if (!buckets) return;
+
+    for (uint64_t i = 0; i < vol->ref_nbuckets; i++) {
+        struct ref_path_entry *pe = vol->ref_buckets[i];
+        while (pe) {
+            struct ref_path_entry *next = pe->next;
+            uint64_t b = hash_bucket(pe->path_hash, nbuckets);
+            pe->next = buckets[b];
+            buckets[b] = pe;
+            pe = next;
+        }
+    }
+    free(vol->ref_buckets);
+    vol->ref_buckets = buckets;
+    vol->ref_nbuckets = nbuckets;
+}
+
+/* Lookups run under the shared lock, so the counters are atomic */
+static void probe_count(struct index_probe_stats *st, uint64_t probes) {
+    __atomic_fetch_add(&st->lookups, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&st->probes, probes, __ATOMIC_RELAXED);
+}
+
 static struct content_index_entry *find_content(geofs_volume_t *vol,
                                                  const geofs_hash_t hash) {
-    struct content_index_entry *entry = vol->content_index;
+    uint64_t probes = 0;
+    struct content_index_entry *entry =
+        vol->content_buckets[hash_bucket(hash, vol->content_nbuckets)];
     while (entry) {
-        if (hash_equal(entry->hash, hash)) return entry;
+        probes++;
+        if (hash_equal(entry->hash, hash)) break;
         entry = entry->next;
     }
-    return NULL;
+    probe_count(&vol->content_probe, probes);
+    return entry;
+}
+
+static void content_index_insert(geofs_volume_t *vol,
+                                 struct content_index_entry *entry) {
+    if (vol->content_count >= vol->content_nbuckets) {
+        content_index_grow(vol);
+    }
+    uint64_t b = hash_bucket(entry->hash, vol->content_nbuckets);
+    entry->next = vol->content_buckets[b];
+    vol->content_buckets[b] = entry;
+    vol->content_count++;
+    vol->stored_bytes += entry->stored;
+    if (entry->packed) vol->packed_count++;
+    if (entry->flags & GEOFS_OBJ_CODEC_MASK) vol->compressed_count++;
+    if (entry->flags & GEOFS_OBJ_SUPERSEDES) vol->recompressed_count++;
+}
+
+/* Point an indexed object at a rewritten copy of it. Write lock held */
+static void content_index_supersede(geofs_volume_t *vol, struct content_index_entry *old,
+                                    const struct content_index_entry *copy) {
+    vol->superseded_bytes += old->stored;
+    vol->stored_bytes += copy->stored - old->stored;
+    if (old->packed) vol->packed_count--;
+    if (copy->packed) vol->packed_count++;
+    if (old->flags & GEOFS_OBJ_CODEC_MASK) vol->compressed_count--;
+    if (copy->flags & GEOFS_OBJ_CODEC_MASK) vol->compressed_count++;
+    if (!(old->flags & GEOFS_OBJ_SUPERSEDES)) vol->recompressed_count++;
+
+    old->offset = copy->offset;
+    old->stored = copy->stored;
+    old->flags = copy->flags;
+    old->packed = copy->packed;
+}
+
+static struct ref_path_entry *find_path(geofs_volume_t *vol,
+                                        const geofs_hash_t path_hash) {
+    uint64_t probes = 0;
+    struct ref_path_entry *pe =
+        vol->ref_buckets[hash_bucket(path_hash, vol->ref_nbuckets)];
+    while (pe) {
+        probes++;
+        if (hash_equal(pe->path_hash, path_hash)) break;
+        pe = pe->next;
+    }
+    probe_count(&vol->ref_probe, probes);
+    return pe;
 }
 
+/* Newest version visible from the current view. Versions are kept newest
+ * first, so that is the first one not from a later view */
 static struct ref_index_entry *find_ref(geofs_volume_t *vol, const char *path) {
     geofs_hash_t path_hash;
     hash_path(path, path_hash);
 
-    struct ref_index_entry *best = NULL;
-    geofs_time_t best_time = 0;
+    struct ref_path_entry *pe = find_path(vol, path_hash);
+    if (!pe) return NULL;
 
-    struct ref_index_entry *entry = vol->ref_index;
+    struct ref_index_entry *entry = pe->versions;
     while (entry) {
-        if (hash_equal(entry->path_hash, path_hash)) {
-            if (entry->view_id <= vol->current_view && entry->created > best_time) {
-                best = entry;
-                best_time = entry->created;
-            }
-        }
-        entry = entry->next;
+        if (entry->view_id <= vol->current_view) return entry;
+        entry = entry->version_next;
     }
-    return best;
+    return NULL;
 }
 
-/* Write a ref record to the ref region on disk */
-static geofs_error_t geofs_ref_write_record(geofs_volume_t *vol,
-                                             const struct ref_index_entry *entry) {
-    /* Calculate offset in ref region based on ref_next_id */
-    uint64_t ref_offset = vol->sb.ref_region_start * GEOFS_BLOCK_SIZE +
-                          (vol->sb.ref_next_id - 1) * GEOFS_REF_RECORD_SIZE;
+/* Add a ref to the full list and to its path's version chain */
+static geofs_error_t ref_index_insert(geofs_volume_t *vol,
+                                      struct ref_index_entry *entry) {
+    struct ref_path_entry *pe = find_path(vol, entry->path_hash);
 
-    /* Check if we have space in the ref region */
-    uint64_t ref_region_end = (vol->sb.ref_region_start + vol->sb.ref_region_blocks) * GEOFS_BLOCK_SIZE;
-    if (ref_offset + GEOFS_REF_RECORD_SIZE > ref_region_end) {
-        return GEOFS_ERR_FULL;
+    /* A path appearing, or coming back from hiding, is news to negative caches */
+    if (!entry->is_hidden && (!pe || !pe->versions || pe->versions->is_hidden)) {
+        __atomic_add_fetch(&vol->ref_generation, 1, __ATOMIC_RELEASE);
     }
+    if (!pe) {
+        pe = calloc(1, sizeof(*pe));
+        if (!pe) return GEOFS_ERR_NOMEM;
+        memcpy(pe->path_hash, entry->path_hash, GEOFS_HASH_SIZE);
 
-    /* Build the on-disk record */
-    struct geofs_ref_record record = {0};
-    record.magic = GEOFS_REF_RECORD_MAGIC;
-    record.flags = entry->is_hidden ? 1 : 0;
-    memcpy(record.path_hash, entry->path_hash, GEOFS_HASH_SIZE);
-    memcpy(record.content_hash, entry->content_hash, GEOFS_HASH_SIZE);
-    record.view_id = entry->view_id;
-    record.created = entry->created;
-    record.path_len = (uint16_t)strlen(entry->path);
-    strncpy(record.path, entry->path, GEOFS_MAX_PATH - 1);
-
-    /* Write to disk */
-    if (lseek(vol->fd, ref_offset, SEEK_SET) != (off_t)ref_offset) {
-        return GEOFS_ERR_IO;
+        if (vol->ref_paths >= vol->ref_nbuckets) {
+            ref_index_grow(vol);
+        }
+        uint64_t b = hash_bucket(pe->path_hash, vol->ref_nbuckets);
+        pe->next = vol->ref_buckets[b];
+        vol->ref_buckets[b] = pe;
+        vol->ref_paths++;
     }
-    if (write(vol->fd, &record, sizeof(record)) != sizeof(record)) {
-        return GEOFS_ERR_IO;
+
+    /* Refs arrive in creation order, so this is normally the head */
+    struct ref_index_entry **link = &pe->versions;
+    while (*link && (*link)->created > entry->created) {
+        link = &(*link)->version_next;
     }
+    entry->version_next = *link;
+    *link = entry;
+    pe->version_count++;
 
-    vol->sb.ref_next_id++;
+    entry->next = vol->ref_index;
+    vol->ref_index = entry;
+    vol->ref_count++;
     return GEOFS_OK;
 }
 
-/* Rebuild the content index by scanning the content region on disk */
-static geofs_error_t geofs_content_rebuild(geofs_volume_t *vol) {
-    uint64_t offset = vol->sb.content_region_start * GEOFS_BLOCK_SIZE;
-    uint64_t end_offset = vol->sb.content_next_block * GEOFS_BLOCK_SIZE;
+/* pwrite/pread the whole buffer, retrying short transfers */
+static geofs_error_t pwrite_full(int fd, const void *buf, size_t len, uint64_t offset) {
+    const uint8_t *p = buf;
+    while (len > 0) {
+        ssize_t n = pwrite(fd, p, len, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return GEOFS_ERR_IO;
+        p += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return GEOFS_OK;
+}
 
-    while (offset < end_offset) {
-        uint8_t header[GEOFS_BLOCK_SIZE];
-        if (lseek(vol->fd, offset, SEEK_SET) != (off_t)offset) {
-            return GEOFS_ERR_IO;
+/* As pwrite_full, for a gather list. Consumes iov */
+static geofs_error_t pwritev_full(int fd, struct iovec *iov, int iovcnt, uint64_t offset) {
+    for (;;) {
+        while (iovcnt > 0 && iov->iov_len == 0) {
+            iov++;
+            iovcnt--;
         }
-        if (read(vol->fd, header, GEOFS_BLOCK_SIZE) != GEOFS_BLOCK_SIZE) {
-            return GEOFS_ERR_IO;
+        if (iovcnt == 0) return GEOFS_OK;
+
+        ssize_t n = pwritev(fd, iov, iovcnt, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return GEOFS_ERR_IO;
+        offset += (uint64_t)n;
+        while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= (ssize_t)iov->iov_len;
+            iov++;
+            iovcnt--;
         }
-
-        /* Validate content header magic */
-        if (memcmp(header, "CONT", 4) != 0) {
-            break;  /* End of valid content */
+        if (iovcnt > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
         }
+    }
+}
+
+static ssize_t pread_full(int fd, void *buf, size_t len, uint64_t offset) {
+    uint8_t *p = buf;
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pread(fd, p + done, len - done, (off_t)(offset + done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0) break;
+        done += (size_t)n;
+    }
+    return (ssize_t)done;
+}
 
-        uint64_t size;
-        memcpy(&size, header + 8, 8);
+static void mapping_release(struct geofs_mapping *m) {
+    if (__atomic_sub_fetch(&m->refs, 1, __ATOMIC_ACQ_REL) != 0) return;
+    if (m->is_mmap) munmap(m->base, m->length);
+    free(m);                                /* A heap copy shares this block */
+}
 
-        geofs_hash_t hash;
-        memcpy(hash, header + 16, GEOFS_HASH_SIZE);
+/* ══════════════════════════════════════════════════════════════════════════════
+ * COMPRESSION
+ * ══════════════════════════════════════════════════════════════════════════════ */
 
-        /* Create in-memory index entry */
-        struct content_index_entry *entry = calloc(1, sizeof(struct content_index_entry));
-        if (!entry) {
-            return GEOFS_ERR_NOMEM;
-        }
+/* One object as it goes to disk */
+struct content_blob {
+    const void     *data;               /* Stored bytes */
+    uint64_t        stored;
+    uint64_t        size;               /* Before compression */
+    uint64_t        length;             /* Of the content; see content_index_entry */
+    uint16_t        flags;              /* Codec and GEOFS_OBJ_* bits */
+    void           *owned;              /* Compressed copy, freed with the blob */
+};
 
-        memcpy(entry->hash, hash, GEOFS_HASH_SIZE);
-        entry->offset = offset;
-        entry->size = size;
+int geofs_codec_available(geofs_codec_t codec) {
+    switch (codec) {
+    case GEOFS_CODEC_NONE:
+    case GEOFS_CODEC_LZ4:
+        return 1;
+    case GEOFS_CODEC_DEFLATE:
+#ifdef GEOFS_HAVE_ZLIB
+        return 1;
+#else
+        return 0;
+#endif
+    }
+    return 0;
+}
 
-        /* Add to index (prepend to list) */
-        entry->next = vol->content_index;
-        vol->content_index = entry;
+static int codec_compress(geofs_codec_t codec, const void *src, size_t len,
+                          uint8_t *dst, size_t dst_max, size_t *out_len) {
+    switch (codec) {
+    case GEOFS_CODEC_LZ4:
+        return lz4_compress(src, len, dst, dst_max, out_len);
+#ifdef GEOFS_HAVE_ZLIB
+    case GEOFS_CODEC_DEFLATE: {
+        uLongf n = dst_max;
+        if (compress2(dst, &n, src, len, Z_BEST_COMPRESSION) != Z_OK) return -1;
+        *out_len = n;
+        return 0;
+    }
+#endif
+    default:
+        return -1;
+    }
+}
 
-        /* Move to next content block */
-        uint64_t data_blocks = (size + GEOFS_BLOCK_SIZE - 1) / GEOFS_BLOCK_SIZE;
-        offset += (1 + data_blocks) * GEOFS_BLOCK_SIZE;
+/*
+ * Describe data for storing with codec: compressed if that saves at least
+ * 10%, like the kernel's GeoFS, else raw and pointing at data.
+ */
+static void content_encode(geofs_codec_t codec, const void *data, size_t size,
+                           struct content_blob *blob) {
+    memset(blob, 0, sizeof(*blob));
+    blob->data = data;
+    blob->stored = size;
+    blob->size = size;
+    blob->length = size;
+    if (codec == GEOFS_CODEC_NONE || size < GEOFS_COMPRESS_MIN) return;
+
+    /* Output that would not pay is abandoned part way */
+    size_t limit = size - size / 10;
+    uint8_t *out = malloc(limit);
+    if (!out) return;
+    size_t len;
+    if (codec_compress(codec, data, size, out, limit, &len) != 0 || len >= limit) {
+        free(out);
+        return;
     }
+    blob->data = out;
+    blob->owned = out;
+    blob->stored = len;
+    blob->flags = (uint16_t)codec;
+}
 
-    return GEOFS_OK;
+static void content_blob_free(struct content_blob *blob) {
+    free(blob->owned);
+    blob->owned = NULL;
 }
 
-/* Rebuild the ref index by scanning the ref region on disk */
-static geofs_error_t geofs_refs_rebuild(geofs_volume_t *vol) {
-    uint64_t ref_region_start = vol->sb.ref_region_start * GEOFS_BLOCK_SIZE;
-    uint64_t num_refs = vol->sb.ref_next_id - 1;  /* ref_next_id starts at 1 */
+static geofs_error_t content_decode(uint16_t flags, const uint8_t *src, uint64_t stored,
+                                    uint8_t *dst, uint64_t size) {
+    size_t got = 0;
+    switch (flags & GEOFS_OBJ_CODEC_MASK) {
+    case GEOFS_CODEC_LZ4:
+        if (lz4_decompress(src, stored, dst, size, &got) != 0) return GEOFS_ERR_CORRUPT;
+        break;
+#ifdef GEOFS_HAVE_ZLIB
+    case GEOFS_CODEC_DEFLATE: {
+        uLongf n = size;
+        if (uncompress(dst, &n, src, stored) != Z_OK) return GEOFS_ERR_CORRUPT;
+        got = n;
+        break;
+    }
+#endif
+    default:
+        return GEOFS_ERR_INVALID;       /* Codec not built in */
+    }
+    return got == size ? GEOFS_OK : GEOFS_ERR_CORRUPT;
+}
 
-    for (uint64_t i = 0; i < num_refs; i++) {
-        uint64_t offset = ref_region_start + i * GEOFS_REF_RECORD_SIZE;
+/* Read an object's stored bytes at offset and decode all size bytes into dst */
+static geofs_error_t content_load(geofs_volume_t *vol, uint64_t offset, uint64_t stored,
+                                  uint16_t flags, uint8_t *dst, uint64_t size) {
+    if (!(flags & GEOFS_OBJ_CODEC_MASK)) {
+        return pread_full(vol->fd, dst, size, offset) == (ssize_t)size ? GEOFS_OK
+                                                                       : GEOFS_ERR_IO;
+    }
+    uint8_t *buf = malloc(stored ? stored : 1);
+    if (!buf) return GEOFS_ERR_NOMEM;
+    geofs_error_t err = GEOFS_ERR_IO;
+    if (pread_full(vol->fd, buf, stored, offset) == (ssize_t)stored) {
+        err = content_decode(flags, buf, stored, dst, size);
+    }
+    free(buf);
+    return err;
+}
 
-        struct geofs_ref_record record;
-        if (lseek(vol->fd, offset, SEEK_SET) != (off_t)offset) {
-            return GEOFS_ERR_IO;
-        }
-        if (read(vol->fd, &record, sizeof(record)) != sizeof(record)) {
-            return GEOFS_ERR_IO;
-        }
+/* ══════════════════════════════════════════════════════════════════════════════
+ * WRITE STAGING AND DURABILITY
+ * ══════════════════════════════════════════════════════════════════════════════ */
 
-        /* Validate magic */
-        if (record.magic != GEOFS_REF_RECORD_MAGIC) {
-            continue;  /* Skip invalid/corrupted records */
+/*
+ * CRC-32C (Castagnoli). x86-64 CPUs with SSE4.2 compute it in hardware;
+ * elsewhere a table does eight bytes per step (slicing-by-8).
+ */
+static void async_quiesce(geofs_volume_t *vol);
+static void async_clip_snapshot(geofs_volume_t *vol, uint64_t *block, uint64_t *ops);
+static void async_free(geofs_volume_t *vol);
+
+static uint32_t crc32c_table[8][256];
+static int crc32c_hw;
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+static void crc32c_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0x82F63B78u ^ (c >> 1) : c >> 1;
         }
-
-        /* Create in-memory index entry */
-        struct ref_index_entry *entry = calloc(1, sizeof(struct ref_index_entry));
-        if (!entry) {
-            return GEOFS_ERR_NOMEM;
+        crc32c_table[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int t = 1; t < 8; t++) {
+            uint32_t c = crc32c_table[t - 1][i];
+            crc32c_table[t][i] = crc32c_table[0][c & 0xFF] ^ (c >> 8);
         }
-
-        memcpy(entry->path_hash, record.path_hash, GEOFS_HASH_SIZE);
-        memcpy(entry->content_hash, record.content_hash, GEOFS_HASH_SIZE);
-        entry->view_id = record.view_id;
-        entry->created = record.created;
-        strncpy(entry->path, record.path, GEOFS_MAX_PATH - 1);
-        entry->is_hidden = (record.flags & 1) ? 1 : 0;
-
-        /* Add to index (prepend to list) */
-        entry->next = vol->ref_index;
-        vol->ref_index = entry;
     }
-
-    return GEOFS_OK;
+#if defined(__x86_64__)
+    crc32c_hw = __builtin_cpu_supports("sse4.2") != 0;
+#endif
 }
 
-/* Write a view record to the view region on disk */
-static geofs_error_t geofs_view_write_record(geofs_volume_t *vol,
-                                              const struct view_index_entry *entry) {
-    /* Calculate offset in view region based on view id */
-    uint64_t view_offset = vol->sb.view_region_start * GEOFS_BLOCK_SIZE +
-                           (entry->id - 1) * GEOFS_VIEW_RECORD_SIZE;
-
-    /* Check if we have space in the view region */
-    uint64_t view_region_end = (vol->sb.view_region_start + vol->sb.view_region_blocks) * GEOFS_BLOCK_SIZE;
-    if (view_offset + GEOFS_VIEW_RECORD_SIZE > view_region_end) {
-        return GEOFS_ERR_FULL;
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_update_hw(uint32_t crc, const uint8_t *p, size_t len) {
+    uint64_t c = crc;
+    while (len >= 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        c = __builtin_ia32_crc32di(c, v);
+        p += 8;
+        len -= 8;
     }
-
-    /* Build the on-disk record */
-    struct geofs_view_record record = {0};
-    record.magic = GEOFS_VIEW_RECORD_MAGIC;
-    record.flags = 0;
-    record.id = entry->id;
-    record.parent_id = entry->parent_id;
-    record.created = entry->created;
-    strncpy(record.label, entry->label, 63);
-
-    /* Write to disk */
-    if (lseek(vol->fd, view_offset, SEEK_SET) != (off_t)view_offset) {
-        return GEOFS_ERR_IO;
+    while (len--) {
+        c = __builtin_ia32_crc32qi((uint32_t)c, *p++);
     }
-    if (write(vol->fd, &record, sizeof(record)) != sizeof(record)) {
-        return GEOFS_ERR_IO;
+    return (uint32_t)c;
+}
+#endif
+
+/* Running CRC-32C: start from 0xFFFFFFFF, invert the final value */
+static uint32_t crc32c_update(uint32_t crc, const void *data, size_t len) {
+    const uint8_t *p = data;
+#if defined(__x86_64__)
+    if (crc32c_hw) return crc32c_update_hw(crc, p, len);
+#endif
+    while (len >= 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = crc32c_table[7][lo & 0xFF] ^ crc32c_table[6][(lo >> 8) & 0xFF] ^
+              crc32c_table[5][(lo >> 16) & 0xFF] ^ crc32c_table[4][lo >> 24] ^
+              crc32c_table[3][hi & 0xFF] ^ crc32c_table[2][(hi >> 8) & 0xFF] ^
+              crc32c_table[1][(hi >> 16) & 0xFF] ^ crc32c_table[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = crc32c_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
     }
+    return crc;
+}
+
+static geofs_error_t staging_init(geofs_volume_t *vol) {
+    pthread_once(&crc32c_once, crc32c_init);
+    pthread_mutex_init(&vol->seg_lock, NULL);
+    pthread_mutex_init(&vol->sync_lock, NULL);
+    pthread_mutex_init(&vol->flusher_lock, NULL);
+    pthread_cond_init(&vol->flusher_cond, NULL);
 
+    vol->seg_buf = malloc(GEOFS_SEGMENT_BLOCKS * GEOFS_BLOCK_SIZE);
+    vol->seg_refs = malloc(GEOFS_SEGMENT_REFS * sizeof(struct geofs_ref_record));
+    if (!vol->seg_buf || !vol->seg_refs) return GEOFS_ERR_NOMEM;
     return GEOFS_OK;
 }
 
-/* Rebuild the view index by scanning the view region on disk */
-static geofs_error_t geofs_views_rebuild(geofs_volume_t *vol) {
-    uint64_t view_region_start = vol->sb.view_region_start * GEOFS_BLOCK_SIZE;
-    uint64_t num_views = vol->sb.view_next_id - 1;  /* view_next_id starts at 1 */
+static void staging_free(geofs_volume_t *vol) {
+    free(vol->seg_buf);
+    free(vol->seg_refs);
+    vol->seg_buf = NULL;
+    vol->seg_refs = NULL;
+    pthread_cond_destroy(&vol->flusher_cond);
+    pthread_mutex_destroy(&vol->flusher_lock);
+    pthread_mutex_destroy(&vol->sync_lock);
+    pthread_mutex_destroy(&vol->seg_lock);
+}
 
-    for (uint64_t i = 0; i < num_views; i++) {
-        uint64_t offset = view_region_start + i * GEOFS_VIEW_RECORD_SIZE;
+static void content_header(uint8_t header[GEOFS_BLOCK_SIZE], const geofs_hash_t hash,
+                           const struct content_blob *blob) {
+    uint32_t flags = blob->flags;
+    memset(header, 0, GEOFS_BLOCK_SIZE);
+    memcpy(header, "CONT", 4);
+    memcpy(header + 4, &flags, 4);
+    memcpy(header + 8, &blob->size, 8);
+    memcpy(header + 16, hash, GEOFS_HASH_SIZE);
+    memcpy(header + 48, &blob->stored, 8);
+}
 
-        struct geofs_view_record record;
-        if (lseek(vol->fd, offset, SEEK_SET) != (off_t)offset) {
-            return GEOFS_ERR_IO;
-        }
-        if (read(vol->fd, &record, sizeof(record)) != sizeof(record)) {
-            return GEOFS_ERR_IO;
-        }
+/*
+ * Write iov (whole blocks of content objects) and a trailer after it as
+ * one segment at content_next_block, then advance content_next_block past
+ * it. iov must have room for one more entry. Called with seg_lock held.
+ */
+static geofs_error_t segment_write_locked(geofs_volume_t *vol, struct iovec *iov,
+                                          int iovcnt, uint64_t blocks,
+                                          uint64_t objects) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (int i = 0; i < iovcnt; i++) {
+        crc = crc32c_update(crc, iov[i].iov_base, iov[i].iov_len);
+    }
 
-        /* Validate magic */
-        if (record.magic != GEOFS_VIEW_RECORD_MAGIC) {
-            continue;  /* Skip invalid/corrupted records */
-        }
+    struct geofs_segment_trailer t = {
+        .magic = GEOFS_SEGMENT_MAGIC,
+        .checksum = ~crc,
+        .blocks = blocks,
+        .objects = objects,
+        .sequence = vol->seg_sequence + 1,
+    };
+    uint8_t trailer[GEOFS_BLOCK_SIZE] = {0};
+    memcpy(trailer, &t, sizeof(t));
+    iov[iovcnt].iov_base = trailer;
+    iov[iovcnt].iov_len = GEOFS_BLOCK_SIZE;
 
-        /* Create in-memory index entry */
-        struct view_index_entry *entry = calloc(1, sizeof(struct view_index_entry));
-        if (!entry) {
-            return GEOFS_ERR_NOMEM;
-        }
+    uint64_t next = vol->sb.content_next_block;
+    geofs_error_t err = pwritev_full(vol->fd, iov, iovcnt + 1, next * GEOFS_BLOCK_SIZE);
+    if (err != GEOFS_OK) return err;
 
-        entry->id = record.id;
-        entry->parent_id = record.parent_id;
-        entry->created = record.created;
-        strncpy(entry->label, record.label, 63);
+    vol->seg_sequence++;
+    __atomic_store_n(&vol->sb.content_next_block, next + blocks + 1, __ATOMIC_RELEASE);
+    return GEOFS_OK;
+}
 
-        /* Add to index (prepend to list) */
-        entry->next = vol->view_index;
-        vol->view_index = entry;
+/* Write out the staged segment, then the staged refs. seg_lock held */
+static geofs_error_t segment_flush_locked(geofs_volume_t *vol) {
+    if (vol->seg_blocks > 0) {
+        struct iovec iov[2] = {
+            { vol->seg_buf, vol->seg_blocks * GEOFS_BLOCK_SIZE },
+        };
+        geofs_error_t err = segment_write_locked(vol, iov, 1, vol->seg_blocks,
+                                                 vol->seg_objects);
+        if (err != GEOFS_OK) return err;
+        vol->seg_blocks = 0;
+        vol->seg_objects = 0;
+        vol->pack_open = 0;
     }
 
+    /* Refs go after the content they name, in slot order */
+    if (vol->seg_nrefs > 0) {
+        uint64_t offset = vol->sb.ref_region_start * GEOFS_BLOCK_SIZE +
+                          (vol->sb.ref_next_id - 1) * GEOFS_REF_RECORD_SIZE;
+        geofs_error_t err = pwrite_full(vol->fd, vol->seg_refs,
+                                        vol->seg_nrefs * GEOFS_REF_RECORD_SIZE, offset);
+        if (err != GEOFS_OK) return err;
+        vol->sb.ref_next_id += vol->seg_nrefs;
+        vol->seg_nrefs = 0;
+    }
+    return GEOFS_OK;
+}
+
+static geofs_error_t segment_flush(geofs_volume_t *vol) {
+    pthread_mutex_lock(&vol->seg_lock);
+    geofs_error_t err = segment_flush_locked(vol);
+    pthread_mutex_unlock(&vol->seg_lock);
+    return err;
+}
+
+/* Content at offset may still be staged; make sure it is in the file */
+static geofs_error_t content_ensure_written(geofs_volume_t *vol, uint64_t offset) {
+    uint64_t written = __atomic_load_n(&vol->sb.content_next_block, __ATOMIC_ACQUIRE);
+    if (offset < written * GEOFS_BLOCK_SIZE) return GEOFS_OK;
+    return segment_flush(vol);
+}
+
+/* Raise synced_ops to ops; async syncs complete without sync_lock */
+static void synced_advance(geofs_volume_t *vol, uint64_t ops) {
+    uint64_t cur = __atomic_load_n(&vol->synced_ops, __ATOMIC_RELAXED);
+    while (cur < ops &&
+           !__atomic_compare_exchange_n(&vol->synced_ops, &cur, ops, 0,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+}
+
+/*
+ * Make everything staged up to op number upto durable: flush, fdatasync,
+ * then write a superblock that covers just what was synced. Threads that
+ * queue on sync_lock while a sync runs are usually covered by the next
+ * one and return without syncing again.
+ */
+static geofs_error_t volume_commit(geofs_volume_t *vol, uint64_t upto) {
+    pthread_mutex_lock(&vol->sync_lock);
+    if (__atomic_load_n(&vol->synced_ops, __ATOMIC_ACQUIRE) >= upto) {
+        pthread_mutex_unlock(&vol->sync_lock);
+        return GEOFS_OK;
+    }
+
+    /* Async writes already acknowledged must be covered by this sync */
+    async_quiesce(vol);
+
+    /* The index lock keeps the superblock's totals still for the snapshot */
+    pthread_rwlock_rdlock(&vol->lock);
+    pthread_mutex_lock(&vol->seg_lock);
+    geofs_error_t err = segment_flush_locked(vol);
+    uint64_t ops = vol->staged_ops;
+    struct geofs_superblock snap = vol->sb;
+    /* ...but not ones submitted since, which may not have landed */
+    async_clip_snapshot(vol, &snap.content_next_block, &ops);
+    pthread_mutex_unlock(&vol->seg_lock);
+    pthread_rwlock_unlock(&vol->lock);
+
+    if (err == GEOFS_OK && fdatasync(vol->fd) != 0) err = GEOFS_ERR_IO;
+    if (err == GEOFS_OK) {
+        snap.last_modified = geofs_time_now();
+        err = pwrite_full(vol->fd, &snap, sizeof(snap), 0);
+    }
+    if (err == GEOFS_OK) synced_advance(vol, ops);
+
+    pthread_mutex_unlock(&vol->sync_lock);
+    return err;
+}
+
+/* Apply the sync policy after staging op number ops */
+static geofs_error_t commit_policy(geofs_volume_t *vol, uint64_t ops) {
+    if (__atomic_load_n(&vol->sync_policy, __ATOMIC_RELAXED) != GEOFS_SYNC_PER_OP) {
+        return GEOFS_OK;
+    }
+    return volume_commit(vol, ops);
+}
+
+/*
+ * Append a small object to the open pack, or start a pack after the
+ * staged blocks. The pack grows a block at a time as the last thing in
+ * the staging buffer. seg_lock held, room checked.
+ */
+static geofs_error_t pack_stage_locked(geofs_volume_t *vol, const geofs_hash_t hash,
+                                       const struct content_blob *blob,
+                                       uint64_t *offset_out) {
+    uint64_t record = GEOFS_PACK_RECORD(blob->stored);
+
+    if (vol->pack_open) {
+        uint64_t blocks = (vol->pack_used + record + GEOFS_BLOCK_SIZE - 1) / GEOFS_BLOCK_SIZE;
+        if (vol->pack_start + blocks > GEOFS_SEGMENT_BLOCKS) {
+            geofs_error_t err = segment_flush_locked(vol);
+            if (err != GEOFS_OK) return err;
+        }
+    }
+    if (!vol->pack_open) {
+        uint64_t blocks = (sizeof(struct geofs_pack_header) + record + GEOFS_BLOCK_SIZE - 1) /
+                          GEOFS_BLOCK_SIZE;
+        if (vol->seg_blocks + blocks > GEOFS_SEGMENT_BLOCKS) {
+            geofs_error_t err = segment_flush_locked(vol);
+            if (err != GEOFS_OK) return err;
+        }
+        vol->pack_open = 1;
+        vol->pack_start = vol->seg_blocks;
+        vol->pack_used = sizeof(struct geofs_pack_header);
+    }
+
+    /* Bring in zeroed blocks to cover the record, padding included */
+    uint8_t *pack = vol->seg_buf + vol->pack_start * GEOFS_BLOCK_SIZE;
+    uint64_t blocks = (vol->pack_used + record + GEOFS_BLOCK_SIZE - 1) / GEOFS_BLOCK_SIZE;
+    if (vol->pack_start + blocks > vol->seg_blocks) {
+        memset(vol->seg_buf + vol->seg_blocks * GEOFS_BLOCK_SIZE, 0,
+               (vol->pack_start + blocks - vol->seg_blocks) * GEOFS_BLOCK_SIZE);
+        vol->seg_blocks = vol->pack_start + blocks;
+    }
+
+    struct geofs_packed_object h = {
+        .length = (uint32_t)blob->stored,
+        .flags = blob->flags,
+        .checksum = ~crc32c_update(0xFFFFFFFF, blob->data, blob->stored),
+        .size = (uint32_t)blob->size,
+    };
+    memcpy(h.hash, hash, GEOFS_HASH_SIZE);
+    memcpy(pack + vol->pack_used, &h, sizeof(h));
+    memcpy(pack + vol->pack_used + sizeof(h), blob->data, blob->stored);
+    *offset_out = (vol->sb.content_next_block + vol->pack_start) * GEOFS_BLOCK_SIZE +
+                  vol->pack_used + sizeof(h);
+    vol->pack_used += record;
+
+    struct geofs_pack_header ph;
+    memcpy(&ph, pack, sizeof(ph));
+    ph.magic = GEOFS_PACK_MAGIC;
+    ph.blocks = (uint32_t)blocks;
+    ph.objects++;
+    ph.used = (uint32_t)vol->pack_used;
+    memcpy(pack, &ph, sizeof(ph));
+
+    vol->seg_objects++;
+    return GEOFS_OK;
+}
+
+/*
+ * Stage one content object and return where its data will land. Small
+ * objects are packed; objects too big for the staging buffer go out at
+ * once as a segment of their own, written straight from the caller's
+ * memory.
+ */
+static geofs_error_t content_stage(geofs_volume_t *vol, const geofs_hash_t hash,
+                                   const struct content_blob *blob,
+                                   uint64_t *offset_out, uint64_t *ops_out) {
+    static const uint8_t zero[GEOFS_BLOCK_SIZE];
+    const void *data = blob->data;
+    uint64_t size = blob->stored;
+    int packed = size < GEOFS_PACK_MAX_OBJECT;
+    uint64_t data_blocks = (size + GEOFS_BLOCK_SIZE - 1) / GEOFS_BLOCK_SIZE;
+    uint64_t blocks = 1 + data_blocks;
+    size_t pad = data_blocks * GEOFS_BLOCK_SIZE - size;
+    if (packed) {
+        blocks = 1 + (sizeof(struct geofs_pack_header) + GEOFS_PACK_RECORD(size)) /
+                     GEOFS_BLOCK_SIZE;
+    }
+
+    pthread_mutex_lock(&vol->seg_lock);
+
+    /* Room for the staged segment, this object, and both trailers */
+    uint64_t region_end = vol->sb.content_region_start + vol->sb.content_region_blocks;
+    uint64_t need = vol->seg_blocks + (vol->seg_blocks ? 1 : 0) + blocks + 1;
+    if (vol->sb.content_next_block + need > region_end) {
+        pthread_mutex_unlock(&vol->seg_lock);
+        return GEOFS_ERR_FULL;
+    }
+
+    geofs_error_t err = GEOFS_OK;
+    if (packed) {
+        err = pack_stage_locked(vol, hash, blob, offset_out);
+    } else if (blocks > GEOFS_SEGMENT_BLOCKS) {
+        err = segment_flush_locked(vol);
+        if (err == GEOFS_OK) {
+            uint8_t header[GEOFS_BLOCK_SIZE];
+            content_header(header, hash, blob);
+            struct iovec iov[4] = {
+                { header, GEOFS_BLOCK_SIZE },
+                { (void *)data, size },
+                { (void *)zero, pad },
+            };
+            *offset_out = (vol->sb.content_next_block + 1) * GEOFS_BLOCK_SIZE;
+            err = segment_write_locked(vol, iov, 3, blocks, 1);
+        }
+    } else {
+        if (vol->seg_blocks + blocks > GEOFS_SEGMENT_BLOCKS) {
+            err = segment_flush_locked(vol);
+        }
+        if (err == GEOFS_OK) {
+            uint8_t *p = vol->seg_buf + vol->seg_blocks * GEOFS_BLOCK_SIZE;
+            content_header(p, hash, blob);
+            memcpy(p + GEOFS_BLOCK_SIZE, data, size);
+            memset(p + GEOFS_BLOCK_SIZE + size, 0, pad);
+            *offset_out = (vol->sb.content_next_block + vol->seg_blocks + 1) *
+                          GEOFS_BLOCK_SIZE;
+            vol->seg_blocks += blocks;
+            vol->seg_objects++;
+            vol->pack_open = 0;
+        }
+    }
+    if (err == GEOFS_OK) *ops_out = __atomic_add_fetch(&vol->staged_ops, 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_unlock(&vol->seg_lock);
+    return err;
+}
+
+/* Stage a ref record; it gets the next slot in the ref region when flushed */
+static geofs_error_t geofs_ref_stage_record(geofs_volume_t *vol,
+                                             const struct ref_index_entry *entry,
+                                             uint64_t *ops_out) {
+    /* Build the on-disk record */
+    struct geofs_ref_record record = {0};
+    record.magic = GEOFS_REF_RECORD_MAGIC;
+    record.flags = entry->is_hidden ? 1 : 0;
+    memcpy(record.path_hash, entry->path_hash, GEOFS_HASH_SIZE);
+    memcpy(record.content_hash, entry->content_hash, GEOFS_HASH_SIZE);
+    record.view_id = entry->view_id;
+    record.created = entry->created;
+    record.path_len = (uint16_t)strlen(entry->path);
+    strncpy(record.path, entry->path, GEOFS_MAX_PATH - 1);
+
+    uint64_t ref_capacity = vol->sb.ref_region_blocks * GEOFS_BLOCK_SIZE /
+                            GEOFS_REF_RECORD_SIZE;
+
+    pthread_mutex_lock(&vol->seg_lock);
+    /* ref_next_id starts at 1 */
+    if (vol->sb.ref_next_id - 1 + vol->seg_nrefs >= ref_capacity) {
+        pthread_mutex_unlock(&vol->seg_lock);
+        return GEOFS_ERR_FULL;
+    }
+    geofs_error_t err = GEOFS_OK;
+    if (vol->seg_nrefs == GEOFS_SEGMENT_REFS) {
+        err = segment_flush_locked(vol);
+    }
+    if (err == GEOFS_OK) {
+        vol->seg_refs[vol->seg_nrefs++] = record;
+        *ops_out = __atomic_add_fetch(&vol->staged_ops, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&vol->seg_lock);
+    return err;
+}
+
+/* Background commits under GEOFS_SYNC_GROUP */
+static void *flusher_main(void *arg) {
+    geofs_volume_t *vol = arg;
+
+    pthread_mutex_lock(&vol->flusher_lock);
+    while (!vol->flusher_stop) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        uint64_t ns = (uint64_t)ts.tv_nsec + (uint64_t)vol->sync_interval_ms * 1000000ULL;
+        ts.tv_sec += (time_t)(ns / 1000000000ULL);
+        ts.tv_nsec = (long)(ns % 1000000000ULL);
+        pthread_cond_timedwait(&vol->flusher_cond, &vol->flusher_lock, &ts);
+        if (vol->flusher_stop) break;
+
+        pthread_mutex_unlock(&vol->flusher_lock);
+        volume_commit(vol, __atomic_load_n(&vol->staged_ops, __ATOMIC_RELAXED));
+        pthread_mutex_lock(&vol->flusher_lock);
+    }
+    pthread_mutex_unlock(&vol->flusher_lock);
+    return NULL;
+}
+
+static void flusher_stop(geofs_volume_t *vol) {
+    if (!vol->flusher_running) return;
+    pthread_mutex_lock(&vol->flusher_lock);
+    vol->flusher_stop = 1;
+    pthread_cond_signal(&vol->flusher_cond);
+    pthread_mutex_unlock(&vol->flusher_lock);
+    pthread_join(vol->flusher, NULL);
+    vol->flusher_running = 0;
+    vol->flusher_stop = 0;
+}
+
+/* CRC-32C of the file between two offsets, for checking a segment */
+static geofs_error_t segment_checksum(geofs_volume_t *vol, uint64_t start,
+                                      uint64_t end, uint32_t *crc_out) {
+    size_t chunk = GEOFS_SEGMENT_BLOCKS * GEOFS_BLOCK_SIZE;
+    uint8_t *buf = malloc(chunk);
+    if (!buf) return GEOFS_ERR_NOMEM;
+
+    uint32_t crc = 0xFFFFFFFF;
+    for (uint64_t off = start; off < end; off += chunk) {
+        size_t len = end - off < chunk ? (size_t)(end - off) : chunk;
+        if (pread_full(vol->fd, buf, len, off) != (ssize_t)len) {
+            free(buf);
+            return GEOFS_ERR_IO;
+        }
+        crc = crc32c_update(crc, buf, len);
+    }
+    free(buf);
+    *crc_out = ~crc;
+    return GEOFS_OK;
+}
+
+/* Index a scanned object unless an earlier copy (a racing store) won */
+static void content_rebuild_insert(geofs_volume_t *vol, struct content_index_entry *entry) {
+    struct content_index_entry *old = find_content(vol, entry->hash);
+    if (old) {
+        if (entry->flags & GEOFS_OBJ_SUPERSEDES) content_index_supersede(vol, old, entry);
+        free(entry);
+        return;
+    }
+    content_index_insert(vol, entry);
+    vol->sb.total_content_bytes += entry->size;
+}
+
+/*
+ * Queue the objects of the pack at offset, whose first block is in
+ * header, on pending. Objects failing their own checksum are counted for
+ * the trailer but not indexed. GEOFS_ERR_CORRUPT if the pack is malformed.
+ */
+static geofs_error_t rebuild_pack(geofs_volume_t *vol, uint64_t offset,
+                                  const uint8_t *header, uint64_t region_end,
+                                  struct content_index_entry **pending,
+                                  uint64_t *pending_count, uint64_t *next_out) {
+    struct geofs_pack_header ph;
+    memcpy(&ph, header, sizeof(ph));
+    if (ph.blocks == 0 || ph.used < sizeof(ph) ||
+        ph.used > (uint64_t)ph.blocks * GEOFS_BLOCK_SIZE ||
+        offset + (uint64_t)ph.blocks * GEOFS_BLOCK_SIZE > region_end) {
+        return GEOFS_ERR_CORRUPT;
+    }
+
+    uint8_t *pack = malloc((size_t)ph.blocks * GEOFS_BLOCK_SIZE);
+    if (!pack) return GEOFS_ERR_NOMEM;
+    if (pread_full(vol->fd, pack, ph.used, offset) != (ssize_t)ph.used) {
+        free(pack);
+        return GEOFS_ERR_IO;
+    }
+
+    geofs_error_t err = GEOFS_OK;
+    uint64_t pos = sizeof(ph);
+    for (uint32_t i = 0; i < ph.objects; i++) {
+        struct geofs_packed_object h;
+        if (pos + sizeof(h) > ph.used) {
+            err = GEOFS_ERR_CORRUPT;
+            break;
+        }
+        memcpy(&h, pack + pos, sizeof(h));
+        if (pos + GEOFS_PACK_RECORD(h.length) > ph.used) {
+            err = GEOFS_ERR_CORRUPT;
+            break;
+        }
+        (*pending_count)++;
+
+        if (~crc32c_update(0xFFFFFFFF, pack + pos + sizeof(h), h.length) == h.checksum) {
+            struct content_index_entry *entry = calloc(1, sizeof(struct content_index_entry));
+            if (!entry) {
+                err = GEOFS_ERR_NOMEM;
+                break;
+            }
+            memcpy(entry->hash, h.hash, GEOFS_HASH_SIZE);
+            entry->offset = offset + pos + sizeof(h);
+            entry->stored = h.length;
+            entry->flags = h.flags;
+            entry->size = (h.flags & GEOFS_OBJ_CODEC_MASK) ? h.size : h.length;
+            entry->length = entry->size;
+            entry->packed = 1;
+            entry->next = *pending;
+            *pending = entry;
+        }
+        pos += GEOFS_PACK_RECORD(h.length);
+    }
+    free(pack);
+
+    *next_out = offset + (uint64_t)ph.blocks * GEOFS_BLOCK_SIZE;
+    return err;
+}
+
+static geofs_error_t manifest_load(geofs_volume_t *vol, uint64_t offset, uint64_t stored,
+                                   uint16_t flags, uint64_t size,
+                                   struct geofs_chunk **chunks_out, size_t *count_out,
+                                   uint64_t *total_out);
+
+/*
+ * Index manifests with the length of their content, which only the
+ * manifests themselves record. One that doesn't decode keeps its own size
+ * and fails when read.
+ */
+static geofs_error_t content_rebuild_lengths(geofs_volume_t *vol) {
+    for (uint64_t b = 0; b < vol->content_nbuckets; b++) {
+        for (struct content_index_entry *e = vol->content_buckets[b]; e; e = e->next) {
+            if (!(e->flags & GEOFS_OBJ_MANIFEST)) continue;
+            struct geofs_chunk *chunks;
+            size_t count;
+            geofs_error_t err = manifest_load(vol, e->offset, e->stored, e->flags, e->size,
+                                              &chunks, &count, &e->length);
+            if (err == GEOFS_OK) {
+                free(chunks);
+            } else if (err != GEOFS_ERR_CORRUPT) {
+                return err;
+            }
+        }
+    }
+    return GEOFS_OK;
+}
+
+/*
+ * Rebuild the content index by scanning the content log on disk.
+ *
+ * The superblock is only written after a sync, so everything below its
+ * content_next_block is on disk and indexed as is; volumes written before
+ * segments existed have no trailers at all and are all below it. Past
+ * that point, objects are indexed only when a trailer with a matching
+ * checksum commits them. The scan stops at the first segment that doesn't
+ * check out, and new segments overwrite it.
+ */
+static geofs_error_t geofs_content_rebuild(geofs_volume_t *vol) {
+    uint64_t trusted_end = vol->sb.content_next_block * GEOFS_BLOCK_SIZE;
+    uint64_t region_end = (vol->sb.content_region_start + vol->sb.content_region_blocks) *
+                          GEOFS_BLOCK_SIZE;
+    uint64_t offset = vol->sb.content_region_start * GEOFS_BLOCK_SIZE;
+    uint64_t run_start = offset;                    /* First object of the segment */
+    uint64_t committed = offset;
+    struct content_index_entry *pending = NULL;     /* Segment's objects, newest first */
+    uint64_t pending_count = 0;
+    geofs_error_t err = GEOFS_OK;
+
+    vol->sb.total_content_bytes = 0;
+
+    while (offset + GEOFS_BLOCK_SIZE <= region_end) {
+        /* Trailerless objects reaching the superblock's extent: a volume
+         * written before segments existed. Newer segments start here */
+        if (offset == trusted_end && pending) {
+            while (pending) {
+                struct content_index_entry *next = pending->next;
+                content_rebuild_insert(vol, pending);
+                pending = next;
+            }
+            pending_count = 0;
+            run_start = committed = offset;
+        }
+
+        uint8_t header[GEOFS_BLOCK_SIZE];
+        if (pread_full(vol->fd, header, GEOFS_BLOCK_SIZE, offset) != GEOFS_BLOCK_SIZE) {
+            err = GEOFS_ERR_IO;
+            break;
+        }
+
+        if (memcmp(header, "CONT", 4) == 0) {
+            uint32_t flags;
+            uint64_t size, stored;
+            memcpy(&flags, header + 4, 4);
+            memcpy(&size, header + 8, 8);
+            memcpy(&stored, header + 48, 8);
+            if (!(flags & GEOFS_OBJ_CODEC_MASK)) stored = size;
+            uint64_t data_blocks = (stored + GEOFS_BLOCK_SIZE - 1) / GEOFS_BLOCK_SIZE;
+            uint64_t next = offset + (1 + data_blocks) * GEOFS_BLOCK_SIZE;
+            if (next > region_end) break;
+
+            struct content_index_entry *entry = calloc(1, sizeof(struct content_index_entry));
+            if (!entry) {
+                err = GEOFS_ERR_NOMEM;
+                break;
+            }
+            memcpy(entry->hash, header + 16, GEOFS_HASH_SIZE);
+            entry->offset = offset + GEOFS_BLOCK_SIZE;
+            entry->size = size;
+            entry->stored = stored;
+            entry->length = size;
+            entry->flags = (uint16_t)flags;
+            entry->next = pending;
+            pending = entry;
+            pending_count++;
+
+            offset = next;
+            continue;
+        }
+
+        uint32_t magic;
+        memcpy(&magic, header, sizeof(magic));
+        if (magic == GEOFS_PACK_MAGIC) {
+            uint64_t next;
+            geofs_error_t perr = rebuild_pack(vol, offset, header, region_end,
+                                              &pending, &pending_count, &next);
+            if (perr == GEOFS_ERR_CORRUPT) break;
+            if (perr != GEOFS_OK) {
+                err = perr;
+                break;
+            }
+            offset = next;
+            continue;
+        }
+
+        struct geofs_segment_trailer t;
+        memcpy(&t, header, sizeof(t));
+        if (t.magic != GEOFS_SEGMENT_MAGIC ||
+            t.blocks * GEOFS_BLOCK_SIZE != offset - run_start ||
+            t.objects != pending_count) {
+            break;
+        }
+        if (offset + GEOFS_BLOCK_SIZE > trusted_end) {
+            uint32_t crc;
+            err = segment_checksum(vol, run_start, offset, &crc);
+            if (err != GEOFS_OK || crc != t.checksum) break;
+        }
+
+        /* Segment committed */
+        while (pending) {
+            struct content_index_entry *next = pending->next;
+            content_rebuild_insert(vol, pending);
+            pending = next;
+        }
+        pending_count = 0;
+        vol->seg_sequence = t.sequence;
+        offset += GEOFS_BLOCK_SIZE;
+        run_start = committed = offset;
+    }
+
+    /* Objects without a trailer count only if the superblock vouches for
+     * them; trusted_end is block aligned, so their data ending below it is
+     * enough */
+    while (pending) {
+        struct content_index_entry *next = pending->next;
+        if (err == GEOFS_OK && pending->offset + pending->size <= trusted_end) {
+            content_rebuild_insert(vol, pending);
+        } else {
+            free(pending);
+        }
+        pending = next;
+    }
+    if (err != GEOFS_OK) return err;
+
+    if (committed < trusted_end) committed = trusted_end;
+    vol->sb.content_next_block = committed / GEOFS_BLOCK_SIZE;
+    return content_rebuild_lengths(vol);
+}
+
+/*
+ * Rebuild the ref index by scanning the ref region on disk. Records are
+ * written in slot order, so past the superblock's count the scan carries
+ * on until the first empty slot to pick up refs synced after it.
+ */
+static geofs_error_t geofs_refs_rebuild(geofs_volume_t *vol) {
+    uint64_t ref_region_start = vol->sb.ref_region_start * GEOFS_BLOCK_SIZE;
+    uint64_t num_refs = vol->sb.ref_next_id - 1;  /* ref_next_id starts at 1 */
+    uint64_t capacity = vol->sb.ref_region_blocks * GEOFS_BLOCK_SIZE / GEOFS_REF_RECORD_SIZE;
+    uint64_t i;
+
+    vol->sb.total_refs = 0;
+    for (i = 0; i < capacity; i++) {
+        uint64_t offset = ref_region_start + i * GEOFS_REF_RECORD_SIZE;
+
+        struct geofs_ref_record record;
+        if (pread_full(vol->fd, &record, sizeof(record), offset) != sizeof(record)) {
+            return GEOFS_ERR_IO;
+        }
+
+        /* Validate magic */
+        if (record.magic != GEOFS_REF_RECORD_MAGIC) {
+            if (i >= num_refs) break;   /* End of the written records */
+            continue;  /* Skip invalid/corrupted records */
+        }
+
+        /* Create in-memory index entry */
+        struct ref_index_entry *entry = calloc(1, sizeof(struct ref_index_entry));
+        if (!entry) {
+            return GEOFS_ERR_NOMEM;
+        }
+
+        memcpy(entry->path_hash, record.path_hash, GEOFS_HASH_SIZE);
+        memcpy(entry->content_hash, record.content_hash, GEOFS_HASH_SIZE);
+        entry->view_id = record.view_id;
+        entry->created = record.created;
+        strncpy(entry->path, record.path, GEOFS_MAX_PATH - 1);
+        entry->is_hidden = (record.flags & 1) ? 1 : 0;
+
+        if (ref_index_insert(vol, entry) != GEOFS_OK) {
+            free(entry);
+            return GEOFS_ERR_NOMEM;
+        }
+        if (!entry->is_hidden) vol->sb.total_refs++;
+    }
+
+    if (i > num_refs) vol->sb.ref_next_id = i + 1;
+    return GEOFS_OK;
+}
+
+/* Write a view record to the view region on disk */
+static geofs_error_t geofs_view_write_record(geofs_volume_t *vol,
+                                              const struct view_index_entry *entry) {
+    /* Calculate offset in view region based on view id */
+    uint64_t view_offset = vol->sb.view_region_start * GEOFS_BLOCK_SIZE +
+                           (entry->id - 1) * GEOFS_VIEW_RECORD_SIZE;
+
+    /* Check if we have space in the view region */
+    uint64_t view_region_end = (vol->sb.view_region_start + vol->sb.view_region_blocks) * GEOFS_BLOCK_SIZE;
+    if (view_offset + GEOFS_VIEW_RECORD_SIZE > view_region_end) {
+        return GEOFS_ERR_FULL;
+    }
+
+    /* Build the on-disk record */
+    struct geofs_view_record record = {0};
+    record.magic = GEOFS_VIEW_RECORD_MAGIC;
+    record.flags = 0;
+    record.id = entry->id;
+    record.parent_id = entry->parent_id;
+    record.created = entry->created;
+    strncpy(record.label, entry->label, 63);
+
+    return pwrite_full(vol->fd, &record, sizeof(record), view_offset);
+}
+
+/* Rebuild the view index by scanning the view region on disk, past the
+ * superblock's count like the refs */
+static geofs_error_t geofs_views_rebuild(geofs_volume_t *vol) {
+    uint64_t view_region_start = vol->sb.view_region_start * GEOFS_BLOCK_SIZE;
+    uint64_t num_views = vol->sb.view_next_id - 1;  /* view_next_id starts at 1 */
+    uint64_t capacity = vol->sb.view_region_blocks * GEOFS_BLOCK_SIZE / GEOFS_VIEW_RECORD_SIZE;
+    uint64_t i;
+
+    for (i = 0; i < capacity; i++) {
+        uint64_t offset = view_region_start + i * GEOFS_VIEW_RECORD_SIZE;
+
+        struct geofs_view_record record;
+        if (pread_full(vol->fd, &record, sizeof(record), offset) != sizeof(record)) {
+            return GEOFS_ERR_IO;
+        }
+
+        /* Validate magic */
+        if (record.magic != GEOFS_VIEW_RECORD_MAGIC) {
+            if (i >= num_views) break;
+            continue;  /* Skip invalid/corrupted records */
+        }
+
+        /* Create in-memory index entry */
+        struct view_index_entry *entry = calloc(1, sizeof(struct view_index_entry));
+        if (!entry) {
+            return GEOFS_ERR_NOMEM;
+        }
+
+        entry->id = record.id;
+        entry->parent_id = record.parent_id;
+        entry->created = record.created;
+        strncpy(entry->label, record.label, 63);
+
+        /* Add to index (prepend to list) */
+        entry->next = vol->view_index;
+        vol->view_index = entry;
+    }
+
+    if (i > num_views) {
+        vol->sb.view_next_id = i + 1;
+        vol->sb.total_views = i;
+    }
     return GEOFS_OK;
 }
 
@@ -519,29 +1712,59 @@ static geofs_error_t geofs_views_rebuild(geofs_volume_t *vol) {
 
 static geofs_error_t write_superblock(geofs_volume_t *vol) {
     vol->sb.last_modified = geofs_time_now();
-    if (lseek(vol->fd, 0, SEEK_SET) != 0) return GEOFS_ERR_IO;
-    if (write(vol->fd, &vol->sb, sizeof(vol->sb)) != sizeof(vol->sb)) return GEOFS_ERR_IO;
-    return GEOFS_OK;
+    return pwrite_full(vol->fd, &vol->sb, sizeof(vol->sb), 0);
 }
 
 static geofs_error_t read_superblock(geofs_volume_t *vol) {
-    if (lseek(vol->fd, 0, SEEK_SET) != 0) return GEOFS_ERR_IO;
-    if (read(vol->fd, &vol->sb, sizeof(vol->sb)) != sizeof(vol->sb)) return GEOFS_ERR_IO;
+    if (pread_full(vol->fd, &vol->sb, sizeof(vol->sb), 0) != sizeof(vol->sb)) return GEOFS_ERR_IO;
     if (vol->sb.magic != GEOFS_MAGIC) return GEOFS_ERR_CORRUPT;
     return GEOFS_OK;
 }
 
+/* Allocate a volume handle with empty indices and staging, fd not open */
+static geofs_volume_t *volume_alloc(const char *path) {
+    geofs_volume_t *vol = calloc(1, sizeof(geofs_volume_t));
+    if (!vol) return NULL;
+
+    strncpy(vol->path, path, GEOFS_MAX_PATH - 1);
+    vol->fd = -1;
+    vol->codec = GEOFS_CODEC_LZ4;
+    pthread_rwlock_init(&vol->lock, NULL);
+    pthread_mutex_init(&vol->async_lock, NULL);
+
+    if (index_init(vol) != GEOFS_OK) {
+        pthread_rwlock_destroy(&vol->lock);
+        free(vol);
+        return NULL;
+    }
+    if (staging_init(vol) != GEOFS_OK) {
+        index_free(vol);
+        staging_free(vol);
+        pthread_rwlock_destroy(&vol->lock);
+        free(vol);
+        return NULL;
+    }
+    return vol;
+}
+
+static void volume_free(geofs_volume_t *vol) {
+    async_free(vol);
+    pthread_mutex_destroy(&vol->async_lock);
+    if (vol->fd >= 0) close(vol->fd);
+    index_free(vol);
+    staging_free(vol);
+    pthread_rwlock_destroy(&vol->lock);
+    free(vol);
+}
+
 geofs_error_t geofs_volume_create(const char *path, uint64_t size_mb,
                                    geofs_volume_t **vol_out) {
-    geofs_volume_t *vol = calloc(1, sizeof(geofs_volume_t));
+    geofs_volume_t *vol = volume_alloc(path);
     if (!vol) return GEOFS_ERR_NOMEM;
     
-    strncpy(vol->path, path, GEOFS_MAX_PATH - 1);
-    pthread_mutex_init(&vol->lock, NULL);
-    
     vol->fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
     if (vol->fd < 0) {
-        free(vol);
+        volume_free(vol);
         return GEOFS_ERR_IO;
     }
     
@@ -571,9 +1794,8 @@ geofs_error_t geofs_volume_create(const char *path, uint64_t size_mb,
     vol->sb.current_view = 1;
     
     if (ftruncate(vol->fd, total_blocks * GEOFS_BLOCK_SIZE) != 0) {
-        close(vol->fd);
+        volume_free(vol);
         unlink(path);
-        free(vol);
         return GEOFS_ERR_IO;
     }
     
@@ -600,23 +1822,51 @@ geofs_error_t geofs_volume_create(const char *path, uint64_t size_mb,
     return GEOFS_OK;
 }
 
+geofs_error_t geofs_volume_map(geofs_volume_t *vol) {
+    pthread_rwlock_wrlock(&vol->lock);
+    if (vol->mapping) {
+        pthread_rwlock_unlock(&vol->lock);
+        return GEOFS_OK;
+    }
+
+    struct geofs_mapping *m = calloc(1, sizeof(struct geofs_mapping));
+    if (!m) {
+        pthread_rwlock_unlock(&vol->lock);
+        return GEOFS_ERR_NOMEM;
+    }
+
+    /* Map from the start of the file so block offsets index it directly.
+     * The file never grows, and pwrite goes through the same page cache,
+     * so content stored after this is visible without remapping. */
+    m->length = (vol->sb.content_region_start + vol->sb.content_region_blocks) *
+                GEOFS_BLOCK_SIZE;
+    m->base = mmap(NULL, m->length, PROT_READ, MAP_SHARED, vol->fd, 0);
+    if (m->base == MAP_FAILED) {
+        free(m);
+        pthread_rwlock_unlock(&vol->lock);
+        return GEOFS_ERR_IO;
+    }
+    m->is_mmap = 1;
+    m->refs = 1;
+    vol->mapping = m;
+
+    pthread_rwlock_unlock(&vol->lock);
+    return GEOFS_OK;
+}
+
 geofs_error_t geofs_volume_open(const char *path, geofs_volume_t **vol_out) {
-    geofs_volume_t *vol = calloc(1, sizeof(geofs_volume_t));
+    geofs_volume_t *vol = volume_alloc(path);
     if (!vol) return GEOFS_ERR_NOMEM;
 
-    strncpy(vol->path, path, GEOFS_MAX_PATH - 1);
-    pthread_mutex_init(&vol->lock, NULL);
-
     vol->fd = open(path, O_RDWR);
     if (vol->fd < 0) {
-        free(vol);
+        volume_free(vol);
         return GEOFS_ERR_IO;
     }
 
     geofs_error_t err = read_superblock(vol);
     if (err != GEOFS_OK) {
-        close(vol->fd);
-        free(vol);
+        volume_free(vol);
         return err;
     }
 
@@ -625,236 +1875,1314 @@ geofs_error_t geofs_volume_open(const char *path, geofs_volume_t **vol_out) {
     /* Rebuild content index from disk */
     err = geofs_content_rebuild(vol);
     if (err != GEOFS_OK) {
-        close(vol->fd);
-        free(vol);
+        volume_free(vol);
         return err;
     }
 
     /* Rebuild ref index from disk */
     err = geofs_refs_rebuild(vol);
     if (err != GEOFS_OK) {
-        close(vol->fd);
-        free(vol);
+        volume_free(vol);
+        return err;
+    }
+
+    /* Rebuild view index from disk (geological strata) */
+    err = geofs_views_rebuild(vol);
+    if (err != GEOFS_OK) {
+        volume_free(vol);
+        return err;
+    }
+
+    /* Create default view if index is empty (shouldn't happen with proper persistence) */
+    if (!vol->view_index) {
+        struct view_index_entry *root = calloc(1, sizeof(struct view_index_entry));
+        root->id = vol->current_view;
+        root->parent_id = 0;
+        root->created = vol->sb.created;
+        strcpy(root->label, "Genesis");
+        vol->view_index = root;
+    }
+
+    *vol_out = vol;
+    return GEOFS_OK;
+}
+
+geofs_error_t geofs_volume_set_sync(geofs_volume_t *vol, geofs_sync_policy_t policy,
+                                     unsigned interval_ms) {
+    if (policy != GEOFS_SYNC_ON_CLOSE && policy != GEOFS_SYNC_PER_OP &&
+        policy != GEOFS_SYNC_GROUP) {
+        return GEOFS_ERR_INVALID;
+    }
+    if (policy == GEOFS_SYNC_GROUP && interval_ms == 0) return GEOFS_ERR_INVALID;
+
+    flusher_stop(vol);
+    vol->sync_interval_ms = interval_ms;
+    __atomic_store_n(&vol->sync_policy, policy, __ATOMIC_RELAXED);
+
+    if (policy == GEOFS_SYNC_GROUP) {
+        if (pthread_create(&vol->flusher, NULL, flusher_main, vol) != 0) {
+            __atomic_store_n(&vol->sync_policy, GEOFS_SYNC_ON_CLOSE, __ATOMIC_RELAXED);
+            return GEOFS_ERR_NOMEM;
+        }
+        vol->flusher_running = 1;
+    }
+
+    /* Writes staged under the old policy are covered by the new one too */
+    if (policy == GEOFS_SYNC_PER_OP) return geofs_volume_sync(vol);
+    return GEOFS_OK;
+}
+
+geofs_error_t geofs_volume_sync(geofs_volume_t *vol) {
+    return volume_commit(vol, UINT64_MAX);
+}
+
+geofs_error_t geofs_volume_set_codec(geofs_volume_t *vol, geofs_codec_t codec) {
+    if (!geofs_codec_available(codec)) return GEOFS_ERR_INVALID;
+    pthread_rwlock_wrlock(&vol->lock);
+    vol->codec = codec;
+    pthread_rwlock_unlock(&vol->lock);
+    return GEOFS_OK;
+}
+
+void geofs_volume_close(geofs_volume_t *vol) {
+    if (!vol) return;
+    
+    flusher_stop(vol);
+    
+    /* Completions take the index lock, so finish them before we do */
+    geofs_async_drain(vol);
+    
+    pthread_rwlock_wrlock(&vol->lock);
+    segment_flush(vol);
+    if (vol->dirty) {
+        /* Data first, then the superblock that vouches for it */
+        fdatasync(vol->fd);
+        write_superblock(vol);
+        fsync(vol->fd);
+    }
+    
+    /* Views still out keep the mapping alive */
+    if (vol->mapping) mapping_release(vol->mapping);
+    
+    pthread_rwlock_unlock(&vol->lock);
+    volume_free(vol);
+}
+
+/* ══════════════════════════════════════════════════════════════════════════════
+ * CONTENT OPERATIONS
+ * ══════════════════════════════════════════════════════════════════════════════ */
+
+/*
+ * Index stored content, unless a concurrent store of the same data won.
+ * A superseding copy replaces the entry it was rewritten from.
+ */
+static geofs_error_t content_index_add(geofs_volume_t *vol, const geofs_hash_t hash,
+                                       uint64_t offset, const struct content_blob *blob,
+                                       int packed) {
+    struct content_index_entry *entry = calloc(1, sizeof(struct content_index_entry));
+    if (!entry) {
+        return GEOFS_ERR_NOMEM;
+    }
+    uint64_t size = blob->size;
+    memcpy(entry->hash, hash, GEOFS_HASH_SIZE);
+    entry->offset = offset;
+    entry->size = size;
+    entry->stored = blob->stored;
+    entry->length = blob->length;
+    entry->flags = blob->flags;
+    entry->packed = packed;
+    
+    pthread_rwlock_wrlock(&vol->lock);
+    struct content_index_entry *old = find_content(vol, hash);
+    if (old) {
+        if (blob->flags & GEOFS_OBJ_SUPERSEDES) content_index_supersede(vol, old, entry);
+        free(entry);
+    } else {
+        content_index_insert(vol, entry);
+        vol->sb.total_content_bytes += size;
+    }
+    vol->dirty = 1;
+    pthread_rwlock_unlock(&vol->lock);
+    return GEOFS_OK;
+}
+
+/* Stage an encoded object and index it */
+static geofs_error_t content_store_blob(geofs_volume_t *vol, const geofs_hash_t hash,
+                                        const struct content_blob *blob, uint64_t *ops_out) {
+    /* Stage header and data; other stores stage alongside us */
+    uint64_t offset;
+    geofs_error_t err = content_stage(vol, hash, blob, &offset, ops_out);
+    if (err != GEOFS_OK) {
+        return err;
+    }
+    return content_index_add(vol, hash, offset, blob, blob->stored < GEOFS_PACK_MAX_OBJECT);
+}
+
+/*
+ * Stage content whose hash the caller has computed and index it. ops_out
+ * gets the op number to commit up to, or 0 if the content was there already.
+ */
+static geofs_error_t content_store_hashed(geofs_volume_t *vol, const geofs_hash_t hash,
+                                          const void *data, size_t size,
+                                          uint64_t *ops_out) {
+    *ops_out = 0;
+    
+    /* Deduplication check */
+    pthread_rwlock_rdlock(&vol->lock);
+    struct content_index_entry *old = find_content(vol, hash);
+    geofs_codec_t codec = vol->codec;
+    pthread_rwlock_unlock(&vol->lock);
+    if (old) {
+        return GEOFS_OK;
+    }
+    
+    struct content_blob blob;
+    content_encode(codec, data, size, &blob);
+    geofs_error_t err = content_store_blob(vol, hash, &blob, ops_out);
+    content_blob_free(&blob);
+    return err;
+}
+
+geofs_error_t geofs_content_store(geofs_volume_t *vol, const void *data,
+                                   size_t size, geofs_hash_t hash_out) {
+    geofs_hash_t hash;
+    sha256(data, size, hash);
+    
+    uint64_t ops;
+    geofs_error_t err = content_store_hashed(vol, hash, data, size, &ops);
+    if (err != GEOFS_OK) {
+        return err;
+    }
+    
+    memcpy(hash_out, hash, GEOFS_HASH_SIZE);
+    return commit_policy(vol, ops);
+}
+
+/*
+ * Hash a manifest's bytes. Plain content hashes its bytes as they are, so
+ * the tag keeps the two apart: storing a manifest's bytes as content can't
+ * take the manifest's hash, short of a SHA-256 preimage.
+ */
+static void manifest_hash(const void *payload, size_t len, geofs_hash_t hash) {
+    static const uint8_t tag[4] = { 'G', 'M', 'A', 'N' };
+    sha256(payload, len, hash);
+    for (size_t i = 0; i < GEOFS_HASH_SIZE; i++) {
+        hash[i] ^= tag[i % sizeof(tag)];
+    }
+}
+
+geofs_error_t geofs_manifest_store(geofs_volume_t *vol, const geofs_hash_t *chunks,
+                                    size_t count, geofs_hash_t hash_out) {
+    size_t len = sizeof(struct geofs_manifest_header) +
+                 count * sizeof(struct geofs_manifest_entry);
+    uint8_t *payload = malloc(len);
+    if (!payload) return GEOFS_ERR_NOMEM;
+    
+    struct geofs_manifest_header h = { .magic = GEOFS_MANIFEST_MAGIC, .chunks = count };
+    geofs_error_t err = GEOFS_OK;
+    pthread_rwlock_rdlock(&vol->lock);
+    for (size_t i = 0; i < count && err == GEOFS_OK; i++) {
+        struct content_index_entry *entry = find_content(vol, chunks[i]);
+        if (!entry) {
+            err = GEOFS_ERR_NOTFOUND;
+        } else if (entry->flags & GEOFS_OBJ_MANIFEST) {
+            err = GEOFS_ERR_INVALID;
+        } else {
+            struct geofs_manifest_entry e = { .size = entry->size };
+            memcpy(e.hash, chunks[i], GEOFS_HASH_SIZE);
+            memcpy(payload + sizeof(h) + i * sizeof(e), &e, sizeof(e));
+            h.size += entry->size;
+        }
+    }
+    pthread_rwlock_unlock(&vol->lock);
+    if (err != GEOFS_OK) {
+        free(payload);
+        return err;
+    }
+    memcpy(payload, &h, sizeof(h));
+    
+    geofs_hash_t hash;
+    manifest_hash(payload, len, hash);
+    
+    /* Like content_store_hashed, but flagged and indexed with the length
+     * of the content it stands for */
+    uint64_t ops = 0;
+    pthread_rwlock_rdlock(&vol->lock);
+    struct content_index_entry *old = find_content(vol, hash);
+    geofs_codec_t codec = vol->codec;
+    pthread_rwlock_unlock(&vol->lock);
+    if (!old) {
+        struct content_blob blob;
+        content_encode(codec, payload, len, &blob);
+        blob.flags |= GEOFS_OBJ_MANIFEST;
+        blob.length = h.size;
+        err = content_store_blob(vol, hash, &blob, &ops);
+        content_blob_free(&blob);
+    }
+    free(payload);
+    if (err != GEOFS_OK) {
+        return err;
+    }
+    
+    memcpy(hash_out, hash, GEOFS_HASH_SIZE);
+    return commit_policy(vol, ops);
+}
+
+/*
+ * Decode the manifest stored at offset into its chunks, giving each its
+ * offset in the content, and check that they add up. Called without the
+ * lock; *chunks_out is malloc'd.
+ */
+static geofs_error_t manifest_load(geofs_volume_t *vol, uint64_t offset, uint64_t stored,
+                                   uint16_t flags, uint64_t size,
+                                   struct geofs_chunk **chunks_out, size_t *count_out,
+                                   uint64_t *total_out) {
+    struct geofs_manifest_header h;
+    if (size < sizeof(h) ||
+        (size - sizeof(h)) % sizeof(struct geofs_manifest_entry) != 0) {
+        return GEOFS_ERR_CORRUPT;
+    }
+    uint8_t *buf = malloc(size);
+    if (!buf) return GEOFS_ERR_NOMEM;
+    geofs_error_t err = content_ensure_written(vol, offset);
+    if (err == GEOFS_OK) {
+        err = content_load(vol, offset, stored, flags, buf, size);
+    }
+    if (err != GEOFS_OK) {
+        free(buf);
+        return err;
+    }
+    
+    memcpy(&h, buf, sizeof(h));
+    uint64_t count = (size - sizeof(h)) / sizeof(struct geofs_manifest_entry);
+    struct geofs_chunk *chunks = malloc((count ? count : 1) * sizeof(*chunks));
+    if (h.magic != GEOFS_MANIFEST_MAGIC || h.chunks != count || !chunks) {
+        free(chunks);
+        free(buf);
+        return chunks ? GEOFS_ERR_CORRUPT : GEOFS_ERR_NOMEM;
+    }
+    uint64_t pos = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        struct geofs_manifest_entry e;
+        memcpy(&e, buf + sizeof(h) + i * sizeof(e), sizeof(e));
+        memcpy(chunks[i].hash, e.hash, GEOFS_HASH_SIZE);
+        chunks[i].offset = pos;
+        chunks[i].size = e.size;
+        pos += e.size;
+    }
+    free(buf);
+    if (pos != h.size) {
+        free(chunks);
+        return GEOFS_ERR_CORRUPT;
+    }
+    
+    *chunks_out = chunks;
+    *count_out = count;
+    if (total_out) *total_out = pos;
+    return GEOFS_OK;
+}
+
+/* Read chunks back to back into buf; a short buffer takes a prefix */
+static geofs_error_t chunks_read(geofs_volume_t *vol, const struct geofs_chunk *chunks,
+                                 size_t count, uint8_t *buf, size_t buf_size,
+                                 size_t *size_out) {
+    size_t done = 0;
+    for (size_t i = 0; i < count && done < buf_size; i++) {
+        size_t want = buf_size - done;
+        if (want > chunks[i].size) want = chunks[i].size;
+        size_t got = 0;
+        geofs_error_t err = geofs_content_read(vol, chunks[i].hash, buf + done, want, &got);
+        if (err != GEOFS_OK) return err == GEOFS_ERR_NOTFOUND ? GEOFS_ERR_CORRUPT : err;
+        if (got != want) return GEOFS_ERR_CORRUPT;
+        done += got;
+    }
+    *size_out = done;
+    return GEOFS_OK;
+}
+
+geofs_error_t geofs_content_chunks(geofs_volume_t *vol, const geofs_hash_t hash,
+                                    struct geofs_chunk **chunks_out, size_t *count_out) {
+    pthread_rwlock_rdlock(&vol->lock);
+    struct content_index_entry *entry = find_content(vol, hash);
+    if (!entry) {
+        pthread_rwlock_unlock(&vol->lock);
+        return GEOFS_ERR_NOTFOUND;
+    }
+    uint64_t offset = entry->offset;
+    uint64_t stored = entry->stored;
+    uint16_t flags = entry->flags;
+    uint64_t size = entry->size;
+    pthread_rwlock_unlock(&vol->lock);
+    
+    if (flags & GEOFS_OBJ_MANIFEST) {
+        return manifest_load(vol, offset, stored, flags, size, chunks_out, count_out, NULL);
+    }
+    struct geofs_chunk *chunk = malloc(sizeof(*chunk));
+    if (!chunk) return GEOFS_ERR_NOMEM;
+    memcpy(chunk->hash, hash, GEOFS_HASH_SIZE);
+    chunk->offset = 0;
+    chunk->size = size;
+    *chunks_out = chunk;
+    *count_out = 1;
+    return GEOFS_OK;
+}
+
+geofs_error_t geofs_content_read(geofs_volume_t *vol, const geofs_hash_t hash,
+                                  void *buf, size_t buf_size, size_t *size_out) {
+    pthread_rwlock_rdlock(&vol->lock);
+    
+    struct content_index_entry *entry = find_content(vol, hash);
+    if (!entry) {
+        pthread_rwlock_unlock(&vol->lock);
+        return GEOFS_ERR_NOTFOUND;
+    }
+    
+    uint64_t offset = entry->offset;
+    uint64_t stored = entry->stored;
+    uint16_t flags = entry->flags;
+    uint64_t size = entry->size;
+    size_t to_read = size;
+    if (to_read > buf_size) to_read = buf_size;
+    
+    /* Content never changes once indexed; read without the lock */
+    pthread_rwlock_unlock(&vol->lock);
+    
+    if (flags & GEOFS_OBJ_MANIFEST) {
+        struct geofs_chunk *chunks;
+        size_t count, got = 0;
+        geofs_error_t err = manifest_load(vol, offset, stored, flags, size,
+                                          &chunks, &count, NULL);
+        if (err != GEOFS_OK) return err;
+        err = chunks_read(vol, chunks, count, buf, buf_size, &got);
+        free(chunks);
+        if (err == GEOFS_OK && size_out) *size_out = got;
+        return err;
+    }
+    if (content_ensure_written(vol, offset) != GEOFS_OK) {
+        return GEOFS_ERR_IO;
+    }
+    if (!(flags & GEOFS_OBJ_CODEC_MASK)) {
+        ssize_t got = pread_full(vol->fd, buf, to_read, offset);
+        if (got < 0) {
+            return GEOFS_ERR_IO;
+        }
+        if (size_out) *size_out = (size_t)got;
+        return GEOFS_OK;
+    }
+    
+    /* Compressed objects decode whole; a short buffer takes a prefix */
+    uint8_t *out = buf;
+    if (to_read < size) {
+        out = malloc(size);
+        if (!out) return GEOFS_ERR_NOMEM;
+    }
+    geofs_error_t err = content_load(vol, offset, stored, flags, out, size);
+    if (out != buf) {
+        if (err == GEOFS_OK) memcpy(buf, out, to_read);
+        free(out);
+    }
+    if (err != GEOFS_OK) {
         return err;
     }
+    
+    if (size_out) *size_out = to_read;
+    return GEOFS_OK;
+}
+
+geofs_error_t geofs_content_map(geofs_volume_t *vol, const geofs_hash_t hash,
+                                 struct geofs_content_view *view) {
+    memset(view, 0, sizeof(*view));
+
+    pthread_rwlock_rdlock(&vol->lock);
+    
+    struct content_index_entry *entry = find_content(vol, hash);
+    if (!entry) {
+        pthread_rwlock_unlock(&vol->lock);
+        return GEOFS_ERR_NOTFOUND;
+    }
+    
+    uint64_t offset = entry->offset;
+    uint64_t size = entry->size;
+    uint64_t stored = entry->stored;
+    uint16_t flags = entry->flags;
+    
+    /* Only raw objects can be viewed in place */
+    struct geofs_mapping *mapping = vol->mapping;
+    if (flags & (GEOFS_OBJ_CODEC_MASK | GEOFS_OBJ_MANIFEST)) mapping = NULL;
+    if (mapping) {
+        __atomic_add_fetch(&mapping->refs, 1, __ATOMIC_RELAXED);
+    }
+    pthread_rwlock_unlock(&vol->lock);
+    
+    if (content_ensure_written(vol, offset) != GEOFS_OK) {
+        if (mapping) mapping_release(mapping);
+        return GEOFS_ERR_IO;
+    }
+    
+    if (mapping) {
+        view->mapping = mapping;
+        view->data = mapping->base + offset;
+        view->size = size;
+        return GEOFS_OK;
+    }
+    
+    /* Unmapped volume, compressed object or manifest: the view gets its own
+     * copy. Readers of large chunked content should map a chunk at a time */
+    struct geofs_chunk *chunks = NULL;
+    size_t count = 0;
+    uint64_t length = size;
+    if (flags & GEOFS_OBJ_MANIFEST) {
+        geofs_error_t err = manifest_load(vol, offset, stored, flags, size,
+                                          &chunks, &count, &length);
+        if (err != GEOFS_OK) return err;
+    }
+    struct geofs_mapping *m = malloc(sizeof(struct geofs_mapping) + length);
+    if (!m) {
+        free(chunks);
+        return GEOFS_ERR_NOMEM;
+    }
+    m->base = (uint8_t *)(m + 1);
+    m->length = length;
+    m->is_mmap = 0;
+    m->refs = 1;
+    
+    geofs_error_t err;
+    if (chunks) {
+        size_t got;
+        err = chunks_read(vol, chunks, count, m->base, length, &got);
+        free(chunks);
+    } else {
+        err = content_load(vol, offset, stored, flags, m->base, size);
+    }
+    if (err != GEOFS_OK) {
+        free(m);
+        return err;
+    }
+    size = length;
+    
+    view->mapping = m;
+    view->data = m->base;
+    view->size = size;
+    return GEOFS_OK;
+}
+
+void geofs_content_unmap(struct geofs_content_view *view) {
+    if (!view || !view->mapping) return;
+    mapping_release(view->mapping);
+    memset(view, 0, sizeof(*view));
+}
+
+geofs_error_t geofs_content_size(geofs_volume_t *vol, const geofs_hash_t hash,
+                                  uint64_t *size_out) {
+    pthread_rwlock_rdlock(&vol->lock);
+    struct content_index_entry *entry = find_content(vol, hash);
+    if (!entry) {
+        pthread_rwlock_unlock(&vol->lock);
+        return GEOFS_ERR_NOTFOUND;
+    }
+    *size_out = entry->length;
+    pthread_rwlock_unlock(&vol->lock);
+    return GEOFS_OK;
+}
+
+/* One object a recompress pass will look at */
+struct recompress_item {
+    geofs_hash_t    hash;
+    uint64_t        offset;
+    uint64_t        stored;
+    uint64_t        size;
+    uint16_t        flags;
+};
+
+geofs_error_t geofs_volume_recompress(geofs_volume_t *vol, geofs_codec_t codec,
+                                       struct geofs_recompress_result *result) {
+    struct geofs_recompress_result r = {0};
+    if (result) *result = r;
+    if (codec == GEOFS_CODEC_NONE || !geofs_codec_available(codec)) {
+        return GEOFS_ERR_INVALID;
+    }
+
+    /* Snapshot what is on disk now; later stores use the volume's codec */
+    pthread_rwlock_rdlock(&vol->lock);
+    uint64_t end = __atomic_load_n(&vol->sb.content_next_block, __ATOMIC_ACQUIRE) *
+                   GEOFS_BLOCK_SIZE;
+    struct recompress_item *items = malloc((vol->content_count + 1) * sizeof(*items));
+    if (!items) {
+        pthread_rwlock_unlock(&vol->lock);
+        return GEOFS_ERR_NOMEM;
+    }
+    uint64_t count = 0;
+    for (uint64_t b = 0; b < vol->content_nbuckets; b++) {
+        for (struct content_index_entry *e = vol->content_buckets[b]; e; e = e->next) {
+            if (e->offset >= end || (e->flags & GEOFS_OBJ_CODEC_MASK) == codec) continue;
+            struct recompress_item *it = &items[count++];
+            memcpy(it->hash, e->hash, GEOFS_HASH_SIZE);
+            it->offset = e->offset;
+            it->stored = e->stored;
+            it->size = e->size;
+            it->flags = e->flags;
+        }
+    }
+    pthread_rwlock_unlock(&vol->lock);
+
+    geofs_error_t err = GEOFS_OK;
+    uint64_t last_ops = 0;
+    uint8_t *buf = NULL;
+    uint64_t buf_size = 0;
+    for (uint64_t i = 0; i < count && err == GEOFS_OK; i++) {
+        struct recompress_item *it = &items[i];
+        r.examined++;
+        if (it->size < GEOFS_COMPRESS_MIN) continue;
+
+        if (it->size > buf_size) {
+            uint8_t *grown = realloc(buf, it->size);
+            if (!grown) {
+                err = GEOFS_ERR_NOMEM;
+                break;
+            }
+            buf = grown;
+            buf_size = it->size;
+        }
+        err = content_ensure_written(vol, it->offset);
+        if (err == GEOFS_OK) {
+            err = content_load(vol, it->offset, it->stored, it->flags, buf, it->size);
+        }
+        if (err != GEOFS_OK) break;
+
+        struct content_blob blob;
+        content_encode(codec, buf, it->size, &blob);
+        if (!(blob.flags & GEOFS_OBJ_CODEC_MASK) ||
+            blob.stored > it->stored - it->stored / 10) {
+            content_blob_free(&blob);
+            continue;
+        }
+        blob.flags |= GEOFS_OBJ_SUPERSEDES | (it->flags & GEOFS_OBJ_MANIFEST);
+        uint64_t ops;
+        err = content_store_blob(vol, it->hash, &blob, &ops);
+        if (err == GEOFS_OK) {
+            r.rewritten++;
+            r.bytes_before += it->stored;
+            r.bytes_after += blob.stored;
+            last_ops = ops;
+        }
+        content_blob_free(&blob);
+    }
+    free(buf);
+    free(items);
+
+    if (err == GEOFS_OK && last_ops) err = commit_policy(vol, last_ops);
+    if (result) *result = r;
+    return err;
+}
+
+/* ══════════════════════════════════════════════════════════════════════════════
+ * ASYNCHRONOUS I/O
+ *
+ * Each volume gets one io_uring on its first async call, driven through the
+ * raw syscalls. Small stores are staged as usual and complete at once; large
+ * ones reserve a segment of their own and the kernel writes it from the
+ * caller's buffer. async_lock guards the ring and the done list. It is
+ * taken before seg_lock and the index lock, and under sync_lock by
+ * volume_commit, so nothing holding it may commit.
+ * ══════════════════════════════════════════════════════════════════════════════ */
+
+enum { ASYNC_STORE, ASYNC_READ, ASYNC_SYNC };
+
+struct geofs_async_op {
+    int             type;
+    geofs_error_t   err;
+    geofs_hash_t    hash;
+    size_t          size;           /* Store: content. Read: bytes read */
+    uint64_t        offset;         /* Store: header. Read: data */
+    size_t          length;         /* Bytes the kernel is to transfer */
+    struct iovec    iov[4];
+    uint8_t        *blocks;         /* Store: header and trailer */
+    struct content_blob blob;       /* Store: the object as encoded */
+    uint64_t        ops;            /* Staged op number to commit up to */
+    uint64_t        fixups;         /* Sync: async->fixups when queued */
+    struct geofs_superblock sb;     /* Sync: written once the data is synced */
+    geofs_async_callback callback;
+    void           *ctx;
+    struct geofs_async_op *next;        /* Done list */
+    struct geofs_async_op *write_next;  /* Stores in flight */
+};
+
+#ifdef GEOFS_HAVE_IO_URING
+struct geofs_uring {
+    int             fd;
+    unsigned        entries;
+    unsigned       *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned       *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void           *sq_ring, *cq_ring;
+    size_t          sq_ring_len, cq_ring_len, sqes_len;
+};
+#endif
+
+struct geofs_async {
+    int             use_uring;
+#ifdef GEOFS_HAVE_IO_URING
+    struct geofs_uring ring;
+#endif
+    unsigned        queued;         /* In the SQ, not submitted yet */
+    unsigned        inflight;       /* Queued or submitted, not reaped */
+    unsigned        pending;        /* Callback not run yet */
+    struct geofs_async_op *done, *done_tail;
+    unsigned        ndone;
+    uint64_t        fixups;         /* Writes redone with blocking calls */
+
+    /* Under seg_lock: stores the kernel is writing, and the first failed one */
+    struct geofs_async_op *writes;
+    uint64_t        failed_block;
+};
+
+#ifdef GEOFS_HAVE_IO_URING
+static int uring_setup(struct geofs_uring *r, unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (fd < 0) return -1;
+
+    memset(r, 0, sizeof(*r));
+    r->fd = fd;
+    r->entries = p.sq_entries;
+    r->sq_ring_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_ring_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    int single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single) {
+        if (r->cq_ring_len > r->sq_ring_len) r->sq_ring_len = r->cq_ring_len;
+        r->cq_ring_len = r->sq_ring_len;
+    }
+
+    r->sq_ring = mmap(NULL, r->sq_ring_len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (r->sq_ring == MAP_FAILED) goto fail;
+    r->cq_ring = single ? r->sq_ring :
+                 mmap(NULL, r->cq_ring_len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if (r->cq_ring == MAP_FAILED) {
+        munmap(r->sq_ring, r->sq_ring_len);
+        goto fail;
+    }
+    r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) {
+        if (!single) munmap(r->cq_ring, r->cq_ring_len);
+        munmap(r->sq_ring, r->sq_ring_len);
+        goto fail;
+    }
+
+    uint8_t *sq = r->sq_ring, *cq = r->cq_ring;
+    r->sq_head = (unsigned *)(sq + p.sq_off.head);
+    r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    r->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)(sq + p.sq_off.array);
+    r->cq_head = (unsigned *)(cq + p.cq_off.head);
+    r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    r->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    return 0;
+
+fail:
+    close(fd);
+    return -1;
+}
+
+static void uring_teardown(struct geofs_uring *r) {
+    munmap(r->sqes, r->sqes_len);
+    if (r->cq_ring != r->sq_ring) munmap(r->cq_ring, r->cq_ring_len);
+    munmap(r->sq_ring, r->sq_ring_len);
+    close(r->fd);
+}
+#endif
+
+/* The volume's async state, created on first use. async_lock held */
+static struct geofs_async *async_get(geofs_volume_t *vol) {
+    if (vol->async) return vol->async;
+
+    struct geofs_async *a = calloc(1, sizeof(struct geofs_async));
+    if (!a) return NULL;
+    a->failed_block = UINT64_MAX;
+#ifdef GEOFS_HAVE_IO_URING
+    if (!getenv("GEOFS_NO_IO_URING") && uring_setup(&a->ring, GEOFS_ASYNC_DEPTH) == 0) {
+        a->use_uring = 1;
+    }
+#endif
+    __atomic_store_n(&vol->async, a, __ATOMIC_RELEASE);
+    return a;
+}
+
+static void async_free(geofs_volume_t *vol) {
+    struct geofs_async *a = vol->async;
+    if (!a) return;
+#ifdef GEOFS_HAVE_IO_URING
+    if (a->use_uring) uring_teardown(&a->ring);
+#endif
+    while (a->done) {
+        struct geofs_async_op *next = a->done->next;
+        free(a->done->blocks);
+        content_blob_free(&a->done->blob);
+        free(a->done);
+        a->done = next;
+    }
+    free(a);
+    vol->async = NULL;
+}
+
+static void async_done(struct geofs_async *a, struct geofs_async_op *op) {
+    op->next = NULL;
+    if (a->done_tail) {
+        a->done_tail->next = op;
+    } else {
+        a->done = op;
+    }
+    a->done_tail = op;
+    a->ndone++;
+}
+
+/*
+ * Pull a commit snapshot back to before the first async write that may
+ * not be in the file yet, so neither the superblock nor synced_ops
+ * vouches for it. seg_lock held.
+ */
+static void async_clip_snapshot(geofs_volume_t *vol, uint64_t *block, uint64_t *ops) {
+    struct geofs_async *a = __atomic_load_n(&vol->async, __ATOMIC_ACQUIRE);
+    if (!a) return;
+    for (struct geofs_async_op *op = a->writes; op; op = op->write_next) {
+        if (op->offset / GEOFS_BLOCK_SIZE < *block) *block = op->offset / GEOFS_BLOCK_SIZE;
+        if (op->ops <= *ops) *ops = op->ops - 1;
+    }
+    if (a->failed_block < *block) *block = a->failed_block;
+}
+
+static void async_store_complete(geofs_volume_t *vol, struct geofs_async *a,
+                                 struct geofs_async_op *op, int res) {
+    if (res < 0 || (size_t)res != op->length) {
+        /* Failed or short: write the whole segment again the slow way */
+        a->fixups++;
+        op->err = pwritev_full(vol->fd, op->iov, 4, op->offset);
+    }
+
+    pthread_mutex_lock(&vol->seg_lock);
+    struct geofs_async_op **pp = &a->writes;
+    while (*pp != op) pp = &(*pp)->write_next;
+    *pp = op->write_next;
+    if (op->err != GEOFS_OK && op->offset / GEOFS_BLOCK_SIZE < a->failed_block) {
+        a->failed_block = op->offset / GEOFS_BLOCK_SIZE;
+    }
+    pthread_mutex_unlock(&vol->seg_lock);
+
+    free(op->blocks);
+    op->blocks = NULL;
+    if (op->err == GEOFS_OK) {
+        op->err = content_index_add(vol, op->hash, op->offset + GEOFS_BLOCK_SIZE,
+                                    &op->blob, 0);
+    }
+    content_blob_free(&op->blob);
+}
+
+static void async_read_complete(geofs_volume_t *vol, struct geofs_async_op *op, int res) {
+    if (res >= 0 && (size_t)res == op->length) {
+        op->size = (size_t)res;
+        return;
+    }
+    ssize_t got = pread_full(vol->fd, op->iov[0].iov_base, op->length, op->offset);
+    if (got < 0) {
+        op->err = GEOFS_ERR_IO;
+    } else {
+        op->size = (size_t)got;
+    }
+}
+
+static void async_sync_complete(geofs_volume_t *vol, struct geofs_async *a,
+                                struct geofs_async_op *op, int res) {
+    /* Writes redone since this was queued went around the ring */
+    if (res < 0 || (a->fixups != op->fixups && fdatasync(vol->fd) != 0)) {
+        op->err = GEOFS_ERR_IO;
+        return;
+    }
+
+    pthread_mutex_lock(&vol->seg_lock);
+    if (a->failed_block < op->sb.content_next_block) {
+        op->sb.content_next_block = a->failed_block;
+    }
+    pthread_mutex_unlock(&vol->seg_lock);
+
+    op->sb.last_modified = geofs_time_now();
+    op->err = pwrite_full(vol->fd, &op->sb, sizeof(op->sb), 0);
+    if (op->err == GEOFS_OK) synced_advance(vol, op->ops);
+}
+
+/*
+ * Submit queued entries, wait until wait_nr completions are ready, and
+ * finish every completion there is. async_lock held. 0, or -1 if the
+ * ring itself failed.
+ */
+static int async_reap(geofs_volume_t *vol, struct geofs_async *a, unsigned wait_nr) {
+#ifdef GEOFS_HAVE_IO_URING
+    if (!a->use_uring) return 0;
+    struct geofs_uring *r = &a->ring;
+
+    while (a->queued > 0 || wait_nr > 0) {
+        unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+        long ret = syscall(__NR_io_uring_enter, r->fd, a->queued, wait_nr, flags, NULL, 0);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            /* Completion queue busy: make room below, submit next time */
+            if (errno == EAGAIN || errno == EBUSY) break;
+            return -1;
+        }
+        a->queued -= (unsigned)ret;
+        break;
+    }
+
+    unsigned head = *r->cq_head;
+    while (head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+        struct geofs_async_op *op = (struct geofs_async_op *)(uintptr_t)cqe->user_data;
+        int res = cqe->res;
+        __atomic_store_n(r->cq_head, ++head, __ATOMIC_RELEASE);
+        a->inflight--;
+
+        switch (op->type) {
+        case ASYNC_STORE: async_store_complete(vol, a, op, res); break;
+        case ASYNC_READ:  async_read_complete(vol, op, res); break;
+        case ASYNC_SYNC:  async_sync_complete(vol, a, op, res); break;
+        }
+        async_done(a, op);
+    }
+    return 0;
+#else
+    (void)vol; (void)a; (void)wait_nr;
+    return 0;
+#endif
+}
 
-    /* Rebuild view index from disk (geological strata) */
-    err = geofs_views_rebuild(vol);
-    if (err != GEOFS_OK) {
-        close(vol->fd);
-        free(vol);
-        return err;
+/* Wait for every operation in the ring; used before a blocking commit */
+static void async_quiesce(geofs_volume_t *vol) {
+    pthread_mutex_lock(&vol->async_lock);
+    struct geofs_async *a = vol->async;
+    while (a && a->inflight > 0) {
+        if (async_reap(vol, a, a->inflight) != 0) break;
     }
+    pthread_mutex_unlock(&vol->async_lock);
+}
 
-    /* Create default view if index is empty (shouldn't happen with proper persistence) */
-    if (!vol->view_index) {
-        struct view_index_entry *root = calloc(1, sizeof(struct view_index_entry));
-        root->id = vol->current_view;
-        root->parent_id = 0;
-        root->created = vol->sb.created;
-        strcpy(root->label, "Genesis");
-        vol->view_index = root;
+#ifdef GEOFS_HAVE_IO_URING
+/* A free submission entry, reaping first if the ring is full. async_lock held */
+static struct io_uring_sqe *async_sqe(geofs_volume_t *vol, struct geofs_async *a) {
+    struct geofs_uring *r = &a->ring;
+    while (a->inflight >= r->entries) {
+        if (async_reap(vol, a, 1) != 0) return NULL;
     }
+    struct io_uring_sqe *sqe = &r->sqes[*r->sq_tail & *r->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
 
-    *vol_out = vol;
-    return GEOFS_OK;
+/* Queue the entry from async_sqe; a full batch goes to the kernel at once */
+static void async_push(geofs_volume_t *vol, struct geofs_async *a) {
+    struct geofs_uring *r = &a->ring;
+    unsigned tail = *r->sq_tail;
+    r->sq_array[tail & *r->sq_mask] = tail & *r->sq_mask;
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    a->queued++;
+    a->inflight++;
+    a->pending++;
+    if (a->queued >= GEOFS_ASYNC_BATCH) async_reap(vol, a, 0);
 }
 
-void geofs_volume_close(geofs_volume_t *vol) {
-    if (!vol) return;
-    
-    pthread_mutex_lock(&vol->lock);
-    if (vol->dirty) {
-        write_superblock(vol);
-        fsync(vol->fd);
+/*
+ * Reserve a segment for one large object and queue its write: header,
+ * data from the caller, padding and trailer in one writev. Staged content
+ * is flushed first so it keeps the offsets it was given. async_lock held.
+ */
+static geofs_error_t async_store_direct(geofs_volume_t *vol, struct geofs_async *a,
+                                        struct geofs_async_op *op) {
+    static const uint8_t zero[GEOFS_BLOCK_SIZE];
+    uint64_t stored = op->blob.stored;
+    uint64_t data_blocks = (stored + GEOFS_BLOCK_SIZE - 1) / GEOFS_BLOCK_SIZE;
+    uint64_t blocks = 1 + data_blocks;
+    size_t pad = data_blocks * GEOFS_BLOCK_SIZE - stored;
+
+    op->blocks = calloc(2, GEOFS_BLOCK_SIZE);
+    if (!op->blocks) return GEOFS_ERR_NOMEM;
+    uint8_t *trailer = op->blocks + GEOFS_BLOCK_SIZE;
+    content_header(op->blocks, op->hash, &op->blob);
+    op->iov[0] = (struct iovec){ op->blocks, GEOFS_BLOCK_SIZE };
+    op->iov[1] = (struct iovec){ (void *)op->blob.data, stored };
+    op->iov[2] = (struct iovec){ (void *)zero, pad };
+    op->iov[3] = (struct iovec){ trailer, GEOFS_BLOCK_SIZE };
+    op->length = (blocks + 1) * GEOFS_BLOCK_SIZE;
+
+    uint32_t crc = 0xFFFFFFFF;
+    for (int i = 0; i < 3; i++) {
+        crc = crc32c_update(crc, op->iov[i].iov_base, op->iov[i].iov_len);
     }
-    close(vol->fd);
-    
-    /* Free indices */
-    struct content_index_entry *ce = vol->content_index;
-    while (ce) {
-        struct content_index_entry *next = ce->next;
-        free(ce);
-        ce = next;
+    struct geofs_segment_trailer t = {
+        .magic = GEOFS_SEGMENT_MAGIC,
+        .checksum = ~crc,
+        .blocks = blocks,
+        .objects = 1,
+    };
+
+    struct io_uring_sqe *sqe = async_sqe(vol, a);
+    if (!sqe) {
+        free(op->blocks);
+        return GEOFS_ERR_IO;
     }
-    
-    struct ref_index_entry *re = vol->ref_index;
-    while (re) {
-        struct ref_index_entry *next = re->next;
-        free(re);
-        re = next;
+
+    pthread_mutex_lock(&vol->seg_lock);
+    uint64_t region_end = vol->sb.content_region_start + vol->sb.content_region_blocks;
+    uint64_t need = vol->seg_blocks + (vol->seg_blocks ? 1 : 0) + blocks + 1;
+    geofs_error_t err = GEOFS_OK;
+    if (vol->sb.content_next_block + need > region_end) err = GEOFS_ERR_FULL;
+    if (err == GEOFS_OK) err = segment_flush_locked(vol);
+    if (err == GEOFS_OK) {
+        uint64_t next = vol->sb.content_next_block;
+        t.sequence = ++vol->seg_sequence;
+        memcpy(trailer, &t, sizeof(t));
+        op->offset = next * GEOFS_BLOCK_SIZE;
+        op->ops = __atomic_add_fetch(&vol->staged_ops, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&vol->sb.content_next_block, next + blocks + 1, __ATOMIC_RELEASE);
+        op->write_next = a->writes;
+        a->writes = op;
     }
-    
-    struct view_index_entry *ve = vol->view_index;
-    while (ve) {
-        struct view_index_entry *next = ve->next;
-        free(ve);
-        ve = next;
+    pthread_mutex_unlock(&vol->seg_lock);
+    if (err != GEOFS_OK) {
+        free(op->blocks);
+        return err;
     }
-    
-    pthread_mutex_unlock(&vol->lock);
-    pthread_mutex_destroy(&vol->lock);
-    free(vol);
-}
 
-/* ══════════════════════════════════════════════════════════════════════════════
- * CONTENT OPERATIONS
- * ══════════════════════════════════════════════════════════════════════════════ */
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->fd = vol->fd;
+    sqe->addr = (uintptr_t)op->iov;
+    sqe->len = 4;
+    sqe->off = op->offset;
+    sqe->user_data = (uintptr_t)op;
+    async_push(vol, a);
+    return GEOFS_OK;
+}
+#endif
+
+/* Hand an op that finished at submission to the next poll */
+static void async_finished(geofs_volume_t *vol, struct geofs_async_op *op) {
+    pthread_mutex_lock(&vol->async_lock);
+    struct geofs_async *a = vol->async;
+    a->pending++;
+    async_done(a, op);
+    pthread_mutex_unlock(&vol->async_lock);
+}
 
-geofs_error_t geofs_content_store(geofs_volume_t *vol, const void *data,
-                                   size_t size, geofs_hash_t hash_out) {
-    geofs_hash_t hash;
-    sha256(data, size, hash);
-    
-    pthread_mutex_lock(&vol->lock);
-    
-    /* Deduplication check */
-    if (find_content(vol, hash)) {
-        memcpy(hash_out, hash, GEOFS_HASH_SIZE);
-        pthread_mutex_unlock(&vol->lock);
-        return GEOFS_OK;
-    }
-    
-    uint64_t data_blocks = (size + GEOFS_BLOCK_SIZE - 1) / GEOFS_BLOCK_SIZE;
-    uint64_t total_blocks = 1 + data_blocks;
-    
-    uint64_t available = vol->sb.content_region_start + 
-                         vol->sb.content_region_blocks - 
-                         vol->sb.content_next_block;
-    if (total_blocks > available) {
-        pthread_mutex_unlock(&vol->lock);
-        return GEOFS_ERR_FULL;
+geofs_error_t geofs_content_store_async(geofs_volume_t *vol, const void *data,
+                                         size_t size, geofs_async_callback callback,
+                                         void *ctx) {
+    struct geofs_async_op *op = calloc(1, sizeof(struct geofs_async_op));
+    if (!op) return GEOFS_ERR_NOMEM;
+    op->type = ASYNC_STORE;
+    op->size = size;
+    op->callback = callback;
+    op->ctx = ctx;
+    sha256(data, size, op->hash);
+
+    pthread_rwlock_rdlock(&vol->lock);
+    int exists = find_content(vol, op->hash) != NULL;
+    geofs_codec_t codec = vol->codec;
+    pthread_rwlock_unlock(&vol->lock);
+
+    /* Compression runs here, on the caller's thread */
+    if (!exists) content_encode(codec, data, size, &op->blob);
+
+    pthread_mutex_lock(&vol->async_lock);
+    struct geofs_async *a = async_get(vol);
+    if (!a) {
+        pthread_mutex_unlock(&vol->async_lock);
+        content_blob_free(&op->blob);
+        free(op);
+        return GEOFS_ERR_NOMEM;
     }
-    
-    /* Write content header */
-    uint8_t header[GEOFS_BLOCK_SIZE] = {0};
-    memcpy(header, "CONT", 4);
-    memcpy(header + 8, &size, 8);
-    memcpy(header + 16, hash, 32);
-    
-    uint64_t offset = vol->sb.content_next_block * GEOFS_BLOCK_SIZE;
-    lseek(vol->fd, offset, SEEK_SET);
-    write(vol->fd, header, GEOFS_BLOCK_SIZE);
-    
-    if (size > 0) {
-        write(vol->fd, data, size);
+#ifdef GEOFS_HAVE_IO_URING
+    if (!exists && a->use_uring && op->blob.stored >= GEOFS_ASYNC_DIRECT_MIN) {
+        geofs_error_t err = async_store_direct(vol, a, op);
+        pthread_mutex_unlock(&vol->async_lock);
+        if (err != GEOFS_OK) {
+            content_blob_free(&op->blob);
+            free(op);
+        }
+        return err;
     }
-    
-    /* Add to index */
-    struct content_index_entry *entry = calloc(1, sizeof(struct content_index_entry));
-    if (entry) {
-        memcpy(entry->hash, hash, GEOFS_HASH_SIZE);
-        entry->offset = offset;
-        entry->size = size;
-        entry->next = vol->content_index;
-        vol->content_index = entry;
+#endif
+    pthread_mutex_unlock(&vol->async_lock);
+
+    /* Duplicates, small objects and the blocking backend: stage it now */
+    if (!exists) {
+        op->err = content_store_blob(vol, op->hash, &op->blob, &op->ops);
+        content_blob_free(&op->blob);
     }
-    
-    vol->sb.content_next_block += total_blocks;
-    vol->sb.total_content_bytes += size;
-    vol->dirty = 1;
-    
-    memcpy(hash_out, hash, GEOFS_HASH_SIZE);
-    pthread_mutex_unlock(&vol->lock);
+    async_finished(vol, op);
     return GEOFS_OK;
 }
 
-geofs_error_t geofs_content_read(geofs_volume_t *vol, const geofs_hash_t hash,
-                                  void *buf, size_t buf_size, size_t *size_out) {
-    pthread_mutex_lock(&vol->lock);
-    
+geofs_error_t geofs_content_read_async(geofs_volume_t *vol, const geofs_hash_t hash,
+                                        void *buf, size_t buf_size,
+                                        geofs_async_callback callback, void *ctx) {
+    pthread_rwlock_rdlock(&vol->lock);
     struct content_index_entry *entry = find_content(vol, hash);
     if (!entry) {
-        pthread_mutex_unlock(&vol->lock);
+        pthread_rwlock_unlock(&vol->lock);
         return GEOFS_ERR_NOTFOUND;
     }
-    
+    uint64_t offset = entry->offset;
     size_t to_read = entry->size;
     if (to_read > buf_size) to_read = buf_size;
-    
-    lseek(vol->fd, entry->offset + GEOFS_BLOCK_SIZE, SEEK_SET);
-    ssize_t got = read(vol->fd, buf, to_read);
-    
-    if (got < 0) {
-        pthread_mutex_unlock(&vol->lock);
+    int compressed = (entry->flags & (GEOFS_OBJ_CODEC_MASK | GEOFS_OBJ_MANIFEST)) != 0;
+    pthread_rwlock_unlock(&vol->lock);
+
+    if (content_ensure_written(vol, offset) != GEOFS_OK) {
         return GEOFS_ERR_IO;
     }
-    
-    if (size_out) *size_out = (size_t)got;
-    pthread_mutex_unlock(&vol->lock);
+
+    struct geofs_async_op *op = calloc(1, sizeof(struct geofs_async_op));
+    if (!op) return GEOFS_ERR_NOMEM;
+    op->type = ASYNC_READ;
+    memcpy(op->hash, hash, GEOFS_HASH_SIZE);
+    op->offset = offset;
+    op->length = to_read;
+    op->iov[0] = (struct iovec){ buf, to_read };
+    op->callback = callback;
+    op->ctx = ctx;
+
+    /* Compressed objects and manifests are read now, not by the ring */
+    if (compressed) {
+        pthread_mutex_lock(&vol->async_lock);
+        struct geofs_async *a = async_get(vol);
+        pthread_mutex_unlock(&vol->async_lock);
+        if (!a) {
+            free(op);
+            return GEOFS_ERR_NOMEM;
+        }
+        op->err = geofs_content_read(vol, hash, buf, buf_size, &op->size);
+        async_finished(vol, op);
+        return GEOFS_OK;
+    }
+
+    pthread_mutex_lock(&vol->async_lock);
+    struct geofs_async *a = async_get(vol);
+    if (!a) {
+        pthread_mutex_unlock(&vol->async_lock);
+        free(op);
+        return GEOFS_ERR_NOMEM;
+    }
+#ifdef GEOFS_HAVE_IO_URING
+    if (a->use_uring) {
+        struct io_uring_sqe *sqe = async_sqe(vol, a);
+        if (!sqe) {
+            pthread_mutex_unlock(&vol->async_lock);
+            free(op);
+            return GEOFS_ERR_IO;
+        }
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = vol->fd;
+        sqe->addr = (uintptr_t)op->iov;
+        sqe->len = 1;
+        sqe->off = offset;
+        sqe->user_data = (uintptr_t)op;
+        async_push(vol, a);
+        pthread_mutex_unlock(&vol->async_lock);
+        return GEOFS_OK;
+    }
+#endif
+    pthread_mutex_unlock(&vol->async_lock);
+
+    async_read_complete(vol, op, -1);
+    async_finished(vol, op);
     return GEOFS_OK;
 }
 
-geofs_error_t geofs_content_size(geofs_volume_t *vol, const geofs_hash_t hash,
-                                  uint64_t *size_out) {
-    pthread_mutex_lock(&vol->lock);
-    struct content_index_entry *entry = find_content(vol, hash);
-    if (!entry) {
-        pthread_mutex_unlock(&vol->lock);
-        return GEOFS_ERR_NOTFOUND;
+geofs_error_t geofs_volume_sync_async(geofs_volume_t *vol,
+                                       geofs_async_callback callback, void *ctx) {
+    struct geofs_async_op *op = calloc(1, sizeof(struct geofs_async_op));
+    if (!op) return GEOFS_ERR_NOMEM;
+    op->type = ASYNC_SYNC;
+    op->callback = callback;
+    op->ctx = ctx;
+
+    pthread_mutex_lock(&vol->async_lock);
+    struct geofs_async *a = async_get(vol);
+    if (!a) {
+        pthread_mutex_unlock(&vol->async_lock);
+        free(op);
+        return GEOFS_ERR_NOMEM;
+    }
+#ifdef GEOFS_HAVE_IO_URING
+    if (a->use_uring) {
+        struct io_uring_sqe *sqe = async_sqe(vol, a);
+        if (!sqe) {
+            pthread_mutex_unlock(&vol->async_lock);
+            free(op);
+            return GEOFS_ERR_IO;
+        }
+
+        /* The superblock to write once everything before it is on disk */
+        pthread_mutex_lock(&vol->seg_lock);
+        geofs_error_t err = segment_flush_locked(vol);
+        op->ops = vol->staged_ops;
+        op->sb = vol->sb;
+        pthread_mutex_unlock(&vol->seg_lock);
+        if (err != GEOFS_OK) {
+            pthread_mutex_unlock(&vol->async_lock);
+            free(op);
+            return err;
+        }
+        op->fixups = a->fixups;
+
+        /* Drain: the fdatasync starts after every write queued before it */
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fd = vol->fd;
+        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+        sqe->flags = IOSQE_IO_DRAIN;
+        sqe->user_data = (uintptr_t)op;
+        async_push(vol, a);
+        pthread_mutex_unlock(&vol->async_lock);
+        return GEOFS_OK;
+    }
+#endif
+    pthread_mutex_unlock(&vol->async_lock);
+
+    op->err = volume_commit(vol, UINT64_MAX);
+    async_finished(vol, op);
+    return GEOFS_OK;
+}
+
+int geofs_async_poll(geofs_volume_t *vol, unsigned min_complete) {
+    pthread_mutex_lock(&vol->async_lock);
+    struct geofs_async *a = vol->async;
+    if (!a) {
+        pthread_mutex_unlock(&vol->async_lock);
+        return 0;
+    }
+
+    unsigned wait = min_complete > a->ndone ? min_complete - a->ndone : 0;
+    if (wait > a->inflight) wait = a->inflight;
+    int failed = async_reap(vol, a, wait) != 0;
+
+    struct geofs_async_op *list = a->done;
+    unsigned n = a->ndone;
+    a->done = a->done_tail = NULL;
+    a->ndone = 0;
+    a->pending -= n;
+    pthread_mutex_unlock(&vol->async_lock);
+
+    /* One commit covers the whole batch of stores */
+    uint64_t upto = 0;
+    for (struct geofs_async_op *op = list; op; op = op->next) {
+        if (op->type == ASYNC_STORE && op->err == GEOFS_OK && op->ops > upto) upto = op->ops;
+    }
+    if (upto && __atomic_load_n(&vol->sync_policy, __ATOMIC_RELAXED) == GEOFS_SYNC_PER_OP) {
+        geofs_error_t err = volume_commit(vol, upto);
+        for (struct geofs_async_op *op = list; op && err != GEOFS_OK; op = op->next) {
+            if (op->type == ASYNC_STORE && op->err == GEOFS_OK) op->err = err;
+        }
+    }
+
+    while (list) {
+        struct geofs_async_op *next = list->next;
+        if (list->callback) {
+            list->callback(list->err, list->hash, list->size, list->ctx);
+        }
+        free(list->blocks);
+        free(list);
+        list = next;
+    }
+
+    if (failed && n == 0) return GEOFS_ERR_IO;
+    return (int)n;
+}
+
+geofs_error_t geofs_async_drain(geofs_volume_t *vol) {
+    while (geofs_async_pending(vol) > 0) {
+        int n = geofs_async_poll(vol, 1);
+        if (n < 0) return (geofs_error_t)n;
     }
-    *size_out = entry->size;
-    pthread_mutex_unlock(&vol->lock);
     return GEOFS_OK;
 }
 
+unsigned geofs_async_pending(geofs_volume_t *vol) {
+    pthread_mutex_lock(&vol->async_lock);
+    unsigned pending = vol->async ? vol->async->pending : 0;
+    pthread_mutex_unlock(&vol->async_lock);
+    return pending;
+}
+
+const char *geofs_async_backend(geofs_volume_t *vol) {
+    pthread_mutex_lock(&vol->async_lock);
+    struct geofs_async *a = async_get(vol);
+    int uring = a && a->use_uring;
+    pthread_mutex_unlock(&vol->async_lock);
+    return uring ? "io_uring" : "blocking";
+}
+
 /* ══════════════════════════════════════════════════════════════════════════════
  * REFERENCE OPERATIONS
  * ══════════════════════════════════════════════════════════════════════════════ */
 
 geofs_error_t geofs_ref_create(geofs_volume_t *vol, const char *path,
                                 const geofs_hash_t content_hash) {
-    pthread_mutex_lock(&vol->lock);
-
     struct ref_index_entry *entry = calloc(1, sizeof(struct ref_index_entry));
     if (!entry) {
-        pthread_mutex_unlock(&vol->lock);
         return GEOFS_ERR_NOMEM;
     }
 
     hash_path(path, entry->path_hash);
     memcpy(entry->content_hash, content_hash, GEOFS_HASH_SIZE);
-    entry->view_id = vol->current_view;
+    entry->view_id = __atomic_load_n(&vol->current_view, __ATOMIC_RELAXED);
     entry->created = geofs_time_now();
     strncpy(entry->path, path, GEOFS_MAX_PATH - 1);
     entry->is_hidden = 0;
 
-    /* Persist ref to disk */
-    geofs_error_t err = geofs_ref_write_record(vol, entry);
+    /* Stage the ref for disk */
+    uint64_t ops;
+    geofs_error_t err = geofs_ref_stage_record(vol, entry, &ops);
     if (err != GEOFS_OK) {
         free(entry);
-        pthread_mutex_unlock(&vol->lock);
         return err;
     }
 
-    entry->next = vol->ref_index;
-    vol->ref_index = entry;
+    pthread_rwlock_wrlock(&vol->lock);
+    err = ref_index_insert(vol, entry);
+    if (err != GEOFS_OK) {
+        free(entry);
+        pthread_rwlock_unlock(&vol->lock);
+        return err;
+    }
 
     vol->sb.total_refs++;
     vol->dirty = 1;
 
-    pthread_mutex_unlock(&vol->lock);
-    return GEOFS_OK;
+    pthread_rwlock_unlock(&vol->lock);
+    return commit_policy(vol, ops);
 }
 
 geofs_error_t geofs_ref_resolve(geofs_volume_t *vol, const char *path,
                                  geofs_hash_t hash_out) {
-    pthread_mutex_lock(&vol->lock);
+    pthread_rwlock_rdlock(&vol->lock);
     
     struct ref_index_entry *entry = find_ref(vol, path);
     if (!entry || entry->is_hidden) {
-        pthread_mutex_unlock(&vol->lock);
+        pthread_rwlock_unlock(&vol->lock);
         return GEOFS_ERR_NOTFOUND;
     }
     
     memcpy(hash_out, entry->content_hash, GEOFS_HASH_SIZE);
-    pthread_mutex_unlock(&vol->lock);
+    pthread_rwlock_unlock(&vol->lock);
     return GEOFS_OK;
 }
 
 int geofs_ref_list(geofs_volume_t *vol, const char *dir_path,
                    geofs_dir_callback callback, void *ctx) {
-    pthread_mutex_lock(&vol->lock);
+    pthread_rwlock_rdlock(&vol->lock);
 
     size_t dir_len = strlen(dir_path);
     int count = 0;
@@ -903,7 +3231,7 @@ int geofs_ref_list(geofs_volume_t *vol, const char *dir_path,
                         struct geofs_dirent dirent = {0};
                         strncpy(dirent.name, name, GEOFS_MAX_NAME);
                         memcpy(dirent.content_hash, current->content_hash, GEOFS_HASH_SIZE);
-                        dirent.size = content ? content->size : 0;
+                        dirent.size = content ? content->length : 0;
                         dirent.created = current->created;
 
                         callback(&dirent, ctx);
@@ -915,7 +3243,7 @@ int geofs_ref_list(geofs_volume_t *vol, const char *dir_path,
         entry = entry->next;
     }
     
-    pthread_mutex_unlock(&vol->lock);
+    pthread_rwlock_unlock(&vol->lock);
     return count;
 }
 
@@ -925,11 +3253,11 @@ int geofs_ref_list(geofs_volume_t *vol, const char *dir_path,
 
 geofs_error_t geofs_view_create(geofs_volume_t *vol, const char *label,
                                  geofs_view_t *view_out) {
-    pthread_mutex_lock(&vol->lock);
+    pthread_rwlock_wrlock(&vol->lock);
 
     struct view_index_entry *view = calloc(1, sizeof(struct view_index_entry));
     if (!view) {
-        pthread_mutex_unlock(&vol->lock);
+        pthread_rwlock_unlock(&vol->lock);
         return GEOFS_ERR_NOMEM;
     }
 
@@ -943,7 +3271,7 @@ geofs_error_t geofs_view_create(geofs_volume_t *vol, const char *label,
     if (err != GEOFS_OK) {
         vol->sb.view_next_id--;  /* Rollback */
         free(view);
-        pthread_mutex_unlock(&vol->lock);
+        pthread_rwlock_unlock(&vol->lock);
         return err;
     }
 
@@ -954,12 +3282,12 @@ geofs_error_t geofs_view_create(geofs_volume_t *vol, const char *label,
     vol->dirty = 1;
 
     *view_out = view->id;
-    pthread_mutex_unlock(&vol->lock);
+    pthread_rwlock_unlock(&vol->lock);
     return GEOFS_OK;
 }
 
 geofs_error_t geofs_view_switch(geofs_volume_t *vol, geofs_view_t view_id) {
-    pthread_mutex_lock(&vol->lock);
+    pthread_rwlock_wrlock(&vol->lock);
     
     int found = 0;
     struct view_index_entry *view = vol->view_index;
@@ -972,24 +3300,30 @@ geofs_error_t geofs_view_switch(geofs_volume_t *vol, geofs_view_t view_id) {
     }
     
     if (!found) {
-        pthread_mutex_unlock(&vol->lock);
+        pthread_rwlock_unlock(&vol->lock);
         return GEOFS_ERR_NOTFOUND;
     }
     
-    vol->current_view = view_id;
+    /* ref_create reads this without the lock */
+    __atomic_store_n(&vol->current_view, view_id, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&vol->ref_generation, 1, __ATOMIC_RELEASE);
     vol->sb.current_view = view_id;
     vol->dirty = 1;
     
-    pthread_mutex_unlock(&vol->lock);
+    pthread_rwlock_unlock(&vol->lock);
     return GEOFS_OK;
 }
 
+uint64_t geofs_ref_generation(geofs_volume_t *vol) {
+    return __atomic_load_n(&vol->ref_generation, __ATOMIC_ACQUIRE);
+}
+
 geofs_view_t geofs_view_current(geofs_volume_t *vol) {
-    return vol->current_view;
+    return __atomic_load_n(&vol->current_view, __ATOMIC_RELAXED);
 }
 
 int geofs_view_list(geofs_volume_t *vol, geofs_view_callback callback, void *ctx) {
-    pthread_mutex_lock(&vol->lock);
+    pthread_rwlock_rdlock(&vol->lock);
     
     int count = 0;
     struct view_index_entry *view = vol->view_index;
@@ -1005,21 +3339,19 @@ int geofs_view_list(geofs_volume_t *vol, geofs_view_callback callback, void *ctx
         view = view->next;
     }
     
-    pthread_mutex_unlock(&vol->lock);
+    pthread_rwlock_unlock(&vol->lock);
     return count;
 }
 
 geofs_error_t geofs_view_hide(geofs_volume_t *vol, const char *path) {
-    pthread_mutex_lock(&vol->lock);
-
+    pthread_rwlock_rdlock(&vol->lock);
     struct ref_index_entry *existing = find_ref(vol, path);
+    pthread_rwlock_unlock(&vol->lock);
+
     if (!existing) {
-        pthread_mutex_unlock(&vol->lock);
         return GEOFS_ERR_NOTFOUND;
     }
 
-    pthread_mutex_unlock(&vol->lock);
-
     /* Create new view */
     geofs_view_t new_view = 0;
     char label[64];
@@ -1029,12 +3361,9 @@ geofs_error_t geofs_view_hide(geofs_volume_t *vol, const char *path) {
         geofs_view_switch(vol, new_view);
     }
 
-    pthread_mutex_lock(&vol->lock);
-
     /* Create hidden marker */
     struct ref_index_entry *hidden = calloc(1, sizeof(struct ref_index_entry));
     if (!hidden) {
-        pthread_mutex_unlock(&vol->lock);
         return GEOFS_ERR_NOMEM;
     }
 
@@ -1045,20 +3374,25 @@ geofs_error_t geofs_view_hide(geofs_volume_t *vol, const char *path) {
     strncpy(hidden->path, path, GEOFS_MAX_PATH - 1);
     hidden->is_hidden = 1;
 
-    /* Persist hidden ref to disk */
-    geofs_error_t err = geofs_ref_write_record(vol, hidden);
+    /* Stage hidden ref for disk */
+    uint64_t ops;
+    geofs_error_t err = geofs_ref_stage_record(vol, hidden, &ops);
     if (err != GEOFS_OK) {
         free(hidden);
-        pthread_mutex_unlock(&vol->lock);
         return err;
     }
 
-    hidden->next = vol->ref_index;
-    vol->ref_index = hidden;
+    pthread_rwlock_wrlock(&vol->lock);
+    err = ref_index_insert(vol, hidden);
+    if (err != GEOFS_OK) {
+        free(hidden);
+        pthread_rwlock_unlock(&vol->lock);
+        return err;
+    }
     vol->dirty = 1;
 
-    pthread_mutex_unlock(&vol->lock);
-    return GEOFS_OK;
+    pthread_rwlock_unlock(&vol->lock);
+    return commit_policy(vol, ops);
 }
 
 /* ══════════════════════════════════════════════════════════════════════════════
@@ -1068,7 +3402,7 @@ geofs_error_t geofs_view_hide(geofs_volume_t *vol, const char *path) {
 int geofs_ref_history(geofs_volume_t *vol, geofs_history_callback callback, void *ctx) {
     if (!vol || !callback) return 0;
 
-    pthread_mutex_lock(&vol->lock);
+    pthread_rwlock_rdlock(&vol->lock);
 
     int count = 0;
     struct ref_index_entry *entry = vol->ref_index;
@@ -1085,7 +3419,7 @@ int geofs_ref_history(geofs_volume_t *vol, geofs_history_callback callback, void
         if (!entry->is_hidden) {
             struct content_index_entry *content = find_content(vol, entry->content_hash);
             if (content) {
-                info.size = content->size;
+                info.size = content->length;
             }
         }
 
@@ -1094,16 +3428,97 @@ int geofs_ref_history(geofs_volume_t *vol, geofs_history_callback callback, void
         entry = entry->next;
     }
 
-    pthread_mutex_unlock(&vol->lock);
+    pthread_rwlock_unlock(&vol->lock);
     return count;
 }
 
+/* ══════════════════════════════════════════════════════════════════════════════
+ * INDEX STATISTICS
+ * ══════════════════════════════════════════════════════════════════════════════ */
+
+geofs_error_t geofs_index_stats(geofs_volume_t *vol, struct geofs_index_stats *stats) {
+    if (!vol || !stats) return GEOFS_ERR_INVALID;
+
+    memset(stats, 0, sizeof(*stats));
+    pthread_rwlock_rdlock(&vol->lock);
+
+    /* A hit on the k-th entry of a chain compares k entries */
+    uint64_t hit_probes = 0;
+    for (uint64_t i = 0; i < vol->content_nbuckets; i++) {
+        uint64_t len = 0;
+        for (struct content_index_entry *e = vol->content_buckets[i]; e; e = e->next) {
+            len++;
+        }
+        hit_probes += len * (len + 1) / 2;
+        if (len > stats->content_longest) stats->content_longest = len;
+    }
+    stats->content_entries = vol->content_count;
+    stats->content_buckets = vol->content_nbuckets;
+    stats->content_lookups = vol->content_probe.lookups;
+    stats->content_probes = vol->content_probe.probes;
+    if (vol->content_count) {
+        stats->content_expected_probe = (double)hit_probes / vol->content_count;
+    }
+
+    hit_probes = 0;
+    for (uint64_t i = 0; i < vol->ref_nbuckets; i++) {
+        uint64_t len = 0;
+        for (struct ref_path_entry *pe = vol->ref_buckets[i]; pe; pe = pe->next) {
+            len++;
+            if (pe->version_count > stats->ref_max_versions) {
+                stats->ref_max_versions = pe->version_count;
+            }
+        }
+        hit_probes += len * (len + 1) / 2;
+        if (len > stats->ref_longest) stats->ref_longest = len;
+    }
+    stats->ref_versions = vol->ref_count;
+    stats->ref_paths = vol->ref_paths;
+    stats->ref_buckets = vol->ref_nbuckets;
+    stats->ref_lookups = vol->ref_probe.lookups;
+    stats->ref_probes = vol->ref_probe.probes;
+    if (vol->ref_paths) {
+        stats->ref_expected_probe = (double)hit_probes / vol->ref_paths;
+    }
+
+    pthread_rwlock_unlock(&vol->lock);
+    return GEOFS_OK;
+}
+
+geofs_error_t geofs_space_stats(geofs_volume_t *vol, struct geofs_space_stats *stats) {
+    if (!vol || !stats) return GEOFS_ERR_INVALID;
+
+    memset(stats, 0, sizeof(*stats));
+    pthread_rwlock_rdlock(&vol->lock);
+    stats->objects = vol->content_count;
+    stats->packed_objects = vol->packed_count;
+    stats->compressed_objects = vol->compressed_count;
+    stats->recompressed_objects = vol->recompressed_count;
+    stats->logical_bytes = vol->sb.total_content_bytes;
+    stats->stored_bytes = vol->stored_bytes;
+    stats->superseded_bytes = vol->superseded_bytes;
+
+    pthread_mutex_lock(&vol->seg_lock);
+    uint64_t blocks = vol->sb.content_next_block - vol->sb.content_region_start +
+                      vol->seg_blocks;
+    pthread_mutex_unlock(&vol->seg_lock);
+    pthread_rwlock_unlock(&vol->lock);
+
+    stats->physical_bytes = blocks * GEOFS_BLOCK_SIZE;
+    if (stats->logical_bytes) {
+        stats->amplification = (double)stats->physical_bytes / stats->logical_bytes;
+    }
+    return GEOFS_OK;
+}
+
 /* ══════════════════════════════════════════════════════════════════════════════
  * CLI COMMANDS (only compiled in standalone mode)
  * ══════════════════════════════════════════════════════════════════════════════ */
 
 #ifdef GEOFS_STANDALONE
 
+#include <dirent.h>
+
 static int cmd_create(int argc, char **argv) {
     if (argc < 4) {
         fprintf(stderr, "Usage: geofs create <volume> <size_mb>\n");
@@ -1274,6 +3689,153 @@ static int cmd_write(int argc, char **argv) {
     return 0;
 }
 
+/* import: files go to the volume asynchronously, a bounded number at a time */
+#define IMPORT_QUEUE    32
+
+struct import_state {
+    geofs_volume_t *vol;
+    unsigned        queued;
+    uint64_t        files;
+    uint64_t        bytes;
+    uint64_t        failed;
+};
+
+struct import_file {
+    struct import_state *st;
+    char            path[GEOFS_MAX_PATH];
+    void           *data;
+};
+
+static void import_done(geofs_error_t err, const geofs_hash_t hash, size_t size, void *ctx) {
+    struct import_file *f = ctx;
+    struct import_state *st = f->st;
+    
+    if (err == GEOFS_OK) err = geofs_ref_create(st->vol, f->path, hash);
+    if (err == GEOFS_OK) {
+        st->files++;
+        st->bytes += size;
+    } else {
+        fprintf(stderr, "  %s: %s\n", f->path, geofs_strerror(err));
+        st->failed++;
+    }
+    st->queued--;
+    free(f->data);
+    free(f);
+}
+
+static void import_file(struct import_state *st, const char *src, const char *dst) {
+    int fd = open(src, O_RDONLY);
+    struct stat sb;
+    if (fd < 0 || fstat(fd, &sb) != 0) {
+        fprintf(stderr, "  %s: %s\n", src, strerror(errno));
+        if (fd >= 0) close(fd);
+        st->failed++;
+        return;
+    }
+    
+    struct import_file *f = calloc(1, sizeof(struct import_file));
+    void *data = malloc(sb.st_size ? (size_t)sb.st_size : 1);
+    if (!f || !data || pread_full(fd, data, (size_t)sb.st_size, 0) != sb.st_size) {
+        fprintf(stderr, "  %s: read failed\n", src);
+        close(fd);
+        free(f);
+        free(data);
+        st->failed++;
+        return;
+    }
+    close(fd);
+    
+    f->st = st;
+    f->data = data;
+    strncpy(f->path, dst, GEOFS_MAX_PATH - 1);
+    
+    /* Keep the queue bounded; callbacks free what they are done with */
+    while (st->queued >= IMPORT_QUEUE) geofs_async_poll(st->vol, 1);
+    
+    geofs_error_t err = geofs_content_store_async(st->vol, data, (size_t)sb.st_size,
+                                                  import_done, f);
+    if (err != GEOFS_OK) {
+        fprintf(stderr, "  %s: %s\n", src, geofs_strerror(err));
+        free(data);
+        free(f);
+        st->failed++;
+        return;
+    }
+    st->queued++;
+    geofs_async_poll(st->vol, 0);
+}
+
+static void import_dir(struct import_state *st, const char *src, const char *dst) {
+    DIR *dir = opendir(src);
+    if (!dir) {
+        fprintf(stderr, "  %s: %s\n", src, strerror(errno));
+        st->failed++;
+        return;
+    }
+    
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) continue;
+        
+        char src_path[4096], dst_path[GEOFS_MAX_PATH];
+        snprintf(src_path, sizeof(src_path), "%s/%s", src, de->d_name);
+        if (snprintf(dst_path, sizeof(dst_path), "%s/%s", dst, de->d_name) >= (int)sizeof(dst_path)) {
+            fprintf(stderr, "  %s: path too long\n", src_path);
+            st->failed++;
+            continue;
+        }
+        
+        struct stat sb;
+        if (lstat(src_path, &sb) != 0) continue;
+        if (S_ISDIR(sb.st_mode)) {
+            import_dir(st, src_path, dst_path);
+        } else if (S_ISREG(sb.st_mode)) {
+            import_file(st, src_path, dst_path);
+        }
+    }
+    closedir(dir);
+}
+
+static int cmd_import(int argc, char **argv) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: geofs import <volume> <directory> [path]\n");
+        return 1;
+    }
+    
+    geofs_volume_t *vol;
+    geofs_error_t err = geofs_volume_open(argv[2], &vol);
+    if (err != GEOFS_OK) {
+        fprintf(stderr, "Error: %s\n", geofs_strerror(err));
+        return 1;
+    }
+    
+    /* Strip a trailing slash so "/" imports at the root */
+    char dst[GEOFS_MAX_PATH] = "";
+    if (argc > 4) strncpy(dst, argv[4], sizeof(dst) - 1);
+    size_t len = strlen(dst);
+    if (len > 0 && dst[len - 1] == '/') dst[len - 1] = '\0';
+    
+    struct import_state st = { .vol = vol };
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    
+    import_dir(&st, argv[3], dst);
+    
+    geofs_volume_sync_async(vol, NULL, NULL);
+    err = geofs_async_drain(vol);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    
+    printf("\n  Imported: %lu files, %lu bytes\n",
+           (unsigned long)st.files, (unsigned long)st.bytes);
+    if (st.failed) printf("  Failed:   %lu\n", (unsigned long)st.failed);
+    printf("  Backend:  %s\n", geofs_async_backend(vol));
+    printf("  Time:     %.2f s\n\n", secs);
+    
+    geofs_volume_close(vol);
+    return (err != GEOFS_OK || st.failed) ? 1 : 0;
+}
+
 static void view_callback(const struct geofs_view_info *info, void *ctx) {
     geofs_view_t *current = ctx;
     char marker = (info->id == *current) ? '*' : ' ';
@@ -1404,8 +3966,75 @@ static int cmd_stats(int argc, char **argv) {
     printf("  Views:         %lu\n", vol->sb.total_views);
     printf("  Current View:  %lu\n", vol->sb.current_view);
     printf("\n");
+
+    struct geofs_index_stats ix;
+    geofs_index_stats(vol, &ix);
+
+    printf("  Index:\n");
+    printf("    Content:     %lu entries in %lu buckets (longest chain %lu)\n",
+           ix.content_entries, ix.content_buckets, ix.content_longest);
+    printf("    Ref paths:   %lu paths, %lu versions in %lu buckets "
+           "(longest chain %lu, most versions %lu)\n",
+           ix.ref_paths, ix.ref_versions, ix.ref_buckets,
+           ix.ref_longest, ix.ref_max_versions);
+    printf("    Avg probe:   content %.2f, refs %.2f\n",
+           ix.content_expected_probe, ix.ref_expected_probe);
+    printf("\n");
+
+    struct geofs_space_stats sp;
+    geofs_space_stats(vol, &sp);
+
+    printf("  Space:\n");
+    printf("    Objects:     %lu (%lu packed, %lu compressed, %lu recompressed)\n",
+           sp.objects, sp.packed_objects, sp.compressed_objects, sp.recompressed_objects);
+    printf("    Stored:      %lu bytes for %lu bytes of content\n",
+           sp.stored_bytes, sp.logical_bytes);
+    printf("    Superseded:  %lu bytes\n", sp.superseded_bytes);
+    printf("    On disk:     %lu bytes\n", sp.physical_bytes);
+    printf("    Amplification: %.2fx\n", sp.amplification);
+    printf("\n");
+    
+    geofs_volume_close(vol);
+    return 0;
+}
+
+static int cmd_recompress(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: geofs recompress <volume> [lz4|deflate]\n");
+        return 1;
+    }
+    
+    geofs_codec_t codec = GEOFS_CODEC_DEFLATE;
+    if (argc > 3) {
+        if (strcmp(argv[3], "lz4") == 0) {
+            codec = GEOFS_CODEC_LZ4;
+        } else if (strcmp(argv[3], "deflate") != 0) {
+            fprintf(stderr, "Error: Unknown codec %s\n", argv[3]);
+            return 1;
+        }
+    }
+    if (!geofs_codec_available(codec)) {
+        fprintf(stderr, "Error: %s is not built in\n", argc > 3 ? argv[3] : "deflate");
+        return 1;
+    }
+    
+    geofs_volume_t *vol;
+    geofs_error_t err = geofs_volume_open(argv[2], &vol);
+    if (err != GEOFS_OK) {
+        fprintf(stderr, "Error: %s\n", geofs_strerror(err));
+        return 1;
+    }
     
+    struct geofs_recompress_result r;
+    err = geofs_volume_recompress(vol, codec, &r);
     geofs_volume_close(vol);
+    if (err != GEOFS_OK) {
+        fprintf(stderr, "Error: %s\n", geofs_strerror(err));
+        return 1;
+    }
+    
+    printf("Rewrote %lu of %lu objects: %lu -> %lu bytes\n",
+           r.rewritten, r.examined, r.bytes_before, r.bytes_after);
     return 0;
 }
 
@@ -1424,10 +4053,12 @@ static void usage(void) {
     printf("    geofs ls <volume> [path]          List directory\n");
     printf("    geofs cat <volume> <path>         Read file contents\n");
     printf("    geofs write <volume> <path>       Write from stdin\n");
+    printf("    geofs import <volume> <dir>       Import a directory tree\n");
     printf("    geofs views <volume>              List all views\n");
     printf("    geofs view <volume> <id>          Switch to view\n");
     printf("    geofs hide <volume> <path>        Hide file from view\n");
     printf("    geofs stats <volume>              Volume statistics\n");
+    printf("    geofs recompress <volume> [codec] Rewrite cold content\n");
     printf("\n");
     printf("  EXAMPLES:\n");
     printf("\n");
@@ -1458,10 +4089,12 @@ int main(int argc, char **argv) {
     if (strcmp(cmd, "ls") == 0)     return cmd_ls(argc, argv);
     if (strcmp(cmd, "cat") == 0)    return cmd_cat(argc, argv);
     if (strcmp(cmd, "write") == 0)  return cmd_write(argc, argv);
+    if (strcmp(cmd, "import") == 0) return cmd_import(argc, argv);
     if (strcmp(cmd, "views") == 0)  return cmd_views(argc, argv);
     if (strcmp(cmd, "view") == 0)   return cmd_view(argc, argv);
     if (strcmp(cmd, "hide") == 0)   return cmd_hide(argc, argv);
     if (strcmp(cmd, "stats") == 0)  return cmd_stats(argc, argv);
+    if (strcmp(cmd, "recompress") == 0) return cmd_recompress(argc, argv);
     if (strcmp(cmd, "help") == 0)   { usage(); return 0; }
     
     fprintf(stderr, "Unknown command: %s\n", cmd);
@@ -48,6 +48,28 @@ typedef enum {
     GEOFS_ERR_FULL      = -7,
 } geofs_error_t;
 
+/*
+ * When staged writes reach the disk. Stores and refs are staged in an
+ * in-memory segment and written out together; a segment is committed by
+ * a checksummed trailer, and fdatasync makes it durable.
+ */
+typedef enum {
+    GEOFS_SYNC_ON_CLOSE = 0,    /* On close and geofs_volume_sync (default) */
+    GEOFS_SYNC_PER_OP   = 1,    /* Before every store and ref_create returns */
+    GEOFS_SYNC_GROUP    = 2,    /* Every interval_ms, from a background thread */
+} geofs_sync_policy_t;
+
+/*
+ * Per-object compression. An object is kept compressed only when that
+ * saves at least 10%. LZ4 is always built in; deflate, the slower and
+ * denser codec meant for cold data, needs zlib (GEOFS_HAVE_ZLIB).
+ */
+typedef enum {
+    GEOFS_CODEC_NONE    = 0,
+    GEOFS_CODEC_LZ4     = 1,    /* Default for new stores */
+    GEOFS_CODEC_DEFLATE = 2,
+} geofs_codec_t;
+
 /* ══════════════════════════════════════════════════════════════════════════════
  * STRUCTURES
  * ══════════════════════════════════════════════════════════════════════════════ */
@@ -82,6 +104,68 @@ struct geofs_history_entry {
     int         is_hidden;
 };
 
+/* Backing memory of content views (internal, reference counted) */
+struct geofs_mapping;
+
+/*
+ * Read-only view of stored content (see geofs_content_map). The bytes stay
+ * valid until geofs_content_unmap, even if the volume is closed first.
+ */
+struct geofs_content_view {
+    const void *data;
+    uint64_t    size;
+    struct geofs_mapping *mapping;
+};
+
+/* One piece of chunked content (see geofs_manifest_store) */
+struct geofs_chunk {
+    geofs_hash_t hash;
+    uint64_t    offset;             /* Where the chunk starts in the content */
+    uint64_t    size;
+};
+
+/* In-memory index statistics (see geofs_index_stats) */
+struct geofs_index_stats {
+    uint64_t    content_entries;
+    uint64_t    content_buckets;
+    uint64_t    content_longest;    /* Longest bucket chain */
+    uint64_t    content_lookups;    /* Since the volume was opened */
+    uint64_t    content_probes;     /* Chain entries compared by those lookups */
+
+    uint64_t    ref_versions;       /* Ref records, all views */
+    uint64_t    ref_paths;          /* Distinct paths */
+    uint64_t    ref_buckets;
+    uint64_t    ref_longest;
+    uint64_t    ref_max_versions;   /* Most versions held by one path */
+    uint64_t    ref_lookups;
+    uint64_t    ref_probes;
+
+    /* Mean chain entries compared to find a present key, from chain lengths */
+    double      content_expected_probe;
+    double      ref_expected_probe;
+};
+
+/* Content region usage (see geofs_space_stats) */
+struct geofs_space_stats {
+    uint64_t    objects;
+    uint64_t    packed_objects;     /* Sharing blocks with other small objects */
+    uint64_t    compressed_objects;
+    uint64_t    recompressed_objects;   /* Rewritten by geofs_volume_recompress */
+    uint64_t    logical_bytes;      /* Content as callers stored it */
+    uint64_t    stored_bytes;       /* The same after compression */
+    uint64_t    superseded_bytes;   /* Older copies of recompressed objects */
+    uint64_t    physical_bytes;     /* Content region used: headers, padding, trailers */
+    double      amplification;      /* physical_bytes / logical_bytes */
+};
+
+/* Outcome of one geofs_volume_recompress pass */
+struct geofs_recompress_result {
+    uint64_t    examined;
+    uint64_t    rewritten;
+    uint64_t    bytes_before;       /* Stored size of the rewritten objects, before */
+    uint64_t    bytes_after;        /* ...and after */
+};
+
 /* ══════════════════════════════════════════════════════════════════════════════
  * CALLBACK TYPES
  * ══════════════════════════════════════════════════════════════════════════════ */
@@ -90,6 +174,14 @@ typedef void (*geofs_dir_callback)(const struct geofs_dirent *entry, void *ctx);
 typedef void (*geofs_view_callback)(const struct geofs_view_info *info, void *ctx);
 typedef void (*geofs_history_callback)(const struct geofs_history_entry *entry, void *ctx);
 
+/*
+ * Completion of an asynchronous operation. hash and size describe the
+ * content stored or read (size is the bytes read for reads); both are
+ * empty for geofs_volume_sync_async.
+ */
+typedef void (*geofs_async_callback)(geofs_error_t err, const geofs_hash_t hash,
+                                     size_t size, void *ctx);
+
 /* ══════════════════════════════════════════════════════════════════════════════
  * VOLUME OPERATIONS
  * ══════════════════════════════════════════════════════════════════════════════ */
@@ -114,9 +206,68 @@ geofs_error_t geofs_volume_create(const char *path, uint64_t size_mb,
  */
 geofs_error_t geofs_volume_open(const char *path, geofs_volume_t **vol_out);
 
+/*
+ * Switch a volume to mmap mode: the content region is mapped read-only and
+ * geofs_content_map hands out pointers into it instead of copies. Content
+ * stored later is visible through the same mapping. Calling it again is a
+ * no-op.
+ *
+ * @param vol   The volume
+ * @return      GEOFS_OK on success, GEOFS_ERR_IO if the mapping failed
+ */
+geofs_error_t geofs_volume_map(geofs_volume_t *vol);
+
+/*
+ * Choose when staged writes are made durable. Concurrent writers under
+ * GEOFS_SYNC_PER_OP share fdatasync calls: one sync covers every write
+ * staged before it started.
+ *
+ * @param vol           The volume
+ * @param policy        The durability policy
+ * @param interval_ms   Commit interval for GEOFS_SYNC_GROUP, ignored otherwise
+ * @return              GEOFS_OK on success
+ */
+geofs_error_t geofs_volume_set_sync(geofs_volume_t *vol, geofs_sync_policy_t policy,
+                                     unsigned interval_ms);
+
+/*
+ * Write out staged stores and refs and wait until they are durable.
+ *
+ * @param vol   The volume
+ * @return      GEOFS_OK on success, GEOFS_ERR_IO if a write or sync failed
+ */
+geofs_error_t geofs_volume_sync(geofs_volume_t *vol);
+
+/*
+ * Choose the codec for content stored from now on. Existing content keeps
+ * its codec until geofs_volume_recompress rewrites it.
+ *
+ * @return  GEOFS_OK, or GEOFS_ERR_INVALID if the codec isn't built in
+ */
+geofs_error_t geofs_volume_set_codec(geofs_volume_t *vol, geofs_codec_t codec);
+
+/* 1 if codec is built in */
+int geofs_codec_available(geofs_codec_t codec);
+
+/*
+ * Rewrite content that was on disk when the pass started with codec,
+ * wherever that saves 10% over how it is stored now. The rewritten copy
+ * is appended and the index moves to it; the log being append-only, the
+ * old copy stays behind and counts as superseded. Safe to run on a
+ * background thread alongside readers and writers.
+ *
+ * @param vol       The volume
+ * @param codec     Codec to rewrite with, usually GEOFS_CODEC_DEFLATE
+ * @param result    Output, may be NULL
+ * @return          GEOFS_OK on success
+ */
+geofs_error_t geofs_volume_recompress(geofs_volume_t *vol, geofs_codec_t codec,
+                                       struct geofs_recompress_result *result);
+
 /*
  * Close a GeoFS volume.
- * All changes are flushed to disk.
+ * All changes are flushed to disk. Outstanding asynchronous operations are
+ * completed first, and their callbacks run on the closing thread.
  *
  * @param vol   The volume to close
  */
@@ -152,6 +303,28 @@ geofs_error_t geofs_content_store(geofs_volume_t *vol, const void *data,
 geofs_error_t geofs_content_read(geofs_volume_t *vol, const geofs_hash_t hash,
                                   void *buf, size_t buf_size, size_t *size_out);
 
+/*
+ * Get a read-only view of content by hash, without copying it on a mapped
+ * volume (see geofs_volume_map). On an unmapped volume the view is backed
+ * by a private copy. Each view holds a reference on its backing memory and
+ * must be released with geofs_content_unmap.
+ *
+ * @param vol       The volume
+ * @param hash      The content hash
+ * @param view      Output: the view
+ * @return          GEOFS_OK on success, GEOFS_ERR_NOTFOUND if hash not found
+ */
+geofs_error_t geofs_content_map(geofs_volume_t *vol, const geofs_hash_t hash,
+                                 struct geofs_content_view *view);
+
+/*
+ * Release a view from geofs_content_map. The view is cleared; releasing a
+ * cleared view is a no-op.
+ *
+ * @param view      The view
+ */
+void geofs_content_unmap(struct geofs_content_view *view);
+
 /*
  * Get the size of content by hash.
  *
@@ -163,6 +336,103 @@ geofs_error_t geofs_content_read(geofs_volume_t *vol, const geofs_hash_t hash,
 geofs_error_t geofs_content_size(geofs_volume_t *vol, const geofs_hash_t hash,
                                   uint64_t *size_out);
 
+/*
+ * Store a manifest: content made of other stored objects (its chunks), in
+ * order. The manifest is content like any other. Reading, mapping or
+ * sizing its hash gives the chunks' bytes back to back, and a ref may
+ * point at it. Chunks dedup like any other content, so content that is
+ * stored again in chunks costs only its new chunks and a new manifest.
+ *
+ * @param vol       The volume
+ * @param chunks    Hashes of the chunks, each already stored and not itself
+ *                  a manifest
+ * @param count     Number of chunks
+ * @param hash_out  Output: the manifest's hash
+ * @return          GEOFS_OK on success, GEOFS_ERR_NOTFOUND if a chunk isn't
+ *                  stored, GEOFS_ERR_INVALID if a chunk is a manifest
+ */
+geofs_error_t geofs_manifest_store(geofs_volume_t *vol, const geofs_hash_t *chunks,
+                                    size_t count, geofs_hash_t hash_out);
+
+/*
+ * List the chunks of content, so it can be read a chunk at a time with
+ * geofs_content_map. A manifest gives its chunks. Any other object gives
+ * one chunk: itself.
+ *
+ * @param vol        The volume
+ * @param hash       The content hash
+ * @param chunks_out Output: malloc'd array, for the caller to free
+ * @param count_out  Output: number of chunks
+ * @return           GEOFS_OK on success, GEOFS_ERR_NOTFOUND if hash not found
+ */
+geofs_error_t geofs_content_chunks(geofs_volume_t *vol, const geofs_hash_t hash,
+                                    struct geofs_chunk **chunks_out, size_t *count_out);
+
+/* ══════════════════════════════════════════════════════════════════════════════
+ * ASYNCHRONOUS OPERATIONS
+ *
+ * Submissions are queued and handed to the kernel in batches, through
+ * io_uring where the kernel allows it; otherwise each operation runs as a
+ * blocking call when submitted. Either way callbacks only run from
+ * geofs_async_poll and geofs_async_drain, on the calling thread.
+ * ══════════════════════════════════════════════════════════════════════════════ */
+
+/*
+ * Store content without waiting for the write. data must stay valid until
+ * the callback runs; large objects are written straight from it. The
+ * content is readable once the callback reports GEOFS_OK.
+ *
+ * @param vol       The volume
+ * @param data      Pointer to the data to store
+ * @param size      Size of the data
+ * @param callback  Completion, with the content hash
+ * @param ctx       Passed to callback
+ * @return          GEOFS_OK if queued; callback will run exactly once
+ */
+geofs_error_t geofs_content_store_async(geofs_volume_t *vol, const void *data,
+                                         size_t size, geofs_async_callback callback,
+                                         void *ctx);
+
+/*
+ * Read content without waiting. buf must stay valid until the callback runs.
+ *
+ * @param vol       The volume
+ * @param hash      The content hash
+ * @param buf       Buffer to read into
+ * @param buf_size  Size of the buffer
+ * @param callback  Completion, with the bytes read
+ * @param ctx       Passed to callback
+ * @return          GEOFS_OK if queued, GEOFS_ERR_NOTFOUND if hash not found
+ */
+geofs_error_t geofs_content_read_async(geofs_volume_t *vol, const geofs_hash_t hash,
+                                        void *buf, size_t buf_size,
+                                        geofs_async_callback callback, void *ctx);
+
+/*
+ * Make every write submitted so far durable without waiting, like
+ * geofs_volume_sync.
+ */
+geofs_error_t geofs_volume_sync_async(geofs_volume_t *vol,
+                                       geofs_async_callback callback, void *ctx);
+
+/*
+ * Submit queued operations and run callbacks for completed ones, waiting
+ * until at least min_complete have completed (or none are outstanding).
+ *
+ * @return  Number of callbacks run, or a negative geofs_error_t
+ */
+int geofs_async_poll(geofs_volume_t *vol, unsigned min_complete);
+
+/* Wait for every outstanding operation and run its callback */
+geofs_error_t geofs_async_drain(geofs_volume_t *vol);
+
+/* Operations submitted but whose callbacks have not run yet */
+unsigned geofs_async_pending(geofs_volume_t *vol);
+
+/* "io_uring" or "blocking"; the backend is chosen on first use, and
+ * setting GEOFS_NO_IO_URING in the environment forces blocking */
+const char *geofs_async_backend(geofs_volume_t *vol);
+
 /* ══════════════════════════════════════════════════════════════════════════════
  * REFERENCE OPERATIONS (path -> content mapping)
  * ══════════════════════════════════════════════════════════════════════════════ */
@@ -202,6 +472,16 @@ geofs_error_t geofs_ref_resolve(geofs_volume_t *vol, const char *path,
 int geofs_ref_list(geofs_volume_t *vol, const char *dir_path,
                    geofs_dir_callback callback, void *ctx);
 
+/*
+ * A counter that changes whenever a path may have become resolvable: a
+ * new path, one created again after being hidden, or a view switch. A
+ * cached "not found" is still good while it stays the same.
+ *
+ * @param vol   The volume
+ * @return      The current generation
+ */
+uint64_t geofs_ref_generation(geofs_volume_t *vol);
+
 /* ══════════════════════════════════════════════════════════════════════════════
  * VIEW OPERATIONS (geological strata)
  * ══════════════════════════════════════════════════════════════════════════════ */
@@ -272,6 +552,25 @@ geofs_error_t geofs_view_hide(geofs_volume_t *vol, const char *path);
  */
 int geofs_ref_history(geofs_volume_t *vol, geofs_history_callback callback, void *ctx);
 
+/*
+ * Report the sizes and chain lengths of the content and ref hash indices.
+ *
+ * @param vol       The volume
+ * @param stats     Output: index statistics
+ * @return          GEOFS_OK on success
+ */
+geofs_error_t geofs_index_stats(geofs_volume_t *vol, struct geofs_index_stats *stats);
+
+/*
+ * Report how much of the content region stored content takes up, staged
+ * writes included, against the bytes callers stored.
+ *
+ * @param vol       The volume
+ * @param stats     Output: space statistics
+ * @return          GEOFS_OK on success
+ */
+geofs_error_t geofs_space_stats(geofs_volume_t *vol, struct geofs_space_stats *stats);
+
 /* ══════════════════════════════════════════════════════════════════════════════
  * UTILITY FUNCTIONS
  * ══════════════════════════════════════════════════════════════════════════════ */
@@ -6,6 +6,7 @@
  */
 
 #include "ata.h"
+#include "trace.h"
 #include <stdint.h>
 #include <stddef.h>
 
@@ -325,6 +326,8 @@ int ata_drive_count(void)
 
 ata_error_t ata_read_sectors(int drive_idx, uint64_t lba, uint32_t count, void *buffer)
 {
+    TRACE_SCOPE(TRACE_ID_ATA_READ, lba, count, drive_idx);
+
     if (drive_idx < 0 || drive_idx >= ATA_MAX_DRIVES) {
         return ATA_ERR_INVALID;
     }
@@ -403,6 +406,8 @@ ata_error_t ata_read_sectors(int drive_idx, uint64_t lba, uint32_t count, void *
 
 ata_error_t ata_write_sectors(int drive_idx, uint64_t lba, uint32_t count, const void *buffer)
 {
+    TRACE_SCOPE(TRACE_ID_ATA_WRITE, lba, count, drive_idx);
+
     if (drive_idx < 0 || drive_idx >= ATA_MAX_DRIVES) {
         return ATA_ERR_INVALID;
     }
@@ -484,6 +489,8 @@ ata_error_t ata_write_sectors(int drive_idx, uint64_t lba, uint32_t count, const
 
 ata_error_t ata_flush(int drive_idx)
 {
+    TRACE_SCOPE(TRACE_ID_ATA_FLUSH, drive_idx, 0, 0);
+
     if (drive_idx < 0 || drive_idx >= ATA_MAX_DRIVES) {
         return ATA_ERR_INVALID;
     }
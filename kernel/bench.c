@@ -0,0 +1,821 @@
+/*
+ * PhantomOS Kernel Microbenchmarks
+ * "To Create, Not To Destroy"
+ *
+ * Every case is a function that performs `ops` operations and returns the
+ * TSC cycles they took; anything it has to prepare (buffers, stored
+ * content, a partner task) happens outside the timed region. Groups may
+ * have a setup step that builds shared fixtures or reports why the group
+ * cannot run (no framebuffer, out of memory).
+ *
+ * GeoFS cases never touch the shell's volume: they run against scratch
+ * volumes created here and destroyed when the group is done.
+ */
+
+#include "bench.h"
+#include "geofs.h"
+#include "heap.h"
+#include "pmm.h"
+#include "lz4.h"
+#include "framebuffer.h"
+#include "font.h"
+#include "process.h"
+#include "timer.h"
+#include "idt.h"
+#include "io.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/*============================================================================
+ * External Declarations
+ *============================================================================*/
+
+extern int kprintf(const char *fmt, ...);
+extern void *memset(void *s, int c, size_t n);
+extern void *memcpy(void *dest, const void *src, size_t n);
+extern size_t strlen(const char *s);
+extern int strcmp(const char *s1, const char *s2);
+
+/*============================================================================
+ * Constants
+ *============================================================================*/
+
+#define BENCH_BUF_SIZE      65536       /* Largest operation size */
+#define BENCH_OUT_SIZE      (BENCH_BUF_SIZE + BENCH_BUF_SIZE / 255 + 64)
+#define BENCH_RANDOM        (1ULL << 32)    /* arg flag: incompressible data */
+#define BENCH_SIZE(arg)     ((uint32_t)(arg))
+
+#define BENCH_MIX_SLOTS     64          /* Live allocations in the heap mix */
+#define BENCH_PMM_BATCH     64          /* Pages held at once */
+
+#define BENCH_DIR           "/dir"
+#define BENCH_DIR_FILES     1024        /* Entries in the large directory */
+#define BENCH_PATH_LEN      16          /* "/dir/f0000" plus NUL, padded */
+
+#define BENCH_NAME_WIDTH    34
+
+/*============================================================================
+ * State
+ *============================================================================*/
+
+static uint8_t *bench_src;          /* Input data */
+static uint8_t *bench_dst;          /* Copy/decompress target */
+static uint8_t *bench_out;          /* LZ4 output */
+
+static kgeofs_volume_t *bench_vol;  /* Scratch volume with the large dir */
+static char *bench_paths;           /* BENCH_DIR_FILES paths into it */
+
+static struct bench_result bench_results[BENCH_MAX_RESULTS];
+static int bench_nresults;
+
+/*============================================================================
+ * Helpers
+ *============================================================================*/
+
+static uint32_t bench_rand(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/* Text-like data LZ4 compresses well, or xorshift noise it cannot */
+static void bench_fill(uint8_t *buf, uint32_t size, int random)
+{
+    if (random) {
+        uint32_t seed = 0x9E3779B9;
+        for (uint32_t i = 0; i < size; i++)
+            buf[i] = (uint8_t)bench_rand(&seed);
+        return;
+    }
+
+    static const char line[] = "PhantomOS kernel benchmark record 0000\n";
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < size; i++) {
+        uint32_t pos = i % (sizeof(line) - 1);
+        if (pos == 0)
+            n++;
+        if (pos >= 33 && pos < 37) {
+            static const uint32_t div[] = { 1000, 100, 10, 1 };
+            buf[i] = (uint8_t)('0' + (n / div[pos - 33]) % 10);
+        } else {
+            buf[i] = (uint8_t)line[pos];
+        }
+    }
+}
+
+/* Make each stored block distinct so GeoFS dedup doesn't short-circuit */
+static inline void bench_stamp(uint8_t *buf, uint32_t size, uint64_t n)
+{
+    if (size >= sizeof(n))
+        memcpy(buf, &n, sizeof(n));
+    else
+        buf[0] = (uint8_t)n;
+}
+
+static void bench_pad(const char *s, int width)
+{
+    kprintf("%s", s);
+    for (int i = (int)strlen(s); i < width; i++)
+        kprintf(" ");
+}
+
+static char *bench_fmt_uint(char *p, uint64_t v)
+{
+    char tmp[24];
+    int n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n > 0)
+        *p++ = tmp[--n];
+    return p;
+}
+
+/* Tenths as "123.4" */
+static char *bench_fmt_fixed(char *p, uint64_t tenths)
+{
+    p = bench_fmt_uint(p, tenths / 10);
+    *p++ = '.';
+    return bench_fmt_uint(p, tenths % 10);
+}
+
+/* kprintf has no float or left-justify; right-align in width by hand */
+static void bench_print_fixed(uint64_t tenths, int width)
+{
+    char buf[32];
+    char *end = bench_fmt_fixed(buf, tenths);
+    *end = '\0';
+    for (int i = (int)(end - buf); i < width; i++)
+        kprintf(" ");
+    kprintf("%s", buf);
+}
+
+/*============================================================================
+ * Heap and Page Allocator
+ *============================================================================*/
+
+static uint64_t run_kmalloc(uint64_t arg, uint32_t ops)
+{
+    uint64_t start = rdtsc();
+    for (uint32_t i = 0; i < ops; i++) {
+        void *p = kmalloc(BENCH_SIZE(arg));
+        if (!p)
+            return 0;
+        kfree(p);
+    }
+    return rdtsc() - start;
+}
+
+/* Random sizes 16B-2KB, freed in random order with ~32 live at a time */
+static uint64_t run_kmalloc_mix(uint64_t arg, uint32_t ops)
+{
+    (void)arg;
+    void *slots[BENCH_MIX_SLOTS];
+    uint32_t seed = 0x12345678;
+    memset(slots, 0, sizeof(slots));
+
+    uint64_t start = rdtsc();
+    for (uint32_t i = 0; i < ops; i++) {
+        uint32_t r = bench_rand(&seed);
+        void **slot = &slots[r % BENCH_MIX_SLOTS];
+        if (*slot) {
+            kfree(*slot);
+            *slot = NULL;
+        } else {
+            *slot = kmalloc(16u << ((r >> 8) % 8));
+        }
+    }
+    uint64_t cycles = rdtsc() - start;
+
+    for (int i = 0; i < BENCH_MIX_SLOTS; i++)
+        if (slots[i])
+            kfree(slots[i]);
+    return cycles;
+}
+
+/* ops pages allocated and freed, BENCH_PMM_BATCH held at a time */
+static uint64_t run_pmm_page(uint64_t arg, uint32_t ops)
+{
+    (void)arg;
+    void *pages[BENCH_PMM_BATCH];
+    uint64_t cycles = 0;
+
+    for (uint32_t done = 0; done < ops; done += BENCH_PMM_BATCH) {
+        uint32_t n = ops - done < BENCH_PMM_BATCH ? ops - done : BENCH_PMM_BATCH;
+        uint64_t start = rdtsc();
+        for (uint32_t i = 0; i < n; i++) {
+            pages[i] = pmm_alloc_page();
+            if (!pages[i]) {
+                while (i-- > 0)
+                    pmm_free_page(pages[i]);
+                return 0;
+            }
+        }
+        for (uint32_t i = 0; i < n; i++)
+            pmm_free_page(pages[i]);
+        cycles += rdtsc() - start;
+    }
+    return cycles;
+}
+
+/*============================================================================
+ * memcpy / memset
+ *============================================================================*/
+
+static uint64_t run_memcpy(uint64_t arg, uint32_t ops)
+{
+    uint32_t size = BENCH_SIZE(arg);
+    uint64_t start = rdtsc();
+    for (uint32_t i = 0; i < ops; i++)
+        memcpy(bench_dst, bench_src, size);
+    return rdtsc() - start;
+}
+
+static uint64_t run_memset(uint64_t arg, uint32_t ops)
+{
+    uint32_t size = BENCH_SIZE(arg);
+    uint64_t start = rdtsc();
+    for (uint32_t i = 0; i < ops; i++)
+        memset(bench_dst, (int)i, size);
+    return rdtsc() - start;
+}
+
+/*============================================================================
+ * GeoFS
+ *============================================================================*/
+
+static int geofs_setup(void)
+{
+    if (kgeofs_volume_create(512, 256, 0, &bench_vol) != KGEOFS_OK)
+        return -1;
+
+    bench_paths = (char *)kmalloc(BENCH_DIR_FILES * BENCH_PATH_LEN);
+    if (!bench_paths || kgeofs_mkdir(bench_vol, BENCH_DIR) != KGEOFS_OK)
+        goto fail;
+
+    /* One small file per entry; identical content is stored once */
+    bench_fill(bench_src, 64, 0);
+    for (uint32_t i = 0; i < BENCH_DIR_FILES; i++) {
+        char *p = bench_paths + i * BENCH_PATH_LEN;
+        memcpy(p, BENCH_DIR "/f", 6);
+        p[6] = (char)('0' + (i / 1000) % 10);
+        p[7] = (char)('0' + (i / 100) % 10);
+        p[8] = (char)('0' + (i / 10) % 10);
+        p[9] = (char)('0' + i % 10);
+        p[10] = '\0';
+        if (kgeofs_file_write(bench_vol, p, bench_src, 64) != KGEOFS_OK)
+            goto fail;
+    }
+    return 0;
+
+fail:
+    if (bench_paths)
+        kfree(bench_paths);
+    bench_paths = NULL;
+    kgeofs_volume_destroy(bench_vol);
+    bench_vol = NULL;
+    return -1;
+}
+
+static void geofs_teardown(void)
+{
+    kfree(bench_paths);
+    bench_paths = NULL;
+    kgeofs_volume_destroy(bench_vol);
+    bench_vol = NULL;
+}
+
+/* Each pass stores into a fresh volume so passes don't fill the region */
+static uint64_t run_geofs_store(uint64_t arg, uint32_t ops)
+{
+    uint32_t size = BENCH_SIZE(arg);
+    kgeofs_volume_t *vol;
+    kgeofs_hash_t hash;
+
+    if (kgeofs_volume_create(512, 0, 0, &vol) != KGEOFS_OK)
+        return 0;
+    bench_fill(bench_src, size, (arg & BENCH_RANDOM) != 0);
+
+    uint64_t cycles = 0;
+    for (uint32_t i = 0; i < ops; i++) {
+        bench_stamp(bench_src, size, i);
+        uint64_t start = rdtsc();
+        kgeofs_error_t err = kgeofs_content_store(vol, bench_src, size, hash);
+        cycles += rdtsc() - start;
+        if (err != KGEOFS_OK) {
+            cycles = 0;
+            break;
+        }
+    }
+
+    kgeofs_volume_destroy(vol);
+    return cycles;
+}
+
+static uint64_t run_geofs_read(uint64_t arg, uint32_t ops)
+{
+    uint32_t size = BENCH_SIZE(arg);
+    kgeofs_hash_t hash;
+    size_t got;
+
+    bench_fill(bench_src, size, (arg & BENCH_RANDOM) != 0);
+    if (kgeofs_content_store(bench_vol, bench_src, size, hash) != KGEOFS_OK)
+        return 0;
+
+    uint64_t start = rdtsc();
+    for (uint32_t i = 0; i < ops; i++)
+        if (kgeofs_content_read(bench_vol, hash, bench_dst, BENCH_BUF_SIZE,
+                                &got) != KGEOFS_OK)
+            return 0;
+    return rdtsc() - start;
+}
+
+static uint64_t run_geofs_resolve(uint64_t arg, uint32_t ops)
+{
+    (void)arg;
+    kgeofs_hash_t hash;
+
+    uint64_t start = rdtsc();
+    for (uint32_t i = 0; i < ops; i++) {
+        const char *path = bench_paths + (i % BENCH_DIR_FILES) * BENCH_PATH_LEN;
+        if (kgeofs_ref_resolve(bench_vol, path, hash) != KGEOFS_OK)
+            return 0;
+    }
+    return rdtsc() - start;
+}
+
+static int count_entry(const struct kgeofs_dirent *entry, void *ctx)
+{
+    (void)entry;
+    (*(uint32_t *)ctx)++;
+    return 0;
+}
+
+static uint64_t run_geofs_list(uint64_t arg, uint32_t ops)
+{
+    (void)arg;
+    uint32_t seen = 0;
+
+    uint64_t start = rdtsc();
+    for (uint32_t i = 0; i < ops; i++)
+        kgeofs_ref_list(bench_vol, BENCH_DIR, count_entry, &seen);
+    uint64_t cycles = rdtsc() - start;
+
+    return seen >= ops * BENCH_DIR_FILES ? cycles : 0;
+}
+
+/*============================================================================
+ * LZ4 and SHA-256
+ *============================================================================*/
+
+static uint64_t run_lz4_compress(uint64_t arg, uint32_t ops)
+{
+    uint32_t size = BENCH_SIZE(arg);
+    size_t len;
+
+    bench_fill(bench_src, size, (arg & BENCH_RANDOM) != 0);
+
+    uint64_t start = rdtsc();
+    for (uint32_t i = 0; i < ops; i++)
+        if (lz4_compress(bench_src, size, bench_out, BENCH_OUT_SIZE, &len) != 0)
+            return 0;
+    return rdtsc() - start;
+}
+
+static uint64_t run_lz4_decompress(uint64_t arg, uint32_t ops)
+{
+    uint32_t size = BENCH_SIZE(arg);
+    size_t clen, len;
+
+    bench_fill(bench_src, size, (arg & BENCH_RANDOM) != 0);
+    if (lz4_compress(bench_src, size, bench_out, BENCH_OUT_SIZE, &clen) != 0)
+        return 0;
+
+    uint64_t start = rdtsc();
+    for (uint32_t i = 0; i < ops; i++)
+        if (lz4_decompress(bench_out, clen, bench_dst, BENCH_BUF_SIZE, &len) != 0)
+            return 0;
+    return rdtsc() - start;
+}
+
+static uint64_t run_sha256(uint64_t arg, uint32_t ops)
+{
+    uint32_t size = BENCH_SIZE(arg);
+    kgeofs_hash_t hash;
+
+    bench_fill(bench_src, size, 1);
+
+    uint64_t start = rdtsc();
+    for (uint32_t i = 0; i < ops; i++)
+        kgeofs_hash_compute(bench_src, size, hash);
+    return rdtsc() - start;
+}
+
+/*============================================================================
+ * Framebuffer
+ *
+ * Draws into the top-left corner of the back buffer; the desktop repaints
+ * over it on its next frame.
+ *============================================================================*/
+
+static int fb_setup(void)
+{
+    return fb_is_initialized() ? 0 : -1;
+}
+
+/* arg is the square's side in pixels, 0 for the whole screen */
+static uint64_t run_fb_fill(uint64_t arg, uint32_t ops)
+{
+    const struct framebuffer_info *info = fb_get_info();
+    uint32_t w = arg ? BENCH_SIZE(arg) : info->width;
+    uint32_t h = arg ? BENCH_SIZE(arg) : info->height;
+
+    uint64_t start = rdtsc();
+    for (uint32_t i = 0; i < ops; i++)
+        fb_fill_rect(0, 0, w, h, (i & 1) ? 0x00202020 : 0x00404040);
+    return rdtsc() - start;
+}
+
+static uint64_t run_font_string(uint64_t arg, uint32_t ops)
+{
+    (void)arg;
+    static const char text[] = "To Create, Not To Destroy 012345";
+
+    uint64_t start = rdtsc();
+    for (uint32_t i = 0; i < ops; i++)
+        font_draw_string(0, 0, text, 0x00FFFFFF, 0x00000000);
+    return rdtsc() - start;
+}
+
+static uint64_t run_fb_flip(uint64_t arg, uint32_t ops)
+{
+    (void)arg;
+    uint64_t start = rdtsc();
+    for (uint32_t i = 0; i < ops; i++)
+        fb_flip();
+    return rdtsc() - start;
+}
+
+/*============================================================================
+ * Scheduler
+ *
+ * Ping-pong between the calling task and a partner: each round trip is
+ * two wakeups and two context switches.
+ *============================================================================*/
+
+static volatile int pp_turn;        /* 0: caller runs, 1: partner runs */
+static volatile int pp_stop;
+static struct process *pp_caller;
+static struct process *pp_partner;
+
+static void pp_wait(int turn)
+{
+    for (;;) {
+        uint64_t flags = irq_save();
+        if (pp_turn == turn) {
+            irq_restore(flags);
+            return;
+        }
+        process_block();
+    }
+}
+
+static void pp_partner_main(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        pp_wait(1);
+        int stop = pp_stop;
+        pp_turn = 0;
+        process_unblock(pp_caller);
+        if (stop)
+            return;
+    }
+}
+
+static uint64_t run_pingpong(uint64_t arg, uint32_t ops)
+{
+    (void)arg;
+    pp_caller = sched_current();
+    if (!pp_caller)
+        return 0;
+
+    pp_turn = 0;
+    pp_stop = 0;
+    pid_t pid = process_create("bench-pong", pp_partner_main, NULL);
+    if (pid == PID_INVALID)
+        return 0;
+    pp_partner = process_get(pid);
+
+    uint64_t start = rdtsc();
+    for (uint32_t i = 0; i < ops; i++) {
+        pp_turn = 1;
+        process_unblock(pp_partner);
+        pp_wait(0);
+    }
+    uint64_t cycles = rdtsc() - start;
+
+    pp_stop = 1;
+    pp_turn = 1;
+    process_unblock(pp_partner);
+    pp_wait(0);
+    return cycles;
+}
+
+static uint64_t run_yield(uint64_t arg, uint32_t ops)
+{
+    (void)arg;
+    uint64_t start = rdtsc();
+    for (uint32_t i = 0; i < ops; i++)
+        sched_yield();
+    return rdtsc() - start;
+}
+
+/*============================================================================
+ * Tables
+ *============================================================================*/
+
+struct bench_group {
+    const char *name;
+    const char *description;
+    int       (*setup)(void);       /* Non-zero skips the group */
+    void      (*teardown)(void);
+    const char *skip_reason;
+};
+
+struct bench_case {
+    const char *group;
+    const char *name;
+    uint64_t  (*run)(uint64_t arg, uint32_t ops);  /* Cycles, 0 on failure */
+    uint64_t    arg;
+    uint32_t    ops;
+};
+
+static const struct bench_group bench_groups[] = {
+    { "heap",  "kmalloc/kfree and pmm pages", NULL, NULL, NULL },
+    { "mem",   "memcpy and memset",           NULL, NULL, NULL },
+    { "geofs", "GeoFS content and refs",      geofs_setup, geofs_teardown,
+      "could not create scratch volume" },
+    { "lz4",   "LZ4 block codec",             NULL, NULL, NULL },
+    { "hash",  "SHA-256",                     NULL, NULL, NULL },
+    { "fb",    "Framebuffer and font",        fb_setup, NULL,
+      "no framebuffer" },
+    { "sched", "Context switches",            NULL, NULL, NULL },
+};
+
+#define BENCH_GROUP_COUNT (int)(sizeof(bench_groups) / sizeof(bench_groups[0]))
+
+static const struct bench_case bench_cases[] = {
+    { "heap",  "kmalloc+kfree 32B",          run_kmalloc,      32,     20000 },
+    { "heap",  "kmalloc+kfree 4K",           run_kmalloc,      4096,   5000 },
+    { "heap",  "kmalloc/kfree random mix",   run_kmalloc_mix,  0,      20000 },
+    { "heap",  "pmm_alloc_page+free",        run_pmm_page,     0,      4096 },
+
+    { "mem",   "memcpy 64B",                 run_memcpy,       64,     20000 },
+    { "mem",   "memcpy 1K",                  run_memcpy,       1024,   10000 },
+    { "mem",   "memcpy 4K",                  run_memcpy,       4096,   4000 },
+    { "mem",   "memcpy 64K",                 run_memcpy,       65536,  256 },
+    { "mem",   "memset 64B",                 run_memset,       64,     20000 },
+    { "mem",   "memset 1K",                  run_memset,       1024,   10000 },
+    { "mem",   "memset 4K",                  run_memset,       4096,   4000 },
+    { "mem",   "memset 64K",                 run_memset,       65536,  256 },
+
+    { "geofs", "store 64B text",             run_geofs_store,  64,     1024 },
+    { "geofs", "store 1K text",              run_geofs_store,  1024,   512 },
+    { "geofs", "store 4K text",              run_geofs_store,  4096,   256 },
+    { "geofs", "store 64K text",             run_geofs_store,  65536,  32 },
+    { "geofs", "store 1K random",            run_geofs_store,  BENCH_RANDOM | 1024,  512 },
+    { "geofs", "store 4K random",            run_geofs_store,  BENCH_RANDOM | 4096,  128 },
+    { "geofs", "store 64K random",           run_geofs_store,  BENCH_RANDOM | 65536, 16 },
+    { "geofs", "read 4K text",               run_geofs_read,   4096,   1024 },
+    { "geofs", "read 64K text",              run_geofs_read,   65536,  64 },
+    { "geofs", "read 4K random",             run_geofs_read,   BENCH_RANDOM | 4096,  1024 },
+    { "geofs", "read 64K random",            run_geofs_read,   BENCH_RANDOM | 65536, 64 },
+    { "geofs", "ref_resolve (1024 entries)", run_geofs_resolve, 0,     2048 },
+    { "geofs", "ref_list (1024 entries)",    run_geofs_list,   0,      8 },
+
+    { "lz4",   "compress 4K text",           run_lz4_compress, 4096,   1000 },
+    { "lz4",   "compress 64K text",          run_lz4_compress, 65536,  64 },
+    { "lz4",   "compress 4K random",         run_lz4_compress, BENCH_RANDOM | 4096,  1000 },
+    { "lz4",   "compress 64K random",        run_lz4_compress, BENCH_RANDOM | 65536, 64 },
+    { "lz4",   "decompress 4K text",         run_lz4_decompress, 4096,  2000 },
+    { "lz4",   "decompress 64K text",        run_lz4_decompress, 65536, 128 },
+    { "lz4",   "decompress 64K random",      run_lz4_decompress, BENCH_RANDOM | 65536, 128 },
+
+    { "hash",  "sha256 64B",                 run_sha256,       64,     10000 },
+    { "hash",  "sha256 4K",                  run_sha256,       4096,   500 },
+    { "hash",  "sha256 64K",                 run_sha256,       65536,  32 },
+
+    { "fb",    "fill_rect 64x64",            run_fb_fill,      64,     2000 },
+    { "fb",    "fill_rect full screen",      run_fb_fill,      0,      32 },
+    { "fb",    "font_draw_string 32 chars",  run_font_string,  0,      2000 },
+    { "fb",    "fb_flip",                    run_fb_flip,      0,      32 },
+
+    { "sched", "ping-pong round trip",       run_pingpong,     0,      5000 },
+    { "sched", "sched_yield",                run_yield,        0,      20000 },
+};
+
+#define BENCH_CASE_COUNT (int)(sizeof(bench_cases) / sizeof(bench_cases[0]))
+
+static const struct bench_group *find_group(const char *name)
+{
+    for (int i = 0; i < BENCH_GROUP_COUNT; i++)
+        if (strcmp(bench_groups[i].name, name) == 0)
+            return &bench_groups[i];
+    return NULL;
+}
+
+/*============================================================================
+ * Running
+ *============================================================================*/
+
+static void run_case(const struct bench_case *c)
+{
+    kprintf("  ");
+    bench_pad(c->group, 6);
+    bench_pad(c->name, BENCH_NAME_WIDTH);
+
+    /* Warm-up pass: caches, TLB, lazily grown heap */
+    if (c->run(c->arg, c->ops) == 0) {
+        kprintf("   failed\n");
+        return;
+    }
+
+    uint64_t min = ~0ULL, total = 0;
+    for (int s = 0; s < BENCH_SAMPLES; s++) {
+        uint64_t cycles = c->run(c->arg, c->ops);
+        if (cycles == 0) {
+            kprintf("   failed\n");
+            return;
+        }
+        if (cycles < min)
+            min = cycles;
+        total += cycles;
+    }
+
+    uint64_t ns10 = timer_tsc_to_ns(min * 10 / c->ops);
+    bench_print_fixed(min * 10 / c->ops, 12);
+    bench_print_fixed(total * 10 / ((uint64_t)c->ops * BENCH_SAMPLES), 12);
+    bench_print_fixed(ns10, 11);
+    kprintf("\n");
+
+    if (bench_nresults < BENCH_MAX_RESULTS) {
+        struct bench_result *r = &bench_results[bench_nresults++];
+        r->group = c->group;
+        r->name = c->name;
+        r->ops = c->ops;
+        r->min_cycles = min;
+        r->total_cycles = total;
+    }
+}
+
+static void run_group(const struct bench_group *g)
+{
+    if (g->setup && g->setup() != 0) {
+        kprintf("  ");
+        bench_pad(g->name, 6);
+        kprintf("skipped: %s\n", g->skip_reason);
+        return;
+    }
+
+    for (int i = 0; i < BENCH_CASE_COUNT; i++)
+        if (strcmp(bench_cases[i].group, g->name) == 0)
+            run_case(&bench_cases[i]);
+
+    if (g->teardown)
+        g->teardown();
+}
+
+int bench_run(const char *group)
+{
+    const struct bench_group *only = NULL;
+    if (group) {
+        only = find_group(group);
+        if (!only)
+            return -1;
+    }
+
+    bench_src = (uint8_t *)kmalloc(BENCH_BUF_SIZE);
+    bench_dst = (uint8_t *)kmalloc(BENCH_BUF_SIZE);
+    bench_out = (uint8_t *)kmalloc(BENCH_OUT_SIZE);
+
+    int before = bench_nresults;
+    if (bench_src && bench_dst && bench_out) {
+        kprintf("  ");
+        bench_pad("", 6);
+        bench_pad("case", BENCH_NAME_WIDTH);
+        kprintf("  min cyc/op  avg cyc/op      ns/op\n");
+
+        for (int i = 0; i < BENCH_GROUP_COUNT; i++)
+            if (!only || only == &bench_groups[i])
+                run_group(&bench_groups[i]);
+    } else {
+        kprintf("bench: out of memory for buffers\n");
+    }
+
+    if (bench_src) kfree(bench_src);
+    if (bench_dst) kfree(bench_dst);
+    if (bench_out) kfree(bench_out);
+    bench_src = bench_dst = bench_out = NULL;
+
+    return bench_nresults - before;
+}
+
+void bench_list(void)
+{
+    for (int g = 0; g < BENCH_GROUP_COUNT; g++) {
+        kprintf("%s - %s\n", bench_groups[g].name, bench_groups[g].description);
+        for (int i = 0; i < BENCH_CASE_COUNT; i++)
+            if (strcmp(bench_cases[i].group, bench_groups[g].name) == 0)
+                kprintf("    %s (%u ops)\n", bench_cases[i].name,
+                        bench_cases[i].ops);
+    }
+}
+
+void bench_reset(void)
+{
+    bench_nresults = 0;
+}
+
+int bench_result_count(void)
+{
+    return bench_nresults;
+}
+
+const struct bench_result *bench_get_result(int idx)
+{
+    if (idx < 0 || idx >= bench_nresults)
+        return NULL;
+    return &bench_results[idx];
+}
+
+/*============================================================================
+ * CSV Export
+ *============================================================================*/
+
+static char *csv_str(char *p, const char *s)
+{
+    while (*s)
+        *p++ = *s++;
+    return p;
+}
+
+int bench_save(struct kgeofs_volume *vol, const char *path)
+{
+    if (!vol || !path || bench_nresults == 0)
+        return -1;
+
+    /* Names are short literals; 160 bytes covers any row */
+    size_t size = 128 + (size_t)bench_nresults * 160;
+    char *buf = (char *)kmalloc(size);
+    if (!buf)
+        return -1;
+
+    char *p = csv_str(buf, "group,case,ops,min_cycles_per_op,"
+                           "avg_cycles_per_op,min_ns_per_op,tsc_khz\n");
+    for (int i = 0; i < bench_nresults; i++) {
+        const struct bench_result *r = &bench_results[i];
+        uint64_t min10 = r->min_cycles * 10 / r->ops;
+        p = csv_str(p, r->group);
+        *p++ = ',';
+        p = csv_str(p, r->name);
+        *p++ = ',';
+        p = bench_fmt_uint(p, r->ops);
+        *p++ = ',';
+        p = bench_fmt_fixed(p, min10);
+        *p++ = ',';
+        p = bench_fmt_fixed(p, r->total_cycles * 10 /
+                         ((uint64_t)r->ops * BENCH_SAMPLES));
+        *p++ = ',';
+        p = bench_fmt_fixed(p, timer_tsc_to_ns(min10));
+        *p++ = ',';
+        p = bench_fmt_uint(p, timer_tsc_khz());
+        *p++ = '\n';
+    }
+
+    /* Create the parent directory if the path has one */
+    char dir[128];
+    size_t len = strlen(path);
+    size_t slash = 0;
+    for (size_t i = 0; i < len && i < sizeof(dir) - 1; i++)
+        if (path[i] == '/') slash = i;
+    if (slash > 0) {
+        memcpy(dir, path, slash);
+        dir[slash] = '\0';
+        kgeofs_mkdir(vol, dir);
+    }
+
+    kgeofs_error_t err = kgeofs_file_write(vol, path, buf, (size_t)(p - buf));
+    kfree(buf);
+
+    if (err != KGEOFS_OK)
+        return -1;
+
+    kprintf("Bench: wrote %d results to %s\n", bench_nresults, path);
+    return 0;
+}
@@ -0,0 +1,56 @@
+/*
+ * PhantomOS Kernel Microbenchmarks
+ * "To Create, Not To Destroy"
+ *
+ * A table of small, self-contained benchmarks over the kernel's hot paths
+ * (heap, page allocator, memcpy/memset, GeoFS, LZ4, SHA-256, framebuffer
+ * drawing, context switches), run from the shell with `bench`. Each case
+ * is timed with RDTSC over a fixed number of operations: one warm-up pass,
+ * then BENCH_SAMPLES timed passes, reporting the best and the mean cycles
+ * per operation.
+ *
+ * Results of the last run can be written to GeoFS as CSV. Because GeoFS
+ * keeps every version of a file, saving to the same path after each change
+ * builds a history that can be compared run against run.
+ */
+
+#ifndef PHANTOMOS_BENCH_H
+#define PHANTOMOS_BENCH_H
+
+#include <stdint.h>
+
+struct kgeofs_volume;
+
+#define BENCH_SAMPLES       5           /* Timed passes per case */
+#define BENCH_MAX_RESULTS   64
+#define BENCH_DEFAULT_PATH  "/bench/results.csv"
+
+struct bench_result {
+    const char *group;
+    const char *name;
+    uint32_t    ops;            /* Operations per pass */
+    uint64_t    min_cycles;     /* Fastest pass */
+    uint64_t    total_cycles;   /* All BENCH_SAMPLES passes */
+};
+
+/* Print the groups and their cases */
+void bench_list(void);
+
+/*
+ * Run every case in a group (NULL runs all groups), printing a line per
+ * case and appending to the result table. Returns the number of cases run,
+ * or -1 if the group does not exist.
+ */
+int bench_run(const char *group);
+
+/* Forget results from earlier runs */
+void bench_reset(void);
+
+/* Results recorded since the last reset */
+int bench_result_count(void);
+const struct bench_result *bench_get_result(int idx);
+
+/* Write the results as CSV to a GeoFS file. 0 on success */
+int bench_save(struct kgeofs_volume *vol, const char *path);
+
+#endif /* PHANTOMOS_BENCH_H */
@@ -13,6 +13,7 @@
 #include "icons.h"
 #include "framebuffer.h"
 #include "graphics.h"
+#include "pixel.h"
 #include "font.h"
 #include "wm.h"
 #include "widgets.h"
@@ -30,12 +31,17 @@
 #include "pci.h"
 #include "usb.h"
 #include "usb_hid.h"
+#include "xhci.h"
 #include "acpi.h"
 #include "vm_detect.h"
 #include "virtio_net.h"
+#include "netstack.h"
 #include "ata.h"
+#include "kinit.h"
 #include "virtio_console.h"
 #include "io.h"
+#include "frameprof.h"
+#include "input.h"
 #include <stdint.h>
 #include <stddef.h>
 
@@ -292,12 +298,19 @@ static struct {
 /* Canvas dimensions */
 #define ARTOS_CANVAS_W      400
 #define ARTOS_CANVAS_H      300
-#define ARTOS_MAX_UNDO      10
+#define ARTOS_MAX_UNDO      10      /* Undo steps kept per layer */
 #define ARTOS_MAX_LAYERS    4
 #define ARTOS_PALETTE_COUNT 16
 #define ARTOS_MAX_POLY_VERTS 32
 #define ARTOS_MAX_BRUSH     10
 #define ARTOS_MAX_OPACITY   255
+
+/* Canvas tiles: undo saves, and compositing redoes, only touched tiles */
+#define ARTOS_TILE_SIZE     64
+#define ARTOS_TILES_X       ((ARTOS_CANVAS_W + ARTOS_TILE_SIZE - 1) / ARTOS_TILE_SIZE)
+#define ARTOS_TILES_Y       ((ARTOS_CANVAS_H + ARTOS_TILE_SIZE - 1) / ARTOS_TILE_SIZE)
+#define ARTOS_TILES         (ARTOS_TILES_X * ARTOS_TILES_Y)
+#define ARTOS_UNDO_TILE_BUDGET 128  /* Saved tiles across all layers (~2MB) */
 #define ARTOS_OPACITY_STEP  16
 
 /* Layout constants — v4 sidebar layout */
@@ -386,19 +399,40 @@ struct artos_layer {
     char        name[8];    /* "Layer 1" etc */
 };
 
+/*
+ * One undo step: the pre-stroke contents of every tile the stroke
+ * touched. Tiles are copied on first write (see artos_canvas_touch).
+ */
+/* Per-layer tile contents, cached between strokes */
+#define ARTOS_TILE_UNKNOWN  0       /* Written since last classified */
+#define ARTOS_TILE_CLEAR    1       /* Every pixel alpha 0 */
+#define ARTOS_TILE_OPAQUE   2       /* Every pixel alpha 255 */
+#define ARTOS_TILE_MIXED    3
+
+struct artos_undo_rec {
+    uint32_t   *tiles[ARTOS_TILES];     /* NULL = tile untouched */
+    uint32_t    seq;                    /* Push order, for eviction */
+    int         ntiles;
+};
+
 static struct {
     /* Layer stack */
     struct artos_layer layers[ARTOS_MAX_LAYERS];
     int         active_layer;
     int         layer_count;        /* 1-4 */
 
-    /* Composite canvas (flattened for display) */
+    /* Composite canvas (flattened for display), rebuilt per dirty tile */
     uint32_t    composite[ARTOS_CANVAS_W * ARTOS_CANVAS_H];
+    uint8_t     comp_dirty[ARTOS_TILES];
+    uint8_t     tile_class[ARTOS_MAX_LAYERS][ARTOS_TILES];  /* ARTOS_TILE_* */
 
-    /* Undo stack: snapshots of active layer only */
-    uint32_t    undo[ARTOS_MAX_UNDO][ARTOS_CANVAS_W * ARTOS_CANVAS_H];
-    int         undo_count;
-    int         undo_pos;
+    /* Undo: per-layer rings of tile deltas, kept across layer switches */
+    struct artos_undo_rec undo[ARTOS_MAX_LAYERS][ARTOS_MAX_UNDO];
+    int         undo_count[ARTOS_MAX_LAYERS];
+    int         undo_pos[ARTOS_MAX_LAYERS];
+    int         undo_open;          /* Newest record of active layer collects writes */
+    uint32_t    undo_seq;
+    int         undo_tiles;         /* Saved tiles, all layers */
 
     /* Current tool and colors */
     int         tool;
@@ -411,7 +445,6 @@ static struct {
     int         drawing;
     int         start_cx, start_cy;
     int         last_cx, last_cy;
-    uint32_t    shape_save[ARTOS_CANVAS_W * ARTOS_CANVAS_H];
 
     /* Zoom and pan */
     int         zoom;               /* 1, 2, or 3 */
@@ -5985,21 +6018,109 @@ static void rgb_to_hsv(uint32_t color, int *oh, int *os, int *ov)
 }
 
 /* --- Layer compositing --- */
-static void artos_composite_layers(void)
+static void artos_tile_bounds(int t, int *x0, int *y0, int *w, int *h)
 {
-    int npix = ARTOS_CANVAS_W * ARTOS_CANVAS_H;
-    for (int i = 0; i < npix; i++) art.composite[i] = 0xFFFFFFFF; /* white bg */
-    for (int l = 0; l < art.layer_count; l++) {
-        if (!art.layers[l].visible) continue;
+    *x0 = (t % ARTOS_TILES_X) * ARTOS_TILE_SIZE;
+    *y0 = (t / ARTOS_TILES_X) * ARTOS_TILE_SIZE;
+    *w = (*x0 + ARTOS_TILE_SIZE > ARTOS_CANVAS_W) ? ARTOS_CANVAS_W - *x0 : ARTOS_TILE_SIZE;
+    *h = (*y0 + ARTOS_TILE_SIZE > ARTOS_CANVAS_H) ? ARTOS_CANVAS_H - *y0 : ARTOS_TILE_SIZE;
+}
+
+/* Tile t of the active layer changed */
+static inline void artos_tile_dirty(int t)
+{
+    art.tile_class[art.active_layer][t] = ARTOS_TILE_UNKNOWN;
+    art.comp_dirty[t] = 1;
+}
+
+/* Layer visibility or opacity changed: recomposite every tile */
+static void artos_composite_invalidate(void)
+{
+    memset(art.comp_dirty, 1, sizeof(art.comp_dirty));
+}
+
+/* Layer l was rewritten wholesale */
+static void artos_layer_invalidate(int l)
+{
+    memset(art.tile_class[l], ARTOS_TILE_UNKNOWN, sizeof(art.tile_class[l]));
+    artos_composite_invalidate();
+}
+
+static int artos_tile_classify(int l, int t)
+{
+    int x0, y0, w, h;
+    uint32_t and_a = 0xFF, or_a = 0;
+
+    artos_tile_bounds(t, &x0, &y0, &w, &h);
+    for (int row = 0; row < h; row++) {
+        const uint32_t *px = &art.layers[l].pixels[(y0 + row) * ARTOS_CANVAS_W + x0];
+        for (int i = 0; i < w; i++) {
+            uint32_t a = px[i] >> 24;
+            and_a &= a;
+            or_a |= a;
+        }
+    }
+    if (or_a == 0) return ARTOS_TILE_CLEAR;
+    if (and_a == 0xFF) return ARTOS_TILE_OPAQUE;
+    return ARTOS_TILE_MIXED;
+}
+
+static void artos_composite_tile(int t)
+{
+    int x0, y0, w, h;
+    int base = -1;
+
+    artos_tile_bounds(t, &x0, &y0, &w, &h);
+
+    for (int l = 0; l < art.layer_count; l++)
+        if (art.tile_class[l][t] == ARTOS_TILE_UNKNOWN)
+            art.tile_class[l][t] = (uint8_t)artos_tile_classify(l, t);
+
+    /* Everything under the topmost fully opaque layer is hidden */
+    for (int l = art.layer_count - 1; l >= 0; l--) {
+        if (art.layers[l].visible && art.layers[l].opacity == 255 &&
+            art.tile_class[l][t] == ARTOS_TILE_OPAQUE) {
+            base = l;
+            break;
+        }
+    }
+
+    for (int row = 0; row < h; row++) {
+        uint32_t *dst = &art.composite[(y0 + row) * ARTOS_CANVAS_W + x0];
+        if (base >= 0)
+            memcpy(dst, &art.layers[base].pixels[(y0 + row) * ARTOS_CANVAS_W + x0],
+                   sizeof(uint32_t) * w);
+        else
+            px_fill(dst, (uint32_t)w, 0xFFFFFFFF); /* white bg */
+    }
+
+    for (int l = base + 1; l < art.layer_count; l++) {
         uint8_t lop = art.layers[l].opacity;
-        for (int i = 0; i < npix; i++) {
-            uint32_t src = art.layers[l].pixels[i];
-            uint8_t sa = (src >> 24) & 0xFF;
-            int ea = (sa * lop) / 255;
-            if (ea >= 255) art.composite[i] = src | 0xFF000000;
-            else if (ea > 0) art.composite[i] = gfx_alpha_blend(src | 0xFF000000, art.composite[i], (uint8_t)ea);
+        if (!art.layers[l].visible || lop == 0 ||
+            art.tile_class[l][t] == ARTOS_TILE_CLEAR)
+            continue;
+        for (int row = 0; row < h; row++) {
+            int off = (y0 + row) * ARTOS_CANVAS_W + x0;
+            const uint32_t *src_row = &art.layers[l].pixels[off];
+            uint32_t *dst = &art.composite[off];
+            for (int i = 0; i < w; i++) {
+                uint32_t src = src_row[i];
+                uint8_t sa = (src >> 24) & 0xFF;
+                int ea = (sa * lop) / 255;
+                if (ea >= 255) dst[i] = src | 0xFF000000;
+                else if (ea > 0) dst[i] = gfx_alpha_blend(src | 0xFF000000, dst[i], (uint8_t)ea);
+            }
         }
     }
+    art.comp_dirty[t] = 0;
+}
+
+/* Bring art.composite up to date; only dirty tiles are redone */
+static void artos_composite_layers(void)
+{
+    for (int t = 0; t < ARTOS_TILES; t++)
+        if (art.comp_dirty[t])
+            artos_composite_tile(t);
 }
 
 /* --- BMP Export (canvas → ATA disk + GeoFS) --- */
@@ -6035,7 +6156,8 @@ static void artos_export_bmp(void)
     hdr[38] = 0x13; hdr[39] = 0x0B; /* 2835 ppm (72 DPI) */
     hdr[42] = 0x13; hdr[43] = 0x0B;
 
-    int has_disk = (ata_drive_count() >= 1);
+    /* The ATA probe runs as a deferred init step */
+    int has_disk = kinit_is_done("ata") && ata_drive_count() >= 1;
     int error = 0;
 
     /* --- ATA: sector-by-sector write (avoids large kmalloc) --- */
@@ -6116,56 +6238,189 @@ static void artos_export_bmp(void)
             art.export_status, ARTOS_BMP_ATA_SECTOR, ARTOS_BMP_ATA_COUNT);
 }
 
-/* --- Canvas access (operates on active layer) --- */
-static void artos_canvas_set(int cx, int cy, uint32_t color)
+/* --- Undo (tile deltas, per layer) --- */
+/* Copy tile t between a layer and a packed tile buffer */
+static void artos_tile_copy(uint32_t *layer_px, uint32_t *tile, int t, int to_layer)
 {
-    if (cx >= 0 && cx < ARTOS_CANVAS_W && cy >= 0 && cy < ARTOS_CANVAS_H)
-        art.layers[art.active_layer].pixels[cy * ARTOS_CANVAS_W + cx] = color;
+    int x0, y0, w, h;
+    artos_tile_bounds(t, &x0, &y0, &w, &h);
+    for (int row = 0; row < h; row++) {
+        uint32_t *lp = &layer_px[(y0 + row) * ARTOS_CANVAS_W + x0];
+        if (to_layer)
+            memcpy(lp, &tile[row * w], sizeof(uint32_t) * w);
+        else
+            memcpy(&tile[row * w], lp, sizeof(uint32_t) * w);
+    }
 }
 
-static void artos_canvas_set_opacity(int cx, int cy, uint32_t color, int opacity)
+static void artos_undo_free_rec(struct artos_undo_rec *r)
 {
-    if (cx < 0 || cx >= ARTOS_CANVAS_W || cy < 0 || cy >= ARTOS_CANVAS_H) return;
-    if (opacity >= 255) {
-        art.layers[art.active_layer].pixels[cy * ARTOS_CANVAS_W + cx] = color;
-    } else if (opacity > 0) {
-        uint32_t ex = art.layers[art.active_layer].pixels[cy * ARTOS_CANVAS_W + cx];
-        art.layers[art.active_layer].pixels[cy * ARTOS_CANVAS_W + cx] =
-            gfx_alpha_blend(color, ex, (uint8_t)opacity);
+    for (int t = 0; t < ARTOS_TILES; t++) {
+        if (r->tiles[t]) {
+            kfree(r->tiles[t]);
+            r->tiles[t] = NULL;
+            art.undo_tiles--;
+        }
     }
+    r->ntiles = 0;
 }
 
-static uint32_t artos_canvas_get(int cx, int cy)
+static struct artos_undo_rec *artos_undo_newest(int l)
 {
-    if (cx >= 0 && cx < ARTOS_CANVAS_W && cy >= 0 && cy < ARTOS_CANVAS_H)
-        return art.layers[art.active_layer].pixels[cy * ARTOS_CANVAS_W + cx];
-    return 0;
+    if (art.undo_count[l] <= 0) return NULL;
+    return &art.undo[l][(art.undo_pos[l] - 1 + ARTOS_MAX_UNDO) % ARTOS_MAX_UNDO];
 }
 
-/* --- Undo (operates on active layer only) --- */
+/* Drop the oldest undo step of any layer (never the one being recorded) */
+static int artos_undo_evict_oldest(void)
+{
+    int victim = -1;
+    uint32_t oldest = 0;
+
+    for (int l = 0; l < ARTOS_MAX_LAYERS; l++) {
+        int n = art.undo_count[l];
+        if (n <= 0) continue;
+        if (l == art.active_layer && art.undo_open && n == 1) continue;
+        struct artos_undo_rec *r =
+            &art.undo[l][(art.undo_pos[l] - n + ARTOS_MAX_UNDO) % ARTOS_MAX_UNDO];
+        if (victim < 0 || r->seq < oldest) {
+            victim = l;
+            oldest = r->seq;
+        }
+    }
+    if (victim < 0) return 0;
+
+    int n = art.undo_count[victim];
+    artos_undo_free_rec(&art.undo[victim][(art.undo_pos[victim] - n + ARTOS_MAX_UNDO) % ARTOS_MAX_UNDO]);
+    art.undo_count[victim]--;
+    return 1;
+}
+
+/* Save tile t of the active layer into the open record (first write only) */
+static void artos_undo_save_tile(int t)
+{
+    struct artos_undo_rec *r = artos_undo_newest(art.active_layer);
+    if (!r || r->tiles[t]) return;
+
+    int x0, y0, w, h;
+    artos_tile_bounds(t, &x0, &y0, &w, &h);
+
+    while (art.undo_tiles >= ARTOS_UNDO_TILE_BUDGET && artos_undo_evict_oldest())
+        ;
+    uint32_t *tile = (uint32_t *)kmalloc(sizeof(uint32_t) * w * h);
+    while (!tile && artos_undo_evict_oldest())
+        tile = (uint32_t *)kmalloc(sizeof(uint32_t) * w * h);
+    if (!tile) return;  /* Out of memory: this tile will not be undoable */
+
+    artos_tile_copy(art.layers[art.active_layer].pixels, tile, t, 0);
+    r->tiles[t] = tile;
+    r->ntiles++;
+    art.undo_tiles++;
+}
+
+/*
+ * Called before writing canvas pixel (cx, cy) of the active layer:
+ * saves the tile for undo and marks it for recompositing.
+ */
+static inline void artos_canvas_touch(int cx, int cy)
+{
+    int t = (cy / ARTOS_TILE_SIZE) * ARTOS_TILES_X + cx / ARTOS_TILE_SIZE;
+    artos_tile_dirty(t);
+    if (!art.undo_open) return;
+    struct artos_undo_rec *r = artos_undo_newest(art.active_layer);
+    if (r && !r->tiles[t])
+        artos_undo_save_tile(t);
+}
+
+/* Called before writing the canvas rectangle [x0,x1) x [y0,y1) directly */
+static void artos_canvas_touch_rect(int x0, int y0, int x1, int y1)
+{
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > ARTOS_CANVAS_W) x1 = ARTOS_CANVAS_W;
+    if (y1 > ARTOS_CANVAS_H) y1 = ARTOS_CANVAS_H;
+    if (x1 <= x0 || y1 <= y0) return;
+    for (int ty = y0 / ARTOS_TILE_SIZE; ty <= (y1 - 1) / ARTOS_TILE_SIZE; ty++)
+        for (int tx = x0 / ARTOS_TILE_SIZE; tx <= (x1 - 1) / ARTOS_TILE_SIZE; tx++)
+            artos_canvas_touch(tx * ARTOS_TILE_SIZE, ty * ARTOS_TILE_SIZE);
+}
+
+/* Start a new undo step on the active layer; tiles are saved as they are hit */
 static void artos_undo_push(void)
 {
-    memcpy(art.undo[art.undo_pos], art.layers[art.active_layer].pixels,
-           sizeof(uint32_t) * ARTOS_CANVAS_W * ARTOS_CANVAS_H);
-    art.undo_pos = (art.undo_pos + 1) % ARTOS_MAX_UNDO;
-    if (art.undo_count < ARTOS_MAX_UNDO) art.undo_count++;
+    int l = art.active_layer;
+    struct artos_undo_rec *r = &art.undo[l][art.undo_pos[l]];
+
+    /* Ring full: this slot holds the layer's oldest step */
+    artos_undo_free_rec(r);
+    r->seq = ++art.undo_seq;
+    art.undo_pos[l] = (art.undo_pos[l] + 1) % ARTOS_MAX_UNDO;
+    if (art.undo_count[l] < ARTOS_MAX_UNDO) art.undo_count[l]++;
+    art.undo_open = 1;
+}
+
+/* End the open step; writes until the next push are not recorded */
+static void artos_undo_close(void)
+{
+    art.undo_open = 0;
 }
 
 static void artos_undo(void)
 {
-    if (art.undo_count <= 0) return;
-    art.undo_pos = (art.undo_pos - 1 + ARTOS_MAX_UNDO) % ARTOS_MAX_UNDO;
-    art.undo_count--;
-    memcpy(art.layers[art.active_layer].pixels, art.undo[art.undo_pos],
-           sizeof(uint32_t) * ARTOS_CANVAS_W * ARTOS_CANVAS_H);
+    int l = art.active_layer;
+    struct artos_undo_rec *r = artos_undo_newest(l);
+    if (!r) return;
+
+    for (int t = 0; t < ARTOS_TILES; t++) {
+        if (r->tiles[t]) {
+            artos_tile_copy(art.layers[l].pixels, r->tiles[t], t, 1);
+            artos_tile_dirty(t);
+        }
+    }
+    artos_undo_free_rec(r);
+    art.undo_pos[l] = (art.undo_pos[l] - 1 + ARTOS_MAX_UNDO) % ARTOS_MAX_UNDO;
+    art.undo_count[l]--;
+    art.undo_open = 0;
+}
+
+/*
+ * Put back the pre-stroke contents of every tile the open step touched,
+ * keeping the step open. Shape tools use this to erase their preview.
+ */
+static void artos_undo_revert_open(void)
+{
+    struct artos_undo_rec *r = artos_undo_newest(art.active_layer);
+    if (!art.undo_open || !r) return;
+
+    for (int t = 0; t < ARTOS_TILES; t++) {
+        if (r->tiles[t]) {
+            artos_tile_copy(art.layers[art.active_layer].pixels, r->tiles[t], t, 1);
+            artos_tile_dirty(t);
+        }
+    }
+}
+
+static void artos_undo_clear_layer(int l)
+{
+    for (int i = 0; i < ARTOS_MAX_UNDO; i++)
+        artos_undo_free_rec(&art.undo[l][i]);
+    art.undo_count[l] = 0;
+    art.undo_pos[l] = 0;
+    if (l == art.active_layer) art.undo_open = 0;
+}
+
+static void artos_undo_clear_all(void)
+{
+    for (int l = 0; l < ARTOS_MAX_LAYERS; l++)
+        artos_undo_clear_layer(l);
 }
 
 static void artos_switch_layer(int n)
 {
     if (n < 0 || n >= art.layer_count || n == art.active_layer) return;
+    /* History stays with its layer; only the open step is closed */
+    art.undo_open = 0;
     art.active_layer = n;
-    art.undo_count = 0;
-    art.undo_pos = 0;
 }
 
 static void artos_flatten_layers(void)
@@ -6177,8 +6432,38 @@ static void artos_flatten_layers(void)
     art.layers[0].opacity = 255;
     art.layer_count = 1;
     art.active_layer = 0;
-    art.undo_count = 0;
-    art.undo_pos = 0;
+    artos_undo_clear_all();
+    artos_layer_invalidate(0);
+}
+
+/* --- Canvas access (operates on active layer) --- */
+static void artos_canvas_set(int cx, int cy, uint32_t color)
+{
+    if (cx >= 0 && cx < ARTOS_CANVAS_W && cy >= 0 && cy < ARTOS_CANVAS_H) {
+        artos_canvas_touch(cx, cy);
+        art.layers[art.active_layer].pixels[cy * ARTOS_CANVAS_W + cx] = color;
+    }
+}
+
+static void artos_canvas_set_opacity(int cx, int cy, uint32_t color, int opacity)
+{
+    if (cx < 0 || cx >= ARTOS_CANVAS_W || cy < 0 || cy >= ARTOS_CANVAS_H) return;
+    if (opacity >= 255) {
+        artos_canvas_touch(cx, cy);
+        art.layers[art.active_layer].pixels[cy * ARTOS_CANVAS_W + cx] = color;
+    } else if (opacity > 0) {
+        artos_canvas_touch(cx, cy);
+        uint32_t ex = art.layers[art.active_layer].pixels[cy * ARTOS_CANVAS_W + cx];
+        art.layers[art.active_layer].pixels[cy * ARTOS_CANVAS_W + cx] =
+            gfx_alpha_blend(color, ex, (uint8_t)opacity);
+    }
+}
+
+static uint32_t artos_canvas_get(int cx, int cy)
+{
+    if (cx >= 0 && cx < ARTOS_CANVAS_W && cy >= 0 && cy < ARTOS_CANVAS_H)
+        return art.layers[art.active_layer].pixels[cy * ARTOS_CANVAS_W + cx];
+    return 0;
 }
 
 /* --- Drawing primitives --- */
@@ -8322,6 +8607,7 @@ static void artos_flood_fill(int sx, int sy, uint32_t new_color)
 /* Initialize ArtOS state */
 static void artos_init_state(void)
 {
+    artos_undo_clear_all();     /* Frees tiles from a previous session */
     memset(&art, 0, sizeof(art));
     art.tool = ARTOS_TOOL_PENCIL;
     art.fg_color = 0xFF000000;
@@ -8364,6 +8650,8 @@ static void artos_init_state(void)
         strcpy(art.layers[l].name, nm);
     }
 
+    for (int l = 0; l < ARTOS_MAX_LAYERS; l++)
+        artos_layer_invalidate(l);
     artos_composite_layers();
 }
 
@@ -8817,6 +9105,7 @@ static void artos_flip_h(void)
     uint32_t *px = art.layers[art.active_layer].pixels;
     int x0 = 0, y0 = 0, x1 = ARTOS_CANVAS_W, y1 = ARTOS_CANVAS_H;
     if (art.sel_active) { x0 = art.sel_x1; y0 = art.sel_y1; x1 = art.sel_x2; y1 = art.sel_y2; }
+    artos_canvas_touch_rect(x0, y0, x1, y1);
     int w = x1 - x0;
     for (int y = y0; y < y1; y++)
         for (int i = 0; i < w / 2; i++) {
@@ -8832,6 +9121,7 @@ static void artos_flip_v(void)
     uint32_t *px = art.layers[art.active_layer].pixels;
     int x0 = 0, y0 = 0, x1 = ARTOS_CANVAS_W, y1 = ARTOS_CANVAS_H;
     if (art.sel_active) { x0 = art.sel_x1; y0 = art.sel_y1; x1 = art.sel_x2; y1 = art.sel_y2; }
+    artos_canvas_touch_rect(x0, y0, x1, y1);
     int h = y1 - y0;
     for (int i = 0; i < h / 2; i++)
         for (int x = x0; x < x1; x++) {
@@ -8847,6 +9137,7 @@ static void artos_invert(void)
     uint32_t *px = art.layers[art.active_layer].pixels;
     int x0 = 0, y0 = 0, x1 = ARTOS_CANVAS_W, y1 = ARTOS_CANVAS_H;
     if (art.sel_active) { x0 = art.sel_x1; y0 = art.sel_y1; x1 = art.sel_x2; y1 = art.sel_y2; }
+    artos_canvas_touch_rect(x0, y0, x1, y1);
     for (int y = y0; y < y1; y++)
         for (int x = x0; x < x1; x++)
             px[y * ARTOS_CANVAS_W + x] ^= 0x00FFFFFF;
@@ -8858,6 +9149,7 @@ static void artos_brightness(int delta)
     uint32_t *px = art.layers[art.active_layer].pixels;
     int x0 = 0, y0 = 0, x1 = ARTOS_CANVAS_W, y1 = ARTOS_CANVAS_H;
     if (art.sel_active) { x0 = art.sel_x1; y0 = art.sel_y1; x1 = art.sel_x2; y1 = art.sel_y2; }
+    artos_canvas_touch_rect(x0, y0, x1, y1);
     for (int y = y0; y < y1; y++)
         for (int x = x0; x < x1; x++) {
             int idx = y * ARTOS_CANVAS_W + x;
@@ -8876,6 +9168,7 @@ static void artos_posterize(void)
     uint32_t *px = art.layers[art.active_layer].pixels;
     int x0 = 0, y0 = 0, x1 = ARTOS_CANVAS_W, y1 = ARTOS_CANVAS_H;
     if (art.sel_active) { x0 = art.sel_x1; y0 = art.sel_y1; x1 = art.sel_x2; y1 = art.sel_y2; }
+    artos_canvas_touch_rect(x0, y0, x1, y1);
     for (int y = y0; y < y1; y++)
         for (int x = x0; x < x1; x++) {
             int idx = y * ARTOS_CANVAS_W + x;
@@ -9313,9 +9606,8 @@ static void artos_click(struct wm_window *win, int x, int y, int button)
                        art.tool == ARTOS_TOOL_GRADFILL ||
                        art.tool == ARTOS_TOOL_FILLOVAL || art.tool == ARTOS_TOOL_FILLSTAR ||
                        art.tool == ARTOS_TOOL_SPIRAL) {
-                /* Restore saved layer and draw shape preview */
-                memcpy(layer_px, art.shape_save,
-                       sizeof(uint32_t) * ARTOS_CANVAS_W * ARTOS_CANVAS_H);
+                /* Erase the previous preview, then draw the new one */
+                artos_undo_revert_open();
                 if (art.tool == ARTOS_TOOL_LINE) {
                     artos_line(art.start_cx, art.start_cy, cx_coord, cy_coord,
                                art.fg_color, art.brush_size);
@@ -9397,6 +9689,9 @@ static void artos_click(struct wm_window *win, int x, int y, int button)
         }
         art.drawing = 0;
         art.sel_moving = 0;
+        /* Stroke over; polygon and text keep their step across clicks */
+        if (!art.text_active && art.poly_count == 0)
+            artos_undo_close();
         return;
     }
 
@@ -9409,6 +9704,7 @@ static void artos_click(struct wm_window *win, int x, int y, int button)
         /* Clear (x=44..79) */
         if (x >= 44 && x < 80) {
             artos_undo_push();
+            artos_canvas_touch_rect(0, 0, ARTOS_CANVAS_W, ARTOS_CANVAS_H);
             for (int i = 0; i < ARTOS_CANVAS_W * ARTOS_CANVAS_H; i++)
                 layer_px[i] = art.bg_color;
             art.modified = 1;
@@ -9561,6 +9857,7 @@ static void artos_click(struct wm_window *win, int x, int y, int button)
                 /* Eye icon (x 4..11 within panel) */
                 if (lx >= 4 && lx < 12) {
                     art.layers[l].visible = !art.layers[l].visible;
+                    artos_composite_invalidate();
                     return;
                 }
                 /* Click on layer name = switch to it */
@@ -9582,6 +9879,8 @@ static void artos_click(struct wm_window *win, int x, int y, int button)
                 art.layers[nl].name[4] = '1' + (char)nl; art.layers[nl].name[5] = '\0';
                 for (int i = 0; i < ARTOS_CANVAS_W * ARTOS_CANVAS_H; i++)
                     art.layers[nl].pixels[i] = 0x00000000; /* transparent */
+                artos_undo_clear_layer(nl);
+                artos_layer_invalidate(nl);
                 artos_switch_layer(nl);
                 return;
             }
@@ -9605,6 +9904,7 @@ static void artos_click(struct wm_window *win, int x, int y, int button)
                 o -= ARTOS_OPACITY_STEP;
                 if (o < 0) o = 0;
                 art.layers[art.active_layer].opacity = (uint8_t)o;
+                artos_composite_invalidate();
                 return;
             }
             /* Opacity + */
@@ -9613,6 +9913,7 @@ static void artos_click(struct wm_window *win, int x, int y, int button)
                 o += ARTOS_OPACITY_STEP;
                 if (o > 255) o = 255;
                 art.layers[art.active_layer].opacity = (uint8_t)o;
+                artos_composite_invalidate();
                 return;
             }
         }
@@ -9642,8 +9943,6 @@ static void artos_click(struct wm_window *win, int x, int y, int button)
                    art.tool == ARTOS_TOOL_FILLOVAL || art.tool == ARTOS_TOOL_FILLSTAR ||
                    art.tool == ARTOS_TOOL_SPIRAL) {
             artos_undo_push();
-            memcpy(art.shape_save, layer_px,
-                   sizeof(uint32_t) * ARTOS_CANVAS_W * ARTOS_CANVAS_H);
             art.drawing = 1;
             art.start_cx = cx_coord;
             art.start_cy = cy_coord;
@@ -9798,6 +10097,7 @@ static void artos_key(struct wm_window *win, int key)
         if (key == 27) {
             /* Escape: exit text mode */
             art.text_active = 0;
+            artos_undo_close();
             return;
         } else if (key == '\n' || key == '\r') {
             /* Enter: newline */
@@ -9969,6 +10269,7 @@ static void artos_key(struct wm_window *win, int key)
         art.text_active = 0;
         art.bezier_count = 0;
         art.clone_src_set = 0;
+        artos_undo_close();
         return;
     }
     if ((key == '\b' || key == 127) && art.sel_active) {
@@ -12028,6 +12329,21 @@ void desktop_run(void)
     int hover_dock = -1;
 
     while (1) {
+        frameprof_begin_frame();
+
+        /* 0. Apply queued input, then dispatch keys before drawing so their
+         *    effect is in this frame */
+        input_drain();
+        int key;
+        while ((key = keyboard_getchar_nonblock()) >= 0) {
+            if (wm_window_count() > 0) {
+                wm_handle_key(key);
+            } else if (active_input == 1) {
+                handle_ai_input_key(key);
+            }
+        }
+        frameprof_mark(FRAMEPROF_INPUT);
+
         /* 1. Draw all panels (with hover state) */
         panel_draw_header();
         panel_draw_menubar();
@@ -12039,17 +12355,23 @@ void desktop_run(void)
         panel_draw_right_assistant(&ai_state);
         panel_draw_dock(desktop_apps, desktop_app_count, hover_dock);
         panel_draw_statusbar();
+        frameprof_mark(FRAMEPROF_PANELS);
 
         /* 2. Draw any open popup windows on top */
         wm_draw_all();
+        frameprof_mark(FRAMEPROF_WM);
 
-        /* 3. Poll USB HID devices (injects into kbd_buffer and mouse_state) */
+        /* 3. USB hot-plug (HID reports arrive by interrupt) */
         if (usb_is_initialized()) {
             usb_poll();
         }
+        xhci_poll();
+        frameprof_mark(FRAMEPROF_USB);
 
-        /* 3b. Poll VirtIO network (process received packets) */
+        /* 3b. Poll VirtIO network (process received packets, TCP timers) */
         virtio_net_poll();
+        net_poll();
+        frameprof_mark(FRAMEPROF_NET);
 
         /* 3c. Poll DrawNet collaboration (sync peers and strokes every 100ms) */
         if (art.drawnet_enabled) {
@@ -12060,6 +12382,7 @@ void desktop_run(void)
                 art.drawnet_last_sync_ms = now_ms;
             }
         }
+        frameprof_mark(FRAMEPROF_DRAWNET);
 
         /* 3d. Poll Groq AI response (async VirtIO Console) */
         if (art.groq_pending) {
@@ -12071,6 +12394,7 @@ void desktop_run(void)
                 generate_ai_art_local();
             }
         }
+        frameprof_mark(FRAMEPROF_GROQ);
 
         /* 3e. Periodic Governor scan (every ~5 seconds = 500 ticks) */
         {
@@ -12233,6 +12557,7 @@ void desktop_run(void)
                     pve_evolve_key();
             }
         }
+        frameprof_mark(FRAMEPROF_GOVERNOR);
 
         /* 4. Handle mouse */
         mouse_get_state(&ms);
@@ -12325,6 +12650,7 @@ void desktop_run(void)
                 acpi_request_shutdown();
             }
         }
+        frameprof_mark(FRAMEPROF_MOUSE);
 
         /* 4. Tick animations */
         /* Sidebar expand animation (ease-out) */
@@ -12540,29 +12866,34 @@ void desktop_run(void)
             }
         }
 
+        frameprof_mark(FRAMEPROF_ANIM);
+
+        /* 4b. Frame-time HUD (toggled with the "frametime hud" command) */
+        frameprof_draw_hud();
+        frameprof_mark(FRAMEPROF_HUD);
+
         /* 5. Draw cursor on top */
         gfx_draw_cursor(ms.x, ms.y);
+        frameprof_mark(FRAMEPROF_CURSOR);
 
         /* 6. Wait for frame timing then flip to screen */
         fb_frame_wait();
+        frameprof_mark(FRAMEPROF_WAIT);
         fb_flip();
+        input_frame_presented();
+        frameprof_mark(FRAMEPROF_FLIP);
 
-        /* 7. Handle keyboard */
-        int key = keyboard_getchar_nonblock();
-        if (key >= 0) {
-            if (wm_window_count() > 0) {
-                wm_handle_key(key);
-            } else if (active_input == 1) {
-                handle_ai_input_key(key);
-            }
-        }
-
-        /* 8. Check for ACPI shutdown request */
+        /* 7. Check for ACPI shutdown request */
         if (acpi_is_shutdown_requested())
             break;
 
-        /* Yield until next interrupt */
-        __asm__ volatile("hlt");
+        /* Yield until next interrupt, or to deferred boot tasks */
+        if (sched_has_ready())
+            sched_yield();
+        else
+            __asm__ volatile("hlt");
+        frameprof_mark(FRAMEPROF_IDLE);
+        frameprof_end_frame();
     }
 
     /* Shutdown screen */
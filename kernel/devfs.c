@@ -208,8 +208,6 @@ static struct {
 };
 
 static struct vfs_dentry *devfs_lookup(struct vfs_inode *dir, const char *name) {
-    (void)dir;
-
     /* Find device by name */
     devfs_device_t device = (devfs_device_t)-1;
     for (int i = 0; devfs_devices[i].name; i++) {
@@ -238,6 +236,7 @@ static struct vfs_dentry *devfs_lookup(struct vfs_inode *dir, const char *name)
     inode->type = VFS_TYPE_DEVICE;
     inode->fs_data = idata;
     inode->fops = &devfs_file_ops;
+    inode->sb = dir->sb;
 
     dentry->inode = inode;
     return dentry;
@@ -295,11 +294,18 @@ static void devfs_unmount(struct vfs_superblock *sb) {
     printf("  [devfs] Unmounted (data preserved)\n");
 }
 
+/* The device table is fixed, so a name that isn't there never will be */
+static uint64_t devfs_generation(struct vfs_superblock *sb) {
+    (void)sb;
+    return 0;
+}
+
 /* Global devfs type */
 struct vfs_fs_type devfs_fs_type = {
     .name = "devfs",
     .flags = 0,
     .mount = devfs_mount,
     .unmount = devfs_unmount,
+    .generation = devfs_generation,
     .next = NULL,
 };
@@ -4,19 +4,33 @@
  *
  * Renders text on the framebuffer using the bitmap font.
  * Provides scrolling, cursor tracking, and integrates with kprintf.
+ *
+ * Text is kept in a character-cell ring buffer. Scrolling rotates the
+ * ring's top-row index instead of moving text, and rendering is deferred
+ * until the next flip: only cells that differ from what is already on
+ * screen are redrawn. When the GPU backend can copy regions, accumulated
+ * scrolls are applied to the pixels with a single copy_region; otherwise
+ * no pixels are moved at all and the changed cells are simply repainted.
  */
 
 #include "fbcon.h"
 #include "framebuffer.h"
+#include "gpu_hal.h"
 #include "font.h"
+#include "timer.h"
+#include "io.h"
+#include "idt.h"
 #include <stdint.h>
 
 /*============================================================================
  * External Declarations
  *============================================================================*/
 
+extern int kprintf(const char *fmt, ...);
 extern void *memcpy(void *dest, const void *src, size_t n);
+extern void *memmove(void *dest, const void *src, size_t n);
 extern void *memset(void *s, int c, size_t n);
+extern const uint8_t font_data[95][16];
 
 /*============================================================================
  * Console State
@@ -26,12 +40,135 @@ extern void *memset(void *s, int c, size_t n);
 #define FBCON_FG    0xFFEEEEEE      /* Light gray text */
 #define FBCON_BG    0xFF000000      /* Black background */
 
+/* Largest grid the framebuffer can need */
+#define FBCON_MAX_COLS  (FB_MAX_WIDTH / FONT_WIDTH)     /* 160 */
+#define FBCON_MAX_ROWS  (FB_MAX_HEIGHT / FONT_HEIGHT)   /* 64 */
+
 static uint32_t cols;           /* Characters per row */
 static uint32_t rows;           /* Character rows */
 static uint32_t cursor_x;      /* Current column (0-based) */
 static uint32_t cursor_y;      /* Current row (0-based) */
 static int      active;        /* Console initialized? */
 
+/*
+ * Text model: cells[] is a ring of rows. Screen row r lives in
+ * ring row (ring_top + r) % rows, so a scroll is just ring_top++.
+ */
+static char     cells[FBCON_MAX_ROWS][FBCON_MAX_COLS];
+static uint32_t ring_top;
+
+/* What is currently drawn on screen, indexed by screen row */
+static char     shown[FBCON_MAX_ROWS][FBCON_MAX_COLS];
+
+/* Scrolls accumulated since the last render */
+static uint32_t pending_scroll;
+
+/* Statistics */
+static struct fbcon_stats stats;
+
+/*============================================================================
+ * Rendering
+ *============================================================================*/
+
+static inline char *text_row(uint32_t screen_row)
+{
+    return cells[(ring_top + screen_row) % rows];
+}
+
+/*
+ * Draw one glyph straight into the backbuffer (caller guarantees bounds)
+ */
+static void fbcon_draw_cell(uint32_t *backbuf, uint32_t fb_w,
+                            uint32_t cx, uint32_t cy, char ch)
+{
+    int idx = (unsigned char)ch - 32;
+    if (idx < 0 || idx >= 95)
+        idx = 0;
+
+    const uint8_t *glyph = font_data[idx];
+    uint32_t *dst = &backbuf[cy * FONT_HEIGHT * fb_w + cx * FONT_WIDTH];
+
+    for (int row = 0; row < FONT_HEIGHT; row++) {
+        uint8_t bits = glyph[row];
+        dst[0] = (bits & 0x80) ? FBCON_FG : FBCON_BG;
+        dst[1] = (bits & 0x40) ? FBCON_FG : FBCON_BG;
+        dst[2] = (bits & 0x20) ? FBCON_FG : FBCON_BG;
+        dst[3] = (bits & 0x10) ? FBCON_FG : FBCON_BG;
+        dst[4] = (bits & 0x08) ? FBCON_FG : FBCON_BG;
+        dst[5] = (bits & 0x04) ? FBCON_FG : FBCON_BG;
+        dst[6] = (bits & 0x02) ? FBCON_FG : FBCON_BG;
+        dst[7] = (bits & 0x01) ? FBCON_FG : FBCON_BG;
+        dst += fb_w;
+    }
+}
+
+/*
+ * Apply pending scrolls to the pixels with the GPU, if it can.
+ * Returns 1 if the screen contents (and shown[]) were shifted.
+ */
+static int fbcon_gpu_scroll(uint32_t n)
+{
+    uint32_t fb_w = fb_get_width();
+
+    if (n == 0 || n >= rows || !gpu_hal_available())
+        return 0;
+
+    if (gpu_hal_copy_region(0, 0, 0, n * FONT_HEIGHT, cols * FONT_WIDTH,
+                            (rows - n) * FONT_HEIGHT) != 0)
+        return 0;
+
+    /* CPU glyph writes below must land after the copy */
+    gpu_hal_sync();
+    fb_mark_dirty(0, 0, fb_w, rows * FONT_HEIGHT);
+
+    /* Pixels moved up by n rows; the bottom n rows still show old text */
+    memmove(shown[0], shown[n], (size_t)(rows - n) * FBCON_MAX_COLS);
+    stats.gpu_scrolls++;
+    return 1;
+}
+
+/*
+ * Bring the backbuffer in line with the text model
+ */
+static void fbcon_render(void)
+{
+    uint32_t *backbuf = fb_get_backbuffer();
+    uint32_t fb_w = fb_get_width();
+
+    if (!backbuf)
+        return;
+
+    uint64_t t0 = rdtsc();
+
+    if (pending_scroll) {
+        fbcon_gpu_scroll(pending_scroll);
+        pending_scroll = 0;
+    }
+
+    for (uint32_t r = 0; r < rows; r++) {
+        const char *text = text_row(r);
+        char *seen = shown[r];
+        uint32_t first = cols, last = 0;
+
+        for (uint32_t c = 0; c < cols; c++) {
+            if (text[c] == seen[c])
+                continue;
+            fbcon_draw_cell(backbuf, fb_w, c, r, text[c]);
+            seen[c] = text[c];
+            if (first == cols) first = c;
+            last = c;
+            stats.cells_drawn++;
+        }
+
+        if (first < cols)
+            fb_mark_dirty(first * FONT_WIDTH, r * FONT_HEIGHT,
+                          (last - first + 1) * FONT_WIDTH, FONT_HEIGHT);
+    }
+
+    stats.renders++;
+    stats.render_cycles += rdtsc() - t0;
+}
+
 /*============================================================================
  * Implementation
  *============================================================================*/
@@ -43,11 +180,18 @@ void fbcon_init(void)
 
     cols = fb_get_width() / FONT_WIDTH;     /* 1024/8 = 128 */
     rows = fb_get_height() / FONT_HEIGHT;   /* 768/16 = 48 */
+    if (cols > FBCON_MAX_COLS) cols = FBCON_MAX_COLS;
+    if (rows > FBCON_MAX_ROWS) rows = FBCON_MAX_ROWS;
     cursor_x = 0;
     cursor_y = 0;
+    ring_top = 0;
+    pending_scroll = 0;
+    memset(cells, ' ', sizeof(cells));
+    memset(shown, ' ', sizeof(shown));
+    memset(&stats, 0, sizeof(stats));
     active = 1;
 
-    /* Clear screen to black */
+    /* Clear screen to black (matches the all-blank shown[] grid) */
     fb_clear(FBCON_BG);
     fb_flip();
 }
@@ -58,32 +202,21 @@ int fbcon_is_active(void)
 }
 
 /*
- * Scroll the console up by one line
+ * Scroll the console up by one line: rotate the ring, blank the new row
  */
 static void fbcon_scroll(void)
 {
-    uint32_t *backbuf = fb_get_backbuffer();
-    uint32_t fb_w = fb_get_width();
-    uint32_t fb_h = fb_get_height();
-
-    if (!backbuf) return;
-
-    /* Move everything up by FONT_HEIGHT pixels */
-    uint32_t line_pixels = FONT_HEIGHT * fb_w;
-    uint32_t total_pixels = fb_w * fb_h;
-
-    memcpy(backbuf, backbuf + line_pixels,
-           (total_pixels - line_pixels) * 4);
-
-    /* Clear the last line */
-    memset(backbuf + (total_pixels - line_pixels), 0,
-           line_pixels * 4);
+    ring_top = (ring_top + 1) % rows;
+    memset(text_row(rows - 1), ' ', cols);
+    pending_scroll++;
+    stats.scrolls++;
 }
 
 static void fbcon_newline(void)
 {
     cursor_x = 0;
     cursor_y++;
+    stats.lines++;
     if (cursor_y >= rows) {
         cursor_y = rows - 1;
         fbcon_scroll();
@@ -94,6 +227,11 @@ void fbcon_putchar(char c)
 {
     if (!active) return;
 
+    /* Deferred boot tasks print too; the cursor update, rendering and
+     * flip all happen with interrupts held off */
+    uint64_t flags = irq_save();
+    stats.chars++;
+
     switch (c) {
     case '\n':
         fbcon_newline();
@@ -113,15 +251,13 @@ void fbcon_putchar(char c)
     case '\b':
         if (cursor_x > 0) {
             cursor_x--;
-            font_draw_char(cursor_x * FONT_WIDTH, cursor_y * FONT_HEIGHT,
-                          ' ', FBCON_FG, FBCON_BG);
+            text_row(cursor_y)[cursor_x] = ' ';
         }
         break;
 
     default:
         if ((unsigned char)c >= 32 && (unsigned char)c <= 126) {
-            font_draw_char(cursor_x * FONT_WIDTH, cursor_y * FONT_HEIGHT,
-                          c, FBCON_FG, FBCON_BG);
+            text_row(cursor_y)[cursor_x] = c;
             cursor_x++;
             if (cursor_x >= cols)
                 fbcon_newline();
@@ -132,21 +268,91 @@ void fbcon_putchar(char c)
     /* Flip to screen on newlines for reasonable performance during boot.
      * Individual characters are batched until a newline triggers the flip. */
     if (c == '\n') {
+        fbcon_render();
         fb_flip();
     }
+    irq_restore(flags);
 }
 
-void fbcon_clear(void)
+void fbcon_flush(void)
 {
     if (!active) return;
 
-    fb_clear(FBCON_BG);
+    uint64_t flags = irq_save();
+    fbcon_render();
     fb_flip();
+    irq_restore(flags);
+}
+
+void fbcon_clear(void)
+{
+    if (!active) return;
+
+    uint64_t flags = irq_save();
+    memset(cells, ' ', sizeof(cells));
+    ring_top = 0;
     cursor_x = 0;
     cursor_y = 0;
+    fbcon_render();
+    fb_flip();
+    irq_restore(flags);
 }
 
 void fbcon_disable(void)
 {
     active = 0;
 }
+
+/*============================================================================
+ * Statistics
+ *============================================================================*/
+
+void fbcon_get_stats(struct fbcon_stats *out)
+{
+    if (out) *out = stats;
+}
+
+void fbcon_dump_stats(void)
+{
+    kprintf("\nFramebuffer Console:\n");
+    kprintf("  Active:       %s\n", active ? "yes" : "no");
+    kprintf("  Grid:         %ux%u cells\n", cols, rows);
+    kprintf("  Lines:        %lu\n", (unsigned long)stats.lines);
+    kprintf("  Chars:        %lu\n", (unsigned long)stats.chars);
+    kprintf("  Scrolls:      %lu (%lu via GPU copy)\n",
+            (unsigned long)stats.scrolls, (unsigned long)stats.gpu_scrolls);
+    kprintf("  Renders:      %lu\n", (unsigned long)stats.renders);
+    kprintf("  Cells drawn:  %lu\n", (unsigned long)stats.cells_drawn);
+    if (stats.renders > 0)
+        kprintf("  Cycles/render: %lu\n",
+                (unsigned long)(stats.render_cycles / stats.renders));
+}
+
+int fbcon_bench(uint32_t nlines)
+{
+    if (!active || nlines == 0)
+        return -1;
+
+    struct fbcon_stats before = stats;
+    uint64_t ns0 = timer_get_ns();
+    uint64_t tsc0 = rdtsc();
+
+    for (uint32_t i = 0; i < nlines; i++)
+        kprintf("fbcon bench line %u: the quick brown fox jumps over the lazy dog\n", i);
+
+    uint64_t cycles = rdtsc() - tsc0;
+    uint64_t ns = timer_get_ns() - ns0;
+    if (ns == 0) ns = 1;
+
+    kprintf("\nfbcon bench: %u lines in %lu ms\n", nlines,
+            (unsigned long)(ns / 1000000));
+    kprintf("  Throughput:   %lu lines/sec\n",
+            (unsigned long)((uint64_t)nlines * 1000000000ULL / ns));
+    kprintf("  Cycles/line:  %lu (including serial output)\n",
+            (unsigned long)(cycles / nlines));
+    kprintf("  Cells drawn:  %lu\n",
+            (unsigned long)(stats.cells_drawn - before.cells_drawn));
+    kprintf("  GPU scrolls:  %lu\n",
+            (unsigned long)(stats.gpu_scrolls - before.gpu_scrolls));
+    return 0;
+}
@@ -8,6 +8,22 @@
 #ifndef PHANTOMOS_FBCON_H
 #define PHANTOMOS_FBCON_H
 
+#include <stdint.h>
+
+/*============================================================================
+ * Statistics
+ *============================================================================*/
+
+struct fbcon_stats {
+    uint64_t lines;             /* Newlines processed */
+    uint64_t chars;             /* Characters written */
+    uint64_t scrolls;           /* Ring rotations */
+    uint64_t gpu_scrolls;       /* Renders that moved pixels via copy_region */
+    uint64_t renders;           /* Text model -> backbuffer passes */
+    uint64_t cells_drawn;       /* Glyphs actually repainted */
+    uint64_t render_cycles;     /* TSC cycles spent rendering */
+};
+
 /*
  * Initialize framebuffer console
  * Sets up character grid based on framebuffer dimensions
@@ -30,9 +46,30 @@ int fbcon_is_active(void);
  */
 void fbcon_clear(void);
 
+/*
+ * Render pending text changes and flip to the screen
+ */
+void fbcon_flush(void);
+
 /*
  * Disable framebuffer console (when desktop takes over rendering)
  */
 void fbcon_disable(void);
 
+/*
+ * Get console rendering statistics
+ */
+void fbcon_get_stats(struct fbcon_stats *out);
+
+/*
+ * Print console rendering statistics
+ */
+void fbcon_dump_stats(void);
+
+/*
+ * Print @nlines test lines and report output throughput
+ * Returns 0 on success, -1 if the console is not active.
+ */
+int fbcon_bench(uint32_t nlines);
+
 #endif /* PHANTOMOS_FBCON_H */
@@ -11,6 +11,8 @@
 #include "io.h"
 #include "vmm.h"
 #include "heap.h"
+#include "pixel.h"
+#include "trace.h"
 #include <stdint.h>
 #include <stddef.h>
 
@@ -182,12 +184,8 @@ void fb_fill_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h,
         }
     }
 
-    for (uint32_t row = 0; row < h; row++) {
-        uint32_t *dst = &fb.backbuffer[(y + row) * fb.width + x];
-        for (uint32_t col = 0; col < w; col++) {
-            dst[col] = color;
-        }
-    }
+    for (uint32_t row = 0; row < h; row++)
+        px_fill(&fb.backbuffer[(y + row) * fb.width + x], w, color);
 }
 
 void fb_draw_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h,
@@ -241,10 +239,7 @@ void fb_clear(uint32_t color)
         }
     }
 
-    uint32_t total = fb.width * fb.height;
-    for (uint32_t i = 0; i < total; i++) {
-        fb.backbuffer[i] = color;
-    }
+    px_fill(fb.backbuffer, fb.width * fb.height, color);
 }
 
 /*============================================================================
@@ -319,6 +314,8 @@ void fb_flip(void)
 {
     if (!fb.initialized) return;
 
+    TRACE_SCOPE(TRACE_ID_FB_FLIP, 0, 0, 0);
+
     /* VM-optimized path: only copy dirty tiles */
     if (dirty_tracking_enabled) {
         fb_flip_dirty();
@@ -0,0 +1,359 @@
+/*
+ * PhantomOS Frame-Time Profiler
+ * "To Create, Not To Destroy"
+ *
+ * TSC lap timer for the desktop loop. Each frame is a row of cycle counts,
+ * one per phase; rows live in a fixed ring so recording a frame is a few
+ * stores and statistics are only computed when someone asks for them.
+ */
+
+#include "frameprof.h"
+#include "framebuffer.h"
+#include "graphics.h"
+#include "desktop_panels.h"
+#include "timer.h"
+#include "io.h"
+#include <stdint.h>
+
+/*============================================================================
+ * External Declarations
+ *============================================================================*/
+
+extern int kprintf(const char *fmt, ...);
+extern void *memset(void *s, int c, size_t n);
+
+/*============================================================================
+ * State
+ *============================================================================*/
+
+static const char *phase_names[FRAMEPROF_PHASE_COUNT] = {
+    "input", "panels", "wm", "usb", "net", "drawnet", "groq", "governor",
+    "mouse", "anim", "hud", "cursor", "wait", "flip", "idle",
+};
+
+/* Cycle counts of the last FRAMEPROF_HISTORY frames */
+static uint64_t history[FRAMEPROF_HISTORY][FRAMEPROF_PHASE_COUNT];
+static uint32_t history_head;           /* Next slot to write */
+static uint32_t history_count;          /* Valid slots */
+static uint64_t total_frames;
+
+/* Frame being recorded */
+static uint64_t cur[FRAMEPROF_PHASE_COUNT];
+static uint64_t last_mark;
+static int      in_frame;
+
+static int hud_enabled;
+
+/*============================================================================
+ * Recording
+ *============================================================================*/
+
+void frameprof_begin_frame(void)
+{
+    memset(cur, 0, sizeof(cur));
+    last_mark = rdtsc();
+    in_frame = 1;
+}
+
+void frameprof_mark(enum frameprof_phase phase)
+{
+    if (!in_frame || phase >= FRAMEPROF_PHASE_COUNT)
+        return;
+
+    uint64_t now = rdtsc();
+    cur[phase] += now - last_mark;
+    last_mark = now;
+}
+
+void frameprof_end_frame(void)
+{
+    if (!in_frame)
+        return;
+
+    uint64_t *slot = history[history_head];
+    for (int p = 0; p < FRAMEPROF_PHASE_COUNT; p++)
+        slot[p] = cur[p];
+
+    history_head = (history_head + 1) % FRAMEPROF_HISTORY;
+    if (history_count < FRAMEPROF_HISTORY)
+        history_count++;
+    total_frames++;
+    in_frame = 0;
+}
+
+void frameprof_reset(void)
+{
+    history_head = 0;
+    history_count = 0;
+    total_frames = 0;
+    in_frame = 0;
+}
+
+const char *frameprof_phase_name(enum frameprof_phase phase)
+{
+    if (phase >= FRAMEPROF_PHASE_COUNT)
+        return "?";
+    return phase_names[phase];
+}
+
+/*============================================================================
+ * Statistics
+ *============================================================================*/
+
+static uint64_t frame_total(const uint64_t *f)
+{
+    uint64_t sum = 0;
+    for (int p = 0; p < FRAMEPROF_PHASE_COUNT; p++)
+        sum += f[p];
+    return sum;
+}
+
+static uint64_t frame_busy(const uint64_t *f)
+{
+    return frame_total(f) - f[FRAMEPROF_WAIT] - f[FRAMEPROF_IDLE];
+}
+
+/* Sort n samples (n <= FRAMEPROF_HISTORY) and reduce them to stats */
+static void reduce(uint64_t *v, uint32_t n, struct frameprof_phase_stats *out)
+{
+    uint64_t sum = 0;
+
+    for (uint32_t i = 1; i < n; i++) {
+        uint64_t x = v[i];
+        uint32_t j = i;
+        while (j > 0 && v[j - 1] > x) {
+            v[j] = v[j - 1];
+            j--;
+        }
+        v[j] = x;
+    }
+    for (uint32_t i = 0; i < n; i++)
+        sum += v[i];
+
+    out->min_ns = timer_tsc_to_ns(v[0]);
+    out->max_ns = timer_tsc_to_ns(v[n - 1]);
+    out->avg_ns = timer_tsc_to_ns(sum / n);
+    out->p99_ns = timer_tsc_to_ns(v[(n * 99 + 99) / 100 - 1]);
+}
+
+void frameprof_get_stats(struct frameprof_stats *out)
+{
+    uint64_t v[FRAMEPROF_HISTORY];
+    uint32_t n = history_count;
+
+    if (!out)
+        return;
+
+    memset(out, 0, sizeof(*out));
+    out->frames = n;
+    out->total_frames = total_frames;
+    if (n == 0)
+        return;
+
+    for (int p = 0; p < FRAMEPROF_PHASE_COUNT; p++) {
+        for (uint32_t i = 0; i < n; i++)
+            v[i] = history[i][p];
+        reduce(v, n, &out->phase[p]);
+    }
+
+    for (uint32_t i = 0; i < n; i++)
+        v[i] = frame_total(history[i]);
+    reduce(v, n, &out->frame);
+
+    for (uint32_t i = 0; i < n; i++)
+        v[i] = frame_busy(history[i]);
+    reduce(v, n, &out->busy);
+}
+
+static void dump_row(const char *name, const struct frameprof_phase_stats *s)
+{
+    int len = 0;
+
+    /* kprintf has no left-justify, so pad the name by hand */
+    kprintf("  %s", name);
+    while (name[len]) len++;
+    for (; len < 10; len++)
+        kprintf(" ");
+    kprintf(" %8lu %8lu %8lu %8lu\n",
+            (unsigned long)(s->min_ns / 1000), (unsigned long)(s->avg_ns / 1000),
+            (unsigned long)(s->p99_ns / 1000), (unsigned long)(s->max_ns / 1000));
+}
+
+void frameprof_dump(void)
+{
+    struct frameprof_stats st;
+    frameprof_get_stats(&st);
+
+    kprintf("\nFrame Profiler (last %u of %lu frames, TSC %lu kHz):\n",
+            st.frames, (unsigned long)st.total_frames,
+            (unsigned long)timer_tsc_khz());
+    if (st.frames == 0) {
+        kprintf("  No frames recorded (desktop not running?)\n");
+        return;
+    }
+
+    kprintf("  phase           min      avg      p99      max   (us)\n");
+    for (int p = 0; p < FRAMEPROF_PHASE_COUNT; p++)
+        dump_row(phase_names[p], &st.phase[p]);
+    kprintf("  ----------------------------------------------\n");
+    dump_row("busy", &st.busy);
+    dump_row("frame", &st.frame);
+
+    if (st.frame.avg_ns > 0)
+        kprintf("  Average rate: %lu fps\n",
+                (unsigned long)(1000000000ULL / st.frame.avg_ns));
+}
+
+/*============================================================================
+ * HUD
+ *============================================================================*/
+
+#define HUD_BAR_W       2
+#define HUD_GRAPH_H     60
+#define HUD_PAD         4
+#define HUD_LINES       5
+#define HUD_W           (FRAMEPROF_HISTORY * HUD_BAR_W + 2 * HUD_PAD)
+#define HUD_H           (HUD_LINES * 16 + HUD_GRAPH_H + 3 * HUD_PAD)
+#define HUD_BG          0xFF0D1117
+#define HUD_SCALE_NS    50000000ULL     /* Graph full height = 50 ms */
+#define HUD_TARGET_NS   16666667ULL     /* 60 fps guide line */
+#define HUD_REFRESH     16              /* Recompute text every N frames */
+
+static struct frameprof_stats hud_stats;
+static uint64_t hud_stats_frame = (uint64_t)-1;
+
+void frameprof_set_hud(int enabled)
+{
+    hud_enabled = enabled ? 1 : 0;
+    hud_stats_frame = (uint64_t)-1;
+}
+
+int frameprof_hud_enabled(void)
+{
+    return hud_enabled;
+}
+
+static char *hud_puts(char *p, const char *s)
+{
+    while (*s)
+        *p++ = *s++;
+    return p;
+}
+
+/* Milliseconds with two decimals, right-aligned to 6 characters */
+static char *hud_put_ms(char *p, uint64_t ns)
+{
+    uint64_t hundredths = ns / 10000;
+    char tmp[24];
+    int n = 0;
+
+    if (hundredths > 999999)
+        hundredths = 999999;
+    tmp[n++] = (char)('0' + hundredths % 10);
+    tmp[n++] = (char)('0' + (hundredths / 10) % 10);
+    tmp[n++] = '.';
+    hundredths /= 100;
+    do {
+        tmp[n++] = (char)('0' + hundredths % 10);
+        hundredths /= 10;
+    } while (hundredths);
+
+    for (int pad = n; pad < 6; pad++)
+        *p++ = ' ';
+    while (n > 0)
+        *p++ = tmp[--n];
+    return p;
+}
+
+static void hud_line(int x, int y, const char *label,
+                     const struct frameprof_phase_stats *s, uint32_t color)
+{
+    char buf[40];
+    char *p = buf;
+    int len = 0;
+
+    while (label[len]) len++;
+    p = hud_puts(p, label);
+    for (; len < 9; len++)
+        *p++ = ' ';
+    p = hud_put_ms(p, s->avg_ns);
+    p = hud_puts(p, " p99");
+    p = hud_put_ms(p, s->p99_ns);
+    *p = '\0';
+
+    gfx_draw_text(x, y, buf, color, HUD_BG);
+}
+
+static uint32_t hud_bar_color(uint64_t ns)
+{
+    if (ns <= HUD_TARGET_NS)     return 0xFF3FB950;     /* Green */
+    if (ns <= 2 * HUD_TARGET_NS) return 0xFFD29922;     /* Amber */
+    return 0xFFF85149;                                  /* Red */
+}
+
+void frameprof_draw_hud(void)
+{
+    uint32_t fb_w = fb_get_width();
+    uint32_t fb_h = fb_get_height();
+
+    if (!hud_enabled || fb_w < HUD_W + 8 || fb_h < CONTENT_Y + HUD_H + 8)
+        return;
+
+    int x0 = (int)fb_w - HUD_W - 8;
+    int y0 = CONTENT_Y + 8;
+
+    if (total_frames - hud_stats_frame >= HUD_REFRESH ||
+        hud_stats_frame == (uint64_t)-1) {
+        frameprof_get_stats(&hud_stats);
+        hud_stats_frame = total_frames;
+    }
+
+    fb_fill_rect((uint32_t)x0, (uint32_t)y0, HUD_W, HUD_H, HUD_BG);
+    gfx_draw_hline(x0, y0, HUD_W, COLOR_BORDER);
+    gfx_draw_hline(x0, y0 + HUD_H - 1, HUD_W, COLOR_BORDER);
+    gfx_draw_vline(x0, y0, HUD_H, COLOR_BORDER);
+    gfx_draw_vline(x0 + HUD_W - 1, y0, HUD_H, COLOR_BORDER);
+
+    /* Text: whole frame, busy time, then the three costliest work phases */
+    int tx = x0 + HUD_PAD;
+    int ty = y0 + HUD_PAD;
+    hud_line(tx, ty, "frame ms", &hud_stats.frame, COLOR_TEXT);
+    hud_line(tx, ty + 16, "busy", &hud_stats.busy, COLOR_TEXT);
+
+    int used[FRAMEPROF_PHASE_COUNT] = { 0 };
+    used[FRAMEPROF_WAIT] = used[FRAMEPROF_IDLE] = 1;
+    for (int line = 0; line < HUD_LINES - 2; line++) {
+        int best = -1;
+        for (int p = 0; p < FRAMEPROF_PHASE_COUNT; p++) {
+            if (used[p]) continue;
+            if (best < 0 || hud_stats.phase[p].avg_ns > hud_stats.phase[best].avg_ns)
+                best = p;
+        }
+        if (best < 0) break;
+        used[best] = 1;
+        hud_line(tx, ty + 16 * (line + 2), phase_names[best],
+                 &hud_stats.phase[best], COLOR_TEXT_DIM);
+    }
+
+    /* Graph: one bar per frame, oldest on the left */
+    int gy = y0 + HUD_PAD * 2 + HUD_LINES * 16;
+    int gx = x0 + HUD_PAD;
+    uint32_t n = history_count;
+    uint32_t start = (history_head + FRAMEPROF_HISTORY - n) % FRAMEPROF_HISTORY;
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t ns = timer_tsc_to_ns(frame_total(history[(start + i) % FRAMEPROF_HISTORY]));
+        uint64_t h = ns * HUD_GRAPH_H / HUD_SCALE_NS;
+        if (h > HUD_GRAPH_H) h = HUD_GRAPH_H;
+        if (h == 0) h = 1;
+        int bx = gx + (int)(FRAMEPROF_HISTORY - n + i) * HUD_BAR_W;
+        fb_fill_rect((uint32_t)bx, (uint32_t)(gy + HUD_GRAPH_H - (int)h),
+                     HUD_BAR_W, (uint32_t)h, hud_bar_color(ns));
+    }
+
+    /* 60 fps guide */
+    int guide = gy + HUD_GRAPH_H - (int)(HUD_TARGET_NS * HUD_GRAPH_H / HUD_SCALE_NS);
+    gfx_draw_hline(gx, guide, FRAMEPROF_HISTORY * HUD_BAR_W, COLOR_BORDER);
+
+    fb_mark_dirty((uint32_t)x0, (uint32_t)y0, HUD_W, HUD_H);
+}
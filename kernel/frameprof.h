@@ -0,0 +1,87 @@
+/*
+ * PhantomOS Frame-Time Profiler
+ * "To Create, Not To Destroy"
+ *
+ * Splits every iteration of the desktop loop into phases and times each
+ * one with the TSC. The last FRAMEPROF_HISTORY frames are kept in a ring
+ * so min/avg/p99 can be reported per phase, and an optional HUD draws a
+ * frame-time graph in the corner of the screen.
+ *
+ * Usage, in the loop being measured:
+ *
+ *   frameprof_begin_frame();
+ *   input_drain();      frameprof_mark(FRAMEPROF_INPUT);
+ *   draw_panels();      frameprof_mark(FRAMEPROF_PANELS);
+ *   ...
+ *   hlt();              frameprof_mark(FRAMEPROF_IDLE);
+ *   frameprof_end_frame();
+ *
+ * frameprof_mark() charges the time since the previous mark to the phase.
+ */
+
+#ifndef PHANTOMOS_FRAMEPROF_H
+#define PHANTOMOS_FRAMEPROF_H
+
+#include <stdint.h>
+
+#define FRAMEPROF_HISTORY   128     /* Frames kept for statistics */
+
+/* Phases of desktop_run(), in loop order */
+enum frameprof_phase {
+    FRAMEPROF_INPUT = 0,    /* Input ring drain and key dispatch */
+    FRAMEPROF_PANELS,       /* Header, sidebar, app grid, dock, ... */
+    FRAMEPROF_WM,           /* Popup windows */
+    FRAMEPROF_USB,          /* USB hot-plug (and HID without an IRQ) */
+    FRAMEPROF_NET,          /* VirtIO-net RX processing */
+    FRAMEPROF_DRAWNET,      /* DrawNet peer sync */
+    FRAMEPROF_GROQ,         /* Groq response polling */
+    FRAMEPROF_GOVERNOR,     /* Periodic governor scan */
+    FRAMEPROF_MOUSE,        /* Mouse hit testing and clicks */
+    FRAMEPROF_ANIM,         /* Animation ticks */
+    FRAMEPROF_HUD,          /* This profiler's overlay */
+    FRAMEPROF_CURSOR,       /* Cursor drawing */
+    FRAMEPROF_WAIT,         /* fb_frame_wait() pacing */
+    FRAMEPROF_FLIP,         /* fb_flip() */
+    FRAMEPROF_IDLE,         /* hlt until the next interrupt */
+    FRAMEPROF_PHASE_COUNT
+};
+
+/* Per-phase statistics over the frame history, in nanoseconds */
+struct frameprof_phase_stats {
+    uint64_t min_ns;
+    uint64_t avg_ns;
+    uint64_t p99_ns;
+    uint64_t max_ns;
+};
+
+struct frameprof_stats {
+    uint32_t frames;                /* Frames in the history (<= HISTORY) */
+    uint64_t total_frames;          /* Frames recorded since reset */
+    struct frameprof_phase_stats phase[FRAMEPROF_PHASE_COUNT];
+    struct frameprof_phase_stats frame;     /* Whole-frame times */
+    struct frameprof_phase_stats busy;      /* Frame minus wait and idle */
+};
+
+/* Frame boundaries and phase marks */
+void frameprof_begin_frame(void);
+void frameprof_mark(enum frameprof_phase phase);
+void frameprof_end_frame(void);
+
+/* Compute statistics over the current history */
+void frameprof_get_stats(struct frameprof_stats *out);
+
+/* Phase name ("panels", "flip", ...) */
+const char *frameprof_phase_name(enum frameprof_phase phase);
+
+/* Drop all recorded frames */
+void frameprof_reset(void);
+
+/* Print per-phase min/avg/p99/max to the console */
+void frameprof_dump(void);
+
+/* On-screen HUD */
+void frameprof_set_hud(int enabled);
+int frameprof_hud_enabled(void);
+void frameprof_draw_hud(void);
+
+#endif /* PHANTOMOS_FRAMEPROF_H */
@@ -10,7 +10,11 @@
 #include "pmm.h"
 #include "heap.h"
 #include "ata.h"
+#include "usb_msc.h"
+#include "kinit.h"
 #include "lz4.h"
+#include "trace.h"
+#include "governor.h"
 #include <stdint.h>
 #include <stddef.h>
 
@@ -485,6 +489,8 @@ kgeofs_error_t kgeofs_content_store(kgeofs_volume_t *vol,
                                     size_t size,
                                     kgeofs_hash_t hash_out)
 {
+    TRACE_SCOPE(TRACE_ID_GEOFS_STORE, size, 0, 0);
+
     if (!vol || !data || !hash_out) {
         return KGEOFS_ERR_INVALID;
     }
@@ -580,6 +586,8 @@ kgeofs_error_t kgeofs_content_read(kgeofs_volume_t *vol,
                                    size_t buf_size,
                                    size_t *size_out)
 {
+    TRACE_SCOPE(TRACE_ID_GEOFS_READ, buf_size, 0, 0);
+
     if (!vol || !hash || !buf) {
         return KGEOFS_ERR_INVALID;
     }
@@ -749,6 +757,8 @@ kgeofs_error_t kgeofs_ref_create(kgeofs_volume_t *vol,
                                  const char *path,
                                  const kgeofs_hash_t content_hash)
 {
+    TRACE_SCOPE(TRACE_ID_GEOFS_REF_CREATE, 0, 0, 0);
+
     if (!vol || !path || !content_hash) {
         return KGEOFS_ERR_INVALID;
     }
@@ -812,6 +822,8 @@ kgeofs_error_t kgeofs_ref_resolve(kgeofs_volume_t *vol,
                                   const char *path,
                                   kgeofs_hash_t hash_out)
 {
+    TRACE_SCOPE(TRACE_ID_GEOFS_REF_RESOLVE, 0, 0, 0);
+
     if (!vol || !path || !hash_out) {
         return KGEOFS_ERR_INVALID;
     }
@@ -1325,6 +1337,8 @@ kgeofs_error_t kgeofs_file_write(kgeofs_volume_t *vol,
                                  const void *data,
                                  size_t size)
 {
+    TRACE_SCOPE(TRACE_ID_GEOFS_FILE_WRITE, size, 0, 0);
+
     if (!vol || !path || (!data && size > 0)) {
         return KGEOFS_ERR_INVALID;
     }
@@ -1334,6 +1348,11 @@ kgeofs_error_t kgeofs_file_write(kgeofs_volume_t *vol,
     if (existing && !existing->is_hidden) {
         kgeofs_error_t perr = check_permission(vol, existing, KGEOFS_PERM_WRITE);
         if (perr != KGEOFS_OK) return perr;
+
+        /* Replacing content is audited; the old version stays in history */
+        if (governor_check_filesystem(POLICY_FS_OVERWRITE, path,
+                                      vol->current_ctx.caps, NULL) == GOV_DENY)
+            return KGEOFS_ERR_PERM;
     }
 
     /* Quota check */
@@ -1357,6 +1376,8 @@ kgeofs_error_t kgeofs_file_read(kgeofs_volume_t *vol,
                                 size_t buf_size,
                                 size_t *size_out)
 {
+    TRACE_SCOPE(TRACE_ID_GEOFS_FILE_READ, buf_size, 0, 0);
+
     if (!vol || !path || !buf) {
         return KGEOFS_ERR_INVALID;
     }
@@ -2307,6 +2328,44 @@ int kgeofs_view_diff(kgeofs_volume_t *vol,
  *============================================================================*/
 
 #define ATA_SECTOR_SIZE 512
+#define BLK_CHUNK_SECTORS 128           /* Sectors per request (64 KB) */
+
+/* Block I/O: drive KGEOFS_DRIVE_USB is the USB mass-storage disk, anything
+ * else an ATA drive index */
+/* The drives are probed by deferred init steps; no I/O until they finish */
+static int blk_ready(uint8_t drive)
+{
+    return kinit_is_done(drive == KGEOFS_DRIVE_USB ? "xhci" : "ata");
+}
+
+static int blk_read(uint8_t drive, uint64_t lba, uint32_t count, void *buf)
+{
+    if (!blk_ready(drive))
+        return -1;
+    if (drive == KGEOFS_DRIVE_USB)
+        return usb_msc_read(lba, count, buf);
+    return ata_read_sectors(drive, lba, count, buf) == ATA_OK ? 0 : -1;
+}
+
+static int blk_write(uint8_t drive, uint64_t lba, uint32_t count,
+                     const void *buf)
+{
+    if (!blk_ready(drive))
+        return -1;
+    if (drive == KGEOFS_DRIVE_USB)
+        return usb_msc_write(lba, count, buf);
+    return ata_write_sectors(drive, lba, count, buf) == ATA_OK ? 0 : -1;
+}
+
+static void blk_flush(uint8_t drive)
+{
+    if (!blk_ready(drive))
+        return;
+    if (drive == KGEOFS_DRIVE_USB)
+        usb_msc_flush();
+    else
+        ata_flush(drive);
+}
 
 kgeofs_error_t kgeofs_file_export_ata(kgeofs_volume_t *vol,
                                        const char *path,
@@ -2336,18 +2395,30 @@ kgeofs_error_t kgeofs_file_export_ata(kgeofs_volume_t *vol,
         return err;
     }
 
-    /* Write to ATA in sector-sized chunks */
+    /* Whole sectors go straight from the buffer in multi-sector requests;
+     * only a partial final sector is staged and zero-padded */
+    uint64_t full_sectors = got / ATA_SECTOR_SIZE;
     uint64_t total_sectors = (got + ATA_SECTOR_SIZE - 1) / ATA_SECTOR_SIZE;
-    uint8_t sector_buf[ATA_SECTOR_SIZE];
+    uint64_t i = 0;
 
-    for (uint64_t i = 0; i < total_sectors; i++) {
-        memset(sector_buf, 0, ATA_SECTOR_SIZE);
-        size_t offset = (size_t)(i * ATA_SECTOR_SIZE);
-        size_t chunk = got - offset;
-        if (chunk > ATA_SECTOR_SIZE) chunk = ATA_SECTOR_SIZE;
-        memcpy(sector_buf, buf + offset, chunk);
+    while (i < full_sectors) {
+        uint32_t n = (uint32_t)(full_sectors - i);
+        if (n > BLK_CHUNK_SECTORS) n = BLK_CHUNK_SECTORS;
+        if (blk_write(drive, start_sector + i, n,
+                      buf + (size_t)(i * ATA_SECTOR_SIZE)) != 0) {
+            kfree(buf);
+            if (sectors_written) *sectors_written = i;
+            return KGEOFS_ERR_IO;
+        }
+        i += n;
+    }
 
-        if (ata_write_sectors(drive, start_sector + i, 1, sector_buf) != 0) {
+    if (i < total_sectors) {
+        uint8_t sector_buf[ATA_SECTOR_SIZE];
+        memset(sector_buf, 0, ATA_SECTOR_SIZE);
+        memcpy(sector_buf, buf + (size_t)(i * ATA_SECTOR_SIZE),
+               got - (size_t)(i * ATA_SECTOR_SIZE));
+        if (blk_write(drive, start_sector + i, 1, sector_buf) != 0) {
             kfree(buf);
             if (sectors_written) *sectors_written = i;
             return KGEOFS_ERR_IO;
@@ -2371,14 +2442,16 @@ kgeofs_error_t kgeofs_file_import_ata(kgeofs_volume_t *vol,
     uint8_t *buf = kmalloc(total_bytes);
     if (!buf) return KGEOFS_ERR_NOMEM;
 
-    /* Read from ATA */
-    uint8_t sector_buf[ATA_SECTOR_SIZE];
-    for (uint64_t i = 0; i < num_sectors; i++) {
-        if (ata_read_sectors(drive, start_sector + i, 1, sector_buf) != 0) {
+    /* Read straight into the file buffer */
+    for (uint64_t i = 0; i < num_sectors; ) {
+        uint32_t n = (uint32_t)(num_sectors - i);
+        if (n > BLK_CHUNK_SECTORS) n = BLK_CHUNK_SECTORS;
+        if (blk_read(drive, start_sector + i, n,
+                     buf + (size_t)(i * ATA_SECTOR_SIZE)) != 0) {
             kfree(buf);
             return KGEOFS_ERR_IO;
         }
-        memcpy(buf + (size_t)(i * ATA_SECTOR_SIZE), sector_buf, ATA_SECTOR_SIZE);
+        i += n;
     }
 
     /* Write as file to GeoFS */
@@ -2419,7 +2492,7 @@ static kgeofs_error_t persist_write_region(struct kgeofs_ram_region *region,
             remaining -= chunk;
 
             if (buf_pos == ATA_SECTOR_SIZE) {
-                if (ata_write_sectors(drive, sector, 1, sector_buf) != 0)
+                if (blk_write(drive, sector, 1, sector_buf) != 0)
                     return KGEOFS_ERR_IO;
                 sector++;
                 buf_pos = 0;
@@ -2431,7 +2504,7 @@ static kgeofs_error_t persist_write_region(struct kgeofs_ram_region *region,
 
     /* Flush partial final sector */
     if (buf_pos > 0) {
-        if (ata_write_sectors(drive, sector, 1, sector_buf) != 0)
+        if (blk_write(drive, sector, 1, sector_buf) != 0)
             return KGEOFS_ERR_IO;
         sector++;
     }
@@ -2460,7 +2533,7 @@ static kgeofs_error_t persist_read_region(uint8_t drive,
     uint64_t bytes_left = used_bytes;
 
     for (uint64_t s = 0; s < sector_count && bytes_left > 0; s++) {
-        if (ata_read_sectors(drive, start_sector + s, 1, sector_buf) != 0) {
+        if (blk_read(drive, start_sector + s, 1, sector_buf) != 0) {
             free_region(region);
             return KGEOFS_ERR_IO;
         }
@@ -2684,6 +2757,8 @@ kgeofs_error_t kgeofs_volume_save(kgeofs_volume_t *vol,
                                    uint8_t drive,
                                    uint64_t start_sector)
 {
+    TRACE_SCOPE(TRACE_ID_GEOFS_SAVE, drive, 0, 0);
+
     if (!vol) return KGEOFS_ERR_INVALID;
 
     /* Compute region sizes */
@@ -2724,7 +2799,7 @@ kgeofs_error_t kgeofs_volume_save(kgeofs_volume_t *vol,
     hdr.view_sector_count = view_sectors;
 
     /* Write superblock */
-    if (ata_write_sectors(drive, start_sector, 1, &hdr) != 0)
+    if (blk_write(drive, start_sector, 1, &hdr) != 0)
         return KGEOFS_ERR_IO;
 
     /* Write content region */
@@ -2745,7 +2820,7 @@ kgeofs_error_t kgeofs_volume_save(kgeofs_volume_t *vol,
                                 start_sector + hdr.view_start_sector, &written);
     if (err != KGEOFS_OK) return err;
 
-    ata_flush(drive);
+    blk_flush(drive);
 
     uint64_t total_sectors = 1 + content_sectors + ref_sectors + view_sectors;
     kprintf("[GeoFS] Saved: %lu sectors (%lu KB) to drive %u sector %lu\n",
@@ -2769,13 +2844,15 @@ kgeofs_error_t kgeofs_volume_load(uint8_t drive,
                                    uint64_t start_sector,
                                    kgeofs_volume_t **vol_out)
 {
+    TRACE_SCOPE(TRACE_ID_GEOFS_LOAD, drive, 0, 0);
+
     if (!vol_out) return KGEOFS_ERR_INVALID;
 
     /* Read superblock */
     struct kgeofs_persist_header hdr;
     memset(&hdr, 0, sizeof(hdr));
 
-    if (ata_read_sectors(drive, start_sector, 1, &hdr) != 0)
+    if (blk_read(drive, start_sector, 1, &hdr) != 0)
         return KGEOFS_ERR_IO;
 
     /* Validate */
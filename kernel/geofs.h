@@ -777,6 +777,9 @@ kgeofs_error_t kgeofs_quota_usage(kgeofs_volume_t *vol,
  * ATA Import/Export Functions
  *============================================================================*/
 
+/* Drive number selecting the USB mass-storage disk instead of an ATA drive */
+#define KGEOFS_DRIVE_USB    0x80
+
 /*
  * Export a file to ATA disk (writes content to consecutive sectors)
  * Returns number of sectors written
@@ -848,7 +851,7 @@ struct kgeofs_persist_header {
  * Serializes all three regions (content, refs, views) and metadata.
  *
  * @vol:           Volume to save
- * @drive:         ATA drive index (0-3)
+ * @drive:         ATA drive index (0-3) or KGEOFS_DRIVE_USB
  * @start_sector:  First sector on disk (default: 2048 = 1MB offset)
  */
 kgeofs_error_t kgeofs_volume_save(kgeofs_volume_t *vol,
@@ -859,7 +862,7 @@ kgeofs_error_t kgeofs_volume_save(kgeofs_volume_t *vol,
  * Load volume from ATA disk
  * Deserializes regions and rebuilds in-memory indices.
  *
- * @drive:         ATA drive index (0-3)
+ * @drive:         ATA drive index (0-3) or KGEOFS_DRIVE_USB
  * @start_sector:  First sector on disk
  * @vol_out:       Output: loaded volume
  */
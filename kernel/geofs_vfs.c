@@ -46,14 +46,25 @@ struct geofs_vfs_inode_data {
     geofs_volume_t     *volume;                 /* Reference to volume */
 };
 
+/* Files are written in chunks of this size, each stored as it fills */
+#define GEOFS_VFS_CHUNK_SIZE    (256 * 1024)
+
 /*
- * GeoFS file data - per-open-file state
+ * GeoFS file data - per-open-file state. A file is its stored chunks
+ * followed by a buffered tail of less than a chunk; reads map one chunk
+ * at a time, so neither reads nor writes hold the whole file.
  */
 struct geofs_vfs_file_data {
-    char               *content;                /* Buffered content */
-    size_t              content_size;           /* Size of content */
-    size_t              content_capacity;       /* Allocated capacity */
-    int                 dirty;                  /* Modified since open */
+    struct geofs_chunk *chunks;                 /* Stored chunks, in order */
+    size_t              chunk_count;
+    size_t              chunk_capacity;
+    uint64_t            stored_size;            /* Bytes in chunks */
+    char               *tail;                   /* Written, not yet a chunk */
+    size_t              tail_size;
+    struct geofs_content_view view;             /* Chunk being read */
+    size_t              view_chunk;
+    uint64_t            content_size;           /* Size of content */
+    int                 dirty;                  /* Modified since last commit */
     char                path[VFS_MAX_PATH];     /* Path for writes */
     geofs_volume_t     *volume;
 };
@@ -127,6 +138,95 @@ static void build_child_path(const char *dir_path, const char *name,
  * FILE OPERATIONS
  * ══════════════════════════════════════════════════════════════════════════════ */
 
+/* Store the tail as the file's next chunk */
+static vfs_error_t file_store_tail(struct geofs_vfs_file_data *fdata) {
+    if (fdata->chunk_count == fdata->chunk_capacity) {
+        size_t cap = fdata->chunk_capacity ? fdata->chunk_capacity * 2 : 16;
+        struct geofs_chunk *chunks = realloc(fdata->chunks, cap * sizeof(*chunks));
+        if (!chunks) return VFS_ERR_NOMEM;
+        fdata->chunks = chunks;
+        fdata->chunk_capacity = cap;
+    }
+
+    struct geofs_chunk *chunk = &fdata->chunks[fdata->chunk_count];
+    if (geofs_content_store(fdata->volume, fdata->tail, fdata->tail_size,
+                            chunk->hash) != GEOFS_OK) {
+        return VFS_ERR_IO;
+    }
+    chunk->offset = fdata->stored_size;
+    chunk->size = fdata->tail_size;
+    fdata->chunk_count++;
+    fdata->stored_size += fdata->tail_size;
+    fdata->tail_size = 0;
+    return VFS_OK;
+}
+
+/* Before the first append: a short last chunk goes back into the tail, so
+ * appends fill it up instead of leaving a run of small chunks */
+static vfs_error_t file_reopen_tail(struct geofs_vfs_file_data *fdata) {
+    if (fdata->chunk_count == 0) return VFS_OK;
+    struct geofs_chunk *last = &fdata->chunks[fdata->chunk_count - 1];
+    if (last->size >= GEOFS_VFS_CHUNK_SIZE) return VFS_OK;
+
+    size_t got = 0;
+    if (geofs_content_read(fdata->volume, last->hash, fdata->tail, last->size,
+                           &got) != GEOFS_OK || got != last->size) {
+        return VFS_ERR_IO;
+    }
+    if (fdata->view_chunk == fdata->chunk_count - 1) {
+        geofs_content_unmap(&fdata->view);
+    }
+    fdata->tail_size = got;
+    fdata->stored_size -= got;
+    fdata->chunk_count--;
+    return VFS_OK;
+}
+
+/*
+ * Point the file's path at what has been written: the chunks and the
+ * tail, stored as one more chunk. A single chunk is referenced directly,
+ * more through a manifest, so each commit stores at most a chunk of data
+ * however large the file. The tail stays buffered for later appends.
+ */
+static vfs_error_t file_commit(struct vfs_file *file, struct geofs_vfs_file_data *fdata) {
+    size_t count = fdata->chunk_count;
+    geofs_hash_t *hashes = malloc((count + 1) * sizeof(geofs_hash_t));
+    if (!hashes) return VFS_ERR_NOMEM;
+    for (size_t i = 0; i < count; i++) {
+        memcpy(hashes[i], fdata->chunks[i].hash, GEOFS_HASH_SIZE);
+    }
+
+    geofs_hash_t hash;
+    geofs_error_t err = GEOFS_OK;
+    if (fdata->tail_size > 0 || count == 0) {
+        err = geofs_content_store(fdata->volume, fdata->tail ? fdata->tail : "",
+                                  fdata->tail_size, hashes[count++]);
+    }
+    if (err == GEOFS_OK) {
+        if (count == 1) {
+            memcpy(hash, hashes[0], GEOFS_HASH_SIZE);
+        } else {
+            err = geofs_manifest_store(fdata->volume, (const geofs_hash_t *)hashes,
+                                       count, hash);
+        }
+    }
+    free(hashes);
+    if (err == GEOFS_OK) {
+        err = geofs_ref_create(fdata->volume, fdata->path, hash);
+    }
+    if (err != GEOFS_OK) return VFS_ERR_IO;
+    fdata->dirty = 0;
+
+    /* Update inode */
+    struct geofs_vfs_inode_data *idata = file->inode->fs_data;
+    if (idata) {
+        memcpy(idata->content_hash, hash, GEOFS_HASH_SIZE);
+        idata->size = fdata->content_size;
+    }
+    file->inode->size = fdata->content_size;
+    return VFS_OK;
+}
+
 static vfs_error_t geofs_vfs_open(struct vfs_inode *inode, struct vfs_file *file) {
     struct geofs_vfs_inode_data *idata = inode->fs_data;
     if (!idata) return VFS_ERR_IO;
@@ -138,26 +238,23 @@ static vfs_error_t geofs_vfs_open(struct vfs_inode *inode, struct vfs_file *file
     strncpy(fdata->path, idata->path, VFS_MAX_PATH - 1);
     fdata->volume = idata->volume;
 
-    /* Load existing content if file exists */
+    /* Only the chunk list is loaded; chunks are mapped as they are read */
     if (idata->size > 0) {
-        fdata->content = malloc(idata->size + 1);
-        if (!fdata->content) {
+        size_t count = 0;
+        geofs_error_t err = geofs_content_chunks(idata->volume, idata->content_hash,
+                                                 &fdata->chunks, &count);
+        if (err == GEOFS_OK) {
+            fdata->chunk_count = fdata->chunk_capacity = count;
+            if (count > 0) {
+                struct geofs_chunk *last = &fdata->chunks[count - 1];
+                fdata->stored_size = last->offset + last->size;
+            }
+            fdata->content_size = fdata->stored_size;
+        } else if (err == GEOFS_ERR_NOMEM) {
             free(fdata);
             return VFS_ERR_NOMEM;
         }
-
-        size_t got = 0;
-        geofs_error_t err = geofs_content_read(idata->volume, idata->content_hash,
-                                                fdata->content, idata->size, &got);
-        if (err == GEOFS_OK) {
-            fdata->content_size = got;
-            fdata->content_capacity = idata->size + 1;
-            fdata->content[got] = '\0';
-        } else {
-            /* File doesn't exist yet or read failed - start empty */
-            fdata->content_size = 0;
-            fdata->content_capacity = idata->size + 1;
-        }
+        /* Otherwise the file doesn't exist yet or the read failed - start empty */
     }
 
     file->private_data = fdata;
@@ -169,29 +266,33 @@ static vfs_error_t geofs_vfs_close(struct vfs_file *file) {
     if (!fdata) return VFS_OK;
 
     /* If dirty, write content to GeoFS */
-    if (fdata->dirty && fdata->content && fdata->content_size > 0) {
-        geofs_hash_t hash;
-        geofs_error_t err = geofs_content_store(fdata->volume, fdata->content,
-                                                 fdata->content_size, hash);
-        if (err == GEOFS_OK) {
-            /* Update reference */
-            geofs_ref_create(fdata->volume, fdata->path, hash);
-
-            /* Update inode */
-            struct geofs_vfs_inode_data *idata = file->inode->fs_data;
-            if (idata) {
-                memcpy(idata->content_hash, hash, GEOFS_HASH_SIZE);
-                idata->size = fdata->content_size;
-            }
-            file->inode->size = fdata->content_size;
-        }
+    vfs_error_t err = VFS_OK;
+    if (fdata->dirty) {
+        err = file_commit(file, fdata);
     }
 
-    free(fdata->content);
+    geofs_content_unmap(&fdata->view);
+    free(fdata->chunks);
+    free(fdata->tail);
     free(fdata);
     file->private_data = NULL;
 
-    return VFS_OK;
+    return err;
+}
+
+/* Index of the chunk holding byte pos, which must be below stored_size */
+static size_t file_find_chunk(const struct geofs_vfs_file_data *fdata, uint64_t pos) {
+    size_t lo = 0, hi = fdata->chunk_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const struct geofs_chunk *c = &fdata->chunks[mid];
+        if (c->offset + c->size <= pos) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
 }
 
 static ssize_t geofs_vfs_read(struct vfs_file *file, void *buf, size_t count) {
@@ -203,39 +304,76 @@ static ssize_t geofs_vfs_read(struct vfs_file *file, void *buf, size_t count) {
         return 0;  /* EOF */
     }
 
-    size_t remaining = fdata->content_size - file->pos;
+    uint64_t remaining = fdata->content_size - file->pos;
     size_t to_read = count < remaining ? count : remaining;
+    size_t done = 0;
+
+    while (done < to_read) {
+        uint64_t at = file->pos + done;
+        size_t n = to_read - done;
 
-    if (fdata->content && to_read > 0) {
-        memcpy(buf, fdata->content + file->pos, to_read);
+        if (at >= fdata->stored_size) {
+            /* Still in the tail */
+            memcpy((char *)buf + done, fdata->tail + (at - fdata->stored_size), n);
+        } else {
+            size_t i = file_find_chunk(fdata, at);
+            const struct geofs_chunk *c = &fdata->chunks[i];
+            if (!fdata->view.mapping || fdata->view_chunk != i) {
+                geofs_content_unmap(&fdata->view);
+                if (geofs_content_map(fdata->volume, c->hash, &fdata->view) != GEOFS_OK) {
+                    return done ? (ssize_t)done : VFS_ERR_IO;
+                }
+                fdata->view_chunk = i;
+            }
+            uint64_t off = at - c->offset;
+            if (n > c->size - off) n = c->size - off;
+            if (off + n > fdata->view.size) {
+                return done ? (ssize_t)done : VFS_ERR_IO;
+            }
+            memcpy((char *)buf + done, (const char *)fdata->view.data + off, n);
+        }
+        done += n;
     }
 
-    return to_read;
+    return done;
 }
 
 static ssize_t geofs_vfs_write(struct vfs_file *file, const void *buf, size_t count) {
     struct geofs_vfs_file_data *fdata = file->private_data;
     if (!fdata) return VFS_ERR_IO;
 
-    /* In Phantom, all writes are appends */
-    size_t new_size = fdata->content_size + count;
-
-    /* Grow buffer if needed */
-    if (new_size > fdata->content_capacity) {
-        size_t new_cap = new_size * 2;
-        if (new_cap < 1024) new_cap = 1024;
-
-        char *new_content = realloc(fdata->content, new_cap);
-        if (!new_content) return VFS_ERR_NOMEM;
-
-        fdata->content = new_content;
-        fdata->content_capacity = new_cap;
+    /* First write: room for a whole chunk, and the last chunk if short */
+    if (!fdata->tail && count > 0) {
+        fdata->tail = malloc(GEOFS_VFS_CHUNK_SIZE);
+        if (!fdata->tail) return VFS_ERR_NOMEM;
+        vfs_error_t err = file_reopen_tail(fdata);
+        if (err != VFS_OK) {
+            free(fdata->tail);
+            fdata->tail = NULL;
+            return err;
+        }
     }
 
-    /* Append data */
-    memcpy(fdata->content + fdata->content_size, buf, count);
-    fdata->content_size = new_size;
-    fdata->dirty = 1;
+    /* In Phantom, all writes are appends */
+    size_t done = 0;
+    while (done < count) {
+        size_t n = GEOFS_VFS_CHUNK_SIZE - fdata->tail_size;
+        if (n > count - done) n = count - done;
+        memcpy(fdata->tail + fdata->tail_size, (const char *)buf + done, n);
+        fdata->tail_size += n;
+
+        /* A full tail is stored as a chunk at once */
+        if (fdata->tail_size == GEOFS_VFS_CHUNK_SIZE) {
+            vfs_error_t err = file_store_tail(fdata);
+            if (err != VFS_OK) {
+                fdata->tail_size -= n;
+                return done ? (ssize_t)done : err;
+            }
+        }
+        done += n;
+        fdata->content_size += n;
+        fdata->dirty = 1;
+    }
 
     return count;
 }
@@ -270,27 +408,8 @@ static vfs_error_t geofs_vfs_sync(struct vfs_file *file) {
     struct geofs_vfs_file_data *fdata = file->private_data;
     if (!fdata || !fdata->dirty) return VFS_OK;
 
-    /* Write content to GeoFS */
-    if (fdata->content && fdata->content_size > 0) {
-        geofs_hash_t hash;
-        geofs_error_t err = geofs_content_store(fdata->volume, fdata->content,
-                                                 fdata->content_size, hash);
-        if (err == GEOFS_OK) {
-            geofs_ref_create(fdata->volume, fdata->path, hash);
-            fdata->dirty = 0;
-
-            /* Update inode */
-            struct geofs_vfs_inode_data *idata = file->inode->fs_data;
-            if (idata) {
-                memcpy(idata->content_hash, hash, GEOFS_HASH_SIZE);
-                idata->size = fdata->content_size;
-            }
-        } else {
-            return VFS_ERR_IO;
-        }
-    }
-
-    return VFS_OK;
+    /* Store the tail and commit the chunks; stored chunks aren't rewritten */
+    return file_commit(file, fdata);
 }
 
 static const struct vfs_file_operations geofs_vfs_file_ops = {
@@ -452,6 +571,7 @@ static struct vfs_dentry *geofs_vfs_lookup(struct vfs_inode *dir, const char *na
     inode->fops = idata->is_directory ? &geofs_vfs_dir_ops : &geofs_vfs_file_ops;
     inode->ops = idata->is_directory ? &geofs_vfs_inode_ops : NULL;
     inode->size = idata->size;
+    inode->sb = dir->sb;
     inode->created = geofs_vfs_time_now();
     inode->modified = inode->created;
     inode->accessed = inode->created;
@@ -691,6 +811,12 @@ static void geofs_vfs_unmount(struct vfs_superblock *sb) {
     }
 }
 
+/* The kernel also creates refs directly, so misses are checked against the volume */
+static uint64_t geofs_vfs_generation(struct vfs_superblock *sb) {
+    struct geofs_vfs_sb_data *sb_data = sb->fs_data;
+    return geofs_ref_generation(sb_data->volume);
+}
+
 /* ══════════════════════════════════════════════════════════════════════════════
  * GLOBAL FILESYSTEM TYPE
  * ══════════════════════════════════════════════════════════════════════════════ */
@@ -700,6 +826,7 @@ struct vfs_fs_type geofs_vfs_type = {
     .flags = 0,
     .mount = geofs_vfs_mount,
     .unmount = geofs_vfs_unmount,
+    .generation = geofs_vfs_generation,
     .next = NULL,
 };
 
@@ -3,9 +3,19 @@
  * "To Create, Not To Destroy"
  *
  * Implementation of the policy enforcement layer.
+ *
+ * A check is split in two: a pure decision (verdict, reason, whether to
+ * audit) computed from the policy, caps and flags, and the bookkeeping
+ * that applies it. Decisions are memoized in a direct-mapped verdict cache
+ * so a repeated check (the same write path, over and over) costs a hash,
+ * one compare and the counters. Audit records are fixed-size binary
+ * records in a lock-free ring; reasons are interned IDs, not strings.
  */
 
 #include "governor.h"
+#include "idt.h"
+#include "io.h"
+#include "timer.h"
 #include <stdint.h>
 #include <stddef.h>
 
@@ -18,12 +28,62 @@ extern uint64_t timer_get_ticks(void);
 extern void *memset(void *s, int c, size_t n);
 extern void *memcpy(void *dest, const void *src, size_t n);
 extern size_t strlen(const char *s);
-extern char *strcpy(char *dest, const char *src);
-extern char *strncpy(char *dest, const char *src, size_t n);
 
 /* From process.h - get current PID */
 extern uint32_t process_getpid(void);
 
+/*============================================================================
+ * Interned Reasons
+ *============================================================================*/
+
+/* Built-in reasons; IDs are fixed at compile time */
+enum {
+    R_NONE = 0,
+    R_MEM_FREE_KERNEL,
+    R_MEM_FREE_DENIED,
+    R_MEM_OVERWRITE,
+    R_PROC_KILL_STRICT,
+    R_PROC_KILL_KERNEL,
+    R_PROC_KILL_DENIED,
+    R_PROC_EXIT,
+    R_FS_DELETE,
+    R_FS_TRUNCATE,
+    R_FS_OVERWRITE,
+    R_FS_HIDE,
+    R_FS_PERM_DENIED,
+    R_FS_QUOTA_EXCEEDED,
+    R_BUILTIN_COUNT
+};
+
+static const char *const builtin_reasons[R_BUILTIN_COUNT] = {
+    [R_NONE]              = "",
+    [R_MEM_FREE_KERNEL]   = "Kernel memory free (permitted)",
+    [R_MEM_FREE_DENIED]   = "Memory free denied: insufficient capability",
+    [R_MEM_OVERWRITE]     = "Memory overwrite (audited)",
+    [R_PROC_KILL_STRICT]  = "Process kill denied: use suspension or dormancy",
+    [R_PROC_KILL_KERNEL]  = "Process termination (kernel, audited)",
+    [R_PROC_KILL_DENIED]  = "Process kill denied: insufficient capability",
+    [R_PROC_EXIT]         = "Process graceful exit",
+    [R_FS_DELETE]         = "Delete transformed to hide (Prime Directive)",
+    [R_FS_TRUNCATE]       = "Truncate denied: creates data loss. Create new version.",
+    [R_FS_OVERWRITE]      = "File overwrite (GeoFS preserves history)",
+    [R_FS_HIDE]           = "File hidden (preserved in history)",
+    [R_FS_PERM_DENIED]    = "Permission denied",
+    [R_FS_QUOTA_EXCEEDED] = "Quota exceeded",
+};
+
+/*
+ * reason_table[id] is the string for every published ID; reasons interned
+ * at runtime are copied into reason_pool. reason_index is an open-addressed
+ * hash (ID + 1, 0 = empty) so interning a known string is one hash probe.
+ */
+#define REASON_INDEX_SIZE   (GOVERNOR_MAX_REASONS * 2)
+
+static const char *reason_table[GOVERNOR_MAX_REASONS];
+static char reason_pool[GOVERNOR_MAX_REASONS][GOVERNOR_MAX_REASON];
+static uint16_t reason_index[REASON_INDEX_SIZE];
+static int reason_count = 0;
+
 /*============================================================================
  * Governor State
  *============================================================================*/
@@ -37,11 +97,61 @@ static uint32_t gov_flags = 0;
 /* Statistics (append-only, never reset) */
 static struct gov_stats gov_stats;
 
-/* Audit trail (circular buffer) */
-static struct gov_audit_entry audit_buffer[GOVERNOR_AUDIT_SIZE];
-static int audit_head = 0;      /* Next write position */
-static int audit_count = 0;     /* Total entries (max GOVERNOR_AUDIT_SIZE) */
-static uint64_t audit_sequence = 0;  /* Monotonic sequence number */
+/*
+ * Audit ring. Writers reserve a sequence number with one atomic add, fill
+ * the slot, then publish it by storing seq + 1 (0 marks a slot being
+ * written). There is one ring because the kernel runs on a single CPU;
+ * IRQ handlers and preempted tasks may still interleave writes.
+ */
+struct gov_audit_record {
+    uint64_t seq;               /* Sequence + 1 once published */
+    uint64_t tick;
+    uint64_t arg1;
+    uint64_t arg2;
+    uint32_t pid;
+    uint16_t reason;            /* Interned reason ID */
+    uint16_t domain;
+    uint8_t  policy;
+    uint8_t  verdict;
+    uint8_t  reserved[6];
+};
+
+#define AUDIT_MASK          (GOVERNOR_AUDIT_SIZE - 1)
+
+static struct gov_audit_record audit_ring[GOVERNOR_AUDIT_SIZE];
+static uint64_t audit_head = 0;         /* Next sequence number */
+
+/* When a decision is written to the audit ring */
+#define LOG_NEVER           0
+#define LOG_ALWAYS          1
+#define LOG_AUDIT_ALL       2           /* Only with GOV_FLAG_AUDIT_ALL */
+
+/* Which violation counter a denial bumps */
+#define VIOL_NONE           0
+#define VIOL_MEMORY         1
+#define VIOL_PROCESS        2
+#define VIOL_FS             3
+
+struct gov_decision {
+    uint8_t  verdict;
+    uint8_t  log;
+    uint8_t  violation;
+    uint8_t  report;            /* Copy the reason to the caller */
+    uint16_t reason;
+};
+
+/* Verdict cache; an entry is valid only for the current generation */
+struct gov_cache_entry {
+    uint32_t            gen;
+    uint32_t            pid;
+    uint32_t            path_hash;
+    gov_caps_t          caps;
+    uint32_t            policy;
+    struct gov_decision d;
+};
+
+static struct gov_cache_entry verdict_cache[GOVERNOR_CACHE_SIZE];
+static uint32_t cache_gen = 1;
 
 /*============================================================================
  * Helper Functions
@@ -62,36 +172,163 @@ static void safe_strcpy(char *dest, const char *src, size_t max)
     dest[len] = '\0';
 }
 
+/* FNV-1a, bounded to the reason length that is actually stored */
+static uint32_t hash_string(const char *s, size_t max)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; s[i] && i < max; i++) {
+        h ^= (uint8_t)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int reason_equal(const char *interned, const char *s)
+{
+    size_t i = 0;
+    for (; i < GOVERNOR_MAX_REASON - 1 && s[i]; i++) {
+        if (interned[i] != s[i])
+            return 0;
+    }
+    return interned[i] == '\0';
+}
+
+/* Caller holds interrupts off */
+static void reason_index_insert(uint16_t id)
+{
+    uint32_t slot = hash_string(reason_table[id], GOVERNOR_MAX_REASON - 1);
+    for (;;) {
+        slot &= REASON_INDEX_SIZE - 1;
+        if (reason_index[slot] == 0) {
+            reason_index[slot] = (uint16_t)(id + 1);
+            return;
+        }
+        slot++;
+    }
+}
+
+static void reasons_init(void)
+{
+    memset(reason_index, 0, sizeof(reason_index));
+    for (int i = 0; i < R_BUILTIN_COUNT; i++) {
+        reason_table[i] = builtin_reasons[i];
+        if (i != R_NONE)
+            reason_index_insert((uint16_t)i);
+    }
+    __atomic_store_n(&reason_count, R_BUILTIN_COUNT, __ATOMIC_RELEASE);
+}
+
 /* Record an audit entry */
 static void audit_add(gov_policy_t policy,
                       gov_verdict_t verdict,
                       uint32_t domain,
                       uint64_t arg1,
                       uint64_t arg2,
-                      const char *reason)
+                      uint16_t reason)
 {
-    struct gov_audit_entry *entry = &audit_buffer[audit_head];
-
-    entry->sequence = audit_sequence++;
-    entry->timestamp = timer_get_ticks();
-    entry->policy = policy;
-    entry->verdict = verdict;
-    entry->pid = process_getpid();
-    entry->domain = domain;
-    entry->arg1 = arg1;
-    entry->arg2 = arg2;
-
-    if (reason) {
-        safe_strcpy(entry->reason, reason, GOVERNOR_MAX_REASON);
-    } else {
-        entry->reason[0] = '\0';
+    uint64_t seq = __atomic_fetch_add(&audit_head, 1, __ATOMIC_RELAXED);
+    struct gov_audit_record *rec = &audit_ring[seq & AUDIT_MASK];
+
+    __atomic_store_n(&rec->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    rec->tick = timer_get_ticks();
+    rec->arg1 = arg1;
+    rec->arg2 = arg2;
+    rec->pid = process_getpid();
+    rec->reason = reason;
+    rec->domain = (uint16_t)domain;
+    rec->policy = (uint8_t)policy;
+    rec->verdict = (uint8_t)verdict;
+
+    __atomic_store_n(&rec->seq, seq + 1, __ATOMIC_RELEASE);
+    gov_stats.audit_records++;
+}
+
+static uint32_t cache_slot(uint32_t policy, uint32_t pid,
+                           uint32_t path_hash, gov_caps_t caps)
+{
+    uint32_t h = path_hash ^ (pid * 0x9E3779B1u) ^
+                 (caps * 0x85EBCA6Bu) ^ (policy * 0xC2B2AE35u);
+    h ^= h >> 15;
+    return h & (GOVERNOR_CACHE_SIZE - 1);
+}
+
+static int cache_lookup(uint32_t slot, uint32_t policy, uint32_t pid,
+                        uint32_t path_hash, gov_caps_t caps,
+                        struct gov_decision *d)
+{
+    int hit = 0;
+    uint64_t irq = irq_save();
+    const struct gov_cache_entry *e = &verdict_cache[slot];
+    if (e->gen == cache_gen && e->policy == policy && e->pid == pid &&
+        e->path_hash == path_hash && e->caps == caps) {
+        *d = e->d;
+        hit = 1;
     }
+    irq_restore(irq);
+    return hit;
+}
 
-    /* Advance circular buffer */
-    audit_head = (audit_head + 1) % GOVERNOR_AUDIT_SIZE;
-    if (audit_count < GOVERNOR_AUDIT_SIZE) {
-        audit_count++;
+static void cache_store(uint32_t slot, uint32_t policy, uint32_t pid,
+                        uint32_t path_hash, gov_caps_t caps,
+                        const struct gov_decision *d)
+{
+    uint64_t irq = irq_save();
+    struct gov_cache_entry *e = &verdict_cache[slot];
+    e->gen = cache_gen;
+    e->policy = policy;
+    e->pid = pid;
+    e->path_hash = path_hash;
+    e->caps = caps;
+    e->d = *d;
+    irq_restore(irq);
+}
+
+/*
+ * Apply a decision: statistics, audit record and the caller's reason
+ * buffer. Shared by the cached and evaluated paths.
+ */
+static gov_verdict_t apply_decision(const struct gov_decision *d,
+                                    gov_policy_t op,
+                                    uint32_t domain,
+                                    uint64_t arg1,
+                                    uint64_t arg2,
+                                    char *reason)
+{
+    gov_verdict_t verdict = (gov_verdict_t)d->verdict;
+
+    switch (verdict) {
+    case GOV_ALLOW:
+    case GOV_AUDIT:
+        gov_stats.total_allowed++;
+        break;
+    case GOV_DENY:
+        gov_stats.total_denied++;
+        break;
+    case GOV_TRANSFORM:
+        gov_stats.total_transformed++;
+        break;
     }
+
+    switch (d->violation) {
+    case VIOL_MEMORY:  gov_stats.violations_memory++;  break;
+    case VIOL_PROCESS: gov_stats.violations_process++; break;
+    case VIOL_FS:      gov_stats.violations_fs++;      break;
+    default:           break;
+    }
+
+    if (d->log == LOG_ALWAYS ||
+        (d->log == LOG_AUDIT_ALL && (gov_flags & GOV_FLAG_AUDIT_ALL))) {
+        audit_add(op, verdict, domain, arg1, arg2, d->reason);
+    }
+
+    /* Copy reason if requested */
+    if (reason && d->report) {
+        safe_strcpy(reason, reason_table[d->reason], GOVERNOR_MAX_REASON);
+    }
+
+    return verdict;
 }
 
 /*============================================================================
@@ -106,10 +343,11 @@ void governor_init(void)
 
     /* Initialize state */
     memset(&gov_stats, 0, sizeof(gov_stats));
-    memset(audit_buffer, 0, sizeof(audit_buffer));
+    memset(audit_ring, 0, sizeof(audit_ring));
+    memset(verdict_cache, 0, sizeof(verdict_cache));
     audit_head = 0;
-    audit_count = 0;
-    audit_sequence = 0;
+    cache_gen = 1;
+    reasons_init();
 
     /* Default flags: verbose logging */
     gov_flags = GOV_FLAG_VERBOSE;
@@ -127,6 +365,8 @@ int governor_is_initialized(void)
 void governor_set_flags(uint32_t flags)
 {
     gov_flags = flags;
+    /* Cached decisions depend on the flags */
+    __atomic_add_fetch(&cache_gen, 1, __ATOMIC_RELAXED);
 }
 
 uint32_t governor_get_flags(void)
@@ -138,16 +378,9 @@ uint32_t governor_get_flags(void)
  * Policy Check: Memory Operations
  *============================================================================*/
 
-gov_verdict_t governor_check_memory(gov_policy_t op,
-                                     void *ptr,
-                                     size_t size,
-                                     gov_caps_t caps,
-                                     char *reason)
+static struct gov_decision decide_memory(gov_policy_t op, gov_caps_t caps)
 {
-    gov_verdict_t verdict = GOV_ALLOW;
-    const char *deny_reason = NULL;
-
-    gov_stats.total_checks++;
+    struct gov_decision d = { GOV_ALLOW, LOG_NEVER, VIOL_NONE, 0, R_NONE };
 
     switch (op) {
     case POLICY_MEM_FREE:
@@ -161,27 +394,15 @@ gov_verdict_t governor_check_memory(gov_policy_t op,
          */
         if (caps & (GOV_CAP_MEM_FREE | GOV_CAP_KERNEL)) {
             /* Kernel has privilege to free memory */
-            verdict = GOV_ALLOW;
-
-            /* Log if audit-all is enabled */
-            if (gov_flags & GOV_FLAG_AUDIT_ALL) {
-                audit_add(op, verdict, GOVERNOR_DOMAIN_MEMORY,
-                          (uint64_t)(uintptr_t)ptr, size,
-                          "Kernel memory free (permitted)");
-            }
+            d.log = LOG_AUDIT_ALL;
+            d.reason = R_MEM_FREE_KERNEL;
         } else {
             /* Non-privileged context cannot free memory */
-            verdict = GOV_DENY;
-            deny_reason = "Memory free denied: insufficient capability";
-            gov_stats.violations_memory++;
-
-            audit_add(op, verdict, GOVERNOR_DOMAIN_MEMORY,
-                      (uint64_t)(uintptr_t)ptr, size, deny_reason);
-
-            if (gov_flags & GOV_FLAG_VERBOSE) {
-                kprintf("  [GOVERNOR] DENY: memory free at 0x%lx (%lu bytes)\n",
-                        (unsigned long)(uintptr_t)ptr, (unsigned long)size);
-            }
+            d.verdict = GOV_DENY;
+            d.log = LOG_ALWAYS;
+            d.violation = VIOL_MEMORY;
+            d.report = 1;
+            d.reason = R_MEM_FREE_DENIED;
         }
         break;
 
@@ -191,39 +412,49 @@ gov_verdict_t governor_check_memory(gov_policy_t op,
          * True Phantom would preserve all versions. Kernel allows overwrites
          * for practical reasons, but we log them.
          */
-        verdict = GOV_AUDIT;
-
-        if (gov_flags & GOV_FLAG_AUDIT_ALL) {
-            audit_add(op, verdict, GOVERNOR_DOMAIN_MEMORY,
-                      (uint64_t)(uintptr_t)ptr, size,
-                      "Memory overwrite (audited)");
-        }
+        d.verdict = GOV_AUDIT;
+        d.log = LOG_AUDIT_ALL;
+        d.reason = R_MEM_OVERWRITE;
         break;
 
     default:
-        verdict = GOV_ALLOW;
         break;
     }
 
-    /* Update statistics */
-    switch (verdict) {
-    case GOV_ALLOW:
-    case GOV_AUDIT:
-        gov_stats.total_allowed++;
-        break;
-    case GOV_DENY:
-        gov_stats.total_denied++;
-        break;
-    case GOV_TRANSFORM:
-        gov_stats.total_transformed++;
-        break;
+    return d;
+}
+
+gov_verdict_t governor_check_memory(gov_policy_t op,
+                                     void *ptr,
+                                     size_t size,
+                                     gov_caps_t caps,
+                                     char *reason)
+{
+    uint64_t t0 = rdtsc();
+    uint32_t pid = process_getpid();
+    uint32_t slot = cache_slot(op, pid, 0, caps);
+    struct gov_decision d;
+
+    gov_stats.total_checks++;
+
+    if (cache_lookup(slot, op, pid, 0, caps, &d)) {
+        gov_stats.cache_hits++;
+    } else {
+        gov_stats.cache_misses++;
+        d = decide_memory(op, caps);
+        cache_store(slot, op, pid, 0, caps, &d);
     }
 
-    /* Copy reason if requested */
-    if (reason && deny_reason) {
-        safe_strcpy(reason, deny_reason, GOVERNOR_MAX_REASON);
+    gov_verdict_t verdict = apply_decision(&d, op, GOVERNOR_DOMAIN_MEMORY,
+                                           (uint64_t)(uintptr_t)ptr, size,
+                                           reason);
+
+    if (verdict == GOV_DENY && (gov_flags & GOV_FLAG_VERBOSE)) {
+        kprintf("  [GOVERNOR] DENY: memory free at 0x%lx (%lu bytes)\n",
+                (unsigned long)(uintptr_t)ptr, (unsigned long)size);
     }
 
+    gov_stats.check_cycles += rdtsc() - t0;
     return verdict;
 }
 
@@ -231,15 +462,10 @@ gov_verdict_t governor_check_memory(gov_policy_t op,
  * Policy Check: Process Operations
  *============================================================================*/
 
-gov_verdict_t governor_check_process(gov_policy_t op,
-                                      uint32_t target_pid,
-                                      gov_caps_t caps,
-                                      char *reason)
+static struct gov_decision decide_process(gov_policy_t op, gov_caps_t caps,
+                                          uint32_t flags)
 {
-    gov_verdict_t verdict = GOV_ALLOW;
-    const char *deny_reason = NULL;
-
-    gov_stats.total_checks++;
+    struct gov_decision d = { GOV_ALLOW, LOG_NEVER, VIOL_NONE, 0, R_NONE };
 
     switch (op) {
     case POLICY_PROC_KILL:
@@ -251,32 +477,23 @@ gov_verdict_t governor_check_process(gov_policy_t op,
          * Policy: DENY forcible process termination.
          * Recommend using process_suspend() or process_exit() instead.
          */
-        if (gov_flags & GOV_FLAG_STRICT) {
-            verdict = GOV_DENY;
-            deny_reason = "Process kill denied: use suspension or dormancy";
-            gov_stats.violations_process++;
-
-            audit_add(op, verdict, GOVERNOR_DOMAIN_PROCESS,
-                      target_pid, 0, deny_reason);
-
-            if (gov_flags & GOV_FLAG_VERBOSE) {
-                kprintf("  [GOVERNOR] DENY: kill process %u (use suspend instead)\n",
-                        target_pid);
-            }
-        } else {
+        if (flags & GOV_FLAG_STRICT) {
+            d.verdict = GOV_DENY;
+            d.log = LOG_ALWAYS;
+            d.violation = VIOL_PROCESS;
+            d.report = 1;
+            d.reason = R_PROC_KILL_STRICT;
+        } else if (caps & GOV_CAP_KERNEL) {
             /* Non-strict mode: Allow with kernel capability, but log */
-            if (caps & GOV_CAP_KERNEL) {
-                verdict = GOV_AUDIT;
-                audit_add(op, verdict, GOVERNOR_DOMAIN_PROCESS,
-                          target_pid, 0, "Process termination (kernel, audited)");
-            } else {
-                verdict = GOV_DENY;
-                deny_reason = "Process kill denied: insufficient capability";
-                gov_stats.violations_process++;
-
-                audit_add(op, verdict, GOVERNOR_DOMAIN_PROCESS,
-                          target_pid, 0, deny_reason);
-            }
+            d.verdict = GOV_AUDIT;
+            d.log = LOG_ALWAYS;
+            d.reason = R_PROC_KILL_KERNEL;
+        } else {
+            d.verdict = GOV_DENY;
+            d.log = LOG_ALWAYS;
+            d.violation = VIOL_PROCESS;
+            d.report = 1;
+            d.reason = R_PROC_KILL_DENIED;
         }
         break;
 
@@ -286,38 +503,46 @@ gov_verdict_t governor_check_process(gov_policy_t op,
          * Self-termination (graceful exit) is allowed.
          * The process is choosing to end, not being destroyed.
          */
-        verdict = GOV_ALLOW;
-
-        if (gov_flags & GOV_FLAG_AUDIT_ALL) {
-            audit_add(op, verdict, GOVERNOR_DOMAIN_PROCESS,
-                      target_pid, 0, "Process graceful exit");
-        }
+        d.log = LOG_AUDIT_ALL;
+        d.reason = R_PROC_EXIT;
         break;
 
     default:
-        verdict = GOV_ALLOW;
         break;
     }
 
-    /* Update statistics */
-    switch (verdict) {
-    case GOV_ALLOW:
-    case GOV_AUDIT:
-        gov_stats.total_allowed++;
-        break;
-    case GOV_DENY:
-        gov_stats.total_denied++;
-        break;
-    case GOV_TRANSFORM:
-        gov_stats.total_transformed++;
-        break;
+    return d;
+}
+
+gov_verdict_t governor_check_process(gov_policy_t op,
+                                      uint32_t target_pid,
+                                      gov_caps_t caps,
+                                      char *reason)
+{
+    uint64_t t0 = rdtsc();
+    uint32_t pid = process_getpid();
+    uint32_t slot = cache_slot(op, pid, 0, caps);
+    struct gov_decision d;
+
+    gov_stats.total_checks++;
+
+    if (cache_lookup(slot, op, pid, 0, caps, &d)) {
+        gov_stats.cache_hits++;
+    } else {
+        gov_stats.cache_misses++;
+        d = decide_process(op, caps, gov_flags);
+        cache_store(slot, op, pid, 0, caps, &d);
     }
 
-    /* Copy reason if requested */
-    if (reason && deny_reason) {
-        safe_strcpy(reason, deny_reason, GOVERNOR_MAX_REASON);
+    gov_verdict_t verdict = apply_decision(&d, op, GOVERNOR_DOMAIN_PROCESS,
+                                           target_pid, 0, reason);
+
+    if (d.reason == R_PROC_KILL_STRICT && (gov_flags & GOV_FLAG_VERBOSE)) {
+        kprintf("  [GOVERNOR] DENY: kill process %u (use suspend instead)\n",
+                target_pid);
     }
 
+    gov_stats.check_cycles += rdtsc() - t0;
     return verdict;
 }
 
@@ -325,15 +550,10 @@ gov_verdict_t governor_check_process(gov_policy_t op,
  * Policy Check: Filesystem Operations
  *============================================================================*/
 
-gov_verdict_t governor_check_filesystem(gov_policy_t op,
-                                         const char *path,
-                                         gov_caps_t caps,
-                                         char *reason)
+static struct gov_decision decide_filesystem(gov_policy_t op, gov_caps_t caps)
 {
-    gov_verdict_t verdict = GOV_ALLOW;
-    const char *deny_reason = NULL;
+    struct gov_decision d = { GOV_ALLOW, LOG_NEVER, VIOL_NONE, 0, R_NONE };
 
-    gov_stats.total_checks++;
     (void)caps;  /* Not used yet, but part of the API */
 
     switch (op) {
@@ -346,16 +566,9 @@ gov_verdict_t governor_check_filesystem(gov_policy_t op,
          * Policy: TRANSFORM delete -> hide
          * The file becomes invisible in current view but remains in geology.
          */
-        verdict = GOV_TRANSFORM;
-        gov_stats.total_transformed++;
-
-        audit_add(op, verdict, GOVERNOR_DOMAIN_FILESYSTEM,
-                  0, 0, "Delete transformed to hide (Prime Directive)");
-
-        if (gov_flags & GOV_FLAG_VERBOSE) {
-            kprintf("  [GOVERNOR] TRANSFORM: delete '%s' -> hide (preserved)\n",
-                    path ? path : "(null)");
-        }
+        d.verdict = GOV_TRANSFORM;
+        d.log = LOG_ALWAYS;
+        d.reason = R_FS_DELETE;
         break;
 
     case POLICY_FS_TRUNCATE:
@@ -364,17 +577,11 @@ gov_verdict_t governor_check_filesystem(gov_policy_t op,
          * Truncation destroys data. This is denied.
          * Create a new version instead.
          */
-        verdict = GOV_DENY;
-        deny_reason = "Truncate denied: creates data loss. Create new version.";
-        gov_stats.violations_fs++;
-
-        audit_add(op, verdict, GOVERNOR_DOMAIN_FILESYSTEM,
-                  0, 0, deny_reason);
-
-        if (gov_flags & GOV_FLAG_VERBOSE) {
-            kprintf("  [GOVERNOR] DENY: truncate '%s' (use versioning)\n",
-                    path ? path : "(null)");
-        }
+        d.verdict = GOV_DENY;
+        d.log = LOG_ALWAYS;
+        d.violation = VIOL_FS;
+        d.report = 1;
+        d.reason = R_FS_TRUNCATE;
         break;
 
     case POLICY_FS_OVERWRITE:
@@ -385,12 +592,9 @@ gov_verdict_t governor_check_filesystem(gov_policy_t op,
          *
          * Policy: ALLOW but audit (GeoFS preserves history automatically)
          */
-        verdict = GOV_AUDIT;
-
-        if (gov_flags & GOV_FLAG_AUDIT_ALL) {
-            audit_add(op, verdict, GOVERNOR_DOMAIN_FILESYSTEM,
-                      0, 0, "File overwrite (GeoFS preserves history)");
-        }
+        d.verdict = GOV_AUDIT;
+        d.log = LOG_AUDIT_ALL;
+        d.reason = R_FS_OVERWRITE;
         break;
 
     case POLICY_FS_HIDE:
@@ -401,63 +605,79 @@ gov_verdict_t governor_check_filesystem(gov_policy_t op,
          *
          * Policy: ALLOW (this IS the correct operation)
          */
-        verdict = GOV_ALLOW;
-
-        if (gov_flags & GOV_FLAG_AUDIT_ALL) {
-            audit_add(op, verdict, GOVERNOR_DOMAIN_FILESYSTEM,
-                      0, 0, "File hidden (preserved in history)");
-        }
+        d.log = LOG_AUDIT_ALL;
+        d.reason = R_FS_HIDE;
         break;
 
     case POLICY_FS_PERM_DENIED:
-        verdict = GOV_DENY;
-        deny_reason = "Permission denied";
-        gov_stats.violations_fs++;
-        audit_add(op, verdict, GOVERNOR_DOMAIN_FILESYSTEM,
-                  0, 0, deny_reason);
-        if (gov_flags & GOV_FLAG_VERBOSE) {
-            kprintf("  [GOVERNOR] DENY: permission denied for '%s'\n",
-                    path ? path : "(null)");
-        }
+        d.verdict = GOV_DENY;
+        d.log = LOG_ALWAYS;
+        d.violation = VIOL_FS;
+        d.report = 1;
+        d.reason = R_FS_PERM_DENIED;
         break;
 
     case POLICY_FS_QUOTA_EXCEEDED:
-        verdict = GOV_DENY;
-        deny_reason = "Quota exceeded";
-        gov_stats.violations_fs++;
-        audit_add(op, verdict, GOVERNOR_DOMAIN_FILESYSTEM,
-                  0, 0, deny_reason);
-        if (gov_flags & GOV_FLAG_VERBOSE) {
-            kprintf("  [GOVERNOR] DENY: quota exceeded for '%s'\n",
-                    path ? path : "(null)");
-        }
+        d.verdict = GOV_DENY;
+        d.log = LOG_ALWAYS;
+        d.violation = VIOL_FS;
+        d.report = 1;
+        d.reason = R_FS_QUOTA_EXCEEDED;
         break;
 
     default:
-        verdict = GOV_ALLOW;
         break;
     }
 
-    /* Update statistics (if not already done above) */
-    if (verdict != GOV_TRANSFORM) {  /* TRANSFORM already counted */
-        switch (verdict) {
-        case GOV_ALLOW:
-        case GOV_AUDIT:
-            gov_stats.total_allowed++;
+    return d;
+}
+
+gov_verdict_t governor_check_filesystem(gov_policy_t op,
+                                         const char *path,
+                                         gov_caps_t caps,
+                                         char *reason)
+{
+    uint64_t t0 = rdtsc();
+    uint32_t pid = process_getpid();
+    uint32_t path_hash = path ? hash_string(path, (size_t)-1) : 0;
+    uint32_t slot = cache_slot(op, pid, path_hash, caps);
+    struct gov_decision d;
+
+    gov_stats.total_checks++;
+
+    if (cache_lookup(slot, op, pid, path_hash, caps, &d)) {
+        gov_stats.cache_hits++;
+    } else {
+        gov_stats.cache_misses++;
+        d = decide_filesystem(op, caps);
+        cache_store(slot, op, pid, path_hash, caps, &d);
+    }
+
+    gov_verdict_t verdict = apply_decision(&d, op, GOVERNOR_DOMAIN_FILESYSTEM,
+                                           0, 0, reason);
+
+    if ((verdict == GOV_DENY || verdict == GOV_TRANSFORM) &&
+        (gov_flags & GOV_FLAG_VERBOSE)) {
+        const char *p = path ? path : "(null)";
+        switch (op) {
+        case POLICY_FS_DELETE:
+            kprintf("  [GOVERNOR] TRANSFORM: delete '%s' -> hide (preserved)\n", p);
+            break;
+        case POLICY_FS_TRUNCATE:
+            kprintf("  [GOVERNOR] DENY: truncate '%s' (use versioning)\n", p);
+            break;
+        case POLICY_FS_PERM_DENIED:
+            kprintf("  [GOVERNOR] DENY: permission denied for '%s'\n", p);
             break;
-        case GOV_DENY:
-            gov_stats.total_denied++;
+        case POLICY_FS_QUOTA_EXCEEDED:
+            kprintf("  [GOVERNOR] DENY: quota exceeded for '%s'\n", p);
             break;
         default:
             break;
         }
     }
 
-    /* Copy reason if requested */
-    if (reason && deny_reason) {
-        safe_strcpy(reason, deny_reason, GOVERNOR_MAX_REASON);
-    }
-
+    gov_stats.check_cycles += rdtsc() - t0;
     return verdict;
 }
 
@@ -474,18 +694,48 @@ void governor_get_stats(struct gov_stats *stats)
 
 int governor_audit_count(void)
 {
-    return audit_count;
+    uint64_t head = __atomic_load_n(&audit_head, __ATOMIC_ACQUIRE);
+    return head < GOVERNOR_AUDIT_SIZE ? (int)head : GOVERNOR_AUDIT_SIZE;
 }
 
 int governor_audit_get(int index, struct gov_audit_entry *entry)
 {
-    if (!entry || index < 0 || index >= audit_count) {
+    uint64_t head = __atomic_load_n(&audit_head, __ATOMIC_ACQUIRE);
+    uint64_t avail = head < GOVERNOR_AUDIT_SIZE ? head : GOVERNOR_AUDIT_SIZE;
+
+    if (!entry) {
+        return -1;
+    }
+    entry->reason_id = 0;
+    entry->reason = "";
+    if (index < 0 || (uint64_t)index >= avail) {
         return -1;
     }
 
-    /* Convert index to circular buffer position (0 = most recent) */
-    int pos = (audit_head - 1 - index + GOVERNOR_AUDIT_SIZE) % GOVERNOR_AUDIT_SIZE;
-    *entry = audit_buffer[pos];
+    /* 0 = most recent; the slot must still hold that sequence number */
+    uint64_t seq = head - 1 - (uint64_t)index;
+    const struct gov_audit_record *rec = &audit_ring[seq & AUDIT_MASK];
+    if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != seq + 1) {
+        return -1;
+    }
+
+    entry->sequence = seq;
+    entry->timestamp = rec->tick;
+    entry->policy = (gov_policy_t)rec->policy;
+    entry->verdict = (gov_verdict_t)rec->verdict;
+    entry->pid = rec->pid;
+    entry->domain = rec->domain;
+    entry->arg1 = rec->arg1;
+    entry->arg2 = rec->arg2;
+    entry->reason_id = rec->reason;
+
+    /* Overwritten by a writer while we copied it */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&rec->seq, __ATOMIC_RELAXED) != seq + 1) {
+        return -1;
+    }
+
+    entry->reason = governor_reason_string(entry->reason_id);
     return 0;
 }
 
@@ -497,7 +747,48 @@ void governor_audit_record(gov_policy_t policy,
                            const char *reason)
 {
     if (!gov_initialized) return;
-    audit_add(policy, verdict, domain, arg1, arg2, reason);
+    audit_add(policy, verdict, domain, arg1, arg2,
+              governor_reason_intern(reason));
+}
+
+uint16_t governor_reason_intern(const char *reason)
+{
+    if (!reason || !reason[0] || !gov_initialized) {
+        return R_NONE;
+    }
+
+    uint32_t h = hash_string(reason, GOVERNOR_MAX_REASON - 1);
+    uint16_t id = R_NONE;
+    uint64_t irq = irq_save();
+
+    for (uint32_t slot = h; ; slot++) {
+        uint16_t v = reason_index[slot & (REASON_INDEX_SIZE - 1)];
+        if (v == 0)
+            break;
+        if (reason_equal(reason_table[v - 1], reason)) {
+            id = (uint16_t)(v - 1);
+            break;
+        }
+    }
+
+    if (id == R_NONE && reason_count < GOVERNOR_MAX_REASONS) {
+        id = (uint16_t)reason_count;
+        safe_strcpy(reason_pool[id], reason, GOVERNOR_MAX_REASON);
+        reason_table[id] = reason_pool[id];
+        reason_index_insert(id);
+        __atomic_store_n(&reason_count, reason_count + 1, __ATOMIC_RELEASE);
+    }
+
+    irq_restore(irq);
+    return id;
+}
+
+const char *governor_reason_string(uint16_t id)
+{
+    if (id >= __atomic_load_n(&reason_count, __ATOMIC_ACQUIRE)) {
+        return "";
+    }
+    return reason_table[id];
 }
 
 /*============================================================================
@@ -566,7 +857,17 @@ void governor_dump_stats(void)
             (unsigned long)gov_stats.violations_process);
     kprintf("    Filesystem: %lu\n",
             (unsigned long)gov_stats.violations_fs);
-    kprintf("  Audit entries: %d\n", audit_count);
+    kprintf("  Verdict cache: %lu hits, %lu misses\n",
+            (unsigned long)gov_stats.cache_hits,
+            (unsigned long)gov_stats.cache_misses);
+    if (gov_stats.total_checks) {
+        uint64_t avg = gov_stats.check_cycles / gov_stats.total_checks;
+        kprintf("  Avg check cost: %lu cycles (%lu ns)\n",
+                (unsigned long)avg, (unsigned long)timer_tsc_to_ns(avg));
+    }
+    kprintf("  Audit entries: %d of %lu recorded (ring %d), %d reasons\n",
+            governor_audit_count(), (unsigned long)gov_stats.audit_records,
+            GOVERNOR_AUDIT_SIZE, reason_count);
     kprintf("  Flags: 0x%x", gov_flags);
     if (gov_flags & GOV_FLAG_STRICT)    kprintf(" STRICT");
     if (gov_flags & GOV_FLAG_AUDIT_ALL) kprintf(" AUDIT_ALL");
@@ -576,6 +877,7 @@ void governor_dump_stats(void)
 
 void governor_dump_audit(int max_entries)
 {
+    int audit_count = governor_audit_count();
     int count = (max_entries > 0 && max_entries < audit_count) ?
                 max_entries : audit_count;
 
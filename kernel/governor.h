@@ -29,7 +29,9 @@
 
 /* Maximum sizes */
 #define GOVERNOR_MAX_REASON     64
-#define GOVERNOR_AUDIT_SIZE     128     /* Circular audit buffer entries */
+#define GOVERNOR_AUDIT_SIZE     2048    /* Audit ring records (power of two) */
+#define GOVERNOR_CACHE_SIZE     64      /* Verdict cache slots (power of two) */
+#define GOVERNOR_MAX_REASONS    128     /* Interned audit reason strings */
 
 /* Policy domains */
 #define GOVERNOR_DOMAIN_MEMORY      0x0001
@@ -110,7 +112,11 @@ typedef uint32_t gov_caps_t;
  * Audit Types
  *============================================================================*/
 
-/* Audit entry - immutable record of an operation */
+/*
+ * Audit entry - immutable record of an operation. The ring itself holds
+ * fixed-size binary records with the reason as an interned ID; this is the
+ * decoded form handed out by governor_audit_get().
+ */
 struct gov_audit_entry {
     uint64_t        sequence;       /* Monotonic sequence number */
     uint64_t        timestamp;      /* Timer ticks */
@@ -120,7 +126,8 @@ struct gov_audit_entry {
     uint32_t        domain;         /* Domain of operation */
     uint64_t        arg1;           /* Operation-specific argument 1 */
     uint64_t        arg2;           /* Operation-specific argument 2 */
-    char            reason[GOVERNOR_MAX_REASON];
+    uint16_t        reason_id;      /* Interned reason (0 = none) */
+    const char     *reason;         /* Interned string, "" if none */
 };
 
 /* Governor statistics */
@@ -132,6 +139,10 @@ struct gov_stats {
     uint64_t    violations_memory;  /* Memory violations blocked */
     uint64_t    violations_process; /* Process violations blocked */
     uint64_t    violations_fs;      /* Filesystem violations blocked */
+    uint64_t    cache_hits;         /* Checks answered by the verdict cache */
+    uint64_t    cache_misses;       /* Checks that evaluated the policy */
+    uint64_t    check_cycles;       /* TSC cycles spent inside checks */
+    uint64_t    audit_records;      /* Records ever written to the ring */
 };
 
 /*============================================================================
@@ -414,7 +425,7 @@ void governor_init(void);
 int governor_is_initialized(void);
 
 /*
- * Set Governor flags
+ * Set Governor flags (invalidates every cached verdict)
  */
 void governor_set_flags(uint32_t flags);
 
@@ -425,6 +436,10 @@ uint32_t governor_get_flags(void);
 
 /*============================================================================
  * Policy Check API
+ *
+ * Verdicts are a function of (policy, calling PID, path hash, caps, flags)
+ * and are memoized in a small direct-mapped cache; a hit skips policy
+ * evaluation but still updates statistics and writes any audit record.
  *============================================================================*/
 
 /*
@@ -519,6 +534,18 @@ void governor_audit_record(gov_policy_t policy,
                            uint64_t arg2,
                            const char *reason);
 
+/*
+ * Intern an audit reason string, returning its ID (0 for NULL or empty).
+ * The string is copied once; later calls with the same text return the
+ * same ID. Returns 0 if the reason table is full.
+ */
+uint16_t governor_reason_intern(const char *reason);
+
+/*
+ * Get the string for an interned reason ID ("" if unknown)
+ */
+const char *governor_reason_string(uint16_t id);
+
 /*============================================================================
  * Utility Functions
  *============================================================================*/
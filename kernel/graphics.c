@@ -8,6 +8,7 @@
 #include "graphics.h"
 #include "framebuffer.h"
 #include "font.h"
+#include "pixel.h"
 #include <stdint.h>
 
 /*============================================================================
@@ -83,11 +84,7 @@ extern const uint8_t font_data[95][16];
 
 uint32_t gfx_alpha_blend(uint32_t fg, uint32_t bg, uint8_t alpha)
 {
-    uint32_t inv = 255 - alpha;
-    uint32_t r = (((fg >> 16) & 0xFF) * alpha + ((bg >> 16) & 0xFF) * inv) >> 8;
-    uint32_t g = (((fg >> 8) & 0xFF) * alpha + ((bg >> 8) & 0xFF) * inv) >> 8;
-    uint32_t b = ((fg & 0xFF) * alpha + (bg & 0xFF) * inv) >> 8;
-    return 0xFF000000 | (r << 16) | (g << 8) | b;
+    return px_blend_pixel(fg, bg, alpha);
 }
 
 void gfx_fill_gradient_v(int x, int y, int w, int h,
@@ -104,20 +101,11 @@ void gfx_fill_gradient_v(int x, int y, int w, int h,
     int x1 = (x + w > (int)fb_w) ? (int)fb_w : x + w;
     int y1 = (y + h > (int)fb_h) ? (int)fb_h : y + h;
 
-    int rt = (color_top >> 16) & 0xFF, gt = (color_top >> 8) & 0xFF, bt = color_top & 0xFF;
-    int rb = (color_bottom >> 16) & 0xFF, gb = (color_bottom >> 8) & 0xFF, bb = color_bottom & 0xFF;
-    int denom = (h > 1) ? (h - 1) : 1;
+    uint32_t span = (h > 1) ? (uint32_t)(h - 1) : 1;
 
     for (int row = y0; row < y1; row++) {
-        int t = row - y;
-        int r = rt + (rb - rt) * t / denom;
-        int g = gt + (gb - gt) * t / denom;
-        int b = bt + (bb - bt) * t / denom;
-        uint32_t color = 0xFF000000 | ((uint32_t)r << 16) | ((uint32_t)g << 8) | (uint32_t)b;
-
-        uint32_t *dst = &backbuf[row * fb_w + x0];
-        for (int col = x0; col < x1; col++)
-            *dst++ = color;
+        uint32_t color = px_ramp_pixel(color_top, color_bottom, row - y, span);
+        px_fill(&backbuf[row * fb_w + x0], (uint32_t)(x1 - x0), color);
     }
 
     fb_mark_dirty((uint32_t)x0, (uint32_t)y0, (uint32_t)(x1 - x0), (uint32_t)(y1 - y0));
@@ -169,9 +157,9 @@ void gfx_fill_rounded_rect(int x, int y, int w, int h, int radius,
         if (x_start < 0) x_start = 0;
         if (x_end > (int)fb_w) x_end = (int)fb_w;
 
-        uint32_t *dst = &backbuf[py * fb_w + x_start];
-        for (int col = x_start; col < x_end; col++)
-            *dst++ = color;
+        if (x_end > x_start)
+            px_fill(&backbuf[py * fb_w + x_start], (uint32_t)(x_end - x_start),
+                    color);
     }
 
     fb_mark_dirty((uint32_t)(x < 0 ? 0 : x), (uint32_t)(y < 0 ? 0 : y),
@@ -227,13 +215,11 @@ void gfx_draw_shadow(int x, int y, int w, int h, int offset, uint8_t alpha)
     int x1 = (sx + w > (int)fb_w) ? (int)fb_w : sx + w;
     int y1 = (sy + h > (int)fb_h) ? (int)fb_h : sy + h;
 
-    for (int row = y0; row < y1; row++) {
-        uint32_t *dst = &backbuf[row * fb_w + x0];
-        for (int col = x0; col < x1; col++) {
-            *dst = gfx_alpha_blend(COLOR_BLACK, *dst, alpha);
-            dst++;
-        }
-    }
+    if (x1 <= x0 || y1 <= y0) return;
+
+    for (int row = y0; row < y1; row++)
+        px_blend_const(&backbuf[row * fb_w + x0], (uint32_t)(x1 - x0),
+                       COLOR_BLACK, alpha);
 
     fb_mark_dirty((uint32_t)x0, (uint32_t)y0, (uint32_t)(x1 - x0), (uint32_t)(y1 - y0));
 }
@@ -288,11 +274,9 @@ void gfx_draw_soft_shadow(int x, int y, int w, int h, int radius)
             if (x_start < 0) x_start = 0;
             if (x_end > (int)fb_w) x_end = (int)fb_w;
 
-            uint32_t *dst = &backbuf[py * fb_w + x_start];
-            for (int col = x_start; col < x_end; col++) {
-                *dst = gfx_alpha_blend(COLOR_BLACK, *dst, alpha);
-                dst++;
-            }
+            if (x_end > x_start)
+                px_blend_const(&backbuf[py * fb_w + x_start],
+                               (uint32_t)(x_end - x_start), COLOR_BLACK, alpha);
         }
     }
 
@@ -319,17 +303,19 @@ void gfx_fill_rounded_rect_aa(int x, int y, int w, int h, int radius,
     int r2 = radius * radius;
     int r_inner = (radius - 1) * (radius - 1);  /* Fully inside */
 
+    int xs = (x < 0) ? 0 : x;
+    int xe = (x + w > (int)fb_w) ? (int)fb_w : x + w;
+    if (xe <= xs) return;
+
     for (int row = 0; row < h; row++) {
         int py = y + row;
         if (py < 0 || py >= (int)fb_h) continue;
 
+        uint32_t *line = &backbuf[py * fb_w];
+
         /* Non-corner rows: fill full width */
         if (row >= radius && row < h - radius) {
-            int xs = (x < 0) ? 0 : x;
-            int xe = (x + w > (int)fb_w) ? (int)fb_w : x + w;
-            uint32_t *dst = &backbuf[py * fb_w + xs];
-            for (int col = xs; col < xe; col++)
-                *dst++ = color;
+            px_fill(&line[xs], (uint32_t)(xe - xs), color);
             continue;
         }
 
@@ -342,29 +328,26 @@ void gfx_fill_rounded_rect_aa(int x, int y, int w, int h, int radius,
         }
         int cy2 = cy_off * cy_off;
 
+        /* Solid span between the two corner zones */
+        int ms = (x + radius > xs) ? x + radius : xs;
+        int me = (x + w - radius < xe) ? x + w - radius : xe;
+        if (me > ms)
+            px_fill(&line[ms], (uint32_t)(me - ms), color);
+
+        /* Per-pixel coverage inside the corner zones */
         for (int col = 0; col < w; col++) {
+            if (col == radius && w - radius > radius)
+                col = w - radius;   /* Skip the solid middle */
+
             int px = x + col;
             if (px < 0 || px >= (int)fb_w) continue;
 
-            /* Check if this pixel is in a corner zone */
-            int cx_off = -1;
-            if (col < radius) {
-                cx_off = radius - 1 - col;
-            } else if (col >= w - radius) {
-                cx_off = col - (w - radius);
-            }
-
-            if (cx_off < 0) {
-                /* Not in corner: fill solid */
-                backbuf[py * fb_w + px] = color;
-                continue;
-            }
-
+            int cx_off = (col < radius) ? radius - 1 - col : col - (w - radius);
             int dist2 = cx_off * cx_off + cy2;
 
             if (dist2 <= r_inner) {
                 /* Fully inside corner arc */
-                backbuf[py * fb_w + px] = color;
+                line[px] = color;
             } else if (dist2 <= r2 + radius) {
                 /* Edge zone: anti-alias */
                 int coverage;
@@ -375,10 +358,8 @@ void gfx_fill_rounded_rect_aa(int x, int y, int w, int h, int radius,
                 }
                 if (coverage < 0) coverage = 0;
                 if (coverage > 255) coverage = 255;
-                if (coverage > 0) {
-                    uint32_t bg = backbuf[py * fb_w + px];
-                    backbuf[py * fb_w + px] = gfx_alpha_blend(color, bg, (uint8_t)coverage);
-                }
+                if (coverage > 0)
+                    line[px] = px_blend_pixel(color, line[px], (uint8_t)coverage);
             }
             /* else: outside arc, don't draw */
         }
@@ -398,9 +379,6 @@ void gfx_fill_gradient_radial(int x, int y, int w, int h,
 
     if (!backbuf || w <= 0 || h <= 0) return;
 
-    int rc = (color_center >> 16) & 0xFF, gc = (color_center >> 8) & 0xFF, bc = color_center & 0xFF;
-    int re = (color_edge >> 16) & 0xFF, ge = (color_edge >> 8) & 0xFF, be = color_edge & 0xFF;
-
     /* Max Manhattan distance from center to any corner */
     int d1 = (cx - x) + (cy - y);
     int d2 = (x + w - 1 - cx) + (cy - y);
@@ -412,24 +390,27 @@ void gfx_fill_gradient_radial(int x, int y, int w, int h,
     if (d4 > max_dist) max_dist = d4;
     if (max_dist < 1) max_dist = 1;
 
+    int xs = (x < 0) ? 0 : x;
+    int xe = (x + w > (int)fb_w) ? (int)fb_w : x + w;
+    if (xe <= xs) return;
+
+    /* Split each row at cx: distance falls toward it, then rises again */
+    int split = cx;
+    if (split < xs) split = xs;
+    if (split > xe) split = xe;
+
     for (int row = y; row < y + h; row++) {
         if (row < 0 || row >= (int)fb_h_val) continue;
         int dy = row - cy;
         if (dy < 0) dy = -dy;
 
         uint32_t *dst = &backbuf[row * fb_w];
-        for (int col = x; col < x + w; col++) {
-            if (col < 0 || col >= (int)fb_w) continue;
-            int dx = col - cx;
-            if (dx < 0) dx = -dx;
-            int dist = dx + dy;
-            if (dist > max_dist) dist = max_dist;
-
-            int r = rc + (re - rc) * dist / max_dist;
-            int g = gc + (ge - gc) * dist / max_dist;
-            int b = bc + (be - bc) * dist / max_dist;
-            dst[col] = 0xFF000000 | ((uint32_t)r << 16) | ((uint32_t)g << 8) | (uint32_t)b;
-        }
+        if (split > xs)
+            px_ramp(&dst[xs], (uint32_t)(split - xs), color_center, color_edge,
+                    dy + (cx - xs), -1, (uint32_t)max_dist);
+        if (xe > split)
+            px_ramp(&dst[split], (uint32_t)(xe - split), color_center, color_edge,
+                    dy + (split - cx), 1, (uint32_t)max_dist);
     }
 
     fb_mark_dirty((uint32_t)(x < 0 ? 0 : x), (uint32_t)(y < 0 ? 0 : y),
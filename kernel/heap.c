@@ -8,6 +8,7 @@
 #include "heap.h"
 #include "pmm.h"
 #include "vmm.h"
+#include "idt.h"
 #include <stdint.h>
 #include <stddef.h>
 
@@ -278,7 +279,7 @@ void heap_init(void)
             (unsigned long)(HEAP_INITIAL_SIZE / 1024));
 }
 
-void *kmalloc(size_t size)
+static void *kmalloc_locked(size_t size)
 {
     if (!heap_initialized || size == 0) {
         return NULL;
@@ -346,12 +347,22 @@ void *kmalloc(size_t size)
 
     /* No suitable block - try to expand heap */
     if (heap_expand(needed) == 0) {
-        return kmalloc(size);  /* Retry */
+        return kmalloc_locked(size);  /* Retry */
     }
 
     return NULL;  /* Out of memory */
 }
 
+/* Interrupts stay off across the free-list walk so a preempting task
+ * cannot see it half-updated */
+void *kmalloc(size_t size)
+{
+    uint64_t flags = irq_save();
+    void *ptr = kmalloc_locked(size);
+    irq_restore(flags);
+    return ptr;
+}
+
 void *kcalloc(size_t nmemb, size_t size)
 {
     size_t total = nmemb * size;
@@ -405,7 +416,7 @@ void *krealloc(void *ptr, size_t size)
     return new_ptr;
 }
 
-void kfree(void *ptr)
+static void kfree_locked(void *ptr)
 {
     if (!heap_initialized || !ptr) {
         return;
@@ -449,6 +460,13 @@ void kfree(void *ptr)
     coalesce(block);
 }
 
+void kfree(void *ptr)
+{
+    uint64_t flags = irq_save();
+    kfree_locked(ptr);
+    irq_restore(flags);
+}
+
 const struct heap_stats *heap_get_stats(void)
 {
     return &heap_stats;
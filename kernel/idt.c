@@ -4,6 +4,7 @@
  */
 
 #include "idt.h"
+#include "trace.h"
 #include <stddef.h>
 
 /* External functions */
@@ -69,6 +70,16 @@ extern void irq13(void);
 extern void irq14(void);
 extern void irq15(void);
 
+/* MSI stubs */
+extern void msi0(void);
+extern void msi1(void);
+extern void msi2(void);
+extern void msi3(void);
+extern void msi4(void);
+extern void msi5(void);
+extern void msi6(void);
+extern void msi7(void);
+
 /* Load IDT (defined in assembly) */
 extern void idt_load(struct idt_ptr *ptr);
 
@@ -123,6 +134,28 @@ void register_interrupt_handler(uint8_t num, interrupt_handler_t handler)
     interrupt_handlers[num] = handler;
 }
 
+/*
+ * Look up the handler registered for a vector
+ */
+interrupt_handler_t interrupt_get_handler(uint8_t num)
+{
+    return interrupt_handlers[num];
+}
+
+/*
+ * Hand out a free MSI vector and install its handler
+ */
+int idt_alloc_msi_vector(interrupt_handler_t handler)
+{
+    for (int v = MSI_VECTOR_BASE; v < MSI_VECTOR_BASE + MSI_VECTOR_COUNT; v++) {
+        if (!interrupt_handlers[v]) {
+            interrupt_handlers[v] = handler;
+            return v;
+        }
+    }
+    return -1;
+}
+
 /*
  * Default exception handler
  */
@@ -168,7 +201,9 @@ void interrupt_handler(struct interrupt_frame *frame)
 {
     /* Call registered handler if present */
     if (interrupt_handlers[frame->int_no]) {
+        trace_irq_enter(frame->int_no, frame->rip);
         interrupt_handlers[frame->int_no](frame);
+        trace_irq_exit(frame->int_no);
     } else if (frame->int_no < 32) {
         /* CPU exception without handler */
         default_exception_handler(frame);
@@ -239,6 +274,16 @@ void idt_init(void)
     idt_set_gate(46, (uint64_t)irq14, 0x08, IDT_GATE_INTERRUPT);
     idt_set_gate(47, (uint64_t)irq15, 0x08, IDT_GATE_INTERRUPT);
 
+    /* Set up MSI vectors (48-55) */
+    idt_set_gate(48, (uint64_t)msi0, 0x08, IDT_GATE_INTERRUPT);
+    idt_set_gate(49, (uint64_t)msi1, 0x08, IDT_GATE_INTERRUPT);
+    idt_set_gate(50, (uint64_t)msi2, 0x08, IDT_GATE_INTERRUPT);
+    idt_set_gate(51, (uint64_t)msi3, 0x08, IDT_GATE_INTERRUPT);
+    idt_set_gate(52, (uint64_t)msi4, 0x08, IDT_GATE_INTERRUPT);
+    idt_set_gate(53, (uint64_t)msi5, 0x08, IDT_GATE_INTERRUPT);
+    idt_set_gate(54, (uint64_t)msi6, 0x08, IDT_GATE_INTERRUPT);
+    idt_set_gate(55, (uint64_t)msi7, 0x08, IDT_GATE_INTERRUPT);
+
     /* Set up IDT pointer */
     idtp.limit = sizeof(idt) - 1;
     idtp.base = (uint64_t)&idt;
@@ -93,6 +93,10 @@ struct idt_ptr {
 #define IRQ_PRIMARY_ATA         (IRQ_BASE + 14)  /* IRQ14: Primary ATA */
 #define IRQ_SECONDARY_ATA       (IRQ_BASE + 15)  /* IRQ15: Secondary ATA */
 
+/* Message-signalled interrupts (delivered by the local APIC) */
+#define MSI_VECTOR_BASE         48
+#define MSI_VECTOR_COUNT        8
+
 /* Software interrupts */
 #define INT_SYSCALL             128              /* System call interrupt */
 
@@ -147,8 +151,26 @@ static inline int interrupts_enabled(void) {
     return (flags >> 9) & 1;
 }
 
+/* Disable interrupts, returning the previous RFLAGS for irq_restore() */
+static inline uint64_t irq_save(void) {
+    uint64_t flags;
+    __asm__ volatile ("pushfq; pop %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint64_t flags) {
+    if (flags & (1 << 9))
+        __asm__ volatile ("sti" ::: "memory");
+}
+
 /* Register an interrupt handler */
 typedef void (*interrupt_handler_t)(struct interrupt_frame *frame);
 void register_interrupt_handler(uint8_t num, interrupt_handler_t handler);
 
+/* Currently registered handler for a vector (NULL if none) */
+interrupt_handler_t interrupt_get_handler(uint8_t num);
+
+/* Install handler on a free MSI vector; returns the vector, or -1 */
+int idt_alloc_msi_vector(interrupt_handler_t handler);
+
 #endif /* _IDT_H */
@@ -0,0 +1,247 @@
+/*
+ * PhantomOS Input Event Ring
+ * "To Create, Not To Destroy"
+ *
+ * The producer owns ring_head and the consumer owns ring_tail; each side
+ * publishes its index with a release store and reads the other side's with
+ * an acquire load. Events are applied in order in task context, so scancode
+ * translation (including LED updates) no longer runs inside IRQ1.
+ */
+
+#include "input.h"
+#include "keyboard.h"
+#include "mouse.h"
+#include "timer.h"
+#include "io.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/*============================================================================
+ * External Declarations
+ *============================================================================*/
+
+extern int kprintf(const char *fmt, ...);
+extern void *memset(void *s, int c, size_t n);
+
+/*============================================================================
+ * State
+ *============================================================================*/
+
+#define INPUT_PENDING_MAX   64          /* Drained events awaiting a flip */
+
+static struct input_event ring[INPUT_RING_SIZE];
+static volatile uint32_t ring_head = 0;     /* Written by producers */
+static volatile uint32_t ring_tail = 0;     /* Written by the consumer */
+static volatile int draining = 0;
+
+/* Producer-side statistics */
+static volatile uint64_t src_events[INPUT_SRC_COUNT];
+static volatile uint64_t dropped = 0;
+static volatile uint32_t high_water = 0;
+
+/* Latency: TSC of drained events not yet on screen, and a history of
+ * event-to-flip times in TSC cycles */
+static uint64_t pending_tsc[INPUT_PENDING_MAX];
+static uint32_t pending_count = 0;
+static int latency_active = 0;              /* Set once frames are presented */
+static uint64_t lat_history[INPUT_LAT_HISTORY];
+static uint32_t lat_pos = 0;
+static uint32_t lat_count = 0;
+
+static const char *source_names[INPUT_SRC_COUNT] = {
+    "ps2-kbd", "ps2-mouse", "usb-kbd", "usb-mouse",
+};
+
+/*============================================================================
+ * Producers
+ *============================================================================*/
+
+static void input_push(uint8_t type, enum input_source src, uint8_t code,
+                       uint8_t buttons, int x, int y)
+{
+    uint32_t head = ring_head;
+    uint32_t tail = __atomic_load_n(&ring_tail, __ATOMIC_ACQUIRE);
+
+    if (head - tail >= INPUT_RING_SIZE) {
+        dropped++;
+        return;
+    }
+
+    struct input_event *ev = &ring[head & (INPUT_RING_SIZE - 1)];
+    ev->tsc = rdtsc();
+    ev->type = type;
+    ev->source = (uint8_t)src;
+    ev->code = code;
+    ev->buttons = buttons;
+    ev->x = (int16_t)x;
+    ev->y = (int16_t)y;
+
+    __atomic_store_n(&ring_head, head + 1, __ATOMIC_RELEASE);
+
+    src_events[src]++;
+    if (head + 1 - tail > high_water)
+        high_water = head + 1 - tail;
+}
+
+void input_report_scancode(uint8_t scancode)
+{
+    input_push(INPUT_EV_SCANCODE, INPUT_SRC_PS2_KBD, scancode, 0, 0, 0);
+}
+
+void input_report_key(enum input_source src, uint8_t c)
+{
+    input_push(INPUT_EV_KEY, src, c, 0, 0, 0);
+}
+
+void input_report_rel(enum input_source src, int dx, int dy, uint8_t buttons)
+{
+    input_push(INPUT_EV_REL, src, 0, buttons, dx, dy);
+}
+
+void input_report_abs(enum input_source src, int x, int y, uint8_t buttons)
+{
+    input_push(INPUT_EV_ABS, src, 0, buttons, x, y);
+}
+
+/*============================================================================
+ * Consumer
+ *============================================================================*/
+
+static void input_apply(const struct input_event *ev)
+{
+    switch (ev->type) {
+    case INPUT_EV_SCANCODE:
+        keyboard_process_scancode(ev->code);
+        break;
+    case INPUT_EV_KEY:
+        keyboard_inject_char((char)ev->code);
+        break;
+    case INPUT_EV_REL:
+        mouse_inject_movement(ev->x, ev->y, ev->buttons);
+        break;
+    case INPUT_EV_ABS:
+        mouse_set_absolute(ev->x, ev->y, ev->buttons);
+        break;
+    }
+}
+
+int input_drain(void)
+{
+    /* Keyboard and mouse readers all drain; only one may consume at a time */
+    if (__atomic_exchange_n(&draining, 1, __ATOMIC_ACQUIRE))
+        return 0;
+
+    int n = 0;
+    uint32_t tail = ring_tail;
+    uint32_t head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+
+    while (tail != head) {
+        struct input_event ev = ring[tail & (INPUT_RING_SIZE - 1)];
+        __atomic_store_n(&ring_tail, ++tail, __ATOMIC_RELEASE);
+
+        input_apply(&ev);
+        if (latency_active && pending_count < INPUT_PENDING_MAX)
+            pending_tsc[pending_count++] = ev.tsc;
+        n++;
+
+        if (tail == head)
+            head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+    }
+
+    __atomic_store_n(&draining, 0, __ATOMIC_RELEASE);
+    return n;
+}
+
+void input_frame_presented(void)
+{
+    uint64_t now = rdtsc();
+
+    latency_active = 1;
+    for (uint32_t i = 0; i < pending_count; i++) {
+        lat_history[lat_pos] = now - pending_tsc[i];
+        lat_pos = (lat_pos + 1) % INPUT_LAT_HISTORY;
+        if (lat_count < INPUT_LAT_HISTORY)
+            lat_count++;
+    }
+    pending_count = 0;
+}
+
+/*============================================================================
+ * Statistics
+ *============================================================================*/
+
+void input_get_stats(struct input_stats *out)
+{
+    uint64_t v[INPUT_LAT_HISTORY];
+    uint32_t n = lat_count;
+    uint64_t sum = 0;
+
+    if (!out)
+        return;
+
+    memset(out, 0, sizeof(*out));
+    for (int s = 0; s < INPUT_SRC_COUNT; s++)
+        out->events[s] = src_events[s];
+    out->dropped = dropped;
+    out->high_water = high_water;
+    out->lat_samples = n;
+    if (n == 0)
+        return;
+
+    /* Insertion sort: the history is small and this runs from the shell */
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t x = lat_history[i];
+        uint32_t j = i;
+        while (j > 0 && v[j - 1] > x) {
+            v[j] = v[j - 1];
+            j--;
+        }
+        v[j] = x;
+        sum += x;
+    }
+
+    out->lat_min_ns = timer_tsc_to_ns(v[0]);
+    out->lat_max_ns = timer_tsc_to_ns(v[n - 1]);
+    out->lat_avg_ns = timer_tsc_to_ns(sum / n);
+    out->lat_p99_ns = timer_tsc_to_ns(v[(n * 99 + 99) / 100 - 1]);
+}
+
+void input_reset_stats(void)
+{
+    for (int s = 0; s < INPUT_SRC_COUNT; s++)
+        src_events[s] = 0;
+    dropped = 0;
+    high_water = 0;
+    lat_pos = 0;
+    lat_count = 0;
+}
+
+const char *input_source_name(enum input_source src)
+{
+    if ((unsigned)src >= INPUT_SRC_COUNT)
+        return "?";
+    return source_names[src];
+}
+
+void input_dump_stats(void)
+{
+    struct input_stats st;
+    input_get_stats(&st);
+
+    kprintf("\nInput Events:\n");
+    for (int s = 0; s < INPUT_SRC_COUNT; s++)
+        kprintf("  %s: %lu\n", source_names[s], (unsigned long)st.events[s]);
+    kprintf("  Ring: %u/%d deepest, %lu dropped\n",
+            st.high_water, INPUT_RING_SIZE, (unsigned long)st.dropped);
+
+    kprintf("\nInput-to-photon latency (last %u events):\n", st.lat_samples);
+    if (st.lat_samples == 0) {
+        kprintf("  No samples (desktop not running?)\n");
+        return;
+    }
+    kprintf("  min %lu us, avg %lu us, p99 %lu us, max %lu us\n",
+            (unsigned long)(st.lat_min_ns / 1000),
+            (unsigned long)(st.lat_avg_ns / 1000),
+            (unsigned long)(st.lat_p99_ns / 1000),
+            (unsigned long)(st.lat_max_ns / 1000));
+}
@@ -0,0 +1,94 @@
+/*
+ * PhantomOS Input Event Ring
+ * "To Create, Not To Destroy"
+ *
+ * Single queue for all keyboard and mouse input. Interrupt handlers (PS/2
+ * keyboard, PS/2 mouse, UHCI completion) report timestamped events into a
+ * lock-free single-producer/single-consumer ring; the consumer drains it
+ * and applies each event to the keyboard buffer and mouse state that the
+ * rest of the kernel reads.
+ *
+ * The kernel is single-CPU and interrupt gates keep handlers from nesting,
+ * so all producers are serialized and the ring needs no lock. Any producer
+ * running outside an interrupt handler must do so with interrupts off.
+ *
+ * The desktop drains once at the start of every frame and calls
+ * input_frame_presented() after fb_flip(), which records how long each
+ * event took to reach the screen (input-to-photon latency).
+ */
+
+#ifndef PHANTOMOS_INPUT_H
+#define PHANTOMOS_INPUT_H
+
+#include <stdint.h>
+
+#define INPUT_RING_SIZE     256         /* Events (power of two) */
+#define INPUT_LAT_HISTORY   256         /* Latency samples kept for stats */
+
+/* Event types */
+#define INPUT_EV_SCANCODE   1           /* code = PS/2 set-1 scancode byte */
+#define INPUT_EV_KEY        2           /* code = translated character */
+#define INPUT_EV_REL        3           /* x/y = motion (screen axes), buttons */
+#define INPUT_EV_ABS        4           /* x/y = position in [0, 32767], buttons */
+
+/* Event sources */
+enum input_source {
+    INPUT_SRC_PS2_KBD = 0,
+    INPUT_SRC_PS2_MOUSE,
+    INPUT_SRC_USB_KBD,
+    INPUT_SRC_USB_MOUSE,
+    INPUT_SRC_COUNT
+};
+
+struct input_event {
+    uint64_t tsc;                       /* rdtsc() when reported */
+    uint8_t  type;                      /* INPUT_EV_* */
+    uint8_t  source;                    /* enum input_source */
+    uint8_t  code;
+    uint8_t  buttons;                   /* MOUSE_LEFT/RIGHT/MIDDLE */
+    int16_t  x;
+    int16_t  y;
+};                                      /* 16 bytes */
+
+/*============================================================================
+ * Producers (interrupt context)
+ *============================================================================*/
+
+void input_report_scancode(uint8_t scancode);
+void input_report_key(enum input_source src, uint8_t c);
+void input_report_rel(enum input_source src, int dx, int dy, uint8_t buttons);
+void input_report_abs(enum input_source src, int x, int y, uint8_t buttons);
+
+/*============================================================================
+ * Consumer
+ *============================================================================*/
+
+/* Apply all queued events; returns the number applied */
+int input_drain(void);
+
+/* The frame showing everything drained so far is on screen */
+void input_frame_presented(void);
+
+/*============================================================================
+ * Statistics
+ *============================================================================*/
+
+struct input_stats {
+    uint64_t events[INPUT_SRC_COUNT];   /* Reported, per source */
+    uint64_t dropped;                   /* Ring full */
+    uint32_t high_water;                /* Deepest the ring has been */
+    uint32_t lat_samples;               /* Latency samples in history */
+    uint64_t lat_min_ns;
+    uint64_t lat_avg_ns;
+    uint64_t lat_p99_ns;
+    uint64_t lat_max_ns;
+};
+
+void input_get_stats(struct input_stats *out);
+void input_reset_stats(void);
+const char *input_source_name(enum input_source src);
+
+/* Print ring and latency statistics to the console */
+void input_dump_stats(void);
+
+#endif /* PHANTOMOS_INPUT_H */
@@ -2,12 +2,15 @@
  * PhantomOS PS/2 Keyboard Driver
  * "To Create, Not To Destroy"
  *
- * Implementation of PS/2 keyboard handling.
+ * Implementation of PS/2 keyboard handling. IRQ1 only reports raw
+ * scancodes to the input ring (input.h); they are translated into the key
+ * buffer when the ring is drained, which every read below does first.
  */
 
 #include "keyboard.h"
 #include "idt.h"
 #include "pic.h"
+#include "input.h"
 #include <stdint.h>
 #include <stddef.h>
 
@@ -167,7 +170,7 @@ static uint8_t kbd_read_data(void)
  * Scancode Processing
  *============================================================================*/
 
-static void process_scancode(uint8_t scancode)
+void keyboard_process_scancode(uint8_t scancode)
 {
     /* Check for extended scancode prefix */
     if (scancode == SC_EXTENDED) {
@@ -314,11 +317,9 @@ static void keyboard_handler(struct interrupt_frame *frame)
 {
     (void)frame;
 
-    /* Read scancode from keyboard */
+    /* Read scancode from keyboard and queue it with its timestamp */
     uint8_t scancode = inb(KBD_DATA_PORT);
-
-    /* Process the scancode */
-    process_scancode(scancode);
+    input_report_scancode(scancode);
 
     /* Send EOI to PIC */
     pic_send_eoi(1);
@@ -358,20 +359,24 @@ void keyboard_init(void)
 
 int keyboard_has_key(void)
 {
+    input_drain();
     return !buffer_empty();
 }
 
 int keyboard_getchar(void)
 {
     /* Wait for a key */
+    input_drain();
     while (buffer_empty()) {
         __asm__ volatile("hlt");  /* Wait for interrupt */
+        input_drain();
     }
     return buffer_get();
 }
 
 int keyboard_getchar_nonblock(void)
 {
+    input_drain();
     return buffer_get();
 }
 
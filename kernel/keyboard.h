@@ -185,8 +185,15 @@ void keyboard_get_stats(uint64_t *keys_pressed, uint64_t *keys_released);
 void keyboard_dump_state(void);
 
 /*
- * Inject a character into the keyboard buffer (for USB HID keyboards)
+ * Inject a character into the keyboard buffer (USB HID keys, applied
+ * from the input ring)
  */
 void keyboard_inject_char(char c);
 
+/*
+ * Translate one set-1 scancode into the keyboard buffer (applied from
+ * the input ring)
+ */
+void keyboard_process_scancode(uint8_t scancode);
+
 #endif /* PHANTOMOS_KEYBOARD_H */
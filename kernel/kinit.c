@@ -0,0 +1,289 @@
+/*
+ * PhantomOS Kernel Init Steps
+ * "To Create, Not To Destroy"
+ *
+ * One record per step or milestone. Records are only appended by the boot
+ * thread; deferred tasks update their own record's timestamps and state
+ * and publish completion with a release store to state.
+ */
+
+#include "kinit.h"
+#include "process.h"
+#include "timer.h"
+#include "io.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/*============================================================================
+ * External Declarations
+ *============================================================================*/
+
+extern int kprintf(const char *fmt, ...);
+extern int strcmp(const char *s1, const char *s2);
+extern size_t strlen(const char *s);
+extern void *memcpy(void *dest, const void *src, size_t n);
+
+/*============================================================================
+ * State
+ *============================================================================*/
+
+#define REC_WAITING     0
+#define REC_RUNNING     1
+#define REC_DONE        2
+
+struct kinit_record {
+    const char              *name;
+    const struct kinit_step *step;      /* NULL for milestones */
+    uint64_t                 queued_tsc;
+    uint64_t                 start_tsc;
+    uint64_t                 end_tsc;
+    volatile int             state;
+    pid_t                    pid;       /* Task running it, 0 if boot thread */
+};
+
+static struct kinit_record records[KINIT_MAX_STEPS];
+static int record_count = 0;         /* Appended by the boot thread only */
+static uint64_t boot_tsc = 0;
+static volatile int deferred_left = 0;
+static volatile int boot_done = 0;
+static volatile int timeline_printed = 0;
+
+/*============================================================================
+ * Helpers
+ *============================================================================*/
+
+static struct kinit_record *find_record(const char *name)
+{
+    int n = __atomic_load_n(&record_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < n; i++) {
+        if (records[i].step && strcmp(records[i].name, name) == 0)
+            return &records[i];
+    }
+    return NULL;
+}
+
+static int rec_done(const struct kinit_record *r)
+{
+    return __atomic_load_n(&r->state, __ATOMIC_ACQUIRE) == REC_DONE;
+}
+
+/* Wait for every dependency of r; all of them are already recorded */
+static void wait_deps(struct kinit_record *r)
+{
+    for (int d = 0; d < KINIT_MAX_DEPS && r->step->deps[d]; d++) {
+        struct kinit_record *dep = find_record(r->step->deps[d]);
+        if (!dep)
+            continue;
+        while (!rec_done(dep)) {
+            if (sched_has_ready())
+                sched_yield();
+            else
+                __asm__ volatile("hlt");
+        }
+    }
+}
+
+static void run_record(struct kinit_record *r)
+{
+    r->start_tsc = rdtsc();
+    __atomic_store_n(&r->state, REC_RUNNING, __ATOMIC_RELAXED);
+    r->step->fn();
+    r->end_tsc = rdtsc();
+    __atomic_store_n(&r->state, REC_DONE, __ATOMIC_RELEASE);
+}
+
+/* Once, when both the boot thread and every deferred step are done */
+static void print_final_timeline(void)
+{
+    if (!__atomic_load_n(&boot_done, __ATOMIC_ACQUIRE) ||
+        __atomic_load_n(&deferred_left, __ATOMIC_ACQUIRE) != 0)
+        return;
+    if (__atomic_exchange_n(&timeline_printed, 1, __ATOMIC_ACQ_REL))
+        return;
+
+    kprintf("[init] Boot complete\n");
+    kinit_dump_timeline();
+}
+
+static void deferred_task(void *arg)
+{
+    struct kinit_record *r = (struct kinit_record *)arg;
+
+    wait_deps(r);
+    run_record(r);
+
+    if (__atomic_sub_fetch(&deferred_left, 1, __ATOMIC_ACQ_REL) == 0)
+        print_final_timeline();
+}
+
+/* Milliseconds since kernel entry, with microsecond fraction */
+static void print_ms(uint64_t tsc, int width)
+{
+    uint64_t us = tsc > boot_tsc ? timer_tsc_to_ns(tsc - boot_tsc) / 1000 : 0;
+    uint64_t ms = us / 1000;
+    int digits = 1;
+    for (uint64_t v = ms; v >= 10; v /= 10)
+        digits++;
+    for (int i = digits; i < width; i++)
+        kprintf(" ");
+    kprintf("%lu.%03lu", (unsigned long)ms, (unsigned long)(us % 1000));
+}
+
+/*============================================================================
+ * API
+ *============================================================================*/
+
+void kinit_begin(void)
+{
+    boot_tsc = rdtsc();
+}
+
+int kinit_run(const struct kinit_step *steps, int count)
+{
+    int unresolved = 0;
+
+    for (int i = 0; i < count; i++) {
+        const struct kinit_step *s = &steps[i];
+
+        if (record_count >= KINIT_MAX_STEPS) {
+            kprintf("[init] Too many steps, running %s untracked\n", s->name);
+            s->fn();
+            continue;
+        }
+
+        /* Dependencies must name steps that appear earlier */
+        for (int d = 0; d < KINIT_MAX_DEPS && s->deps[d]; d++) {
+            if (!find_record(s->deps[d])) {
+                kprintf("[init] %s: unknown or later dependency '%s'\n",
+                        s->name, s->deps[d]);
+                unresolved++;
+            }
+        }
+
+        /* Deferred tasks scan earlier records, so publish the count last */
+        struct kinit_record *r = &records[record_count];
+        r->name = s->name;
+        r->step = s;
+        r->queued_tsc = rdtsc();
+        r->state = REC_WAITING;
+        r->pid = 0;
+        __atomic_store_n(&record_count, record_count + 1, __ATOMIC_RELEASE);
+
+        if ((s->flags & KINIT_DEFERRED) && sched_running()) {
+            char pname[PROCESS_NAME_MAX];
+            size_t len = strlen(s->name);
+            if (len > PROCESS_NAME_MAX - 6)
+                len = PROCESS_NAME_MAX - 6;
+            memcpy(pname, "init:", 5);
+            memcpy(pname + 5, s->name, len);
+            pname[5 + len] = '\0';
+
+            __atomic_add_fetch(&deferred_left, 1, __ATOMIC_ACQ_REL);
+            r->pid = process_create(pname, deferred_task, r);
+            if (r->pid != PID_INVALID)
+                continue;
+            __atomic_sub_fetch(&deferred_left, 1, __ATOMIC_ACQ_REL);
+            r->pid = 0;
+        }
+
+        wait_deps(r);
+        run_record(r);
+    }
+
+    return unresolved;
+}
+
+void kinit_boot_done(void)
+{
+    __atomic_store_n(&boot_done, 1, __ATOMIC_RELEASE);
+    print_final_timeline();
+}
+
+void kinit_mark(const char *name)
+{
+    if (record_count >= KINIT_MAX_STEPS)
+        return;
+
+    struct kinit_record *r = &records[record_count];
+    r->name = name;
+    r->step = NULL;
+    r->queued_tsc = r->start_tsc = r->end_tsc = rdtsc();
+    r->pid = 0;
+    r->state = REC_DONE;
+    __atomic_store_n(&record_count, record_count + 1, __ATOMIC_RELEASE);
+}
+
+int kinit_is_done(const char *name)
+{
+    struct kinit_record *r = find_record(name);
+    return r && rec_done(r);
+}
+
+int kinit_pending(void)
+{
+    return __atomic_load_n(&deferred_left, __ATOMIC_ACQUIRE);
+}
+
+void kinit_dump_timeline(void)
+{
+    int order[KINIT_MAX_STEPS];
+    int n = __atomic_load_n(&record_count, __ATOMIC_ACQUIRE);
+
+    /* Insertion sort by start time; unstarted steps sort last */
+    for (int i = 0; i < n; i++) {
+        uint64_t key = records[i].state == REC_WAITING ?
+                       ~0ULL : records[i].start_tsc;
+        int j = i;
+        while (j > 0) {
+            const struct kinit_record *p = &records[order[j - 1]];
+            uint64_t pk = p->state == REC_WAITING ? ~0ULL : p->start_tsc;
+            if (pk <= key)
+                break;
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    kprintf("\nBoot timeline (ms since kernel entry):\n");
+    kprintf("       start        end   step\n");
+    for (int i = 0; i < n; i++) {
+        const struct kinit_record *r = &records[order[i]];
+        int state = __atomic_load_n(&r->state, __ATOMIC_ACQUIRE);
+
+        if (!r->step) {
+            kprintf("  ");
+            print_ms(r->start_tsc, 6);
+            kprintf("          -   [%s]\n", r->name);
+            continue;
+        }
+
+        kprintf("  ");
+        if (state == REC_WAITING) {
+            kprintf("   waiting");
+        } else {
+            print_ms(r->start_tsc, 6);
+        }
+        kprintf(" ");
+        if (state == REC_DONE) {
+            print_ms(r->end_tsc, 6);
+        } else {
+            kprintf("   running");
+        }
+        kprintf("   %s", r->name);
+        if (r->pid)
+            kprintf(" (deferred, PID %u, waited ", r->pid);
+        if (r->pid && state != REC_WAITING) {
+            uint64_t wait_us = timer_tsc_to_ns(r->start_tsc - r->queued_tsc) / 1000;
+            kprintf("%lu.%03lu ms)", (unsigned long)(wait_us / 1000),
+                    (unsigned long)(wait_us % 1000));
+        } else if (r->pid) {
+            kprintf("...)");
+        }
+        kprintf("\n");
+    }
+
+    if (deferred_left)
+        kprintf("  %d deferred step%s still pending\n", deferred_left,
+                deferred_left == 1 ? "" : "s");
+}
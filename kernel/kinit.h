@@ -0,0 +1,60 @@
+/*
+ * PhantomOS Kernel Init Steps
+ * "To Create, Not To Destroy"
+ *
+ * kmain describes boot as a table of named steps, each naming the steps it
+ * depends on. Immediate steps run in table order on the boot thread.
+ * Deferred steps (slow hardware probes) each get their own kernel task,
+ * which waits for its dependencies and then runs while the boot thread
+ * goes on to start the desktop.
+ *
+ * Every step records TSC timestamps (queued, started, finished), so the
+ * whole boot can be printed as a timeline relative to kernel entry.
+ */
+
+#ifndef PHANTOMOS_KINIT_H
+#define PHANTOMOS_KINIT_H
+
+#include <stdint.h>
+
+#define KINIT_MAX_STEPS     48          /* Steps plus milestones */
+#define KINIT_MAX_DEPS      4
+
+/* Step flags */
+#define KINIT_DEFERRED      0x01        /* Run in its own kernel task */
+
+struct kinit_step {
+    const char *name;
+    void      (*fn)(void);
+    uint32_t    flags;
+    const char *deps[KINIT_MAX_DEPS];   /* Step names; unused entries NULL */
+};
+
+/* Record the kernel entry TSC (call first thing in kmain) */
+void kinit_begin(void);
+
+/*
+ * Run a step table. Immediate steps run now, in order; an immediate step
+ * that depends on a deferred one waits for it. Deferred steps are spawned
+ * as kernel tasks once the scheduler exists (before that they run inline).
+ * Returns the number of steps whose dependencies could not be resolved.
+ */
+int kinit_run(const struct kinit_step *steps, int count);
+
+/* The boot thread is done with init; the timeline is printed as soon as
+ * the last deferred step has also finished */
+void kinit_boot_done(void);
+
+/* Record a milestone (e.g. "desktop ready") on the timeline */
+void kinit_mark(const char *name);
+
+/* Non-zero once the named step has finished */
+int kinit_is_done(const char *name);
+
+/* Deferred steps still queued or running */
+int kinit_pending(void);
+
+/* Print every step and milestone in start order with times in ms */
+void kinit_dump_timeline(void);
+
+#endif /* PHANTOMOS_KINIT_H */
@@ -32,12 +32,17 @@
 #include "vmware_svga.h"
 #include "usb.h"
 #include "usb_hid.h"
+#include "lapic.h"
+#include "xhci.h"
 #include "vm_detect.h"
 #include "kvm_clock.h"
 #include "virtio_console.h"
 #include "acpi.h"
 #include "virtio_net.h"
+#include "netstack.h"
 #include "desktop.h"
+#include "kinit.h"
+#include "pixel.h"
 
 /*============================================================================
  * Forward Declarations (from freestanding library)
@@ -350,50 +355,18 @@ static void print_banner(void)
 }
 
 /*============================================================================
- * Kernel Main Entry Point
- *============================================================================*/
-
-/*
- * kmain - Called from boot.S after long mode transition
+ * Boot Steps
  *
- * @mb_info: Pointer to multiboot2 information structure
- * @magic:   Multiboot2 magic number (should be 0x36d76289)
- */
-void kmain(struct multiboot_info *mb_info, uint32_t magic)
-{
-    /* Initialize serial port for debugging */
-    serial_init();
-
-    /* Clear screen and print banner */
-    vga_clear();
-    print_banner();
-
-    /* Verify multiboot2 magic */
-    if (magic != MULTIBOOT2_MAGIC) {
-        kprintf("ERROR: Invalid Multiboot2 magic number!\n");
-        kprintf("  Expected: 0x%08x\n", MULTIBOOT2_MAGIC);
-        kprintf("  Got:      0x%08x\n", magic);
-        kpanic("Multiboot2 verification failed");
-    }
-
-    kprintf("Multiboot2 Info:\n");
-    kprintf("  Magic:    0x%08x (valid)\n", magic);
-    kprintf("  Info at:  0x%016lx\n", (unsigned long)(uintptr_t)mb_info);
-    kprintf("  Size:     %u bytes\n", mb_info->total_size);
+ * Each step is one entry in boot_steps[] below. Steps that wait on slow
+ * hardware are deferred: they run as kernel tasks while the boot thread
+ * starts the desktop.
+ *============================================================================*/
 
-    /* Parse multiboot information */
-    parse_multiboot_info(mb_info);
+static struct multiboot_info *boot_mb_info = NULL;
+static kgeofs_volume_t *geofs_vol = NULL;
 
-    /* Print initialization status */
-    kprintf("\n");
-    kprintf("===========================================================\n");
-    kprintf("\n");
-    kprintf("Kernel Initialization:\n");
-    kprintf("  [OK] Serial port (COM1 @ 115200 baud)\n");
-    kprintf("  [OK] VGA text mode (80x25)\n");
-    kprintf("  [OK] Multiboot2 info parsed\n");
-
-    /* Initialize interrupt handling */
+static void init_interrupts(void)
+{
     idt_init();
     pic_init();
     timer_init();
@@ -401,45 +374,92 @@ void kmain(struct multiboot_info *mb_info, uint32_t magic)
     /* Enable interrupts */
     kprintf("  [OK] Interrupts enabled\n");
     sti();
+}
 
-    /* Initialize memory management */
-    pmm_init(mb_info);
+static void init_pmm(void)
+{
+    pmm_init(boot_mb_info);
     kprintf("  [OK] Physical memory manager\n");
+}
 
+static void init_vmm(void)
+{
     vmm_init();
     kprintf("  [OK] Virtual memory manager\n");
+}
 
+static void init_heap(void)
+{
     heap_init();
     kprintf("  [OK] Kernel heap\n");
 
-    /* Initialize PCI bus enumeration */
+    /* Test memory allocation */
+    void *test_ptr = kmalloc(1024);
+    if (test_ptr) {
+        kprintf("  [OK] Test allocation: 0x%lx\n", (unsigned long)test_ptr);
+        kfree(test_ptr);
+        kprintf("  [OK] Test free completed\n");
+    } else {
+        kprintf("  [!!] Test allocation failed\n");
+    }
+}
+
+static void init_sched(void)
+{
+    /* The boot thread becomes a process so deferred steps can run beside it */
+    sched_init();
+    sched_adopt("kmain");
+    kprintf("  [OK] Process scheduler\n");
+}
+
+static void init_pci(void)
+{
     pci_init();
     kprintf("  [OK] PCI bus enumeration\n");
+}
 
-    /* Detect hypervisor (before GPU HAL so backends can adjust) */
-    vm_detect_init();
-
-    /* Initialize KVM paravirtualized clock (after VM detection) */
-    kvm_clock_init();
+static void init_lapic(void)
+{
+    /* Local APIC (target for PCI MSI) */
+    if (lapic_init() == 0) {
+        kprintf("  [OK] Local APIC (ID %u)\n", lapic_id());
+    } else {
+        kprintf("  [--] Local APIC unavailable, no MSI\n");
+    }
+}
 
-    /* Initialize VirtIO console (after PCI, before framebuffer) */
+static void init_virtio_console(void)
+{
     virtio_console_init();
+}
 
-    /* Initialize VirtIO network (after PCI) */
+static void init_virtio_net(void)
+{
     virtio_net_init();
+}
 
-    /* Initialize ACPI power management */
+static void init_netstack(void)
+{
+    netstack_init();
+}
+
+static void init_acpi(void)
+{
     acpi_init();
+}
 
-    /* Initialize GPU HAL and register backends */
+static void init_gpu_hal(void)
+{
     gpu_hal_init();
     intel_gpu_register_hal();
     virtio_gpu_register_hal();
     vmware_svga_register_hal();
     bochs_vga_register_hal();
     kprintf("  [OK] GPU HAL initialized\n");
+}
 
-    /* Initialize framebuffer (needs heap for backbuffer) */
+static void init_framebuffer(void)
+{
     if (saved_fb_found) {
         if (fb_init(saved_fb_addr, saved_fb_width, saved_fb_height,
                     saved_fb_pitch, saved_fb_bpp) == 0) {
@@ -461,19 +481,11 @@ void kmain(struct multiboot_info *mb_info, uint32_t magic)
     } else {
         kprintf("  [--] No framebuffer (text mode)\n");
     }
+}
 
-    /* Test memory allocation */
-    void *test_ptr = kmalloc(1024);
-    if (test_ptr) {
-        kprintf("  [OK] Test allocation: 0x%lx\n", (unsigned long)test_ptr);
-        kfree(test_ptr);
-        kprintf("  [OK] Test free completed\n");
-    } else {
-        kprintf("  [!!] Test allocation failed\n");
-    }
-
+static void init_geofs(void)
+{
     /* Initialize kernel GeoFS */
-    kgeofs_volume_t *geofs_vol = NULL;
     kgeofs_error_t gerr = kgeofs_volume_create(0, 0, 0, &geofs_vol);
     if (gerr == KGEOFS_OK) {
         kprintf("  [OK] GeoFS volume created\n");
@@ -541,28 +553,35 @@ void kmain(struct multiboot_info *mb_info, uint32_t magic)
         kprintf("  [!!] GeoFS volume creation failed: %s\n", kgeofs_strerror(gerr));
     }
     kprintf("\n");
+}
 
-    /* Initialize scheduler */
-    sched_init();
-    kprintf("  [OK] Process scheduler\n");
-
-    /* Initialize Governor (policy enforcement) */
+static void init_governor(void)
+{
     governor_init();
     kprintf("  [OK] Governor system\n");
+}
 
-    /* Initialize keyboard driver */
+static void init_keyboard(void)
+{
     keyboard_init();
     kprintf("  [OK] PS/2 keyboard driver\n");
+}
 
-    /* Initialize mouse driver */
+static void init_mouse(void)
+{
     mouse_init();
     kprintf("  [OK] PS/2 mouse driver\n");
+}
 
-    /* Initialize ATA disk driver */
+static void init_ata(void)
+{
     ata_init();
     kprintf("  [OK] ATA disk driver\n");
+}
 
-    /* Initialize USB (UHCI) host controller and HID devices */
+static void init_usb(void)
+{
+    /* UHCI host controller and HID devices */
     usb_init();
     if (usb_is_initialized()) {
         kprintf("  [OK] USB UHCI host controller (%d device%s)\n",
@@ -570,6 +589,113 @@ void kmain(struct multiboot_info *mb_info, uint32_t magic)
     } else {
         kprintf("  [--] USB: No UHCI controller found\n");
     }
+}
+
+static void init_xhci(void)
+{
+    /* xHCI (USB 3) host controller, HID and mass storage */
+    xhci_init();
+    if (xhci_is_initialized()) {
+        kprintf("  [OK] USB xHCI host controller (%d device%s)\n",
+                xhci_device_count(), xhci_device_count() == 1 ? "" : "s");
+    } else {
+        kprintf("  [--] USB: No xHCI controller found\n");
+    }
+}
+
+static void init_shell(void)
+{
+    /* Needed for the terminal window too */
+    shell_init(geofs_vol);
+    kprintf("  [OK] Shell initialized\n\n");
+}
+
+/*
+ * Boot order. A step may only depend on steps listed above it. ATA
+ * identify and USB port resets wait on hardware for tens to hundreds of
+ * milliseconds, so they are deferred; the xHCI step also waits for UHCI
+ * because usb_init() resets the shared HID table.
+ */
+static const struct kinit_step boot_steps[] = {
+    { "interrupts",     init_interrupts,     0, { NULL } },
+    { "pmm",            init_pmm,            0, { NULL } },
+    { "vmm",            init_vmm,            0, { "pmm" } },
+    { "heap",           init_heap,           0, { "vmm" } },
+    { "sched",          init_sched,          0, { "heap", "interrupts" } },
+    { "pci",            init_pci,            0, { "heap" } },
+    { "lapic",          init_lapic,          0, { "vmm" } },
+    /* Hypervisor detection before the clock and GPU backends */
+    { "vm_detect",      vm_detect_init,      0, { NULL } },
+    { "kvm_clock",      kvm_clock_init,      0, { "vm_detect" } },
+    /* SIMD state and pixel kernels before any drawing */
+    { "pixel",          px_init,             0, { NULL } },
+    { "virtio_console", init_virtio_console, 0, { "pci" } },
+    { "virtio_net",     init_virtio_net,     0,
+                                             { "pci", "heap", "sched", "lapic" } },
+    { "netstack",       init_netstack,       0, { "virtio_net" } },
+    { "acpi",           init_acpi,           0, { "vmm" } },
+    { "gpu_hal",        init_gpu_hal,        0, { "pci", "vm_detect" } },
+    { "framebuffer",    init_framebuffer,    0, { "gpu_hal", "heap", "pixel" } },
+    { "geofs",          init_geofs,          0, { "heap" } },
+    { "governor",       init_governor,       0, { "heap" } },
+    { "keyboard",       init_keyboard,       0, { "interrupts" } },
+    { "mouse",          init_mouse,          0, { "interrupts" } },
+    { "ata",            init_ata,            KINIT_DEFERRED, { "sched" } },
+    { "usb",            init_usb,            KINIT_DEFERRED,
+                                             { "pci", "keyboard", "mouse" } },
+    { "xhci",           init_xhci,           KINIT_DEFERRED, { "usb", "lapic" } },
+    { "shell",          init_shell,          0, { "geofs" } },
+};
+
+/*============================================================================
+ * Kernel Main Entry Point
+ *============================================================================*/
+
+/*
+ * kmain - Called from boot.S after long mode transition
+ *
+ * @mb_info: Pointer to multiboot2 information structure
+ * @magic:   Multiboot2 magic number (should be 0x36d76289)
+ */
+void kmain(struct multiboot_info *mb_info, uint32_t magic)
+{
+    kinit_begin();
+
+    /* Initialize serial port for debugging */
+    serial_init();
+
+    /* Clear screen and print banner */
+    vga_clear();
+    print_banner();
+
+    /* Verify multiboot2 magic */
+    if (magic != MULTIBOOT2_MAGIC) {
+        kprintf("ERROR: Invalid Multiboot2 magic number!\n");
+        kprintf("  Expected: 0x%08x\n", MULTIBOOT2_MAGIC);
+        kprintf("  Got:      0x%08x\n", magic);
+        kpanic("Multiboot2 verification failed");
+    }
+
+    kprintf("Multiboot2 Info:\n");
+    kprintf("  Magic:    0x%08x (valid)\n", magic);
+    kprintf("  Info at:  0x%016lx\n", (unsigned long)(uintptr_t)mb_info);
+    kprintf("  Size:     %u bytes\n", mb_info->total_size);
+
+    /* Parse multiboot information */
+    parse_multiboot_info(mb_info);
+
+    /* Print initialization status */
+    kprintf("\n");
+    kprintf("===========================================================\n");
+    kprintf("\n");
+    kprintf("Kernel Initialization:\n");
+    kprintf("  [OK] Serial port (COM1 @ 115200 baud)\n");
+    kprintf("  [OK] VGA text mode (80x25)\n");
+    kprintf("  [OK] Multiboot2 info parsed\n");
+
+    kinit_mark("multiboot parsed");
+    boot_mb_info = mb_info;
+    kinit_run(boot_steps, sizeof(boot_steps) / sizeof(boot_steps[0]));
 
     /* Print memory statistics */
     pmm_dump_stats();
@@ -589,16 +715,14 @@ void kmain(struct multiboot_info *mb_info, uint32_t magic)
     kprintf("===========================================================\n");
     kprintf("\n");
 
-    /* Initialize shell (needed for terminal window too) */
-    shell_init(geofs_vol);
-    kprintf("  [OK] Shell initialized\n\n");
-
     /* Launch GUI desktop if framebuffer available, otherwise text shell */
     if (fb_is_initialized()) {
         kprintf("Launching graphical desktop...\n");
         kprintf("Press Ctrl+A, X to exit QEMU.\n\n");
 
         desktop_init(geofs_vol);
+        kinit_mark("desktop ready");
+        kinit_boot_done();
         desktop_run();  /* Returns on ACPI shutdown */
         acpi_poweroff();
     } else {
@@ -606,6 +730,8 @@ void kmain(struct multiboot_info *mb_info, uint32_t magic)
         kprintf("Type 'help' for available commands.\n");
         kprintf("Press Ctrl+A, X to exit QEMU.\n\n");
 
+        kinit_mark("shell ready");
+        kinit_boot_done();
         shell_run();
 
         kprintf("\nShell exited. System halted.\n");
@@ -0,0 +1,64 @@
+/*
+ * PhantomOS Kernel Symbol Table
+ * "To Create, Not To Destroy"
+ *
+ * Lookup over the address-sorted table generated into ksyms_gen.c. The
+ * table symbols are weak so the first link pass, which has no table yet,
+ * still resolves; lookups then simply find nothing.
+ */
+
+#include "ksyms.h"
+#include <stdint.h>
+#include <stddef.h>
+
+extern const struct ksym ksym_table[] __attribute__((weak));
+extern const uint32_t ksym_count __attribute__((weak));
+
+/* Linker script markers */
+extern char __text_start[];
+extern char __text_end[];
+
+uint32_t ksym_total(void)
+{
+    return &ksym_count ? ksym_count : 0;
+}
+
+int ksym_in_text(uint64_t addr)
+{
+    return addr >= (uint64_t)__text_start && addr < (uint64_t)__text_end;
+}
+
+int ksym_index(uint64_t addr)
+{
+    uint32_t n = ksym_total();
+    if (n == 0 || !ksym_in_text(addr) || addr < ksym_table[0].addr)
+        return -1;
+
+    /* Last symbol with addr <= target */
+    uint32_t lo = 0, hi = n - 1;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        if (ksym_table[mid].addr <= addr)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return (int)lo;
+}
+
+const char *ksym_name(int index)
+{
+    if (index < 0 || (uint32_t)index >= ksym_total())
+        return NULL;
+    return ksym_table[index].name;
+}
+
+const char *ksym_lookup(uint64_t addr, uint64_t *offset)
+{
+    int i = ksym_index(addr);
+    if (i < 0)
+        return NULL;
+    if (offset)
+        *offset = addr - ksym_table[i].addr;
+    return ksym_table[i].name;
+}
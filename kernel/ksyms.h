@@ -0,0 +1,37 @@
+/*
+ * PhantomOS Kernel Symbol Table
+ * "To Create, Not To Destroy"
+ *
+ * Function addresses of the running kernel, for turning sampled or
+ * faulting RIPs into names. The table is generated at link time:
+ * phantomos.elf is linked once, tools/ksyms.sh turns `nm -n` of that
+ * image into kernel/ksyms_gen.c, and the kernel is linked again with the
+ * table added. The table only lives in .rodata, which follows .text, so
+ * function addresses are identical between the two links.
+ */
+
+#ifndef PHANTOMOS_KSYMS_H
+#define PHANTOMOS_KSYMS_H
+
+#include <stdint.h>
+
+struct ksym {
+    uint64_t    addr;
+    const char *name;
+};
+
+/* Index of the function containing addr, or -1 if outside kernel text */
+int ksym_index(uint64_t addr);
+
+/* Name of the function containing addr (NULL if unknown); *offset is
+ * set to addr's distance from the function start when non-NULL */
+const char *ksym_lookup(uint64_t addr, uint64_t *offset);
+
+/* Number of symbols and name of symbol i */
+uint32_t ksym_total(void);
+const char *ksym_name(int index);
+
+/* Is addr inside kernel .text? */
+int ksym_in_text(uint64_t addr);
+
+#endif /* PHANTOMOS_KSYMS_H */
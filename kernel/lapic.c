@@ -0,0 +1,79 @@
+/*
+ * PhantomOS Local APIC
+ * "To Create, Not To Destroy"
+ */
+
+#include "lapic.h"
+#include "vmm.h"
+#include "io.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/*============================================================================
+ * External Declarations
+ *============================================================================*/
+
+extern int kprintf(const char *fmt, ...);
+
+/*============================================================================
+ * State
+ *============================================================================*/
+
+static volatile uint32_t *lapic_regs = NULL;
+
+static inline uint32_t lapic_read(uint32_t reg)
+{
+    return lapic_regs[reg / 4];
+}
+
+static inline void lapic_write(uint32_t reg, uint32_t val)
+{
+    lapic_regs[reg / 4] = val;
+}
+
+/*============================================================================
+ * API
+ *============================================================================*/
+
+int lapic_init(void)
+{
+    uint64_t base = rdmsr(MSR_APIC_BASE);
+
+    if (!(base & APIC_BASE_ENABLE) || (base & APIC_BASE_X2APIC)) {
+        kprintf("[LAPIC] Not in xAPIC mode (base MSR 0x%lx), MSI disabled\n",
+                (unsigned long)base);
+        return -1;
+    }
+
+    uint64_t phys = base & APIC_BASE_ADDR_MASK;
+    vmm_map_page(phys, phys,
+                 PTE_PRESENT | PTE_WRITABLE | PTE_NOCACHE | PTE_WRITETHROUGH);
+    volatile uint32_t *regs = (volatile uint32_t *)(uintptr_t)phys;
+
+    /* Enabling it here would mask LINT0 and cut off the PIC */
+    if (!(regs[LAPIC_REG_SVR / 4] & LAPIC_SVR_ENABLE)) {
+        kprintf("[LAPIC] Software-disabled by firmware, MSI disabled\n");
+        return -1;
+    }
+
+    lapic_regs = regs;
+    kprintf("[LAPIC] xAPIC at 0x%lx, ID %u\n", (unsigned long)phys,
+            (unsigned)lapic_id());
+    return 0;
+}
+
+int lapic_available(void)
+{
+    return lapic_regs != NULL;
+}
+
+uint8_t lapic_id(void)
+{
+    return lapic_regs ? (uint8_t)(lapic_read(LAPIC_REG_ID) >> 24) : 0;
+}
+
+void lapic_eoi(void)
+{
+    if (lapic_regs)
+        lapic_write(LAPIC_REG_EOI, 0);
+}
@@ -0,0 +1,45 @@
+/*
+ * PhantomOS Local APIC
+ * "To Create, Not To Destroy"
+ *
+ * Minimal xAPIC access for message-signalled interrupts. Legacy IRQs still
+ * arrive through the 8259 PIC in virtual-wire mode; the local APIC is only
+ * used as the target of MSI writes and must be EOI'd by MSI handlers.
+ *
+ * The APIC is used as the firmware left it: if it is not globally and
+ * software enabled (or is in x2APIC mode) lapic_available() is false and
+ * drivers fall back to INTx or polling.
+ */
+
+#ifndef PHANTOMOS_LAPIC_H
+#define PHANTOMOS_LAPIC_H
+
+#include <stdint.h>
+
+#define MSR_APIC_BASE           0x1B
+#define APIC_BASE_ENABLE        (1ULL << 11)
+#define APIC_BASE_X2APIC        (1ULL << 10)
+#define APIC_BASE_ADDR_MASK     0xFFFFF000ULL
+
+#define LAPIC_REG_ID            0x020
+#define LAPIC_REG_EOI           0x0B0
+#define LAPIC_REG_SVR           0x0F0
+#define LAPIC_SVR_ENABLE        (1 << 8)
+
+/* MSI address/data for delivery to a local APIC (fixed, edge) */
+#define MSI_ADDR_BASE           0xFEE00000U
+#define MSI_ADDR_DEST_SHIFT     12
+
+/* Map the local APIC if the firmware left it enabled. 0 if usable */
+int lapic_init(void);
+
+/* MSIs can be delivered */
+int lapic_available(void);
+
+/* APIC ID of this CPU (MSI destination) */
+uint8_t lapic_id(void);
+
+/* Signal end of interrupt (MSI handlers only) */
+void lapic_eoi(void);
+
+#endif /* PHANTOMOS_LAPIC_H */
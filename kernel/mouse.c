@@ -3,13 +3,16 @@
  * "To Create, Not To Destroy"
  *
  * PS/2 mouse via 8042 controller auxiliary port.
- * Handles 3-byte standard PS/2 mouse packets on IRQ12.
+ * Handles 3-byte standard PS/2 mouse packets on IRQ12. Complete packets
+ * are reported to the input ring (input.h) and applied to the cursor state
+ * when it is drained; every state query below drains first.
  */
 
 #include "mouse.h"
 #include "idt.h"
 #include "pic.h"
 #include "framebuffer.h"
+#include "input.h"
 #include <stdint.h>
 
 /*============================================================================
@@ -165,26 +168,8 @@ static void mouse_handler(struct interrupt_frame *frame)
             return;
         }
 
-        /* Update position (PS/2 Y is inverted: positive = up) */
-        state.x += dx;
-        state.y -= dy;
-
-        /* Clamp to screen bounds */
-        if (state.x < 0) state.x = 0;
-        if (state.y < 0) state.y = 0;
-        if (state.x >= screen_w) state.x = screen_w - 1;
-        if (state.y >= screen_h) state.y = screen_h - 1;
-
-        /* Update buttons */
-        uint8_t new_buttons = flags & 0x07;
-        if (new_buttons != state.buttons) {
-            state.clicked = 1;
-        }
-        state.buttons = new_buttons;
-
-        if (dx != 0 || dy != 0) {
-            state.moved = 1;
-        }
+        /* Queue in screen axes (PS/2 Y is inverted: positive = up) */
+        input_report_rel(INPUT_SRC_PS2_MOUSE, dx, -dy, flags & 0x07);
     }
 
     pic_send_eoi(12);
@@ -247,6 +232,7 @@ void mouse_init(void)
 
 void mouse_get_state(struct mouse_state *out)
 {
+    input_drain();
     out->x = state.x;
     out->y = state.y;
     out->buttons = state.buttons;
@@ -258,11 +244,13 @@ void mouse_get_state(struct mouse_state *out)
 
 int mouse_has_moved(void)
 {
+    input_drain();
     return state.moved;
 }
 
 int mouse_has_clicked(void)
 {
+    input_drain();
     return state.clicked;
 }
 
@@ -57,13 +57,13 @@ int mouse_has_moved(void);
 int mouse_has_clicked(void);
 
 /*
- * Inject mouse movement/button data (for USB HID mice)
+ * Apply mouse movement/button data (applied from the input ring)
  */
 void mouse_inject_movement(int dx, int dy, uint8_t buttons);
 
 /*
- * Set absolute mouse position (for USB tablet devices via VNC)
- * x, y are in range [0, 32767] mapped to screen coordinates
+ * Set absolute mouse position (USB tablet devices via VNC, applied from
+ * the input ring). x, y are in range [0, 32767] mapped to screen coordinates
  */
 void mouse_set_absolute(int abs_x, int abs_y, uint8_t buttons);
 
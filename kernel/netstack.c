@@ -0,0 +1,1697 @@
+/*
+ * PhantomOS Kernel Network Stack
+ * "To Create, Not To Destroy"
+ *
+ * UDP and TCP on top of virtio_net_send_ipv4() / netstack_input().
+ *
+ * TCP implements what a LAN or QEMU user-mode link needs to move data at
+ * line rate without stalling:
+ *   - MSS and window scale options on SYN (RFC 7323 scaling)
+ *   - Delayed ACKs: every second full segment, else after TCP_DELACK_MS
+ *   - Nagle's algorithm, disabled per socket with NET_OPT_NODELAY
+ *   - Retransmission timeout from smoothed RTT (RFC 6298, Karn's rule),
+ *     go-back-N from the first unacknowledged byte, exponential backoff
+ *   - FIN handshake in both directions, short TIME_WAIT, RST for segments
+ *     that match no socket
+ * Out-of-order segments are dropped and answered with a duplicate ACK;
+ * there is no reassembly queue, SACK or congestion control.
+ *
+ * Data segments go to the driver in batches, with the payload read by the
+ * device straight out of the send queue's pbufs. A pbuf freed (acked)
+ * while the device may still be reading it waits on a deferred list
+ * until its transmit reference drops.
+ *
+ * Everything runs under one lock (a yield spin like virtio_net's transmit
+ * lock). Lock order is netstack, then the driver's transmit lock.
+ */
+
+#include "netstack.h"
+#include "virtio_net.h"
+#include "pmm.h"
+#include "timer.h"
+#include "process.h"
+#include "io.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/*============================================================================
+ * External Declarations
+ *============================================================================*/
+
+extern int kprintf(const char *fmt, ...);
+extern void *memset(void *s, int c, size_t n);
+extern void *memcpy(void *dest, const void *src, size_t n);
+
+/*============================================================================
+ * Constants
+ *============================================================================*/
+
+#define IP_PROTO_TCP        6
+#define IP_PROTO_UDP        17
+
+#define TCP_FIN             0x01
+#define TCP_SYN             0x02
+#define TCP_RST             0x04
+#define TCP_PSH             0x08
+#define TCP_ACK             0x10
+
+#define TCP_OPT_END         0
+#define TCP_OPT_NOP         1
+#define TCP_OPT_MSS         2
+#define TCP_OPT_WSCALE      3
+
+#define TCP_HLEN            20
+#define TCP_SYN_OPTLEN      8           /* MSS (4) + NOP + window scale (3) */
+#define TCP_WSCALE          2           /* NET_TCP_RCV_BUF >> 2 fits 16 bits */
+#define TCP_DEFAULT_MSS     536         /* Peer sent no MSS option */
+#define TCP_DELACK_MS       40
+#define TCP_RTO_INITIAL_MS  1000
+#define TCP_RTO_MIN_MS      200
+#define TCP_RTO_MAX_MS      60000
+#define TCP_MAX_RETRIES     8
+#define TCP_TIME_WAIT_MS    2000        /* Far below 2*MSL; fine for a LAN */
+#define TCP_FIN_WAIT_2_MS   30000       /* Give up on a peer that never closes */
+#define TCP_BACKLOG         4           /* Unaccepted connections per listener */
+#define TCP_TX_BATCH        16          /* Data segments per driver call */
+
+#define UDP_HLEN            8
+
+#define EPHEMERAL_FIRST     49152
+
+/* pbufs kept back from receive-window advertisements for sends and ACKs */
+#define PBUF_RESERVE        16
+#define PBUF_POOL           0xFFFF      /* ring_id of pool-backed data */
+
+/* Socket types */
+#define SOCK_FREE           0
+#define SOCK_UDP            1
+#define SOCK_TCP            2
+
+/* TCP states */
+enum {
+    TCP_CLOSED = 0,
+    TCP_LISTEN,
+    TCP_SYN_SENT,
+    TCP_SYN_RCVD,
+    TCP_ESTABLISHED,
+    TCP_FIN_WAIT_1,
+    TCP_FIN_WAIT_2,
+    TCP_CLOSE_WAIT,
+    TCP_CLOSING,
+    TCP_LAST_ACK,
+    TCP_TIME_WAIT,
+};
+
+static const char *tcp_state_names[] = {
+    "CLOSED", "LISTEN", "SYN_SENT", "SYN_RCVD", "ESTABLISHED",
+    "FIN_WAIT_1", "FIN_WAIT_2", "CLOSE_WAIT", "CLOSING", "LAST_ACK",
+    "TIME_WAIT",
+};
+
+/*============================================================================
+ * Byte Order and Sequence Arithmetic
+ *============================================================================*/
+
+static inline uint16_t htons(uint16_t x)
+{
+    return (uint16_t)((x >> 8) | (x << 8));
+}
+static inline uint16_t ntohs(uint16_t x) { return htons(x); }
+
+static inline uint32_t htonl(uint32_t x)
+{
+    return ((x & 0xFF) << 24) | ((x & 0xFF00) << 8) |
+           ((x & 0xFF0000) >> 8) | ((x & 0xFF000000) >> 24);
+}
+static inline uint32_t ntohl(uint32_t x) { return htonl(x); }
+
+static inline int seq_lt(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+static inline int seq_le(uint32_t a, uint32_t b) { return (int32_t)(a - b) <= 0; }
+static inline int seq_gt(uint32_t a, uint32_t b) { return (int32_t)(a - b) > 0; }
+static inline int seq_ge(uint32_t a, uint32_t b) { return (int32_t)(a - b) >= 0; }
+
+/*============================================================================
+ * Wire Formats
+ *============================================================================*/
+
+struct udp_hdr {
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint16_t length;
+    uint16_t checksum;
+} __attribute__((packed));
+
+struct tcp_hdr {
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint32_t seq;
+    uint32_t ack;
+    uint8_t  data_off;          /* Header length in words, high nibble */
+    uint8_t  flags;
+    uint16_t window;
+    uint16_t checksum;
+    uint16_t urgent;
+} __attribute__((packed));
+
+/*============================================================================
+ * Packet Buffers
+ *============================================================================*/
+
+struct pbuf {
+    struct pbuf *next;
+    uint8_t     *data;          /* First byte not yet consumed */
+    uint32_t     len;
+    uint32_t     seq;           /* TCP: sequence number of data[0] */
+    uint32_t     src_ip;        /* UDP: sender */
+    uint16_t     src_port;
+    uint16_t     ring_id;       /* Held receive buffer, or PBUF_POOL */
+    uint8_t     *storage;       /* NET_PBUF_SIZE bytes of pool memory */
+    volatile uint32_t tx_refs;  /* Transmits the device may still be reading */
+};
+
+struct pbuf_queue {
+    struct pbuf *head;
+    struct pbuf *tail;
+};
+
+/*============================================================================
+ * Sockets
+ *============================================================================*/
+
+struct socket {
+    uint8_t  type;
+    uint8_t  state;             /* TCP state */
+    uint8_t  orphan;            /* Closed by the user, finishing in background */
+    uint8_t  nodelay;
+    uint8_t  close_requested;   /* Send FIN once the send queue drains */
+    uint8_t  fin_sent;
+    uint8_t  peer_fin;          /* Peer's FIN received in order */
+    int8_t   parent;            /* Listener for unaccepted connections */
+    int      error;             /* Sticky NET_ERR_* once aborted */
+
+    uint16_t local_port;
+    uint16_t remote_port;
+    uint32_t remote_ip;
+
+    /* Send side: snd_q holds unacked and unsent data, one segment per pbuf */
+    struct pbuf_queue snd_q;
+    uint32_t snd_queued;        /* Bytes in snd_q */
+    uint32_t iss;
+    uint32_t snd_una;           /* Oldest unacknowledged */
+    uint32_t snd_nxt;           /* Next to send (rewound on timeout) */
+    uint32_t snd_max;           /* Highest ever sent */
+    uint32_t snd_wnd;           /* Peer's window in bytes, scaled */
+    uint32_t fin_seq;
+    uint16_t mss;               /* Segment size we send */
+    uint8_t  snd_wscale;
+    uint8_t  rcv_wscale;
+
+    /* Receive side: in-order payload (TCP) or datagrams (UDP) */
+    struct pbuf_queue rcv_q;
+    uint32_t rcv_queued;        /* Bytes (TCP) or datagrams (UDP) */
+    uint32_t rcv_nxt;
+    uint32_t rcv_adv;           /* Right edge of the last advertised window */
+
+    /* Timers (absolute ms, 0 = off) */
+    uint64_t rto_deadline;
+    uint64_t ack_deadline;
+    uint64_t time_wait_end;
+    uint32_t rto_ms;
+    uint32_t srtt_ms;           /* 0 until the first sample */
+    uint32_t rttvar_ms;
+    uint32_t rtt_seq;           /* Timed segment; valid while rtt_start != 0 */
+    uint64_t rtt_start;
+    uint8_t  retries;
+    uint8_t  ack_pending;       /* Full segments received since our last ACK */
+};
+
+static struct {
+    int                   ready;
+    volatile int          busy;
+    struct pbuf           pbufs[NET_PBUF_COUNT];
+    struct pbuf          *free_list;
+    uint32_t              free_count;
+    struct pbuf          *deferred;     /* Freed while still being sent */
+    uint32_t              deferred_count;
+    uint8_t              *storage;
+    struct socket         sockets[NET_MAX_SOCKETS];
+    uint16_t              next_port;
+    struct netstack_stats stats;
+} net;
+
+static void net_lock(void)
+{
+    while (__atomic_exchange_n(&net.busy, 1, __ATOMIC_ACQUIRE))
+        sched_yield();
+}
+
+static void net_unlock(void)
+{
+    __atomic_store_n(&net.busy, 0, __ATOMIC_RELEASE);
+}
+
+/*============================================================================
+ * pbuf Pool
+ *============================================================================*/
+
+/* Return deferred pbufs whose transmits have completed to the pool */
+static void pbuf_reap(void)
+{
+    struct pbuf **link = &net.deferred;
+    while (*link) {
+        struct pbuf *p = *link;
+        if (__atomic_load_n(&p->tx_refs, __ATOMIC_ACQUIRE)) {
+            link = &p->next;
+            continue;
+        }
+        *link = p->next;
+        net.deferred_count--;
+        p->next = net.free_list;
+        net.free_list = p;
+        net.free_count++;
+    }
+}
+
+static struct pbuf *pbuf_alloc(void)
+{
+    if (!net.free_list && net.deferred) {
+        virtio_net_tx_reclaim();
+        pbuf_reap();
+    }
+
+    struct pbuf *p = net.free_list;
+    if (!p) {
+        net.stats.pbuf_exhausted++;
+        return NULL;
+    }
+    net.free_list = p->next;
+    net.free_count--;
+    p->next = NULL;
+    p->data = p->storage;
+    p->len = 0;
+    p->ring_id = PBUF_POOL;
+    return p;
+}
+
+static void pbuf_free(struct pbuf *p)
+{
+    if (p->ring_id != PBUF_POOL)
+        virtio_net_buf_release(p->ring_id);
+    if (__atomic_load_n(&p->tx_refs, __ATOMIC_ACQUIRE)) {
+        p->next = net.deferred;
+        net.deferred = p;
+        net.deferred_count++;
+        return;
+    }
+    p->next = net.free_list;
+    net.free_list = p;
+    net.free_count++;
+}
+
+/*
+ * Wrap received payload in a pbuf: keep it in the receive ring when the
+ * driver lets us hold the buffer, otherwise copy it into pool storage.
+ */
+static struct pbuf *pbuf_from_rx(struct net_buf *buf, const uint8_t *data,
+                                 uint32_t len)
+{
+    if (len > NET_PBUF_SIZE)
+        return NULL;
+    struct pbuf *p = pbuf_alloc();
+    if (!p)
+        return NULL;
+
+    if (virtio_net_buf_hold(buf) == 0) {
+        p->data = (uint8_t *)data;
+        p->ring_id = buf->id;
+        net.stats.rx_zero_copy++;
+    } else {
+        memcpy(p->storage, data, len);
+        net.stats.rx_copied++;
+    }
+    p->len = len;
+    return p;
+}
+
+static void queue_push(struct pbuf_queue *q, struct pbuf *p)
+{
+    p->next = NULL;
+    if (q->tail)
+        q->tail->next = p;
+    else
+        q->head = p;
+    q->tail = p;
+}
+
+static struct pbuf *queue_pop(struct pbuf_queue *q)
+{
+    struct pbuf *p = q->head;
+    if (p) {
+        q->head = p->next;
+        if (!q->head)
+            q->tail = NULL;
+        p->next = NULL;
+    }
+    return p;
+}
+
+static void queue_free(struct pbuf_queue *q)
+{
+    struct pbuf *p;
+    while ((p = queue_pop(q)) != NULL)
+        pbuf_free(p);
+}
+
+/*============================================================================
+ * Checksums
+ *============================================================================*/
+
+static uint32_t csum_add(uint32_t sum, const void *data, uint32_t len)
+{
+    const uint16_t *words = (const uint16_t *)data;
+    while (len > 1) {
+        sum += *words++;
+        len -= 2;
+    }
+    if (len == 1)
+        sum += *(const uint8_t *)words;
+    return sum;
+}
+
+static uint16_t csum_fold(uint32_t sum)
+{
+    while (sum >> 16)
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    return (uint16_t)~sum;
+}
+
+/*
+ * UDP/TCP checksum with the IPv4 pseudo-header over hdr then data (hdr_len
+ * must be even); 0 when a received segment, checksum field included, is
+ * intact.
+ */
+static uint16_t transport_checksum(uint32_t src_ip, uint32_t dst_ip,
+                                   uint8_t protocol,
+                                   const void *hdr, uint32_t hdr_len,
+                                   const void *data, uint32_t len)
+{
+    struct {
+        uint32_t src;
+        uint32_t dst;
+        uint8_t  zero;
+        uint8_t  protocol;
+        uint16_t length;
+    } __attribute__((packed)) ph;
+
+    ph.src = htonl(src_ip);
+    ph.dst = htonl(dst_ip);
+    ph.zero = 0;
+    ph.protocol = protocol;
+    ph.length = htons((uint16_t)(hdr_len + len));
+    uint32_t sum = csum_add(0, &ph, sizeof(ph));
+    sum = csum_add(sum, hdr, hdr_len);
+    return csum_fold(csum_add(sum, data, len));
+}
+
+/*============================================================================
+ * Socket Table
+ *============================================================================*/
+
+static int port_in_use(uint8_t type, uint16_t port)
+{
+    for (int i = 0; i < NET_MAX_SOCKETS; i++) {
+        const struct socket *s = &net.sockets[i];
+        if (s->type == type && s->local_port == port)
+            return 1;
+    }
+    return 0;
+}
+
+static uint16_t ephemeral_port(uint8_t type)
+{
+    for (int tries = 0; tries < 65536 - EPHEMERAL_FIRST; tries++) {
+        uint16_t port = net.next_port++;
+        if (net.next_port == 0)
+            net.next_port = EPHEMERAL_FIRST;
+        if (!port_in_use(type, port))
+            return port;
+    }
+    return 0;
+}
+
+static struct socket *socket_alloc(uint8_t type)
+{
+    for (int i = 0; i < NET_MAX_SOCKETS; i++) {
+        struct socket *s = &net.sockets[i];
+        if (s->type == SOCK_FREE) {
+            memset(s, 0, sizeof(*s));
+            s->type = type;
+            s->parent = -1;
+            return s;
+        }
+    }
+    return NULL;
+}
+
+static void socket_free(struct socket *s)
+{
+    queue_free(&s->snd_q);
+    queue_free(&s->rcv_q);
+    s->type = SOCK_FREE;
+}
+
+static int socket_index(const struct socket *s)
+{
+    return (int)(s - net.sockets);
+}
+
+/* The socket behind a user handle, or NULL */
+static struct socket *socket_get(int sock, uint8_t type)
+{
+    if (sock < 0 || sock >= NET_MAX_SOCKETS)
+        return NULL;
+    struct socket *s = &net.sockets[sock];
+    if (s->type != type || s->orphan || s->parent >= 0)
+        return NULL;
+    return s;
+}
+
+/*============================================================================
+ * UDP
+ *============================================================================*/
+
+static void udp_input(struct net_buf *buf, uint32_t src_ip,
+                      const uint8_t *payload, uint32_t len)
+{
+    if (len < UDP_HLEN)
+        return;
+    const struct udp_hdr *uh = (const struct udp_hdr *)payload;
+    uint32_t ulen = ntohs(uh->length);
+    if (ulen < UDP_HLEN || ulen > len)
+        return;
+    if (uh->checksum &&
+        transport_checksum(src_ip, virtio_net_ip_addr(), IP_PROTO_UDP,
+                           payload, ulen, NULL, 0) != 0) {
+        net.stats.bad_checksum++;
+        return;
+    }
+
+    uint16_t port = ntohs(uh->dst_port);
+    struct socket *s = NULL;
+    for (int i = 0; i < NET_MAX_SOCKETS; i++) {
+        if (net.sockets[i].type == SOCK_UDP &&
+            net.sockets[i].local_port == port) {
+            s = &net.sockets[i];
+            break;
+        }
+    }
+    if (!s || s->rcv_queued >= NET_UDP_RCV_QUEUE) {
+        net.stats.udp_dropped++;
+        return;
+    }
+
+    struct pbuf *p = pbuf_from_rx(buf, payload + UDP_HLEN, ulen - UDP_HLEN);
+    if (!p) {
+        net.stats.udp_dropped++;
+        return;
+    }
+    p->src_ip = src_ip;
+    p->src_port = ntohs(uh->src_port);
+    queue_push(&s->rcv_q, p);
+    s->rcv_queued++;
+    net.stats.udp_rx++;
+}
+
+/*============================================================================
+ * TCP Output
+ *============================================================================*/
+
+/* Fill in a TCP header (plus options) for a segment carrying data;
+ * returns the header length */
+static uint32_t tcp_build_header(uint8_t *hdr, uint32_t dst_ip,
+                                 uint16_t src_port, uint16_t dst_port,
+                                 uint32_t seq, uint32_t ack, uint8_t flags,
+                                 uint16_t window,
+                                 const uint8_t *opts, uint32_t optlen,
+                                 const uint8_t *data, uint32_t len)
+{
+    uint32_t hlen = TCP_HLEN + optlen;
+
+    struct tcp_hdr *th = (struct tcp_hdr *)hdr;
+    th->src_port = htons(src_port);
+    th->dst_port = htons(dst_port);
+    th->seq = htonl(seq);
+    th->ack = htonl(ack);
+    th->data_off = (uint8_t)((hlen / 4) << 4);
+    th->flags = flags;
+    th->window = htons(window);
+    th->checksum = 0;
+    th->urgent = 0;
+    if (optlen)
+        memcpy(hdr + TCP_HLEN, opts, optlen);
+    th->checksum = transport_checksum(virtio_net_ip_addr(), dst_ip,
+                                      IP_PROTO_TCP, hdr, hlen, data, len);
+    return hlen;
+}
+
+/* Receive window we can offer, in bytes */
+static uint32_t tcp_rcv_window(const struct socket *s)
+{
+    uint32_t space = NET_TCP_RCV_BUF - s->rcv_queued;
+    uint32_t pool = net.free_count > PBUF_RESERVE ?
+                    (net.free_count - PBUF_RESERVE) * NET_TCP_MSS : 0;
+    return space < pool ? space : pool;
+}
+
+/*
+ * Header for one segment of s. Every segment but the first SYN carries an
+ * ACK, which also settles any delayed ACK.
+ */
+static uint32_t tcp_header(struct socket *s, uint8_t *hdr, uint32_t seq,
+                           uint8_t flags, const uint8_t *data, uint32_t len)
+{
+    uint8_t opts[TCP_SYN_OPTLEN];
+    uint32_t optlen = 0;
+    uint32_t wnd = tcp_rcv_window(s);
+    uint16_t field;
+
+    if (flags & TCP_SYN) {
+        /* Window scaling applies from the segment after the SYN */
+        opts[0] = TCP_OPT_MSS;
+        opts[1] = 4;
+        opts[2] = (uint8_t)(NET_TCP_MSS >> 8);
+        opts[3] = (uint8_t)(NET_TCP_MSS & 0xFF);
+        optlen = 4;
+        if (s->rcv_wscale) {
+            opts[4] = TCP_OPT_NOP;
+            opts[5] = TCP_OPT_WSCALE;
+            opts[6] = 3;
+            opts[7] = s->rcv_wscale;
+            optlen = 8;
+        }
+        field = wnd > 0xFFFF ? 0xFFFF : (uint16_t)wnd;
+    } else {
+        wnd >>= s->rcv_wscale;
+        field = wnd > 0xFFFF ? 0xFFFF : (uint16_t)wnd;
+    }
+
+    if (s->state != TCP_SYN_SENT)
+        flags |= TCP_ACK;
+    if (flags & TCP_ACK) {
+        s->ack_pending = 0;
+        s->ack_deadline = 0;
+        s->rcv_adv = s->rcv_nxt + ((uint32_t)field <<
+                                   ((flags & TCP_SYN) ? 0 : s->rcv_wscale));
+    }
+
+    return tcp_build_header(hdr, s->remote_ip, s->local_port, s->remote_port,
+                            seq, (flags & TCP_ACK) ? s->rcv_nxt : 0, flags,
+                            field, opts, optlen, data, len);
+}
+
+/* Send one segment for s, copying any data */
+static void tcp_xmit(struct socket *s, uint32_t seq, uint8_t flags,
+                     const uint8_t *data, uint32_t len)
+{
+    uint8_t hdr[TCP_HLEN + TCP_SYN_OPTLEN];
+    struct vnet_tx_frame f;
+
+    f.hdr = hdr;
+    f.hdr_len = tcp_header(s, hdr, seq, flags, data, len);
+    f.payload = data;
+    f.payload_len = len;
+    f.ref = NULL;
+    net.stats.tcp_tx_segs++;
+    virtio_net_send_ipv4_batch(s->remote_ip, IP_PROTO_TCP, &f, 1);
+}
+
+/* Data segments collected by tcp_output() for one driver call */
+struct tcp_batch {
+    struct vnet_tx_frame frames[TCP_TX_BATCH];
+    uint8_t              hdrs[TCP_TX_BATCH][TCP_HLEN];
+    uint32_t             seqs[TCP_TX_BATCH];
+    int                  count;
+};
+
+/*
+ * Hand the batch to the driver. Returns 0 if it didn't take all of it
+ * (ring full, ARP pending): snd_nxt is rewound to the first segment left
+ * over, which goes out with the next send or the retransmit timer.
+ */
+static int tcp_flush(struct socket *s, struct tcp_batch *b)
+{
+    if (!b->count)
+        return 1;
+
+    int n = virtio_net_send_ipv4_batch(s->remote_ip, IP_PROTO_TCP,
+                                       b->frames, b->count);
+    if (n < 0)
+        n = 0;
+    net.stats.tcp_tx_segs += (uint32_t)n;
+
+    int all = n == b->count;
+    if (!all)
+        s->snd_nxt = b->seqs[n];
+    b->count = 0;
+    return all;
+}
+
+static void tcp_send_ack(struct socket *s)
+{
+    tcp_xmit(s, s->snd_nxt, TCP_ACK, NULL, 0);
+}
+
+static void tcp_arm_rto(struct socket *s)
+{
+    s->rto_deadline = timer_get_ms() + s->rto_ms;
+}
+
+/*
+ * Send what the peer's window and Nagle allow, then a FIN once a close is
+ * requested and everything queued has gone out. force sends the first
+ * unsent segment regardless of the window (timeout probe).
+ */
+static void tcp_output(struct socket *s, int force)
+{
+    if (s->state != TCP_ESTABLISHED && s->state != TCP_CLOSE_WAIT &&
+        s->state != TCP_FIN_WAIT_1 && s->state != TCP_CLOSING &&
+        s->state != TCP_LAST_ACK)
+        return;
+
+    struct tcp_batch batch;
+    batch.count = 0;
+
+    for (struct pbuf *p = s->snd_q.head; p; p = p->next) {
+        if (seq_lt(p->seq, s->snd_nxt))
+            continue;
+
+        uint32_t end = p->seq + p->len;
+        if (!force && end - s->snd_una > s->snd_wnd)
+            break;
+
+        /* Nagle: hold a short segment while earlier data is unacked */
+        if (!s->nodelay && !s->close_requested && p->len < s->mss &&
+            !p->next && s->snd_nxt != s->snd_una)
+            break;
+
+        /* The device reads the payload from the pbuf */
+        struct vnet_tx_frame *f = &batch.frames[batch.count];
+        f->hdr = batch.hdrs[batch.count];
+        f->hdr_len = tcp_header(s, batch.hdrs[batch.count], p->seq,
+                                (uint8_t)(p->next ? 0 : TCP_PSH),
+                                p->data, p->len);
+        f->payload = p->data;
+        f->payload_len = p->len;
+        f->ref = &p->tx_refs;
+        batch.seqs[batch.count++] = p->seq;
+
+        if (!s->rtt_start && !seq_lt(p->seq, s->snd_max)) {
+            s->rtt_start = timer_get_ms();
+            s->rtt_seq = end;
+        }
+        s->snd_nxt = end;
+        if (seq_gt(end, s->snd_max))
+            s->snd_max = end;
+        if (!s->rto_deadline)
+            tcp_arm_rto(s);
+        force = 0;
+
+        if (batch.count == TCP_TX_BATCH && !tcp_flush(s, &batch))
+            return;
+    }
+    if (!tcp_flush(s, &batch))
+        return;
+
+    if (s->close_requested && !s->fin_sent &&
+        s->snd_nxt == s->snd_una + s->snd_queued) {
+        s->fin_seq = s->snd_nxt;
+        tcp_xmit(s, s->fin_seq, TCP_FIN, NULL, 0);
+        s->fin_sent = 1;
+        s->snd_nxt = s->fin_seq + 1;
+        if (seq_gt(s->snd_nxt, s->snd_max))
+            s->snd_max = s->snd_nxt;
+        if (s->state == TCP_ESTABLISHED)
+            s->state = TCP_FIN_WAIT_1;
+        else if (s->state == TCP_CLOSE_WAIT)
+            s->state = TCP_LAST_ACK;
+        if (!s->rto_deadline)
+            tcp_arm_rto(s);
+    }
+}
+
+/* RST in answer to a segment that matches no connection */
+static void tcp_send_reset(uint32_t dst_ip, const struct tcp_hdr *th,
+                           uint32_t seg_len)
+{
+    uint32_t seq = 0, ack = 0;
+    uint8_t flags = TCP_RST;
+
+    if (th->flags & TCP_ACK) {
+        seq = ntohl(th->ack);
+    } else {
+        ack = ntohl(th->seq) + seg_len;
+        flags |= TCP_ACK;
+    }
+    uint8_t hdr[TCP_HLEN];
+    struct vnet_tx_frame f;
+    f.hdr = hdr;
+    f.hdr_len = tcp_build_header(hdr, dst_ip, ntohs(th->dst_port),
+                                 ntohs(th->src_port), seq, ack, flags, 0,
+                                 NULL, 0, NULL, 0);
+    f.payload = NULL;
+    f.payload_len = 0;
+    f.ref = NULL;
+    net.stats.tcp_resets_sent++;
+    net.stats.tcp_tx_segs++;
+    virtio_net_send_ipv4_batch(dst_ip, IP_PROTO_TCP, &f, 1);
+}
+
+/* Drop the connection; the user sees err (if still holding the socket) */
+static void tcp_abort(struct socket *s, int err)
+{
+    queue_free(&s->snd_q);
+    queue_free(&s->rcv_q);
+    s->snd_queued = 0;
+    s->rcv_queued = 0;
+    s->state = TCP_CLOSED;
+    s->error = err;
+    s->rto_deadline = 0;
+    s->ack_deadline = 0;
+    if (s->orphan || s->parent >= 0)
+        socket_free(s);
+}
+
+/*============================================================================
+ * TCP Input
+ *============================================================================*/
+
+/* MSS and window scale from a SYN's options */
+static void tcp_parse_syn_options(struct socket *s, const uint8_t *opt,
+                                  uint32_t len)
+{
+    int wscale = -1;
+    s->mss = TCP_DEFAULT_MSS;
+
+    for (uint32_t i = 0; i < len; ) {
+        uint8_t kind = opt[i];
+        if (kind == TCP_OPT_END)
+            break;
+        if (kind == TCP_OPT_NOP) {
+            i++;
+            continue;
+        }
+        if (i + 1 >= len || opt[i + 1] < 2 || i + opt[i + 1] > len)
+            break;
+        if (kind == TCP_OPT_MSS && opt[i + 1] == 4)
+            s->mss = (uint16_t)((opt[i + 2] << 8) | opt[i + 3]);
+        else if (kind == TCP_OPT_WSCALE && opt[i + 1] == 3)
+            wscale = opt[i + 2] > 14 ? 14 : opt[i + 2];
+        i += opt[i + 1];
+    }
+
+    if (s->mss > NET_TCP_MSS)
+        s->mss = NET_TCP_MSS;
+    if (s->mss < 64)
+        s->mss = 64;
+
+    /* Scaling is on only if both sides offered it */
+    if (wscale >= 0 && s->rcv_wscale) {
+        s->snd_wscale = (uint8_t)wscale;
+    } else {
+        s->snd_wscale = 0;
+        s->rcv_wscale = 0;
+    }
+}
+
+static void tcp_rtt_sample(struct socket *s, uint32_t rtt)
+{
+    if (!s->srtt_ms) {
+        s->srtt_ms = rtt ? rtt : 1;
+        s->rttvar_ms = rtt / 2;
+    } else {
+        uint32_t diff = rtt > s->srtt_ms ? rtt - s->srtt_ms : s->srtt_ms - rtt;
+        s->rttvar_ms = (3 * s->rttvar_ms + diff) / 4;
+        s->srtt_ms = (7 * s->srtt_ms + rtt) / 8;
+        if (!s->srtt_ms)
+            s->srtt_ms = 1;
+    }
+    uint32_t rto = s->srtt_ms + (4 * s->rttvar_ms > 1 ? 4 * s->rttvar_ms : 1);
+    if (rto < TCP_RTO_MIN_MS)
+        rto = TCP_RTO_MIN_MS;
+    if (rto > TCP_RTO_MAX_MS)
+        rto = TCP_RTO_MAX_MS;
+    s->rto_ms = rto;
+}
+
+/* Process an acknowledgment and window update from the peer */
+static void tcp_ack(struct socket *s, uint32_t ack, uint32_t wnd)
+{
+    if (seq_gt(ack, s->snd_max)) {
+        tcp_send_ack(s);
+        return;
+    }
+
+    s->snd_wnd = wnd << s->snd_wscale;
+
+    if (!seq_gt(ack, s->snd_una))
+        return;
+
+    /* The FIN takes a sequence number but no queued byte */
+    uint32_t data_end = s->fin_sent && seq_gt(ack, s->fin_seq) ?
+                        s->fin_seq : ack;
+    uint32_t acked = data_end - s->snd_una;
+    while (acked && s->snd_q.head) {
+        struct pbuf *p = s->snd_q.head;
+        if (p->len <= acked) {
+            acked -= p->len;
+            s->snd_queued -= p->len;
+            pbuf_free(queue_pop(&s->snd_q));
+        } else {
+            p->data += acked;
+            p->seq += acked;
+            p->len -= acked;
+            s->snd_queued -= acked;
+            acked = 0;
+        }
+    }
+
+    s->snd_una = ack;
+    if (seq_lt(s->snd_nxt, s->snd_una))
+        s->snd_nxt = s->snd_una;
+
+    if (s->rtt_start && seq_ge(ack, s->rtt_seq)) {
+        tcp_rtt_sample(s, (uint32_t)(timer_get_ms() - s->rtt_start));
+        s->rtt_start = 0;
+    }
+
+    s->retries = 0;
+    s->rto_deadline = 0;
+    if (s->snd_una != s->snd_max)
+        tcp_arm_rto(s);
+}
+
+static int fin_acked(const struct socket *s)
+{
+    return s->fin_sent && seq_gt(s->snd_una, s->fin_seq);
+}
+
+/* Queue in-order payload; returns 0 if it had to be dropped */
+static int tcp_receive_data(struct socket *s, struct net_buf *buf,
+                            uint32_t seq, const uint8_t *data, uint32_t len)
+{
+    /* Trim what we already have (retransmission overlapping rcv_nxt) */
+    if (seq_lt(seq, s->rcv_nxt)) {
+        uint32_t dup = s->rcv_nxt - seq;
+        if (dup >= len)
+            return 1;
+        data += dup;
+        len -= dup;
+    }
+
+    if (s->close_requested) {
+        /* Nobody will read it; accept and discard */
+        s->rcv_nxt += len;
+        return 1;
+    }
+    if (s->rcv_queued + len > NET_TCP_RCV_BUF)
+        return 0;
+
+    struct pbuf *p = pbuf_from_rx(buf, data, len);
+    if (!p)
+        return 0;
+    queue_push(&s->rcv_q, p);
+    s->rcv_queued += len;
+    s->rcv_nxt += len;
+    return 1;
+}
+
+static struct socket *tcp_find(uint32_t src_ip, uint16_t src_port,
+                               uint16_t dst_port)
+{
+    struct socket *listener = NULL;
+
+    for (int i = 0; i < NET_MAX_SOCKETS; i++) {
+        struct socket *s = &net.sockets[i];
+        if (s->type != SOCK_TCP || s->local_port != dst_port)
+            continue;
+        if (s->state == TCP_LISTEN)
+            listener = s;
+        else if (s->state != TCP_CLOSED && s->remote_ip == src_ip &&
+                 s->remote_port == src_port)
+            return s;
+    }
+    return listener;
+}
+
+static uint32_t tcp_new_iss(void)
+{
+    uint64_t t = rdtsc();
+    return (uint32_t)(t ^ (t >> 29));
+}
+
+/* SYN on a listening socket: start a child connection */
+static void tcp_listen_input(struct socket *l, uint32_t src_ip,
+                             const struct tcp_hdr *th, const uint8_t *opts,
+                             uint32_t optlen, uint32_t seg_len)
+{
+    if (th->flags & TCP_RST)
+        return;
+    if (th->flags & TCP_ACK) {
+        tcp_send_reset(src_ip, th, seg_len);
+        return;
+    }
+    if (!(th->flags & TCP_SYN))
+        return;
+
+    int pending = 0;
+    for (int i = 0; i < NET_MAX_SOCKETS; i++) {
+        if (net.sockets[i].type == SOCK_TCP &&
+            net.sockets[i].parent == socket_index(l))
+            pending++;
+    }
+    if (pending >= TCP_BACKLOG)
+        return;     /* Peer retries the SYN */
+
+    struct socket *s = socket_alloc(SOCK_TCP);
+    if (!s)
+        return;
+
+    s->parent = (int8_t)socket_index(l);
+    s->state = TCP_SYN_RCVD;
+    s->nodelay = l->nodelay;
+    s->local_port = l->local_port;
+    s->remote_ip = src_ip;
+    s->remote_port = ntohs(th->src_port);
+    s->rcv_wscale = TCP_WSCALE;
+    tcp_parse_syn_options(s, opts, optlen);
+    s->rcv_nxt = ntohl(th->seq) + 1;
+    s->snd_wnd = ntohs(th->window);
+    s->iss = tcp_new_iss();
+    s->snd_una = s->iss;
+    s->snd_nxt = s->snd_max = s->iss + 1;
+    s->rto_ms = TCP_RTO_INITIAL_MS;
+
+    tcp_xmit(s, s->iss, TCP_SYN, NULL, 0);
+    tcp_arm_rto(s);
+}
+
+static void tcp_syn_sent_input(struct socket *s, const struct tcp_hdr *th,
+                               const uint8_t *opts, uint32_t optlen,
+                               uint32_t seg_len)
+{
+    uint32_t ack = ntohl(th->ack);
+    int ack_ok = (th->flags & TCP_ACK) && ack == s->iss + 1;
+
+    if ((th->flags & TCP_ACK) && !ack_ok) {
+        if (!(th->flags & TCP_RST))
+            tcp_send_reset(s->remote_ip, th, seg_len);
+        return;
+    }
+    if (th->flags & TCP_RST) {
+        if (ack_ok)
+            tcp_abort(s, NET_ERR_RESET);
+        return;
+    }
+    if (!(th->flags & TCP_SYN) || !ack_ok)
+        return;     /* Simultaneous open isn't supported */
+
+    tcp_parse_syn_options(s, opts, optlen);
+    s->rcv_nxt = ntohl(th->seq) + 1;
+    s->snd_una = ack;
+    s->snd_nxt = s->snd_max = ack;
+    s->snd_wnd = ntohs(th->window);     /* Never scaled on a SYN */
+    if (s->rtt_start) {
+        tcp_rtt_sample(s, (uint32_t)(timer_get_ms() - s->rtt_start));
+        s->rtt_start = 0;
+    }
+    s->retries = 0;
+    s->rto_deadline = 0;
+    s->state = TCP_ESTABLISHED;
+    tcp_send_ack(s);
+    tcp_output(s, 0);
+}
+
+static void tcp_input(struct net_buf *buf, uint32_t src_ip,
+                      const uint8_t *payload, uint32_t len)
+{
+    if (len < TCP_HLEN)
+        return;
+    if (transport_checksum(src_ip, virtio_net_ip_addr(), IP_PROTO_TCP,
+                           payload, len, NULL, 0) != 0) {
+        net.stats.bad_checksum++;
+        return;
+    }
+
+    const struct tcp_hdr *th = (const struct tcp_hdr *)payload;
+    uint32_t hlen = (uint32_t)(th->data_off >> 4) * 4;
+    if (hlen < TCP_HLEN || hlen > len)
+        return;
+
+    const uint8_t *opts = payload + TCP_HLEN;
+    uint32_t optlen = hlen - TCP_HLEN;
+    const uint8_t *data = payload + hlen;
+    uint32_t data_len = len - hlen;
+    uint32_t seq = ntohl(th->seq);
+    uint8_t flags = th->flags;
+    uint32_t seg_len = data_len + ((flags & TCP_SYN) ? 1 : 0) +
+                       ((flags & TCP_FIN) ? 1 : 0);
+
+    net.stats.tcp_rx_segs++;
+
+    struct socket *s = tcp_find(src_ip, ntohs(th->src_port),
+                                ntohs(th->dst_port));
+    if (!s) {
+        if (!(flags & TCP_RST))
+            tcp_send_reset(src_ip, th, seg_len);
+        return;
+    }
+
+    if (s->state == TCP_LISTEN) {
+        tcp_listen_input(s, src_ip, th, opts, optlen, seg_len);
+        return;
+    }
+    if (s->state == TCP_SYN_SENT) {
+        tcp_syn_sent_input(s, th, opts, optlen, seg_len);
+        return;
+    }
+
+    if (flags & TCP_RST) {
+        /* Only trust a reset inside the window we advertised */
+        if (seq_ge(seq, s->rcv_nxt) && seq_le(seq, s->rcv_adv))
+            tcp_abort(s, NET_ERR_RESET);
+        return;
+    }
+
+    if (flags & TCP_SYN) {
+        /* Our SYN-ACK was lost and the peer resent its SYN */
+        if (s->state == TCP_SYN_RCVD && seq + 1 == s->rcv_nxt)
+            tcp_xmit(s, s->iss, TCP_SYN, NULL, 0);
+        else
+            tcp_send_ack(s);
+        return;
+    }
+
+    if (!(flags & TCP_ACK))
+        return;
+
+    uint32_t ack = ntohl(th->ack);
+    if (s->state == TCP_SYN_RCVD) {
+        if (ack != s->iss + 1) {
+            tcp_send_reset(src_ip, th, seg_len);
+            return;
+        }
+        s->state = TCP_ESTABLISHED;
+    }
+
+    tcp_ack(s, ack, ntohs(th->window));
+
+    /* Our FIN acknowledged */
+    if (fin_acked(s)) {
+        if (s->state == TCP_FIN_WAIT_1) {
+            s->state = TCP_FIN_WAIT_2;
+            s->time_wait_end = timer_get_ms() + TCP_FIN_WAIT_2_MS;
+        } else if (s->state == TCP_CLOSING) {
+            s->state = TCP_TIME_WAIT;
+            s->time_wait_end = timer_get_ms() + TCP_TIME_WAIT_MS;
+        } else if (s->state == TCP_LAST_ACK) {
+            s->state = TCP_CLOSED;
+            s->rto_deadline = 0;
+            if (s->orphan)
+                socket_free(s);
+            return;
+        }
+    }
+
+    int in_order = seq_le(seq, s->rcv_nxt);
+    int can_receive = s->state == TCP_ESTABLISHED ||
+                      s->state == TCP_FIN_WAIT_1 ||
+                      s->state == TCP_FIN_WAIT_2;
+
+    if (data_len) {
+        if (!in_order || !can_receive) {
+            /* No reassembly: the duplicate ACK asks for a resend */
+            if (!in_order)
+                net.stats.tcp_out_of_order++;
+            tcp_send_ack(s);
+            return;
+        }
+        if (!tcp_receive_data(s, buf, seq, data, data_len)) {
+            tcp_send_ack(s);    /* Out of buffers; peer retransmits */
+            return;
+        }
+        if (data_len >= s->mss)
+            s->ack_pending++;
+        else if (!s->ack_pending)
+            s->ack_pending = 1;
+        if (!s->ack_deadline)
+            s->ack_deadline = timer_get_ms() + TCP_DELACK_MS;
+    }
+
+    if ((flags & TCP_FIN) && seq + data_len == s->rcv_nxt && !s->peer_fin) {
+        s->rcv_nxt++;
+        s->peer_fin = 1;
+        if (s->state == TCP_ESTABLISHED) {
+            s->state = TCP_CLOSE_WAIT;
+        } else if (s->state == TCP_FIN_WAIT_1) {
+            s->state = fin_acked(s) ? TCP_TIME_WAIT : TCP_CLOSING;
+        } else if (s->state == TCP_FIN_WAIT_2) {
+            s->state = TCP_TIME_WAIT;
+        }
+        if (s->state == TCP_TIME_WAIT)
+            s->time_wait_end = timer_get_ms() + TCP_TIME_WAIT_MS;
+        tcp_send_ack(s);
+    } else if ((flags & TCP_FIN) && s->state == TCP_TIME_WAIT) {
+        tcp_send_ack(s);    /* Our last ACK was lost */
+    }
+
+    /* Freed window or ACKs may let queued data go; it carries the ACK */
+    tcp_output(s, 0);
+
+    if (s->ack_pending >= 2)
+        tcp_send_ack(s);
+    else if (s->ack_pending)
+        net.stats.tcp_acks_delayed++;
+}
+
+/*============================================================================
+ * TCP Timers
+ *============================================================================*/
+
+static void tcp_timeout(struct socket *s)
+{
+    if (++s->retries > TCP_MAX_RETRIES) {
+        tcp_abort(s, NET_ERR_RESET);
+        return;
+    }
+
+    net.stats.tcp_retransmits++;
+    s->rtt_start = 0;   /* Karn: don't time retransmitted segments */
+    s->rto_ms = s->rto_ms * 2 > TCP_RTO_MAX_MS ? TCP_RTO_MAX_MS : s->rto_ms * 2;
+    s->rto_deadline = 0;
+
+    if (s->state == TCP_SYN_SENT || s->state == TCP_SYN_RCVD) {
+        tcp_xmit(s, s->iss, TCP_SYN, NULL, 0);
+        tcp_arm_rto(s);
+        return;
+    }
+
+    /* Go back to the first unacked byte; a lost FIN is resent too */
+    s->snd_nxt = s->snd_una;
+    if (s->fin_sent && !fin_acked(s))
+        s->fin_sent = 0;
+    tcp_output(s, 1);
+    if (!s->rto_deadline)
+        tcp_arm_rto(s);
+}
+
+/*============================================================================
+ * API
+ *============================================================================*/
+
+void netstack_init(void)
+{
+    if (net.ready || !virtio_net_available())
+        return;
+
+    size_t pages = (NET_PBUF_COUNT * NET_PBUF_SIZE + 4095) / 4096;
+    net.storage = (uint8_t *)pmm_alloc_pages(pages);
+    if (!net.storage) {
+        kprintf("[NET] No memory for the pbuf pool\n");
+        return;
+    }
+
+    net.free_list = NULL;
+    for (int i = NET_PBUF_COUNT - 1; i >= 0; i--) {
+        net.pbufs[i].storage = net.storage + (size_t)i * NET_PBUF_SIZE;
+        net.pbufs[i].next = net.free_list;
+        net.free_list = &net.pbufs[i];
+    }
+    net.free_count = NET_PBUF_COUNT;
+    net.next_port = (uint16_t)(EPHEMERAL_FIRST + (rdtsc() & 0x3FFF));
+    net.ready = 1;
+
+    kprintf("[NET] UDP/TCP ready: %u pbufs (%lu KB), %u sockets\n",
+            NET_PBUF_COUNT, (unsigned long)(pages * 4), NET_MAX_SOCKETS);
+}
+
+void netstack_input(struct net_buf *buf, uint32_t src_ip, uint8_t protocol,
+                    const uint8_t *payload, uint32_t len)
+{
+    if (!net.ready)
+        return;
+
+    net_lock();
+    if (protocol == IP_PROTO_TCP)
+        tcp_input(buf, src_ip, payload, len);
+    else if (protocol == IP_PROTO_UDP)
+        udp_input(buf, src_ip, payload, len);
+    net_unlock();
+}
+
+void net_poll(void)
+{
+    if (!net.ready)
+        return;
+
+    uint64_t now = timer_get_ms();
+    net_lock();
+    if (net.deferred)
+        pbuf_reap();
+    for (int i = 0; i < NET_MAX_SOCKETS; i++) {
+        struct socket *s = &net.sockets[i];
+        if (s->type != SOCK_TCP)
+            continue;
+
+        if (s->state == TCP_TIME_WAIT ||
+            (s->state == TCP_FIN_WAIT_2 && s->orphan)) {
+            if (now >= s->time_wait_end) {
+                s->state = TCP_CLOSED;
+                if (s->orphan)
+                    socket_free(s);
+            }
+            continue;
+        }
+        if (s->ack_deadline && now >= s->ack_deadline)
+            tcp_send_ack(s);
+        if (s->rto_deadline && now >= s->rto_deadline)
+            tcp_timeout(s);
+    }
+    net_unlock();
+}
+
+int net_udp_open(uint16_t port)
+{
+    if (!net.ready)
+        return NET_ERR_DOWN;
+
+    net_lock();
+    int ret;
+    if (port && port_in_use(SOCK_UDP, port)) {
+        ret = NET_ERR_INUSE;
+    } else {
+        if (!port)
+            port = ephemeral_port(SOCK_UDP);
+        struct socket *s = port ? socket_alloc(SOCK_UDP) : NULL;
+        if (s) {
+            s->local_port = port;
+            ret = socket_index(s);
+        } else {
+            ret = NET_ERR_NOSOCK;
+        }
+    }
+    net_unlock();
+    return ret;
+}
+
+int net_udp_sendto(int sock, uint32_t ip, uint16_t port,
+                   const void *data, uint32_t len)
+{
+    uint8_t dgram[VNET_IP_MAX_PAYLOAD];
+
+    if (len > VNET_IP_MAX_PAYLOAD - UDP_HLEN)
+        return NET_ERR_INVALID;
+
+    net_lock();
+    struct socket *s = socket_get(sock, SOCK_UDP);
+    if (!s) {
+        net_unlock();
+        return NET_ERR_BADSOCK;
+    }
+
+    struct udp_hdr *uh = (struct udp_hdr *)dgram;
+    uh->src_port = htons(s->local_port);
+    uh->dst_port = htons(port);
+    uh->length = htons((uint16_t)(UDP_HLEN + len));
+    uh->checksum = 0;
+    memcpy(dgram + UDP_HLEN, data, len);
+    uint16_t sum = transport_checksum(virtio_net_ip_addr(), ip, IP_PROTO_UDP,
+                                      dgram, UDP_HLEN + len, NULL, 0);
+    uh->checksum = sum ? sum : 0xFFFF;
+
+    int ret = virtio_net_send_ipv4(ip, IP_PROTO_UDP, dgram, UDP_HLEN + len);
+    if (ret == VNET_OK) {
+        net.stats.udp_tx++;
+        ret = (int)len;
+    } else {
+        ret = ret == VNET_ERR_INVALID ? NET_ERR_INVALID : NET_ERR_WOULDBLOCK;
+    }
+    net_unlock();
+    return ret;
+}
+
+int net_udp_recvfrom(int sock, void *buf, uint32_t size,
+                     uint32_t *ip, uint16_t *port)
+{
+    net_lock();
+    struct socket *s = socket_get(sock, SOCK_UDP);
+    if (!s) {
+        net_unlock();
+        return NET_ERR_BADSOCK;
+    }
+
+    struct pbuf *p = queue_pop(&s->rcv_q);
+    if (!p) {
+        net_unlock();
+        return NET_ERR_WOULDBLOCK;
+    }
+    s->rcv_queued--;
+
+    uint32_t n = p->len < size ? p->len : size;
+    memcpy(buf, p->data, n);
+    if (ip)
+        *ip = p->src_ip;
+    if (port)
+        *port = p->src_port;
+    pbuf_free(p);
+    net_unlock();
+    return (int)n;
+}
+
+int net_tcp_connect(uint32_t ip, uint16_t port)
+{
+    if (!net.ready)
+        return NET_ERR_DOWN;
+
+    net_lock();
+    uint16_t local = ephemeral_port(SOCK_TCP);
+    struct socket *s = local ? socket_alloc(SOCK_TCP) : NULL;
+    if (!s) {
+        net_unlock();
+        return NET_ERR_NOSOCK;
+    }
+
+    s->state = TCP_SYN_SENT;
+    s->local_port = local;
+    s->remote_ip = ip;
+    s->remote_port = port;
+    s->rcv_wscale = TCP_WSCALE;
+    s->mss = TCP_DEFAULT_MSS;
+    s->iss = tcp_new_iss();
+    s->snd_una = s->iss;
+    s->snd_nxt = s->snd_max = s->iss + 1;
+    s->rto_ms = TCP_RTO_INITIAL_MS;
+    s->rtt_start = timer_get_ms();
+    s->rtt_seq = s->iss + 1;
+
+    /* If ARP is still resolving, the retransmit timer resends the SYN */
+    tcp_xmit(s, s->iss, TCP_SYN, NULL, 0);
+    tcp_arm_rto(s);
+
+    int ret = socket_index(s);
+    net_unlock();
+    return ret;
+}
+
+int net_tcp_listen(uint16_t port)
+{
+    if (!net.ready)
+        return NET_ERR_DOWN;
+    if (!port)
+        return NET_ERR_INVALID;
+
+    net_lock();
+    int ret;
+    if (port_in_use(SOCK_TCP, port)) {
+        ret = NET_ERR_INUSE;
+    } else {
+        struct socket *s = socket_alloc(SOCK_TCP);
+        if (s) {
+            s->state = TCP_LISTEN;
+            s->local_port = port;
+            ret = socket_index(s);
+        } else {
+            ret = NET_ERR_NOSOCK;
+        }
+    }
+    net_unlock();
+    return ret;
+}
+
+int net_tcp_accept(int listener)
+{
+    net_lock();
+    struct socket *l = socket_get(listener, SOCK_TCP);
+    int ret = NET_ERR_BADSOCK;
+    if (l && l->state == TCP_LISTEN) {
+        ret = NET_ERR_WOULDBLOCK;
+        for (int i = 0; i < NET_MAX_SOCKETS; i++) {
+            struct socket *s = &net.sockets[i];
+            if (s->type == SOCK_TCP && s->parent == listener &&
+                s->state != TCP_SYN_RCVD) {
+                s->parent = -1;
+                ret = i;
+                break;
+            }
+        }
+    }
+    net_unlock();
+    return ret;
+}
+
+int net_tcp_status(int sock)
+{
+    net_lock();
+    struct socket *s = socket_get(sock, SOCK_TCP);
+    int ret;
+    if (!s)
+        ret = NET_ERR_BADSOCK;
+    else if (s->error)
+        ret = s->error;
+    else if (s->state == TCP_SYN_SENT || s->state == TCP_SYN_RCVD)
+        ret = NET_TCP_CONNECTING;
+    else if (s->state == TCP_ESTABLISHED || s->state == TCP_FIN_WAIT_1 ||
+             s->state == TCP_FIN_WAIT_2)
+        ret = NET_TCP_CONNECTED;
+    else if (s->peer_fin)
+        ret = NET_TCP_CLOSING;
+    else
+        ret = NET_ERR_NOTCONN;
+    net_unlock();
+    return ret;
+}
+
+int net_tcp_send(int sock, const void *data, uint32_t len)
+{
+    const uint8_t *src = (const uint8_t *)data;
+
+    net_lock();
+    struct socket *s = socket_get(sock, SOCK_TCP);
+    if (!s) {
+        net_unlock();
+        return NET_ERR_BADSOCK;
+    }
+    if (s->error || (s->state != TCP_ESTABLISHED &&
+                     s->state != TCP_CLOSE_WAIT)) {
+        int err = s->error ? s->error :
+                  s->state == TCP_SYN_SENT ? NET_ERR_WOULDBLOCK :
+                  NET_ERR_NOTCONN;
+        net_unlock();
+        return err;
+    }
+
+    /* Top up the last unsent segment before starting a new one */
+    uint32_t copied = 0;
+    while (copied < len && s->snd_queued < NET_TCP_SND_BUF) {
+        struct pbuf *t = s->snd_q.tail;
+        /* A partial ACK moves data forward, so storage can run out
+         * before the segment reaches a full MSS */
+        uint32_t room = t ? NET_PBUF_SIZE -
+                            (uint32_t)(t->data + t->len - t->storage) : 0;
+        if (!t || seq_lt(t->seq, s->snd_nxt) || t->len >= s->mss || !room) {
+            t = pbuf_alloc();
+            if (!t)
+                break;
+            t->seq = s->snd_una + s->snd_queued;
+            queue_push(&s->snd_q, t);
+            room = NET_PBUF_SIZE;
+        }
+        uint32_t n = len - copied;
+        if (n > s->mss - t->len)
+            n = s->mss - t->len;
+        if (n > room)
+            n = room;
+        if (n > NET_TCP_SND_BUF - s->snd_queued)
+            n = NET_TCP_SND_BUF - s->snd_queued;
+        memcpy(t->data + t->len, src + copied, n);
+        t->len += n;
+        s->snd_queued += n;
+        copied += n;
+    }
+
+    tcp_output(s, 0);
+    net_unlock();
+    return copied ? (int)copied : NET_ERR_WOULDBLOCK;
+}
+
+int net_tcp_recv(int sock, void *buf, uint32_t size)
+{
+    uint8_t *dst = (uint8_t *)buf;
+
+    net_lock();
+    struct socket *s = socket_get(sock, SOCK_TCP);
+    if (!s) {
+        net_unlock();
+        return NET_ERR_BADSOCK;
+    }
+
+    uint32_t copied = 0;
+    while (copied < size && s->rcv_q.head) {
+        struct pbuf *p = s->rcv_q.head;
+        uint32_t n = p->len < size - copied ? p->len : size - copied;
+        memcpy(dst + copied, p->data, n);
+        copied += n;
+        p->data += n;
+        p->len -= n;
+        s->rcv_queued -= n;
+        if (!p->len)
+            pbuf_free(queue_pop(&s->rcv_q));
+    }
+
+    int ret;
+    if (copied) {
+        /* Tell the peer once the window has opened by two segments */
+        uint32_t edge = s->rcv_nxt + tcp_rcv_window(s);
+        if (s->state != TCP_SYN_RCVD && seq_ge(edge, s->rcv_adv + 2 * s->mss))
+            tcp_send_ack(s);
+        ret = (int)copied;
+    } else if (s->error) {
+        ret = s->error;
+    } else if (s->peer_fin) {
+        ret = 0;
+    } else if (s->state == TCP_SYN_SENT || s->state == TCP_SYN_RCVD ||
+               s->state == TCP_ESTABLISHED || s->state == TCP_FIN_WAIT_1 ||
+               s->state == TCP_FIN_WAIT_2) {
+        ret = NET_ERR_WOULDBLOCK;
+    } else {
+        ret = NET_ERR_NOTCONN;
+    }
+    net_unlock();
+    return ret;
+}
+
+uint32_t net_tcp_unacked(int sock)
+{
+    net_lock();
+    struct socket *s = socket_get(sock, SOCK_TCP);
+    uint32_t n = 0;
+    if (s && !s->error)
+        n = s->snd_queued + (s->fin_sent && !fin_acked(s) ? 1 : 0);
+    net_unlock();
+    return n;
+}
+
+int net_setopt(int sock, int opt, int value)
+{
+    net_lock();
+    struct socket *s = socket_get(sock, SOCK_TCP);
+    int ret = NET_OK;
+    if (!s) {
+        ret = NET_ERR_BADSOCK;
+    } else if (opt == NET_OPT_NODELAY) {
+        s->nodelay = value ? 1 : 0;
+        if (s->nodelay)
+            tcp_output(s, 0);
+    } else {
+        ret = NET_ERR_INVALID;
+    }
+    net_unlock();
+    return ret;
+}
+
+void net_close(int sock)
+{
+    if (sock < 0 || sock >= NET_MAX_SOCKETS)
+        return;
+
+    net_lock();
+    struct socket *s = &net.sockets[sock];
+    if (s->type == SOCK_FREE || s->orphan || s->parent >= 0) {
+        net_unlock();
+        return;
+    }
+
+    if (s->type == SOCK_UDP) {
+        socket_free(s);
+        net_unlock();
+        return;
+    }
+
+    switch (s->state) {
+    case TCP_LISTEN:
+        /* Reset connections nobody accepted */
+        for (int i = 0; i < NET_MAX_SOCKETS; i++) {
+            struct socket *c = &net.sockets[i];
+            if (c->type == SOCK_TCP && c->parent == sock) {
+                tcp_xmit(c, c->snd_nxt, TCP_RST, NULL, 0);
+                socket_free(c);
+            }
+        }
+        socket_free(s);
+        break;
+    case TCP_CLOSED:
+    case TCP_SYN_SENT:
+    case TCP_TIME_WAIT:
+        socket_free(s);
+        break;
+    default:
+        /* Finish in the background: FIN after the queued data */
+        s->orphan = 1;
+        s->close_requested = 1;
+        queue_free(&s->rcv_q);
+        s->rcv_queued = 0;
+        tcp_output(s, 0);
+        break;
+    }
+    net_unlock();
+}
+
+const struct netstack_stats *net_get_stats(void)
+{
+    return &net.stats;
+}
+
+void net_dump_stats(void)
+{
+    if (!net.ready) {
+        kprintf("  Sockets:  (stack not initialized)\n");
+        return;
+    }
+
+    net_lock();
+    kprintf("  pbufs:    %u of %u free, %u waiting on transmit\n",
+            net.free_count, NET_PBUF_COUNT, net.deferred_count);
+    for (int i = 0; i < NET_MAX_SOCKETS; i++) {
+        const struct socket *s = &net.sockets[i];
+        if (s->type == SOCK_UDP) {
+            kprintf("  [%d] UDP  :%u  %u queued\n", i, s->local_port,
+                    s->rcv_queued);
+        } else if (s->type == SOCK_TCP) {
+            kprintf("  [%d] TCP  :%u -> %u.%u.%u.%u:%u  %s", i, s->local_port,
+                    (s->remote_ip >> 24) & 0xFF, (s->remote_ip >> 16) & 0xFF,
+                    (s->remote_ip >> 8) & 0xFF, s->remote_ip & 0xFF,
+                    s->remote_port, tcp_state_names[s->state]);
+            if (s->state != TCP_LISTEN)
+                kprintf("  snd %u rcv %u wnd %u rto %ums srtt %ums",
+                        s->snd_queued, s->rcv_queued, s->snd_wnd,
+                        s->rto_ms, s->srtt_ms);
+            kprintf("%s\n", s->orphan ? " (closing)" : "");
+        }
+    }
+
+    const struct netstack_stats *st = &net.stats;
+    kprintf("  UDP:      %lu in, %lu out, %lu dropped\n",
+            (unsigned long)st->udp_rx, (unsigned long)st->udp_tx,
+            (unsigned long)st->udp_dropped);
+    kprintf("  TCP:      %lu in, %lu out, %lu retransmits, %lu out of order\n",
+            (unsigned long)st->tcp_rx_segs, (unsigned long)st->tcp_tx_segs,
+            (unsigned long)st->tcp_retransmits,
+            (unsigned long)st->tcp_out_of_order);
+    kprintf("            %lu delayed ACKs, %lu resets sent, %lu bad checksums\n",
+            (unsigned long)st->tcp_acks_delayed,
+            (unsigned long)st->tcp_resets_sent,
+            (unsigned long)st->bad_checksum);
+    kprintf("  Receive:  %lu zero-copy, %lu copied, pool empty %lu times\n",
+            (unsigned long)st->rx_zero_copy, (unsigned long)st->rx_copied,
+            (unsigned long)st->pbuf_exhausted);
+    net_unlock();
+}
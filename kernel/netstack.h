@@ -0,0 +1,121 @@
+/*
+ * PhantomOS Kernel Network Stack
+ * "To Create, Not To Destroy"
+ *
+ * UDP and TCP over virtio_net's IPv4 layer, with a small non-blocking
+ * socket API. Nothing here sleeps: calls that can't make progress return
+ * NET_ERR_WOULDBLOCK, and callers (the desktop loop, shell commands) poll.
+ * Timers (retransmission, delayed ACKs, TIME_WAIT) run from net_poll().
+ *
+ * Packet data lives in a fixed pool of pbufs allocated once at init.
+ * Received segments reference the device's receive buffer directly when
+ * the driver lets us hold it, and are copied into pool storage otherwise.
+ */
+
+#ifndef PHANTOMOS_NETSTACK_H
+#define PHANTOMOS_NETSTACK_H
+
+#include <stdint.h>
+
+struct net_buf;
+
+/*============================================================================
+ * Limits
+ *============================================================================*/
+
+#define NET_MAX_SOCKETS     16
+#define NET_PBUF_COUNT      256         /* Packet buffers in the pool */
+#define NET_PBUF_SIZE       1536        /* Storage per pbuf (one MSS + slack) */
+#define NET_TCP_MSS         1460
+#define NET_TCP_RCV_BUF     (128 * 1024)    /* Per-connection receive queue */
+#define NET_TCP_SND_BUF     (64 * 1024)     /* Per-connection send queue */
+#define NET_UDP_RCV_QUEUE   32          /* Datagrams queued per UDP socket */
+
+/*============================================================================
+ * Errors (negative return values)
+ *============================================================================*/
+
+#define NET_OK              0
+#define NET_ERR_WOULDBLOCK  -1          /* Try again after net_poll() */
+#define NET_ERR_BADSOCK     -2          /* Not an open socket of this type */
+#define NET_ERR_NOSOCK      -3          /* Socket table full */
+#define NET_ERR_INUSE       -4          /* Port already bound */
+#define NET_ERR_NOTCONN     -5
+#define NET_ERR_RESET       -6          /* Peer reset or retransmits gave up */
+#define NET_ERR_NOMEM       -7          /* pbuf pool exhausted */
+#define NET_ERR_INVALID     -8
+#define NET_ERR_DOWN        -9          /* No network device */
+
+/* net_setopt() options */
+#define NET_OPT_NODELAY     1           /* TCP: disable Nagle */
+
+/* net_tcp_status() results (or a negative error) */
+#define NET_TCP_CONNECTING  0
+#define NET_TCP_CONNECTED   1
+#define NET_TCP_CLOSING     2           /* Peer sent FIN; reads drain then 0 */
+
+/*============================================================================
+ * Statistics
+ *============================================================================*/
+
+struct netstack_stats {
+    uint64_t udp_rx;
+    uint64_t udp_tx;
+    uint64_t udp_dropped;           /* No socket or queue full */
+    uint64_t tcp_rx_segs;
+    uint64_t tcp_tx_segs;
+    uint64_t tcp_retransmits;
+    uint64_t tcp_out_of_order;      /* Dropped (no reassembly) */
+    uint64_t tcp_acks_delayed;      /* ACKs that rode a timer or data */
+    uint64_t tcp_resets_sent;
+    uint64_t bad_checksum;
+    uint64_t rx_zero_copy;          /* Payloads kept in the receive ring */
+    uint64_t rx_copied;
+    uint64_t pbuf_exhausted;
+};
+
+/*============================================================================
+ * API
+ *============================================================================*/
+
+/* Allocate the pbuf pool (no-op without a network device) */
+void netstack_init(void);
+
+/* UDP/TCP datagram from virtio_net; src_ip in host byte order */
+void netstack_input(struct net_buf *buf, uint32_t src_ip, uint8_t protocol,
+                    const uint8_t *payload, uint32_t len);
+
+/* Run timers; call from the event loop */
+void net_poll(void);
+
+/* UDP: port 0 picks an ephemeral port. Returns a socket or an error */
+int net_udp_open(uint16_t port);
+int net_udp_sendto(int sock, uint32_t ip, uint16_t port,
+                   const void *data, uint32_t len);
+/* Returns the datagram length (truncated to size), sender in ip/port */
+int net_udp_recvfrom(int sock, void *buf, uint32_t size,
+                     uint32_t *ip, uint16_t *port);
+
+/* TCP: connect returns a socket at once; watch net_tcp_status() */
+int net_tcp_connect(uint32_t ip, uint16_t port);
+int net_tcp_listen(uint16_t port);
+int net_tcp_accept(int listener);
+int net_tcp_status(int sock);
+/* Bytes queued (may be less than len) */
+int net_tcp_send(int sock, const void *data, uint32_t len);
+/* Bytes read; 0 once the peer has closed and everything was read */
+int net_tcp_recv(int sock, void *buf, uint32_t size);
+/* Bytes sent but not yet acknowledged, plus bytes not yet sent */
+uint32_t net_tcp_unacked(int sock);
+
+int net_setopt(int sock, int opt, int value);
+
+/* UDP: release now. TCP: send FIN after queued data, release when done */
+void net_close(int sock);
+
+const struct netstack_stats *net_get_stats(void);
+
+/* Print sockets and counters for shell */
+void net_dump_stats(void);
+
+#endif /* PHANTOMOS_NETSTACK_H */
@@ -7,7 +7,10 @@
  */
 
 #include "pci.h"
+#include "lapic.h"
+#include "vmm.h"
 #include "io.h"
+#include "idt.h"
 #include <stdint.h>
 #include <stddef.h>
 
@@ -27,6 +30,10 @@ static int pci_num_devices = 0;
 
 /*============================================================================
  * PCI Configuration Space Access
+ *
+ * An access is an address write to 0xCF8 and a data access at 0xCFC.
+ * Deferred probe tasks are preempted, so each pair runs with interrupts
+ * held off.
  *============================================================================*/
 
 static uint32_t pci_make_address(uint8_t bus, uint8_t dev, uint8_t func,
@@ -42,8 +49,11 @@ static uint32_t pci_make_address(uint8_t bus, uint8_t dev, uint8_t func,
 uint32_t pci_config_read32(uint8_t bus, uint8_t dev, uint8_t func,
                            uint8_t offset)
 {
+    uint64_t flags = irq_save();
     outl(PCI_CONFIG_ADDRESS, pci_make_address(bus, dev, func, offset));
-    return inl(PCI_CONFIG_DATA);
+    uint32_t val = inl(PCI_CONFIG_DATA);
+    irq_restore(flags);
+    return val;
 }
 
 uint16_t pci_config_read16(uint8_t bus, uint8_t dev, uint8_t func,
@@ -63,20 +73,24 @@ uint8_t pci_config_read8(uint8_t bus, uint8_t dev, uint8_t func,
 void pci_config_write32(uint8_t bus, uint8_t dev, uint8_t func,
                         uint8_t offset, uint32_t value)
 {
+    uint64_t flags = irq_save();
     outl(PCI_CONFIG_ADDRESS, pci_make_address(bus, dev, func, offset));
     outl(PCI_CONFIG_DATA, value);
+    irq_restore(flags);
 }
 
 void pci_config_write16(uint8_t bus, uint8_t dev, uint8_t func,
                         uint8_t offset, uint16_t value)
 {
     uint32_t addr = pci_make_address(bus, dev, func, offset & 0xFC);
+    uint64_t flags = irq_save();
     outl(PCI_CONFIG_ADDRESS, addr);
     uint32_t old = inl(PCI_CONFIG_DATA);
     int shift = (offset & 2) * 8;
     old &= ~(0xFFFF << shift);
     old |= ((uint32_t)value << shift);
     outl(PCI_CONFIG_DATA, old);
+    irq_restore(flags);
 }
 
 /*============================================================================
@@ -262,6 +276,18 @@ const struct pci_device *pci_find_device(uint8_t class_code,
     return NULL;
 }
 
+const struct pci_device *pci_find_class(uint8_t class_code, uint8_t subclass,
+                                        uint8_t prog_if)
+{
+    for (int i = 0; i < pci_num_devices; i++) {
+        if (pci_devices[i].class_code == class_code &&
+            pci_devices[i].subclass == subclass &&
+            pci_devices[i].prog_if == prog_if)
+            return &pci_devices[i];
+    }
+    return NULL;
+}
+
 const struct pci_device *pci_find_by_id(uint16_t vendor_id,
                                         uint16_t device_id)
 {
@@ -313,6 +339,96 @@ void pci_enable_memory_space(const struct pci_device *dev)
     }
 }
 
+/*============================================================================
+ * Capabilities and MSI
+ *============================================================================*/
+
+uint8_t pci_find_capability(const struct pci_device *dev, uint8_t cap_id)
+{
+    if (!dev) return 0;
+
+    uint16_t status = pci_config_read16(dev->bus, dev->device, dev->function,
+                                         PCI_REG_STATUS);
+    if (!(status & PCI_STATUS_CAP_LIST))
+        return 0;
+
+    uint8_t ptr = pci_config_read8(dev->bus, dev->device, dev->function,
+                                    PCI_REG_CAP_PTR) & 0xFC;
+    for (int guard = 0; ptr && guard < 48; guard++) {
+        if (pci_config_read8(dev->bus, dev->device, dev->function, ptr) == cap_id)
+            return ptr;
+        ptr = pci_config_read8(dev->bus, dev->device, dev->function,
+                               ptr + 1) & 0xFC;
+    }
+    return 0;
+}
+
+int pci_enable_msi(const struct pci_device *dev, uint8_t vector,
+                   uint8_t apic_id)
+{
+    uint8_t cap = pci_find_capability(dev, PCI_CAP_ID_MSI);
+    if (!cap) return -1;
+
+    uint8_t b = dev->bus, d = dev->device, f = dev->function;
+    uint16_t ctrl = pci_config_read16(b, d, f, cap + 2);
+
+    /* One vector, fixed delivery, edge triggered, to apic_id */
+    uint32_t addr = MSI_ADDR_BASE | ((uint32_t)apic_id << MSI_ADDR_DEST_SHIFT);
+    pci_config_write32(b, d, f, cap + 4, addr);
+    if (ctrl & PCI_MSI_CTRL_64BIT) {
+        pci_config_write32(b, d, f, cap + 8, 0);
+        pci_config_write16(b, d, f, cap + 12, vector);
+    } else {
+        pci_config_write16(b, d, f, cap + 8, vector);
+    }
+
+    ctrl &= ~PCI_MSI_CTRL_MME_MASK;
+    ctrl |= PCI_MSI_CTRL_ENABLE;
+    pci_config_write16(b, d, f, cap + 2, ctrl);
+
+    /* MSI replaces the pin interrupt */
+    uint16_t cmd = pci_config_read16(b, d, f, PCI_REG_COMMAND);
+    pci_config_write16(b, d, f, PCI_REG_COMMAND, cmd | PCI_CMD_INTX_DISABLE);
+    return 0;
+}
+
+int pci_enable_msix(const struct pci_device *dev, uint16_t entry,
+                    uint8_t vector, uint8_t apic_id)
+{
+    uint8_t cap = pci_find_capability(dev, PCI_CAP_ID_MSIX);
+    if (!cap) return -1;
+
+    uint8_t b = dev->bus, d = dev->device, f = dev->function;
+    uint16_t ctrl = pci_config_read16(b, d, f, cap + 2);
+    if (entry >= PCI_MSIX_CTRL_SIZE(ctrl)) return -1;
+
+    /* Table Offset/BIR: low 3 bits pick the BAR */
+    uint32_t table = pci_config_read32(b, d, f, cap + 4);
+    uint64_t base = dev->bar_addr[table & 7];
+    if (!base) return -1;
+
+    uint64_t addr = base + (table & ~7U) + (uint64_t)entry * PCI_MSIX_ENTRY_SIZE;
+    vmm_map_page(addr & ~0xFFFULL, addr & ~0xFFFULL,
+                 PTE_PRESENT | PTE_WRITABLE | PTE_NOCACHE | PTE_WRITETHROUGH);
+    volatile uint32_t *e = (volatile uint32_t *)(uintptr_t)addr;
+
+    /* Hold every vector masked while the entry is rewritten */
+    pci_config_write16(b, d, f, cap + 2,
+                       ctrl | PCI_MSIX_CTRL_ENABLE | PCI_MSIX_CTRL_FMASK);
+
+    e[0] = MSI_ADDR_BASE | ((uint32_t)apic_id << MSI_ADDR_DEST_SHIFT);
+    e[1] = 0;
+    e[2] = vector;
+    e[3] = e[3] & ~PCI_MSIX_ENTRY_MASKED;
+
+    ctrl = (uint16_t)((ctrl | PCI_MSIX_CTRL_ENABLE) & ~PCI_MSIX_CTRL_FMASK);
+    pci_config_write16(b, d, f, cap + 2, ctrl);
+
+    uint16_t cmd = pci_config_read16(b, d, f, PCI_REG_COMMAND);
+    pci_config_write16(b, d, f, PCI_REG_COMMAND, cmd | PCI_CMD_INTX_DISABLE);
+    return 0;
+}
+
 /*============================================================================
  * Debug Output
  *============================================================================*/
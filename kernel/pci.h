@@ -42,6 +42,7 @@
 #define PCI_REG_BAR5            0x24    /* 32-bit */
 #define PCI_REG_SUBSYS_VENDOR   0x2C    /* 16-bit */
 #define PCI_REG_SUBSYS_ID       0x2E    /* 16-bit */
+#define PCI_REG_CAP_PTR         0x34    /* 8-bit */
 #define PCI_REG_IRQ_LINE        0x3C    /* 8-bit */
 #define PCI_REG_IRQ_PIN         0x3D    /* 8-bit */
 
@@ -52,6 +53,28 @@
 #define PCI_CMD_IO_SPACE        (1 << 0)
 #define PCI_CMD_MEMORY_SPACE    (1 << 1)
 #define PCI_CMD_BUS_MASTER      (1 << 2)
+#define PCI_CMD_INTX_DISABLE    (1 << 10)
+
+#define PCI_STATUS_CAP_LIST     (1 << 4)
+
+/*============================================================================
+ * Capabilities
+ *============================================================================*/
+
+#define PCI_CAP_ID_MSI          0x05
+#define PCI_CAP_ID_MSIX         0x11
+
+/* MSI Message Control (capability + 2) */
+#define PCI_MSI_CTRL_ENABLE     (1 << 0)
+#define PCI_MSI_CTRL_MME_MASK   (7 << 4)    /* Multiple Message Enable */
+#define PCI_MSI_CTRL_64BIT      (1 << 7)
+
+/* MSI-X Message Control (capability + 2) and table entries */
+#define PCI_MSIX_CTRL_SIZE(c)   (((c) & 0x7FF) + 1)
+#define PCI_MSIX_CTRL_FMASK     (1 << 14)   /* Function mask */
+#define PCI_MSIX_CTRL_ENABLE    (1 << 15)
+#define PCI_MSIX_ENTRY_SIZE     16
+#define PCI_MSIX_ENTRY_MASKED   (1 << 0)    /* Vector control */
 
 /*============================================================================
  * PCI Class Codes
@@ -72,6 +95,9 @@
 #define PCI_SUBCLASS_ISA        0x01
 #define PCI_SUBCLASS_PCI        0x04
 
+#define PCI_PROG_IF_UHCI        0x00
+#define PCI_PROG_IF_XHCI        0x30
+
 /*============================================================================
  * BAR Type Detection
  *============================================================================*/
@@ -139,6 +165,10 @@ void pci_config_write16(uint8_t bus, uint8_t dev, uint8_t func,
 const struct pci_device *pci_find_device(uint8_t class_code,
                                          uint8_t subclass);
 
+/* Find device by class/subclass/programming interface */
+const struct pci_device *pci_find_class(uint8_t class_code, uint8_t subclass,
+                                        uint8_t prog_if);
+
 /* Find device by vendor/device ID */
 const struct pci_device *pci_find_by_id(uint16_t vendor_id,
                                         uint16_t device_id);
@@ -153,6 +183,20 @@ void pci_enable_bus_master(const struct pci_device *dev);
 /* Enable memory space access */
 void pci_enable_memory_space(const struct pci_device *dev);
 
+/* Config-space offset of capability cap_id, or 0 if absent */
+uint8_t pci_find_capability(const struct pci_device *dev, uint8_t cap_id);
+
+/* Route the device's interrupt as a single MSI to vector on apic_id and
+ * disable its INTx pin. 0 on success, -1 if it has no MSI capability */
+int pci_enable_msi(const struct pci_device *dev, uint8_t vector,
+                   uint8_t apic_id);
+
+/* Program MSI-X table entry to vector on apic_id, enable MSI-X and disable
+ * the INTx pin. Entries not programmed stay masked. 0 on success, -1 if
+ * the device has no MSI-X capability or fewer entries */
+int pci_enable_msix(const struct pci_device *dev, uint16_t entry,
+                    uint8_t vector, uint8_t apic_id);
+
 /* Print all detected PCI devices */
 void pci_dump_devices(void);
 
@@ -0,0 +1,333 @@
+/*
+ * PhantomOS Sampling Profiler
+ * "To Create, Not To Destroy"
+ *
+ * The RTC interrupt handler hashes the interrupted RIP into an open-
+ * addressed per-CPU table and bumps a per-PID counter; nothing is resolved
+ * or allocated in interrupt context. perf_report() folds the RIP table
+ * into per-function counts via the symbol table and prints the top
+ * entries.
+ */
+
+#include "perf.h"
+#include "ksyms.h"
+#include "process.h"
+#include "idt.h"
+#include "pic.h"
+#include "heap.h"
+#include "io.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/*============================================================================
+ * External Declarations
+ *============================================================================*/
+
+extern int kprintf(const char *fmt, ...);
+extern void *memset(void *s, int c, size_t n);
+
+/*============================================================================
+ * CMOS RTC
+ *============================================================================*/
+
+#define CMOS_ADDR           0x70
+#define CMOS_DATA           0x71
+#define CMOS_NMI_DISABLE    0x80
+
+#define RTC_REG_A           0x0A        /* Divider and rate select */
+#define RTC_REG_B           0x0B        /* Interrupt enables */
+#define RTC_REG_C           0x0C        /* Interrupt flags (read to ack) */
+
+#define RTC_B_PIE           0x40        /* Periodic interrupt enable */
+#define RTC_IRQ             8
+
+static uint8_t cmos_read(uint8_t reg)
+{
+    outb(CMOS_ADDR, CMOS_NMI_DISABLE | reg);
+    return inb(CMOS_DATA);
+}
+
+static void cmos_write(uint8_t reg, uint8_t val)
+{
+    outb(CMOS_ADDR, CMOS_NMI_DISABLE | reg);
+    outb(CMOS_DATA, val);
+}
+
+/*============================================================================
+ * State
+ *============================================================================*/
+
+#define PERF_PROBE_MAX      16          /* Linear probe limit per sample */
+#define PERF_TOP_MAX        64
+
+struct perf_pid {
+    pid_t    pid;
+    uint32_t hits;                      /* 0 = slot unused */
+};
+
+struct perf_cpu {
+    uint64_t        rip[PERF_HASH_SIZE];
+    uint32_t        hits[PERF_HASH_SIZE];
+    struct perf_pid pids[PERF_MAX_PIDS];
+    uint64_t        samples;
+    uint64_t        idle;               /* RIP just after a HLT */
+    uint64_t        lost;               /* RIP table full */
+};
+
+static struct perf_cpu perf_cpus[PERF_MAX_CPUS];
+
+static volatile int perf_on = 0;
+static uint32_t perf_hz = 0;
+static int perf_handler_installed = 0;
+
+/* Single-processor kernel: everything runs on CPU 0 */
+static inline uint32_t perf_cpu_id(void)
+{
+    return 0;
+}
+
+/*============================================================================
+ * Sampling (interrupt context)
+ *============================================================================*/
+
+static void perf_sample(uint64_t rip)
+{
+    struct perf_cpu *c = &perf_cpus[perf_cpu_id()];
+    c->samples++;
+
+    struct process *p = sched_current();
+    pid_t pid = p ? p->pid : 0;
+    for (int i = 0; i < PERF_MAX_PIDS; i++) {
+        if (c->pids[i].hits == 0)
+            c->pids[i].pid = pid;
+        if (c->pids[i].pid == pid) {
+            c->pids[i].hits++;
+            break;
+        }
+    }
+
+    /* Woken from HLT: the byte before RIP is the HLT opcode */
+    if (ksym_in_text(rip - 1) && *(const uint8_t *)(rip - 1) == 0xF4) {
+        c->idle++;
+        return;
+    }
+
+    uint32_t h = (uint32_t)((rip * 0x9E3779B97F4A7C15ULL) >> (64 - PERF_HASH_BITS));
+    for (int probe = 0; probe < PERF_PROBE_MAX; probe++) {
+        uint32_t slot = (h + probe) & (PERF_HASH_SIZE - 1);
+        if (c->hits[slot] == 0)
+            c->rip[slot] = rip;
+        if (c->rip[slot] == rip) {
+            c->hits[slot]++;
+            return;
+        }
+    }
+    c->lost++;
+}
+
+static void perf_rtc_handler(struct interrupt_frame *frame)
+{
+    /* Register C must be read or the RTC raises no further interrupts */
+    cmos_read(RTC_REG_C);
+
+    if (perf_on)
+        perf_sample(frame->rip);
+
+    pic_send_eoi(RTC_IRQ);
+}
+
+/*============================================================================
+ * Control
+ *============================================================================*/
+
+int perf_start(uint32_t hz)
+{
+    if (hz < PERF_MIN_HZ || hz > PERF_MAX_HZ)
+        return -1;
+
+    /* RTC rate r gives 32768 >> (r - 1) Hz; round hz down to a power of 2 */
+    int log2 = 0;
+    while ((2u << log2) <= hz)
+        log2++;
+    uint8_t rate = (uint8_t)(16 - log2);
+
+    if (!perf_handler_installed) {
+        register_interrupt_handler(IRQ_RTC, perf_rtc_handler);
+        perf_handler_installed = 1;
+    }
+
+    int was_enabled = interrupts_enabled();
+    cli();
+    cmos_write(RTC_REG_A, (cmos_read(RTC_REG_A) & 0xF0) | rate);
+    cmos_write(RTC_REG_B, cmos_read(RTC_REG_B) | RTC_B_PIE);
+    cmos_read(RTC_REG_C);
+    perf_hz = 1u << log2;
+    perf_on = 1;
+    if (was_enabled)
+        sti();
+
+    pic_enable_irq(RTC_IRQ);
+    return 0;
+}
+
+void perf_stop(void)
+{
+    if (!perf_handler_installed)
+        return;
+
+    int was_enabled = interrupts_enabled();
+    cli();
+    perf_on = 0;
+    cmos_write(RTC_REG_B, cmos_read(RTC_REG_B) & ~RTC_B_PIE);
+    cmos_read(RTC_REG_C);
+    if (was_enabled)
+        sti();
+
+    pic_disable_irq(RTC_IRQ);
+}
+
+void perf_reset(void)
+{
+    int was_enabled = interrupts_enabled();
+    cli();
+    memset(perf_cpus, 0, sizeof(perf_cpus));
+    if (was_enabled)
+        sti();
+}
+
+int perf_running(void)
+{
+    return perf_on;
+}
+
+uint32_t perf_rate(void)
+{
+    return perf_hz;
+}
+
+uint64_t perf_samples(void)
+{
+    uint64_t n = 0;
+    for (int cpu = 0; cpu < PERF_MAX_CPUS; cpu++)
+        n += perf_cpus[cpu].samples;
+    return n;
+}
+
+/*============================================================================
+ * Reporting
+ *============================================================================*/
+
+/* "12.3%" of total, printed as a fixed 6-column field */
+static void print_pct(uint64_t part, uint64_t total)
+{
+    uint64_t permille = total ? part * 1000 / total : 0;
+    kprintf("%3lu.%lu%%", (unsigned long)(permille / 10),
+            (unsigned long)(permille % 10));
+}
+
+/* Pick the n largest entries of counts[0..len) into top[], by index */
+static uint32_t select_top(const uint32_t *counts, uint32_t len,
+                           uint32_t *top, uint32_t n)
+{
+    uint32_t found = 0;
+    while (found < n) {
+        uint32_t best = 0, best_i = 0;
+        for (uint32_t i = 0; i < len; i++) {
+            if (counts[i] <= best)
+                continue;
+            int taken = 0;
+            for (uint32_t j = 0; j < found; j++)
+                if (top[j] == i) { taken = 1; break; }
+            if (!taken) {
+                best = counts[i];
+                best_i = i;
+            }
+        }
+        if (best == 0)
+            break;
+        top[found++] = best_i;
+    }
+    return found;
+}
+
+void perf_report(uint32_t n)
+{
+    if (n == 0 || n > PERF_TOP_MAX)
+        n = n ? PERF_TOP_MAX : 20;
+
+    uint64_t samples = perf_samples();
+    uint64_t idle = 0, lost = 0;
+    for (int cpu = 0; cpu < PERF_MAX_CPUS; cpu++) {
+        idle += perf_cpus[cpu].idle;
+        lost += perf_cpus[cpu].lost;
+    }
+
+    uint64_t secs10 = perf_hz ? samples * 10 / perf_hz : 0;
+    kprintf("\nProfile: %lu samples at %u Hz over %lu.%lu s (%s)\n",
+            (unsigned long)samples, perf_hz,
+            (unsigned long)(secs10 / 10), (unsigned long)(secs10 % 10),
+            perf_on ? "running" : "stopped");
+    if (samples == 0)
+        return;
+
+    kprintf("  idle  %8lu  ", (unsigned long)idle);
+    print_pct(idle, samples);
+    kprintf("\n  busy  %8lu  ", (unsigned long)(samples - idle));
+    print_pct(samples - idle, samples);
+    kprintf("\n");
+    if (lost)
+        kprintf("  (%lu samples lost: RIP table full)\n", (unsigned long)lost);
+
+    /* Fold RIPs into functions */
+    uint32_t nsyms = ksym_total();
+    uint32_t buckets = nsyms ? nsyms + 1 : 0;   /* Last bucket: unknown */
+    uint32_t *counts = buckets ? (uint32_t *)kmalloc(buckets * sizeof(uint32_t))
+                               : NULL;
+    uint32_t top[PERF_TOP_MAX];
+
+    if (counts) {
+        memset(counts, 0, buckets * sizeof(uint32_t));
+        for (int cpu = 0; cpu < PERF_MAX_CPUS; cpu++) {
+            struct perf_cpu *c = &perf_cpus[cpu];
+            for (uint32_t s = 0; s < PERF_HASH_SIZE; s++) {
+                if (c->hits[s] == 0)
+                    continue;
+                int idx = ksym_index(c->rip[s]);
+                counts[idx >= 0 ? (uint32_t)idx : nsyms] += c->hits[s];
+            }
+        }
+
+        uint32_t found = select_top(counts, buckets, top, n);
+        kprintf("\n   Samples      %%  Function\n");
+        for (uint32_t i = 0; i < found; i++) {
+            kprintf("  %8u  ", counts[top[i]]);
+            print_pct(counts[top[i]], samples);
+            kprintf("  %s\n", top[i] < nsyms ? ksym_name((int)top[i])
+                                             : "[unknown]");
+        }
+        kfree(counts);
+    } else {
+        /* No symbol table (first-pass image): show raw addresses */
+        struct perf_cpu *c = &perf_cpus[0];
+        uint32_t found = select_top(c->hits, PERF_HASH_SIZE, top, n);
+        kprintf("\n   Samples      %%  RIP (no symbol table)\n");
+        for (uint32_t i = 0; i < found; i++) {
+            kprintf("  %8u  ", c->hits[top[i]]);
+            print_pct(c->hits[top[i]], samples);
+            kprintf("  0x%lx\n", (unsigned long)c->rip[top[i]]);
+        }
+    }
+
+    /* Per-process split */
+    kprintf("\n   Samples      %%    PID  Process\n");
+    for (int cpu = 0; cpu < PERF_MAX_CPUS; cpu++) {
+        struct perf_cpu *c = &perf_cpus[cpu];
+        for (int i = 0; i < PERF_MAX_PIDS && c->pids[i].hits; i++) {
+            struct process *p = process_get(c->pids[i].pid);
+            kprintf("  %8u  ", c->pids[i].hits);
+            print_pct(c->pids[i].hits, samples);
+            kprintf("  %5u  %s\n", (unsigned)c->pids[i].pid,
+                    p ? p->name : "?");
+        }
+    }
+}
@@ -0,0 +1,43 @@
+/*
+ * PhantomOS Sampling Profiler
+ * "To Create, Not To Destroy"
+ *
+ * Statistical CPU profiler. While running, a periodic interrupt records
+ * the interrupted RIP and the current PID into a per-CPU histogram;
+ * `perf` in the shell resolves the RIPs against the embedded kernel
+ * symbol table (ksyms.h) and prints the hottest functions.
+ *
+ * Samples are driven by the CMOS RTC periodic interrupt (IRQ8), which is
+ * independent of the 100 Hz PIT tick and programmable from 2 to 8192 Hz,
+ * so profiling does not disturb scheduling or timekeeping. Samples whose
+ * RIP directly follows a HLT are counted as idle.
+ */
+
+#ifndef PHANTOMOS_PERF_H
+#define PHANTOMOS_PERF_H
+
+#include <stdint.h>
+
+#define PERF_MAX_CPUS       1           /* Kernel runs on the BSP only */
+#define PERF_HASH_BITS      12
+#define PERF_HASH_SIZE      (1 << PERF_HASH_BITS)   /* Distinct RIPs per CPU */
+#define PERF_MAX_PIDS       32          /* Distinct PIDs tracked per CPU */
+#define PERF_DEFAULT_HZ     1024
+#define PERF_MIN_HZ         2
+#define PERF_MAX_HZ         8192
+
+/* Start sampling at hz (rounded down to a power of two). 0 on success */
+int perf_start(uint32_t hz);
+void perf_stop(void);
+void perf_reset(void);
+
+int perf_running(void);
+uint32_t perf_rate(void);
+
+/* Samples taken since reset (all CPUs) */
+uint64_t perf_samples(void);
+
+/* Print the top n functions and the per-process split */
+void perf_report(uint32_t n);
+
+#endif /* PHANTOMOS_PERF_H */
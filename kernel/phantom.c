@@ -220,6 +220,14 @@ phantom_error_t phantom_init(struct phantom_kernel *kernel, const char *geofs_pa
     } else {
         printf("  Opened GeoFS volume: %s\n", geofs_path);
     }
+    /* Serve file reads straight from a mapping of the volume */
+    if (geofs_volume_map(vol) != GEOFS_OK) {
+        printf("  GeoFS mmap unavailable, reads will copy\n");
+    }
+    /* IPC messages are small and frequent: commit them in groups */
+    if (geofs_volume_set_sync(vol, GEOFS_SYNC_GROUP, PHANTOM_GEOFS_COMMIT_MS) != GEOFS_OK) {
+        printf("  GeoFS group commit unavailable, syncing on shutdown\n");
+    }
     kernel->geofs_volume = vol;
 
     printf("\n");
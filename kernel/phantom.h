@@ -27,6 +27,7 @@
 #define PHANTOM_MAX_PATH        4096
 #define PHANTOM_HASH_SIZE       32
 #define PHANTOM_SIGNATURE_SIZE  64
+#define PHANTOM_GEOFS_COMMIT_MS 50      /* GeoFS group commit interval */
 
 /* ══════════════════════════════════════════════════════════════════════════════
  * TYPES
@@ -0,0 +1,240 @@
+/*
+ * PhantomOS Pixel Kernels
+ * "To Create, Not To Destroy"
+ *
+ * Scalar reference kernels, CPUID-based implementation selection and
+ * dispatch. The SSE2/AVX2 variants live in pixel_sse2.c / pixel_avx2.c,
+ * which are compiled from the shared body in pixel_simd.h.
+ */
+
+#include "pixel.h"
+#include <stddef.h>
+
+/*============================================================================
+ * External Declarations
+ *============================================================================*/
+
+extern int kprintf(const char *fmt, ...);
+
+/*============================================================================
+ * CPU Feature Detection
+ *============================================================================*/
+
+#define CPUID1_ECX_XSAVE        (1U << 26)
+#define CPUID1_ECX_OSXSAVE      (1U << 27)
+#define CPUID1_ECX_AVX          (1U << 28)
+#define CPUID1_EDX_SSE          (1U << 25)
+#define CPUID1_EDX_SSE2         (1U << 26)
+#define CPUID7_EBX_AVX2         (1U << 5)
+
+#define CR0_MP                  (1UL << 1)
+#define CR0_EM                  (1UL << 2)
+#define CR4_OSFXSR              (1UL << 9)
+#define CR4_OSXMMEXCPT          (1UL << 10)
+#define CR4_OSXSAVE             (1UL << 18)
+
+#define XCR0_X87                (1UL << 0)
+#define XCR0_SSE                (1UL << 1)
+#define XCR0_AVX                (1UL << 2)
+
+static inline void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t *eax,
+                         uint32_t *ebx, uint32_t *ecx, uint32_t *edx)
+{
+    __asm__ volatile("cpuid"
+        : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+        : "a"(leaf), "c"(subleaf));
+}
+
+static inline uint64_t xgetbv(uint32_t index)
+{
+    uint32_t lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(index));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+int px_impl_supported(enum px_impl impl)
+{
+    uint32_t eax, ebx, ecx, edx;
+
+    if (impl == PX_IMPL_SCALAR)
+        return 1;
+
+    cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+
+    if (impl == PX_IMPL_SSE2)
+        return (edx & CPUID1_EDX_SSE) && (edx & CPUID1_EDX_SSE2);
+
+    if (impl == PX_IMPL_AVX2) {
+        /* AVX needs the OS to have enabled YMM state via XCR0 */
+        if (!(ecx & CPUID1_ECX_AVX) || !(ecx & CPUID1_ECX_OSXSAVE))
+            return 0;
+        if ((xgetbv(0) & (XCR0_SSE | XCR0_AVX)) != (XCR0_SSE | XCR0_AVX))
+            return 0;
+        cpuid(0, 0, &eax, &ebx, &ecx, &edx);
+        if (eax < 7)
+            return 0;
+        cpuid(7, 0, &eax, &ebx, &ecx, &edx);
+        return (ebx & CPUID7_EBX_AVX2) != 0;
+    }
+
+    return 0;
+}
+
+/*
+ * Turn on SSE (and AVX, if present) register state. boot.S leaves it
+ * off, and the rest of the kernel is built with -mno-sse.
+ */
+static void px_enable_simd_state(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+    uint64_t cr0, cr4;
+
+    cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+    if (!(edx & CPUID1_EDX_SSE2))
+        return;
+
+    __asm__ volatile("mov %%cr0, %0" : "=r"(cr0));
+    cr0 &= ~CR0_EM;
+    cr0 |= CR0_MP;
+    __asm__ volatile("mov %0, %%cr0" : : "r"(cr0));
+
+    __asm__ volatile("mov %%cr4, %0" : "=r"(cr4));
+    cr4 |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+    if (ecx & CPUID1_ECX_XSAVE)
+        cr4 |= CR4_OSXSAVE;
+    __asm__ volatile("mov %0, %%cr4" : : "r"(cr4));
+
+    if ((ecx & CPUID1_ECX_XSAVE) && (ecx & CPUID1_ECX_AVX)) {
+        uint64_t xcr0 = XCR0_X87 | XCR0_SSE | XCR0_AVX;
+        __asm__ volatile("xsetbv" : :
+            "c"(0), "a"((uint32_t)xcr0), "d"((uint32_t)(xcr0 >> 32)));
+    }
+}
+
+/*============================================================================
+ * Scalar Reference Kernels
+ *============================================================================*/
+
+static void scalar_fill(uint32_t *dst, uint32_t n, uint32_t color)
+{
+    for (uint32_t i = 0; i < n; i++)
+        dst[i] = color;
+}
+
+static void scalar_blend_const(uint32_t *dst, uint32_t n, uint32_t color,
+                               uint8_t alpha)
+{
+    for (uint32_t i = 0; i < n; i++)
+        dst[i] = px_blend_pixel(color, dst[i], alpha);
+}
+
+static void scalar_blend_alpha(uint32_t *dst, const uint32_t *src, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+        dst[i] = px_blend_pixel(src[i], dst[i], (uint8_t)(src[i] >> 24));
+}
+
+static void scalar_over_premul(uint32_t *dst, const uint32_t *src, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+        dst[i] = px_over_pixel(src[i], dst[i]);
+}
+
+static void scalar_ramp(uint32_t *dst, uint32_t n, uint32_t c0, uint32_t c1,
+                        int32_t t0, int32_t dt, uint32_t span)
+{
+    /* Same arithmetic as px_ramp_pixel, with the divisions hoisted */
+    int32_t step[3], base[3];
+    for (int c = 0; c < 3; c++) {
+        step[c] = px_ramp_step(c0, c1, c * 8, span);
+        base[c] = (int32_t)(((c0 >> (c * 8)) & 0xFF) << 16) + 0x8000;
+    }
+
+    int32_t t = t0;
+    for (uint32_t i = 0; i < n; i++, t += dt) {
+        int32_t tc = t < 0 ? 0 : (t > (int32_t)span ? (int32_t)span : t);
+        dst[i] = 0xFF000000 |
+                 ((uint32_t)((base[2] + tc * step[2]) >> 16) << 16) |
+                 ((uint32_t)((base[1] + tc * step[1]) >> 16) << 8) |
+                 (uint32_t)((base[0] + tc * step[0]) >> 16);
+    }
+}
+
+const struct px_ops px_scalar_ops = {
+    .name        = "Scalar",
+    .fill        = scalar_fill,
+    .blend_const = scalar_blend_const,
+    .blend_alpha = scalar_blend_alpha,
+    .over_premul = scalar_over_premul,
+    .ramp        = scalar_ramp,
+};
+
+/*============================================================================
+ * Selection
+ *============================================================================*/
+
+static const struct px_ops *active_ops = &px_scalar_ops;
+
+const struct px_ops *px_get_impl(enum px_impl impl)
+{
+    if (!px_impl_supported(impl))
+        return NULL;
+
+    switch (impl) {
+    case PX_IMPL_SCALAR: return &px_scalar_ops;
+    case PX_IMPL_SSE2:   return &px_sse2_ops;
+    case PX_IMPL_AVX2:   return &px_avx2_ops;
+    default:             return NULL;
+    }
+}
+
+void px_init(void)
+{
+    px_enable_simd_state();
+
+    active_ops = &px_scalar_ops;
+    for (int impl = PX_IMPL_COUNT - 1; impl > PX_IMPL_SCALAR; impl--) {
+        const struct px_ops *ops = px_get_impl((enum px_impl)impl);
+        if (ops) {
+            active_ops = ops;
+            break;
+        }
+    }
+
+    kprintf("[PX] Pixel kernels: %s\n", active_ops->name);
+}
+
+const char *px_get_active_name(void)
+{
+    return active_ops->name;
+}
+
+/*============================================================================
+ * Dispatch
+ *============================================================================*/
+
+void px_fill(uint32_t *dst, uint32_t n, uint32_t color)
+{
+    active_ops->fill(dst, n, color);
+}
+
+void px_blend_const(uint32_t *dst, uint32_t n, uint32_t color, uint8_t alpha)
+{
+    active_ops->blend_const(dst, n, color, alpha);
+}
+
+void px_blend_alpha(uint32_t *dst, const uint32_t *src, uint32_t n)
+{
+    active_ops->blend_alpha(dst, src, n);
+}
+
+void px_over_premul(uint32_t *dst, const uint32_t *src, uint32_t n)
+{
+    active_ops->over_premul(dst, src, n);
+}
+
+void px_ramp(uint32_t *dst, uint32_t n, uint32_t c0, uint32_t c1,
+             int32_t t0, int32_t dt, uint32_t span)
+{
+    active_ops->ramp(dst, n, c0, c1, t0, dt, span);
+}
@@ -0,0 +1,135 @@
+/*
+ * PhantomOS Pixel Kernels
+ * "To Create, Not To Destroy"
+ *
+ * Batched span operations on 32-bit ARGB pixels: solid fill, constant
+ * alpha blend, per-pixel alpha blend, linear color ramps (used for
+ * horizontal, vertical and radial gradients) and premultiplied "over"
+ * compositing. Each operation has a scalar reference implementation plus
+ * SSE2 and AVX2 variants; px_init() picks the best one via CPUID.
+ *
+ * All implementations are bit-exact with the scalar path (test_pixel.c).
+ *
+ * The SIMD variants use XMM/YMM registers, which context_switch.S does
+ * not save. Only the thread that owns the framebuffer (the desktop) may
+ * call into this module.
+ */
+
+#ifndef PHANTOMOS_PIXEL_H
+#define PHANTOMOS_PIXEL_H
+
+#include <stdint.h>
+
+/*============================================================================
+ * Implementations
+ *============================================================================*/
+
+enum px_impl {
+    PX_IMPL_SCALAR = 0,
+    PX_IMPL_SSE2   = 1,
+    PX_IMPL_AVX2   = 2,
+    PX_IMPL_COUNT
+};
+
+/*
+ * Span operations (function pointer table)
+ *
+ * ramp: dst[i] = lerp(c0, c1, t, span) with t = t0 + i * dt clamped to
+ * [0, span]. dt of +1/-1 walks a gradient left-to-right or mirrored.
+ */
+struct px_ops {
+    const char *name;
+
+    void (*fill)(uint32_t *dst, uint32_t n, uint32_t color);
+    void (*blend_const)(uint32_t *dst, uint32_t n, uint32_t color,
+                        uint8_t alpha);
+    void (*blend_alpha)(uint32_t *dst, const uint32_t *src, uint32_t n);
+    void (*over_premul)(uint32_t *dst, const uint32_t *src, uint32_t n);
+    void (*ramp)(uint32_t *dst, uint32_t n, uint32_t c0, uint32_t c1,
+                 int32_t t0, int32_t dt, uint32_t span);
+};
+
+extern const struct px_ops px_scalar_ops;
+extern const struct px_ops px_sse2_ops;
+extern const struct px_ops px_avx2_ops;
+
+/*============================================================================
+ * Per-Pixel Reference Math (shared by every implementation)
+ *============================================================================*/
+
+/* fg over bg with coverage alpha (0=bg, 255=~fg); result is opaque */
+static inline uint32_t px_blend_pixel(uint32_t fg, uint32_t bg, uint8_t alpha)
+{
+    uint32_t inv = 255 - alpha;
+    uint32_t r = (((fg >> 16) & 0xFF) * alpha + ((bg >> 16) & 0xFF) * inv) >> 8;
+    uint32_t g = (((fg >> 8) & 0xFF) * alpha + ((bg >> 8) & 0xFF) * inv) >> 8;
+    uint32_t b = ((fg & 0xFF) * alpha + (bg & 0xFF) * inv) >> 8;
+    return 0xFF000000 | (r << 16) | (g << 8) | b;
+}
+
+/* Premultiplied src over dst: dst = src + dst * (255 - src.a) / 255 */
+static inline uint32_t px_over_pixel(uint32_t src, uint32_t dst)
+{
+    uint32_t ia = 255 - (src >> 24);
+    uint32_t out = 0;
+
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t x = ((dst >> shift) & 0xFF) * ia + 128;
+        x = (x + (x >> 8)) >> 8;
+        uint32_t c = ((src >> shift) & 0xFF) + x;
+        if (c > 255) c = 255;
+        out |= c << shift;
+    }
+    return out;
+}
+
+/* 16.16 fixed-point step of one channel across span */
+static inline int32_t px_ramp_step(uint32_t c0, uint32_t c1, int shift,
+                                   uint32_t span)
+{
+    int32_t a = (int32_t)((c0 >> shift) & 0xFF);
+    int32_t b = (int32_t)((c1 >> shift) & 0xFF);
+    return (b - a) * 65536 / (int32_t)(span ? span : 1);
+}
+
+/* Opaque color at position t of a c0 -> c1 ramp over [0, span] */
+static inline uint32_t px_ramp_pixel(uint32_t c0, uint32_t c1, int32_t t,
+                                     uint32_t span)
+{
+    if (t < 0) t = 0;
+    if (t > (int32_t)span) t = (int32_t)span;
+
+    uint32_t out = 0xFF000000;
+    for (int shift = 0; shift < 24; shift += 8) {
+        int32_t base = (int32_t)(((c0 >> shift) & 0xFF) << 16) + 0x8000;
+        int32_t v = base + t * px_ramp_step(c0, c1, shift, span);
+        out |= (uint32_t)(v >> 16) << shift;
+    }
+    return out;
+}
+
+/*============================================================================
+ * API
+ *============================================================================*/
+
+/* Enable SIMD state in CR0/CR4/XCR0 and select the fastest implementation */
+void px_init(void);
+
+/* Does this CPU (and OS state) support the implementation? */
+int px_impl_supported(enum px_impl impl);
+
+/* Get an implementation's table, or NULL if unsupported */
+const struct px_ops *px_get_impl(enum px_impl impl);
+
+/* Name of the active implementation ("AVX2", "SSE2", "Scalar") */
+const char *px_get_active_name(void);
+
+/* Span operations (dispatch to active implementation) */
+void px_fill(uint32_t *dst, uint32_t n, uint32_t color);
+void px_blend_const(uint32_t *dst, uint32_t n, uint32_t color, uint8_t alpha);
+void px_blend_alpha(uint32_t *dst, const uint32_t *src, uint32_t n);
+void px_over_premul(uint32_t *dst, const uint32_t *src, uint32_t n);
+void px_ramp(uint32_t *dst, uint32_t n, uint32_t c0, uint32_t c1,
+             int32_t t0, int32_t dt, uint32_t span);
+
+#endif /* PHANTOMOS_PIXEL_H */
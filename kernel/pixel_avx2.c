@@ -0,0 +1,13 @@
+/*
+ * PhantomOS Pixel Kernels - AVX2
+ * "To Create, Not To Destroy"
+ *
+ * 256-bit build of pixel_simd.h. Compiled with -mavx2 (see Makefile.boot);
+ * only called after px_init() has enabled YMM state and checked CPUID.
+ */
+
+#define PX_VEC_BYTES    32
+#define PX_OPS_NAME     px_avx2_ops
+#define PX_OPS_LABEL    "AVX2"
+
+#include "pixel_simd.h"
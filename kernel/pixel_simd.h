@@ -0,0 +1,174 @@
+/*
+ * PhantomOS Pixel Kernels - SIMD Body
+ * "To Create, Not To Destroy"
+ *
+ * Vector implementation of the px_ops span kernels, written with GCC
+ * vector extensions so no intrinsic headers are needed. Included by
+ * pixel_sse2.c and pixel_avx2.c, which set the vector width and are
+ * compiled with the matching -m flags:
+ *
+ *   PX_VEC_BYTES   16 (SSE2) or 32 (AVX2)
+ *   PX_OPS_NAME    name of the exported struct px_ops
+ *   PX_OPS_LABEL   human-readable implementation name
+ *
+ * Every lane does exactly the integer arithmetic of the scalar helpers
+ * in pixel.h, and tails fall back to those helpers, so results are
+ * bit-exact with the scalar path.
+ */
+
+#include "pixel.h"
+
+#define PX_LANES    (PX_VEC_BYTES / 4)
+
+typedef uint32_t px_vu32 __attribute__((vector_size(PX_VEC_BYTES)));
+typedef int32_t  px_vi32 __attribute__((vector_size(PX_VEC_BYTES)));
+typedef uint8_t  px_vu8  __attribute__((vector_size(PX_VEC_BYTES)));
+typedef uint16_t px_vu16 __attribute__((vector_size(PX_VEC_BYTES * 2)));
+typedef int16_t  px_vi16 __attribute__((vector_size(PX_VEC_BYTES * 2)));
+
+/*============================================================================
+ * Helpers
+ *============================================================================*/
+
+static inline px_vu32 vload(const uint32_t *p)
+{
+    px_vu32 v;
+    __builtin_memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void vstore(uint32_t *p, px_vu32 v)
+{
+    __builtin_memcpy(p, &v, sizeof(v));
+}
+
+static inline px_vu32 vsplat(uint32_t x)
+{
+    px_vu32 v = { 0 };
+    return v + x;
+}
+
+/* Per channel: (fg * a + bg * (255 - a)) >> 8, alpha forced opaque */
+static inline px_vu32 vmix(px_vu32 fg, px_vu32 bg, px_vu32 alpha)
+{
+    px_vu16 f = __builtin_convertvector((px_vu8)fg, px_vu16);
+    px_vu16 b = __builtin_convertvector((px_vu8)bg, px_vu16);
+    px_vu16 a = __builtin_convertvector((px_vu8)(alpha * 0x01010101U), px_vu16);
+    px_vu16 r = (f * a + b * (255 - a)) >> 8;
+    return (px_vu32)__builtin_convertvector(r, px_vu8) | 0xFF000000U;
+}
+
+/*============================================================================
+ * Kernels
+ *============================================================================*/
+
+static void simd_fill(uint32_t *dst, uint32_t n, uint32_t color)
+{
+    px_vu32 c = vsplat(color);
+    uint32_t i = 0;
+
+    for (; i + 4 * PX_LANES <= n; i += 4 * PX_LANES) {
+        vstore(dst + i, c);
+        vstore(dst + i + PX_LANES, c);
+        vstore(dst + i + 2 * PX_LANES, c);
+        vstore(dst + i + 3 * PX_LANES, c);
+    }
+    for (; i + PX_LANES <= n; i += PX_LANES)
+        vstore(dst + i, c);
+    for (; i < n; i++)
+        dst[i] = color;
+}
+
+static void simd_blend_const(uint32_t *dst, uint32_t n, uint32_t color,
+                             uint8_t alpha)
+{
+    px_vu32 fg = vsplat(color);
+    px_vu32 a = vsplat(alpha);
+    uint32_t i = 0;
+
+    for (; i + PX_LANES <= n; i += PX_LANES)
+        vstore(dst + i, vmix(fg, vload(dst + i), a));
+    for (; i < n; i++)
+        dst[i] = px_blend_pixel(color, dst[i], alpha);
+}
+
+static void simd_blend_alpha(uint32_t *dst, const uint32_t *src, uint32_t n)
+{
+    uint32_t i = 0;
+
+    for (; i + PX_LANES <= n; i += PX_LANES) {
+        px_vu32 s = vload(src + i);
+        vstore(dst + i, vmix(s, vload(dst + i), s >> 24));
+    }
+    for (; i < n; i++)
+        dst[i] = px_blend_pixel(src[i], dst[i], (uint8_t)(src[i] >> 24));
+}
+
+static void simd_over_premul(uint32_t *dst, const uint32_t *src, uint32_t n)
+{
+    uint32_t i = 0;
+
+    for (; i + PX_LANES <= n; i += PX_LANES) {
+        px_vu32 s32 = vload(src + i);
+        px_vu16 s = __builtin_convertvector((px_vu8)s32, px_vu16);
+        px_vu16 d = __builtin_convertvector((px_vu8)vload(dst + i), px_vu16);
+        px_vu16 ia = 255 - __builtin_convertvector(
+                         (px_vu8)((s32 >> 24) * 0x01010101U), px_vu16);
+
+        px_vu16 x = d * ia + 128;
+        x = (x + (x >> 8)) >> 8;
+        px_vu16 r = s + x;
+
+        /* Clamp to 255 (only reachable with non-premultiplied input) */
+        px_vu16 over = (px_vu16)(r > 255);
+        r = (r & ~over) | (over & 255);
+
+        vstore(dst + i, (px_vu32)__builtin_convertvector(r, px_vu8));
+    }
+    for (; i < n; i++)
+        dst[i] = px_over_pixel(src[i], dst[i]);
+}
+
+static void simd_ramp(uint32_t *dst, uint32_t n, uint32_t c0, uint32_t c1,
+                      int32_t t0, int32_t dt, uint32_t span)
+{
+    int32_t sr = px_ramp_step(c0, c1, 16, span);
+    int32_t sg = px_ramp_step(c0, c1, 8, span);
+    int32_t sb = px_ramp_step(c0, c1, 0, span);
+    int32_t br = (int32_t)(((c0 >> 16) & 0xFF) << 16) + 0x8000;
+    int32_t bg = (int32_t)(((c0 >> 8) & 0xFF) << 16) + 0x8000;
+    int32_t bb = (int32_t)((c0 & 0xFF) << 16) + 0x8000;
+
+    px_vi32 t = { 0 };
+    for (int l = 0; l < PX_LANES; l++)
+        t[l] = t0 + l * dt;
+    px_vi32 zero = { 0 };
+    px_vi32 hi = zero + (int32_t)span;
+    uint32_t i = 0;
+
+    for (; i + PX_LANES <= n; i += PX_LANES) {
+        /* Clamp t to [0, span] */
+        px_vi32 lo_mask = t < zero;
+        px_vi32 tc = t & ~lo_mask;
+        px_vi32 hi_mask = tc > hi;
+        tc = (tc & ~hi_mask) | (hi & hi_mask);
+
+        px_vu32 r = (px_vu32)((br + tc * sr) >> 16);
+        px_vu32 g = (px_vu32)((bg + tc * sg) >> 16);
+        px_vu32 b = (px_vu32)((bb + tc * sb) >> 16);
+        vstore(dst + i, 0xFF000000U | (r << 16) | (g << 8) | b);
+
+        t += PX_LANES * dt;
+    }
+    for (int32_t tt = t0 + (int32_t)i * dt; i < n; i++, tt += dt)
+        dst[i] = px_ramp_pixel(c0, c1, tt, span);
+}
+
+const struct px_ops PX_OPS_NAME = {
+    .name        = PX_OPS_LABEL,
+    .fill        = simd_fill,
+    .blend_const = simd_blend_const,
+    .blend_alpha = simd_blend_alpha,
+    .over_premul = simd_over_premul,
+    .ramp        = simd_ramp,
+};
@@ -0,0 +1,13 @@
+/*
+ * PhantomOS Pixel Kernels - SSE2
+ * "To Create, Not To Destroy"
+ *
+ * 128-bit build of pixel_simd.h. Compiled with -msse2 (see Makefile.boot);
+ * only called after px_init() has enabled SSE state and checked CPUID.
+ */
+
+#define PX_VEC_BYTES    16
+#define PX_OPS_NAME     px_sse2_ops
+#define PX_OPS_LABEL    "SSE2"
+
+#include "pixel_simd.h"
@@ -6,6 +6,7 @@
  */
 
 #include "pmm.h"
+#include "idt.h"
 #include <stdint.h>
 #include <stddef.h>
 
@@ -210,7 +211,7 @@ void pmm_init(struct multiboot_info *mb_info)
     pmm_initialized = 1;
 }
 
-void *pmm_alloc_page(void)
+static void *pmm_alloc_page_locked(void)
 {
     if (!pmm_initialized) {
         return NULL;
@@ -249,7 +250,7 @@ void *pmm_alloc_page(void)
     return NULL;  /* Out of memory */
 }
 
-void *pmm_alloc_pages(size_t count)
+static void *pmm_alloc_pages_locked(size_t count)
 {
     if (!pmm_initialized || count == 0) {
         return NULL;
@@ -290,7 +291,7 @@ void *pmm_alloc_pages(size_t count)
     return NULL;  /* Not enough contiguous memory */
 }
 
-void pmm_free_page(void *addr)
+static void pmm_free_page_locked(void *addr)
 {
     if (!pmm_initialized || !addr) {
         return;
@@ -313,16 +314,43 @@ void pmm_free_page(void *addr)
     pmm_stats.total_frees++;
 }
 
+/* Public entry points run with interrupts off: boot-time tasks can preempt
+ * the desktop in the middle of an allocation */
+void *pmm_alloc_page(void)
+{
+    uint64_t flags = irq_save();
+    void *page = pmm_alloc_page_locked();
+    irq_restore(flags);
+    return page;
+}
+
+void *pmm_alloc_pages(size_t count)
+{
+    uint64_t flags = irq_save();
+    void *pages = pmm_alloc_pages_locked(count);
+    irq_restore(flags);
+    return pages;
+}
+
+void pmm_free_page(void *addr)
+{
+    uint64_t flags = irq_save();
+    pmm_free_page_locked(addr);
+    irq_restore(flags);
+}
+
 void pmm_free_pages(void *addr, size_t count)
 {
     if (!pmm_initialized || !addr || count == 0) {
         return;
     }
 
+    uint64_t flags = irq_save();
     uint64_t start_page = ADDR_TO_PAGE((uint64_t)addr);
     for (size_t i = 0; i < count; i++) {
-        pmm_free_page((void *)PAGE_TO_ADDR(start_page + i));
+        pmm_free_page_locked((void *)PAGE_TO_ADDR(start_page + i));
     }
+    irq_restore(flags);
 }
 
 void pmm_mark_used(uint64_t addr)
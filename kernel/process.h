@@ -110,6 +110,9 @@ struct process {
     /* Statistics (append-only, Phantom style) */
     uint64_t            created_tick;
     uint64_t            context_switches;
+
+    /* Interrupt nesting when switched out (for trace record context) */
+    int                 trace_irq_depth;
 };
 
 /*============================================================================
@@ -147,6 +150,23 @@ void sched_init(void);
  */
 void sched_start(void);
 
+/*
+ * Make the calling context (the boot thread) a process and start
+ * scheduling, without giving up the CPU. Other processes then run when
+ * this one yields or its time slice expires. Alternative to sched_start().
+ */
+void sched_adopt(const char *name);
+
+/*
+ * Non-zero once sched_start() or sched_adopt() has run
+ */
+int sched_running(void);
+
+/*
+ * Non-zero if another process is waiting for the CPU
+ */
+int sched_has_ready(void);
+
 /*
  * Yield CPU to another process (cooperative)
  */
@@ -8,6 +8,8 @@
 #include "process.h"
 #include "heap.h"
 #include "pmm.h"
+#include "trace.h"
+#include "idt.h"
 #include <stdint.h>
 #include <stddef.h>
 
@@ -29,10 +31,6 @@ extern void context_switch(struct cpu_context *old_ctx,
 extern void context_start(struct cpu_context *ctx);
 extern void process_entry_wrapper(void);
 
-/* Interrupt control */
-static inline void cli(void) { __asm__ volatile("cli"); }
-static inline void sti(void) { __asm__ volatile("sti"); }
-
 /*============================================================================
  * Scheduler State
  *============================================================================*/
@@ -162,8 +160,14 @@ static void schedule(void)
     /* Get next process from ready queue */
     next = ready_queue_pop();
 
-    /* If nothing ready, run idle process */
+    /* If nothing else is ready, keep running the current process (fresh
+     * time slice), or idle if it is blocking or exiting */
     if (!next) {
+        if (current_process &&
+            current_process->state == PROCESS_STATE_RUNNING) {
+            current_process->time_slice = TIME_SLICE_TICKS;
+            return;
+        }
         next = idle_process;
     }
 
@@ -187,11 +191,16 @@ static void schedule(void)
         ready_queue_add(old);
     }
 
+    TRACE_INSTANT(TRACE_ID_SCHED_SWITCH, old ? old->pid : 0, next->pid, 0);
+
     /* Perform context switch */
     if (old) {
+        old->trace_irq_depth = trace_irq_depth();
+        trace_set_irq_depth(next->trace_irq_depth);
         context_switch(&old->context, &next->context);
     } else {
         /* First run - just start the new context */
+        trace_set_irq_depth(next->trace_irq_depth);
         context_start(&next->context);
     }
 }
@@ -262,8 +271,65 @@ void sched_start(void)
     idle_task(NULL);
 }
 
+void sched_adopt(const char *name)
+{
+    if (!sched_initialized || current_process) {
+        return;
+    }
+
+    cli();
+
+    struct process *proc = alloc_process_slot();
+    if (!proc) {
+        sti();
+        kprintf("sched_adopt: no free slots\n");
+        return;
+    }
+
+    /* The boot stack stays in use; there is no stack to allocate or free,
+     * and the context is filled in by the first context_switch() away */
+    memset(proc, 0, sizeof(*proc));
+    proc->pid = next_pid++;
+    proc->priority = 10;
+    proc->parent_pid = PID_KERNEL;
+    proc->created_tick = timer_get_ticks();
+    size_t len = strlen(name);
+    if (len >= PROCESS_NAME_MAX) len = PROCESS_NAME_MAX - 1;
+    memcpy(proc->name, name, len);
+    proc->name[len] = '\0';
+
+    proc->state = PROCESS_STATE_RUNNING;
+    proc->time_slice = TIME_SLICE_TICKS;
+    current_process = proc;
+
+    sched_stats.total_processes_created++;
+    sched_stats.active_processes++;
+    if (sched_stats.active_processes > sched_stats.peak_processes) {
+        sched_stats.peak_processes = sched_stats.active_processes;
+    }
+
+    sti();
+    kprintf("  Scheduler: running, boot context is PID %u (%s)\n",
+            proc->pid, proc->name);
+}
+
+int sched_running(void)
+{
+    return current_process != NULL;
+}
+
+int sched_has_ready(void)
+{
+    return ready_head != NULL;
+}
+
 void sched_yield(void)
 {
+    /* Before sched_start()/sched_adopt() there is no context to return to */
+    if (!current_process) {
+        return;
+    }
+
     cli();
     schedule();
     sti();
@@ -483,13 +549,14 @@ void process_block(void)
     sti();
 }
 
+/* Safe from interrupt handlers: leaves the interrupt flag as it found it */
 void process_unblock(struct process *proc)
 {
-    cli();
+    uint64_t flags = irq_save();
 
     if (proc && proc->state == PROCESS_STATE_BLOCKED) {
         ready_queue_add(proc);
     }
 
-    sti();
+    irq_restore(flags);
 }
@@ -17,9 +17,20 @@
 #include "timer.h"
 #include "pci.h"
 #include "gpu_hal.h"
+#include "fbcon.h"
+#include "frameprof.h"
+#include "trace.h"
+#include "perf.h"
+#include "bench.h"
+#include "input.h"
 #include "usb.h"
 #include "usb_hid.h"
+#include "usb_msc.h"
+#include "xhci.h"
+#include "kinit.h"
+#include "io.h"
 #include "virtio_net.h"
+#include "netstack.h"
 #include <stdint.h>
 #include <stddef.h>
 
@@ -71,6 +82,17 @@ static int parse_args(char *cmd, char *argv[], int max_args)
     return argc;
 }
 
+/* Parse a decimal argument; returns def if it is not a number */
+static uint32_t parse_uint(const char *s, uint32_t def)
+{
+    if (!s || *s < '0' || *s > '9')
+        return def;
+    uint32_t n = 0;
+    for (; *s >= '0' && *s <= '9'; s++)
+        n = n * 10 + (uint32_t)(*s - '0');
+    return n;
+}
+
 /* Build full path from current directory and relative path */
 static void build_path(const char *relative, char *full, size_t size)
 {
@@ -160,17 +182,242 @@ static shell_result_t cmd_gpu(int argc, char *argv[])
     return SHELL_OK;
 }
 
-/* usb - Show USB device information */
+/* fbcon - Show framebuffer console stats, or benchmark output */
+static shell_result_t cmd_fbcon(int argc, char *argv[])
+{
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        uint32_t nlines = 500;
+        if (argc >= 3) {
+            nlines = 0;
+            for (const char *p = argv[2]; *p >= '0' && *p <= '9'; p++)
+                nlines = nlines * 10 + (uint32_t)(*p - '0');
+        }
+        if (fbcon_bench(nlines) != 0) {
+            kprintf("fbcon: console not active (desktop owns the framebuffer)\n");
+            return SHELL_ERR_IO;
+        }
+        return SHELL_OK;
+    }
+
+    fbcon_dump_stats();
+    return SHELL_OK;
+}
+
+/* frametime - Desktop frame-time statistics and HUD */
+static shell_result_t cmd_frametime(int argc, char *argv[])
+{
+    if (argc >= 2 && strcmp(argv[1], "hud") == 0) {
+        frameprof_set_hud(!frameprof_hud_enabled());
+        kprintf("Frame-time HUD %s\n", frameprof_hud_enabled() ? "on" : "off");
+        return SHELL_OK;
+    }
+    if (argc >= 2 && strcmp(argv[1], "reset") == 0) {
+        frameprof_reset();
+        kprintf("Frame-time history cleared\n");
+        return SHELL_OK;
+    }
+
+    frameprof_dump();
+    return SHELL_OK;
+}
+
+/* trace - Control the kernel trace ring */
+static shell_result_t cmd_trace(int argc, char *argv[])
+{
+    const char *sub = argc >= 2 ? argv[1] : "";
+
+    if (strcmp(sub, "start") == 0) {
+        trace_start();
+        kprintf("Tracing started\n");
+    } else if (strcmp(sub, "stop") == 0) {
+        trace_stop();
+        kprintf("Tracing stopped (%lu records)\n", (unsigned long)trace_count());
+    } else if (strcmp(sub, "clear") == 0) {
+        trace_clear();
+        kprintf("Trace ring cleared\n");
+    } else if (strcmp(sub, "dump") == 0) {
+        trace_dump(parse_uint(argc >= 3 ? argv[2] : NULL, 32));
+    } else if (strcmp(sub, "save") == 0) {
+        if (!shell_volume) {
+            kprintf("trace: No filesystem mounted\n");
+            return SHELL_ERR_IO;
+        }
+        char path[SHELL_CMD_MAX];
+        build_path(argc >= 3 ? argv[2] : TRACE_DEFAULT_PATH, path, sizeof(path));
+        if (trace_export(shell_volume, path) != 0) {
+            kprintf("trace: Failed to write %s\n", path);
+            return SHELL_ERR_IO;
+        }
+    } else {
+        kprintf("Trace: %s, %lu records held, %lu dropped\n",
+                trace_enabled ? "running" : "stopped",
+                (unsigned long)trace_count(), (unsigned long)trace_dropped());
+        kprintf("Usage: trace start|stop|clear|dump [n]|save [file]\n");
+    }
+    return SHELL_OK;
+}
+
+/* perf - Sampling CPU profiler */
+static shell_result_t cmd_perf(int argc, char *argv[])
+{
+    const char *sub = argc >= 2 ? argv[1] : "";
+
+    if (strcmp(sub, "start") == 0) {
+        uint32_t hz = parse_uint(argc >= 3 ? argv[2] : NULL, PERF_DEFAULT_HZ);
+        perf_reset();
+        if (perf_start(hz) != 0) {
+            kprintf("perf: Rate must be %d-%d Hz\n", PERF_MIN_HZ, PERF_MAX_HZ);
+            return SHELL_ERR_ARGS;
+        }
+        kprintf("Profiling at %u Hz\n", perf_rate());
+    } else if (strcmp(sub, "stop") == 0) {
+        perf_stop();
+        kprintf("Profiling stopped (%lu samples)\n", (unsigned long)perf_samples());
+    } else if (strcmp(sub, "reset") == 0) {
+        perf_reset();
+        kprintf("Profile cleared\n");
+    } else if (strcmp(sub, "top") == 0 || sub[0] == '\0') {
+        perf_report(parse_uint(argc >= 3 ? argv[2] : NULL, 20));
+        if (sub[0] == '\0')
+            kprintf("\nUsage: perf start [hz]|stop|reset|top [n]\n");
+    } else {
+        kprintf("Usage: perf start [hz]|stop|reset|top [n]\n");
+        return SHELL_ERR_ARGS;
+    }
+    return SHELL_OK;
+}
+
+/* bench - Kernel microbenchmarks */
+static shell_result_t cmd_bench(int argc, char *argv[])
+{
+    const char *out = NULL;
+    int groups = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "list") == 0) {
+            bench_list();
+            return SHELL_OK;
+        }
+        if (strcmp(argv[i], "-o") == 0)
+            out = i + 1 < argc ? argv[++i] : BENCH_DEFAULT_PATH;
+    }
+
+    bench_reset();
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0) {
+            i++;
+            continue;
+        }
+        groups++;
+        if (bench_run(argv[i]) < 0) {
+            kprintf("bench: Unknown group '%s' (see bench list)\n", argv[i]);
+            return SHELL_ERR_ARGS;
+        }
+    }
+    if (groups == 0)
+        bench_run(NULL);
+
+    if (out) {
+        if (!shell_volume) {
+            kprintf("bench: No filesystem mounted\n");
+            return SHELL_ERR_IO;
+        }
+        char path[SHELL_CMD_MAX];
+        build_path(out, path, sizeof(path));
+        if (bench_save(shell_volume, path) != 0) {
+            kprintf("bench: Failed to write %s\n", path);
+            return SHELL_ERR_IO;
+        }
+    }
+    return SHELL_OK;
+}
+
+/* input - Input event ring and input-to-photon latency */
+static shell_result_t cmd_input(int argc, char *argv[])
+{
+    if (argc >= 2 && strcmp(argv[1], "reset") == 0) {
+        input_reset_stats();
+        kprintf("Input statistics cleared\n");
+        return SHELL_OK;
+    }
+
+    input_dump_stats();
+    return SHELL_OK;
+}
+
+/* usb - Show USB device information, reset statistics, or benchmark the
+ * USB disk */
 static shell_result_t cmd_usb(int argc, char *argv[])
 {
-    (void)argc;
-    (void)argv;
-    if (!usb_is_initialized()) {
-        kprintf("USB: Not initialized (no UHCI controller found)\n");
+    if (argc >= 2 && strcmp(argv[1], "reset") == 0) {
+        usb_hid_reset_stats();
+        usb_msc_reset_stats();
+        kprintf("USB statistics cleared\n");
         return SHELL_OK;
     }
-    usb_dump_status();
+
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        uint64_t mb = 16;
+        if (argc >= 3) {
+            mb = 0;
+            for (const char *p = argv[2]; *p >= '0' && *p <= '9'; p++)
+                mb = mb * 10 + (uint64_t)(*p - '0');
+        }
+        if (!kinit_is_done("xhci")) {
+            kprintf("usb bench: USB probe still running\n");
+            return SHELL_OK;
+        }
+        if (!usb_msc_present()) {
+            kprintf("usb bench: no USB disk\n");
+            return SHELL_OK;
+        }
+
+        uint64_t sectors = mb * 1024 * 1024 / USB_MSC_SECTOR_SIZE;
+        if (sectors == 0 || sectors > usb_msc_sectors())
+            sectors = usb_msc_sectors();
+        uint32_t per = USB_MSC_XFER_MAX / USB_MSC_SECTOR_SIZE;
+        uint8_t *buf = kmalloc(USB_MSC_XFER_MAX);
+        if (!buf) {
+            kprintf("usb bench: out of memory\n");
+            return SHELL_OK;
+        }
+
+        uint64_t start = rdtsc();
+        for (uint64_t lba = 0; lba < sectors; lba += per) {
+            uint32_t n = (uint32_t)(sectors - lba < per ? sectors - lba : per);
+            if (usb_msc_read(lba, n, buf) != USB_MSC_OK) {
+                kprintf("usb bench: read failed at LBA %lu\n",
+                        (unsigned long)lba);
+                kfree(buf);
+                return SHELL_OK;
+            }
+        }
+        uint64_t ns = timer_tsc_to_ns(rdtsc() - start);
+        kfree(buf);
+
+        uint64_t bytes = sectors * USB_MSC_SECTOR_SIZE;
+        uint64_t kbps = ns ? bytes * 1000000ULL / ns : 0;     /* KB/s */
+        kprintf("Read %lu KB in %lu ms: %lu.%02lu MB/s\n",
+                (unsigned long)(bytes / 1024),
+                (unsigned long)(ns / 1000000),
+                (unsigned long)(kbps / 1024),
+                (unsigned long)((kbps % 1024) * 100 / 1024));
+        kprintf("(UHCI has no bulk path; its full-speed bus tops out "
+                "near 1.2 MB/s)\n");
+        usb_hid_dump_status();
+        return SHELL_OK;
+    }
+
+    if (!usb_is_initialized() && !xhci_is_initialized()) {
+        kprintf("USB: Not initialized (no UHCI or xHCI controller found)\n");
+        return SHELL_OK;
+    }
+    if (usb_is_initialized())
+        usb_dump_status();
+    if (xhci_is_initialized())
+        xhci_dump_status();
     usb_hid_dump_status();
+    usb_msc_dump_status();
     return SHELL_OK;
 }
 
@@ -587,6 +834,10 @@ static shell_result_t cmd_disk(int argc, char *argv[])
     (void)argv;
 
     kprintf("Disk Information:\n");
+    if (!kinit_is_done("ata")) {
+        kprintf("  ATA probe still running\n");
+        return SHELL_OK;
+    }
 
     const ata_drive_t *drive0 = ata_get_drive(0);
     const ata_drive_t *drive1 = ata_get_drive(1);
@@ -616,11 +867,38 @@ static shell_result_t cmd_disk(int argc, char *argv[])
     return SHELL_OK;
 }
 
-/* gov - Show Governor statistics */
+/* gov - Show Governor statistics, or time repeated policy checks */
 static shell_result_t cmd_gov(int argc, char *argv[])
 {
-    (void)argc;
-    (void)argv;
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        uint32_t n = 100000;
+        if (argc >= 3) {
+            n = 0;
+            for (const char *p = argv[2]; *p >= '0' && *p <= '9'; p++)
+                n = n * 10 + (uint32_t)(*p - '0');
+        }
+        if (n == 0)
+            n = 1;
+
+        /* The same check every GeoFS overwrite of this path makes */
+        struct gov_stats before, after;
+        governor_get_stats(&before);
+        uint64_t start = rdtsc();
+        for (uint32_t i = 0; i < n; i++)
+            governor_check_filesystem(POLICY_FS_OVERWRITE, "/bench/gov",
+                                      GOV_CAP_KERNEL, NULL);
+        uint64_t wall = rdtsc() - start;
+        governor_get_stats(&after);
+
+        uint64_t cycles = after.check_cycles - before.check_cycles;
+        uint64_t hits = after.cache_hits - before.cache_hits;
+        kprintf("%u overwrite checks: %lu cycles (%lu ns) each, "
+                "%lu%% cache hits\n", n,
+                (unsigned long)(cycles / n),
+                (unsigned long)(timer_tsc_to_ns(wall) / n),
+                (unsigned long)(hits * 100 / n));
+        return SHELL_OK;
+    }
 
     kprintf("Governor Statistics:\n");
     governor_dump_stats();
@@ -651,6 +929,15 @@ static shell_result_t cmd_uptime(int argc, char *argv[])
     return SHELL_OK;
 }
 
+/* boot - Show the boot timeline */
+static shell_result_t cmd_boot(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    kinit_dump_timeline();
+    return SHELL_OK;
+}
+
 /*============================================================================
  * Extended Filesystem Commands
  *============================================================================*/
@@ -1049,8 +1336,8 @@ static shell_result_t cmd_export(int argc, char *argv[])
         return SHELL_OK;
     }
     if (argc < 3) {
-        kprintf("Usage: export <file> <sector>\n");
-        kprintf("  Writes file to ATA drive 0 starting at sector\n");
+        kprintf("Usage: export <file> <sector> [usb]\n");
+        kprintf("  Writes file to ATA drive 0 (or the USB disk) starting at sector\n");
         return SHELL_OK;
     }
 
@@ -1061,14 +1348,18 @@ static shell_result_t cmd_export(int argc, char *argv[])
     for (const char *p = argv[2]; *p >= '0' && *p <= '9'; p++)
         sector = sector * 10 + (uint64_t)(*p - '0');
 
+    int usb = argc >= 4 && strcmp(argv[3], "usb") == 0;
+    uint8_t drive = usb ? KGEOFS_DRIVE_USB : 0;
+
     uint64_t written = 0;
-    kgeofs_error_t err = kgeofs_file_export_ata(shell_volume, full, 0,
+    kgeofs_error_t err = kgeofs_file_export_ata(shell_volume, full, drive,
                                                  sector, &written);
     if (err != KGEOFS_OK) {
         kprintf("export: %s\n", kgeofs_strerror(err));
     } else {
-        kprintf("Exported %s -> ATA sector %lu (%lu sectors)\n",
-                full, (unsigned long)sector, (unsigned long)written);
+        kprintf("Exported %s -> %s sector %lu (%lu sectors)\n",
+                full, usb ? "USB" : "ATA", (unsigned long)sector,
+                (unsigned long)written);
     }
     return SHELL_OK;
 }
@@ -1081,8 +1372,8 @@ static shell_result_t cmd_import(int argc, char *argv[])
         return SHELL_OK;
     }
     if (argc < 4) {
-        kprintf("Usage: import <file> <sector> <count>\n");
-        kprintf("  Reads <count> sectors from ATA drive 0\n");
+        kprintf("Usage: import <file> <sector> <count> [usb]\n");
+        kprintf("  Reads <count> sectors from ATA drive 0 (or the USB disk)\n");
         return SHELL_OK;
     }
 
@@ -1095,13 +1386,17 @@ static shell_result_t cmd_import(int argc, char *argv[])
     for (const char *p = argv[3]; *p >= '0' && *p <= '9'; p++)
         count = count * 10 + (uint64_t)(*p - '0');
 
-    kgeofs_error_t err = kgeofs_file_import_ata(shell_volume, full, 0,
+    int usb = argc >= 5 && strcmp(argv[4], "usb") == 0;
+    uint8_t drive = usb ? KGEOFS_DRIVE_USB : 0;
+
+    kgeofs_error_t err = kgeofs_file_import_ata(shell_volume, full, drive,
                                                  sector, count);
     if (err != KGEOFS_OK) {
         kprintf("import: %s\n", kgeofs_strerror(err));
     } else {
-        kprintf("Imported ATA sector %lu (%lu sectors) -> %s\n",
-                (unsigned long)sector, (unsigned long)count, full);
+        kprintf("Imported %s sector %lu (%lu sectors) -> %s\n",
+                usb ? "USB" : "ATA", (unsigned long)sector,
+                (unsigned long)count, full);
     }
     return SHELL_OK;
 }
@@ -1413,6 +1708,7 @@ static shell_result_t cmd_net(int argc, char *argv[])
     (void)argc;
     (void)argv;
     virtio_net_dump_info();
+    net_dump_stats();
     return SHELL_OK;
 }
 
@@ -1444,10 +1740,28 @@ static shell_result_t cmd_ping(int argc, char *argv[])
 
     uint32_t target_ip = 0x0A000202;  /* 10.0.2.2 */
     const char *target_str = "10.0.2.2";
+    int flood = argc >= 2 && strcmp(argv[1], "-f") == 0;
 
-    if (argc >= 2) {
-        target_ip = parse_ip(argv[1]);
-        target_str = argv[1];
+    if (argc >= 2 + flood) {
+        target_ip = parse_ip(argv[1 + flood]);
+        target_str = argv[1 + flood];
+    }
+
+    if (flood) {
+        /* Batched echo requests, replies counted as fast as they come */
+        uint32_t count = parse_uint(argc >= 4 ? argv[3] : NULL, 10000);
+        struct vnet_flood_result res;
+        kprintf("PING flood %s: %u requests\n", target_str, count);
+        if (virtio_net_ping_flood(target_ip, count, &res) != 0) {
+            kprintf("  cannot reach %s\n", target_str);
+            return SHELL_ERR_IO;
+        }
+        uint64_t pps = res.elapsed_us ?
+                       (uint64_t)res.received * 1000000 / res.elapsed_us : 0;
+        kprintf("--- %u sent, %u received in %lu ms: %lu replies/s ---\n",
+                res.sent, res.received,
+                (unsigned long)(res.elapsed_us / 1000), (unsigned long)pps);
+        return SHELL_OK;
     }
 
     kprintf("PING %s:\n", target_str);
@@ -1479,6 +1793,101 @@ static shell_result_t cmd_ping(int argc, char *argv[])
     return SHELL_OK;
 }
 
+/* Let the receive task run (or the desktop-loop poll) while waiting */
+static void nc_wait(void)
+{
+    virtio_net_poll();
+    net_poll();
+    if (sched_has_ready())
+        sched_yield();
+    else
+        __asm__ volatile("hlt");
+}
+
+/*
+ * Stream data to a TCP listener and report throughput, e.g. against
+ * "nc -l 5001 > /dev/null" on the host (10.0.2.2 under QEMU user net).
+ */
+static shell_result_t cmd_nc(int argc, char *argv[])
+{
+    if (argc < 3) {
+        kprintf("Usage: nc <ip> <port> [kb]\n");
+        return SHELL_ERR_ARGS;
+    }
+    if (!virtio_net_available()) {
+        kprintf("Network not available\n");
+        return SHELL_ERR_IO;
+    }
+
+    uint32_t ip = parse_ip(argv[1]);
+    uint16_t port = (uint16_t)parse_uint(argv[2], 0);
+    uint64_t total = (uint64_t)parse_uint(argc >= 4 ? argv[3] : NULL, 4096) * 1024;
+
+    int sock = net_tcp_connect(ip, port);
+    if (sock < 0) {
+        kprintf("nc: connect failed (%d)\n", sock);
+        return SHELL_ERR_IO;
+    }
+
+    int status = NET_TCP_CONNECTING;
+    uint64_t deadline = timer_get_ms() + 5000;
+    while ((status = net_tcp_status(sock)) == NET_TCP_CONNECTING &&
+           timer_get_ms() < deadline)
+        nc_wait();
+    if (status != NET_TCP_CONNECTED) {
+        kprintf("nc: %s:%u %s\n", argv[1], port,
+                status == NET_ERR_RESET ? "refused" : "timed out");
+        net_close(sock);
+        return SHELL_ERR_IO;
+    }
+
+    static uint8_t chunk[NET_TCP_MSS * 4];
+    for (uint32_t i = 0; i < sizeof(chunk); i++)
+        chunk[i] = (uint8_t)('a' + i % 26);
+
+    uint64_t sent = 0;
+    uint64_t start = rdtsc();
+    uint64_t last_progress = timer_get_ms();
+    int err = 0;
+
+    /* Done once everything is queued and acknowledged */
+    while (sent < total || net_tcp_unacked(sock)) {
+        uint32_t want = total - sent < sizeof(chunk) ?
+                        (uint32_t)(total - sent) : sizeof(chunk);
+        int n = want ? net_tcp_send(sock, chunk, want) : NET_ERR_WOULDBLOCK;
+        if (n > 0) {
+            sent += (uint32_t)n;
+            last_progress = timer_get_ms();
+            continue;
+        }
+        if (n != NET_ERR_WOULDBLOCK) {
+            err = n;
+            break;
+        }
+        if (timer_get_ms() - last_progress > 10000) {
+            err = NET_ERR_WOULDBLOCK;
+            break;
+        }
+        nc_wait();
+    }
+
+    uint64_t us = timer_tsc_to_ns(rdtsc() - start) / 1000;
+    net_close(sock);
+
+    if (err) {
+        kprintf("nc: %s after %lu bytes\n",
+                err == NET_ERR_RESET ? "connection reset" : "stalled",
+                (unsigned long)sent);
+        return SHELL_ERR_IO;
+    }
+
+    uint64_t kbps = us ? (sent * 1000000 / us) / 1024 : 0;
+    kprintf("%lu KB in %lu.%03lu s: %lu KB/s\n",
+            (unsigned long)(sent / 1024), (unsigned long)(us / 1000000),
+            (unsigned long)(us / 1000 % 1000), (unsigned long)kbps);
+    return SHELL_OK;
+}
+
 static const shell_cmd_t commands[] = {
     /* Filesystem commands */
     { "ls",       cmd_ls,       "List directory contents" },
@@ -1511,8 +1920,8 @@ static const shell_cmd_t commands[] = {
     { "merge",    cmd_merge,    "Merge branch into current" },
 
     /* Import/Export */
-    { "export",   cmd_export,   "Export file to ATA disk" },
-    { "import",   cmd_import,   "Import file from ATA disk" },
+    { "export",   cmd_export,   "Export file to ATA or USB disk" },
+    { "import",   cmd_import,   "Import file from ATA or USB disk" },
 
     /* Volume Persistence */
     { "save",     cmd_save,     "Save volume to ATA disk" },
@@ -1531,19 +1940,27 @@ static const shell_cmd_t commands[] = {
     { "clear",    cmd_clear,    "Clear screen" },
     { "mem",      cmd_mem,      "Show memory statistics" },
     { "disk",     cmd_disk,     "Show disk information" },
-    { "gov",      cmd_gov,      "Show Governor statistics" },
+    { "gov",      cmd_gov,      "Governor statistics (gov bench [n])" },
     { "uptime",   cmd_uptime,   "Show system uptime" },
+    { "boot",     cmd_boot,     "Show boot timeline" },
     { "echo",     cmd_echo,     "Echo text" },
     { "exit",     cmd_exit,     "Exit shell" },
 
     /* Hardware */
     { "lspci",    cmd_lspci,    "List PCI devices" },
     { "gpu",      cmd_gpu,      "Show GPU info and stats" },
-    { "usb",      cmd_usb,      "Show USB device info" },
+    { "fbcon",    cmd_fbcon,    "Console stats (fbcon bench [lines])" },
+    { "frametime", cmd_frametime, "Frame times (frametime hud|reset)" },
+    { "trace",    cmd_trace,    "Event trace (start|stop|dump|save)" },
+    { "perf",     cmd_perf,     "CPU profiler (start|stop|top)" },
+    { "bench",    cmd_bench,    "Microbenchmarks (bench [list|group...] [-o file])" },
+    { "input",    cmd_input,    "Input events and latency (input reset)" },
+    { "usb",      cmd_usb,      "USB devices (usb [reset|bench [mb]])" },
 
     /* Network */
     { "net",      cmd_net,      "Show network info" },
-    { "ping",     cmd_ping,     "Ping gateway (or IP)" },
+    { "ping",     cmd_ping,     "Ping gateway (or IP); -f <ip> [n] floods" },
+    { "nc",       cmd_nc,       "Send KB over TCP, report throughput" },
 
     { NULL, NULL, NULL }  /* Sentinel */
 };
@@ -1619,14 +2036,18 @@ void shell_help(void)
     kprintf("\nHardware:\n");
     for (const shell_cmd_t *cmd = commands; cmd->name; cmd++) {
         if (strcmp(cmd->name, "lspci") == 0 || strcmp(cmd->name, "gpu") == 0 ||
-            strcmp(cmd->name, "usb") == 0) {
+            strcmp(cmd->name, "fbcon") == 0 || strcmp(cmd->name, "usb") == 0 ||
+            strcmp(cmd->name, "frametime") == 0 || strcmp(cmd->name, "trace") == 0 ||
+            strcmp(cmd->name, "perf") == 0 || strcmp(cmd->name, "input") == 0 ||
+            strcmp(cmd->name, "bench") == 0) {
             kprintf("  %-10s %s\n", cmd->name, cmd->description);
         }
     }
 
     kprintf("\nNetwork:\n");
     for (const shell_cmd_t *cmd = commands; cmd->name; cmd++) {
-        if (strcmp(cmd->name, "net") == 0 || strcmp(cmd->name, "ping") == 0) {
+        if (strcmp(cmd->name, "net") == 0 || strcmp(cmd->name, "ping") == 0 ||
+            strcmp(cmd->name, "nc") == 0) {
             kprintf("  %-10s %s\n", cmd->name, cmd->description);
         }
     }
@@ -1636,6 +2057,7 @@ void shell_help(void)
         if (strcmp(cmd->name, "help") == 0 || strcmp(cmd->name, "clear") == 0 ||
             strcmp(cmd->name, "mem") == 0 || strcmp(cmd->name, "disk") == 0 ||
             strcmp(cmd->name, "gov") == 0 || strcmp(cmd->name, "uptime") == 0 ||
+            strcmp(cmd->name, "boot") == 0 ||
             strcmp(cmd->name, "echo") == 0 || strcmp(cmd->name, "exit") == 0) {
             kprintf("  %-10s %s\n", cmd->name, cmd->description);
         }
@@ -0,0 +1,1102 @@
+/*
+ * GeoFS Volume Test Suite
+ *
+ * Exercises the hosted GeoFS library (../geofs.c): content dedup, ref
+ * versions across views, persistence across reopen, mapped content views,
+ * small-object packing, concurrent writers, recovery after a crash or torn
+ * write, async I/O, compression and chunk manifests. Ends with throughput benchmarks: multi-threaded
+ * reads and writes, small stores under each sync policy, and bulk import.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include "../geofs.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("Testing: %s... ", name)
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define VOLUME_MB       256
+#define WRITER_THREADS  8
+#define WRITER_OBJECTS  500
+
+#define BENCH_OBJECTS   2000
+#define BENCH_SIZE      8192
+#define BENCH_OPS       4000            /* Per run, split across threads */
+#define SMALL_SIZE      256             /* About one IPC message */
+#define SMALL_OPS       20000
+#define SMALL_SYNC_OPS  2000            /* Per-op sync runs */
+#define CRASH_OBJECTS   40
+#define PACK_OBJECTS    2000
+#define PACK_SIZE       200             /* A typical IPC message or event */
+#define ASYNC_OBJECTS   48              /* Every third one written directly */
+#define IMPORT_OBJECTS  256
+#define IMPORT_SIZE     (256 * 1024)
+#define TEXT_OBJECTS    4               /* Packed, one block run, two large */
+#define CHUNK_SIZE      100000
+
+static char vol_path[64];
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static geofs_volume_t *fresh_volume(void)
+{
+    geofs_volume_t *vol;
+    unlink(vol_path);
+    if (geofs_volume_create(vol_path, VOLUME_MB, &vol) != GEOFS_OK)
+        return NULL;
+    return vol;
+}
+
+/* Deterministic object contents: tag selects the object, size its length */
+static void fill_object(uint8_t *buf, size_t size, uint32_t tag)
+{
+    uint32_t x = tag * 2654435761u + 1;
+    for (size_t i = 0; i < size; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        buf[i] = (uint8_t)x;
+    }
+}
+
+static int read_equals(geofs_volume_t *vol, const geofs_hash_t hash,
+                       const void *expect, size_t size)
+{
+    uint8_t *buf = malloc(size + 1);
+    size_t got = 0;
+    int ok = buf && geofs_content_read(vol, hash, buf, size + 1, &got) == GEOFS_OK &&
+             got == size && memcmp(buf, expect, size) == 0;
+    free(buf);
+    return ok;
+}
+
+/* Flip the first byte of object tag where it sits in the volume file */
+static int corrupt_object(uint32_t tag, size_t size)
+{
+    uint8_t *want = malloc(size);
+    fill_object(want, size, tag);
+
+    int fd = open(vol_path, O_RDWR);
+    if (fd < 0) { free(want); return 0; }
+    size_t len = 4 * 1024 * 1024;
+    uint8_t *buf = malloc(len);
+    ssize_t got = pread(fd, buf, len, 0);
+    uint8_t *at = got > 0 ? memmem(buf, (size_t)got, want, size) : NULL;
+    int done = 0;
+    if (at) {
+        off_t off = at - buf;
+        buf[off] ^= 0xFF;
+        done = pwrite(fd, buf + off, 1, off) == 1;
+    }
+    free(buf);
+    free(want);
+    close(fd);
+    return done;
+}
+
+/* ══════════════════════════════════════════════════════════════════════════════
+ * FUNCTIONAL TESTS
+ * ══════════════════════════════════════════════════════════════════════════════ */
+
+void test_content_roundtrip(void)
+{
+    TEST("content store/read and dedup");
+
+    geofs_volume_t *vol = fresh_volume();
+    if (!vol) { FAIL("create volume"); return; }
+
+    uint8_t data[10000];
+    fill_object(data, sizeof(data), 1);
+
+    geofs_hash_t h1, h2;
+    if (geofs_content_store(vol, data, sizeof(data), h1) != GEOFS_OK ||
+        geofs_content_store(vol, data, sizeof(data), h2) != GEOFS_OK) {
+        FAIL("store");
+        geofs_volume_close(vol);
+        return;
+    }
+
+    struct geofs_index_stats st;
+    geofs_index_stats(vol, &st);
+    if (memcmp(h1, h2, GEOFS_HASH_SIZE) != 0 || st.content_entries != 1) {
+        FAIL("duplicate content stored twice");
+    } else if (!read_equals(vol, h1, data, sizeof(data))) {
+        FAIL("read back differs");
+    } else {
+        PASS();
+    }
+    geofs_volume_close(vol);
+}
+
+void test_ref_versions(void)
+{
+    TEST("ref versions, hide and reopen");
+
+    geofs_volume_t *vol = fresh_volume();
+    if (!vol) { FAIL("create volume"); return; }
+
+    geofs_hash_t v1, v2, got;
+    geofs_content_store(vol, "first", 5, v1);
+    geofs_content_store(vol, "second", 6, v2);
+    geofs_ref_create(vol, "/doc", v1);
+    geofs_ref_create(vol, "/doc", v2);
+
+    if (geofs_ref_resolve(vol, "/doc", got) != GEOFS_OK ||
+        memcmp(got, v2, GEOFS_HASH_SIZE) != 0) {
+        FAIL("latest version not resolved");
+        geofs_volume_close(vol);
+        return;
+    }
+
+    geofs_view_t genesis = geofs_view_current(vol);
+    if (geofs_view_hide(vol, "/doc") != GEOFS_OK ||
+        geofs_ref_resolve(vol, "/doc", got) != GEOFS_ERR_NOTFOUND) {
+        FAIL("hidden ref still resolves");
+        geofs_volume_close(vol);
+        return;
+    }
+    geofs_volume_close(vol);
+
+    if (geofs_volume_open(vol_path, &vol) != GEOFS_OK) {
+        FAIL("reopen");
+        return;
+    }
+    int ok = geofs_ref_resolve(vol, "/doc", got) == GEOFS_ERR_NOTFOUND &&
+             geofs_view_switch(vol, genesis) == GEOFS_OK &&
+             geofs_ref_resolve(vol, "/doc", got) == GEOFS_OK &&
+             memcmp(got, v2, GEOFS_HASH_SIZE) == 0 &&
+             read_equals(vol, got, "second", 6);
+    geofs_volume_close(vol);
+
+    if (ok) PASS();
+    else FAIL("history lost across reopen");
+}
+
+void test_content_map(void)
+{
+    TEST("content map views");
+
+    geofs_volume_t *vol = fresh_volume();
+    if (!vol) { FAIL("create volume"); return; }
+
+    uint8_t data[20000];
+    fill_object(data, sizeof(data), 2);
+    geofs_hash_t h1, h2;
+    geofs_content_store(vol, data, sizeof(data), h1);
+
+    /* Unmapped volume: the view is a private copy */
+    struct geofs_content_view copy;
+    if (geofs_content_map(vol, h1, &copy) != GEOFS_OK ||
+        copy.size != sizeof(data) || memcmp(copy.data, data, sizeof(data)) != 0) {
+        FAIL("copied view differs");
+        geofs_volume_close(vol);
+        return;
+    }
+
+    /* Mapped volume: content stored before and after mapping is visible */
+    struct geofs_content_view before, after;
+    if (geofs_volume_map(vol) != GEOFS_OK) {
+        FAIL("map volume");
+        geofs_content_unmap(&copy);
+        geofs_volume_close(vol);
+        return;
+    }
+    geofs_content_store(vol, "after the mapping", 17, h2);
+    int ok = geofs_content_map(vol, h1, &before) == GEOFS_OK &&
+             geofs_content_map(vol, h2, &after) == GEOFS_OK &&
+             before.size == sizeof(data) &&
+             memcmp(before.data, data, sizeof(data)) == 0 &&
+             after.size == 17 && memcmp(after.data, "after the mapping", 17) == 0;
+
+    /* Views stay readable after the volume is closed */
+    geofs_volume_close(vol);
+    ok = ok && memcmp(before.data, data, sizeof(data)) == 0 &&
+         memcmp(copy.data, data, sizeof(data)) == 0;
+    geofs_content_unmap(&before);
+    geofs_content_unmap(&after);
+    geofs_content_unmap(&copy);
+    geofs_content_unmap(&copy);         /* Cleared view: no-op */
+
+    if (ok) PASS();
+    else FAIL("mapped view differs");
+}
+
+struct writer_arg {
+    geofs_volume_t *vol;
+    int             id;
+    int             errors;
+};
+
+static void *writer_thread(void *p)
+{
+    struct writer_arg *a = p;
+    uint8_t buf[6000];
+    char path[64];
+
+    for (int i = 0; i < WRITER_OBJECTS; i++) {
+        uint32_t tag = (uint32_t)(a->id * WRITER_OBJECTS + i);
+        size_t size = 100 + tag % 5900;
+        geofs_hash_t hash;
+        fill_object(buf, size, tag);
+        snprintf(path, sizeof(path), "/w%d/obj%d", a->id, i);
+        if (geofs_content_store(a->vol, buf, size, hash) != GEOFS_OK ||
+            geofs_ref_create(a->vol, path, hash) != GEOFS_OK)
+            a->errors++;
+    }
+    return NULL;
+}
+
+static int verify_writers(geofs_volume_t *vol)
+{
+    uint8_t buf[6000];
+    char path[64];
+
+    for (int t = 0; t < WRITER_THREADS; t++) {
+        for (int i = 0; i < WRITER_OBJECTS; i++) {
+            uint32_t tag = (uint32_t)(t * WRITER_OBJECTS + i);
+            size_t size = 100 + tag % 5900;
+            geofs_hash_t hash;
+            fill_object(buf, size, tag);
+            snprintf(path, sizeof(path), "/w%d/obj%d", t, i);
+            if (geofs_ref_resolve(vol, path, hash) != GEOFS_OK ||
+                !read_equals(vol, hash, buf, size))
+                return 0;
+        }
+    }
+    return 1;
+}
+
+void test_concurrent_writers(void)
+{
+    TEST("concurrent writers");
+
+    geofs_volume_t *vol = fresh_volume();
+    if (!vol) { FAIL("create volume"); return; }
+
+    pthread_t threads[WRITER_THREADS];
+    struct writer_arg args[WRITER_THREADS];
+    for (int t = 0; t < WRITER_THREADS; t++) {
+        args[t] = (struct writer_arg){ vol, t, 0 };
+        pthread_create(&threads[t], NULL, writer_thread, &args[t]);
+    }
+    int errors = 0;
+    for (int t = 0; t < WRITER_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+        errors += args[t].errors;
+    }
+
+    if (errors) {
+        FAIL("store or ref_create failed");
+        geofs_volume_close(vol);
+        return;
+    }
+    if (!verify_writers(vol)) {
+        FAIL("object missing or corrupt");
+        geofs_volume_close(vol);
+        return;
+    }
+    geofs_volume_close(vol);
+
+    if (geofs_volume_open(vol_path, &vol) != GEOFS_OK) {
+        FAIL("reopen");
+        return;
+    }
+    int ok = verify_writers(vol);
+    geofs_volume_close(vol);
+
+    if (ok) PASS();
+    else FAIL("object missing after reopen");
+}
+
+/* Small objects share blocks; a large one every 100 closes the pack */
+static size_t pack_size(uint32_t i)
+{
+    return i % 100 == 99 ? 20000 : PACK_SIZE + i % 7;
+}
+
+void test_small_packing(void)
+{
+    TEST("small objects packed");
+
+    geofs_volume_t *vol = fresh_volume();
+    if (!vol) { FAIL("create volume"); return; }
+
+    static geofs_hash_t hashes[PACK_OBJECTS];
+    uint8_t buf[20000];
+    uint64_t logical = 0;
+    int ok = 1;
+    for (uint32_t i = 0; i < PACK_OBJECTS; i++) {
+        fill_object(buf, pack_size(i), 7000 + i);
+        ok &= geofs_content_store(vol, buf, pack_size(i), hashes[i]) == GEOFS_OK;
+        logical += pack_size(i);
+    }
+
+    struct geofs_space_stats sp;
+    geofs_space_stats(vol, &sp);
+    ok &= sp.objects == PACK_OBJECTS && sp.packed_objects == PACK_OBJECTS - PACK_OBJECTS / 100 &&
+          sp.logical_bytes == logical;
+    /* The 20 KB objects alone cost 1.4x with their header block and padding */
+    if (!ok || sp.amplification > 1.5) {
+        FAIL("objects not packed");
+        geofs_volume_close(vol);
+        return;
+    }
+
+    for (uint32_t i = 0; i < PACK_OBJECTS; i++) {
+        fill_object(buf, pack_size(i), 7000 + i);
+        ok &= read_equals(vol, hashes[i], buf, pack_size(i));
+    }
+    geofs_volume_close(vol);
+    if (!ok) { FAIL("read back differs"); return; }
+
+    /* A packed object whose own checksum fails is dropped on reopen */
+    if (!corrupt_object(7000 + 5, pack_size(5))) { FAIL("object not found in volume file"); return; }
+    if (geofs_volume_open(vol_path, &vol) != GEOFS_OK) { FAIL("reopen"); return; }
+    struct geofs_space_stats reopened;
+    geofs_space_stats(vol, &reopened);
+    for (uint32_t i = 0; i < PACK_OBJECTS; i++) {
+        fill_object(buf, pack_size(i), 7000 + i);
+        uint64_t size;
+        if (i == 5) ok &= geofs_content_size(vol, hashes[i], &size) == GEOFS_ERR_NOTFOUND;
+        else ok &= read_equals(vol, hashes[i], buf, pack_size(i));
+    }
+    /* Close flushed the staged segment, adding its trailer */
+    ok &= reopened.objects == PACK_OBJECTS - 1 &&
+          reopened.packed_objects == sp.packed_objects - 1 &&
+          reopened.physical_bytes == sp.physical_bytes + GEOFS_BLOCK_SIZE;
+    geofs_volume_close(vol);
+
+    if (ok) PASS();
+    else FAIL("packed objects lost or corrupt one indexed");
+}
+
+/* Store object tag under "/<dir>/<tag>" */
+static int store_tagged(geofs_volume_t *vol, const char *dir, uint32_t tag)
+{
+    uint8_t buf[SMALL_SIZE];
+    char path[64];
+    geofs_hash_t hash;
+    fill_object(buf, sizeof(buf), tag);
+    snprintf(path, sizeof(path), "/%s/%u", dir, tag);
+    return geofs_content_store(vol, buf, sizeof(buf), hash) == GEOFS_OK &&
+           geofs_ref_create(vol, path, hash) == GEOFS_OK;
+}
+
+/* 1 if "/<dir>/<tag>" resolves to its content, 0 if it is gone, -1 if the
+ * ref survived but its content did not */
+static int check_tagged(geofs_volume_t *vol, const char *dir, uint32_t tag)
+{
+    uint8_t buf[SMALL_SIZE];
+    char path[64];
+    geofs_hash_t hash;
+    fill_object(buf, sizeof(buf), tag);
+    snprintf(path, sizeof(path), "/%s/%u", dir, tag);
+    if (geofs_ref_resolve(vol, path, hash) != GEOFS_OK) return 0;
+    return read_equals(vol, hash, buf, sizeof(buf)) ? 1 : -1;
+}
+
+/* Run fn in a child that exits without closing its volume */
+static int run_crashed(void (*fn)(void))
+{
+    pid_t pid = fork();
+    if (pid == 0) {
+        fn();
+        _exit(0);
+    }
+    int status;
+    return pid > 0 && waitpid(pid, &status, 0) == pid &&
+           WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void crash_per_op(void)
+{
+    geofs_volume_t *vol = fresh_volume();
+    if (!vol || geofs_volume_set_sync(vol, GEOFS_SYNC_PER_OP, 0) != GEOFS_OK) _exit(1);
+    for (uint32_t i = 0; i < CRASH_OBJECTS; i++)
+        if (!store_tagged(vol, "synced", i)) _exit(1);
+
+    /* Staged but never flushed: lost with the process */
+    geofs_volume_set_sync(vol, GEOFS_SYNC_ON_CLOSE, 0);
+    for (uint32_t i = 0; i < CRASH_OBJECTS; i++)
+        if (!store_tagged(vol, "staged", i)) _exit(1);
+}
+
+void test_crash_recovery(void)
+{
+    TEST("recovery without close");
+
+    if (!run_crashed(crash_per_op)) { FAIL("writer failed"); return; }
+
+    geofs_volume_t *vol;
+    if (geofs_volume_open(vol_path, &vol) != GEOFS_OK) { FAIL("reopen"); return; }
+    int ok = 1;
+    for (uint32_t i = 0; i < CRASH_OBJECTS; i++) {
+        ok &= check_tagged(vol, "synced", i) == 1;
+        ok &= check_tagged(vol, "staged", i) == 0;
+    }
+    geofs_volume_close(vol);
+
+    if (ok) PASS();
+    else FAIL("synced writes lost or unsynced writes resurrected");
+}
+
+/* A synced segment, then one flushed past the superblock but never synced */
+static void crash_unsynced_segment(void)
+{
+    geofs_volume_t *vol = fresh_volume();
+    if (!vol) _exit(1);
+    for (uint32_t i = 0; i < CRASH_OBJECTS; i++)
+        if (!store_tagged(vol, "a", i)) _exit(1);
+    if (geofs_volume_sync(vol) != GEOFS_OK) _exit(1);
+
+    for (uint32_t i = 0; i < CRASH_OBJECTS; i++)
+        if (!store_tagged(vol, "b", 1000 + i)) _exit(1);
+    if (check_tagged(vol, "b", 1000) != 1) _exit(1);    /* Read flushes */
+}
+
+/* Flip one byte of the first "b" object in the volume file */
+void test_torn_segment(void)
+{
+    TEST("unsynced segment checked by trailer");
+
+    if (!run_crashed(crash_unsynced_segment)) { FAIL("writer failed"); return; }
+    geofs_volume_t *vol;
+    if (geofs_volume_open(vol_path, &vol) != GEOFS_OK) { FAIL("reopen"); return; }
+    int ok = 1;
+    for (uint32_t i = 0; i < CRASH_OBJECTS; i++) {
+        ok &= check_tagged(vol, "a", i) == 1;
+        ok &= check_tagged(vol, "b", 1000 + i) == 1;
+    }
+    geofs_volume_close(vol);
+    if (!ok) { FAIL("intact segment not recovered"); return; }
+
+    /* Same again, but the second segment's data doesn't match its trailer */
+    if (!run_crashed(crash_unsynced_segment)) { FAIL("writer failed"); return; }
+    if (!corrupt_object(1000, SMALL_SIZE)) { FAIL("object not found in volume file"); return; }
+    if (geofs_volume_open(vol_path, &vol) != GEOFS_OK) { FAIL("reopen"); return; }
+    for (uint32_t i = 0; i < CRASH_OBJECTS; i++) {
+        ok &= check_tagged(vol, "a", i) == 1;
+        ok &= check_tagged(vol, "b", 1000 + i) != 1;
+    }
+
+    /* New writes replace the torn segment and survive a reopen */
+    ok &= store_tagged(vol, "c", 7);
+    geofs_volume_close(vol);
+    if (geofs_volume_open(vol_path, &vol) != GEOFS_OK) { FAIL("reopen"); return; }
+    ok &= check_tagged(vol, "a", 0) == 1 && check_tagged(vol, "c", 7) == 1;
+    geofs_volume_close(vol);
+
+    if (ok) PASS();
+    else FAIL("torn segment indexed or later writes lost");
+}
+
+/* ══════════════════════════════════════════════════════════════════════════════
+ * ASYNCHRONOUS OPERATIONS
+ * ══════════════════════════════════════════════════════════════════════════════ */
+
+struct async_slot {
+    geofs_hash_t    hash;
+    size_t          size;
+    geofs_error_t   err;
+    int             calls;
+};
+
+static uint8_t *async_objects[ASYNC_OBJECTS];
+
+static void async_record(geofs_error_t err, const geofs_hash_t hash, size_t size, void *ctx)
+{
+    struct async_slot *s = ctx;
+    memcpy(s->hash, hash, GEOFS_HASH_SIZE);
+    s->size = size;
+    s->err = err;
+    s->calls++;
+}
+
+/* Large enough for a direct write every third object, staged otherwise */
+static size_t async_size(uint32_t i)
+{
+    return i % 3 == 0 ? 200 * 1024 + i * 7 : 3000 + i;
+}
+
+static int async_slot_ok(const struct async_slot *s, size_t size)
+{
+    return s->calls == 1 && s->err == GEOFS_OK && s->size == size;
+}
+
+/* Store everything and sync it, all asynchronously, then exit unclosed */
+static void crash_async(void)
+{
+    geofs_volume_t *vol = fresh_volume();
+    if (!vol) _exit(1);
+    struct async_slot slots[ASYNC_OBJECTS + 1];
+    memset(slots, 0, sizeof(slots));
+    for (uint32_t i = 0; i < ASYNC_OBJECTS; i++) {
+        if (geofs_content_store_async(vol, async_objects[i], async_size(i),
+                                      async_record, &slots[i]) != GEOFS_OK)
+            _exit(1);
+    }
+    if (geofs_volume_sync_async(vol, async_record, &slots[ASYNC_OBJECTS]) != GEOFS_OK ||
+        geofs_async_drain(vol) != GEOFS_OK)
+        _exit(1);
+    for (uint32_t i = 0; i <= ASYNC_OBJECTS; i++) {
+        if (slots[i].calls != 1 || slots[i].err != GEOFS_OK) _exit(1);
+    }
+}
+
+static void async_backend_run(int blocking)
+{
+    if (blocking) setenv("GEOFS_NO_IO_URING", "1", 1);
+    else unsetenv("GEOFS_NO_IO_URING");
+
+    geofs_volume_t *vol = fresh_volume();
+    if (!vol) { FAIL("create volume"); return; }
+    char name[64];
+    snprintf(name, sizeof(name), "async store/read/sync (%s)", geofs_async_backend(vol));
+    TEST(name);
+
+    struct async_slot stores[ASYNC_OBJECTS + 1], reads[ASYNC_OBJECTS];
+    memset(stores, 0, sizeof(stores));
+    memset(reads, 0, sizeof(reads));
+    int ok = 1;
+    for (uint32_t i = 0; i < ASYNC_OBJECTS; i++) {
+        ok &= geofs_content_store_async(vol, async_objects[i], async_size(i),
+                                        async_record, &stores[i]) == GEOFS_OK;
+    }
+    /* A duplicate completes without being written again */
+    ok &= geofs_content_store_async(vol, async_objects[0], async_size(0),
+                                    async_record, &stores[ASYNC_OBJECTS]) == GEOFS_OK;
+    ok &= geofs_async_drain(vol) == GEOFS_OK && geofs_async_pending(vol) == 0;
+    if (!ok) { FAIL("submit or drain"); geofs_volume_close(vol); return; }
+
+    /* Same hashes as the blocking path, which finds them all already there */
+    for (uint32_t i = 0; i < ASYNC_OBJECTS; i++) {
+        geofs_hash_t hash;
+        ok &= async_slot_ok(&stores[i], async_size(i)) &&
+              geofs_content_store(vol, async_objects[i], async_size(i), hash) == GEOFS_OK &&
+              memcmp(hash, stores[i].hash, GEOFS_HASH_SIZE) == 0;
+    }
+    struct geofs_index_stats st;
+    geofs_index_stats(vol, &st);
+    ok &= st.content_entries == ASYNC_OBJECTS;
+    if (!ok) { FAIL("stored content differs"); geofs_volume_close(vol); return; }
+
+    uint8_t *bufs[ASYNC_OBJECTS];
+    for (uint32_t i = 0; i < ASYNC_OBJECTS; i++) {
+        bufs[i] = malloc(async_size(i));
+        ok &= bufs[i] && geofs_content_read_async(vol, stores[i].hash, bufs[i], async_size(i),
+                                                  async_record, &reads[i]) == GEOFS_OK;
+    }
+    ok &= geofs_async_drain(vol) == GEOFS_OK;
+    for (uint32_t i = 0; i < ASYNC_OBJECTS; i++) {
+        ok &= async_slot_ok(&reads[i], async_size(i)) &&
+              memcmp(bufs[i], async_objects[i], async_size(i)) == 0;
+        free(bufs[i]);
+    }
+    geofs_volume_close(vol);
+    if (!ok) { FAIL("read back differs"); return; }
+
+    /* An async sync alone makes the stores durable */
+    if (!run_crashed(crash_async)) { FAIL("async writer failed"); return; }
+    if (geofs_volume_open(vol_path, &vol) != GEOFS_OK) { FAIL("reopen"); return; }
+    for (uint32_t i = 0; i < ASYNC_OBJECTS; i++)
+        ok &= read_equals(vol, stores[i].hash, async_objects[i], async_size(i));
+    geofs_volume_close(vol);
+
+    if (ok) PASS();
+    else FAIL("synced stores lost");
+}
+
+void test_async(void)
+{
+    for (uint32_t i = 0; i < ASYNC_OBJECTS; i++) {
+        async_objects[i] = malloc(async_size(i));
+        if (!async_objects[i]) { FAIL("out of memory"); return; }
+        fill_object(async_objects[i], async_size(i), 5000 + i);
+    }
+
+    async_backend_run(0);
+    async_backend_run(1);
+    unsetenv("GEOFS_NO_IO_URING");
+
+    for (uint32_t i = 0; i < ASYNC_OBJECTS; i++)
+        free(async_objects[i]);
+}
+
+/* ══════════════════════════════════════════════════════════════════════════════
+ * COMPRESSION
+ * ══════════════════════════════════════════════════════════════════════════════ */
+
+/* Log-like text, which compresses well */
+static void fill_text(char *buf, size_t size, uint32_t tag)
+{
+    size_t n = 0;
+    for (uint32_t line = 0; n < size; line++) {
+        char tmp[96];
+        int len = snprintf(tmp, sizeof(tmp), "[%06u] worker %u: request %u served in %u ms\n",
+                           tag * 1000 + line, line % 8, tag + line * 3, (line * 7) % 50);
+        for (int i = 0; i < len && n < size; i++)
+            buf[n++] = tmp[i];
+    }
+}
+
+static size_t text_size(uint32_t i)
+{
+    static const size_t sizes[TEXT_OBJECTS] = { 600, 12000, 60000, 300000 };
+    return sizes[i];
+}
+
+static int text_all_equal(geofs_volume_t *vol, geofs_hash_t *hashes, char *buf)
+{
+    int ok = 1;
+    for (uint32_t i = 0; i < TEXT_OBJECTS; i++) {
+        fill_text(buf, text_size(i), i);
+        ok &= read_equals(vol, hashes[i], buf, text_size(i));
+    }
+    return ok;
+}
+
+void test_compression(void)
+{
+    TEST("compressed content and recompression");
+
+    geofs_volume_t *vol = fresh_volume();
+    if (!vol) { FAIL("create volume"); return; }
+
+    static char buf[300000];
+    geofs_hash_t hashes[TEXT_OBJECTS], noise;
+    uint64_t logical = 0;
+    int ok = 1;
+    for (uint32_t i = 0; i < TEXT_OBJECTS; i++) {
+        fill_text(buf, text_size(i), i);
+        ok &= geofs_content_store(vol, buf, text_size(i), hashes[i]) == GEOFS_OK;
+        logical += text_size(i);
+    }
+    /* Random bytes don't compress and are kept raw */
+    fill_object((uint8_t *)buf, 5000, 77);
+    ok &= geofs_content_store(vol, buf, 5000, noise) == GEOFS_OK;
+
+    struct geofs_space_stats sp;
+    geofs_space_stats(vol, &sp);
+    ok &= sp.compressed_objects == TEXT_OBJECTS && sp.logical_bytes == logical + 5000 &&
+          sp.stored_bytes < logical / 2 + 5000;
+    if (!ok) { FAIL("text not compressed"); geofs_volume_close(vol); return; }
+
+    ok &= text_all_equal(vol, hashes, buf);
+
+    /* A short buffer gets a prefix, a view the whole object */
+    fill_text(buf, text_size(2), 2);
+    char head[100];
+    size_t got = 0;
+    ok &= geofs_content_read(vol, hashes[2], head, sizeof(head), &got) == GEOFS_OK &&
+          got == sizeof(head) && memcmp(head, buf, sizeof(head)) == 0;
+    struct geofs_content_view view;
+    ok &= geofs_content_map(vol, hashes[2], &view) == GEOFS_OK &&
+          view.size == text_size(2) && memcmp(view.data, buf, view.size) == 0;
+    geofs_content_unmap(&view);
+
+    static char out[300000];
+    struct async_slot slot;
+    memset(&slot, 0, sizeof(slot));
+    fill_text(buf, text_size(3), 3);
+    ok &= geofs_content_read_async(vol, hashes[3], out, sizeof(out), async_record, &slot) ==
+              GEOFS_OK &&
+          geofs_async_drain(vol) == GEOFS_OK && async_slot_ok(&slot, text_size(3)) &&
+          memcmp(out, buf, text_size(3)) == 0;
+
+    /* Compressed before an async store, so written whole by the ring */
+    geofs_hash_t big;
+    memset(&slot, 0, sizeof(slot));
+    fill_text(out, sizeof(out), 5);
+    ok &= geofs_content_store_async(vol, out, sizeof(out), async_record, &slot) == GEOFS_OK &&
+          geofs_async_drain(vol) == GEOFS_OK && async_slot_ok(&slot, sizeof(out));
+    memcpy(big, slot.hash, GEOFS_HASH_SIZE);
+    ok &= read_equals(vol, big, out, sizeof(out));
+    if (!ok) { FAIL("compressed read back differs"); geofs_volume_close(vol); return; }
+
+    /* Stored raw, then rewritten compressed; the rewrite survives reopen */
+    geofs_hash_t raw;
+    fill_text(buf, 40000, 9);
+    ok &= geofs_volume_set_codec(vol, GEOFS_CODEC_NONE) == GEOFS_OK &&
+          geofs_content_store(vol, buf, 40000, raw) == GEOFS_OK &&
+          geofs_volume_set_codec(vol, GEOFS_CODEC_LZ4) == GEOFS_OK;
+    geofs_codec_t cold = geofs_codec_available(GEOFS_CODEC_DEFLATE) ? GEOFS_CODEC_DEFLATE
+                                                                     : GEOFS_CODEC_LZ4;
+    geofs_volume_sync(vol);
+    struct geofs_recompress_result r;
+    ok &= geofs_volume_recompress(vol, cold, &r) == GEOFS_OK &&
+          r.rewritten >= 1 && r.bytes_after < r.bytes_before;
+    geofs_space_stats(vol, &sp);
+    ok &= sp.recompressed_objects == r.rewritten && sp.superseded_bytes == r.bytes_before &&
+          read_equals(vol, raw, buf, 40000) && text_all_equal(vol, hashes, buf);
+    geofs_volume_close(vol);
+    if (!ok) { FAIL("recompress"); return; }
+
+    if (geofs_volume_open(vol_path, &vol) != GEOFS_OK) { FAIL("reopen"); return; }
+    struct geofs_space_stats reopened;
+    geofs_space_stats(vol, &reopened);
+    fill_text(buf, 40000, 9);
+    ok &= read_equals(vol, raw, buf, 40000) && text_all_equal(vol, hashes, buf) &&
+          reopened.objects == TEXT_OBJECTS + 3 &&
+          reopened.recompressed_objects == sp.recompressed_objects &&
+          reopened.superseded_bytes == sp.superseded_bytes &&
+          reopened.stored_bytes == sp.stored_bytes;
+    fill_object((uint8_t *)buf, 5000, 77);
+    ok &= read_equals(vol, noise, buf, 5000);
+    geofs_volume_close(vol);
+
+    if (ok) PASS();
+    else FAIL("recompressed objects lost on reopen");
+}
+
+static void listed_size(const struct geofs_dirent *entry, void *ctx)
+{
+    if (strcmp(entry->name, "big") == 0) *(uint64_t *)ctx = entry->size;
+}
+
+void test_manifest(void)
+{
+    TEST("chunk manifests");
+
+    geofs_volume_t *vol = fresh_volume();
+    if (!vol) { FAIL("create volume"); return; }
+
+    /* Two full chunks and a short one */
+    static uint8_t data[3 * CHUNK_SIZE];
+    size_t sizes[3] = { CHUNK_SIZE, CHUNK_SIZE, 5000 };
+    size_t total = 2 * CHUNK_SIZE + 5000;
+    geofs_hash_t chunks[4], manifest;
+    int ok = 1;
+    for (int i = 0; i < 3; i++) {
+        fill_object(data + i * CHUNK_SIZE, sizes[i], 300 + i);
+        ok &= geofs_content_store(vol, data + i * CHUNK_SIZE, sizes[i], chunks[i]) == GEOFS_OK;
+    }
+    ok &= geofs_manifest_store(vol, (const geofs_hash_t *)chunks, 3, manifest) == GEOFS_OK;
+    if (!ok) { FAIL("store"); geofs_volume_close(vol); return; }
+
+    /* Read, mapped and sized as the chunks back to back */
+    uint64_t size = 0;
+    struct geofs_content_view view;
+    ok &= geofs_content_size(vol, manifest, &size) == GEOFS_OK && size == total &&
+          read_equals(vol, manifest, data, total);
+    ok &= geofs_content_map(vol, manifest, &view) == GEOFS_OK && view.size == total &&
+          memcmp(view.data, data, total) == 0;
+    geofs_content_unmap(&view);
+    uint8_t head[150000];
+    size_t got = 0;
+    ok &= geofs_content_read(vol, manifest, head, sizeof(head), &got) == GEOFS_OK &&
+          got == sizeof(head) && memcmp(head, data, sizeof(head)) == 0;
+    struct async_slot slot;
+    memset(&slot, 0, sizeof(slot));
+    static uint8_t out[3 * CHUNK_SIZE];
+    ok &= geofs_content_read_async(vol, manifest, out, sizeof(out), async_record, &slot) ==
+              GEOFS_OK &&
+          geofs_async_drain(vol) == GEOFS_OK && async_slot_ok(&slot, total) &&
+          memcmp(out, data, total) == 0;
+    if (!ok) { FAIL("manifest read back differs"); geofs_volume_close(vol); return; }
+
+    struct geofs_chunk *list = NULL;
+    size_t count = 0;
+    ok &= geofs_content_chunks(vol, manifest, &list, &count) == GEOFS_OK && count == 3 &&
+          list[1].offset == CHUNK_SIZE && list[2].size == 5000 &&
+          memcmp(list[2].hash, chunks[2], GEOFS_HASH_SIZE) == 0;
+    free(list);
+    ok &= geofs_content_chunks(vol, chunks[0], &list, &count) == GEOFS_OK && count == 1 &&
+          list[0].size == CHUNK_SIZE;
+    free(list);
+    if (!ok) { FAIL("chunk lists"); geofs_volume_close(vol); return; }
+
+    /* Appending a chunk stores only it and a new manifest */
+    struct geofs_space_stats before, after;
+    geofs_space_stats(vol, &before);
+    geofs_hash_t again, longer;
+    fill_object(data + 2 * CHUNK_SIZE + 5000, 3000, 303);
+    ok &= geofs_manifest_store(vol, (const geofs_hash_t *)chunks, 3, again) == GEOFS_OK &&
+          memcmp(again, manifest, GEOFS_HASH_SIZE) == 0;
+    ok &= geofs_content_store(vol, data + 2 * CHUNK_SIZE + 5000, 3000, chunks[3]) == GEOFS_OK &&
+          geofs_manifest_store(vol, (const geofs_hash_t *)chunks, 4, longer) == GEOFS_OK;
+    geofs_space_stats(vol, &after);
+    ok &= after.objects == before.objects + 2 && read_equals(vol, longer, data, total + 3000);
+    if (!ok) { FAIL("chunks not shared"); geofs_volume_close(vol); return; }
+
+    /* Chunks must be stored and can't be manifests themselves */
+    geofs_hash_t bad[2], missing = {0};
+    memcpy(bad[0], chunks[0], GEOFS_HASH_SIZE);
+    memcpy(bad[1], missing, GEOFS_HASH_SIZE);
+    ok &= geofs_manifest_store(vol, (const geofs_hash_t *)bad, 2, again) == GEOFS_ERR_NOTFOUND;
+    memcpy(bad[1], manifest, GEOFS_HASH_SIZE);
+    ok &= geofs_manifest_store(vol, (const geofs_hash_t *)bad, 2, again) == GEOFS_ERR_INVALID;
+    if (!ok) { FAIL("bad chunk accepted"); geofs_volume_close(vol); return; }
+
+    /* A manifest's bytes stored as plain content first don't block it,
+     * and each reads back as itself */
+    struct { uint32_t magic, reserved; uint64_t chunks, size; } mh =
+        { 0x4E414D47u, 0, 2, 2 * CHUNK_SIZE };
+    struct { geofs_hash_t hash; uint64_t size; } me[2];
+    memset(me, 0, sizeof(me));
+    uint8_t forged[sizeof(mh) + sizeof(me)];
+    for (int i = 0; i < 2; i++) {
+        memcpy(me[i].hash, chunks[i], GEOFS_HASH_SIZE);
+        me[i].size = CHUNK_SIZE;
+    }
+    memcpy(forged, &mh, sizeof(mh));
+    memcpy(forged + sizeof(mh), me, sizeof(me));
+    geofs_hash_t plain, pair;
+    ok &= geofs_content_store(vol, forged, sizeof(forged), plain) == GEOFS_OK &&
+          geofs_manifest_store(vol, (const geofs_hash_t *)chunks, 2, pair) == GEOFS_OK &&
+          memcmp(plain, pair, GEOFS_HASH_SIZE) != 0 &&
+          read_equals(vol, pair, data, 2 * CHUNK_SIZE) &&
+          read_equals(vol, plain, forged, sizeof(forged));
+    if (!ok) { FAIL("manifest hash taken by plain content"); geofs_volume_close(vol); return; }
+
+    /* A ref to a manifest, listed with the content's size, across reopen */
+    ok &= geofs_ref_create(vol, "/big", manifest) == GEOFS_OK;
+    geofs_volume_close(vol);
+    if (geofs_volume_open(vol_path, &vol) != GEOFS_OK) { FAIL("reopen"); return; }
+    geofs_hash_t resolved;
+    uint64_t listed = 0;
+    geofs_ref_list(vol, "/", listed_size, &listed);
+    ok &= listed == total && geofs_ref_resolve(vol, "/big", resolved) == GEOFS_OK &&
+          memcmp(resolved, manifest, GEOFS_HASH_SIZE) == 0 &&
+          geofs_content_size(vol, longer, &size) == GEOFS_OK && size == total + 3000 &&
+          read_equals(vol, manifest, data, total);
+    geofs_volume_close(vol);
+
+    if (ok) PASS();
+    else FAIL("manifest lost on reopen");
+}
+
+/* ══════════════════════════════════════════════════════════════════════════════
+ * THROUGHPUT BENCHMARK
+ * ══════════════════════════════════════════════════════════════════════════════ */
+
+struct bench_arg {
+    geofs_volume_t *vol;
+    geofs_hash_t   *hashes;         /* BENCH_OBJECTS preloaded objects */
+    int             id;
+    int             ops;
+    int             write_pct;      /* Share of ops that store new content */
+    uint64_t        bytes;
+};
+
+static void *bench_thread(void *p)
+{
+    struct bench_arg *a = p;
+    uint8_t *buf = malloc(BENCH_SIZE);
+    uint32_t x = (uint32_t)a->id * 7919u + 17;
+    size_t got;
+
+    for (int i = 0; i < a->ops; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        if ((int)(x % 100) < a->write_pct) {
+            geofs_hash_t hash;
+            fill_object(buf, 64, x);            /* Unique head, no dedup */
+            geofs_content_store(a->vol, buf, BENCH_SIZE, hash);
+        } else {
+            geofs_content_read(a->vol, a->hashes[x % BENCH_OBJECTS],
+                               buf, BENCH_SIZE, &got);
+        }
+        a->bytes += BENCH_SIZE;
+    }
+    free(buf);
+    return NULL;
+}
+
+static void bench_run(geofs_volume_t *vol, geofs_hash_t *hashes,
+                      int nthreads, int write_pct)
+{
+    pthread_t threads[16];
+    struct bench_arg args[16];
+
+    double start = now_sec();
+    for (int t = 0; t < nthreads; t++) {
+        args[t] = (struct bench_arg){ vol, hashes, t, BENCH_OPS / nthreads,
+                                      write_pct, 0 };
+        pthread_create(&threads[t], NULL, bench_thread, &args[t]);
+    }
+    uint64_t bytes = 0;
+    for (int t = 0; t < nthreads; t++) {
+        pthread_join(threads[t], NULL);
+        bytes += args[t].bytes;
+    }
+    double secs = now_sec() - start;
+
+    printf("  %3d%% writes  %2d threads  %8.1f MB/s  %9.0f ops/s\n",
+           write_pct, nthreads, bytes / secs / (1024 * 1024), BENCH_OPS / secs);
+}
+
+void bench_throughput(void)
+{
+    printf("\n=== Throughput (%d KB objects, page cache warm) ===\n\n",
+           BENCH_SIZE / 1024);
+
+    geofs_volume_t *vol;
+    unlink(vol_path);
+    if (geofs_volume_create(vol_path, 1024, &vol) != GEOFS_OK) {
+        printf("  (could not create benchmark volume)\n");
+        return;
+    }
+
+    geofs_hash_t *hashes = malloc(sizeof(geofs_hash_t) * BENCH_OBJECTS);
+    uint8_t *buf = malloc(BENCH_SIZE);
+    for (int i = 0; i < BENCH_OBJECTS; i++) {
+        fill_object(buf, BENCH_SIZE, (uint32_t)i + 0x10000);
+        geofs_content_store(vol, buf, BENCH_SIZE, hashes[i]);
+    }
+    free(buf);
+
+    static const int thread_counts[] = { 1, 2, 4, 8 };
+    static const int write_pcts[] = { 0, 20, 100 };
+    for (size_t w = 0; w < sizeof(write_pcts) / sizeof(write_pcts[0]); w++)
+        for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++)
+            bench_run(vol, hashes, thread_counts[t], write_pcts[w]);
+
+    free(hashes);
+    geofs_volume_close(vol);
+}
+
+struct small_arg {
+    geofs_volume_t *vol;
+    int             id;
+    int             ops;
+};
+
+static void *small_thread(void *p)
+{
+    struct small_arg *a = p;
+    for (int i = 0; i < a->ops; i++)
+        store_tagged(a->vol, "msg", (uint32_t)(a->id * a->ops + i));
+    return NULL;
+}
+
+static void small_run(const char *label, geofs_sync_policy_t policy,
+                      unsigned interval_ms, int nthreads, int ops)
+{
+    geofs_volume_t *vol = fresh_volume();
+    if (!vol) return;
+    geofs_volume_set_sync(vol, policy, interval_ms);
+
+    pthread_t threads[16];
+    struct small_arg args[16];
+    double start = now_sec();
+    for (int t = 0; t < nthreads; t++) {
+        args[t] = (struct small_arg){ vol, t, ops / nthreads };
+        pthread_create(&threads[t], NULL, small_thread, &args[t]);
+    }
+    for (int t = 0; t < nthreads; t++)
+        pthread_join(threads[t], NULL);
+    geofs_volume_close(vol);                /* Includes the final sync */
+    double secs = now_sec() - start;
+
+    printf("  %-16s %2d threads  %9.0f ops/s\n", label, nthreads, ops / secs);
+}
+
+void bench_small_stores(void)
+{
+    printf("\n=== Small stores (%d B content + ref) ===\n\n", SMALL_SIZE);
+
+    small_run("sync on close", GEOFS_SYNC_ON_CLOSE, 0, 1, SMALL_OPS);
+    small_run("group, 10 ms", GEOFS_SYNC_GROUP, 10, 1, SMALL_OPS);
+    small_run("sync per op", GEOFS_SYNC_PER_OP, 0, 1, SMALL_SYNC_OPS);
+    small_run("sync per op", GEOFS_SYNC_PER_OP, 0, 8, SMALL_SYNC_OPS);
+}
+
+static void import_run(const char *label, int async, const uint8_t *data)
+{
+    geofs_volume_t *vol = fresh_volume();
+    if (!vol) return;
+
+    char name[64];
+    if (async) snprintf(name, sizeof(name), "%s (%s)", label, geofs_async_backend(vol));
+    else snprintf(name, sizeof(name), "%s", label);
+
+    double start = now_sec();
+    for (int i = 0; i < IMPORT_OBJECTS; i++) {
+        const uint8_t *obj = data + (size_t)i * IMPORT_SIZE;
+        if (async) {
+            geofs_content_store_async(vol, obj, IMPORT_SIZE, NULL, NULL);
+            geofs_async_poll(vol, 0);
+        } else {
+            geofs_hash_t hash;
+            geofs_content_store(vol, obj, IMPORT_SIZE, hash);
+        }
+    }
+    if (async) {
+        geofs_volume_sync_async(vol, NULL, NULL);
+        geofs_async_drain(vol);
+    } else {
+        geofs_volume_sync(vol);
+    }
+    double secs = now_sec() - start;
+    geofs_volume_close(vol);
+
+    double mb = (double)IMPORT_OBJECTS * IMPORT_SIZE / (1024 * 1024);
+    printf("  %-24s %8.1f MB/s\n", name, mb / secs);
+}
+
+void bench_async_import(void)
+{
+    printf("\n=== Bulk import (%d x %d KB, synced at the end) ===\n\n",
+           IMPORT_OBJECTS, IMPORT_SIZE / 1024);
+
+    uint8_t *data = malloc((size_t)IMPORT_OBJECTS * IMPORT_SIZE);
+    if (!data) return;
+    for (int i = 0; i < IMPORT_OBJECTS; i++)
+        fill_object(data + (size_t)i * IMPORT_SIZE, IMPORT_SIZE, 9000 + i);
+
+    import_run("blocking stores", 0, data);
+    setenv("GEOFS_NO_IO_URING", "1", 1);
+    import_run("async stores", 1, data);
+    unsetenv("GEOFS_NO_IO_URING");
+    import_run("async stores", 1, data);
+
+    free(data);
+}
+
+int main(void)
+{
+    snprintf(vol_path, sizeof(vol_path), "/tmp/test_geofs_%d.geo", (int)getpid());
+
+    printf("\n=== GeoFS Volume Test Suite ===\n\n");
+
+    test_content_roundtrip();
+    test_ref_versions();
+    test_content_map();
+    test_small_packing();
+    test_concurrent_writers();
+    test_crash_recovery();
+    test_torn_segment();
+    test_async();
+    test_compression();
+    test_manifest();
+    bench_throughput();
+    bench_small_stores();
+    bench_async_import();
+
+    unlink(vol_path);
+
+    printf("\n=== Results ===\n");
+    printf("Passed: %d\n", tests_passed);
+    printf("Failed: %d\n", tests_failed);
+    printf("Total:  %d\n", tests_passed + tests_failed);
+
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -7,29 +7,27 @@
 #include "kvm_clock.h"
 #include "idt.h"
 #include "pic.h"
+#include "io.h"
 
 /* External functions */
 extern int kprintf(const char *fmt, ...);
 
-/* Port I/O helpers */
-static inline void outb(uint16_t port, uint8_t val)
-{
-    __asm__ volatile ("outb %0, %1" : : "a"(val), "Nd"(port));
-}
-
-static inline uint8_t inb(uint16_t port)
-{
-    uint8_t ret;
-    __asm__ volatile ("inb %1, %0" : "=a"(ret) : "Nd"(port));
-    return ret;
-}
-
 /* Tick counter */
 static volatile uint64_t timer_ticks = 0;
 
-/* Forward declaration for scheduler */
+/* TSC calibration: TSC sampled at the first and the latest PIT tick */
+static volatile uint64_t tsc_first_tick = 0;
+static volatile uint64_t tsc_last_tick = 0;
+
+/* Forward declarations for scheduler */
 extern void scheduler_tick(void);
 __attribute__((weak)) void scheduler_tick(void) { }
+extern int sched_running(void);
+__attribute__((weak)) int sched_running(void) { return 0; }
+extern int sched_has_ready(void);
+__attribute__((weak)) int sched_has_ready(void) { return 0; }
+extern void sched_yield(void);
+__attribute__((weak)) void sched_yield(void) { }
 
 /*
  * Timer interrupt handler (IRQ0)
@@ -40,11 +38,16 @@ static void timer_handler(struct interrupt_frame *frame)
 
     timer_ticks++;
 
-    /* Call scheduler tick (if scheduler is initialized) */
-    scheduler_tick();
+    tsc_last_tick = rdtsc();
+    if (timer_ticks == 1)
+        tsc_first_tick = tsc_last_tick;
 
-    /* Send EOI */
+    /* EOI first: the scheduler may switch to another task here and only
+     * return to this handler much later */
     pic_send_eoi(0);
+
+    /* Call scheduler tick (if scheduler is initialized) */
+    scheduler_tick();
 }
 
 /*
@@ -88,7 +91,12 @@ void timer_sleep_ms(uint32_t ms)
     if (target == timer_ticks) target++;  /* At least one tick */
 
     while (timer_ticks < target) {
-        __asm__ volatile ("hlt");  /* Wait for interrupt */
+        /* Let other tasks run if any are waiting; otherwise wait for
+         * interrupt */
+        if (sched_running() && sched_has_ready() && interrupts_enabled())
+            sched_yield();
+        else
+            __asm__ volatile ("hlt");
     }
 }
 
@@ -111,6 +119,27 @@ uint64_t timer_get_ms(void)
     return timer_get_ns() / 1000000ULL;
 }
 
+/*
+ * TSC frequency, measured against the PIT
+ */
+uint64_t timer_tsc_khz(void)
+{
+    uint64_t ticks = timer_ticks;
+    if (ticks < 2)
+        return 0;
+    return (tsc_last_tick - tsc_first_tick) * TIMER_FREQUENCY /
+           ((ticks - 1) * 1000);
+}
+
+uint64_t timer_tsc_to_ns(uint64_t cycles)
+{
+    uint64_t khz = timer_tsc_khz();
+    if (khz == 0)
+        return 0;
+    /* Split to avoid overflowing cycles * 1e6 */
+    return (cycles / khz) * 1000000ULL + (cycles % khz) * 1000000ULL / khz;
+}
+
 /*
  * PC Speaker - PIT Channel 2
  */
@@ -28,7 +28,8 @@ void timer_init(void);
 /* Get current tick count */
 uint64_t timer_get_ticks(void);
 
-/* Sleep for specified milliseconds (busy wait) */
+/* Sleep for specified milliseconds (yields to other tasks when called from
+ * a scheduled task with interrupts on, else halts until each tick) */
 void timer_sleep_ms(uint32_t ms);
 
 /* High-resolution time (nanoseconds) - uses KVM pvclock when available */
@@ -37,6 +38,12 @@ uint64_t timer_get_ns(void);
 /* Milliseconds since boot (higher precision than tick-based) */
 uint64_t timer_get_ms(void);
 
+/* TSC frequency in kHz, calibrated against PIT ticks (0 until 2 ticks) */
+uint64_t timer_tsc_khz(void);
+
+/* Convert a TSC cycle delta to nanoseconds (0 until calibrated) */
+uint64_t timer_tsc_to_ns(uint64_t cycles);
+
 /* PC Speaker (PIT Channel 2) */
 void speaker_play_tone(uint32_t freq_hz);
 void speaker_stop(void);
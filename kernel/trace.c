@@ -0,0 +1,278 @@
+/*
+ * PhantomOS Kernel Trace Ring
+ * "To Create, Not To Destroy"
+ *
+ * Per-CPU rings of fixed-size records. A writer claims the next slot with
+ * an atomic fetch-add on the ring head and fills it in place; interrupts
+ * that fire in between simply claim the following slot. The ring never
+ * blocks and overwrites the oldest records when full. Readers (dump and
+ * export) stop tracing first, so they never race with a writer.
+ */
+
+#include "trace.h"
+#include "geofs.h"
+#include "process.h"
+#include "heap.h"
+#include "timer.h"
+#include "io.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/*============================================================================
+ * External Declarations
+ *============================================================================*/
+
+extern int kprintf(const char *fmt, ...);
+extern void *memset(void *s, int c, size_t n);
+extern void *memcpy(void *dest, const void *src, size_t n);
+extern size_t strlen(const char *s);
+extern char *strncpy(char *dest, const char *src, size_t n);
+
+/*============================================================================
+ * State
+ *============================================================================*/
+
+struct trace_cpu {
+    struct trace_record ring[TRACE_RING_SIZE];
+    uint64_t            head;       /* Records ever claimed */
+    int                 irq_depth;  /* Nested interrupt handlers */
+};
+
+static struct trace_cpu trace_cpus[TRACE_MAX_CPUS];
+
+volatile int trace_enabled = 0;
+
+static const char *trace_names[TRACE_ID_COUNT] = {
+    [TRACE_ID_NONE]              = "none",
+    [TRACE_ID_SCHED_SWITCH]      = "sched_switch",
+    [TRACE_ID_IRQ]               = "irq",
+    [TRACE_ID_GEOFS_STORE]       = "geofs_content_store",
+    [TRACE_ID_GEOFS_READ]        = "geofs_content_read",
+    [TRACE_ID_GEOFS_REF_CREATE]  = "geofs_ref_create",
+    [TRACE_ID_GEOFS_REF_RESOLVE] = "geofs_ref_resolve",
+    [TRACE_ID_GEOFS_FILE_WRITE]  = "geofs_file_write",
+    [TRACE_ID_GEOFS_FILE_READ]   = "geofs_file_read",
+    [TRACE_ID_GEOFS_SAVE]        = "geofs_volume_save",
+    [TRACE_ID_GEOFS_LOAD]        = "geofs_volume_load",
+    [TRACE_ID_ATA_READ]          = "ata_read",
+    [TRACE_ID_ATA_WRITE]         = "ata_write",
+    [TRACE_ID_ATA_FLUSH]         = "ata_flush",
+    [TRACE_ID_FB_FLIP]           = "fb_flip",
+    [TRACE_ID_NET_POLL]          = "virtio_net_poll",
+    [TRACE_ID_MARK]              = "mark",
+};
+
+/* Single-processor kernel: everything runs on CPU 0 */
+static inline uint32_t trace_cpu_id(void)
+{
+    return 0;
+}
+
+/*============================================================================
+ * Emitting
+ *============================================================================*/
+
+void trace_emit(uint16_t id, uint8_t phase, uint64_t a0, uint64_t a1,
+                uint64_t a2)
+{
+    uint32_t cpu = trace_cpu_id();
+    struct trace_cpu *c = &trace_cpus[cpu];
+
+    uint64_t idx = __atomic_fetch_add(&c->head, 1, __ATOMIC_RELAXED);
+    struct trace_record *r = &c->ring[idx & (TRACE_RING_SIZE - 1)];
+
+    struct process *p = sched_current();
+
+    r->tsc = rdtsc();
+    r->id = id;
+    r->phase = phase;
+    r->cpu = (uint8_t)cpu;
+    r->ctx = c->irq_depth > 0 ? TRACE_CTX_IRQ : TRACE_CTX_TASK;
+    r->pid = p ? p->pid : 0;
+    r->args[0] = a0;
+    r->args[1] = a1;
+    r->args[2] = a2;
+}
+
+void trace_irq_enter(uint64_t vector, uint64_t rip)
+{
+    struct trace_cpu *c = &trace_cpus[trace_cpu_id()];
+    c->irq_depth++;
+    TRACE_BEGIN(TRACE_ID_IRQ, vector, rip, 0);
+}
+
+void trace_irq_exit(uint64_t vector)
+{
+    struct trace_cpu *c = &trace_cpus[trace_cpu_id()];
+    TRACE_END(TRACE_ID_IRQ, vector);
+    c->irq_depth--;
+}
+
+int trace_irq_depth(void)
+{
+    return trace_cpus[trace_cpu_id()].irq_depth;
+}
+
+void trace_set_irq_depth(int depth)
+{
+    trace_cpus[trace_cpu_id()].irq_depth = depth;
+}
+
+/*============================================================================
+ * Control
+ *============================================================================*/
+
+void trace_start(void)
+{
+    trace_enabled = 1;
+}
+
+void trace_stop(void)
+{
+    trace_enabled = 0;
+}
+
+void trace_clear(void)
+{
+    for (int cpu = 0; cpu < TRACE_MAX_CPUS; cpu++)
+        trace_cpus[cpu].head = 0;
+}
+
+const char *trace_id_name(uint16_t id)
+{
+    if (id >= TRACE_ID_COUNT || !trace_names[id])
+        return "?";
+    return trace_names[id];
+}
+
+static uint64_t cpu_count(const struct trace_cpu *c)
+{
+    return c->head < TRACE_RING_SIZE ? c->head : TRACE_RING_SIZE;
+}
+
+uint64_t trace_count(void)
+{
+    uint64_t n = 0;
+    for (int cpu = 0; cpu < TRACE_MAX_CPUS; cpu++)
+        n += cpu_count(&trace_cpus[cpu]);
+    return n;
+}
+
+uint64_t trace_dropped(void)
+{
+    uint64_t n = 0;
+    for (int cpu = 0; cpu < TRACE_MAX_CPUS; cpu++)
+        n += trace_cpus[cpu].head - cpu_count(&trace_cpus[cpu]);
+    return n;
+}
+
+/*============================================================================
+ * Reading
+ *============================================================================*/
+
+void trace_dump(uint32_t n)
+{
+    static const char phase_ch[] = { 'B', 'E', 'i' };
+    int was_enabled = trace_enabled;
+
+    trace_stop();
+
+    kprintf("\nTrace: %lu records held, %lu dropped, %s\n",
+            (unsigned long)trace_count(), (unsigned long)trace_dropped(),
+            was_enabled ? "running" : "stopped");
+
+    uint64_t khz = timer_tsc_khz();
+
+    for (int cpu = 0; cpu < TRACE_MAX_CPUS; cpu++) {
+        struct trace_cpu *c = &trace_cpus[cpu];
+        uint64_t held = cpu_count(c);
+        uint64_t show = n < held ? n : held;
+        if (show == 0)
+            continue;
+
+        uint64_t first = c->head - show;
+        uint64_t t0 = c->ring[first & (TRACE_RING_SIZE - 1)].tsc;
+
+        kprintf("  CPU %d, newest %lu (time in us from first shown):\n",
+                cpu, (unsigned long)show);
+        for (uint64_t i = first; i < c->head; i++) {
+            const struct trace_record *r = &c->ring[i & (TRACE_RING_SIZE - 1)];
+            uint64_t dt = r->tsc - t0;
+            uint64_t us = khz ? dt * 1000 / khz : dt;
+            kprintf("  %10lu %c pid %lu%s %s 0x%lx 0x%lx 0x%lx\n",
+                    (unsigned long)us, phase_ch[r->phase < 3 ? r->phase : 2],
+                    (unsigned long)r->pid,
+                    r->ctx == TRACE_CTX_IRQ ? " [irq]" : "",
+                    trace_id_name(r->id),
+                    (unsigned long)r->args[0], (unsigned long)r->args[1],
+                    (unsigned long)r->args[2]);
+        }
+    }
+
+    if (was_enabled)
+        trace_start();
+}
+
+int trace_export(struct kgeofs_volume *vol, const char *path)
+{
+    if (!vol || !path)
+        return -1;
+
+    /* Stop first: GeoFS itself is traced */
+    trace_stop();
+
+    uint64_t count = trace_count();
+    size_t names_size = (size_t)TRACE_ID_COUNT * TRACE_NAME_LEN;
+    size_t size = sizeof(struct trace_file_header) + names_size +
+                  (size_t)count * sizeof(struct trace_record);
+
+    uint8_t *buf = (uint8_t *)kmalloc(size);
+    if (!buf)
+        return -1;
+
+    struct trace_file_header *hdr = (struct trace_file_header *)buf;
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic = TRACE_FILE_MAGIC;
+    hdr->version = 1;
+    hdr->record_size = sizeof(struct trace_record);
+    hdr->tsc_khz = timer_tsc_khz();
+    hdr->name_count = TRACE_ID_COUNT;
+    hdr->record_count = (uint32_t)count;
+    hdr->dropped = trace_dropped();
+
+    char *names = (char *)(buf + sizeof(*hdr));
+    memset(names, 0, names_size);
+    for (int id = 0; id < TRACE_ID_COUNT; id++)
+        strncpy(names + id * TRACE_NAME_LEN, trace_id_name((uint16_t)id),
+                TRACE_NAME_LEN - 1);
+
+    /* Records, oldest first per CPU (the host tool sorts by TSC) */
+    struct trace_record *out = (struct trace_record *)(names + names_size);
+    for (int cpu = 0; cpu < TRACE_MAX_CPUS; cpu++) {
+        struct trace_cpu *c = &trace_cpus[cpu];
+        for (uint64_t i = c->head - cpu_count(c); i < c->head; i++)
+            *out++ = c->ring[i & (TRACE_RING_SIZE - 1)];
+    }
+
+    /* Create the parent directory if the path has one */
+    char dir[128];
+    size_t len = strlen(path);
+    size_t slash = 0;
+    for (size_t i = 0; i < len && i < sizeof(dir) - 1; i++)
+        if (path[i] == '/') slash = i;
+    if (slash > 0) {
+        memcpy(dir, path, slash);
+        dir[slash] = '\0';
+        kgeofs_mkdir(vol, dir);
+    }
+
+    kgeofs_error_t err = kgeofs_file_write(vol, path, buf, size);
+    kfree(buf);
+
+    if (err != KGEOFS_OK)
+        return -1;
+
+    kprintf("Trace: wrote %lu records (%lu bytes) to %s\n",
+            (unsigned long)count, (unsigned long)size, path);
+    return 0;
+}
@@ -0,0 +1,156 @@
+/*
+ * PhantomOS Kernel Trace Ring
+ * "To Create, Not To Destroy"
+ *
+ * Low-overhead binary event tracing. Static tracepoints in the scheduler,
+ * interrupt dispatch, GeoFS, ATA, framebuffer flip and VirtIO-net emit
+ * fixed-size records (TSC timestamp, PID, up to three 64-bit arguments)
+ * into a per-CPU ring. Writers reserve a slot with one atomic add, so
+ * tracepoints are safe from interrupt context and never block. When
+ * tracing is stopped a tracepoint costs a single load and branch.
+ *
+ * "trace save" writes the ring to GeoFS; tools/trace2json.py turns the
+ * file into Chrome trace JSON (chrome://tracing, Perfetto).
+ */
+
+#ifndef PHANTOMOS_TRACE_H
+#define PHANTOMOS_TRACE_H
+
+#include <stdint.h>
+
+struct kgeofs_volume;
+
+/*============================================================================
+ * Configuration
+ *============================================================================*/
+
+#define TRACE_MAX_CPUS      1           /* Kernel runs on the BSP only */
+#define TRACE_RING_SIZE     8192        /* Records per CPU (power of two) */
+#define TRACE_DEFAULT_PATH  "/trace/trace.bin"
+
+/*============================================================================
+ * Tracepoints
+ *============================================================================*/
+
+enum trace_id {
+    TRACE_ID_NONE = 0,
+    TRACE_ID_SCHED_SWITCH,      /* a0 = old pid, a1 = new pid */
+    TRACE_ID_IRQ,               /* a0 = vector, a1 = interrupted rip */
+    TRACE_ID_GEOFS_STORE,       /* a0 = size */
+    TRACE_ID_GEOFS_READ,        /* a0 = buffer size */
+    TRACE_ID_GEOFS_REF_CREATE,
+    TRACE_ID_GEOFS_REF_RESOLVE,
+    TRACE_ID_GEOFS_FILE_WRITE,  /* a0 = size */
+    TRACE_ID_GEOFS_FILE_READ,   /* a0 = buffer size */
+    TRACE_ID_GEOFS_SAVE,        /* a0 = drive */
+    TRACE_ID_GEOFS_LOAD,        /* a0 = drive */
+    TRACE_ID_ATA_READ,          /* a0 = lba, a1 = count, a2 = drive */
+    TRACE_ID_ATA_WRITE,         /* a0 = lba, a1 = count, a2 = drive */
+    TRACE_ID_ATA_FLUSH,         /* a0 = drive */
+    TRACE_ID_FB_FLIP,
+    TRACE_ID_NET_POLL,          /* end: a0 = packets received */
+    TRACE_ID_MARK,              /* Free-form instant, a0..a2 caller-defined */
+    TRACE_ID_COUNT
+};
+
+/* Record phase (maps to Chrome trace "B", "E", "i") */
+#define TRACE_PH_BEGIN      0
+#define TRACE_PH_END        1
+#define TRACE_PH_INSTANT    2
+
+/* Record context */
+#define TRACE_CTX_TASK      0
+#define TRACE_CTX_IRQ       1           /* Emitted inside an interrupt handler */
+
+struct trace_record {
+    uint64_t tsc;
+    uint16_t id;                /* enum trace_id */
+    uint8_t  phase;             /* TRACE_PH_* */
+    uint8_t  cpu;
+    uint8_t  ctx;               /* TRACE_CTX_* */
+    uint8_t  reserved[3];
+    uint64_t pid;
+    uint64_t args[3];
+} __attribute__((packed));      /* 48 bytes */
+
+/*============================================================================
+ * Export File Format (little-endian)
+ *
+ *   struct trace_file_header
+ *   char names[name_count][TRACE_NAME_LEN]     (NUL-padded)
+ *   struct trace_record records[record_count]  (oldest first)
+ *============================================================================*/
+
+#define TRACE_FILE_MAGIC    0x3145434152544850ULL   /* "PHTRACE1" */
+#define TRACE_NAME_LEN      24
+
+struct trace_file_header {
+    uint64_t magic;
+    uint32_t version;           /* 1 */
+    uint32_t record_size;       /* sizeof(struct trace_record) */
+    uint64_t tsc_khz;           /* For converting timestamps to time */
+    uint32_t name_count;        /* TRACE_ID_COUNT */
+    uint32_t record_count;
+    uint64_t dropped;           /* Records overwritten before export */
+} __attribute__((packed));
+
+/*============================================================================
+ * Emitting
+ *============================================================================*/
+
+extern volatile int trace_enabled;
+
+void trace_emit(uint16_t id, uint8_t phase, uint64_t a0, uint64_t a1,
+                uint64_t a2);
+
+#define TRACE_BEGIN(id, a0, a1, a2) \
+    do { if (trace_enabled) trace_emit((id), TRACE_PH_BEGIN, (a0), (a1), (a2)); } while (0)
+#define TRACE_END(id, a0) \
+    do { if (trace_enabled) trace_emit((id), TRACE_PH_END, (a0), 0, 0); } while (0)
+#define TRACE_INSTANT(id, a0, a1, a2) \
+    do { if (trace_enabled) trace_emit((id), TRACE_PH_INSTANT, (a0), (a1), (a2)); } while (0)
+
+/*
+ * TRACE_SCOPE(id, a0, a1, a2): begin now, end when the enclosing block
+ * exits (including early returns).
+ */
+static inline void trace_scope_end(uint16_t *id)
+{
+    if (trace_enabled)
+        trace_emit(*id, TRACE_PH_END, 0, 0, 0);
+}
+
+#define TRACE_SCOPE(id, a0, a1, a2) \
+    uint16_t __trace_scope __attribute__((cleanup(trace_scope_end), unused)) = (id); \
+    TRACE_BEGIN((id), (a0), (a1), (a2))
+
+/* Interrupt dispatch hooks (track IRQ nesting even while stopped) */
+void trace_irq_enter(uint64_t vector, uint64_t rip);
+void trace_irq_exit(uint64_t vector);
+
+/* IRQ nesting is per task: the scheduler saves/restores it across switches */
+int trace_irq_depth(void);
+void trace_set_irq_depth(int depth);
+
+/*============================================================================
+ * Control
+ *============================================================================*/
+
+void trace_start(void);
+void trace_stop(void);
+void trace_clear(void);
+
+/* Name of a tracepoint ("irq", "ata_read", ...) */
+const char *trace_id_name(uint16_t id);
+
+/* Records currently held (all CPUs) and records lost to wraparound */
+uint64_t trace_count(void);
+uint64_t trace_dropped(void);
+
+/* Print the newest n records to the console */
+void trace_dump(uint32_t n);
+
+/* Stop tracing and write the ring to a GeoFS file. 0 on success */
+int trace_export(struct kgeofs_volume *vol, const char *path);
+
+#endif /* PHANTOMOS_TRACE_H */
@@ -5,11 +5,15 @@
  * UHCI (Universal Host Controller Interface) driver for USB 1.1.
  * Detects UHCI controller via PCI, initializes frame list and TD/QH pools,
  * enumerates connected devices, and sets up HID boot protocol devices.
+ * HID interrupt TDs complete with IOC set, and the controller's PCI IRQ
+ * processes them as they finish rather than once per desktop frame.
  */
 
 #include "usb.h"
 #include "usb_hid.h"
 #include "pci.h"
+#include "idt.h"
+#include "pic.h"
 #include "io.h"
 #include "pmm.h"
 #include "timer.h"
@@ -53,6 +57,8 @@ static struct {
     int         initialized;
     uint16_t    io_base;            /* UHCI I/O base from BAR4 */
     uint8_t     irq;                /* PCI IRQ line */
+    int         irq_mode;           /* HID TDs completed by interrupt */
+    uint64_t    irq_count;          /* Completion interrupts handled */
     uint64_t    dma_base;           /* Physical address of DMA region */
 
     /* Pointers into DMA region */
@@ -740,6 +746,56 @@ uint8_t *usb_get_poll_buffer(int device_index)
     return uhci.poll_bufs + (device_index * DMA_POLL_BUF_STRIDE);
 }
 
+/*============================================================================
+ * Completion Interrupt
+ *============================================================================*/
+
+static void uhci_irq_handler(struct interrupt_frame *frame)
+{
+    (void)frame;
+
+    uint16_t sts = uhci_read16(UHCI_REG_USBSTS);
+    uint16_t ours = sts & (UHCI_STS_USBINT | UHCI_STS_ERROR |
+                           UHCI_STS_RD | UHCI_STS_HSE | UHCI_STS_HCPE);
+
+    if (ours) {
+        /* Write-1-to-clear before processing so new completions re-raise */
+        uhci_write16(UHCI_REG_USBSTS, ours);
+        uhci.irq_count++;
+        if (ours & (UHCI_STS_USBINT | UHCI_STS_ERROR)) {
+            usb_hid_irq_mark();
+            usb_hid_poll();
+        }
+    }
+
+    pic_send_eoi(uhci.irq);
+}
+
+/*
+ * Switch HID completion to the controller's IRQ. Stays in polling mode if
+ * the line is unassigned or its vector is already taken (legacy PIC lines
+ * are not shared here).
+ */
+static void uhci_enable_irq(void)
+{
+    if (uhci.irq == 0 || uhci.irq >= 16 || uhci.irq == 2) {
+        kprintf("[USB] No usable IRQ line, polling HID devices\n");
+        return;
+    }
+    if (interrupt_get_handler(IRQ_BASE + uhci.irq)) {
+        kprintf("[USB] IRQ %d already in use, polling HID devices\n", uhci.irq);
+        return;
+    }
+
+    register_interrupt_handler(IRQ_BASE + uhci.irq, uhci_irq_handler);
+    uhci_write16(UHCI_REG_USBSTS, 0x1F);
+    uhci_write16(UHCI_REG_USBINTR, UHCI_INTR_IOC | UHCI_INTR_TIMEOUT_CRC);
+    uhci.irq_mode = 1;
+    pic_enable_irq(uhci.irq);
+
+    kprintf("[USB] HID completion on IRQ %d\n", uhci.irq);
+}
+
 void usb_init(void)
 {
     memset(&uhci, 0, sizeof(uhci));
@@ -748,18 +804,12 @@ void usb_init(void)
     /* Initialize HID subsystem */
     usb_hid_init();
 
-    /* Find UHCI controller on PCI bus */
-    const struct pci_device *pci_dev = pci_find_device(PCI_CLASS_SERIAL,
-                                                        PCI_SUBCLASS_USB);
+    /* Find UHCI controller (prog_if 0x00) on PCI bus; xHCI is xhci.c's */
+    const struct pci_device *pci_dev = pci_find_class(PCI_CLASS_SERIAL,
+                                                       PCI_SUBCLASS_USB,
+                                                       PCI_PROG_IF_UHCI);
     if (!pci_dev) {
-        kprintf("[USB] No USB controller found on PCI bus\n");
-        return;
-    }
-
-    /* Check prog_if for UHCI (0x00) */
-    if (pci_dev->prog_if != 0x00) {
-        kprintf("[USB] USB controller found but not UHCI (prog_if=0x%02x)\n",
-                pci_dev->prog_if);
+        kprintf("[USB] No UHCI controller found on PCI bus\n");
         return;
     }
 
@@ -839,7 +889,7 @@ void usb_init(void)
     /* Set SOF timing to default */
     outb(uhci.io_base + UHCI_REG_SOFMOD, 0x40);
 
-    /* Disable interrupts (polling mode) */
+    /* Interrupts stay off until enumeration is done */
     uhci_write16(UHCI_REG_USBINTR, 0);
 
     /* Start the controller */
@@ -852,7 +902,6 @@ void usb_init(void)
         return;
     }
 
-    uhci.initialized = 1;
     kprintf("[USB] UHCI host controller started\n");
 
     /* Scan root hub ports */
@@ -865,6 +914,12 @@ void usb_init(void)
     }
 
     kprintf("[USB] Enumeration complete: %d device(s)\n", uhci.device_count);
+
+    /* Init may run as a deferred task: usb_poll() from the desktop stays
+     * out until the port scan is done */
+    uhci.initialized = 1;
+
+    uhci_enable_irq();
 }
 
 void usb_poll(void)
@@ -900,8 +955,17 @@ void usb_poll(void)
         }
     }
 
-    /* Poll HID devices */
-    usb_hid_poll();
+    /* Without an IRQ, process HID completions here. Interrupts are held
+     * off because usb_hid_poll() reports into the input ring, whose
+     * producers must not interleave. */
+    if (!uhci.irq_mode) {
+        int was_enabled = interrupts_enabled();
+        cli();
+        usb_hid_irq_mark();
+        usb_hid_poll();
+        if (was_enabled)
+            sti();
+    }
 }
 
 int usb_is_initialized(void)
@@ -932,7 +996,9 @@ void usb_dump_status(void)
     }
 
     kprintf("  I/O Base:      0x%04x\n", uhci.io_base);
-    kprintf("  IRQ:           %d\n", uhci.irq);
+    kprintf("  IRQ:           %d (%s, %lu interrupts)\n", uhci.irq,
+            uhci.irq_mode ? "interrupt-driven" : "polled",
+            (unsigned long)uhci.irq_count);
     kprintf("  USBCMD:        0x%04x\n", uhci_read16(UHCI_REG_USBCMD));
     kprintf("  USBSTS:        0x%04x\n", uhci_read16(UHCI_REG_USBSTS));
     kprintf("  Frame Number:  %d\n", uhci_read16(UHCI_REG_FRNUM));
@@ -138,6 +138,10 @@
 #define USB_RT_DEV_TO_HOST      0x80
 #define USB_RT_CLASS            0x20
 #define USB_RT_INTERFACE        0x01
+#define USB_RT_ENDPOINT         0x02
+
+/* Feature selectors */
+#define USB_FEATURE_ENDPOINT_HALT   0x00
 
 /*============================================================================
  * USB Descriptor Types
@@ -291,7 +295,8 @@ struct usb_device {
 /* Initialize UHCI host controller and enumerate USB devices */
 void usb_init(void);
 
-/* Poll for USB device events and HID data */
+/* Handle port changes (hot-plug); also processes HID data when the
+ * controller runs without an IRQ */
 void usb_poll(void);
 
 /* Check if USB subsystem is initialized */
@@ -3,14 +3,19 @@
  * "To Create, Not To Destroy"
  *
  * Handles USB HID keyboards and mice using boot protocol.
- * Keyboards inject into the existing PS/2 keyboard buffer.
- * Mice inject into the existing PS/2 mouse state structure.
+ * Completed interrupt TDs are processed from the UHCI interrupt handler
+ * (or usb_poll() when the controller has no usable IRQ); xHCI hands over
+ * completed reports through usb_hid_deliver(). Key presses and mouse
+ * reports go into the shared input event ring (input.h).
  */
 
 #include "usb_hid.h"
 #include "usb.h"
 #include "keyboard.h"
 #include "mouse.h"
+#include "input.h"
+#include "timer.h"
+#include "idt.h"
 #include "io.h"
 #include <stdint.h>
 #include <stddef.h>
@@ -87,6 +92,9 @@ static const char hid_to_ascii_shift[128] = {
 static struct usb_hid_device hid_devices[USB_HID_MAX_DEVICES];
 static int hid_count = 0;
 
+/* TSC at entry of the controller interrupt (or poll) now running */
+static uint64_t hid_irq_tsc = 0;
+
 /*============================================================================
  * Keyboard Report Processing
  *============================================================================*/
@@ -130,9 +138,9 @@ static void hid_process_keyboard(struct usb_hid_device *hid,
             c = c - 'A' + 1;
         }
 
-        /* Inject into keyboard buffer */
+        /* Queue for the keyboard buffer */
         if (c != 0) {
-            keyboard_inject_char(c);
+            input_report_key(INPUT_SRC_USB_KBD, (uint8_t)c);
         }
     }
 
@@ -164,14 +172,51 @@ static void hid_process_mouse(struct usb_hid_device *hid,
     if (len >= 6) {
         int abs_x = (int)(report[1] | ((uint16_t)report[2] << 8));
         int abs_y = (int)(report[3] | ((uint16_t)report[4] << 8));
-        mouse_set_absolute(abs_x, abs_y, buttons);
+        input_report_abs(INPUT_SRC_USB_MOUSE, abs_x, abs_y, buttons);
     } else {
         int8_t dx = (int8_t)report[1];
         int8_t dy = (int8_t)report[2];
-        mouse_inject_movement(dx, dy, buttons);
+        input_report_rel(INPUT_SRC_USB_MOUSE, dx, dy, buttons);
+    }
+}
+
+/*============================================================================
+ * Report Dispatch
+ *============================================================================*/
+
+static void hid_dispatch(struct usb_hid_device *hid, const uint8_t *report,
+                         int len)
+{
+    uint64_t now = rdtsc();
+
+    if (hid->reports > 0) {
+        uint64_t gap = now - hid->last_tsc;
+        if (hid->gap_min == 0 || gap < hid->gap_min)
+            hid->gap_min = gap;
+    }
+    hid->last_tsc = now;
+    hid->reports++;
+
+    if (hid->type == USB_HID_KEYBOARD) {
+        if (len >= 8)
+            hid_process_keyboard(hid, report);
+    } else if (hid->type == USB_HID_MOUSE) {
+        hid_process_mouse(hid, report, len);
+    }
+
+    if (hid_irq_tsc) {
+        uint64_t lat = rdtsc() - hid_irq_tsc;
+        hid->lat_sum += lat;
+        if (lat > hid->lat_max)
+            hid->lat_max = lat;
     }
 }
 
+void usb_hid_irq_mark(void)
+{
+    hid_irq_tsc = rdtsc();
+}
+
 /*============================================================================
  * Interrupt Polling Setup
  *============================================================================*/
@@ -289,8 +334,8 @@ int usb_hid_register(int usb_dev_index, int hid_type,
 
     struct usb_hid_device *hid = &hid_devices[slot];
     memset(hid, 0, sizeof(*hid));
-    hid->active = 1;
     hid->type = hid_type;
+    hid->hc = USB_HC_UHCI;
     hid->usb_dev_index = usb_dev_index;
     hid->address = address;
     hid->endpoint = ep_addr & 0x0F;
@@ -302,10 +347,11 @@ int usb_hid_register(int usb_dev_index, int hid_type,
     /* Set up interrupt polling */
     if (hid_setup_polling(hid) < 0) {
         kprintf("[USB HID] Failed to set up polling for device %d\n", address);
-        hid->active = 0;
         return -1;
     }
 
+    /* Publish last: the interrupt handler skips inactive devices */
+    __atomic_store_n(&hid->active, 1, __ATOMIC_RELEASE);
     hid_count++;
     kprintf("[USB HID] Registered %s at address %d endpoint %d\n",
             hid_type == USB_HID_KEYBOARD ? "keyboard" : "mouse",
@@ -316,10 +362,10 @@ int usb_hid_register(int usb_dev_index, int hid_type,
 void usb_hid_unregister(int usb_dev_index)
 {
     for (int i = 0; i < USB_HID_MAX_DEVICES; i++) {
-        if (hid_devices[i].active &&
+        if (hid_devices[i].active && hid_devices[i].hc == USB_HC_UHCI &&
             hid_devices[i].usb_dev_index == usb_dev_index) {
+            __atomic_store_n(&hid_devices[i].active, 0, __ATOMIC_RELEASE);
             hid_stop_polling(&hid_devices[i]);
-            hid_devices[i].active = 0;
             hid_count--;
             kprintf("[USB HID] Unregistered device at address %d\n",
                     hid_devices[i].address);
@@ -327,6 +373,63 @@ void usb_hid_unregister(int usb_dev_index)
     }
 }
 
+int usb_hid_attach(int hc, int usb_dev_index, int hid_type,
+                   uint8_t address, uint8_t ep_addr, uint16_t ep_mps,
+                   uint8_t interval)
+{
+    int slot = -1;
+    for (int i = 0; i < USB_HID_MAX_DEVICES; i++) {
+        if (!hid_devices[i].active) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        kprintf("[USB HID] No free HID device slots\n");
+        return -1;
+    }
+
+    struct usb_hid_device *hid = &hid_devices[slot];
+    memset(hid, 0, sizeof(*hid));
+    hid->type = hid_type;
+    hid->hc = hc;
+    hid->usb_dev_index = usb_dev_index;
+    hid->address = address;
+    hid->endpoint = ep_addr & 0x0F;
+    hid->max_packet = ep_mps;
+    hid->interval = interval;
+
+    __atomic_store_n(&hid->active, 1, __ATOMIC_RELEASE);
+    hid_count++;
+    kprintf("[USB HID] Registered %s at address %d endpoint %d\n",
+            hid_type == USB_HID_KEYBOARD ? "keyboard" : "mouse",
+            address, hid->endpoint);
+    return slot;
+}
+
+void usb_hid_detach(int hid_index)
+{
+    if (hid_index < 0 || hid_index >= USB_HID_MAX_DEVICES ||
+        !hid_devices[hid_index].active)
+        return;
+
+    __atomic_store_n(&hid_devices[hid_index].active, 0, __ATOMIC_RELEASE);
+    hid_count--;
+    kprintf("[USB HID] Unregistered device at address %d\n",
+            hid_devices[hid_index].address);
+}
+
+void usb_hid_deliver(int hid_index, const uint8_t *report, int len)
+{
+    if (hid_index < 0 || hid_index >= USB_HID_MAX_DEVICES)
+        return;
+    struct usb_hid_device *hid = &hid_devices[hid_index];
+    if (!__atomic_load_n(&hid->active, __ATOMIC_ACQUIRE))
+        return;
+    if (len > 0 && len <= 64)
+        hid_dispatch(hid, report, len);
+}
+
 void usb_hid_poll(void)
 {
     for (int i = 0; i < USB_HID_MAX_DEVICES; i++) {
@@ -360,13 +463,7 @@ void usb_hid_poll(void)
         /* Successful transfer — process data */
         int actual_len = (status & 0x7FF) + 1;  /* ActualLength field */
         if (actual_len > 0 && actual_len <= 64) {
-            if (hid->type == USB_HID_KEYBOARD) {
-                if (actual_len >= 8) {
-                    hid_process_keyboard(hid, hid->poll_buf);
-                }
-            } else if (hid->type == USB_HID_MOUSE) {
-                hid_process_mouse(hid, hid->poll_buf, actual_len);
-            }
+            hid_dispatch(hid, hid->poll_buf, actual_len);
         }
 
         /* Toggle data toggle */
@@ -426,8 +523,37 @@ void usb_hid_dump_status(void)
                 hid->endpoint,
                 hid->max_packet,
                 hid->interval);
-        kprintf("       %s, data toggle %d\n",
-                hid->low_speed ? "Low speed" : "Full speed",
-                hid->data_toggle);
+        if (hid->hc == USB_HC_UHCI) {
+            kprintf("       UHCI, %s, data toggle %d\n",
+                    hid->low_speed ? "Low speed" : "Full speed",
+                    hid->data_toggle);
+        } else {
+            kprintf("       xHCI slot %d\n", hid->usb_dev_index);
+        }
+
+        if (hid->reports == 0) {
+            kprintf("       No reports yet\n");
+            continue;
+        }
+        kprintf("       %lu reports, min interval %lu us, "
+                "dispatch avg %lu us max %lu us\n",
+                (unsigned long)hid->reports,
+                (unsigned long)(timer_tsc_to_ns(hid->gap_min) / 1000),
+                (unsigned long)(timer_tsc_to_ns(hid->lat_sum / hid->reports) / 1000),
+                (unsigned long)(timer_tsc_to_ns(hid->lat_max) / 1000));
+    }
+}
+
+void usb_hid_reset_stats(void)
+{
+    int was_enabled = interrupts_enabled();
+    cli();
+    for (int i = 0; i < USB_HID_MAX_DEVICES; i++) {
+        hid_devices[i].reports = 0;
+        hid_devices[i].gap_min = 0;
+        hid_devices[i].lat_sum = 0;
+        hid_devices[i].lat_max = 0;
     }
+    if (was_enabled)
+        sti();
 }
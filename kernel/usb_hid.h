@@ -3,7 +3,7 @@
  * "To Create, Not To Destroy"
  *
  * Handles USB HID keyboards and mice using boot protocol.
- * Injects input into existing PS/2 keyboard buffer and mouse state.
+ * Reports input through the shared input event ring (input.h).
  */
 
 #ifndef PHANTOMOS_USB_HID_H
@@ -20,6 +20,10 @@
 #define USB_HID_MOUSE           2
 #define USB_HID_MAX_DEVICES     4
 
+/* Host controller that runs a device's interrupt transfers */
+#define USB_HC_UHCI             0
+#define USB_HC_XHCI             1
+
 /*============================================================================
  * HID Device State
  *============================================================================*/
@@ -27,7 +31,8 @@
 struct usb_hid_device {
     int      active;                /* Device is active */
     int      type;                  /* USB_HID_KEYBOARD or USB_HID_MOUSE */
-    int      usb_dev_index;         /* Index into usb_device array */
+    int      hc;                    /* USB_HC_UHCI or USB_HC_XHCI */
+    int      usb_dev_index;         /* UHCI device index or xHCI slot ID */
     uint8_t  address;               /* USB device address */
     uint8_t  endpoint;              /* Interrupt IN endpoint number */
     uint16_t max_packet;            /* Max packet size */
@@ -40,6 +45,12 @@ struct usb_hid_device {
     uint8_t *poll_buf;              /* DMA buffer for poll data */
     /* Keyboard previous state (for key press/release detection) */
     uint8_t  prev_report[8];
+    /* Report timing (TSC cycles) */
+    uint64_t reports;               /* Reports dispatched */
+    uint64_t last_tsc;              /* When the previous report arrived */
+    uint64_t gap_min;               /* Shortest report-to-report interval */
+    uint64_t lat_sum;               /* Controller IRQ to input ring */
+    uint64_t lat_max;
 };
 
 /*============================================================================
@@ -54,16 +65,37 @@ int usb_hid_register(int usb_dev_index, int hid_type,
                      uint8_t address, uint8_t low_speed,
                      uint8_t ep_addr, uint16_t ep_mps, uint8_t interval);
 
-/* Unregister a HID device (on disconnect) */
+/* Unregister a UHCI HID device (on disconnect) */
 void usb_hid_unregister(int usb_dev_index);
 
-/* Poll all HID devices for new data */
+/* Register a HID interface whose interrupt transfers another host
+ * controller runs; its reports arrive through usb_hid_deliver().
+ * Returns the HID index, or -1 */
+int usb_hid_attach(int hc, int usb_dev_index, int hid_type,
+                   uint8_t address, uint8_t ep_addr, uint16_t ep_mps,
+                   uint8_t interval);
+
+/* Remove a device registered with usb_hid_attach() */
+void usb_hid_detach(int hid_index);
+
+/* Hand a completed interrupt IN report to the HID layer (interrupt
+ * context, or task context with interrupts disabled) */
+void usb_hid_deliver(int hid_index, const uint8_t *report, int len);
+
+/* Controller interrupt entry: timestamp for report dispatch latency */
+void usb_hid_irq_mark(void);
+
+/* Process completed interrupt TDs and re-arm them (UHCI IRQ handler, or
+ * usb_poll() with interrupts disabled when running without an IRQ) */
 void usb_hid_poll(void);
 
 /* Get number of active HID devices */
 int usb_hid_device_count(void);
 
-/* Print HID device info for shell */
+/* Print HID device info and report timing for shell */
 void usb_hid_dump_status(void);
 
+/* Clear report timing statistics */
+void usb_hid_reset_stats(void);
+
 #endif /* PHANTOMOS_USB_HID_H */
@@ -0,0 +1,457 @@
+/*
+ * PhantomOS USB Mass Storage (Bulk-Only Transport)
+ * "To Create, Not To Destroy"
+ *
+ * Data moves through a 64 KB physically contiguous bounce buffer, so
+ * callers may pass any kernel pointer and each SCSI command carries up to
+ * 128 sectors. Commands are serialized by a lock; transport errors run the
+ * BOT reset recovery (reset, then clear both pipes) before failing.
+ */
+
+#include "usb_msc.h"
+#include "process.h"
+#include "timer.h"
+#include "pmm.h"
+#include "io.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/*============================================================================
+ * External Declarations
+ *============================================================================*/
+
+extern int kprintf(const char *fmt, ...);
+extern void *memset(void *s, int c, size_t n);
+extern void *memcpy(void *dest, const void *src, size_t n);
+
+/*============================================================================
+ * Bulk-Only Transport Wrappers
+ *============================================================================*/
+
+#define MSC_CBW_SIGNATURE       0x43425355      /* "USBC" */
+#define MSC_CSW_SIGNATURE       0x53425355      /* "USBS" */
+#define MSC_CBW_DIR_IN          0x80
+
+#define MSC_CSW_PASSED          0
+#define MSC_CSW_FAILED          1
+#define MSC_CSW_PHASE_ERROR     2
+
+struct msc_cbw {
+    uint32_t signature;
+    uint32_t tag;
+    uint32_t data_length;
+    uint8_t  flags;
+    uint8_t  lun;
+    uint8_t  cb_length;
+    uint8_t  cb[16];
+} __attribute__((packed));              /* 31 bytes */
+
+struct msc_csw {
+    uint32_t signature;
+    uint32_t tag;
+    uint32_t residue;
+    uint8_t  status;
+} __attribute__((packed));              /* 13 bytes */
+
+/*============================================================================
+ * SCSI Commands
+ *============================================================================*/
+
+#define SCSI_TEST_UNIT_READY    0x00
+#define SCSI_REQUEST_SENSE      0x03
+#define SCSI_INQUIRY            0x12
+#define SCSI_READ_CAPACITY_10   0x25
+#define SCSI_READ_10            0x28
+#define SCSI_WRITE_10           0x2A
+#define SCSI_SYNC_CACHE_10      0x35
+
+#define MSC_READY_RETRIES       10
+
+/*============================================================================
+ * State
+ *============================================================================*/
+
+static struct {
+    int      attached;
+    struct usb_msc_transport tp;
+    uint32_t tag;
+    uint64_t sectors;
+    uint32_t block_size;
+    char     vendor[9];
+    char     product[17];
+    /* DMA memory */
+    struct msc_cbw *cbw;
+    struct msc_csw *csw;
+    uint8_t *small;                     /* INQUIRY/CAPACITY/SENSE data */
+    uint8_t *bounce;                    /* USB_MSC_XFER_MAX bytes */
+    struct usb_msc_stats stats;
+} msc;
+
+static volatile int msc_lock_flag = 0;
+
+static void msc_lock(void)
+{
+    while (__atomic_exchange_n(&msc_lock_flag, 1, __ATOMIC_ACQUIRE))
+        sched_yield();
+}
+
+static void msc_unlock(void)
+{
+    __atomic_store_n(&msc_lock_flag, 0, __ATOMIC_RELEASE);
+}
+
+static inline void put_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static inline uint32_t get_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | p[3];
+}
+
+/*============================================================================
+ * Transport
+ *============================================================================*/
+
+static void msc_reset_recovery(void)
+{
+    if (msc.tp.reset)
+        msc.tp.reset(msc.tp.ctx);
+    msc.tp.clear_halt(msc.tp.ctx, 1);
+    msc.tp.clear_halt(msc.tp.ctx, 0);
+}
+
+static int msc_read_csw(void)
+{
+    uint32_t actual = 0;
+    int rc = msc.tp.bulk(msc.tp.ctx, 1, msc.csw, sizeof(struct msc_csw),
+                         &actual);
+    if (rc == USB_MSC_STALL) {
+        /* A stalled data phase can leave the CSW behind a halt: retry once */
+        msc.tp.clear_halt(msc.tp.ctx, 1);
+        rc = msc.tp.bulk(msc.tp.ctx, 1, msc.csw, sizeof(struct msc_csw),
+                         &actual);
+    }
+    if (rc != USB_MSC_OK || actual != sizeof(struct msc_csw))
+        return -1;
+    return 0;
+}
+
+/*
+ * Run one SCSI command. data is DMA memory (msc.small or msc.bounce).
+ * Returns 0 if the device reported success.
+ */
+static int msc_command(const uint8_t *cb, uint8_t cb_len, int dir_in,
+                       void *data, uint32_t len)
+{
+    uint32_t actual = 0;
+    int rc;
+
+    msc.stats.commands++;
+
+    memset(msc.cbw, 0, sizeof(struct msc_cbw));
+    msc.cbw->signature = MSC_CBW_SIGNATURE;
+    msc.cbw->tag = ++msc.tag;
+    msc.cbw->data_length = len;
+    msc.cbw->flags = dir_in ? MSC_CBW_DIR_IN : 0;
+    msc.cbw->lun = 0;
+    msc.cbw->cb_length = cb_len;
+    memcpy(msc.cbw->cb, cb, cb_len);
+
+    rc = msc.tp.bulk(msc.tp.ctx, 0, msc.cbw, sizeof(struct msc_cbw), &actual);
+    if (rc != USB_MSC_OK) {
+        msc_reset_recovery();
+        goto fail;
+    }
+
+    if (len) {
+        rc = msc.tp.bulk(msc.tp.ctx, dir_in, data, len, &actual);
+        if (rc == USB_MSC_STALL)
+            msc.tp.clear_halt(msc.tp.ctx, dir_in);
+        else if (rc != USB_MSC_OK) {
+            msc_reset_recovery();
+            goto fail;
+        }
+    }
+
+    if (msc_read_csw() < 0) {
+        msc_reset_recovery();
+        goto fail;
+    }
+    if (msc.csw->signature != MSC_CSW_SIGNATURE || msc.csw->tag != msc.tag ||
+        msc.csw->status == MSC_CSW_PHASE_ERROR) {
+        msc_reset_recovery();
+        goto fail;
+    }
+    if (msc.csw->status != MSC_CSW_PASSED || rc != USB_MSC_OK)
+        goto fail;
+    return 0;
+
+fail:
+    msc.stats.errors++;
+    return -1;
+}
+
+/*============================================================================
+ * SCSI Helpers
+ *============================================================================*/
+
+static int scsi_simple(uint8_t opcode, uint32_t lba, uint16_t blocks,
+                       int dir_in, void *data, uint32_t len)
+{
+    uint8_t cb[10];
+    memset(cb, 0, sizeof(cb));
+    cb[0] = opcode;
+    put_be32(&cb[2], lba);
+    cb[7] = (uint8_t)(blocks >> 8);
+    cb[8] = (uint8_t)blocks;
+    return msc_command(cb, 10, dir_in, data, len);
+}
+
+static int scsi_inquiry(void)
+{
+    uint8_t cb[6] = { SCSI_INQUIRY, 0, 0, 0, 36, 0 };
+    memset(msc.small, 0, 36);
+    if (msc_command(cb, 6, 1, msc.small, 36) < 0)
+        return -1;
+
+    /* Bytes 8-15 vendor, 16-31 product, space padded */
+    memcpy(msc.vendor, msc.small + 8, 8);
+    msc.vendor[8] = '\0';
+    memcpy(msc.product, msc.small + 16, 16);
+    msc.product[16] = '\0';
+    for (int i = 7; i >= 0 && msc.vendor[i] == ' '; i--)
+        msc.vendor[i] = '\0';
+    for (int i = 15; i >= 0 && msc.product[i] == ' '; i--)
+        msc.product[i] = '\0';
+    return 0;
+}
+
+static void scsi_request_sense(void)
+{
+    uint8_t cb[6] = { SCSI_REQUEST_SENSE, 0, 0, 0, 18, 0 };
+    msc_command(cb, 6, 1, msc.small, 18);
+}
+
+static int scsi_wait_ready(void)
+{
+    uint8_t cb[6] = { SCSI_TEST_UNIT_READY, 0, 0, 0, 0, 0 };
+
+    /* Fresh devices report UNIT ATTENTION first; sense clears it */
+    for (int i = 0; i < MSC_READY_RETRIES; i++) {
+        if (msc_command(cb, 6, 0, NULL, 0) == 0)
+            return 0;
+        scsi_request_sense();
+        timer_sleep_ms(50);
+    }
+    return -1;
+}
+
+static int scsi_read_capacity(void)
+{
+    memset(msc.small, 0, 8);
+    if (scsi_simple(SCSI_READ_CAPACITY_10, 0, 0, 1, msc.small, 8) < 0)
+        return -1;
+    msc.sectors = (uint64_t)get_be32(msc.small) + 1;
+    msc.block_size = get_be32(msc.small + 4);
+    return 0;
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+int usb_msc_attach(const struct usb_msc_transport *tp)
+{
+    if (!tp || !tp->bulk || !tp->clear_halt)
+        return -1;
+    if (msc.attached) {
+        kprintf("[USB MSC] A disk is already attached\n");
+        return -1;
+    }
+
+    if (!msc.cbw) {
+        uint8_t *page = pmm_alloc_page();
+        uint8_t *bounce = pmm_alloc_pages(USB_MSC_XFER_MAX / PAGE_SIZE);
+        if (!page || !bounce) {
+            if (page) pmm_free_page(page);
+            if (bounce) pmm_free_pages(bounce, USB_MSC_XFER_MAX / PAGE_SIZE);
+            kprintf("[USB MSC] Out of DMA memory\n");
+            return -1;
+        }
+        memset(page, 0, PAGE_SIZE);
+        msc.cbw = (struct msc_cbw *)page;
+        msc.csw = (struct msc_csw *)(page + 64);
+        msc.small = page + 128;
+        msc.bounce = bounce;
+    }
+
+    msc_lock();
+    msc.tp = *tp;
+    msc.tag = 0;
+
+    int ok = scsi_inquiry() == 0 &&
+             scsi_wait_ready() == 0 &&
+             scsi_read_capacity() == 0;
+    if (ok && msc.block_size != USB_MSC_SECTOR_SIZE) {
+        kprintf("[USB MSC] %u-byte blocks not supported\n", msc.block_size);
+        ok = 0;
+    }
+    if (ok)
+        msc.attached = 1;
+    msc_unlock();
+
+    if (!ok) {
+        kprintf("[USB MSC] Device did not respond to SCSI probe\n");
+        return -1;
+    }
+
+    kprintf("[USB MSC] Disk: %s %s, %lu sectors (%lu MB)\n",
+            msc.vendor, msc.product, (unsigned long)msc.sectors,
+            (unsigned long)(msc.sectors / 2048));
+    return 0;
+}
+
+void usb_msc_detach(void *ctx)
+{
+    msc_lock();
+    if (msc.attached && msc.tp.ctx == ctx) {
+        msc.attached = 0;
+        kprintf("[USB MSC] Disk removed\n");
+    }
+    msc_unlock();
+}
+
+int usb_msc_present(void)
+{
+    return msc.attached;
+}
+
+uint64_t usb_msc_sectors(void)
+{
+    return msc.attached ? msc.sectors : 0;
+}
+
+static int msc_check_range(uint64_t lba, uint32_t count)
+{
+    if (!msc.attached || count == 0)
+        return -1;
+    if (lba + count > msc.sectors || lba + count > 0xFFFFFFFFULL)
+        return -1;
+    return 0;
+}
+
+int usb_msc_read(uint64_t lba, uint32_t count, void *buf)
+{
+    uint8_t *dst = (uint8_t *)buf;
+    int rc = 0;
+
+    msc_lock();
+    if (msc_check_range(lba, count) < 0) {
+        msc_unlock();
+        return -1;
+    }
+
+    uint64_t t0 = rdtsc();
+    while (count > 0) {
+        uint32_t n = count;
+        if (n > USB_MSC_XFER_MAX / USB_MSC_SECTOR_SIZE)
+            n = USB_MSC_XFER_MAX / USB_MSC_SECTOR_SIZE;
+        uint32_t bytes = n * USB_MSC_SECTOR_SIZE;
+
+        if (scsi_simple(SCSI_READ_10, (uint32_t)lba, (uint16_t)n, 1,
+                        msc.bounce, bytes) < 0) {
+            rc = -1;
+            break;
+        }
+        memcpy(dst, msc.bounce, bytes);
+        msc.stats.read_bytes += bytes;
+        dst += bytes;
+        lba += n;
+        count -= n;
+    }
+    msc.stats.read_cycles += rdtsc() - t0;
+
+    msc_unlock();
+    return rc;
+}
+
+int usb_msc_write(uint64_t lba, uint32_t count, const void *buf)
+{
+    const uint8_t *src = (const uint8_t *)buf;
+    int rc = 0;
+
+    msc_lock();
+    if (msc_check_range(lba, count) < 0) {
+        msc_unlock();
+        return -1;
+    }
+
+    uint64_t t0 = rdtsc();
+    while (count > 0) {
+        uint32_t n = count;
+        if (n > USB_MSC_XFER_MAX / USB_MSC_SECTOR_SIZE)
+            n = USB_MSC_XFER_MAX / USB_MSC_SECTOR_SIZE;
+        uint32_t bytes = n * USB_MSC_SECTOR_SIZE;
+
+        memcpy(msc.bounce, src, bytes);
+        if (scsi_simple(SCSI_WRITE_10, (uint32_t)lba, (uint16_t)n, 0,
+                        msc.bounce, bytes) < 0) {
+            rc = -1;
+            break;
+        }
+        msc.stats.write_bytes += bytes;
+        src += bytes;
+        lba += n;
+        count -= n;
+    }
+    msc.stats.write_cycles += rdtsc() - t0;
+
+    msc_unlock();
+    return rc;
+}
+
+int usb_msc_flush(void)
+{
+    msc_lock();
+    int rc = msc.attached ? scsi_simple(SCSI_SYNC_CACHE_10, 0, 0, 0, NULL, 0)
+                          : -1;
+    msc_unlock();
+    return rc;
+}
+
+void usb_msc_get_stats(struct usb_msc_stats *out)
+{
+    if (out)
+        *out = msc.stats;
+}
+
+void usb_msc_reset_stats(void)
+{
+    memset(&msc.stats, 0, sizeof(msc.stats));
+}
+
+void usb_msc_dump_status(void)
+{
+    kprintf("\nUSB Mass Storage\n");
+    kprintf("================\n");
+
+    if (!msc.attached) {
+        kprintf("  No disk attached\n");
+        return;
+    }
+
+    kprintf("  %s %s: %lu sectors (%lu MB), %u-byte blocks\n",
+            msc.vendor, msc.product, (unsigned long)msc.sectors,
+            (unsigned long)(msc.sectors / 2048), msc.block_size);
+    kprintf("  %lu commands, %lu errors, %lu KB read, %lu KB written\n",
+            (unsigned long)msc.stats.commands,
+            (unsigned long)msc.stats.errors,
+            (unsigned long)(msc.stats.read_bytes / 1024),
+            (unsigned long)(msc.stats.write_bytes / 1024));
+}
@@ -0,0 +1,95 @@
+/*
+ * PhantomOS USB Mass Storage (Bulk-Only Transport)
+ * "To Create, Not To Destroy"
+ *
+ * SCSI block access to a USB disk over the Bulk-Only Transport: each
+ * command is a 31-byte CBW on the bulk OUT endpoint, an optional data
+ * phase, and a 13-byte CSW on bulk IN. The host controller driver supplies
+ * the bulk pipes through struct usb_msc_transport, so this layer has no
+ * controller-specific code.
+ *
+ * One disk (LUN 0 of the first mass-storage interface) is supported, with
+ * 512-byte blocks and 32-bit LBAs (READ(10)/WRITE(10)). GeoFS reaches it
+ * as drive KGEOFS_DRIVE_USB.
+ */
+
+#ifndef PHANTOMOS_USB_MSC_H
+#define PHANTOMOS_USB_MSC_H
+
+#include <stdint.h>
+
+/*============================================================================
+ * Class Codes
+ *============================================================================*/
+
+#define USB_CLASS_MASS_STORAGE  0x08
+#define USB_MSC_SUBCLASS_SCSI   0x06
+#define USB_MSC_PROTOCOL_BOT    0x50
+
+/* Class requests */
+#define USB_REQ_MSC_RESET       0xFF    /* Bulk-Only Mass Storage Reset */
+
+#define USB_MSC_SECTOR_SIZE     512
+#define USB_MSC_XFER_MAX        (64 * 1024)     /* Bytes per SCSI command */
+
+/* Transport return codes */
+#define USB_MSC_OK              0
+#define USB_MSC_ERR             (-1)
+#define USB_MSC_STALL           (-2)            /* Endpoint halted */
+
+/*============================================================================
+ * Transport (implemented by the host controller driver)
+ *============================================================================*/
+
+struct usb_msc_transport {
+    void *ctx;
+    /* Bulk transfer on the IN or OUT pipe. buf is identity-mapped DMA
+     * memory. Returns USB_MSC_OK with *actual set, or an error */
+    int (*bulk)(void *ctx, int in, void *buf, uint32_t len, uint32_t *actual);
+    /* Clear a halted pipe on both the controller and the device */
+    int (*clear_halt)(void *ctx, int in);
+    /* Bulk-Only Mass Storage Reset on the interface */
+    int (*reset)(void *ctx);
+};
+
+/*============================================================================
+ * Statistics
+ *============================================================================*/
+
+struct usb_msc_stats {
+    uint64_t read_bytes;
+    uint64_t read_cycles;               /* TSC cycles spent in usb_msc_read */
+    uint64_t write_bytes;
+    uint64_t write_cycles;
+    uint64_t commands;
+    uint64_t errors;
+};
+
+/*============================================================================
+ * API
+ *============================================================================*/
+
+/* Probe the device behind transport (INQUIRY, TEST UNIT READY, READ
+ * CAPACITY) and make it the USB disk. 0 on success */
+int usb_msc_attach(const struct usb_msc_transport *tp);
+
+/* Forget the disk if it uses this transport context (on disconnect) */
+void usb_msc_detach(void *ctx);
+
+int usb_msc_present(void);
+uint64_t usb_msc_sectors(void);
+
+/* Transfer count 512-byte sectors starting at lba. 0 on success */
+int usb_msc_read(uint64_t lba, uint32_t count, void *buf);
+int usb_msc_write(uint64_t lba, uint32_t count, const void *buf);
+
+/* SYNCHRONIZE CACHE */
+int usb_msc_flush(void);
+
+void usb_msc_get_stats(struct usb_msc_stats *out);
+void usb_msc_reset_stats(void);
+
+/* Print disk info for shell */
+void usb_msc_dump_status(void);
+
+#endif /* PHANTOMOS_USB_MSC_H */
@@ -15,6 +15,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #include "vfs.h"
 #include "phantom.h"
@@ -178,25 +180,201 @@ static struct vfs_dentry *dentry_alloc(const char *name) {
     return dentry;
 }
 
-static struct vfs_dentry *dentry_lookup_child(struct vfs_dentry *parent, const char *name) {
-    if (!parent || !name) return NULL;
+/* ══════════════════════════════════════════════════════════════════════════════
+ * DENTRY CACHE
+ * Dentries hashed by (parent, name), so a lookup costs the same however
+ * big the directory. Misses the file system confirmed are cached as
+ * negative dentries, checked against its generation and dropped when the
+ * name is created through the VFS.
+ * ══════════════════════════════════════════════════════════════════════════════ */
 
-    struct vfs_dentry *child = parent->children;
-    while (child) {
-        if (!child->is_hidden && strcmp(child->name, name) == 0) {
-            return child;
+/* FNV-1a */
+static uint32_t dcache_name_hash(const char *name, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)name[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static uint64_t dcache_bucket(const struct vfs_dcache *dc, const struct vfs_dentry *parent,
+                              uint32_t name_hash) {
+    uint64_t key = ((uint64_t)(uintptr_t)parent >> 4) * 0x9E3779B97F4A7C15ULL ^ name_hash;
+    return (key ^ (key >> 29)) & (dc->nbuckets - 1);
+}
+
+static int dcache_match(const struct vfs_dentry *d, const struct vfs_dentry *parent,
+                        uint32_t name_hash, const char *name, size_t len) {
+    return d->parent == parent && d->name_hash == name_hash &&
+           strncmp(d->name, name, len) == 0 && d->name[len] == '\0';
+}
+
+static void dcache_grow(struct vfs_dcache *dc) {
+    uint64_t nbuckets = dc->nbuckets ? dc->nbuckets * 2 : VFS_DCACHE_MIN_BUCKETS;
+    struct vfs_dentry **buckets = calloc(nbuckets, sizeof(*buckets));
+    if (!buckets) return;   /* Chains just get longer */
+
+    struct vfs_dcache old = *dc;
+    dc->buckets = buckets;
+    dc->nbuckets = nbuckets;
+    for (uint64_t b = 0; b < old.nbuckets; b++) {
+        struct vfs_dentry *d = old.buckets[b];
+        while (d) {
+            struct vfs_dentry *next = d->hash_next;
+            uint64_t nb = dcache_bucket(dc, d->parent, d->name_hash);
+            d->hash_next = buckets[nb];
+            buckets[nb] = d;
+            d = next;
+        }
+    }
+    free(old.buckets);
+}
+
+static void dcache_insert(struct vfs_dcache *dc, struct vfs_dentry *d) {
+    if (dc->count >= dc->nbuckets) dcache_grow(dc);
+    if (!dc->nbuckets) return;
+    uint64_t b = dcache_bucket(dc, d->parent, d->name_hash);
+    d->hash_next = dc->buckets[b];
+    dc->buckets[b] = d;
+    dc->count++;
+}
+
+static void dcache_unhash(struct vfs_dcache *dc, struct vfs_dentry *d) {
+    struct vfs_dentry **pp = &dc->buckets[dcache_bucket(dc, d->parent, d->name_hash)];
+    while (*pp && *pp != d) pp = &(*pp)->hash_next;
+    if (*pp) {
+        *pp = d->hash_next;
+        dc->count--;
+    }
+}
+
+static void dcache_lru_unlink(struct vfs_dcache *dc, struct vfs_dentry *d) {
+    if (d->lru_prev) d->lru_prev->lru_next = d->lru_next;
+    else dc->lru_head = d->lru_next;
+    if (d->lru_next) d->lru_next->lru_prev = d->lru_prev;
+    else dc->lru_tail = d->lru_prev;
+    d->lru_prev = d->lru_next = NULL;
+}
+
+static void dcache_lru_push(struct vfs_dcache *dc, struct vfs_dentry *d) {
+    d->lru_prev = NULL;
+    d->lru_next = dc->lru_head;
+    if (dc->lru_head) dc->lru_head->lru_prev = d;
+    else dc->lru_tail = d;
+    dc->lru_head = d;
+}
+
+static void dcache_drop_negative(struct vfs_dcache *dc, struct vfs_dentry *d) {
+    dcache_unhash(dc, d);
+    dcache_lru_unlink(dc, d);
+    dc->negative--;
+    free(d);
+}
+
+/*
+ * Generation of the file system behind a directory, for negative entries.
+ * 0 if it has none and misses there mustn't be cached.
+ */
+static int dcache_generation(const struct vfs_dentry *dir, uint64_t *gen_out) {
+    struct vfs_superblock *sb = dir->inode ? dir->inode->sb : NULL;
+    if (!sb || !sb->fs_type || !sb->fs_type->generation) return 0;
+    *gen_out = sb->fs_type->generation(sb);
+    return 1;
+}
+
+/*
+ * Find name (len bytes) under parent. Returns a visible tree dentry, a
+ * still-valid negative one, or NULL if the file system must be asked.
+ */
+static struct vfs_dentry *dcache_lookup(struct vfs_dcache *dc, struct vfs_dentry *parent,
+                                        const char *name, size_t len) {
+    if (!dc->nbuckets) return NULL;
+    uint32_t h = dcache_name_hash(name, len);
+    struct vfs_dentry *d = dc->buckets[dcache_bucket(dc, parent, h)];
+    while (d) {
+        struct vfs_dentry *next = d->hash_next;
+        if (dcache_match(d, parent, h, name, len) && !d->is_hidden) {
+            if (!d->is_negative) return d;
+
+            uint64_t gen;
+            if (dcache_generation(parent, &gen) && gen == d->generation) {
+                dcache_lru_unlink(dc, d);
+                dcache_lru_push(dc, d);
+                return d;
+            }
+            dcache_drop_negative(dc, d);    /* Stale */
         }
-        child = child->sibling;
+        d = next;
     }
     return NULL;
 }
 
-static void dentry_add_child(struct vfs_dentry *parent, struct vfs_dentry *child) {
+/* Remember that name doesn't exist under parent, if its file system allows */
+static void dcache_add_negative(struct vfs_dcache *dc, struct vfs_dentry *parent,
+                                const char *name) {
+    uint64_t gen;
+    if (!dcache_generation(parent, &gen)) return;
+
+    struct vfs_dentry *d = calloc(1, sizeof(struct vfs_dentry));
+    if (!d) return;
+    strncpy(d->name, name, VFS_MAX_NAME);
+    d->parent = parent;
+    d->name_hash = dcache_name_hash(d->name, strlen(d->name));
+    d->is_negative = 1;
+    d->generation = gen;
+
+    while (dc->negative >= VFS_DCACHE_MAX_NEGATIVE && dc->lru_tail) {
+        dcache_drop_negative(dc, dc->lru_tail);
+    }
+    dcache_insert(dc, d);
+    dcache_lru_push(dc, d);
+    dc->negative++;
+}
+
+static void dcache_destroy(struct vfs_dcache *dc) {
+    while (dc->lru_head) {
+        struct vfs_dentry *d = dc->lru_head;
+        dc->lru_head = d->lru_next;
+        free(d);
+    }
+    free(dc->buckets);
+    dc->buckets = NULL;
+    dc->nbuckets = dc->count = dc->negative = 0;
+    dc->lru_head = dc->lru_tail = NULL;
+}
+
+static struct vfs_dentry *dentry_lookup_child(struct vfs_context *ctx,
+                                              struct vfs_dentry *parent, const char *name) {
+    if (!parent || !name) return NULL;
+
+    struct vfs_dentry *d = dcache_lookup(&ctx->dcache, parent, name, strlen(name));
+    return d && !d->is_negative ? d : NULL;
+}
+
+/* Link child into the tree and the cache, replacing a negative entry for its name */
+static void dentry_add_child(struct vfs_context *ctx, struct vfs_dentry *parent,
+                             struct vfs_dentry *child) {
     if (!parent || !child) return;
 
+    struct vfs_dcache *dc = &ctx->dcache;
     child->parent = parent;
     child->sibling = parent->children;
     parent->children = child;
+    child->name_hash = dcache_name_hash(child->name, strlen(child->name));
+
+    if (dc->nbuckets) {
+        struct vfs_dentry *d = dc->buckets[dcache_bucket(dc, parent, child->name_hash)];
+        while (d) {
+            struct vfs_dentry *next = d->hash_next;
+            if (d->is_negative && dcache_match(d, parent, child->name_hash,
+                                               child->name, strlen(child->name))) {
+                dcache_drop_negative(dc, d);
+            }
+            d = next;
+        }
+    }
+    dcache_insert(dc, child);
 }
 
 static void dentry_free_recursive(struct vfs_dentry *dentry) {
@@ -290,6 +468,9 @@ vfs_error_t vfs_init(struct vfs_context *ctx) {
     ctx->root = dentry_alloc("");
     if (!ctx->root) return VFS_ERR_NOMEM;
 
+    dcache_grow(&ctx->dcache);
+    if (!ctx->dcache.buckets) return VFS_ERR_NOMEM;
+
     /* Create root inode */
     struct vfs_inode *root_inode = inode_alloc(NULL, VFS_TYPE_DIRECTORY);
     if (!root_inode) return VFS_ERR_NOMEM;
@@ -312,6 +493,9 @@ void vfs_shutdown(struct vfs_context *ctx) {
         }
     }
 
+    /* Negative dentries belong to the cache; the rest go with their trees */
+    dcache_destroy(&ctx->dcache);
+
     /* Free the root dentry tree */
     if (ctx->root) {
         dentry_free_recursive(ctx->root);
@@ -355,6 +539,8 @@ void vfs_shutdown(struct vfs_context *ctx) {
     printf("    Total writes:        %lu\n", ctx->total_writes);
     printf("    Total bytes read:    %lu\n", ctx->total_bytes_read);
     printf("    Total bytes written: %lu\n", ctx->total_bytes_written);
+    printf("    Dentry cache:        %lu hits, %lu negative hits, %lu misses\n",
+           ctx->dcache.hits, ctx->dcache.negative_hits, ctx->dcache.misses);
 }
 
 /* ══════════════════════════════════════════════════════════════════════════════
@@ -436,7 +622,7 @@ vfs_error_t vfs_mount(struct vfs_context *ctx,
 
         struct vfs_dentry *parent = ctx->root;
         for (int i = 0; i < count; i++) {
-            struct vfs_dentry *child = dentry_lookup_child(parent, components[i]);
+            struct vfs_dentry *child = dentry_lookup_child(ctx, parent, components[i]);
             if (!child) {
                 /* Create intermediate directory */
                 child = dentry_alloc(components[i]);
@@ -445,7 +631,7 @@ vfs_error_t vfs_mount(struct vfs_context *ctx,
                     return VFS_ERR_NOMEM;
                 }
                 child->inode = inode_alloc(NULL, VFS_TYPE_DIRECTORY);
-                dentry_add_child(parent, child);
+                dentry_add_child(ctx, parent, child);
             }
             parent = child;
         }
@@ -515,41 +701,55 @@ vfs_error_t vfs_resolve_path(struct vfs_context *ctx,
         return VFS_OK;
     }
 
-    /* Split path */
-    char components[64][VFS_MAX_NAME + 1];
-    int count = path_split(canonical_path, components, 64);
-
+    /* Walk the components in place, one cache lookup each */
     struct vfs_dentry *current = ctx->root;
+    const char *p = canonical_path;
 
-    for (int i = 0; i < count; i++) {
-        if (!current) return VFS_ERR_NOENT;
+    while (*p) {
+        while (*p == '/') p++;
+        if (!*p) break;
+        const char *name = p;
+        while (*p && *p != '/') p++;
+        size_t len = (size_t)(p - name);
 
         /* Handle "." and ".." */
-        if (strcmp(components[i], ".") == 0) {
+        if (len == 1 && name[0] == '.') {
             continue;
         }
-        if (strcmp(components[i], "..") == 0) {
+        if (len == 2 && name[0] == '.' && name[1] == '.') {
             if (current->parent) {
                 current = current->parent;
             }
             continue;
         }
+        if (len > VFS_MAX_NAME) return VFS_ERR_NOENT;
 
         /* Check if this is a mount point */
         if (current->mount && current->mount->root) {
             current = current->mount->root;
         }
 
-        /* First check in-memory dentry tree (for updated inodes) */
-        struct vfs_dentry *child = dentry_lookup_child(current, components[i]);
+        struct vfs_dentry *child = dcache_lookup(&ctx->dcache, current, name, len);
+        if (child && child->is_negative) {
+            ctx->dcache.negative_hits++;
+            return VFS_ERR_NOENT;
+        }
 
-        if (!child) {
-            /* Not in dentry cache - use filesystem lookup if available */
+        if (child) {
+            ctx->dcache.hits++;
+        } else {
+            /* Not cached - use filesystem lookup if available */
+            ctx->dcache.misses++;
+            char component[VFS_MAX_NAME + 1];
+            memcpy(component, name, len);
+            component[len] = '\0';
             if (current->inode && current->inode->ops && current->inode->ops->lookup) {
-                child = current->inode->ops->lookup(current->inode, components[i]);
+                child = current->inode->ops->lookup(current->inode, component);
                 if (child) {
                     /* Add to dentry tree for future lookups */
-                    dentry_add_child(current, child);
+                    dentry_add_child(ctx, current, child);
+                } else {
+                    dcache_add_negative(&ctx->dcache, current, component);
                 }
             }
         }
@@ -627,7 +827,7 @@ vfs_fd_t vfs_open(struct vfs_context *ctx, phantom_pid_t pid,
             return VFS_ERR_NOMEM;
         }
         dentry->inode = new_inode;
-        dentry_add_child(parent, dentry);
+        dentry_add_child(ctx, parent, dentry);
 
         if (parent->inode->sb) {
             parent->inode->sb->total_files_created++;
@@ -683,9 +883,11 @@ vfs_error_t vfs_close(struct vfs_context *ctx, vfs_fd_t fd) {
     struct vfs_file *file = fd_get(ctx, fd);
     if (!file) return VFS_ERR_BADF;
 
-    /* Call filesystem close if available */
+    /* Call filesystem close if available; the descriptor is released
+     * even if it fails, as with POSIX close */
+    vfs_error_t err = VFS_OK;
     if (file->inode->fops && file->inode->fops->close) {
-        file->inode->fops->close(file);
+        err = file->inode->fops->close(file);
     }
 
     inode_unref(file->inode);
@@ -694,7 +896,7 @@ vfs_error_t vfs_close(struct vfs_context *ctx, vfs_fd_t fd) {
     free(file);
     ctx->open_files[fd] = NULL;
 
-    return VFS_OK;
+    return err;
 }
 
 ssize_t vfs_read(struct vfs_context *ctx, vfs_fd_t fd, void *buf, size_t count) {
@@ -842,7 +1044,7 @@ vfs_error_t vfs_mkdir(struct vfs_context *ctx, phantom_pid_t pid,
     }
 
     /* Check if already exists */
-    if (dentry_lookup_child(parent, dirname)) {
+    if (dentry_lookup_child(ctx, parent, dirname)) {
         return VFS_ERR_EXIST;
     }
 
@@ -866,7 +1068,7 @@ vfs_error_t vfs_mkdir(struct vfs_context *ctx, phantom_pid_t pid,
     }
 
     dentry->inode = new_inode;
-    dentry_add_child(parent, dentry);
+    dentry_add_child(ctx, parent, dentry);
 
     printf("  [vfs] Created directory: %s\n", path);
     return VFS_OK;
@@ -937,17 +1139,7 @@ vfs_error_t vfs_readdir(struct vfs_context *ctx, vfs_fd_t fd,
  * FILE INFORMATION
  * ══════════════════════════════════════════════════════════════════════════════ */
 
-vfs_error_t vfs_stat(struct vfs_context *ctx, const char *path,
-                     struct vfs_stat *stat_out) {
-    if (!ctx || !path || !stat_out) return VFS_ERR_INVAL;
-
-    struct vfs_dentry *dentry = NULL;
-    vfs_error_t err = vfs_resolve_path(ctx, path, &dentry);
-    if (err != VFS_OK) return err;
-
-    if (!dentry->inode) return VFS_ERR_NOENT;
-
-    struct vfs_inode *inode = dentry->inode;
+static void inode_stat(const struct vfs_inode *inode, struct vfs_stat *stat_out) {
     stat_out->ino = inode->ino;
     stat_out->type = inode->type;
     stat_out->mode = inode->mode;
@@ -958,6 +1150,19 @@ vfs_error_t vfs_stat(struct vfs_context *ctx, const char *path,
     stat_out->modified = inode->modified;
     stat_out->accessed = inode->accessed;
     stat_out->owner_pid = inode->owner_pid;
+}
+
+vfs_error_t vfs_stat(struct vfs_context *ctx, const char *path,
+                     struct vfs_stat *stat_out) {
+    if (!ctx || !path || !stat_out) return VFS_ERR_INVAL;
+
+    struct vfs_dentry *dentry = NULL;
+    vfs_error_t err = vfs_resolve_path(ctx, path, &dentry);
+    if (err != VFS_OK) return err;
+
+    if (!dentry->inode) return VFS_ERR_NOENT;
+
+    inode_stat(dentry->inode, stat_out);
 
     return VFS_OK;
 }
@@ -969,17 +1174,7 @@ vfs_error_t vfs_fstat(struct vfs_context *ctx, vfs_fd_t fd,
     struct vfs_file *file = fd_get(ctx, fd);
     if (!file) return VFS_ERR_BADF;
 
-    struct vfs_inode *inode = file->inode;
-    stat_out->ino = inode->ino;
-    stat_out->type = inode->type;
-    stat_out->mode = inode->mode;
-    stat_out->nlink = inode->nlink;
-    stat_out->size = inode->size;
-    stat_out->blocks = (inode->size + 4095) / 4096;
-    stat_out->created = inode->created;
-    stat_out->modified = inode->modified;
-    stat_out->accessed = inode->accessed;
-    stat_out->owner_pid = inode->owner_pid;
+    inode_stat(file->inode, stat_out);
 
     return VFS_OK;
 }
@@ -1069,7 +1264,7 @@ vfs_error_t vfs_symlink(struct vfs_context *ctx, phantom_pid_t pid,
     }
 
     dentry->inode = new_inode;
-    dentry_add_child(parent, dentry);
+    dentry_add_child(ctx, parent, dentry);
 
     printf("  [vfs] Created symlink: %s -> %s\n", link_path, target);
     return VFS_OK;
@@ -1200,89 +1395,470 @@ vfs_error_t vfs_rename(struct vfs_context *ctx, phantom_pid_t pid,
 
 /* ══════════════════════════════════════════════════════════════════════════════
  * FILE SEARCH
- * Recursively search for files matching a pattern.
+ * Search the tree below a directory for names matching a pattern.
  * Pattern supports * (any chars) and ? (single char).
+ *
+ * The walk runs on a pool of workers, each owning a deque of directories.
+ * A worker pushes the subdirectories it finds and pops from the back, so
+ * it goes depth first; idle workers steal from the front, where the
+ * bigger subtrees wait. Listing and file system lookups run in parallel.
+ * Changes to the dentry tree and cache are serialized on the search's
+ * tree lock. Matches are queued for the calling thread, which runs the
+ * callback.
  * ══════════════════════════════════════════════════════════════════════════════ */
 
-/* Simple pattern matching */
-static int pattern_match(const char *pattern, const char *str) {
-    if (!pattern || !str) return 0;
+/* A pattern split at its *s into segments, in which ? matches any char */
+struct search_glob {
+    char               *text;           /* The segments, NUL terminated */
+    const char        **segs;
+    size_t             *lens;
+    size_t              nsegs;
+    size_t              min_len;        /* Of a matching name */
+    int                 star_start;
+    int                 star_end;
+};
+
+static void glob_free(struct search_glob *g) {
+    free(g->text);
+    free(g->segs);
+    free(g->lens);
+}
 
-    while (*pattern && *str) {
-        if (*pattern == '*') {
-            pattern++;
-            if (!*pattern) return 1;  /* Trailing * matches everything */
+static vfs_error_t glob_compile(const char *pattern, struct search_glob *g) {
+    memset(g, 0, sizeof(*g));
+    size_t len = strlen(pattern);
+    g->text = malloc(len + 1);
+    g->segs = malloc((len + 1) * sizeof(*g->segs));
+    g->lens = malloc((len + 1) * sizeof(*g->lens));
+    if (!g->text || !g->segs || !g->lens) {
+        glob_free(g);
+        return VFS_ERR_NOMEM;
+    }
 
-            /* Try matching rest from each position */
-            while (*str) {
-                if (pattern_match(pattern, str)) return 1;
-                str++;
-            }
-            return pattern_match(pattern, str);
-        } else if (*pattern == '?' || *pattern == *str) {
-            pattern++;
-            str++;
+    g->star_start = pattern[0] == '*';
+    g->star_end = len > 0 && pattern[len - 1] == '*';
+    char *out = g->text;
+    const char *p = pattern;
+    for (;;) {
+        while (*p == '*') p++;
+        if (!*p) break;
+        g->segs[g->nsegs] = out;
+        while (*p && *p != '*') *out++ = *p++;
+        g->lens[g->nsegs] = (size_t)(out - g->segs[g->nsegs]);
+        g->min_len += g->lens[g->nsegs++];
+        *out++ = '\0';
+    }
+    return VFS_OK;
+}
+
+/* Does segment i match at s, which has at least its length left? */
+static int glob_seg_at(const struct search_glob *g, size_t i, const char *s) {
+    const char *seg = g->segs[i];
+    for (size_t k = 0; k < g->lens[i]; k++) {
+        if (seg[k] != '?' && seg[k] != s[k]) return 0;
+    }
+    return 1;
+}
+
+/*
+ * Anchor the first segment at the start and the last at the end, unless
+ * a * stands there; the ones between go at their leftmost fit, which
+ * can't lose a match. No backtracking, so each name costs at most
+ * length times pattern.
+ */
+static int glob_match(const struct search_glob *g, const char *name) {
+    size_t n = strlen(name);
+    if (n < g->min_len) return 0;
+    if (g->nsegs == 0) return g->star_start || n == 0;
+
+    const char *s = name, *end = name + n;
+    size_t first = 0, last = g->nsegs;
+    if (!g->star_start) {
+        if (!glob_seg_at(g, 0, s)) return 0;
+        s += g->lens[0];
+        first = 1;
+        if (g->nsegs == 1 && !g->star_end) return s == end;
+    }
+    if (!g->star_end && last > first) {
+        size_t l = g->lens[last - 1];
+        if ((size_t)(end - s) < l || !glob_seg_at(g, last - 1, end - l)) return 0;
+        end -= l;
+        last--;
+    }
+    for (size_t i = first; i < last; i++) {
+        size_t l = g->lens[i];
+        while ((size_t)(end - s) >= l && !glob_seg_at(g, i, s)) s++;
+        if ((size_t)(end - s) < l) return 0;
+        s += l;
+    }
+    return 1;
+}
+
+/* A directory waiting to be listed */
+struct search_dir {
+    struct vfs_dentry  *dentry;
+    int                 depth;
+    char                path[];
+};
+
+/* One worker's directories, a ring; the owner works the back */
+struct search_deque {
+    pthread_mutex_t     lock;
+    struct search_dir **items;
+    size_t              head;
+    size_t              count;
+    size_t              capacity;
+};
+
+/* A match on its way to the caller */
+struct search_hit {
+    struct search_hit  *next;
+    struct vfs_stat     stat;
+    char                path[];
+};
+
+struct search_state {
+    struct vfs_context *ctx;
+    struct search_glob  glob;
+    uint64_t            max_results;
+    const volatile int *cancel;
+    struct search_deque *deques;
+    unsigned            nworkers;
+    pthread_mutex_t     tree_lock;
+
+    /* Directories queued or being listed, and of those queued; atomic */
+    uint64_t            pending;
+    uint64_t            queued;
+    uint64_t            found;              /* Results claimed, for the limit */
+    int                 stop;
+    int                 nomem;
+
+    /* Idle workers wait for pushes or the end of the walk */
+    pthread_mutex_t     idle_lock;
+    pthread_cond_t      idle_cond;
+    unsigned            idle;
+
+    /* Matches for the caller, newest first */
+    pthread_mutex_t     hit_lock;
+    pthread_cond_t      hit_cond;
+    struct search_hit  *hits;
+    unsigned            running;            /* Workers not yet finished */
+
+    uint64_t            directories;
+    uint64_t            entries;
+    uint64_t            steals;
+};
+
+struct search_worker {
+    struct search_state *st;
+    unsigned            id;
+    pthread_t           thread;
+    int                 started;
+};
+
+static int search_stopped(struct search_state *st) {
+    return __atomic_load_n(&st->stop, __ATOMIC_ACQUIRE) || (st->cancel && *st->cancel);
+}
+
+static void search_stop(struct search_state *st) {
+    __atomic_store_n(&st->stop, 1, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&st->idle_lock);
+    pthread_cond_broadcast(&st->idle_cond);
+    pthread_mutex_unlock(&st->idle_lock);
+}
+
+static int deque_push(struct search_deque *dq, struct search_dir *dir) {
+    pthread_mutex_lock(&dq->lock);
+    if (dq->count == dq->capacity) {
+        size_t cap = dq->capacity ? dq->capacity * 2 : 64;
+        struct search_dir **items = malloc(cap * sizeof(*items));
+        if (!items) {
+            pthread_mutex_unlock(&dq->lock);
+            return -1;
+        }
+        for (size_t i = 0; i < dq->count; i++) {
+            items[i] = dq->items[(dq->head + i) % dq->capacity];
+        }
+        free(dq->items);
+        dq->items = items;
+        dq->head = 0;
+        dq->capacity = cap;
+    }
+    dq->items[(dq->head + dq->count) % dq->capacity] = dir;
+    dq->count++;
+    pthread_mutex_unlock(&dq->lock);
+    return 0;
+}
+
+/* Owner takes the newest directory, a thief the oldest */
+static struct search_dir *deque_take(struct search_deque *dq, int steal) {
+    struct search_dir *dir = NULL;
+    pthread_mutex_lock(&dq->lock);
+    if (dq->count > 0) {
+        if (steal) {
+            dir = dq->items[dq->head];
+            dq->head = (dq->head + 1) % dq->capacity;
         } else {
-            return 0;
+            dir = dq->items[(dq->head + dq->count - 1) % dq->capacity];
         }
+        dq->count--;
     }
+    pthread_mutex_unlock(&dq->lock);
+    return dir;
+}
 
-    /* Handle trailing *s */
-    while (*pattern == '*') pattern++;
-    return (*pattern == '\0' && *str == '\0');
+static void search_push(struct search_state *st, unsigned id, struct vfs_dentry *dentry,
+                        int depth, const char *path) {
+    size_t len = strlen(path);
+    struct search_dir *dir = malloc(sizeof(*dir) + len + 1);
+    if (!dir) {
+        __atomic_store_n(&st->nomem, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    dir->dentry = dentry;
+    dir->depth = depth;
+    memcpy(dir->path, path, len + 1);
+
+    __atomic_add_fetch(&st->pending, 1, __ATOMIC_SEQ_CST);
+    if (deque_push(&st->deques[id], dir) != 0) {
+        __atomic_sub_fetch(&st->pending, 1, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&st->nomem, 1, __ATOMIC_RELAXED);
+        free(dir);
+        return;
+    }
+
+    /* An idle worker either sees queued move or gets the signal */
+    __atomic_add_fetch(&st->queued, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&st->idle, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&st->idle_lock);
+        pthread_cond_signal(&st->idle_cond);
+        pthread_mutex_unlock(&st->idle_lock);
+    }
 }
 
-/* Recursive search helper */
-static void vfs_search_recursive(struct vfs_context *ctx, const char *dir_path,
-                                 const char *pattern, vfs_search_callback_t callback,
-                                 void *user_ctx, int depth) {
-    if (depth > 32) return;  /* Prevent infinite recursion */
+static struct search_dir *search_take(struct search_state *st, unsigned id) {
+    struct search_dir *dir = deque_take(&st->deques[id], 0);
+    for (unsigned k = 1; !dir && k < st->nworkers; k++) {
+        dir = deque_take(&st->deques[(id + k) % st->nworkers], 1);
+        if (dir) __atomic_add_fetch(&st->steals, 1, __ATOMIC_RELAXED);
+    }
+    if (dir) __atomic_sub_fetch(&st->queued, 1, __ATOMIC_SEQ_CST);
+    return dir;
+}
 
-    /* Open directory */
-    vfs_fd_t fd = vfs_open(ctx, 1, dir_path, VFS_O_RDONLY | VFS_O_DIRECTORY, 0);
-    if (fd < 0) return;
+/* Directory listing, grown as the file system reports names */
+struct search_list {
+    struct vfs_dirent  *entries;
+    size_t              count;
+    size_t              capacity;
+    int                 nomem;
+};
+
+static void search_list_add(const char *name, vfs_ino_t ino, vfs_file_type_t type,
+                            void *ctx) {
+    struct search_list *list = ctx;
+    if (list->count == list->capacity) {
+        size_t cap = list->capacity ? list->capacity * 2 : 64;
+        struct vfs_dirent *entries = realloc(list->entries, cap * sizeof(*entries));
+        if (!entries) {
+            list->nomem = 1;
+            return;
+        }
+        list->entries = entries;
+        list->capacity = cap;
+    }
+    struct vfs_dirent *e = &list->entries[list->count++];
+    e->ino = ino;
+    e->type = type;
+    strncpy(e->name, name, VFS_MAX_NAME);
+    e->name[VFS_MAX_NAME] = '\0';
+}
 
-    /* Read entries */
-    struct vfs_dirent entries[64];
-    size_t count;
+/*
+ * The dentry for a name listed in dir. A name the cache doesn't know goes
+ * to the file system outside the tree lock; only this worker lists dir,
+ * so nobody else adds the name meanwhile.
+ */
+static struct vfs_dentry *search_child(struct search_state *st, struct vfs_dentry *dir,
+                                       const char *name) {
+    struct vfs_context *ctx = st->ctx;
+    pthread_mutex_lock(&st->tree_lock);
+    struct vfs_dentry *child = dcache_lookup(&ctx->dcache, dir, name, strlen(name));
+    int negative = child && child->is_negative;
+    pthread_mutex_unlock(&st->tree_lock);
+    if (child) return negative ? NULL : child;
+    if (!dir->inode->ops || !dir->inode->ops->lookup) return NULL;
+
+    child = dir->inode->ops->lookup(dir->inode, name);
+    if (child) {
+        pthread_mutex_lock(&st->tree_lock);
+        dentry_add_child(ctx, dir, child);
+        pthread_mutex_unlock(&st->tree_lock);
+    }
+    return child;
+}
 
-    if (vfs_readdir(ctx, fd, entries, 64, &count) == VFS_OK) {
-        for (size_t i = 0; i < count; i++) {
-            /* Skip . and .. */
-            if (strcmp(entries[i].name, ".") == 0 ||
-                strcmp(entries[i].name, "..") == 0) {
-                continue;
-            }
+static void search_hit(struct search_state *st, const char *path,
+                       const struct vfs_inode *inode) {
+    if (st->max_results) {
+        uint64_t n = __atomic_add_fetch(&st->found, 1, __ATOMIC_RELAXED);
+        if (n > st->max_results) return;
+        if (n == st->max_results) search_stop(st);
+    }
 
-            /* Build full path */
-            char full_path[VFS_MAX_PATH];
-            if (strcmp(dir_path, "/") == 0) {
-                snprintf(full_path, sizeof(full_path), "/%s", entries[i].name);
-            } else {
-                snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, entries[i].name);
-            }
+    size_t len = strlen(path);
+    struct search_hit *hit = malloc(sizeof(*hit) + len + 1);
+    if (!hit) {
+        __atomic_store_n(&st->nomem, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    inode_stat(inode, &hit->stat);
+    memcpy(hit->path, path, len + 1);
 
-            /* Check if name matches pattern */
-            if (pattern_match(pattern, entries[i].name)) {
-                struct vfs_stat stat;
-                if (vfs_stat(ctx, full_path, &stat) == VFS_OK) {
-                    callback(full_path, &stat, user_ctx);
-                }
-            }
+    pthread_mutex_lock(&st->hit_lock);
+    hit->next = st->hits;
+    st->hits = hit;
+    pthread_cond_signal(&st->hit_cond);
+    pthread_mutex_unlock(&st->hit_lock);
+}
 
-            /* Recurse into directories */
-            if (entries[i].type == VFS_TYPE_DIRECTORY) {
-                vfs_search_recursive(ctx, full_path, pattern, callback, user_ctx, depth + 1);
+/* List one directory: report its matches and queue its subdirectories */
+static void search_dir_run(struct search_state *st, unsigned id, struct search_dir *sd) {
+    struct vfs_dentry *dir = sd->dentry;
+    if (dir->mount && dir->mount->root) {
+        dir = dir->mount->root;
+    }
+    struct vfs_inode *inode = dir->inode;
+    if (!inode || inode->type != VFS_TYPE_DIRECTORY) return;
+    __atomic_add_fetch(&st->directories, 1, __ATOMIC_RELAXED);
+
+    /* Like vfs_readdir, but on a private file and with no entry limit */
+    struct search_list list = {0};
+    if (inode->fops && inode->fops->readdir) {
+        struct vfs_file file = {
+            .inode = inode,
+            .dentry = dir,
+            .flags = VFS_O_RDONLY | VFS_O_DIRECTORY,
+            .ref_count = 1,
+        };
+        if (!inode->fops->open || inode->fops->open(inode, &file) == VFS_OK) {
+            inode->fops->readdir(&file, search_list_add, &list);
+            if (inode->fops->close) inode->fops->close(&file);
+        }
+    } else {
+        pthread_mutex_lock(&st->tree_lock);
+        for (struct vfs_dentry *child = dir->children; child; child = child->sibling) {
+            if (child->is_hidden) continue;
+            search_list_add(child->name, child->inode ? child->inode->ino : 0,
+                            child->inode ? child->inode->type : VFS_TYPE_REGULAR, &list);
+        }
+        pthread_mutex_unlock(&st->tree_lock);
+    }
+    if (list.nomem) __atomic_store_n(&st->nomem, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&st->entries, list.count, __ATOMIC_RELAXED);
+
+    int descend = sd->depth < VFS_SEARCH_MAX_DEPTH;
+    for (size_t i = 0; i < list.count && !search_stopped(st); i++) {
+        const char *name = list.entries[i].name;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) continue;
+
+        /* Listings don't always know types (GeoFS reports every name as
+         * a file), so any name may be a directory to descend into */
+        int match = glob_match(&st->glob, name);
+        if (!match && !descend) continue;
+
+        char full_path[VFS_MAX_PATH];
+        int n = strcmp(sd->path, "/") == 0
+                    ? snprintf(full_path, sizeof(full_path), "/%s", name)
+                    : snprintf(full_path, sizeof(full_path), "%s/%s", sd->path, name);
+        if (n < 0 || (size_t)n >= sizeof(full_path)) continue;
+
+        struct vfs_dentry *child = search_child(st, dir, name);
+        if (!child || !child->inode) continue;
+
+        /* A mount point reports what is mounted there, as vfs_stat does */
+        struct vfs_dentry *target = child;
+        if (child->mount && child->mount->root && child->mount->root->inode) {
+            target = child->mount->root;
+        }
+        if (match) search_hit(st, full_path, target->inode);
+        if (descend && target->inode->type == VFS_TYPE_DIRECTORY) {
+            search_push(st, id, child, sd->depth + 1, full_path);
+        }
+    }
+    free(list.entries);
+}
+
+static void *search_worker_run(void *arg) {
+    struct search_worker *w = arg;
+    struct search_state *st = w->st;
+
+    while (!search_stopped(st)) {
+        struct search_dir *dir = search_take(st, w->id);
+        if (dir) {
+            search_dir_run(st, w->id, dir);
+            free(dir);
+            if (__atomic_sub_fetch(&st->pending, 1, __ATOMIC_SEQ_CST) == 0) {
+                pthread_mutex_lock(&st->idle_lock);
+                pthread_cond_broadcast(&st->idle_cond);
+                pthread_mutex_unlock(&st->idle_lock);
             }
+            continue;
         }
+
+        /* Nothing to take: done if nothing is pending, else wait for a push */
+        pthread_mutex_lock(&st->idle_lock);
+        if (__atomic_load_n(&st->pending, __ATOMIC_SEQ_CST) == 0 || search_stopped(st)) {
+            pthread_mutex_unlock(&st->idle_lock);
+            break;
+        }
+        __atomic_add_fetch(&st->idle, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&st->queued, __ATOMIC_SEQ_CST) == 0) {
+            pthread_cond_wait(&st->idle_cond, &st->idle_lock);
+        }
+        __atomic_sub_fetch(&st->idle, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&st->idle_lock);
     }
 
-    vfs_close(ctx, fd);
+    /* The caller waits for the last one out */
+    pthread_mutex_lock(&st->hit_lock);
+    st->running--;
+    pthread_cond_broadcast(&st->hit_cond);
+    pthread_mutex_unlock(&st->hit_lock);
+    return NULL;
 }
 
-vfs_error_t vfs_search(struct vfs_context *ctx, const char *start_path,
-                       const char *pattern, vfs_search_callback_t callback,
-                       void *user_ctx) {
+/* Hand a batch (newest first) to the callback, oldest first */
+static void search_deliver(struct search_state *st, struct search_hit *batch,
+                           vfs_search_found_t callback, void *user_ctx,
+                           struct vfs_search_stats *stats, int *quit) {
+    struct search_hit *ordered = NULL;
+    while (batch) {
+        struct search_hit *next = batch->next;
+        batch->next = ordered;
+        ordered = batch;
+        batch = next;
+    }
+    while (ordered) {
+        struct search_hit *next = ordered->next;
+        if (!*quit && st->cancel && *st->cancel) *quit = 1;
+        if (!*quit) {
+            stats->results++;
+            if (callback(ordered->path, &ordered->stat, user_ctx) != 0) {
+                *quit = 1;
+                search_stop(st);
+            }
+        }
+        free(ordered);
+        ordered = next;
+    }
+}
+
+vfs_error_t vfs_search_parallel(struct vfs_context *ctx, const char *start_path,
+                                const char *pattern,
+                                const struct vfs_search_options *opts,
+                                vfs_search_found_t callback, void *user_ctx,
+                                struct vfs_search_stats *stats_out) {
     if (!ctx || !start_path || !pattern || !callback) return VFS_ERR_INVAL;
 
     /* SECURITY: Canonicalize start path to prevent traversal attacks */
@@ -1290,9 +1866,132 @@ vfs_error_t vfs_search(struct vfs_context *ctx, const char *start_path,
     if (vfs_canonicalize_path(start_path, canonical_path, sizeof(canonical_path)) != 0) {
         return VFS_ERR_INVAL;
     }
+    struct vfs_dentry *start = NULL;
+    vfs_error_t err = vfs_resolve_path(ctx, canonical_path, &start);
+    if (err != VFS_OK) return err;
 
-    vfs_search_recursive(ctx, canonical_path, pattern, callback, user_ctx, 0);
-    return VFS_OK;
+    struct vfs_search_options defaults = {0};
+    if (!opts) opts = &defaults;
+    unsigned nworkers = opts->threads;
+    if (nworkers == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        nworkers = cpus > 0 ? (unsigned)cpus : 1;
+    }
+    if (nworkers > VFS_SEARCH_MAX_THREADS) nworkers = VFS_SEARCH_MAX_THREADS;
+
+    struct search_state st = {
+        .ctx = ctx,
+        .max_results = opts->max_results,
+        .cancel = opts->cancel,
+        .nworkers = nworkers,
+    };
+    err = glob_compile(pattern, &st.glob);
+    if (err != VFS_OK) return err;
+    st.deques = calloc(nworkers, sizeof(*st.deques));
+    struct search_worker *workers = calloc(nworkers, sizeof(*workers));
+    if (!st.deques || !workers) {
+        free(st.deques);
+        free(workers);
+        glob_free(&st.glob);
+        return VFS_ERR_NOMEM;
+    }
+    for (unsigned i = 0; i < nworkers; i++) {
+        pthread_mutex_init(&st.deques[i].lock, NULL);
+        workers[i].st = &st;
+        workers[i].id = i;
+    }
+    pthread_mutex_init(&st.tree_lock, NULL);
+    pthread_mutex_init(&st.idle_lock, NULL);
+    pthread_cond_init(&st.idle_cond, NULL);
+    pthread_mutex_init(&st.hit_lock, NULL);
+    pthread_cond_init(&st.hit_cond, NULL);
+
+    search_push(&st, 0, start, 0, canonical_path);
+
+    /* Workers that fail to start leave their share to the others */
+    unsigned started = 0;
+    st.running = nworkers;
+    for (unsigned i = 0; i < nworkers; i++) {
+        if (pthread_create(&workers[i].thread, NULL, search_worker_run, &workers[i]) == 0) {
+            workers[i].started = 1;
+            started++;
+        } else {
+            pthread_mutex_lock(&st.hit_lock);
+            st.running--;
+            pthread_mutex_unlock(&st.hit_lock);
+        }
+    }
+    if (started == 0) {
+        st.running = 1;
+        search_worker_run(&workers[0]);
+    }
+
+    /* Stream matches to the callback until every worker is done */
+    struct vfs_search_stats stats = { .threads = started ? started : 1 };
+    int quit = 0;
+    pthread_mutex_lock(&st.hit_lock);
+    for (;;) {
+        while (!st.hits && st.running > 0) {
+            pthread_cond_wait(&st.hit_cond, &st.hit_lock);
+        }
+        struct search_hit *batch = st.hits;
+        int finished = st.running == 0;
+        st.hits = NULL;
+        pthread_mutex_unlock(&st.hit_lock);
+
+        search_deliver(&st, batch, callback, user_ctx, &stats, &quit);
+        if (finished) break;
+        pthread_mutex_lock(&st.hit_lock);
+    }
+    for (unsigned i = 0; i < nworkers; i++) {
+        if (workers[i].started) pthread_join(workers[i].thread, NULL);
+    }
+
+    /* A stopped walk leaves directories behind */
+    for (unsigned i = 0; i < nworkers; i++) {
+        struct search_dir *dir;
+        while ((dir = deque_take(&st.deques[i], 0)) != NULL) free(dir);
+        free(st.deques[i].items);
+        pthread_mutex_destroy(&st.deques[i].lock);
+    }
+    stats.directories = st.directories;
+    stats.entries = st.entries;
+    stats.steals = st.steals;
+    stats.stopped = st.stop || quit || (st.cancel && *st.cancel);
+    if (stats_out) *stats_out = stats;
+
+    pthread_cond_destroy(&st.hit_cond);
+    pthread_mutex_destroy(&st.hit_lock);
+    pthread_cond_destroy(&st.idle_cond);
+    pthread_mutex_destroy(&st.idle_lock);
+    pthread_mutex_destroy(&st.tree_lock);
+    free(st.deques);
+    free(workers);
+    glob_free(&st.glob);
+    return st.nomem ? VFS_ERR_NOMEM : VFS_OK;
+}
+
+/* vfs_search's callback type, carried through vfs_search_parallel */
+struct search_forward {
+    vfs_search_callback_t callback;
+    void               *user_ctx;
+};
+
+static int search_forward_found(const char *path, const struct vfs_stat *stat, void *ctx) {
+    struct search_forward *fwd = ctx;
+    struct vfs_stat copy = *stat;
+    fwd->callback(path, &copy, fwd->user_ctx);
+    return 0;
+}
+
+vfs_error_t vfs_search(struct vfs_context *ctx, const char *start_path,
+                       const char *pattern, vfs_search_callback_t callback,
+                       void *user_ctx) {
+    if (!ctx || !start_path || !pattern || !callback) return VFS_ERR_INVAL;
+
+    struct search_forward fwd = { callback, user_ctx };
+    return vfs_search_parallel(ctx, start_path, pattern, NULL,
+                               search_forward_found, &fwd, NULL);
 }
 
 /* ══════════════════════════════════════════════════════════════════════════════
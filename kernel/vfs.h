@@ -27,6 +27,8 @@
 #define VFS_MAX_OPEN_FILES      1024
 #define VFS_MAX_MOUNTS          64
 #define VFS_MAX_FS_TYPES        16
+#define VFS_DCACHE_MIN_BUCKETS  256     /* Dentry cache; doubles as it fills */
+#define VFS_DCACHE_MAX_NEGATIVE 4096    /* Cached misses kept, least recent dropped */
 
 /* ══════════════════════════════════════════════════════════════════════════════
  * TYPES
@@ -141,6 +143,14 @@ struct vfs_dentry {
     struct vfs_mount   *mount;          /* Owning mount point */
     int                 is_hidden;      /* Hidden but preserved */
     phantom_time_t      hidden_at;      /* When hidden */
+
+    /* Dentry cache */
+    uint32_t            name_hash;
+    struct vfs_dentry  *hash_next;      /* Bucket chain */
+    int                 is_negative;    /* A cached miss: no inode, not a child */
+    uint64_t            generation;     /* Negative: fs generation when cached */
+    struct vfs_dentry  *lru_prev;       /* Negative: most recently used first */
+    struct vfs_dentry  *lru_next;
 };
 
 /*
@@ -174,6 +184,11 @@ struct vfs_fs_type {
     /* Unmount - in Phantom, this just syncs and marks dormant */
     void (*unmount)(struct vfs_superblock *sb);
 
+    /* Optional: a counter that changes whenever a name may have appeared
+     * other than through this VFS. Misses are only cached for file
+     * systems that provide it */
+    uint64_t (*generation)(struct vfs_superblock *sb);
+
     struct vfs_fs_type *next;
 };
 
@@ -299,6 +314,26 @@ struct vfs_dirent {
     char                name[VFS_MAX_NAME + 1];
 };
 
+/*
+ * Dentry cache - every dentry in the tree by (parent, name), plus negative
+ * entries for names the file system said don't exist. Tree dentries are
+ * owned by the tree; negative ones by the cache, which bounds them with
+ * an LRU list.
+ */
+struct vfs_dcache {
+    struct vfs_dentry **buckets;
+    uint64_t            nbuckets;       /* Power of two */
+    uint64_t            count;
+    struct vfs_dentry  *lru_head;       /* Negative entries */
+    struct vfs_dentry  *lru_tail;
+    uint64_t            negative;
+
+    /* Statistics */
+    uint64_t            hits;
+    uint64_t            negative_hits;
+    uint64_t            misses;         /* Went to the file system */
+};
+
 /*
  * VFS context - per-kernel VFS state
  */
@@ -307,6 +342,7 @@ struct vfs_context {
     struct vfs_mount   *mounts;         /* Mount table */
     struct vfs_dentry  *root;           /* Root dentry */
     struct vfs_file    *open_files[VFS_MAX_OPEN_FILES];
+    struct vfs_dcache   dcache;
 
     /* Statistics */
     uint64_t            total_opens;
@@ -397,6 +433,43 @@ typedef void (*vfs_search_callback_t)(const char *path, struct vfs_stat *stat, v
 vfs_error_t vfs_search(struct vfs_context *ctx, const char *start_path,
                        const char *pattern, vfs_search_callback_t callback, void *user_ctx);
 
+/*
+ * Parallel search. Worker threads walk the tree a directory at a time, each
+ * from its own deque, stealing from the others when theirs runs dry. Names
+ * are matched against the pattern (* and ?) compiled once. Matches reach
+ * the callback as they are found, one at a time and on the calling
+ * thread, which waits until the walk ends. A non-zero return from the
+ * callback, the result limit or *cancel (set from any thread) ends it
+ * early. vfs_search runs on this with the defaults.
+ *
+ * Like the rest of the VFS, not safe while another thread uses ctx.
+ */
+#define VFS_SEARCH_MAX_THREADS  16
+#define VFS_SEARCH_MAX_DEPTH    32
+
+typedef int (*vfs_search_found_t)(const char *path, const struct vfs_stat *stat, void *ctx);
+
+struct vfs_search_options {
+    unsigned            threads;        /* 0: one per CPU */
+    uint64_t            max_results;    /* 0: no limit */
+    const volatile int *cancel;         /* Optional */
+};
+
+struct vfs_search_stats {
+    uint64_t            results;
+    uint64_t            directories;
+    uint64_t            entries;
+    uint64_t            steals;         /* Directories taken from another worker */
+    unsigned            threads;
+    int                 stopped;        /* Ended early */
+};
+
+vfs_error_t vfs_search_parallel(struct vfs_context *ctx, const char *start_path,
+                                const char *pattern,
+                                const struct vfs_search_options *opts,
+                                vfs_search_found_t callback, void *user_ctx,
+                                struct vfs_search_stats *stats_out);
+
 /* Get file history from geology (returns views where file changed) */
 typedef struct {
     uint64_t    view_id;
@@ -2,6 +2,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
 #include "vfs.h"
 #include "../geofs.h"
 
@@ -25,6 +27,58 @@ static void search_callback_fn(const char *path, struct vfs_stat *stat, void *ct
     g_search_count++;
 }
 
+/* Parallel search results: paths, the thread they arrived on, and a stop */
+struct found_set {
+    char        paths[256][VFS_MAX_PATH];
+    int         count;
+    int         off_thread;     /* Callbacks not on the calling thread */
+    int         stop_after;     /* Ask to stop after this many; 0 never */
+    pthread_t   caller;
+};
+
+static int found_fn(const char *path, const struct vfs_stat *stat, void *ctx) {
+    (void)stat;
+    struct found_set *f = ctx;
+    if (!pthread_equal(pthread_self(), f->caller)) f->off_thread++;
+    if (f->count < 256) strncpy(f->paths[f->count], path, VFS_MAX_PATH - 1);
+    f->count++;
+    return f->stop_after && f->count >= f->stop_after;
+}
+
+static int found_unique(struct found_set *f) {
+    for (int i = 0; i < f->count && i < 256; i++) {
+        for (int j = i + 1; j < f->count && j < 256; j++) {
+            if (strcmp(f->paths[i], f->paths[j]) == 0) return 0;
+        }
+    }
+    return 1;
+}
+
+static int search_count(struct vfs_context *vfs, const char *pattern, unsigned threads) {
+    static struct found_set f;
+    memset(&f, 0, sizeof(f));
+    f.caller = pthread_self();
+    struct vfs_search_options opts = { .threads = threads };
+    if (vfs_search_parallel(vfs, "/home/tree", pattern, &opts, found_fn, &f, NULL) != VFS_OK) {
+        return -1;
+    }
+    return f.count;
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Nanoseconds per resolution of path */
+static double resolve_ns(struct vfs_context *vfs, const char *path, int rounds) {
+    struct vfs_dentry *d;
+    double t0 = now_sec();
+    for (int i = 0; i < rounds; i++) vfs_resolve_path(vfs, path, &d);
+    return (now_sec() - t0) * 1e9 / rounds;
+}
+
 static void test_result(const char *name, int passed) {
     if (passed) {
         printf("  [%s] %s\n", TEST_PASS, name);
@@ -44,7 +98,7 @@ int main(void) {
     /* Initialize GeoFS */
     printf("▶ Initializing GeoFS volume...\n");
     geofs_volume_t *vol = NULL;
-    geofs_error_t gerr = geofs_volume_create("test_geology.db", 50, &vol);
+    geofs_error_t gerr = geofs_volume_create("test_geology.db", 128, &vol);
     if (gerr != GEOFS_OK) {
         printf("  Failed to create GeoFS volume: %d\n", gerr);
         return 1;
@@ -325,6 +379,218 @@ int main(void) {
     err = vfs_stat(vfs, "/home/testdir/./test.txt", &st);
     test_result("Resolve path with .", err == VFS_OK);
 
+    /* ══════════════════════════════════════════════════════════════════
+     * TEST 13: Dentry Cache
+     * ══════════════════════════════════════════════════════════════════ */
+    printf("\n▶ TEST 13: Dentry Cache\n");
+
+    vfs_mkdir(vfs, 1, "/home/small", 0755);
+    vfs_mkdir(vfs, 1, "/home/big", 0755);
+    int created = 1;
+    char path[128];
+    for (int i = 0; i < 2000; i++) {
+        snprintf(path, sizeof(path), "/home/%s/f%d", i < 8 ? "small" : "big", i);
+        vfs_fd_t cfd = vfs_open(vfs, 1, path, VFS_O_WRONLY | VFS_O_CREATE, 0644);
+        if (cfd < 0) { created = 0; break; }
+        vfs_close(vfs, cfd);
+    }
+    test_result("Populate 2000-entry directory", created);
+
+    /* Oldest child of the big directory: last in its sibling list */
+    uint64_t hits = vfs->dcache.hits;
+    double small_ns = resolve_ns(vfs, "/home/small/f0", 20000);
+    double big_ns = resolve_ns(vfs, "/home/big/f8", 20000);
+    printf("    Resolve: %.0f ns in 8 entries, %.0f ns in 1992\n", small_ns, big_ns);
+    test_result("Lookups served from the cache", vfs->dcache.hits - hits >= 3 * 40000);
+    test_result("Big directory resolves like a small one", big_ns < small_ns * 3 + 200);
+
+    uint64_t misses = vfs->dcache.misses;
+    err = vfs_stat(vfs, "/home/big/missing", &st);
+    vfs_error_t err2 = vfs_stat(vfs, "/home/big/missing", &st);
+    test_result("Repeated miss answered by negative entry",
+                err == VFS_ERR_NOENT && err2 == VFS_ERR_NOENT &&
+                vfs->dcache.misses == misses + 1 && vfs->dcache.negative_hits > 0);
+
+    vfs_fd_t nfd = vfs_open(vfs, 1, "/home/big/missing", VFS_O_WRONLY | VFS_O_CREATE, 0644);
+    if (nfd >= 0) vfs_close(vfs, nfd);
+    test_result("Create replaces negative entry",
+                nfd >= 0 && vfs_stat(vfs, "/home/big/missing", &st) == VFS_OK);
+
+    /* Created behind the VFS's back: the volume's generation moves */
+    vfs_stat(vfs, "/home/big/external", &st);
+    geofs_hash_t ext_hash;
+    geofs_content_store(vol, "external", 8, ext_hash);
+    geofs_ref_create(vol, "/big/external", ext_hash);
+    test_result("Negative entry dropped when volume changes",
+                vfs_stat(vfs, "/home/big/external", &st) == VFS_OK);
+
+    for (int i = 0; i < VFS_DCACHE_MAX_NEGATIVE + 500; i++) {
+        snprintf(path, sizeof(path), "/home/big/nope%d", i);
+        vfs_stat(vfs, path, &st);
+    }
+    test_result("Negative entries bounded by LRU",
+                vfs->dcache.negative == VFS_DCACHE_MAX_NEGATIVE);
+
+    /* ══════════════════════════════════════════════════════════════════
+     * TEST 14: Chunked File I/O
+     * ══════════════════════════════════════════════════════════════════ */
+    printf("\n▶ TEST 14: Chunked File I/O\n");
+
+    /* 4 MB of incompressible bytes, written 64 KB at a time */
+    size_t stream_size = 4 << 20, piece = 64 << 10;
+    uint8_t *stream = malloc(stream_size + 1000);
+    uint8_t *back = malloc(stream_size + 1000);
+    uint32_t x = 2463534242u;
+    for (size_t i = 0; i < stream_size + 1000; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        stream[i] = (uint8_t)x;
+    }
+
+    /* Synced after every write: each sync stores the tail, not the file.
+     * Whole-file stores would add up to 130 MB */
+    struct geofs_space_stats sp_before, sp_after;
+    geofs_space_stats(vol, &sp_before);
+    int streamed = 1;
+    fd = vfs_open(vfs, 1, "/home/stream.bin", VFS_O_CREATE | VFS_O_RDWR, 0644);
+    for (size_t off = 0; fd >= 0 && off < stream_size; off += piece) {
+        streamed &= vfs_write(vfs, fd, stream + off, piece) == (ssize_t)piece &&
+                    vfs_sync(vfs, fd) == VFS_OK;
+    }
+    if (fd >= 0) vfs_close(vfs, fd);
+    geofs_space_stats(vol, &sp_after);
+    printf("    Stored %.1f MB for a %.1f MB file synced %zu times\n",
+           (sp_after.stored_bytes - sp_before.stored_bytes) / 1048576.0,
+           stream_size / 1048576.0, stream_size / piece);
+    test_result("Write 4 MB with a sync per 64 KB",
+                fd >= 0 && streamed &&
+                sp_after.stored_bytes - sp_before.stored_bytes < 3 * stream_size);
+
+    geofs_hash_t stream_hash;
+    struct geofs_chunk *chunks = NULL;
+    size_t nchunks = 0;
+    geofs_ref_resolve(vol, "/stream.bin", stream_hash);
+    geofs_content_chunks(vol, stream_hash, &chunks, &nchunks);
+    free(chunks);
+    test_result("Stored as a manifest of 256 KB chunks", nchunks == stream_size / (256 << 10));
+
+    /* Read back in odd sizes that straddle chunk boundaries */
+    size_t total = 0;
+    fd = vfs_open(vfs, 1, "/home/stream.bin", VFS_O_RDONLY, 0);
+    while (fd >= 0) {
+        ssize_t n = vfs_read(vfs, fd, back + total, 10007);
+        if (n <= 0) break;
+        total += n;
+    }
+    if (fd >= 0) vfs_close(vfs, fd);
+    test_result("Read back across chunks",
+                total == stream_size && memcmp(back, stream, stream_size) == 0);
+
+    /* Appending reopens only the last chunk */
+    fd = vfs_open(vfs, 1, "/home/stream.bin", VFS_O_RDWR | VFS_O_APPEND, 0);
+    ssize_t appended = fd >= 0 ? vfs_write(vfs, fd, stream + stream_size, 1000) : -1;
+    if (fd >= 0) vfs_close(vfs, fd);
+    total = 0;
+    fd = vfs_open(vfs, 1, "/home/stream.bin", VFS_O_RDONLY, 0);
+    while (fd >= 0) {
+        ssize_t n = vfs_read(vfs, fd, back + total, 300000);
+        if (n <= 0) break;
+        total += n;
+    }
+    if (fd >= 0) vfs_close(vfs, fd);
+    test_result("Append after reopen",
+                appended == 1000 && total == stream_size + 1000 &&
+                memcmp(back, stream, stream_size + 1000) == 0 &&
+                vfs_stat(vfs, "/home/stream.bin", &st) == VFS_OK &&
+                st.size == stream_size + 1000);
+
+    /* The same bytes as another file share every chunk */
+    geofs_space_stats(vol, &sp_before);
+    fd = vfs_open(vfs, 1, "/home/copy.bin", VFS_O_CREATE | VFS_O_RDWR, 0644);
+    for (size_t off = 0; fd >= 0 && off < stream_size; off += piece) {
+        vfs_write(vfs, fd, stream + off, piece);
+    }
+    if (fd >= 0) vfs_close(vfs, fd);
+    geofs_space_stats(vol, &sp_after);
+    geofs_hash_t copy_hash;
+    geofs_ref_resolve(vol, "/copy.bin", copy_hash);
+    test_result("Copy deduplicated chunk by chunk",
+                fd >= 0 && memcmp(copy_hash, stream_hash, GEOFS_HASH_SIZE) == 0 &&
+                sp_after.objects == sp_before.objects);
+    free(stream);
+    free(back);
+
+    /* ══════════════════════════════════════════════════════════════════
+     * TEST 15: Parallel Search
+     * ══════════════════════════════════════════════════════════════════ */
+    printf("\n▶ TEST 15: Parallel Search\n");
+
+    /* 4 x 4 directories, 12 files in each leaf */
+    int built = vfs_mkdir(vfs, 1, "/home/tree", 0755) == VFS_OK;
+    for (int d = 0; d < 4; d++) {
+        snprintf(path, sizeof(path), "/home/tree/d%d", d);
+        built &= vfs_mkdir(vfs, 1, path, 0755) == VFS_OK;
+        for (int e = 0; e < 4; e++) {
+            snprintf(path, sizeof(path), "/home/tree/d%d/e%d", d, e);
+            built &= vfs_mkdir(vfs, 1, path, 0755) == VFS_OK;
+            for (int k = 0; k < 12; k++) {
+                snprintf(path, sizeof(path), "/home/tree/d%d/e%d/file_%d.%s",
+                         d, e, k / 2, k % 2 ? "log" : "txt");
+                vfs_fd_t tfd = vfs_open(vfs, 1, path, VFS_O_WRONLY | VFS_O_CREATE, 0644);
+                built &= tfd >= 0;
+                if (tfd >= 0) vfs_close(vfs, tfd);
+            }
+        }
+    }
+    test_result("Build 4x4 tree of 192 files", built);
+
+    static struct found_set found;
+    memset(&found, 0, sizeof(found));
+    found.caller = pthread_self();
+    struct vfs_search_options sopts = { .threads = 4 };
+    struct vfs_search_stats sstats;
+    err = vfs_search_parallel(vfs, "/home/tree", "*.txt", &sopts, found_fn, &found, &sstats);
+    printf("    %llu results from %llu directories, %llu entries; %u threads, %llu steals\n",
+           (unsigned long long)sstats.results, (unsigned long long)sstats.directories,
+           (unsigned long long)sstats.entries, sstats.threads,
+           (unsigned long long)sstats.steals);
+    test_result("Finds every match once",
+                err == VFS_OK && found.count == 96 && found_unique(&found) &&
+                sstats.results == 96 && sstats.directories == 21 && !sstats.stopped);
+    test_result("Callbacks run on the calling thread", found.off_thread == 0);
+
+    test_result("Same results on one thread", search_count(vfs, "*.txt", 1) == 96);
+    test_result("Compiled patterns",
+                search_count(vfs, "file_?.txt", 4) == 96 &&
+                search_count(vfs, "*_3.*", 4) == 32 &&
+                search_count(vfs, "d*", 4) == 4 &&
+                search_count(vfs, "e?", 4) == 16 &&
+                search_count(vfs, "*", 4) == 212 &&
+                search_count(vfs, "f*e*_?.l?g", 4) == 96 &&
+                search_count(vfs, "file_1.txt*", 4) == 16 &&
+                search_count(vfs, "file", 4) == 0);
+
+    memset(&found, 0, sizeof(found));
+    found.caller = pthread_self();
+    sopts.max_results = 10;
+    err = vfs_search_parallel(vfs, "/home/tree", "*", &sopts, found_fn, &found, &sstats);
+    test_result("Result limit", err == VFS_OK && found.count == 10 && sstats.stopped);
+
+    memset(&found, 0, sizeof(found));
+    found.caller = pthread_self();
+    found.stop_after = 5;
+    sopts.max_results = 0;
+    err = vfs_search_parallel(vfs, "/home/tree", "*", &sopts, found_fn, &found, &sstats);
+    test_result("Callback stops the search", err == VFS_OK && found.count == 5 && sstats.stopped);
+
+    memset(&found, 0, sizeof(found));
+    found.caller = pthread_self();
+    volatile int cancelled = 1;
+    sopts.cancel = &cancelled;
+    err = vfs_search_parallel(vfs, "/home/tree", "*", &sopts, found_fn, &found, &sstats);
+    test_result("Cancelled search", err == VFS_OK && found.count == 0 && sstats.stopped);
+
     /* ══════════════════════════════════════════════════════════════════
      * SUMMARY
      * ══════════════════════════════════════════════════════════════════ */
@@ -344,6 +610,7 @@ int main(void) {
     }
 
     /* Cleanup */
+    vfs_shutdown(vfs);
     geofs_volume_close(vol);
     remove("test_geology.db");
 
@@ -2,9 +2,10 @@
  * PhantomOS VirtIO Network Driver
  * "To Create, Not To Destroy"
  *
- * VirtIO-net PCI driver with minimal network stack:
- *   - ARP: respond to requests, resolve gateway MAC
+ * VirtIO-net PCI driver with the link and IP layers:
+ *   - ARP: respond to requests, cache resolved neighbours with timeouts
  *   - ICMP: respond to echo requests (ping), send echo requests
+ *   - IPv4 send/receive for UDP and TCP, which live in netstack.c
  *   - Static IP: 10.0.2.15/24, gateway 10.0.2.2 (QEMU user-mode defaults)
  *
  * Uses the same VirtIO PCI transport as virtio_console.c:
@@ -12,6 +13,23 @@
  *   2. Walk PCI capabilities for Common/Notify/ISR/Device config
  *   3. Set up receiveq (queue 0) and transmitq (queue 1)
  *   4. Pre-fill receive descriptors, transmit on demand
+ *
+ * Receive is interrupt-driven when the local APIC is usable: the receiveq
+ * raises an MSI-X vector, the handler suppresses further interrupts and
+ * wakes the "net-rx" task, which processes frames in budgeted rounds and
+ * only re-arms the interrupt once the ring is drained (NAPI-style). Under
+ * load it keeps polling without taking an interrupt per packet. Without
+ * MSI-X, virtio_net_poll() from the desktop loop does the same work.
+ *
+ * Frames are handed to the protocol handlers in place, as struct net_buf
+ * references into the receive buffers; a buffer goes back to the device
+ * when the handler is done with it (see virtio_net_buf_hold()).
+ *
+ * Transmit queues frames without waiting for them: headers are gathered
+ * into a per-slot buffer and payloads can be chained as a second
+ * descriptor and read in place. The device is kicked once per batch, and
+ * completed slots are reclaimed lazily. With VIRTIO_RING_F_EVENT_IDX the
+ * device tells us when it actually needs a kick.
  */
 
 #include "virtio_net.h"
@@ -20,6 +38,11 @@
 #include "pmm.h"
 #include "io.h"
 #include "timer.h"
+#include "trace.h"
+#include "idt.h"
+#include "lapic.h"
+#include "process.h"
+#include "netstack.h"
 #include <stdint.h>
 #include <stddef.h>
 
@@ -40,8 +63,16 @@ extern int strcmp(const char *s1, const char *s2);
 #define VIRTIO_NET_DEVICE_ID_V1     0x1041  /* Modern (0x1040+1) */
 #define VIRTIO_VENDOR_ID            0x1AF4
 
-#define VNET_QUEUE_SIZE     64      /* Virtqueue entries */
-#define VNET_RX_BUF_SIZE    1526    /* 10 virtio hdr + 14 eth + 1500 MTU + 2 pad */
+#define VNET_QUEUE_SIZE     256     /* Max virtqueue entries (power of two) */
+#define VNET_RX_BUF_SIZE    2048    /* 12 virtio hdr + full frame; two per page */
+#define VNET_RX_BUDGET      64      /* Frames per receive round */
+#define VNET_RX_MERGE_MAX   4096    /* Largest frame gathered from several buffers */
+#define VNET_NO_BUF         0xFFFF  /* net_buf.id of a gathered (copied) frame */
+#define VNET_TX_SLOT_SIZE   2048    /* Headers, or a whole copied frame */
+#define VNET_EVENT_FAR      0x8000  /* used_event offset that never fires */
+#define VNET_FLOOD_ID       0x464C  /* "FL": echo id of ping flood requests */
+#define VNET_FLOOD_BATCH    32
+#define VNET_FLOOD_WINDOW   128     /* Echo requests in flight */
 
 /* VirtIO PCI capability types */
 #define VIRTIO_PCI_CAP_COMMON_CFG   1
@@ -59,6 +90,12 @@ extern int strcmp(const char *s1, const char *s2);
 #define VIRTQ_DESC_F_NEXT       1
 #define VIRTQ_DESC_F_WRITE      2   /* Device writes (for receive) */
 
+/* Ring flags */
+#define VIRTQ_AVAIL_F_NO_INTERRUPT  1   /* Driver: don't interrupt on used */
+#define VIRTQ_USED_F_NO_NOTIFY      1   /* Device: don't kick on avail */
+
+#define VIRTIO_MSI_NO_VECTOR    0xFFFF
+
 /* PCI capability list */
 #define PCI_REG_CAP_PTR     0x34
 #define PCI_REG_STATUS_CAP  0x10
@@ -71,7 +108,10 @@ extern int strcmp(const char *s1, const char *s2);
 
 /* VirtIO net feature bits */
 #define VIRTIO_NET_F_MAC        (1U << 5)
+#define VIRTIO_NET_F_MRG_RXBUF  (1U << 15)
 #define VIRTIO_NET_F_STATUS     (1U << 16)
+#define VIRTIO_RING_F_EVENT_IDX (1U << 29)
+#define VIRTIO_F_VERSION_1      (1U << 0)   /* Bit 32: feature word 1 */
 
 /* Ethernet */
 #define ETH_ALEN            6
@@ -84,13 +124,25 @@ extern int strcmp(const char *s1, const char *s2);
 #define ARP_OP_REQUEST      1
 #define ARP_OP_REPLY        2
 
+#define ARP_CACHE_SIZE      16
+#define ARP_ENTRY_TTL_MS    60000   /* Refresh a resolved entry after this */
+#define ARP_RETRY_MS        1000    /* Repeat an unanswered request */
+
+#define ARP_FREE            0
+#define ARP_PENDING         1
+#define ARP_VALID           2
+
 /* IP / ICMP */
 #define IP_PROTO_ICMP       1
+#define IP_FLAG_DF          0x4000
+#define IP_FRAG_MASK        0x3FFF  /* More-fragments flag and offset */
 #define ICMP_ECHO_REPLY     0
 #define ICMP_ECHO_REQUEST   8
 
-/* VirtIO net header size */
-#define VIRTIO_NET_HDR_SIZE 10
+/* VirtIO net header size: legacy, and with num_buffers (mergeable or
+ * VERSION_1) */
+#define VIRTIO_NET_HDR_SIZE     10
+#define VIRTIO_NET_HDR_MRG_SIZE 12
 
 /*============================================================================
  * Byte-Order Helpers (x86 is little-endian, network is big-endian)
@@ -139,6 +191,7 @@ struct virtio_net_hdr {
     uint16_t gso_size;
     uint16_t csum_start;
     uint16_t csum_offset;
+    uint16_t num_buffers;   /* Only present in the 12-byte header */
 } __attribute__((packed));
 
 struct eth_hdr {
@@ -249,6 +302,7 @@ static struct {
     struct virtq_desc      *rx_desc;
     struct virtq_avail     *rx_avail;
     struct virtq_used      *rx_used;
+    uint16_t                rx_size;        /* Negotiated entries */
     uint16_t                rx_last_used;
     uint16_t                rx_notify_off;
 
@@ -256,15 +310,40 @@ static struct {
     struct virtq_desc      *tx_desc;
     struct virtq_avail     *tx_avail;
     struct virtq_used      *tx_used;
-    uint16_t                tx_free_head;
+    uint16_t                tx_size;
     uint16_t                tx_last_used;
+    uint16_t                tx_kicked;      /* avail idx at the last kick */
     uint16_t                tx_notify_off;
 
     /* Receive buffers */
-    uint8_t                *rx_bufs;    /* VNET_QUEUE_SIZE * VNET_RX_BUF_SIZE */
-
-    /* Transmit buffer */
-    uint8_t                *tx_buf;     /* Single page for transmit data */
+    uint8_t                *rx_bufs;    /* rx_size * VNET_RX_BUF_SIZE */
+    uint8_t                 rx_held[VNET_QUEUE_SIZE];
+    uint16_t                rx_held_count;
+    uint8_t                *rx_merge;   /* Gather buffer for multi-buffer frames */
+    uint16_t                hdr_len;    /* virtio-net header in every buffer */
+    int                     mergeable;
+
+    /* Interrupt-driven receive */
+    int                     msix;       /* receiveq raises an MSI-X vector */
+    uint8_t                 vector;
+    struct process         *rx_task;
+    volatile int            rx_scheduled;   /* IRQ seen, task owns the ring */
+    volatile int            rx_busy;        /* A receive round is running */
+    volatile int            tx_busy;
+
+    /* Packet-rate window */
+    uint64_t                rate_start_ms;
+    uint64_t                rate_start_packets;
+
+    /* Transmit slots: descriptor pairs 2p, 2p+1 and header buffer p */
+    uint8_t                *tx_slots;   /* tx_size / 2 * VNET_TX_SLOT_SIZE */
+    uint16_t                tx_free[VNET_QUEUE_SIZE / 2];
+    uint16_t                tx_free_count;
+    struct tx_pending {
+        uint32_t            len;        /* Frame bytes, for stats */
+        volatile uint32_t  *ref;        /* Dropped when the device is done */
+    }                       tx_pending[VNET_QUEUE_SIZE / 2];
+    int                     event_idx;  /* VIRTIO_RING_F_EVENT_IDX negotiated */
 
     /* Device info */
     uint8_t                 mac[6];
@@ -272,9 +351,15 @@ static struct {
     uint32_t                gateway;
     uint32_t                netmask;
 
-    /* ARP cache (gateway only) */
-    uint8_t                 gateway_mac[6];
-    int                     gateway_mac_known;
+    /* ARP cache */
+    struct arp_entry {
+        uint32_t            ip;
+        uint8_t             mac[ETH_ALEN];
+        uint8_t             state;
+        uint64_t            updated_ms;     /* Last reply or request seen */
+        uint64_t            requested_ms;   /* Last request sent */
+    }                       arp_cache[ARP_CACHE_SIZE];
+    uint16_t                ip_ident;
 
     /* Ping state */
     uint16_t                ping_id;
@@ -282,6 +367,7 @@ static struct {
     uint64_t                ping_send_time_ms;
     int                     ping_reply_received;
     int                     ping_rtt_ms;
+    volatile uint32_t       flood_replies;
 
     /* Statistics */
     struct net_stats        stats;
@@ -370,11 +456,19 @@ static int find_virtio_caps(void)
  * Virtqueue Setup
  *============================================================================*/
 
+/*
+ * Set up a virtqueue of up to VNET_QUEUE_SIZE entries. The device may offer
+ * fewer; ring indices are taken modulo the size returned in *out_size.
+ * *msix_vector is the MSI-X table entry to signal (VIRTIO_MSI_NO_VECTOR for
+ * none) and is replaced by what the device accepted.
+ */
 static int setup_virtqueue(int queue_idx,
                            struct virtq_desc **out_desc,
                            struct virtq_avail **out_avail,
                            struct virtq_used **out_used,
-                           uint16_t *out_notify_off)
+                           uint16_t *out_size,
+                           uint16_t *out_notify_off,
+                           uint16_t *msix_vector)
 {
     volatile struct virtio_pci_common_cfg *cfg = vnet.common_cfg;
 
@@ -387,20 +481,22 @@ static int setup_virtqueue(int queue_idx,
         max_size = VNET_QUEUE_SIZE;
     cfg->queue_size = max_size;
 
-    void *vq_mem = pmm_alloc_pages(2);
+    uint64_t used_offset = max_size * sizeof(struct virtq_desc) +
+                           sizeof(struct virtq_avail);
+    used_offset = (used_offset + 0xFFF) & ~0xFFFULL;
+    size_t vq_pages = (used_offset + sizeof(struct virtq_used) + 0xFFF) / 4096;
+
+    void *vq_mem = pmm_alloc_pages(vq_pages);
     if (!vq_mem) return -1;
-    memset(vq_mem, 0, 8192);
+    memset(vq_mem, 0, vq_pages * 4096);
 
     uint64_t vq_phys = (uint64_t)(uintptr_t)vq_mem;
 
     *out_desc = (struct virtq_desc *)vq_mem;
     *out_avail = (struct virtq_avail *)((uint8_t *)vq_mem +
                   max_size * sizeof(struct virtq_desc));
-
-    uint64_t used_offset = max_size * sizeof(struct virtq_desc) +
-                           sizeof(struct virtq_avail);
-    used_offset = (used_offset + 0xFFF) & ~0xFFFULL;
     *out_used = (struct virtq_used *)((uint8_t *)vq_mem + used_offset);
+    *out_size = max_size;
 
     for (uint16_t i = 0; i < max_size - 1; i++)
         (*out_desc)[i].next = i + 1;
@@ -412,7 +508,9 @@ static int setup_virtqueue(int queue_idx,
     cfg->queue_avail = vq_phys +
                        (uint64_t)((uint8_t *)*out_avail - (uint8_t *)vq_mem);
     cfg->queue_used  = vq_phys + used_offset;
+    cfg->queue_msix_vector = *msix_vector;
     __asm__ volatile("mfence" ::: "memory");
+    *msix_vector = cfg->queue_msix_vector;
 
     cfg->queue_enable = 1;
     __asm__ volatile("mfence" ::: "memory");
@@ -433,46 +531,211 @@ static void kick_queue(uint16_t notify_off, uint16_t queue_idx)
     *notify_addr = queue_idx;
 }
 
+/* EVENT_IDX fields sit just past each ring's negotiated size */
+static volatile uint16_t *vq_used_event(struct virtq_avail *avail, uint16_t size)
+{
+    return (volatile uint16_t *)(avail->ring + size);
+}
+
+static volatile uint16_t *vq_avail_event(struct virtq_used *used, uint16_t size)
+{
+    return (volatile uint16_t *)(used->ring + size);
+}
+
+/*
+ * Does the device want a kick for avail entries old_idx..new_idx? With
+ * EVENT_IDX it publishes the index it wants to hear about; otherwise it
+ * can only switch notifications off wholesale.
+ */
+static int vq_need_kick(struct virtq_used *used, uint16_t size,
+                        uint16_t old_idx, uint16_t new_idx)
+{
+    if (vnet.event_idx) {
+        uint16_t event = *vq_avail_event(used, size);
+        return (uint16_t)(new_idx - event - 1) < (uint16_t)(new_idx - old_idx);
+    }
+    return !(used->flags & VIRTQ_USED_F_NO_NOTIFY);
+}
+
+/*
+ * Used-buffer interrupts. With EVENT_IDX the device ignores the flag and
+ * interrupts when its used index passes used_event instead, so "off"
+ * moves used_event half the index space away.
+ */
+static void vq_irq_enable(struct virtq_avail *avail, uint16_t size,
+                          uint16_t last_used)
+{
+    if (vnet.event_idx)
+        *vq_used_event(avail, size) = last_used;
+    avail->flags = 0;
+}
+
+static void vq_irq_disable(struct virtq_avail *avail, uint16_t size,
+                           uint16_t last_used)
+{
+    if (vnet.event_idx)
+        *vq_used_event(avail, size) = (uint16_t)(last_used + VNET_EVENT_FAR);
+    avail->flags = VIRTQ_AVAIL_F_NO_INTERRUPT;
+}
+
 /*============================================================================
- * Raw Transmit
+ * Transmit Queue
+ *
+ * Pair p of descriptors (2p, 2p+1) owns header slot p. The head points at
+ * the slot: virtio-net header, Ethernet and protocol headers, and the
+ * payload too when it is copied. A payload read in place is chained as
+ * the second descriptor.
  *============================================================================*/
 
-static int virtio_net_send_raw(const void *data, uint32_t len)
+/* The receive task and the shell both transmit; a preempted holder gets
+ * the CPU back through sched_yield() */
+static void tx_lock(void)
+{
+    while (__atomic_exchange_n(&vnet.tx_busy, 1, __ATOMIC_ACQUIRE))
+        sched_yield();
+}
+
+static int tx_trylock(void)
 {
-    uint16_t idx = vnet.tx_free_head;
-    if (idx == 0xFFFF) return -1;
-    vnet.tx_free_head = vnet.tx_desc[idx].next;
+    return !__atomic_exchange_n(&vnet.tx_busy, 1, __ATOMIC_ACQUIRE);
+}
 
-    memcpy(vnet.tx_buf, data, len);
+static void tx_unlock(void)
+{
+    __atomic_store_n(&vnet.tx_busy, 0, __ATOMIC_RELEASE);
+}
 
-    vnet.tx_desc[idx].addr = (uint64_t)(uintptr_t)vnet.tx_buf;
-    vnet.tx_desc[idx].len = len;
-    vnet.tx_desc[idx].flags = 0;  /* Device reads */
-    vnet.tx_desc[idx].next = 0xFFFF;
+/* Take back every pair the device has finished with */
+static void tx_reclaim_locked(void)
+{
+    uint16_t used_idx = __atomic_load_n(&vnet.tx_used->idx, __ATOMIC_ACQUIRE);
+
+    while (vnet.tx_last_used != used_idx) {
+        uint16_t slot = vnet.tx_last_used & (vnet.tx_size - 1);
+        uint16_t pair = (uint16_t)(vnet.tx_used->ring[slot].id / 2);
+        struct tx_pending *tp = &vnet.tx_pending[pair];
+        vnet.tx_last_used++;
+
+        if (tp->ref) {
+            __atomic_sub_fetch(tp->ref, 1, __ATOMIC_RELEASE);
+            tp->ref = NULL;
+        }
+        vnet.stats.tx_packets++;
+        vnet.stats.tx_bytes += tp->len;
+        vnet.tx_free[vnet.tx_free_count++] = pair;
+    }
+
+    /* Transmit completions never need an interrupt */
+    if (vnet.event_idx)
+        *vq_used_event(vnet.tx_avail, vnet.tx_size) =
+            (uint16_t)(vnet.tx_last_used + VNET_EVENT_FAR);
+}
+
+/* Notify the device of everything queued since the last kick, if it
+ * asked to be notified */
+static void tx_kick_locked(void)
+{
+    uint16_t idx = vnet.tx_avail->idx;
+    if (idx == vnet.tx_kicked)
+        return;
 
-    uint16_t avail_idx = vnet.tx_avail->idx;
-    vnet.tx_avail->ring[avail_idx % VNET_QUEUE_SIZE] = idx;
     __asm__ volatile("mfence" ::: "memory");
-    vnet.tx_avail->idx = avail_idx + 1;
-
-    kick_queue(vnet.tx_notify_off, 1);
-
-    for (int i = 0; i < 1000000; i++) {
-        if (vnet.tx_used->idx != vnet.tx_last_used) {
-            vnet.tx_last_used = vnet.tx_used->idx;
-            vnet.tx_desc[idx].next = vnet.tx_free_head;
-            vnet.tx_free_head = idx;
-            vnet.stats.tx_packets++;
-            vnet.stats.tx_bytes += len;
-            return 0;
+    if (vq_need_kick(vnet.tx_used, vnet.tx_size, vnet.tx_kicked, idx)) {
+        kick_queue(vnet.tx_notify_off, 1);
+        vnet.stats.tx_kicks++;
+    }
+    vnet.tx_kicked = idx;
+}
+
+/* A free pair; reclaims, and waits for the device when the ring is full */
+static int tx_get_pair_locked(void)
+{
+    if (!vnet.tx_free_count)
+        tx_reclaim_locked();
+
+    for (int spin = 0; !vnet.tx_free_count; spin++) {
+        if (spin == 0) {
+            vnet.stats.tx_ring_full++;
+            tx_kick_locked();
         }
+        if (spin == 1000000)
+            return -1;
         __asm__ volatile("pause" ::: "memory");
+        tx_reclaim_locked();
     }
+    return vnet.tx_free[--vnet.tx_free_count];
+}
 
-    /* Timeout: reclaim descriptor anyway */
-    vnet.tx_desc[idx].next = vnet.tx_free_head;
-    vnet.tx_free_head = idx;
-    return -1;
+/*
+ * Queue one frame without kicking. hdr1 and hdr2 are copied into the
+ * slot; so is the payload unless ref is given, in which case the device
+ * reads it in place and *ref stays raised until the pair is reclaimed.
+ */
+static int tx_enqueue_locked(const void *hdr1, uint32_t len1,
+                             const void *hdr2, uint32_t len2,
+                             const void *payload, uint32_t plen,
+                             volatile uint32_t *ref)
+{
+    if (!plen)
+        ref = NULL;
+
+    uint32_t head_len = vnet.hdr_len + len1 + len2 + (ref ? 0 : plen);
+    if (head_len > VNET_TX_SLOT_SIZE)
+        return -1;
+
+    int pair = tx_get_pair_locked();
+    if (pair < 0)
+        return -1;
+
+    uint8_t *slot = vnet.tx_slots + (uint32_t)pair * VNET_TX_SLOT_SIZE;
+    uint32_t off = vnet.hdr_len;
+    memset(slot, 0, vnet.hdr_len);     /* No offloads */
+    memcpy(slot + off, hdr1, len1);
+    off += len1;
+    if (len2) {
+        memcpy(slot + off, hdr2, len2);
+        off += len2;
+    }
+    if (!ref && plen)
+        memcpy(slot + off, payload, plen);
+
+    uint16_t head = (uint16_t)(pair * 2);
+    struct virtq_desc *d = &vnet.tx_desc[head];
+    d[0].addr = (uint64_t)(uintptr_t)slot;
+    d[0].len = head_len;
+    if (ref) {
+        d[0].flags = VIRTQ_DESC_F_NEXT;
+        d[0].next = (uint16_t)(head + 1);
+        d[1].addr = (uint64_t)(uintptr_t)payload;
+        d[1].len = plen;
+        d[1].flags = 0;
+        d[1].next = 0;
+        __atomic_add_fetch(ref, 1, __ATOMIC_RELAXED);
+    } else {
+        d[0].flags = 0;
+        d[0].next = 0;
+    }
+    vnet.tx_pending[pair].ref = ref;
+    vnet.tx_pending[pair].len = len1 + len2 + plen;
+
+    uint16_t avail_idx = vnet.tx_avail->idx;
+    vnet.tx_avail->ring[avail_idx & (vnet.tx_size - 1)] = head;
+    __atomic_store_n(&vnet.tx_avail->idx, (uint16_t)(avail_idx + 1),
+                     __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* Send one Ethernet frame (copied) */
+static int tx_send_frame(const void *frame, uint32_t len)
+{
+    uint64_t start = rdtsc();
+    tx_lock();
+    int ret = tx_enqueue_locked(frame, len, NULL, 0, NULL, 0, NULL);
+    tx_kick_locked();
+    vnet.stats.tx_batches++;
+    tx_unlock();
+    vnet.stats.tx_cycles += rdtsc() - start;
+    return ret;
 }
 
 /*============================================================================
@@ -482,26 +745,20 @@ static int virtio_net_send_raw(const void *data, uint32_t len)
 static int send_eth_frame(const uint8_t *dst_mac, uint16_t ethertype,
                           const void *payload, uint32_t payload_len)
 {
-    uint8_t pkt[1600];
-    uint32_t offset = 0;
-
-    /* VirtIO net header (all zeros = no offloading) */
-    struct virtio_net_hdr *vhdr = (struct virtio_net_hdr *)pkt;
-    memset(vhdr, 0, VIRTIO_NET_HDR_SIZE);
-    offset += VIRTIO_NET_HDR_SIZE;
-
-    /* Ethernet header */
-    struct eth_hdr *eth = (struct eth_hdr *)(pkt + offset);
-    memcpy(eth->dst, dst_mac, ETH_ALEN);
-    memcpy(eth->src, vnet.mac, ETH_ALEN);
-    eth->ethertype = htons(ethertype);
-    offset += ETH_HLEN;
-
-    if (offset + payload_len > sizeof(pkt)) return -1;
-    memcpy(pkt + offset, payload, payload_len);
-    offset += payload_len;
-
-    return virtio_net_send_raw(pkt, offset);
+    struct eth_hdr eth;
+    memcpy(eth.dst, dst_mac, ETH_ALEN);
+    memcpy(eth.src, vnet.mac, ETH_ALEN);
+    eth.ethertype = htons(ethertype);
+
+    uint64_t start = rdtsc();
+    tx_lock();
+    int ret = tx_enqueue_locked(&eth, ETH_HLEN, NULL, 0,
+                                payload, payload_len, NULL);
+    tx_kick_locked();
+    vnet.stats.tx_batches++;
+    tx_unlock();
+    vnet.stats.tx_cycles += rdtsc() - start;
+    return ret;
 }
 
 /*============================================================================
@@ -542,6 +799,180 @@ static void send_arp_request(uint32_t target_ip_host)
     arp.target_ip = htonl(target_ip_host);
 
     send_eth_frame(broadcast, ETH_TYPE_ARP, &arp, sizeof(arp));
+    vnet.stats.arp_requests_sent++;
+}
+
+/*============================================================================
+ * ARP Cache
+ *
+ * Touched by the receive path and by senders, so entries are only read or
+ * changed with interrupts off; requests are sent after restoring them.
+ *============================================================================*/
+
+static struct arp_entry *arp_find(uint32_t ip)
+{
+    for (int i = 0; i < ARP_CACHE_SIZE; i++) {
+        if (vnet.arp_cache[i].state != ARP_FREE && vnet.arp_cache[i].ip == ip)
+            return &vnet.arp_cache[i];
+    }
+    return NULL;
+}
+
+/* A free entry, else the least recently updated one */
+static struct arp_entry *arp_alloc(void)
+{
+    struct arp_entry *victim = &vnet.arp_cache[0];
+    for (int i = 0; i < ARP_CACHE_SIZE; i++) {
+        struct arp_entry *e = &vnet.arp_cache[i];
+        if (e->state == ARP_FREE)
+            return e;
+        if (e->updated_ms < victim->updated_ms)
+            victim = e;
+    }
+    return victim;
+}
+
+/* Record ip -> mac; creates an entry only when asked to */
+static void arp_update(uint32_t ip, const uint8_t *mac, int create)
+{
+    uint64_t flags = irq_save();
+    struct arp_entry *e = arp_find(ip);
+    if (!e && create) {
+        e = arp_alloc();
+        e->ip = ip;
+        e->requested_ms = 0;
+    }
+    if (e) {
+        memcpy(e->mac, mac, ETH_ALEN);
+        e->state = ARP_VALID;
+        e->updated_ms = timer_get_ms();
+    }
+    irq_restore(flags);
+}
+
+/*
+ * Resolve ip to a MAC: 0 with mac filled in, or -1 while unresolved. A
+ * request goes out at most every ARP_RETRY_MS. An entry past its TTL is
+ * still used while a refresh is outstanding, and dropped back to pending
+ * if nothing answers for another TTL.
+ */
+static int arp_resolve(uint32_t ip, uint8_t *mac)
+{
+    uint64_t now = timer_get_ms();
+    int send = 0, ret = -1;
+    uint64_t flags = irq_save();
+
+    struct arp_entry *e = arp_find(ip);
+    if (!e) {
+        e = arp_alloc();
+        e->ip = ip;
+        e->state = ARP_PENDING;
+        e->updated_ms = now;
+        e->requested_ms = now - ARP_RETRY_MS;
+    }
+
+    if (e->state == ARP_VALID && now - e->updated_ms >= 2 * ARP_ENTRY_TTL_MS)
+        e->state = ARP_PENDING;
+
+    if (e->state == ARP_VALID) {
+        memcpy(mac, e->mac, ETH_ALEN);
+        ret = 0;
+    }
+    if ((e->state != ARP_VALID || now - e->updated_ms >= ARP_ENTRY_TTL_MS) &&
+        now - e->requested_ms >= ARP_RETRY_MS) {
+        e->requested_ms = now;
+        send = 1;
+    }
+    irq_restore(flags);
+
+    if (send)
+        send_arp_request(ip);
+    return ret;
+}
+
+/* Gateway for anything off the local subnet */
+static uint32_t next_hop(uint32_t dst_ip)
+{
+    return ((dst_ip ^ vnet.ip) & vnet.netmask) == 0 ? dst_ip : vnet.gateway;
+}
+
+/*============================================================================
+ * IPv4 Transmit
+ *============================================================================*/
+
+int virtio_net_send_ipv4_batch(uint32_t dst_ip, uint8_t protocol,
+                               const struct vnet_tx_frame *frames, int count)
+{
+    static const uint8_t broadcast[6] = {0xFF,0xFF,0xFF,0xFF,0xFF,0xFF};
+    uint8_t dst_mac[ETH_ALEN];
+
+    if (!vnet.initialized) return VNET_ERR_IO;
+    if (count <= 0) return 0;
+
+    if (dst_ip == 0xFFFFFFFF)
+        memcpy(dst_mac, broadcast, ETH_ALEN);
+    else if (arp_resolve(next_hop(dst_ip), dst_mac) != 0)
+        return VNET_ERR_ARP;
+
+    /* Ethernet + IP header, patched per frame */
+    uint8_t hdr[ETH_HLEN + 20];
+    struct eth_hdr *eth = (struct eth_hdr *)hdr;
+    memcpy(eth->dst, dst_mac, ETH_ALEN);
+    memcpy(eth->src, vnet.mac, ETH_ALEN);
+    eth->ethertype = htons(ETH_TYPE_IPV4);
+
+    struct ipv4_hdr *ip = (struct ipv4_hdr *)(hdr + ETH_HLEN);
+    memset(ip, 0, sizeof(*ip));
+    ip->ver_ihl = 0x45;
+    ip->ttl = 64;
+    ip->protocol = protocol;
+    ip->flags_frag = htons(IP_FLAG_DF);
+    ip->src_ip = htonl(vnet.ip);
+    ip->dst_ip = htonl(dst_ip);
+
+    uint64_t start = rdtsc();
+    int queued = 0;
+    tx_lock();
+    for (; queued < count; queued++) {
+        const struct vnet_tx_frame *f = &frames[queued];
+        uint32_t len = f->hdr_len + f->payload_len;
+        if (len > VNET_IP_MAX_PAYLOAD)
+            break;
+
+        ip->total_len = htons((uint16_t)(20 + len));
+        ip->identification = htons(++vnet.ip_ident);
+        ip->checksum = 0;
+        ip->checksum = ip_checksum(ip, 20);
+
+        if (tx_enqueue_locked(hdr, sizeof(hdr), f->hdr, f->hdr_len,
+                              f->payload, f->payload_len, f->ref) != 0)
+            break;
+    }
+    tx_kick_locked();
+    vnet.stats.tx_batches++;
+    tx_unlock();
+    vnet.stats.tx_cycles += rdtsc() - start;
+
+    if (queued == 0)
+        return frames[0].hdr_len + frames[0].payload_len > VNET_IP_MAX_PAYLOAD ?
+               VNET_ERR_INVALID : VNET_ERR_IO;
+    return queued;
+}
+
+int virtio_net_send_ipv4(uint32_t dst_ip, uint8_t protocol,
+                         const void *payload, uint32_t len)
+{
+    struct vnet_tx_frame f = { NULL, 0, payload, len, NULL };
+    int ret = virtio_net_send_ipv4_batch(dst_ip, protocol, &f, 1);
+    return ret == 1 ? VNET_OK : ret;
+}
+
+void virtio_net_tx_reclaim(void)
+{
+    if (!vnet.initialized || !tx_trylock())
+        return;
+    tx_reclaim_locked();
+    tx_unlock();
 }
 
 /*============================================================================
@@ -555,9 +986,6 @@ static void send_icmp_echo_reply(uint32_t dst_ip_host, const uint8_t *dst_mac,
     uint8_t pkt[1600];
     uint32_t offset = 0;
 
-    memset(pkt, 0, VIRTIO_NET_HDR_SIZE);
-    offset += VIRTIO_NET_HDR_SIZE;
-
     struct eth_hdr *eth = (struct eth_hdr *)(pkt + offset);
     memcpy(eth->dst, dst_mac, ETH_ALEN);
     memcpy(eth->src, vnet.mac, ETH_ALEN);
@@ -592,49 +1020,25 @@ static void send_icmp_echo_reply(uint32_t dst_ip_host, const uint8_t *dst_mac,
 
     icmp->checksum = ip_checksum(icmp, (size_t)sizeof(struct icmp_hdr) + data_len);
 
-    virtio_net_send_raw(pkt, offset);
+    tx_send_frame(pkt, offset);
     vnet.stats.icmp_replies_sent++;
 }
 
 static int send_icmp_echo_request(uint32_t dst_ip_host, uint16_t id, uint16_t seq)
 {
-    if (!vnet.gateway_mac_known) return -1;
-
-    uint8_t pkt[1600];
-    uint32_t offset = 0;
-
-    memset(pkt, 0, VIRTIO_NET_HDR_SIZE);
-    offset += VIRTIO_NET_HDR_SIZE;
-
-    struct eth_hdr *eth = (struct eth_hdr *)(pkt + offset);
-    memcpy(eth->dst, vnet.gateway_mac, ETH_ALEN);
-    memcpy(eth->src, vnet.mac, ETH_ALEN);
-    eth->ethertype = htons(ETH_TYPE_IPV4);
-    offset += ETH_HLEN;
-
-    struct ipv4_hdr *ip = (struct ipv4_hdr *)(pkt + offset);
-    memset(ip, 0, sizeof(*ip));
-    ip->ver_ihl = 0x45;
-    ip->ttl = 64;
-    ip->protocol = IP_PROTO_ICMP;
-    ip->total_len = htons(20 + 8);  /* IP + ICMP echo (no payload) */
-    ip->src_ip = htonl(vnet.ip);
-    ip->dst_ip = htonl(dst_ip_host);
-    ip->checksum = 0;
-    ip->checksum = ip_checksum(ip, 20);
-    offset += 20;
-
-    struct icmp_hdr *icmp = (struct icmp_hdr *)(pkt + offset);
-    icmp->type = ICMP_ECHO_REQUEST;
-    icmp->code = 0;
-    icmp->id = htons(id);
-    icmp->seq = htons(seq);
-    icmp->checksum = 0;
-    icmp->checksum = ip_checksum(icmp, sizeof(struct icmp_hdr));
-    offset += (uint32_t)sizeof(struct icmp_hdr);
-
+    struct icmp_hdr icmp;   /* Echo without payload */
+    icmp.type = ICMP_ECHO_REQUEST;
+    icmp.code = 0;
+    icmp.id = htons(id);
+    icmp.seq = htons(seq);
+    icmp.checksum = 0;
+    icmp.checksum = ip_checksum(&icmp, sizeof(icmp));
+
+    if (virtio_net_send_ipv4(dst_ip_host, IP_PROTO_ICMP,
+                             &icmp, sizeof(icmp)) != VNET_OK)
+        return -1;
     vnet.stats.ping_sent++;
-    return virtio_net_send_raw(pkt, offset);
+    return 0;
 }
 
 /*============================================================================
@@ -650,12 +1054,14 @@ static void process_arp(const uint8_t *pkt_start, uint32_t len)
     uint32_t target_ip = ntohl(arp->target_ip);
     uint32_t sender_ip = ntohl(arp->sender_ip);
 
+    /* A request for us teaches us the asker; a reply only refreshes an
+     * entry we already have (unsolicited replies are ignored) */
     if (op == ARP_OP_REQUEST && target_ip == vnet.ip) {
+        arp_update(sender_ip, arp->sender_mac, 1);
         send_arp_reply(arp->sender_mac, sender_ip);
     }
-    else if (op == ARP_OP_REPLY && sender_ip == vnet.gateway) {
-        memcpy(vnet.gateway_mac, arp->sender_mac, ETH_ALEN);
-        vnet.gateway_mac_known = 1;
+    else if (op == ARP_OP_REPLY && target_ip == vnet.ip) {
+        arp_update(sender_ip, arp->sender_mac, 0);
     }
 }
 
@@ -674,7 +1080,10 @@ static void process_icmp(const struct ipv4_hdr *ip,
                               icmp->id, icmp->seq, data, data_len);
     }
     else if (icmp->type == ICMP_ECHO_REPLY && icmp->code == 0) {
-        if (ntohs(icmp->id) == vnet.ping_id) {
+        if (ntohs(icmp->id) == VNET_FLOOD_ID) {
+            vnet.flood_replies++;
+            vnet.stats.ping_received++;
+        } else if (ntohs(icmp->id) == vnet.ping_id) {
             vnet.ping_reply_received = 1;
             vnet.ping_rtt_ms = (int)(timer_get_ms() - vnet.ping_send_time_ms);
             vnet.stats.ping_received++;
@@ -682,7 +1091,8 @@ static void process_icmp(const struct ipv4_hdr *ip,
     }
 }
 
-static void process_ipv4(const uint8_t *pkt_start, uint32_t len,
+static void process_ipv4(struct net_buf *buf,
+                         const uint8_t *pkt_start, uint32_t len,
                          const uint8_t *src_mac)
 {
     if (len < 20) return;
@@ -698,72 +1108,313 @@ static void process_ipv4(const uint8_t *pkt_start, uint32_t len,
     uint32_t payload_len = ntohs(ip->total_len) - ihl;
     if (payload_len > len - ihl) payload_len = len - ihl;
 
-    if (ip->protocol == IP_PROTO_ICMP)
+    if (ip->protocol == IP_PROTO_ICMP) {
         process_icmp(ip, payload, payload_len, src_mac);
+    } else if (!(ntohs(ip->flags_frag) & IP_FRAG_MASK)) {
+        /* UDP and TCP; fragments are not reassembled */
+        netstack_input(buf, ntohl(ip->src_ip), ip->protocol,
+                       payload, payload_len);
+    }
 }
 
-static void process_packet(const uint8_t *raw, uint32_t total_len)
+static void process_packet(struct net_buf *buf)
 {
-    if (total_len < VIRTIO_NET_HDR_SIZE + ETH_HLEN) return;
-
-    const uint8_t *eth_start = raw + VIRTIO_NET_HDR_SIZE;
-    uint32_t eth_len = total_len - VIRTIO_NET_HDR_SIZE;
+    if (buf->len < ETH_HLEN) return;
 
-    const struct eth_hdr *eth = (const struct eth_hdr *)eth_start;
+    const struct eth_hdr *eth = (const struct eth_hdr *)buf->data;
     uint16_t ethertype = ntohs(eth->ethertype);
 
-    const uint8_t *payload = eth_start + ETH_HLEN;
-    uint32_t payload_len = eth_len - ETH_HLEN;
+    const uint8_t *payload = buf->data + ETH_HLEN;
+    uint32_t payload_len = buf->len - ETH_HLEN;
 
     switch (ethertype) {
     case ETH_TYPE_ARP:
         process_arp(payload, payload_len);
         break;
     case ETH_TYPE_IPV4:
-        process_ipv4(payload, payload_len, eth->src);
+        process_ipv4(buf, payload, payload_len, eth->src);
         break;
     }
 }
 
 /*============================================================================
- * Poll (call from event loop)
+ * Receive Ring
  *============================================================================*/
 
-void virtio_net_poll(void)
+static int rx_pending(void)
 {
-    if (!vnet.initialized) return;
+    return __atomic_load_n(&vnet.rx_used->idx, __ATOMIC_ACQUIRE) !=
+           vnet.rx_last_used;
+}
+
+/*
+ * Give buffers back to the device with one index update and at most one
+ * kick. Called from the receive round and from virtio_net_buf_release(),
+ * so the avail ring is only touched with interrupts off.
+ */
+static void rx_repost(const uint16_t *ids, int count)
+{
+    if (count == 0) return;
+
+    uint64_t flags = irq_save();
+    uint16_t avail_idx = vnet.rx_avail->idx;
+    for (int i = 0; i < count; i++) {
+        uint16_t id = ids[i];
+        vnet.rx_desc[id].len = VNET_RX_BUF_SIZE;
+        vnet.rx_desc[id].flags = VIRTQ_DESC_F_WRITE;
+        vnet.rx_avail->ring[(uint16_t)(avail_idx + i) & (vnet.rx_size - 1)] = id;
+    }
+    __asm__ volatile("mfence" ::: "memory");
+    vnet.rx_avail->idx = (uint16_t)(avail_idx + count);
+    __asm__ volatile("mfence" ::: "memory");
+    if (vq_need_kick(vnet.rx_used, vnet.rx_size, avail_idx,
+                     (uint16_t)(avail_idx + count)))
+        kick_queue(vnet.rx_notify_off, 0);
+    irq_restore(flags);
+}
 
-    int requeued = 0;
+/* Packets per second over windows of at least one second */
+static void rate_update(void)
+{
+    uint64_t now = timer_get_ms();
+    uint64_t elapsed = now - vnet.rate_start_ms;
+    if (elapsed < 1000) return;
+
+    uint64_t packets = vnet.stats.rx_packets - vnet.rate_start_packets;
+    vnet.stats.rx_pps = packets * 1000 / elapsed;
+    if (vnet.stats.rx_pps > vnet.stats.rx_pps_peak)
+        vnet.stats.rx_pps_peak = vnet.stats.rx_pps;
+    vnet.rate_start_ms = now;
+    vnet.rate_start_packets = vnet.stats.rx_packets;
+}
 
-    while (vnet.rx_used->idx != vnet.rx_last_used) {
-        uint16_t used_idx = vnet.rx_last_used % VNET_QUEUE_SIZE;
-        uint32_t desc_id = vnet.rx_used->ring[used_idx].id;
-        uint32_t data_len = vnet.rx_used->ring[used_idx].len;
+/*
+ * Process up to budget frames and repost their buffers. Returns the number
+ * of frames taken off the used ring. Only one round runs at a time.
+ */
+static int rx_round(int budget)
+{
+    uint16_t done_ids[VNET_QUEUE_SIZE];
+    int ndone = 0;
+    int frames = 0;
 
-        uint8_t *rx_data = vnet.rx_bufs + desc_id * VNET_RX_BUF_SIZE;
+    if (__atomic_exchange_n(&vnet.rx_busy, 1, __ATOMIC_ACQUIRE))
+        return 0;
 
-        vnet.stats.rx_packets++;
-        vnet.stats.rx_bytes += data_len;
+    TRACE_BEGIN(TRACE_ID_NET_POLL, 0, 0, 0);
+    vnet.stats.rx_poll_rounds++;
 
-        process_packet(rx_data, data_len);
+    while (frames < budget && rx_pending()) {
+        uint64_t start = rdtsc();
+        uint16_t slot = vnet.rx_last_used & (vnet.rx_size - 1);
+        uint16_t id = (uint16_t)vnet.rx_used->ring[slot].id;
+        uint32_t len = vnet.rx_used->ring[slot].len;
+        vnet.rx_last_used++;
+        done_ids[ndone++] = id;
+
+        const uint8_t *raw = vnet.rx_bufs + (uint32_t)id * VNET_RX_BUF_SIZE;
+        const struct virtio_net_hdr *hdr = (const struct virtio_net_hdr *)raw;
+        uint16_t nbufs = vnet.mergeable ? hdr->num_buffers : 1;
+
+        struct net_buf buf;
+        buf.id = id;
+        buf.held = 0;
+        buf.data = raw + vnet.hdr_len;
+        buf.len = len > vnet.hdr_len ? len - vnet.hdr_len : 0;
+        if (len > VNET_RX_BUF_SIZE)
+            buf.len = 0;
+
+        if (nbufs > 1) {
+            /*
+             * Frame spans several buffers. Without GSO offloads this needs
+             * a frame larger than VNET_RX_BUF_SIZE, so gather it into the
+             * merge buffer rather than making handlers walk a chain.
+             */
+            uint32_t total = buf.len;
+            if (total <= VNET_RX_MERGE_MAX)
+                memcpy(vnet.rx_merge, buf.data, total);
+            for (uint16_t n = 1; n < nbufs && rx_pending(); n++) {
+                slot = vnet.rx_last_used & (vnet.rx_size - 1);
+                uint16_t more = (uint16_t)vnet.rx_used->ring[slot].id;
+                uint32_t more_len = vnet.rx_used->ring[slot].len;
+                vnet.rx_last_used++;
+                done_ids[ndone++] = more;
+                if (more_len > VNET_RX_BUF_SIZE)
+                    more_len = 0;
+                if (total + more_len <= VNET_RX_MERGE_MAX)
+                    memcpy(vnet.rx_merge + total,
+                           vnet.rx_bufs + (uint32_t)more * VNET_RX_BUF_SIZE,
+                           more_len);
+                total += more_len;
+            }
+            buf.id = VNET_NO_BUF;
+            buf.data = vnet.rx_merge;
+            buf.len = total <= VNET_RX_MERGE_MAX ? total : 0;
+            vnet.stats.rx_merged++;
+        }
 
-        /* Re-queue the descriptor */
-        vnet.rx_desc[desc_id].len = VNET_RX_BUF_SIZE;
-        vnet.rx_desc[desc_id].flags = VIRTQ_DESC_F_WRITE;
+        if (buf.len == 0) {
+            vnet.stats.rx_dropped++;
+        } else {
+            vnet.stats.rx_packets++;
+            vnet.stats.rx_bytes += buf.len;
+            process_packet(&buf);
+        }
+
+        /* A held buffer goes back when the holder releases it */
+        if (buf.held)
+            ndone--;
 
-        uint16_t avail_idx = vnet.rx_avail->idx;
-        vnet.rx_avail->ring[avail_idx % VNET_QUEUE_SIZE] = (uint16_t)desc_id;
+        vnet.stats.rx_cycles += rdtsc() - start;
+        frames++;
+
+        /* Don't let done_ids overflow on a long merged frame */
+        if (ndone + VNET_RX_MERGE_MAX / VNET_RX_BUF_SIZE + 1 > VNET_QUEUE_SIZE)
+            break;
+    }
+
+    rx_repost(done_ids, ndone);
+    rate_update();
+
+    TRACE_END(TRACE_ID_NET_POLL, frames);
+    __atomic_store_n(&vnet.rx_busy, 0, __ATOMIC_RELEASE);
+    return frames;
+}
+
+int virtio_net_buf_hold(struct net_buf *buf)
+{
+    if (!buf || buf->id == VNET_NO_BUF || buf->held)
+        return -1;
+
+    uint64_t flags = irq_save();
+    int ok = vnet.rx_held_count < vnet.rx_size / 2;
+    if (ok) {
+        vnet.rx_held[buf->id] = 1;
+        vnet.rx_held_count++;
+        buf->held = 1;
+    }
+    irq_restore(flags);
+    return ok ? 0 : -1;
+}
+
+void virtio_net_buf_release(uint16_t id)
+{
+    if (!vnet.initialized || id >= vnet.rx_size)
+        return;
+
+    uint64_t flags = irq_save();
+    int was_held = vnet.rx_held[id];
+    if (was_held) {
+        vnet.rx_held[id] = 0;
+        vnet.rx_held_count--;
+    }
+    irq_restore(flags);
+
+    if (was_held)
+        rx_repost(&id, 1);
+}
+
+/*============================================================================
+ * Interrupt-Driven Receive
+ *============================================================================*/
+
+/*
+ * receiveq MSI-X: turn further receive interrupts off and hand the ring to
+ * the receive task. They stay off until the task has drained the ring.
+ */
+static void rx_irq_handler(struct interrupt_frame *frame)
+{
+    (void)frame;
+
+    vnet.stats.rx_interrupts++;
+    vq_irq_disable(vnet.rx_avail, vnet.rx_size, vnet.rx_last_used);
+    vnet.rx_scheduled = 1;
+    process_unblock(vnet.rx_task);
+    lapic_eoi();
+}
+
+static void rx_task(void *arg)
+{
+    (void)arg;
+
+    for (;;) {
+        /* Sleep until the interrupt; checked with interrupts off so a
+         * wakeup can't slip in between the test and the block */
+        for (;;) {
+            uint64_t flags = irq_save();
+            if (vnet.rx_scheduled) {
+                irq_restore(flags);
+                break;
+            }
+            process_block();
+        }
+
+        int frames = rx_round(VNET_RX_BUDGET);
+        net_poll();
+        virtio_net_tx_reclaim();
+
+        if (frames == VNET_RX_BUDGET) {
+            /* Still under load: stay in polling mode, let others run */
+            vnet.stats.rx_budget_exhausted++;
+            sched_yield();
+            continue;
+        }
+
+        /* Drained: re-arm, then catch a frame that raced the re-arm */
+        vnet.rx_scheduled = 0;
+        vq_irq_enable(vnet.rx_avail, vnet.rx_size, vnet.rx_last_used);
         __asm__ volatile("mfence" ::: "memory");
-        vnet.rx_avail->idx = avail_idx + 1;
+        if (rx_pending()) {
+            vq_irq_disable(vnet.rx_avail, vnet.rx_size, vnet.rx_last_used);
+            vnet.rx_scheduled = 1;
+        }
+    }
+}
 
-        vnet.rx_last_used++;
-        requeued = 1;
+/*
+ * Route receiveq completions to an MSI-X vector (table entry 0). Must run
+ * before the queues are set up; the device confirms per queue.
+ */
+static int rx_irq_setup(void)
+{
+    if (!lapic_available() || !sched_running())
+        return -1;
+
+    int vec = idt_alloc_msi_vector(rx_irq_handler);
+    if (vec < 0)
+        return -1;
+    if (pci_enable_msix(vnet.pci_dev, 0, (uint8_t)vec, lapic_id()) != 0) {
+        register_interrupt_handler((uint8_t)vec, NULL);
+        return -1;
     }
 
-    if (requeued)
-        kick_queue(vnet.rx_notify_off, 0);
+    vnet.vector = (uint8_t)vec;
+    vnet.msix = 1;
+    return 0;
 }
 
+/*============================================================================
+ * Poll (call from event loop)
+ *============================================================================*/
+
+void virtio_net_poll(void)
+{
+    if (!vnet.initialized) return;
+
+    /* Completed transmits; the receive task does this itself */
+    if (!vnet.rx_task)
+        virtio_net_tx_reclaim();
+
+    /* The receive task owns the ring when interrupts are working */
+    if (vnet.rx_task) return;
+
+    /* Idle polls happen every frame; only run a round when there is work */
+    if (!rx_pending()) return;
+
+    rx_round(vnet.rx_size);
+}
+
+
 /*============================================================================
  * Initialization
  *============================================================================*/
@@ -818,11 +1469,27 @@ int virtio_net_init(void)
         our_features |= VIRTIO_NET_F_MAC;
     if (dev_features & VIRTIO_NET_F_STATUS)
         our_features |= VIRTIO_NET_F_STATUS;
+    if (dev_features & VIRTIO_NET_F_MRG_RXBUF)
+        our_features |= VIRTIO_NET_F_MRG_RXBUF;
+    if (dev_features & VIRTIO_RING_F_EVENT_IDX)
+        our_features |= VIRTIO_RING_F_EVENT_IDX;
+
+    cfg->device_feature_select = 1;
+    __asm__ volatile("mfence" ::: "memory");
+    uint32_t our_features_hi = cfg->device_feature & VIRTIO_F_VERSION_1;
 
     cfg->driver_feature_select = 0;
     cfg->driver_feature = our_features;
+    cfg->driver_feature_select = 1;
+    cfg->driver_feature = our_features_hi;
     __asm__ volatile("mfence" ::: "memory");
 
+    /* Both add num_buffers to the header of every frame, sent or received */
+    vnet.mergeable = (our_features & VIRTIO_NET_F_MRG_RXBUF) != 0;
+    vnet.event_idx = (our_features & VIRTIO_RING_F_EVENT_IDX) != 0;
+    vnet.hdr_len = (vnet.mergeable || our_features_hi) ?
+                   VIRTIO_NET_HDR_MRG_SIZE : VIRTIO_NET_HDR_SIZE;
+
     cfg->device_status |= VIRTIO_STATUS_FEATURES_OK;
     __asm__ volatile("mfence" ::: "memory");
 
@@ -838,27 +1505,42 @@ int virtio_net_init(void)
             vnet.mac[0], vnet.mac[1], vnet.mac[2],
             vnet.mac[3], vnet.mac[4], vnet.mac[5]);
 
+    /* Config changes are not signalled; receiveq uses MSI-X entry 0 */
+    uint16_t rx_vector = VIRTIO_MSI_NO_VECTOR;
+    uint16_t tx_vector = VIRTIO_MSI_NO_VECTOR;
+    if (rx_irq_setup() == 0) {
+        cfg->msix_config = VIRTIO_MSI_NO_VECTOR;
+        rx_vector = 0;
+    }
+
     /* Set up receiveq (queue 0) */
     if (setup_virtqueue(0, &vnet.rx_desc, &vnet.rx_avail, &vnet.rx_used,
-                        &vnet.rx_notify_off) != 0) {
+                        &vnet.rx_size, &vnet.rx_notify_off, &rx_vector) != 0) {
         kprintf("[VirtIO Net] Failed to set up receiveq\n");
         cfg->device_status = 0;
         return -1;
     }
     vnet.rx_last_used = 0;
+    if (vnet.msix && rx_vector != 0) {
+        kprintf("[VirtIO Net] Device refused MSI-X vector, polling\n");
+        vnet.msix = 0;
+    }
 
-    /* Set up transmitq (queue 1) */
+    /* Set up transmitq (queue 1); completions are polled */
     if (setup_virtqueue(1, &vnet.tx_desc, &vnet.tx_avail, &vnet.tx_used,
-                        &vnet.tx_notify_off) != 0) {
+                        &vnet.tx_size, &vnet.tx_notify_off, &tx_vector) != 0) {
         kprintf("[VirtIO Net] Failed to set up transmitq\n");
         cfg->device_status = 0;
         return -1;
     }
-    vnet.tx_free_head = 0;
     vnet.tx_last_used = 0;
+    vnet.tx_kicked = 0;
+    vnet.tx_free_count = 0;
+    for (uint16_t pair = vnet.tx_size / 2; pair > 0; pair--)
+        vnet.tx_free[vnet.tx_free_count++] = (uint16_t)(pair - 1);
 
     /* Allocate RX buffers */
-    size_t rx_pages = (VNET_QUEUE_SIZE * VNET_RX_BUF_SIZE + 4095) / 4096;
+    size_t rx_pages = ((size_t)vnet.rx_size * VNET_RX_BUF_SIZE + 4095) / 4096;
     vnet.rx_bufs = (uint8_t *)pmm_alloc_pages(rx_pages);
     if (!vnet.rx_bufs) {
         kprintf("[VirtIO Net] Cannot allocate rx buffers\n");
@@ -867,16 +1549,18 @@ int virtio_net_init(void)
     }
     memset(vnet.rx_bufs, 0, rx_pages * 4096);
 
-    /* Allocate TX buffer */
-    vnet.tx_buf = (uint8_t *)pmm_alloc_pages(1);
-    if (!vnet.tx_buf) {
+    /* Allocate TX slots and the gather buffer for multi-buffer frames */
+    size_t tx_pages = ((size_t)vnet.tx_size / 2 * VNET_TX_SLOT_SIZE + 4095) / 4096;
+    vnet.tx_slots = (uint8_t *)pmm_alloc_pages(tx_pages);
+    vnet.rx_merge = (uint8_t *)pmm_alloc_pages(VNET_RX_MERGE_MAX / 4096);
+    if (!vnet.tx_slots || !vnet.rx_merge) {
         kprintf("[VirtIO Net] Cannot allocate tx buffer\n");
         cfg->device_status = 0;
         return -1;
     }
 
     /* Pre-fill receive descriptors */
-    for (int i = 0; i < VNET_QUEUE_SIZE; i++) {
+    for (int i = 0; i < vnet.rx_size; i++) {
         vnet.rx_desc[i].addr = (uint64_t)(uintptr_t)(vnet.rx_bufs +
                                 i * VNET_RX_BUF_SIZE);
         vnet.rx_desc[i].len = VNET_RX_BUF_SIZE;
@@ -884,7 +1568,12 @@ int virtio_net_init(void)
         vnet.rx_desc[i].next = 0xFFFF;
         vnet.rx_avail->ring[i] = (uint16_t)i;
     }
-    vnet.rx_avail->idx = VNET_QUEUE_SIZE;
+    vnet.rx_avail->idx = vnet.rx_size;
+
+    /* Polled receive never wants an interrupt; transmit never does */
+    if (!vnet.msix)
+        vq_irq_disable(vnet.rx_avail, vnet.rx_size, 0);
+    vq_irq_disable(vnet.tx_avail, vnet.tx_size, 0);
 
     /* Static IP configuration (QEMU user-mode defaults) */
     vnet.ip      = 0x0A00020F;  /* 10.0.2.15 */
@@ -898,11 +1587,25 @@ int virtio_net_init(void)
     /* Kick receiveq */
     kick_queue(vnet.rx_notify_off, 0);
 
+    vnet.rate_start_ms = timer_get_ms();
     vnet.initialized = 1;
     kprintf("[VirtIO Net] Initialized (IP 10.0.2.15, GW 10.0.2.2)\n");
 
-    /* Send ARP request to learn gateway MAC */
-    send_arp_request(vnet.gateway);
+    if (vnet.msix) {
+        pid_t pid = process_create("net-rx", rx_task, NULL);
+        vnet.rx_task = pid != PID_INVALID ? process_get(pid) : NULL;
+        if (!vnet.rx_task)
+            vq_irq_disable(vnet.rx_avail, vnet.rx_size, vnet.rx_last_used);
+    }
+    kprintf("[VirtIO Net] Rings: RX %u x %u bytes%s, TX %u%s; receive %s\n",
+            vnet.rx_size, VNET_RX_BUF_SIZE,
+            vnet.mergeable ? " (mergeable)" : "", vnet.tx_size,
+            vnet.event_idx ? ", event idx" : "",
+            vnet.rx_task ? "on MSI-X" : "polled");
+
+    /* Learn the gateway MAC */
+    uint8_t gw_mac[ETH_ALEN];
+    arp_resolve(vnet.gateway, gw_mac);
 
     return 0;
 }
@@ -921,13 +1624,11 @@ int virtio_net_ping(uint32_t dest_ip, uint16_t seq)
     vnet.ping_rtt_ms = -1;
     vnet.ping_send_time_ms = timer_get_ms();
 
-    if (!vnet.gateway_mac_known) {
-        send_arp_request(vnet.gateway);
-        for (int i = 0; i < 50 && !vnet.gateway_mac_known; i++) {
-            timer_sleep_ms(10);
-            virtio_net_poll();
-        }
-        if (!vnet.gateway_mac_known) return -1;
+    uint8_t mac[ETH_ALEN];
+    for (int i = 0; arp_resolve(next_hop(dest_ip), mac) != 0; i++) {
+        if (i == 50) return -1;
+        timer_sleep_ms(10);
+        virtio_net_poll();
     }
 
     return send_icmp_echo_request(dest_ip, vnet.ping_id, seq);
@@ -941,6 +1642,77 @@ int virtio_net_ping_check(void)
     return -1;
 }
 
+int virtio_net_ping_flood(uint32_t dest_ip, uint32_t count,
+                          struct vnet_flood_result *res)
+{
+    struct icmp_hdr reqs[VNET_FLOOD_BATCH];
+    struct vnet_tx_frame frames[VNET_FLOOD_BATCH];
+
+    memset(res, 0, sizeof(*res));
+    if (!vnet.initialized) return -1;
+
+    uint8_t mac[ETH_ALEN];
+    for (int i = 0; arp_resolve(next_hop(dest_ip), mac) != 0; i++) {
+        if (i == 50) return -1;
+        timer_sleep_ms(10);
+        virtio_net_poll();
+    }
+
+    vnet.flood_replies = 0;
+    uint32_t sent = 0;
+    uint64_t start = rdtsc();
+    uint64_t last_progress = timer_get_ms();
+    uint32_t last_replies = 0;
+
+    /* Keep a window of requests in flight; give up once replies stop */
+    while (vnet.flood_replies < count) {
+        uint32_t replies = vnet.flood_replies;
+        uint32_t room = VNET_FLOOD_WINDOW - (sent - replies);
+        uint32_t n = count - sent;
+        if (n > room) n = room;
+        if (n > VNET_FLOOD_BATCH) n = VNET_FLOOD_BATCH;
+
+        if (n >= VNET_FLOOD_BATCH / 2 || (n && sent + n == count)) {
+            for (uint32_t i = 0; i < n; i++) {
+                reqs[i].type = ICMP_ECHO_REQUEST;
+                reqs[i].code = 0;
+                reqs[i].id = htons(VNET_FLOOD_ID);
+                reqs[i].seq = htons((uint16_t)(sent + i));
+                reqs[i].checksum = 0;
+                reqs[i].checksum = ip_checksum(&reqs[i], sizeof(reqs[i]));
+                frames[i].hdr = &reqs[i];
+                frames[i].hdr_len = sizeof(reqs[i]);
+                frames[i].payload = NULL;
+                frames[i].payload_len = 0;
+                frames[i].ref = NULL;
+            }
+            int q = virtio_net_send_ipv4_batch(dest_ip, IP_PROTO_ICMP,
+                                               frames, (int)n);
+            if (q > 0) {
+                sent += (uint32_t)q;
+                vnet.stats.ping_sent += (uint32_t)q;
+            }
+        }
+
+        virtio_net_poll();
+        if (replies != last_replies) {
+            last_replies = replies;
+            last_progress = timer_get_ms();
+        } else if (timer_get_ms() - last_progress > 1000) {
+            break;
+        }
+        if (sched_has_ready())
+            sched_yield();
+        else
+            __asm__ volatile("pause");
+    }
+
+    res->sent = sent;
+    res->received = vnet.flood_replies;
+    res->elapsed_us = timer_tsc_to_ns(rdtsc() - start) / 1000;
+    return 0;
+}
+
 /*============================================================================
  * Accessor Functions
  *============================================================================*/
@@ -967,6 +1739,11 @@ const char *virtio_net_get_ip(void)
     return "10.0.2.15";
 }
 
+uint32_t virtio_net_ip_addr(void)
+{
+    return vnet.ip;
+}
+
 const struct net_stats *virtio_net_get_stats(void)
 {
     return &vnet.stats;
@@ -988,19 +1765,65 @@ void virtio_net_dump_info(void)
     kprintf("  IP:       10.0.2.15\n");
     kprintf("  Gateway:  10.0.2.2\n");
     kprintf("  Netmask:  255.255.255.0\n");
-    if (vnet.gateway_mac_known) {
-        kprintf("  GW MAC:   %02x:%02x:%02x:%02x:%02x:%02x\n",
-                vnet.gateway_mac[0], vnet.gateway_mac[1],
-                vnet.gateway_mac[2], vnet.gateway_mac[3],
-                vnet.gateway_mac[4], vnet.gateway_mac[5]);
+    uint64_t now = timer_get_ms();
+    for (int i = 0; i < ARP_CACHE_SIZE; i++) {
+        const struct arp_entry *e = &vnet.arp_cache[i];
+        if (e->state == ARP_FREE)
+            continue;
+        kprintf("  ARP:      %u.%u.%u.%u ", (e->ip >> 24) & 0xFF,
+                (e->ip >> 16) & 0xFF, (e->ip >> 8) & 0xFF, e->ip & 0xFF);
+        if (e->state == ARP_VALID)
+            kprintf("%02x:%02x:%02x:%02x:%02x:%02x (%lu s old)\n",
+                    e->mac[0], e->mac[1], e->mac[2],
+                    e->mac[3], e->mac[4], e->mac[5],
+                    (unsigned long)((now - e->updated_ms) / 1000));
+        else
+            kprintf("(resolving)\n");
+    }
+    kprintf("  Rings:    RX %u x %u bytes%s, TX %u (%u free)\n",
+            vnet.rx_size, VNET_RX_BUF_SIZE,
+            vnet.mergeable ? " (mergeable)" : "", vnet.tx_size,
+            vnet.tx_free_count * 2);
+    if (vnet.rx_task) {
+        kprintf("  Receive:  MSI-X vector %u, %lu interrupts, %lu rounds "
+                "(%lu over budget)\n", vnet.vector,
+                (unsigned long)vnet.stats.rx_interrupts,
+                (unsigned long)vnet.stats.rx_poll_rounds,
+                (unsigned long)vnet.stats.rx_budget_exhausted);
+    } else {
+        kprintf("  Receive:  polled, %lu rounds\n",
+                (unsigned long)vnet.stats.rx_poll_rounds);
     }
     kprintf("  TX:       %u packets, %u bytes\n",
             (unsigned)vnet.stats.tx_packets,
             (unsigned)vnet.stats.tx_bytes);
-    kprintf("  RX:       %u packets, %u bytes\n",
+    kprintf("  TX queue: %lu batches, %lu kicks, ring full %lu times%s\n",
+            (unsigned long)vnet.stats.tx_batches,
+            (unsigned long)vnet.stats.tx_kicks,
+            (unsigned long)vnet.stats.tx_ring_full,
+            vnet.event_idx ? " (event idx)" : "");
+    kprintf("  RX:       %u packets, %u bytes, %u dropped, %u merged\n",
             (unsigned)vnet.stats.rx_packets,
-            (unsigned)vnet.stats.rx_bytes);
-    kprintf("  ARP sent: %u\n", (unsigned)vnet.stats.arp_replies_sent);
+            (unsigned)vnet.stats.rx_bytes,
+            (unsigned)vnet.stats.rx_dropped,
+            (unsigned)vnet.stats.rx_merged);
+
+    rate_update();
+    uint64_t rx_cpp = vnet.stats.rx_packets ?
+                      vnet.stats.rx_cycles / vnet.stats.rx_packets : 0;
+    uint64_t tx_cpp = vnet.stats.tx_packets ?
+                      vnet.stats.tx_cycles / vnet.stats.tx_packets : 0;
+    kprintf("  RX rate:  %lu pps (peak %lu), %lu cycles/packet (%lu ns)\n",
+            (unsigned long)vnet.stats.rx_pps,
+            (unsigned long)vnet.stats.rx_pps_peak,
+            (unsigned long)rx_cpp, (unsigned long)timer_tsc_to_ns(rx_cpp));
+    kprintf("  TX cost:  %lu cycles/packet (%lu ns)\n",
+            (unsigned long)tx_cpp, (unsigned long)timer_tsc_to_ns(tx_cpp));
+    if (vnet.rx_held_count)
+        kprintf("  Held:     %u receive buffers\n", vnet.rx_held_count);
+    kprintf("  ARP sent: %u replies, %u requests\n",
+            (unsigned)vnet.stats.arp_replies_sent,
+            (unsigned)vnet.stats.arp_requests_sent);
     kprintf("  ICMP:     %u replies, %u pings sent, %u received\n",
             (unsigned)vnet.stats.icmp_replies_sent,
             (unsigned)vnet.stats.ping_sent,
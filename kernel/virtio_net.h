@@ -2,7 +2,8 @@
  * PhantomOS VirtIO Network Driver
  * "To Create, Not To Destroy"
  *
- * VirtIO-net PCI driver with minimal network stack (ARP + ICMP).
+ * VirtIO-net PCI driver with the link and IP layers (ARP, ICMP, IPv4).
+ * UDP and TCP sit on top in netstack.h.
  * Static IP 10.0.2.15/24, gateway 10.0.2.2 (QEMU user-mode defaults).
  */
 
@@ -18,9 +19,36 @@ struct net_stats {
     uint64_t tx_bytes;
     uint64_t rx_bytes;
     uint64_t arp_replies_sent;
+    uint64_t arp_requests_sent;
     uint64_t icmp_replies_sent;
     uint64_t ping_sent;
     uint64_t ping_received;
+    uint64_t rx_dropped;            /* Runt or oversized frames */
+    uint64_t rx_merged;             /* Frames gathered from several buffers */
+    uint64_t rx_interrupts;
+    uint64_t rx_poll_rounds;        /* Receive rounds run */
+    uint64_t rx_budget_exhausted;   /* Rounds that stayed in polling mode */
+    uint64_t rx_cycles;             /* TSC cycles handling received frames */
+    uint64_t tx_cycles;             /* TSC cycles in transmit */
+    uint64_t tx_batches;            /* Calls that queued frames */
+    uint64_t tx_kicks;              /* Device notifications actually sent */
+    uint64_t tx_ring_full;          /* Waits for the device to free a slot */
+    uint64_t rx_pps;                /* Receive rate over the last window */
+    uint64_t rx_pps_peak;
+};
+
+/*
+ * A received frame as seen by the protocol handlers: a reference into the
+ * receive ring, valid until the handler returns. A handler that needs the
+ * bytes longer calls virtio_net_buf_hold() and later releases the buffer
+ * by id; until then it is not given back to the device. Holding fails
+ * (copy instead) for gathered frames and when half the ring is held.
+ */
+struct net_buf {
+    const uint8_t *data;            /* Ethernet header onward */
+    uint32_t       len;
+    uint16_t       id;              /* Receive buffer index */
+    uint8_t        held;
 };
 
 int virtio_net_init(void);
@@ -32,6 +60,61 @@ const struct net_stats *virtio_net_get_stats(void);
 void virtio_net_poll(void);
 int virtio_net_ping(uint32_t dest_ip, uint16_t seq);
 int virtio_net_ping_check(void);
+
+struct vnet_flood_result {
+    uint32_t sent;
+    uint32_t received;
+    uint64_t elapsed_us;
+};
+
+/* Send count echo requests in batches, keeping a window in flight, and
+ * count the replies (gives up after a second without one) */
+int virtio_net_ping_flood(uint32_t dest_ip, uint32_t count,
+                          struct vnet_flood_result *res);
 void virtio_net_dump_info(void);
 
+int virtio_net_buf_hold(struct net_buf *buf);
+void virtio_net_buf_release(uint16_t id);
+
+/* Largest IPv4 payload in one frame (1500 MTU, no IP options) */
+#define VNET_IP_MAX_PAYLOAD 1480
+
+/* virtio_net_send_ipv4() results */
+#define VNET_OK             0
+#define VNET_ERR_IO         -1      /* Not up, or the device didn't take it */
+#define VNET_ERR_ARP        -2      /* Next hop unresolved; request sent */
+#define VNET_ERR_INVALID    -3
+
+/* Send one unfragmented IPv4 datagram (dst_ip in host byte order) */
+int virtio_net_send_ipv4(uint32_t dst_ip, uint8_t protocol,
+                         const void *payload, uint32_t len);
+
+/*
+ * One datagram for virtio_net_send_ipv4_batch(). hdr (the transport
+ * header) is copied. The payload is copied too when ref is NULL;
+ * otherwise the device reads it in place, and *ref is raised while it
+ * does: the payload must stay put until *ref drops back.
+ */
+struct vnet_tx_frame {
+    const void        *hdr;
+    uint32_t           hdr_len;
+    const void        *payload;
+    uint32_t           payload_len;
+    volatile uint32_t *ref;
+};
+
+/*
+ * Queue several datagrams to one destination and notify the device once.
+ * Returns how many were queued (a prefix of frames), or a VNET_ERR_* if
+ * none were.
+ */
+int virtio_net_send_ipv4_batch(uint32_t dst_ip, uint8_t protocol,
+                               const struct vnet_tx_frame *frames, int count);
+
+/* Reclaim completed transmit slots (done lazily otherwise) */
+void virtio_net_tx_reclaim(void);
+
+/* Our address, host byte order */
+uint32_t virtio_net_ip_addr(void);
+
 #endif /* PHANTOMOS_VIRTIO_NET_H */
@@ -0,0 +1,1260 @@
+/*
+ * PhantomOS xHCI USB Host Controller Driver
+ * "To Create, Not To Destroy"
+ *
+ * Every ring is one page of 256 TRBs; transfer and command rings end in a
+ * Link TRB that toggles the cycle bit. Only the event handler consumes the
+ * event ring, always with interrupts off, so HID reports enter the input
+ * ring under the same rule as the UHCI and PS/2 producers.
+ *
+ * Synchronous operations (commands, control transfers, bulk transfers)
+ * enqueue TRBs, ring the doorbell and wait on a completion flag that the
+ * event handler sets. Commands share one flag and are serialized by
+ * cmd_lock; transfers wait per device, and usb_msc.c serializes its own
+ * bulk traffic.
+ *
+ * Devices on root-hub ports only: hubs are reported and left unconfigured.
+ */
+
+#include "xhci.h"
+#include "usb.h"
+#include "usb_hid.h"
+#include "usb_msc.h"
+#include "pci.h"
+#include "lapic.h"
+#include "vmm.h"
+#include "pmm.h"
+#include "idt.h"
+#include "pic.h"
+#include "timer.h"
+#include "process.h"
+#include "io.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/*============================================================================
+ * External Declarations
+ *============================================================================*/
+
+extern int kprintf(const char *fmt, ...);
+extern void *memset(void *s, int c, size_t n);
+extern void *memcpy(void *dest, const void *src, size_t n);
+
+/*============================================================================
+ * Constants
+ *============================================================================*/
+
+#define XHCI_CMD_TIMEOUT_MS     500
+#define XHCI_XFER_TIMEOUT_MS    2000
+#define XHCI_CONFIG_MAX         1024    /* Bytes of config descriptor read */
+#define XHCI_CTRL_BUF_OFFSET    1024    /* Control data in the device page */
+#define XHCI_MAX_DCI            31
+
+#define TRB_STOP_EP             15
+
+#define XHCI_IRQ_NONE           0
+#define XHCI_IRQ_MSI            1
+#define XHCI_IRQ_INTX           2
+
+#define USB_CLASS_HUB           0x09
+
+/*============================================================================
+ * State
+ *============================================================================*/
+
+struct xhci_ring {
+    struct xhci_trb *trbs;              /* One page, NULL if unused */
+    uint32_t         index;             /* Enqueue (or dequeue) position */
+    uint32_t         cycle;             /* Producer (or consumer) cycle */
+};
+
+struct xhci_erst_entry {
+    uint64_t base;
+    uint32_t size;
+    uint32_t reserved;
+} __attribute__((packed));
+
+struct xhci_hid_ep {
+    uint8_t  dci;
+    uint8_t  halted;
+    uint8_t  iface;
+    uint8_t  ep_addr;
+    uint8_t  interval;                  /* bInterval */
+    uint8_t  type;                      /* USB_HID_KEYBOARD or _MOUSE */
+    uint16_t len;                       /* Bytes requested per report */
+    int      hid;                       /* usb_hid index, -1 if none */
+    uint8_t *buf;                       /* 64-byte DMA report buffer */
+};
+
+struct xhci_device {
+    int      used;
+    uint8_t  slot;
+    uint8_t  port;
+    uint8_t  speed;
+    uint16_t mps0;
+    uint8_t *in_ctx;                    /* Input context (page) */
+    uint8_t *out_ctx;                   /* Output device context (page) */
+    uint8_t *page;                      /* HID buffers + control data */
+    struct xhci_ring rings[XHCI_MAX_DCI + 1];   /* By DCI */
+    struct usb_device_desc desc;
+
+    /* Synchronous transfer completion */
+    volatile int xfer_done;
+    uint8_t  xfer_dci;
+    uint8_t  xfer_cc;
+    uint32_t xfer_residual;
+
+    /* HID boot interfaces */
+    int      hid_count;
+    struct xhci_hid_ep hid[XHCI_DEV_MAX_HID];
+
+    /* Bulk-Only mass storage */
+    int      msc;
+    uint8_t  msc_iface;
+    uint8_t  bulk_in, bulk_out;         /* DCIs */
+    uint8_t  bulk_in_addr, bulk_out_addr;
+    struct usb_msc_transport msc_tp;
+};
+
+static struct {
+    int      initialized;
+    const struct pci_device *pci;
+    volatile uint8_t  *cap;
+    volatile uint8_t  *op;
+    volatile uint8_t  *rt;
+    volatile uint32_t *db;
+    uint16_t version;
+    uint32_t max_slots;
+    uint32_t max_ports;
+    uint32_t ctx_size;
+    int      ac64;
+
+    uint64_t *dcbaa;
+    struct xhci_erst_entry *erst;
+    uint64_t *scratch;
+    uint32_t scratch_count;
+    struct xhci_ring cmd_ring;
+    struct xhci_ring event_ring;
+
+    struct xhci_device devices[XHCI_MAX_DEVICES];
+
+    /* Interrupt delivery */
+    int      irq_mode;
+    uint8_t  irq;
+    uint8_t  vector;
+    uint64_t irq_count;
+    uint64_t events;
+    uint64_t hid_errors;
+
+    /* Command completion */
+    volatile int cmd_done;
+    uint8_t  cmd_cc;
+    uint8_t  cmd_slot;
+
+    volatile uint32_t port_change;      /* Ports with unhandled events */
+} xhci;
+
+static volatile int cmd_lock = 0;
+static volatile int poll_busy = 0;
+
+/*============================================================================
+ * Register Access
+ *============================================================================*/
+
+static inline uint32_t op_read(uint32_t reg)
+{
+    return *(volatile uint32_t *)(xhci.op + reg);
+}
+
+static inline void op_write(uint32_t reg, uint32_t val)
+{
+    *(volatile uint32_t *)(xhci.op + reg) = val;
+}
+
+static inline void op_write64(uint32_t reg, uint64_t val)
+{
+    op_write(reg, (uint32_t)val);
+    op_write(reg + 4, (uint32_t)(val >> 32));
+}
+
+static inline uint32_t rt_read(uint32_t reg)
+{
+    return *(volatile uint32_t *)(xhci.rt + reg);
+}
+
+static inline void rt_write(uint32_t reg, uint32_t val)
+{
+    *(volatile uint32_t *)(xhci.rt + reg) = val;
+}
+
+static inline void rt_write64(uint32_t reg, uint64_t val)
+{
+    rt_write(reg, (uint32_t)val);
+    rt_write(reg + 4, (uint32_t)(val >> 32));
+}
+
+static inline void xhci_doorbell(uint8_t slot, uint8_t target)
+{
+    __asm__ volatile("" ::: "memory");
+    xhci.db[slot] = target;
+}
+
+static inline uint64_t phys(const void *p)
+{
+    return (uint64_t)(uintptr_t)p;
+}
+
+/* Contexts: input context has the control context at 0, slot at 1 and
+ * DCI n at n + 1; the output context has slot at 0 and DCI n at n */
+static inline uint32_t *ctx_at(uint8_t *base, uint32_t index)
+{
+    return (uint32_t *)(base + index * xhci.ctx_size);
+}
+
+/*============================================================================
+ * DMA Memory and Rings
+ *============================================================================*/
+
+static void *dma_page(void)
+{
+    uint8_t *p = pmm_alloc_page();
+    if (!p)
+        return NULL;
+    if (!xhci.ac64 && phys(p) >= 0x100000000ULL) {
+        pmm_free_page(p);
+        return NULL;
+    }
+    memset(p, 0, PAGE_SIZE);
+    return p;
+}
+
+static int ring_init(struct xhci_ring *r)
+{
+    r->trbs = dma_page();
+    if (!r->trbs)
+        return -1;
+    r->index = 0;
+    r->cycle = 1;
+
+    struct xhci_trb *link = &r->trbs[XHCI_RING_TRBS - 1];
+    link->param = phys(r->trbs);
+    link->control = XHCI_TRB_TYPE(TRB_LINK) | XHCI_TRB_TC;
+    return 0;
+}
+
+static void ring_free(struct xhci_ring *r)
+{
+    if (r->trbs)
+        pmm_free_page(r->trbs);
+    r->trbs = NULL;
+}
+
+/* Enqueue one TRB; the cycle bit is written last to hand it over */
+static void ring_push(struct xhci_ring *r, uint64_t param, uint32_t status,
+                      uint32_t control)
+{
+    struct xhci_trb *t = &r->trbs[r->index];
+    t->param = param;
+    t->status = status;
+    __asm__ volatile("" ::: "memory");
+    t->control = control | r->cycle;
+
+    if (++r->index == XHCI_RING_TRBS - 1) {
+        struct xhci_trb *link = &r->trbs[r->index];
+        link->control = (link->control & ~XHCI_TRB_CYCLE) | r->cycle;
+        r->cycle ^= 1;
+        r->index = 0;
+    }
+}
+
+/* Wait for a completion flag. Spins on the TSC so it also works with
+ * interrupts off, and polls the event ring itself when nothing else will */
+static void xhci_poll_events(void);
+
+static int xhci_wait(volatile int *flag, uint32_t timeout_ms)
+{
+    uint64_t khz = timer_tsc_khz();
+    uint64_t deadline = rdtsc() + (khz ? khz : 1000000) * timeout_ms;
+
+    while (!__atomic_load_n(flag, __ATOMIC_ACQUIRE)) {
+        if (xhci.irq_mode == XHCI_IRQ_NONE || !interrupts_enabled())
+            xhci_poll_events();
+        if (rdtsc() > deadline)
+            return -1;
+        __asm__ volatile("pause");
+    }
+    return 0;
+}
+
+/*============================================================================
+ * Event Handling (interrupts off)
+ *============================================================================*/
+
+static struct xhci_device *xhci_find_slot(uint8_t slot)
+{
+    for (int i = 0; i < XHCI_MAX_DEVICES; i++) {
+        if (xhci.devices[i].used && xhci.devices[i].slot == slot)
+            return &xhci.devices[i];
+    }
+    return NULL;
+}
+
+static void xhci_hid_arm(struct xhci_device *d, struct xhci_hid_ep *h)
+{
+    ring_push(&d->rings[h->dci], phys(h->buf), h->len,
+              XHCI_TRB_TYPE(TRB_NORMAL) | XHCI_TRB_IOC | XHCI_TRB_ISP);
+    xhci_doorbell(d->slot, h->dci);
+}
+
+static void xhci_handle_transfer(const struct xhci_trb *ev, uint32_t control)
+{
+    uint8_t slot = (uint8_t)(control >> 24);
+    uint8_t dci = (uint8_t)((control >> 16) & 0x1F);
+    uint8_t cc = (uint8_t)(ev->status >> 24);
+    uint32_t residual = ev->status & 0xFFFFFF;
+
+    struct xhci_device *d = xhci_find_slot(slot);
+    if (!d)
+        return;
+
+    for (int i = 0; i < d->hid_count; i++) {
+        struct xhci_hid_ep *h = &d->hid[i];
+        if (h->dci != dci)
+            continue;
+        if (cc == XHCI_CC_SUCCESS || cc == XHCI_CC_SHORT_PACKET) {
+            int len = (int)h->len - (int)residual;
+            usb_hid_deliver(h->hid, h->buf, len);
+            xhci_hid_arm(d, h);
+        } else {
+            /* Left halted; a replug re-enumerates the device */
+            h->halted = 1;
+            xhci.hid_errors++;
+        }
+        return;
+    }
+
+    if (dci == d->xfer_dci) {
+        d->xfer_cc = cc;
+        d->xfer_residual = residual;
+        __atomic_store_n(&d->xfer_done, 1, __ATOMIC_RELEASE);
+    }
+}
+
+static void xhci_process_events(void)
+{
+    struct xhci_ring *er = &xhci.event_ring;
+    uint32_t n = 0;
+
+    for (;;) {
+        struct xhci_trb *ev = &er->trbs[er->index];
+        uint32_t control = *(volatile uint32_t *)&ev->control;
+        if ((control & XHCI_TRB_CYCLE) != er->cycle)
+            break;
+        __asm__ volatile("" ::: "memory");
+
+        switch (XHCI_TRB_GET_TYPE(control)) {
+        case TRB_COMMAND_COMPLETE:
+            xhci.cmd_cc = (uint8_t)(ev->status >> 24);
+            xhci.cmd_slot = (uint8_t)(control >> 24);
+            __atomic_store_n(&xhci.cmd_done, 1, __ATOMIC_RELEASE);
+            break;
+        case TRB_TRANSFER_EVENT:
+            xhci_handle_transfer(ev, control);
+            break;
+        case TRB_PORT_STATUS_CHANGE: {
+            uint32_t port = (uint32_t)(ev->param >> 24) & 0xFF;
+            if (port >= 1 && port <= xhci.max_ports)
+                __atomic_or_fetch(&xhci.port_change, 1u << (port - 1),
+                                  __ATOMIC_RELAXED);
+            break;
+        }
+        default:
+            break;
+        }
+
+        n++;
+        if (++er->index == XHCI_RING_TRBS) {
+            er->index = 0;
+            er->cycle ^= 1;
+        }
+    }
+
+    if (n) {
+        xhci.events += n;
+        rt_write64(XHCI_RT_ERDP, phys(&er->trbs[er->index]) | XHCI_ERDP_EHB);
+    }
+}
+
+static void xhci_poll_events(void)
+{
+    int was_enabled = interrupts_enabled();
+    cli();
+    xhci_process_events();
+    if (was_enabled)
+        sti();
+}
+
+static void xhci_irq_handler(struct interrupt_frame *frame)
+{
+    (void)frame;
+
+    usb_hid_irq_mark();
+
+    if (op_read(XHCI_OP_USBSTS) & XHCI_STS_EINT)
+        op_write(XHCI_OP_USBSTS, XHCI_STS_EINT);
+    uint32_t iman = rt_read(XHCI_RT_IMAN);
+    if (iman & XHCI_IMAN_IP)
+        rt_write(XHCI_RT_IMAN, iman);       /* W1C IP, keep IE */
+
+    xhci.irq_count++;
+    xhci_process_events();
+
+    if (xhci.irq_mode == XHCI_IRQ_MSI)
+        lapic_eoi();
+    else
+        pic_send_eoi(xhci.irq);
+}
+
+/*============================================================================
+ * Commands
+ *============================================================================*/
+
+static int xhci_command(uint64_t param, uint32_t control, uint8_t *slot_out)
+{
+    while (__atomic_exchange_n(&cmd_lock, 1, __ATOMIC_ACQUIRE))
+        sched_yield();
+
+    __atomic_store_n(&xhci.cmd_done, 0, __ATOMIC_RELAXED);
+    ring_push(&xhci.cmd_ring, param, 0, control);
+    xhci_doorbell(0, 0);
+
+    int rc = xhci_wait(&xhci.cmd_done, XHCI_CMD_TIMEOUT_MS);
+    uint8_t cc = xhci.cmd_cc;
+    if (rc == 0 && slot_out)
+        *slot_out = xhci.cmd_slot;
+
+    __atomic_store_n(&cmd_lock, 0, __ATOMIC_RELEASE);
+
+    if (rc < 0) {
+        kprintf("[xHCI] Command %u timed out\n",
+                (unsigned)XHCI_TRB_GET_TYPE(control));
+        return -1;
+    }
+    return cc == XHCI_CC_SUCCESS ? 0 : -1;
+}
+
+/* Recover a halted or stuck endpoint: stop, reset, and move its dequeue
+ * pointer past everything queued so far */
+static void xhci_reset_ep(struct xhci_device *d, uint8_t dci)
+{
+    struct xhci_ring *r = &d->rings[dci];
+    uint32_t target = XHCI_TRB_SLOT(d->slot) | XHCI_TRB_EP(dci);
+
+    xhci_command(0, XHCI_TRB_TYPE(TRB_STOP_EP) | target, NULL);
+    xhci_command(0, XHCI_TRB_TYPE(TRB_RESET_EP) | target, NULL);
+    xhci_command(phys(&r->trbs[r->index]) | r->cycle,
+                 XHCI_TRB_TYPE(TRB_SET_TR_DEQUEUE) | target, NULL);
+}
+
+/*============================================================================
+ * Transfers
+ *============================================================================*/
+
+static int xhci_control(struct xhci_device *d, uint8_t request_type,
+                        uint8_t request, uint16_t value, uint16_t index,
+                        void *data, uint16_t len)
+{
+    struct xhci_ring *ep0 = &d->rings[1];
+    uint8_t *buf = d->page + XHCI_CTRL_BUF_OFFSET;
+    int in = (request_type & USB_RT_DEV_TO_HOST) != 0;
+
+    if (len > PAGE_SIZE - XHCI_CTRL_BUF_OFFSET)
+        return -1;
+
+    struct usb_setup_packet setup;
+    setup.bmRequestType = request_type;
+    setup.bRequest = request;
+    setup.wValue = value;
+    setup.wIndex = index;
+    setup.wLength = len;
+    uint64_t setup_imm;
+    memcpy(&setup_imm, &setup, sizeof(setup_imm));
+
+    if (!in && len)
+        memcpy(buf, data, len);
+
+    uint32_t trt = len == 0 ? XHCI_TRT_NO_DATA : in ? XHCI_TRT_IN : XHCI_TRT_OUT;
+    d->xfer_dci = 1;
+    __atomic_store_n(&d->xfer_done, 0, __ATOMIC_RELAXED);
+
+    ring_push(ep0, setup_imm, 8,
+              XHCI_TRB_TYPE(TRB_SETUP) | XHCI_TRB_IDT | trt);
+    if (len)
+        ring_push(ep0, phys(buf), len,
+                  XHCI_TRB_TYPE(TRB_DATA) | (in ? XHCI_TRB_DIR_IN : 0));
+    /* Status stage runs opposite to the data stage (IN when there is none) */
+    ring_push(ep0, 0, 0, XHCI_TRB_TYPE(TRB_STATUS) | XHCI_TRB_IOC |
+              ((len && in) ? 0 : XHCI_TRB_DIR_IN));
+    xhci_doorbell(d->slot, 1);
+
+    if (xhci_wait(&d->xfer_done, XHCI_XFER_TIMEOUT_MS) < 0) {
+        xhci_reset_ep(d, 1);
+        return -1;
+    }
+    if (d->xfer_cc != XHCI_CC_SUCCESS && d->xfer_cc != XHCI_CC_SHORT_PACKET) {
+        xhci_reset_ep(d, 1);
+        return -1;
+    }
+
+    if (in && len)
+        memcpy(data, buf, len);
+    return 0;
+}
+
+static int xhci_get_descriptor(struct xhci_device *d, uint8_t type,
+                               void *buf, uint16_t len)
+{
+    return xhci_control(d, USB_RT_DEV_TO_HOST, USB_REQ_GET_DESCRIPTOR,
+                        (uint16_t)type << 8, 0, buf, len);
+}
+
+/* Bulk transfer for usb_msc. A TRB may not cross a 64 KB boundary, so
+ * buf is sent as consecutive single-TRB TDs split at those boundaries */
+static int xhci_msc_bulk(void *ctx, int in, void *buf, uint32_t len,
+                         uint32_t *actual)
+{
+    struct xhci_device *d = (struct xhci_device *)ctx;
+    uint8_t dci = in ? d->bulk_in : d->bulk_out;
+    struct xhci_ring *r = &d->rings[dci];
+    uint8_t *p = (uint8_t *)buf;
+    uint32_t done = 0;
+
+    *actual = 0;
+    while (done < len) {
+        uint64_t addr = phys(p + done);
+        uint32_t chunk = len - done;
+        uint32_t to_boundary = 0x10000 - (uint32_t)(addr & 0xFFFF);
+        if (chunk > to_boundary)
+            chunk = to_boundary;
+
+        d->xfer_dci = dci;
+        __atomic_store_n(&d->xfer_done, 0, __ATOMIC_RELAXED);
+        ring_push(r, addr, chunk,
+                  XHCI_TRB_TYPE(TRB_NORMAL) | XHCI_TRB_IOC | XHCI_TRB_ISP);
+        xhci_doorbell(d->slot, dci);
+
+        if (xhci_wait(&d->xfer_done, XHCI_XFER_TIMEOUT_MS) < 0)
+            return USB_MSC_ERR;
+        if (d->xfer_cc == XHCI_CC_STALL)
+            return USB_MSC_STALL;
+        if (d->xfer_cc != XHCI_CC_SUCCESS &&
+            d->xfer_cc != XHCI_CC_SHORT_PACKET)
+            return USB_MSC_ERR;
+
+        uint32_t got = chunk - d->xfer_residual;
+        done += got;
+        *actual = done;
+        if (got < chunk)
+            break;                      /* Short packet ends the transfer */
+    }
+    return USB_MSC_OK;
+}
+
+static int xhci_msc_clear_halt(void *ctx, int in)
+{
+    struct xhci_device *d = (struct xhci_device *)ctx;
+
+    xhci_reset_ep(d, in ? d->bulk_in : d->bulk_out);
+    return xhci_control(d, USB_RT_HOST_TO_DEV | USB_RT_ENDPOINT,
+                        USB_REQ_CLEAR_FEATURE, USB_FEATURE_ENDPOINT_HALT,
+                        in ? d->bulk_in_addr : d->bulk_out_addr, NULL, 0);
+}
+
+static int xhci_msc_reset(void *ctx)
+{
+    struct xhci_device *d = (struct xhci_device *)ctx;
+
+    return xhci_control(d, USB_RT_HOST_TO_DEV | USB_RT_CLASS | USB_RT_INTERFACE,
+                        USB_REQ_MSC_RESET, 0, d->msc_iface, NULL, 0);
+}
+
+/*============================================================================
+ * Device Setup
+ *============================================================================*/
+
+static const char *speed_name(uint8_t speed)
+{
+    switch (speed) {
+    case XHCI_SPEED_FULL:  return "full";
+    case XHCI_SPEED_LOW:   return "low";
+    case XHCI_SPEED_HIGH:  return "high";
+    case XHCI_SPEED_SUPER: return "super";
+    default:               return "?";
+    }
+}
+
+static uint16_t default_mps0(uint8_t speed)
+{
+    switch (speed) {
+    case XHCI_SPEED_HIGH:  return 64;
+    case XHCI_SPEED_SUPER: return 512;
+    default:               return 8;
+    }
+}
+
+/* Endpoint context interval: 2^n * 125 us. FS/LS bInterval is in frames */
+static uint8_t ep_interval(uint8_t speed, uint8_t b_interval)
+{
+    if (speed == XHCI_SPEED_HIGH || speed == XHCI_SPEED_SUPER) {
+        if (b_interval < 1) b_interval = 1;
+        if (b_interval > 16) b_interval = 16;
+        return (uint8_t)(b_interval - 1);
+    }
+
+    uint32_t uframes = (uint32_t)(b_interval ? b_interval : 1) * 8;
+    uint8_t n = 0;
+    while ((2u << n) <= uframes)
+        n++;
+    if (n < 3) n = 3;
+    if (n > 10) n = 10;
+    return n;
+}
+
+static void fill_ep_ctx(uint32_t *ep, uint8_t type, uint16_t mps,
+                        uint8_t interval, const struct xhci_ring *r)
+{
+    ep[0] = (uint32_t)interval << 16;
+    ep[1] = (3u << 1) | ((uint32_t)type << 3) | ((uint32_t)mps << 16);
+    ep[2] = (uint32_t)phys(r->trbs) | 1;    /* DCS = 1 */
+    ep[3] = (uint32_t)(phys(r->trbs) >> 32);
+    if (type == XHCI_EP_INT_IN)
+        ep[4] = mps | ((uint32_t)mps << 16);    /* Avg TRB len, max ESIT */
+    else if (type == XHCI_EP_CONTROL)
+        ep[4] = 8;
+    else
+        ep[4] = 3072;
+}
+
+static void xhci_free_device(struct xhci_device *d)
+{
+    int was_enabled = interrupts_enabled();
+    cli();
+    d->used = 0;
+    d->hid_count = 0;
+    if (was_enabled)
+        sti();
+
+    if (d->slot && d->slot <= xhci.max_slots)
+        xhci.dcbaa[d->slot] = 0;
+    for (int i = 0; i <= XHCI_MAX_DCI; i++)
+        ring_free(&d->rings[i]);
+    if (d->in_ctx) pmm_free_page(d->in_ctx);
+    if (d->out_ctx) pmm_free_page(d->out_ctx);
+    if (d->page) pmm_free_page(d->page);
+    memset(d, 0, sizeof(*d));
+}
+
+/* Walk the configuration: pick HID boot interfaces and the first
+ * Bulk-Only mass-storage interface, then configure their endpoints */
+static int xhci_configure(struct xhci_device *d, const uint8_t *cfg,
+                          uint16_t len)
+{
+    struct usb_interface_desc cur;
+    int have_iface = 0;
+    uint32_t add_flags = 1;             /* Slot context */
+    uint8_t max_dci = 1;
+
+    memset(&cur, 0, sizeof(cur));
+    memset(d->in_ctx, 0, PAGE_SIZE);
+
+    for (uint16_t off = 0; off + 2 <= len; ) {
+        uint8_t dlen = cfg[off];
+        uint8_t dtype = cfg[off + 1];
+        if (dlen < 2 || off + dlen > len)
+            break;
+
+        if (dtype == USB_DESC_INTERFACE && dlen >= sizeof(cur)) {
+            memcpy(&cur, cfg + off, sizeof(cur));
+            have_iface = 1;
+        } else if (dtype == USB_DESC_ENDPOINT && have_iface &&
+                   dlen >= sizeof(struct usb_endpoint_desc)) {
+            struct usb_endpoint_desc ep;
+            memcpy(&ep, cfg + off, sizeof(ep));
+            int is_in = (ep.bEndpointAddress & 0x80) != 0;
+            uint8_t xfer = ep.bmAttributes & 0x03;
+            uint8_t dci = (uint8_t)((ep.bEndpointAddress & 0x0F) * 2 + is_in);
+            uint16_t mps = ep.wMaxPacketSize & 0x7FF;
+            uint8_t type = 0;
+
+            if (cur.bInterfaceClass == USB_CLASS_HID &&
+                cur.bInterfaceSubClass == USB_SUBCLASS_BOOT &&
+                (cur.bInterfaceProtocol == USB_PROTOCOL_KEYBOARD ||
+                 cur.bInterfaceProtocol == USB_PROTOCOL_MOUSE) &&
+                xfer == 3 && is_in && d->hid_count < XHCI_DEV_MAX_HID) {
+                struct xhci_hid_ep *h = &d->hid[d->hid_count];
+                h->dci = dci;
+                h->len = mps > 64 ? 64 : mps;
+                h->buf = d->page + d->hid_count * 64;
+                h->hid = -1;
+                h->type = cur.bInterfaceProtocol == USB_PROTOCOL_KEYBOARD ?
+                          USB_HID_KEYBOARD : USB_HID_MOUSE;
+                h->iface = cur.bInterfaceNumber;
+                h->ep_addr = ep.bEndpointAddress;
+                h->interval = ep.bInterval;
+                type = XHCI_EP_INT_IN;
+                if (ring_init(&d->rings[dci]) < 0)
+                    return -1;
+                fill_ep_ctx(ctx_at(d->in_ctx, dci + 1), type, mps,
+                            ep_interval(d->speed, ep.bInterval),
+                            &d->rings[dci]);
+                d->hid_count++;
+            } else if (cur.bInterfaceClass == USB_CLASS_MASS_STORAGE &&
+                       cur.bInterfaceSubClass == USB_MSC_SUBCLASS_SCSI &&
+                       cur.bInterfaceProtocol == USB_MSC_PROTOCOL_BOT &&
+                       xfer == 2 && !d->msc) {
+                type = is_in ? XHCI_EP_BULK_IN : XHCI_EP_BULK_OUT;
+                if (is_in && !d->bulk_in) {
+                    d->bulk_in = dci;
+                    d->bulk_in_addr = ep.bEndpointAddress;
+                } else if (!is_in && !d->bulk_out) {
+                    d->bulk_out = dci;
+                    d->bulk_out_addr = ep.bEndpointAddress;
+                } else {
+                    type = 0;
+                }
+                if (type) {
+                    d->msc_iface = cur.bInterfaceNumber;
+                    if (ring_init(&d->rings[dci]) < 0)
+                        return -1;
+                    fill_ep_ctx(ctx_at(d->in_ctx, dci + 1), type, mps, 0,
+                                &d->rings[dci]);
+                }
+            }
+
+            if (type) {
+                add_flags |= 1u << dci;
+                if (dci > max_dci)
+                    max_dci = dci;
+            }
+        }
+        off += dlen;
+    }
+
+    if (d->bulk_in && d->bulk_out)
+        d->msc = 1;
+    if (add_flags == 1)
+        return 0;                       /* Nothing we drive */
+
+    /* Input control context, then the slot context with the new
+     * Context Entries count */
+    ctx_at(d->in_ctx, 0)[1] = add_flags;
+    uint32_t *slot_in = ctx_at(d->in_ctx, 1);
+    memcpy(slot_in, ctx_at(d->out_ctx, 0), xhci.ctx_size);
+    slot_in[0] = (slot_in[0] & ~(0x1Fu << 27)) | ((uint32_t)max_dci << 27);
+    slot_in[3] = 0;
+
+    if (xhci_command(phys(d->in_ctx),
+                     XHCI_TRB_TYPE(TRB_CONFIGURE_EP) | XHCI_TRB_SLOT(d->slot),
+                     NULL) < 0) {
+        kprintf("[xHCI] Configure Endpoint failed for slot %u\n", d->slot);
+        return -1;
+    }
+    return 1;
+}
+
+static void xhci_start_hid(struct xhci_device *d)
+{
+    for (int i = 0; i < d->hid_count; i++) {
+        struct xhci_hid_ep *h = &d->hid[i];
+        uint8_t rt = USB_RT_HOST_TO_DEV | USB_RT_CLASS | USB_RT_INTERFACE;
+
+        xhci_control(d, rt, USB_REQ_HID_SET_PROTOCOL, USB_HID_PROTOCOL_BOOT,
+                     h->iface, NULL, 0);
+        xhci_control(d, rt, USB_REQ_HID_SET_IDLE, 0, h->iface, NULL, 0);
+
+        h->hid = usb_hid_attach(USB_HC_XHCI, d->slot, h->type, d->slot,
+                                h->ep_addr, h->len, h->interval);
+        if (h->hid < 0) {
+            h->halted = 1;
+            continue;
+        }
+
+        int was_enabled = interrupts_enabled();
+        cli();
+        xhci_hid_arm(d, h);
+        if (was_enabled)
+            sti();
+    }
+}
+
+static void xhci_start_msc(struct xhci_device *d)
+{
+    d->msc_tp.ctx = d;
+    d->msc_tp.bulk = xhci_msc_bulk;
+    d->msc_tp.clear_halt = xhci_msc_clear_halt;
+    d->msc_tp.reset = xhci_msc_reset;
+    if (usb_msc_attach(&d->msc_tp) < 0)
+        d->msc = 0;
+}
+
+/* Reset the port if needed, address the device and start its drivers */
+static int xhci_attach_port(uint8_t port)
+{
+    uint32_t sc = op_read(XHCI_OP_PORTSC(port));
+    if (!(sc & XHCI_PORT_CCS))
+        return -1;
+
+    /* USB2 ports need a reset to enable; USB3 ports enable themselves */
+    if (!(sc & XHCI_PORT_PED)) {
+        op_write(XHCI_OP_PORTSC(port), (sc & XHCI_PORT_PRESERVE) | XHCI_PORT_PR);
+        for (int i = 0; i < 20; i++) {
+            timer_sleep_ms(10);
+            sc = op_read(XHCI_OP_PORTSC(port));
+            if (sc & XHCI_PORT_PRC)
+                break;
+        }
+        op_write(XHCI_OP_PORTSC(port),
+                 (sc & XHCI_PORT_PRESERVE) | (sc & XHCI_PORT_CHANGE_BITS));
+        timer_sleep_ms(10);             /* Reset recovery */
+        sc = op_read(XHCI_OP_PORTSC(port));
+        if (!(sc & XHCI_PORT_PED)) {
+            kprintf("[xHCI] Port %u did not enable after reset\n", port);
+            return -1;
+        }
+    }
+
+    struct xhci_device *d = NULL;
+    for (int i = 0; i < XHCI_MAX_DEVICES; i++) {
+        if (!xhci.devices[i].used && !xhci.devices[i].slot) {
+            d = &xhci.devices[i];
+            break;
+        }
+    }
+    if (!d) {
+        kprintf("[xHCI] Too many devices, ignoring port %u\n", port);
+        return -1;
+    }
+
+    uint8_t slot = 0;
+    if (xhci_command(0, XHCI_TRB_TYPE(TRB_ENABLE_SLOT), &slot) < 0 ||
+        slot == 0 || slot > xhci.max_slots) {
+        kprintf("[xHCI] Enable Slot failed for port %u\n", port);
+        return -1;
+    }
+
+    d->slot = slot;
+    d->port = port;
+    d->speed = (uint8_t)XHCI_PORT_SPEED(sc);
+    d->mps0 = default_mps0(d->speed);
+    d->in_ctx = dma_page();
+    d->out_ctx = dma_page();
+    d->page = dma_page();
+    if (!d->in_ctx || !d->out_ctx || !d->page || ring_init(&d->rings[1]) < 0)
+        goto fail;
+
+    xhci.dcbaa[slot] = phys(d->out_ctx);
+    d->used = 1;
+
+    /* Address Device: slot context and EP0 */
+    ctx_at(d->in_ctx, 0)[1] = (1u << 0) | (1u << 1);
+    uint32_t *slot_ctx = ctx_at(d->in_ctx, 1);
+    slot_ctx[0] = ((uint32_t)d->speed << 20) | (1u << 27);
+    slot_ctx[1] = (uint32_t)port << 16;
+    fill_ep_ctx(ctx_at(d->in_ctx, 2), XHCI_EP_CONTROL, d->mps0, 0,
+                &d->rings[1]);
+
+    if (xhci_command(phys(d->in_ctx),
+                     XHCI_TRB_TYPE(TRB_ADDRESS_DEVICE) | XHCI_TRB_SLOT(slot),
+                     NULL) < 0) {
+        kprintf("[xHCI] Address Device failed on port %u\n", port);
+        goto fail;
+    }
+
+    /* First 8 bytes carry the real EP0 max packet size */
+    if (xhci_get_descriptor(d, USB_DESC_DEVICE, &d->desc, 8) < 0)
+        goto fail;
+    uint16_t mps0 = d->speed == XHCI_SPEED_SUPER ?
+                    (uint16_t)(1u << d->desc.bMaxPacketSize0) :
+                    d->desc.bMaxPacketSize0;
+    if (mps0 && mps0 != d->mps0) {
+        d->mps0 = mps0;
+        memset(d->in_ctx, 0, PAGE_SIZE);
+        ctx_at(d->in_ctx, 0)[1] = 1u << 1;
+        uint32_t *ep0 = ctx_at(d->in_ctx, 2);
+        memcpy(ep0, ctx_at(d->out_ctx, 1), xhci.ctx_size);
+        ep0[1] = (ep0[1] & 0xFFFF) | ((uint32_t)mps0 << 16);
+        if (xhci_command(phys(d->in_ctx),
+                         XHCI_TRB_TYPE(TRB_EVALUATE_CONTEXT) |
+                         XHCI_TRB_SLOT(slot), NULL) < 0)
+            goto fail;
+    }
+
+    if (xhci_get_descriptor(d, USB_DESC_DEVICE, &d->desc,
+                            sizeof(d->desc)) < 0)
+        goto fail;
+
+    kprintf("[xHCI] Port %u: %04x:%04x, %s speed, slot %u\n", port,
+            d->desc.idVendor, d->desc.idProduct, speed_name(d->speed), slot);
+
+    if (d->desc.bDeviceClass == USB_CLASS_HUB) {
+        kprintf("[xHCI] Hubs are not supported\n");
+        return 0;
+    }
+
+    /* Configuration descriptor: header first for the total length */
+    static uint8_t cfg[XHCI_CONFIG_MAX];
+    struct usb_config_desc hdr;
+    if (xhci_get_descriptor(d, USB_DESC_CONFIGURATION, &hdr, sizeof(hdr)) < 0)
+        goto fail;
+    uint16_t total = hdr.wTotalLength;
+    if (total > XHCI_CONFIG_MAX)
+        total = XHCI_CONFIG_MAX;
+    if (xhci_get_descriptor(d, USB_DESC_CONFIGURATION, cfg, total) < 0)
+        goto fail;
+
+    if (xhci_control(d, USB_RT_HOST_TO_DEV, USB_REQ_SET_CONFIGURATION,
+                     hdr.bConfigurationValue, 0, NULL, 0) < 0)
+        goto fail;
+
+    int rc = xhci_configure(d, cfg, total);
+    if (rc < 0)
+        goto fail;
+    if (rc == 0) {
+        kprintf("[xHCI] Slot %u: no supported interfaces\n", slot);
+        return 0;
+    }
+
+    if (d->hid_count)
+        xhci_start_hid(d);
+    if (d->msc)
+        xhci_start_msc(d);
+    return 0;
+
+fail:
+    kprintf("[xHCI] Enumeration failed on port %u\n", port);
+    xhci_command(0, XHCI_TRB_TYPE(TRB_DISABLE_SLOT) | XHCI_TRB_SLOT(slot), NULL);
+    xhci_free_device(d);
+    return -1;
+}
+
+static void xhci_detach_device(struct xhci_device *d)
+{
+    kprintf("[xHCI] Device on port %u disconnected\n", d->port);
+
+    if (d->msc)
+        usb_msc_detach(d);
+    for (int i = 0; i < d->hid_count; i++) {
+        if (d->hid[i].hid >= 0)
+            usb_hid_detach(d->hid[i].hid);
+    }
+
+    xhci_command(0, XHCI_TRB_TYPE(TRB_DISABLE_SLOT) | XHCI_TRB_SLOT(d->slot),
+                 NULL);
+    xhci_free_device(d);
+}
+
+/*============================================================================
+ * Controller Setup
+ *============================================================================*/
+
+static void xhci_bios_handoff(uint32_t hcc1)
+{
+    uint32_t off = XHCI_HCC1_XECP(hcc1) << 2;
+
+    while (off) {
+        volatile uint32_t *cap = (volatile uint32_t *)(xhci.cap + off);
+        uint32_t v = cap[0];
+
+        if ((v & 0xFF) == XHCI_XCAP_LEGACY) {
+            if (v & XHCI_LEGACY_BIOS_OWNED) {
+                cap[0] = v | XHCI_LEGACY_OS_OWNED;
+                for (int i = 0; i < 100 && (cap[0] & XHCI_LEGACY_BIOS_OWNED); i++)
+                    timer_sleep_ms(10);
+                if (cap[0] & XHCI_LEGACY_BIOS_OWNED)
+                    kprintf("[xHCI] BIOS did not release the controller\n");
+            }
+            cap[1] &= ~XHCI_LEGACY_SMI_MASK;
+            return;
+        }
+
+        uint32_t next = (v >> 8) & 0xFF;
+        if (!next)
+            break;
+        off += next << 2;
+    }
+}
+
+static int xhci_reset(void)
+{
+    op_write(XHCI_OP_USBCMD, op_read(XHCI_OP_USBCMD) & ~XHCI_CMD_RUN);
+    for (int i = 0; i < 100 && !(op_read(XHCI_OP_USBSTS) & XHCI_STS_HCH); i++)
+        timer_sleep_ms(1);
+
+    op_write(XHCI_OP_USBCMD, XHCI_CMD_HCRST);
+    for (int i = 0; i < 500; i++) {
+        if (!(op_read(XHCI_OP_USBCMD) & XHCI_CMD_HCRST) &&
+            !(op_read(XHCI_OP_USBSTS) & XHCI_STS_CNR))
+            return 0;
+        timer_sleep_ms(1);
+    }
+    return -1;
+}
+
+/*
+ * Completion interrupt: MSI through the local APIC if possible, else the
+ * legacy pin through the PIC, else xhci_poll() from the desktop loop.
+ */
+static void xhci_setup_irq(void)
+{
+    if (lapic_available()) {
+        int vec = idt_alloc_msi_vector(xhci_irq_handler);
+        if (vec >= 0) {
+            if (pci_enable_msi(xhci.pci, (uint8_t)vec, lapic_id()) == 0) {
+                xhci.irq_mode = XHCI_IRQ_MSI;
+                xhci.vector = (uint8_t)vec;
+                kprintf("[xHCI] Events on MSI vector %d\n", vec);
+                return;
+            }
+            register_interrupt_handler((uint8_t)vec, NULL);
+        }
+    }
+
+    xhci.irq = xhci.pci->irq_line;
+    if (xhci.irq == 0 || xhci.irq >= 16 || xhci.irq == 2 ||
+        interrupt_get_handler(IRQ_BASE + xhci.irq)) {
+        kprintf("[xHCI] No usable interrupt, polling events\n");
+        return;
+    }
+
+    register_interrupt_handler(IRQ_BASE + xhci.irq, xhci_irq_handler);
+    xhci.irq_mode = XHCI_IRQ_INTX;
+    pic_enable_irq(xhci.irq);
+    kprintf("[xHCI] Events on IRQ %d\n", xhci.irq);
+}
+
+void xhci_init(void)
+{
+    memset(&xhci, 0, sizeof(xhci));
+
+    xhci.pci = pci_find_class(PCI_CLASS_SERIAL, PCI_SUBCLASS_USB,
+                              PCI_PROG_IF_XHCI);
+    if (!xhci.pci) {
+        kprintf("[xHCI] No xHCI controller found\n");
+        return;
+    }
+    if (xhci.pci->bar_is_io[0] || xhci.pci->bar_addr[0] == 0) {
+        kprintf("[xHCI] BAR0 is not a memory BAR\n");
+        return;
+    }
+
+    /* Map the register space */
+    uint64_t base = xhci.pci->bar_addr[0];
+    uint64_t size = xhci.pci->bar_size[0] ? xhci.pci->bar_size[0] : 0x10000;
+    for (uint64_t off = 0; off < size; off += PAGE_SIZE) {
+        vmm_map_page(base + off, base + off,
+                     PTE_PRESENT | PTE_WRITABLE | PTE_NOCACHE | PTE_WRITETHROUGH);
+    }
+    pci_enable_memory_space(xhci.pci);
+    pci_enable_bus_master(xhci.pci);
+
+    xhci.cap = (volatile uint8_t *)(uintptr_t)base;
+    uint32_t hcs1 = *(volatile uint32_t *)(xhci.cap + XHCI_CAP_HCSPARAMS1);
+    uint32_t hcs2 = *(volatile uint32_t *)(xhci.cap + XHCI_CAP_HCSPARAMS2);
+    uint32_t hcc1 = *(volatile uint32_t *)(xhci.cap + XHCI_CAP_HCCPARAMS1);
+    xhci.op = xhci.cap + xhci.cap[XHCI_CAP_CAPLENGTH];
+    xhci.rt = xhci.cap + (*(volatile uint32_t *)(xhci.cap + XHCI_CAP_RTSOFF) & ~0x1Fu);
+    xhci.db = (volatile uint32_t *)(xhci.cap +
+              (*(volatile uint32_t *)(xhci.cap + XHCI_CAP_DBOFF) & ~0x3u));
+    xhci.version = *(volatile uint16_t *)(xhci.cap + XHCI_CAP_HCIVERSION);
+    xhci.ctx_size = (hcc1 & XHCI_HCC1_CSZ) ? 64 : 32;
+    xhci.ac64 = (hcc1 & XHCI_HCC1_AC64) != 0;
+    xhci.max_slots = XHCI_HCS1_MAX_SLOTS(hcs1);
+    if (xhci.max_slots > XHCI_MAX_SLOTS)
+        xhci.max_slots = XHCI_MAX_SLOTS;
+    xhci.max_ports = XHCI_HCS1_MAX_PORTS(hcs1);
+    if (xhci.max_ports > XHCI_MAX_PORTS)
+        xhci.max_ports = XHCI_MAX_PORTS;
+
+    kprintf("[xHCI] Controller %04x:%04x at 0x%lx, version %x.%02x, "
+            "%u ports, %u slots\n",
+            xhci.pci->vendor_id, xhci.pci->device_id, (unsigned long)base,
+            xhci.version >> 8, xhci.version & 0xFF,
+            xhci.max_ports, xhci.max_slots);
+
+    xhci_bios_handoff(hcc1);
+    if (xhci_reset() < 0) {
+        kprintf("[xHCI] Controller reset timed out\n");
+        return;
+    }
+
+    /* DCBAA (slot 0 = scratchpad array) and the event ring segment table
+     * share a page */
+    uint8_t *misc = dma_page();
+    if (!misc || ring_init(&xhci.cmd_ring) < 0) {
+        kprintf("[xHCI] Out of DMA memory\n");
+        return;
+    }
+    xhci.dcbaa = (uint64_t *)misc;
+    xhci.erst = (struct xhci_erst_entry *)(misc + 2048);
+
+    xhci.scratch_count = XHCI_HCS2_SCRATCH(hcs2);
+    if (xhci.scratch_count) {
+        xhci.scratch = dma_page();
+        if (!xhci.scratch || xhci.scratch_count > PAGE_SIZE / 8) {
+            kprintf("[xHCI] Cannot allocate %u scratchpad pages\n",
+                    xhci.scratch_count);
+            return;
+        }
+        for (uint32_t i = 0; i < xhci.scratch_count; i++) {
+            void *p = dma_page();
+            if (!p) {
+                kprintf("[xHCI] Out of DMA memory\n");
+                return;
+            }
+            xhci.scratch[i] = phys(p);
+        }
+        xhci.dcbaa[0] = phys(xhci.scratch);
+    }
+
+    /* The event ring has no Link TRB: the ERST gives its size */
+    xhci.event_ring.trbs = dma_page();
+    if (!xhci.event_ring.trbs) {
+        kprintf("[xHCI] Out of DMA memory\n");
+        return;
+    }
+    xhci.event_ring.cycle = 1;
+    xhci.erst[0].base = phys(xhci.event_ring.trbs);
+    xhci.erst[0].size = XHCI_RING_TRBS;
+
+    op_write(XHCI_OP_CONFIG, xhci.max_slots);
+    op_write(XHCI_OP_DNCTRL, 0);
+    op_write64(XHCI_OP_DCBAAP, phys(xhci.dcbaa));
+    op_write64(XHCI_OP_CRCR, phys(xhci.cmd_ring.trbs) | XHCI_CRCR_RCS);
+
+    rt_write(XHCI_RT_ERSTSZ, 1);
+    rt_write64(XHCI_RT_ERDP, phys(xhci.event_ring.trbs));
+    rt_write64(XHCI_RT_ERSTBA, phys(xhci.erst));
+    rt_write(XHCI_RT_IMOD, 0);          /* No moderation: lowest HID latency */
+
+    xhci_setup_irq();
+    rt_write(XHCI_RT_IMAN, XHCI_IMAN_IP | XHCI_IMAN_IE);
+    op_write(XHCI_OP_USBCMD, XHCI_CMD_RUN |
+             (xhci.irq_mode != XHCI_IRQ_NONE ? XHCI_CMD_INTE : 0));
+    for (int i = 0; i < 100 && (op_read(XHCI_OP_USBSTS) & XHCI_STS_HCH); i++)
+        timer_sleep_ms(1);
+    if (op_read(XHCI_OP_USBSTS) & XHCI_STS_HCH) {
+        kprintf("[xHCI] Controller did not start\n");
+        return;
+    }
+    /* Init may run as a deferred task: keep xhci_poll() from the desktop
+     * out of the port scan */
+    __atomic_store_n(&poll_busy, 1, __ATOMIC_RELAXED);
+    xhci.initialized = 1;
+
+    /* Let USB3 links train, then enumerate what is already plugged in */
+    timer_sleep_ms(20);
+    for (uint32_t port = 1; port <= xhci.max_ports; port++) {
+        uint32_t sc = op_read(XHCI_OP_PORTSC(port));
+        op_write(XHCI_OP_PORTSC(port),
+                 (sc & XHCI_PORT_PRESERVE) | (sc & XHCI_PORT_CHANGE_BITS));
+        if (sc & XHCI_PORT_CCS)
+            xhci_attach_port((uint8_t)port);
+    }
+    __atomic_store_n(&xhci.port_change, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&poll_busy, 0, __ATOMIC_RELEASE);
+}
+
+/*============================================================================
+ * Public API
+ *============================================================================*/
+
+int xhci_is_initialized(void)
+{
+    return xhci.initialized;
+}
+
+void xhci_poll(void)
+{
+    if (!xhci.initialized)
+        return;
+    if (__atomic_exchange_n(&poll_busy, 1, __ATOMIC_ACQUIRE))
+        return;
+
+    if (xhci.irq_mode == XHCI_IRQ_NONE)
+        xhci_poll_events();
+
+    uint32_t pending = __atomic_exchange_n(&xhci.port_change, 0,
+                                           __ATOMIC_ACQ_REL);
+    for (uint32_t port = 1; pending && port <= xhci.max_ports; port++) {
+        if (!(pending & (1u << (port - 1))))
+            continue;
+
+        uint32_t sc = op_read(XHCI_OP_PORTSC(port));
+        op_write(XHCI_OP_PORTSC(port),
+                 (sc & XHCI_PORT_PRESERVE) | (sc & XHCI_PORT_CHANGE_BITS));
+
+        struct xhci_device *d = NULL;
+        for (int i = 0; i < XHCI_MAX_DEVICES; i++) {
+            if (xhci.devices[i].used && xhci.devices[i].port == port) {
+                d = &xhci.devices[i];
+                break;
+            }
+        }
+
+        if ((sc & XHCI_PORT_CCS) && !d)
+            xhci_attach_port((uint8_t)port);
+        else if (!(sc & XHCI_PORT_CCS) && d)
+            xhci_detach_device(d);
+    }
+
+    __atomic_store_n(&poll_busy, 0, __ATOMIC_RELEASE);
+}
+
+int xhci_device_count(void)
+{
+    int n = 0;
+    for (int i = 0; i < XHCI_MAX_DEVICES; i++) {
+        if (xhci.devices[i].used)
+            n++;
+    }
+    return n;
+}
+
+void xhci_dump_status(void)
+{
+    static const char *irq_names[] = { "polled", "MSI", "INTx" };
+
+    kprintf("\nxHCI Controller\n");
+    kprintf("===============\n");
+
+    if (!xhci.initialized) {
+        kprintf("  Not initialized\n");
+        return;
+    }
+
+    kprintf("  Version %x.%02x, %u ports, %u slots, %u-byte contexts\n",
+            xhci.version >> 8, xhci.version & 0xFF, xhci.max_ports,
+            xhci.max_slots, xhci.ctx_size);
+    kprintf("  Events: %s", irq_names[xhci.irq_mode]);
+    if (xhci.irq_mode == XHCI_IRQ_MSI)
+        kprintf(" (vector %u)", xhci.vector);
+    else if (xhci.irq_mode == XHCI_IRQ_INTX)
+        kprintf(" (IRQ %u)", xhci.irq);
+    kprintf(", %lu interrupts, %lu events, %lu HID errors\n",
+            (unsigned long)xhci.irq_count, (unsigned long)xhci.events,
+            (unsigned long)xhci.hid_errors);
+
+    for (int i = 0; i < XHCI_MAX_DEVICES; i++) {
+        struct xhci_device *d = &xhci.devices[i];
+        if (!d->used)
+            continue;
+        kprintf("  Slot %u: port %u, %04x:%04x, %s speed, EP0 %u bytes",
+                d->slot, d->port, d->desc.idVendor, d->desc.idProduct,
+                speed_name(d->speed), d->mps0);
+        if (d->hid_count)
+            kprintf(", %d HID", d->hid_count);
+        if (d->msc)
+            kprintf(", mass storage");
+        kprintf("\n");
+    }
+}
@@ -0,0 +1,202 @@
+/*
+ * PhantomOS xHCI USB Host Controller Driver
+ * "To Create, Not To Destroy"
+ *
+ * USB 3.x host controller (PCI class 0x0C/0x03, prog_if 0x30). The
+ * controller is driven through three kinds of TRB rings in memory:
+ *   - one command ring (Enable Slot, Address Device, Configure Endpoint, ...)
+ *   - one event ring on interrupter 0 (command completions, transfer
+ *     completions, port status changes)
+ *   - one transfer ring per active endpoint
+ *
+ * Completions are taken from the event ring by an MSI handler when the
+ * local APIC is usable, otherwise by the legacy INTx line, otherwise by
+ * xhci_poll(). HID boot keyboards and mice are handed to usb_hid.c with
+ * their interrupt IN reports delivered straight from the event handler;
+ * Bulk-Only mass-storage devices become the USB disk (usb_msc.h).
+ */
+
+#ifndef PHANTOMOS_XHCI_H
+#define PHANTOMOS_XHCI_H
+
+#include <stdint.h>
+
+/*============================================================================
+ * Capability Registers (BAR0 + 0)
+ *============================================================================*/
+
+#define XHCI_CAP_CAPLENGTH      0x00    /* 8-bit: operational regs offset */
+#define XHCI_CAP_HCIVERSION     0x02    /* 16-bit */
+#define XHCI_CAP_HCSPARAMS1     0x04
+#define XHCI_CAP_HCSPARAMS2     0x08
+#define XHCI_CAP_HCCPARAMS1     0x10
+#define XHCI_CAP_DBOFF          0x14
+#define XHCI_CAP_RTSOFF         0x18
+
+#define XHCI_HCS1_MAX_SLOTS(p)  ((p) & 0xFF)
+#define XHCI_HCS1_MAX_PORTS(p)  (((p) >> 24) & 0xFF)
+#define XHCI_HCS2_SCRATCH(p)    ((((p) >> 16) & 0x3E0) | (((p) >> 27) & 0x1F))
+#define XHCI_HCC1_AC64          (1 << 0)
+#define XHCI_HCC1_CSZ           (1 << 2)    /* 64-byte contexts */
+#define XHCI_HCC1_XECP(p)       (((p) >> 16) & 0xFFFF)
+
+/*============================================================================
+ * Operational Registers (BAR0 + CAPLENGTH)
+ *============================================================================*/
+
+#define XHCI_OP_USBCMD          0x00
+#define XHCI_OP_USBSTS          0x04
+#define XHCI_OP_PAGESIZE        0x08
+#define XHCI_OP_DNCTRL          0x14
+#define XHCI_OP_CRCR            0x18    /* 64-bit */
+#define XHCI_OP_DCBAAP          0x30    /* 64-bit */
+#define XHCI_OP_CONFIG          0x38
+#define XHCI_OP_PORTSC(n)       (0x400 + 0x10 * ((n) - 1))  /* n is 1-based */
+
+#define XHCI_CMD_RUN            (1 << 0)
+#define XHCI_CMD_HCRST          (1 << 1)
+#define XHCI_CMD_INTE           (1 << 2)
+
+#define XHCI_STS_HCH            (1 << 0)    /* Halted */
+#define XHCI_STS_HSE            (1 << 2)    /* Host system error */
+#define XHCI_STS_EINT           (1 << 3)    /* Event interrupt (W1C) */
+#define XHCI_STS_PCD            (1 << 4)    /* Port change detect (W1C) */
+#define XHCI_STS_CNR            (1 << 11)   /* Controller not ready */
+
+#define XHCI_CRCR_RCS           (1 << 0)
+
+/* PORTSC */
+#define XHCI_PORT_CCS           (1 << 0)    /* Current connect status */
+#define XHCI_PORT_PED           (1 << 1)    /* Enabled (W1C: disables!) */
+#define XHCI_PORT_PR            (1 << 4)    /* Port reset */
+#define XHCI_PORT_PP            (1 << 9)    /* Port power */
+#define XHCI_PORT_SPEED(p)      (((p) >> 10) & 0xF)
+#define XHCI_PORT_CSC           (1 << 17)
+#define XHCI_PORT_PEC           (1 << 18)
+#define XHCI_PORT_WRC           (1 << 19)
+#define XHCI_PORT_OCC           (1 << 20)
+#define XHCI_PORT_PRC           (1 << 21)
+#define XHCI_PORT_PLC           (1 << 22)
+#define XHCI_PORT_CEC           (1 << 23)
+#define XHCI_PORT_CHANGE_BITS   (XHCI_PORT_CSC | XHCI_PORT_PEC | \
+                                 XHCI_PORT_WRC | XHCI_PORT_OCC | \
+                                 XHCI_PORT_PRC | XHCI_PORT_PLC | \
+                                 XHCI_PORT_CEC)
+/* Bits that keep their value when written back: RO and RWS fields */
+#define XHCI_PORT_PRESERVE      ((1 << 0) | (1 << 3) | (0xF << 5) | \
+                                 (1 << 9) | (0xF << 10) | (3 << 14) | \
+                                 (7 << 25) | (1 << 30))
+
+/* Port speeds (PORTSC and slot context) */
+#define XHCI_SPEED_FULL         1
+#define XHCI_SPEED_LOW          2
+#define XHCI_SPEED_HIGH         3
+#define XHCI_SPEED_SUPER        4
+
+/*============================================================================
+ * Runtime Registers (BAR0 + RTSOFF), interrupter 0
+ *============================================================================*/
+
+#define XHCI_RT_IMAN            0x20
+#define XHCI_RT_IMOD            0x24
+#define XHCI_RT_ERSTSZ          0x28
+#define XHCI_RT_ERSTBA          0x30    /* 64-bit */
+#define XHCI_RT_ERDP            0x38    /* 64-bit */
+
+#define XHCI_IMAN_IP            (1 << 0)    /* Interrupt pending (W1C) */
+#define XHCI_IMAN_IE            (1 << 1)
+#define XHCI_ERDP_EHB           (1 << 3)    /* Event handler busy (W1C) */
+
+/*============================================================================
+ * Extended Capabilities
+ *============================================================================*/
+
+#define XHCI_XCAP_LEGACY        1
+#define XHCI_LEGACY_BIOS_OWNED  (1 << 16)
+#define XHCI_LEGACY_OS_OWNED    (1 << 24)
+#define XHCI_LEGACY_SMI_MASK    0xE01F      /* SMI enables in USBLEGCTLSTS */
+
+/*============================================================================
+ * Transfer Request Blocks
+ *============================================================================*/
+
+struct xhci_trb {
+    uint64_t param;
+    uint32_t status;
+    uint32_t control;
+} __attribute__((packed, aligned(16)));
+
+#define XHCI_TRB_CYCLE          (1 << 0)
+#define XHCI_TRB_TC             (1 << 1)    /* Link: toggle cycle */
+#define XHCI_TRB_ISP            (1 << 2)    /* Interrupt on short packet */
+#define XHCI_TRB_IOC            (1 << 5)
+#define XHCI_TRB_IDT            (1 << 6)    /* Immediate data */
+#define XHCI_TRB_DIR_IN         (1 << 16)
+#define XHCI_TRB_TYPE(t)        ((uint32_t)(t) << 10)
+#define XHCI_TRB_GET_TYPE(c)    (((c) >> 10) & 0x3F)
+#define XHCI_TRB_SLOT(s)        ((uint32_t)(s) << 24)
+#define XHCI_TRB_EP(e)          ((uint32_t)(e) << 16)
+
+/* Setup stage transfer type */
+#define XHCI_TRT_NO_DATA        (0 << 16)
+#define XHCI_TRT_OUT            (2 << 16)
+#define XHCI_TRT_IN             (3 << 16)
+
+/* TRB types */
+#define TRB_NORMAL              1
+#define TRB_SETUP               2
+#define TRB_DATA                3
+#define TRB_STATUS              4
+#define TRB_LINK                6
+#define TRB_ENABLE_SLOT         9
+#define TRB_DISABLE_SLOT        10
+#define TRB_ADDRESS_DEVICE      11
+#define TRB_CONFIGURE_EP        12
+#define TRB_EVALUATE_CONTEXT    13
+#define TRB_RESET_EP            14
+#define TRB_SET_TR_DEQUEUE      16
+#define TRB_TRANSFER_EVENT      32
+#define TRB_COMMAND_COMPLETE    33
+#define TRB_PORT_STATUS_CHANGE  34
+
+/* Completion codes */
+#define XHCI_CC_SUCCESS         1
+#define XHCI_CC_STALL           6
+#define XHCI_CC_SHORT_PACKET    13
+
+/* Endpoint context types */
+#define XHCI_EP_BULK_OUT        2
+#define XHCI_EP_CONTROL         4
+#define XHCI_EP_BULK_IN         6
+#define XHCI_EP_INT_IN          7
+
+/*============================================================================
+ * Limits
+ *============================================================================*/
+
+#define XHCI_MAX_SLOTS          16
+#define XHCI_MAX_DEVICES        8
+#define XHCI_MAX_PORTS          32
+#define XHCI_RING_TRBS          256     /* One page per ring */
+#define XHCI_DEV_MAX_HID        2       /* HID interfaces per device */
+
+/*============================================================================
+ * API
+ *============================================================================*/
+
+/* Find and start the controller, enumerate attached devices */
+void xhci_init(void);
+
+int xhci_is_initialized(void);
+
+/* Hot-plug handling, and event processing when running without an
+ * interrupt (desktop loop) */
+void xhci_poll(void);
+
+/* Number of addressed devices */
+int xhci_device_count(void);
+
+/* Print controller and device info for shell */
+void xhci_dump_status(void);
+
+#endif /* PHANTOMOS_XHCI_H */
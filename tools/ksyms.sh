@@ -0,0 +1,32 @@
+#!/bin/sh
+#
+# PhantomOS kernel symbol table generator
+# "To Create, Not To Destroy"
+#
+# Reads `nm -n` output for the first-pass kernel image on stdin and writes
+# the C source of the embedded symbol table (see kernel/ksyms.h) to stdout.
+# Only text symbols are kept; the output is already sorted by address.
+#
+# Usage: nm -n phantomos.elf.pass1 | tools/ksyms.sh > kernel/ksyms_gen.c
+
+awk '
+BEGIN {
+    print "/* Generated by tools/ksyms.sh at link time -- do not edit */"
+    print ""
+    print "#include \"ksyms.h\""
+    print ""
+    print "const struct ksym ksym_table[] = {"
+    n = 0
+}
+$2 ~ /^[TtWw]$/ && $3 !~ /^__/ {
+    printf "    { 0x%sULL, \"%s\" },\n", $1, $3
+    n++
+}
+END {
+    if (n == 0)
+        print "    { 0, \"\" },"
+    print "};"
+    print ""
+    printf "const uint32_t ksym_count = %d;\n", n
+}
+'
@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""
+PhantomOS trace converter — turns a kernel trace dump into Chrome trace JSON.
+
+Usage:
+  1. In the PhantomOS shell:
+       trace start
+       ... exercise the system ...
+       trace save                 (writes /trace/trace.bin)
+
+  2. Copy the file out of the volume and convert it:
+       python3 tools/trace2json.py trace.bin > trace.json
+
+  3. Open trace.json in chrome://tracing or https://ui.perfetto.dev
+
+Each PID becomes a thread track; records emitted from interrupt handlers go
+on a separate "irq" track so handler time is visible on its own.
+"""
+
+import sys
+import json
+import struct
+
+TRACE_FILE_MAGIC = 0x3145434152544850      # "PHTRACE1"
+HEADER_FMT = "<QIIQIIQ"                     # struct trace_file_header
+RECORD_FMT = "<QHBBB3xQ3Q"                  # struct trace_record
+NAME_LEN = 24
+
+PHASES = {0: "B", 1: "E", 2: "i"}
+CTX_IRQ = 1
+IRQ_TID = -1
+
+
+def parse(data):
+    hdr_size = struct.calcsize(HEADER_FMT)
+    if len(data) < hdr_size:
+        raise ValueError("file too short for a trace header")
+
+    magic, version, record_size, tsc_khz, name_count, record_count, dropped = \
+        struct.unpack_from(HEADER_FMT, data, 0)
+    if magic != TRACE_FILE_MAGIC:
+        raise ValueError("not a PhantomOS trace file (bad magic)")
+    if version != 1 or record_size != struct.calcsize(RECORD_FMT):
+        raise ValueError("unsupported trace version %d / record size %d"
+                         % (version, record_size))
+
+    off = hdr_size
+    names = []
+    for _ in range(name_count):
+        raw = data[off:off + NAME_LEN]
+        names.append(raw.split(b"\0", 1)[0].decode("ascii", "replace"))
+        off += NAME_LEN
+
+    records = []
+    for _ in range(record_count):
+        if off + record_size > len(data):
+            break
+        records.append(struct.unpack_from(RECORD_FMT, data, off))
+        off += record_size
+
+    return tsc_khz, names, records, dropped
+
+
+def convert(tsc_khz, names, records, dropped):
+    records.sort(key=lambda r: r[0])
+    t0 = records[0][0] if records else 0
+    scale = 1000.0 / tsc_khz if tsc_khz else 1.0   # TSC cycles -> us
+
+    events = []
+    pids = set()
+    for tsc, rid, phase, cpu, ctx, pid, a0, a1, a2 in records:
+        name = names[rid] if rid < len(names) else "id%d" % rid
+        tid = IRQ_TID if ctx == CTX_IRQ else pid
+        pids.add(tid)
+        ev = {
+            "name": name,
+            "ph": PHASES.get(phase, "i"),
+            "ts": (tsc - t0) * scale,
+            "pid": cpu,
+            "tid": tid,
+        }
+        if ev["ph"] == "i":
+            ev["s"] = "t"
+        if ev["ph"] != "E" or a0:
+            ev["args"] = {"a0": a0, "a1": a1, "a2": a2}
+        events.append(ev)
+
+    for tid in sorted(pids):
+        events.append({
+            "name": "thread_name", "ph": "M", "pid": 0, "tid": tid,
+            "args": {"name": "irq" if tid == IRQ_TID else "pid %d" % tid},
+        })
+
+    return {
+        "traceEvents": events,
+        "displayTimeUnit": "ns",
+        "otherData": {"tsc_khz": tsc_khz, "dropped": dropped},
+    }
+
+
+def main():
+    if len(sys.argv) != 2:
+        print("usage: trace2json.py <trace.bin>", file=sys.stderr)
+        return 1
+
+    with open(sys.argv[1], "rb") as f:
+        data = f.read()
+
+    try:
+        tsc_khz, names, records, dropped = parse(data)
+    except ValueError as e:
+        print("trace2json: %s" % e, file=sys.stderr)
+        return 1
+
+    if dropped:
+        print("trace2json: note: %d records were overwritten before export"
+              % dropped, file=sys.stderr)
+
+    json.dump(convert(tsc_khz, names, records, dropped), sys.stdout)
+    sys.stdout.write("\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())